@@ -110,6 +110,9 @@ const char* commands_get_description(u8 command_type)
       case COMMAND_ID_DOWNLOAD_FILE: strcpy(szCommandDesc, "Download_File"); break;
       case COMMAND_ID_DOWNLOAD_FILE_SEGMENT: strcpy(szCommandDesc, "Download_File_Segment"); break;
       case COMMAND_ID_CLEAR_LOGS: strcpy(szCommandDesc, "Clear_Logs"); break;
+      case COMMAND_ID_DOWNLOAD_FILE_WINDOW: strcpy(szCommandDesc, "Download_File_Window"); break;
+      case COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT: strcpy(szCommandDesc, "Upload_File_Bulk_Segment"); break;
+      case COMMAND_ID_MODEL_SYNC_ACK: strcpy(szCommandDesc, "Model_Sync_Ack"); break;
        
       case COMMAND_ID_MANUAL_SWITCH_TO_VIDEO_LINK_QUALITY_LOW: strcpy(szCommandDesc, "Manual switch to video link low quality"); break;
       case COMMAND_ID_MANUAL_SWITCH_TO_VIDEO_LINK_QUALITY_MED: strcpy(szCommandDesc, "Manual switch to video link med quality"); break;
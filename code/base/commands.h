@@ -167,6 +167,8 @@ typedef struct
 //    bit 4: enable developer vehicle video link graphs
 //    bit 5: request sending of full mavlink/ltm telemetry packets
 //    bit 6: send back response in small segments (150 bytes each, for low rate radio links)
+//    bit 7: model sync: the command has the controller's model sections hashes (t_model_sync_hashes) as data.
+//           The vehicle can then send back only the changed sections (see base/models_sync.h)
 
 //  byte 1:
 //    MAVLink sys id of the controller
@@ -184,6 +186,14 @@ typedef struct
 //               1 byte: total segments
 //               1 byte: segment size
 //               N bytes - segment data (150 bytes)
+//   * model sync response (response param is COMMAND_GET_ALL_PARAMS_RESPONSE_MODEL_SYNC), if model sync was requested
+//     and the changed sections are smaller than the zip model settings. Has:
+//               t_model_sync_hashes: the vehicle's model sections hashes
+//               u32: transfer id
+//               u32: changed sections mask, sent as PACKET_TYPE_RUBY_MODEL_SECTION packets with the same transfer id
+
+#define COMMAND_GET_ALL_PARAMS_FLAG_MODEL_SYNC (((u32)0x01)<<7)
+#define COMMAND_GET_ALL_PARAMS_RESPONSE_MODEL_SYNC 2
 
 
 #define COMMAND_ID_GET_CURRENT_VIDEO_CONFIG 101
@@ -244,6 +254,7 @@ typedef struct
 
 
 #define COMMAND_ID_DOWNLOAD_FILE 211 // has as param the ID of the file to download (high bit: request just status); has a response info about the file: t_packet_header_download_file_info
+#define COMMAND_DOWNLOAD_FILE_FLAG_RESUME 0x00800000 // in param: keep the file already prepared by the vehicle, if any, to resume a partial download
 
 typedef struct
 {
@@ -254,11 +265,36 @@ typedef struct
    u8 isReady; // 1 - file is ready: 0 - file is being preprocessed; 2 - error
 } __attribute__((packed)) t_packet_header_download_file_info;
 
+// Vehicles that support bulk transfers append this to the t_packet_header_download_file_info response, once the file is ready
+typedef struct
+{
+   u32 uTransferId; // CRC of the whole file
+   u32 uFileSize;
+   u16 uSegmentSize;
+   u16 uWindowSegments;
+} __attribute__((packed)) t_packet_header_download_file_bulk_info;
+
 #define COMMAND_ID_DOWNLOAD_FILE_SEGMENT 212 // has as param: low word: file ID, high word: file segment; has as response data: dword: fileid and segment id then segment data
 
 
 #define COMMAND_ID_CLEAR_LOGS 213
 
+#define COMMAND_ID_DOWNLOAD_FILE_WINDOW 214 // bulk download: the vehicle sends the missing segments of a window as PACKET_TYPE_RUBY_FILE_TRANSFER_SEGMENT packets. Has a t_file_transfer_window, no response.
+#define COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT 215 // bulk upload: has a t_packet_header_file_transfer_segment and then the segment data.
+// Sent without response, except the last missing segment of a window, that has a t_file_transfer_window as response.
+#define COMMAND_ID_MODEL_SYNC_ACK 216 // Sent by controller after it got all the model sections of a model sync transfer (see base/models_sync.h), no response.
+// Has a u32 transfer id and then the t_model_sync_hashes of the controller's model after it applied the sections.
+// The vehicle uses the sections as the base for the next changes it sends only when the hashes match; it sends the changes again if no ack is received.
+
+typedef struct
+{
+   u32 uFileId;
+   u32 uTransferId;
+   u32 uWindowStart; // First segment of the window, multiple of FILE_TRANSFER_WINDOW_SEGMENTS
+   u32 uAckBitmap[2]; // Segments of the window the receiver already has
+   u32 uMaxBytesPerSec; // Bandwidth cap for the sender, 0 for the default one
+} __attribute__((packed)) t_file_transfer_window;
+
 
 #define COMMAND_ID_MANUAL_SWITCH_TO_VIDEO_LINK_QUALITY_LOW 220
 #define COMMAND_ID_MANUAL_SWITCH_TO_VIDEO_LINK_QUALITY_MED 221
@@ -83,6 +83,8 @@
 #define DEFAULT_RADIO_SERIAL_AIR_MAX_PACKET_SIZE 127
 #define DEFAULT_RADIO_SERIAL_MAX_TX_LOAD 75 // in percentages
 
+#define DEFAULT_FILE_TRANSFER_MAX_KBPS 400 // Bandwidth cap for bulk file transfers between vehicle and controller
+
 // in bps
 #define DEFAULT_RADIO_DATARATE_SERIAL_AIR 4000
 #define DEFAULT_RADIO_DATARATE_SIK_AIR 64000
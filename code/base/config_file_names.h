@@ -11,6 +11,8 @@
 #define LOG_FILE_COMMANDS "log_commands.txt"
 #define LOG_FILE_WATCHDOG "log_watchdog.txt"
 #define LOG_FILE_VIDEO "log_video.txt"
+#define LOG_FILE_ADAPTIVE_VIDEO_STATS "log_adaptive_video.csv"
+#define LOG_FILE_OSD_PROFILER "log_osd_profiler.csv"
 #define LOG_FILE_CAPTURE_VEYE "log_capture_veye.txt"
 #define LOG_FILE_VEHICLE "log_vehicle_%s.txt"
 
@@ -33,6 +35,7 @@
 #define FILE_CONFIG_BOARD_TYPE "board.txt"
 #define FILE_VEHICLE_SPECTATOR "spect-%d.mdl"
 #define FILE_VEHICLE_CONTROLL "ctrl-%d.mdl"
+#define FILE_VEHICLE_MODELS_INDEX "models_index.bin"
 #define FILE_CONFIG_ACTIVE_CONTROLLER_MODEL "controller_active_model.cfg"
 #define FILE_CONFIG_CURRENT_VEHICLE_MODEL "current_vehicle.mdl"
 #define FILE_CONFIG_CURRENT_VEHICLE_MODEL_BACKUP "current_vehicle.bak"
@@ -42,6 +45,7 @@
 #define FILE_CONFIG_HARDWARE_I2C_DEVICES "i2c_devices_settings.cfg"
 #define FILE_CONFIG_ENCRYPTION_PASS "current_pph.cfg"
 #define FILE_CONFIG_HW_SERIAL_PORTS "hw_serial.cfg"
+#define FILE_CONFIG_MAVLINK_ROUTER "mavlink_router.cfg"
 #define FILE_CONFIG_MODELS_CONNECT_FREQUENCIES "models_connect_freq.cfg"
 #define FILE_CONFIG_LAST_SIK_RADIOS_DETECTED "last_sik_radios_detected.cfg"
 #define FILE_CONFIG_BOOT_TIMESTAMP "boot_timestamp.cfg"
@@ -31,6 +31,7 @@
 // rc_params.flags fields:
 
 #define RC_FLAGS_OUTPUT_ENABLED  0x01 // bit 0
+#define RC_FLAGS_LOW_LATENCY_PATH  0x02 // bit 1: RC frames bypass the router queues and are forwarded to the FC as soon as they are received
 
 
 #define DEFAULT_RC_FRAMES_PER_SECOND 20
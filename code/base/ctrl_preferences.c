@@ -34,6 +34,7 @@
 #include "hardware.h"
 #include "hw_procs.h"
 #include "ctrl_preferences.h"
+#include "ctrl_settings_store.h"
 #include <ctype.h>
 
 #define PREFERENCES_SETTINGS_STAMP_ID "vIV.3"
@@ -42,6 +43,8 @@
 
 Preferences s_Preferences;
 
+type_ctrl_settings_store s_PreferencesStore = { SHARED_MEM_CONTROLLER_PREFERENCES, 0, NULL, 0, 0 };
+
 void reset_Preferences()
 {
    memset(&s_Preferences, 0, sizeof(s_Preferences));
@@ -176,15 +179,32 @@ int save_Preferences()
    fprintf(fd, "%d %d %d\n", s_Preferences.iShowOnlyPresentTxPowerCards, s_Preferences.iShowTxBoosters, s_Preferences.iMenuStyle);
 
    fclose(fd);
+   ctrl_settings_store_publish(&s_PreferencesStore, szFile, &s_Preferences, sizeof(Preferences));
    log_line("Saved preferences to file: %s", szFile);
    return 1;
 }
 
+int publish_Preferences()
+{
+   if ( ! ctrl_settings_store_set_publisher(&s_PreferencesStore) )
+      return 0;
+
+   char szFile[128];
+   strcpy(szFile, FOLDER_CONFIG);
+   strcat(szFile, FILE_CONFIG_UI_PREFERENCES);
+   return ctrl_settings_store_publish(&s_PreferencesStore, szFile, &s_Preferences, sizeof(Preferences));
+}
+
 int load_Preferences()
 {
    char szFile[128];
    strcpy(szFile, FOLDER_CONFIG);
    strcat(szFile, FILE_CONFIG_UI_PREFERENCES);
+
+   // Published by ruby_central or saved as binary, if still matching the preferences file
+   if ( ctrl_settings_store_load(&s_PreferencesStore, szFile, &s_Preferences, sizeof(Preferences)) )
+      return 1;
+
    FILE* fd = fopen(szFile, "r");
    if ( NULL == fd )
    {
@@ -384,6 +404,7 @@ int load_Preferences()
       return 0;
    }
    fclose(fd);
+   ctrl_settings_store_save_snapshot(&s_PreferencesStore, szFile, &s_Preferences, sizeof(Preferences));
    log_line("Loaded preferences from file: %s", szFile);
    return 1;
 }
@@ -397,6 +418,7 @@ Preferences* get_Preferences()
 
 int save_Preferences() { return 0; }
 int load_Preferences() { return 0; }
+int publish_Preferences() { return 0; }
 void reset_Preferences() {}
 Preferences* get_Preferences() { return NULL; }
 #endif
\ No newline at end of file
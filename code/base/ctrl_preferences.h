@@ -112,6 +112,8 @@ typedef struct
 
 int save_Preferences();
 int load_Preferences();
+// Called by ruby_central: publishes the preferences in shared memory now and on each save
+int publish_Preferences();
 void reset_Preferences();
 Preferences* get_Preferences();
 
@@ -32,6 +32,7 @@
 #include "base.h"
 #include "config.h"
 #include "ctrl_settings.h"
+#include "ctrl_settings_store.h"
 #include "hardware.h"
 #include "hardware_radio.h"
 #include "hw_procs.h"
@@ -42,6 +43,10 @@
 ControllerSettings s_CtrlSettings;
 int s_CtrlSettingsLoaded = 0;
 
+// Increase on any change to the ControllerSettings structure
+#define CONTROLLER_SETTINGS_BINARY_VERSION 2
+type_ctrl_settings_store s_CtrlSettingsStore = { SHARED_MEM_CONTROLLER_SETTINGS, 0, NULL, 0, 0 };
+
 void reset_ControllerSettings()
 {
    memset(&s_CtrlSettings, 0, sizeof(s_CtrlSettings));
@@ -115,6 +120,10 @@ void reset_ControllerSettings()
    s_CtrlSettings.iRadioTxThreadPriority = DEFAULT_PRIORITY_THREAD_RADIO_TX;
    s_CtrlSettings.iRadioTxUsesPPCAP = DEFAULT_USE_PPCAP_FOR_TX;
    s_CtrlSettings.iRadioBypassSocketBuffers = DEFAULT_BYPASS_SOCKET_BUFFERS;
+   s_CtrlSettings.iDisplayTripleBuffering = 0;
+   s_CtrlSettings.iVideoDisplayLowestLatency = 0;
+   s_CtrlSettings.iFileTransferMaxKbps = DEFAULT_FILE_TRANSFER_MAX_KBPS;
+   s_CtrlSettings.iDevLogAdaptiveVideoStats = 0;
 
    log_line("Reseted controller settings.");
 }
@@ -170,12 +179,29 @@ int save_ControllerSettings()
    fprintf(fd, "%d\n", s_CtrlSettings.iSiKPacketSize);
    fprintf(fd, "%d %d\n", s_CtrlSettings.iRadioRxThreadPriority, s_CtrlSettings.iRadioTxThreadPriority);
    fprintf(fd, "%d %d\n", s_CtrlSettings.iRadioTxUsesPPCAP, s_CtrlSettings.iRadioBypassSocketBuffers);
+   fprintf(fd, "%d %d\n", s_CtrlSettings.iDisplayTripleBuffering, s_CtrlSettings.iVideoDisplayLowestLatency);
+   fprintf(fd, "%d\n", s_CtrlSettings.iFileTransferMaxKbps);
+   fprintf(fd, "%d\n", s_CtrlSettings.iDevLogAdaptiveVideoStats);
    fclose(fd);
 
+   ctrl_settings_store_publish(&s_CtrlSettingsStore, szFile, &s_CtrlSettings, sizeof(ControllerSettings));
    log_line("Saved controller settings to file: %s", szFile);
    return 1;
 }
 
+int publish_ControllerSettings()
+{
+   if ( ! ctrl_settings_store_set_publisher(&s_CtrlSettingsStore) )
+      return 0;
+   if ( ! s_CtrlSettingsLoaded )
+      load_ControllerSettings();
+
+   char szFile[128];
+   strcpy(szFile, FOLDER_CONFIG);
+   strcat(szFile, FILE_CONFIG_CONTROLLER_SETTINGS);
+   return ctrl_settings_store_publish(&s_CtrlSettingsStore, szFile, &s_CtrlSettings, sizeof(ControllerSettings));
+}
+
 int load_ControllerSettings()
 {
    reset_ControllerSettings();
@@ -184,6 +210,11 @@ int load_ControllerSettings()
    char szFile[128];
    strcpy(szFile, FOLDER_CONFIG);
    strcat(szFile, FILE_CONFIG_CONTROLLER_SETTINGS);
+
+   // Published by ruby_central or saved as binary, if still matching the settings file
+   if ( ctrl_settings_store_load(&s_CtrlSettingsStore, szFile, &s_CtrlSettings, sizeof(ControllerSettings)) )
+      return 1;
+
    FILE* fd = fopen(szFile, "r");
    if ( NULL == fd )
    {
@@ -381,6 +412,15 @@ int load_ControllerSettings()
       s_CtrlSettings.iRadioBypassSocketBuffers = DEFAULT_BYPASS_SOCKET_BUFFERS;
    }
 
+   if ( (!failed) && (1 != fscanf(fd, "%d", &s_CtrlSettings.iDisplayTripleBuffering)) )
+      s_CtrlSettings.iDisplayTripleBuffering = 0;
+   if ( (!failed) && (1 != fscanf(fd, "%d", &s_CtrlSettings.iVideoDisplayLowestLatency)) )
+      s_CtrlSettings.iVideoDisplayLowestLatency = 0;
+   if ( (!failed) && (1 != fscanf(fd, "%d", &s_CtrlSettings.iFileTransferMaxKbps)) )
+      s_CtrlSettings.iFileTransferMaxKbps = DEFAULT_FILE_TRANSFER_MAX_KBPS;
+   if ( (!failed) && (1 != fscanf(fd, "%d", &s_CtrlSettings.iDevLogAdaptiveVideoStats)) )
+      s_CtrlSettings.iDevLogAdaptiveVideoStats = 0;
+
    fclose(fd);
 
    //--------------------------------------------------------
@@ -419,6 +459,8 @@ int load_ControllerSettings()
 
    if ( (s_CtrlSettings.iSiKPacketSize < 10) || (s_CtrlSettings.iSiKPacketSize > 250 ) )
       s_CtrlSettings.iSiKPacketSize = DEFAULT_SIK_PACKET_SIZE;
+   if ( (s_CtrlSettings.iFileTransferMaxKbps < 0) || (s_CtrlSettings.iFileTransferMaxKbps > 100000) )
+      s_CtrlSettings.iFileTransferMaxKbps = DEFAULT_FILE_TRANSFER_MAX_KBPS;
    if ( failed )
    {
       log_line("Incomplete/Invalid settings file %s, error code: %d. Reseted to default.", szFile, failed);
@@ -426,7 +468,10 @@ int load_ControllerSettings()
       save_ControllerSettings();
    }
    else
+   {
+      ctrl_settings_store_save_snapshot(&s_CtrlSettingsStore, szFile, &s_CtrlSettings, sizeof(ControllerSettings));
       log_line("Loaded controller settings from file: %s", szFile);
+   }
    return 1;
 }
 
@@ -464,6 +509,7 @@ u32 compute_ping_interval_ms(u32 uModelFlags, u32 uRxTxSyncType, u32 uCurrentVid
 #else
 int save_ControllerSettings() { return 0; }
 int load_ControllerSettings() { return 0; }
+int publish_ControllerSettings() { return 0; }
 void reset_ControllerSettings() {}
 ControllerSettings* get_ControllerSettings() { return NULL; }
 
@@ -79,10 +79,18 @@ typedef struct
    int iRadioTxThreadPriority;
    int iRadioTxUsesPPCAP;
    int iRadioBypassSocketBuffers;
+
+   int iDisplayTripleBuffering; // Uses 3 display buffers for the OSD (Radxa only)
+   int iVideoDisplayLowestLatency; // Video player shows the newest frame at next vblank instead of pacing frames (Radxa only)
+
+   int iFileTransferMaxKbps; // Bandwidth cap for bulk file transfers to/from vehicle (logs download, plugins upload)
+   int iDevLogAdaptiveVideoStats; // Records the predictive adaptive video link stats to a CSV file in the logs folder
 } ControllerSettings;
 
 int save_ControllerSettings();
 int load_ControllerSettings();
+// Called by ruby_central: publishes the settings in shared memory now and on each save, for the other processes to load them from there
+int publish_ControllerSettings();
 void reset_ControllerSettings();
 ControllerSettings* get_ControllerSettings();
 
@@ -0,0 +1,355 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "base.h"
+#include "config.h"
+#include "hardware.h"
+#include "ctrl_settings_store.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define CTRL_SETTINGS_BINARY_MAGIC 0x43534252
+
+typedef struct
+{
+   u32 uMagic;
+   u32 uVersion;
+   u32 uDataSize;
+   u32 uSourceSize;
+   u32 uSourceTimeSec;
+   u32 uSourceTimeNanoSec;
+   u32 uCRC; // of the header fields above and the data
+} __attribute__((packed)) t_ctrl_settings_binary_header;
+
+// The binary snapshot and the shared memory are valid only for the build that wrote them (and the same data size),
+// so a change to the settings structures does not need a version increase
+
+static u32 _ctrl_settings_store_get_version(type_ctrl_settings_store* pStore, int iDataSize)
+{
+   if ( 0 != pStore->uVersion )
+      return pStore->uVersion;
+   char szBuild[128];
+   snprintf(szBuild, sizeof(szBuild)/sizeof(szBuild[0]), "%d.%d.%d %s %s %d", SYSTEM_SW_VERSION_MAJOR, SYSTEM_SW_VERSION_MINOR, SYSTEM_SW_BUILD_NUMBER, __DATE__, __TIME__, iDataSize);
+   pStore->uVersion = base_compute_crc32((u8*)szBuild, strlen(szBuild));
+   if ( 0 == pStore->uVersion )
+      pStore->uVersion = 1;
+   return pStore->uVersion;
+}
+
+static void _ctrl_settings_store_get_binary_file_name(const char* szTextFile, char* szOutput)
+{
+   strncpy(szOutput, szTextFile, MAX_FILE_PATH_SIZE-1);
+   szOutput[MAX_FILE_PATH_SIZE-1] = 0;
+   char* pExt = strrchr(szOutput, '.');
+   if ( (NULL != pExt) && (NULL == strchr(pExt, '/')) )
+      *pExt = 0;
+   if ( strlen(szOutput) + 4 < MAX_FILE_PATH_SIZE )
+      strcat(szOutput, ".bin");
+}
+
+static int _ctrl_settings_store_get_source_info(const char* szTextFile, u32* puSize, u32* puTimeSec, u32* puTimeNanoSec)
+{
+   struct stat statSource;
+   if ( 0 != stat(szTextFile, &statSource) )
+      return 0;
+   *puSize = (u32) statSource.st_size;
+   *puTimeSec = (u32) statSource.st_mtim.tv_sec;
+   *puTimeNanoSec = (u32) statSource.st_mtim.tv_nsec;
+   return 1;
+}
+
+// Does not clear the content (as open_shared_mem does): the publisher can restart while readers use it
+
+static int _ctrl_settings_store_open(type_ctrl_settings_store* pStore)
+{
+   if ( NULL != pStore->pSharedMem )
+      return 1;
+
+   // Readers retry at most once a second, the settings are not published until ruby_central starts
+   u32 uTimeNow = get_current_timestamp_ms();
+   if ( (! pStore->iIsPublisher) && (0 != pStore->uTimeLastOpenAttempt) && (uTimeNow < pStore->uTimeLastOpenAttempt + 1000) )
+      return 0;
+   pStore->uTimeLastOpenAttempt = uTimeNow;
+
+   int fd = -1;
+   if ( pStore->iIsPublisher )
+      fd = shm_open(pStore->szSharedMemName, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+   else
+      fd = shm_open(pStore->szSharedMemName, O_RDONLY, S_IRUSR | S_IWUSR);
+   if ( fd < 0 )
+   {
+      if ( pStore->iIsPublisher )
+         log_softerror_and_alarm("[CtrlSettingsStore] Failed to open shared memory %s for write: %s", pStore->szSharedMemName, strerror(errno));
+      return 0;
+   }
+   if ( pStore->iIsPublisher && (0 != ftruncate(fd, sizeof(shared_mem_ctrl_settings))) )
+   {
+      log_softerror_and_alarm("[CtrlSettingsStore] Failed to init (ftruncate) shared memory %s.", pStore->szSharedMemName);
+      close(fd);
+      return 0;
+   }
+   struct stat statShm;
+   if ( (0 != fstat(fd, &statShm)) || (statShm.st_size < (int)sizeof(shared_mem_ctrl_settings)) )
+   {
+      close(fd);
+      return 0;
+   }
+   void* pAddress = mmap(NULL, sizeof(shared_mem_ctrl_settings), pStore->iIsPublisher?(PROT_READ | PROT_WRITE):PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if ( MAP_FAILED == pAddress )
+   {
+      log_softerror_and_alarm("[CtrlSettingsStore] Failed to map shared memory %s.", pStore->szSharedMemName);
+      return 0;
+   }
+   pStore->pSharedMem = (shared_mem_ctrl_settings*)pAddress;
+   return 1;
+}
+
+int ctrl_settings_store_set_publisher(type_ctrl_settings_store* pStore)
+{
+   if ( NULL == pStore )
+      return 0;
+   if ( pStore->iIsPublisher && (NULL != pStore->pSharedMem) )
+      return 1;
+   ctrl_settings_store_close(pStore);
+   pStore->iIsPublisher = 1;
+   if ( ! _ctrl_settings_store_open(pStore) )
+      return 0;
+   log_line("[CtrlSettingsStore] This process publishes %s.", pStore->szSharedMemName);
+   return 1;
+}
+
+void ctrl_settings_store_close(type_ctrl_settings_store* pStore)
+{
+   if ( NULL == pStore )
+      return;
+   if ( NULL != pStore->pSharedMem )
+      munmap(pStore->pSharedMem, sizeof(shared_mem_ctrl_settings));
+   pStore->pSharedMem = NULL;
+}
+
+static int _ctrl_settings_store_load_shared_mem(type_ctrl_settings_store* pStore, u32 uSourceSize, u32 uSourceTimeSec, u32 uSourceTimeNanoSec, void* pData, int iDataSize)
+{
+   if ( ! _ctrl_settings_store_open(pStore) )
+      return 0;
+
+   shared_mem_ctrl_settings* pSM = pStore->pSharedMem;
+   for( int iRetry=0; iRetry<20; iRetry++ )
+   {
+      u32 uGeneration = pSM->uGeneration;
+      if ( 0 == uGeneration )
+         return 0;
+      if ( uGeneration & 0x01 )
+      {
+         hardware_sleep_micros(200);
+         continue;
+      }
+      __sync_synchronize();
+
+      if ( (pSM->uVersion != _ctrl_settings_store_get_version(pStore, iDataSize)) || (pSM->uDataSize != (u32)iDataSize) )
+         return 0;
+      if ( (pSM->uSourceSize != uSourceSize) || (pSM->uSourceTimeSec != uSourceTimeSec) || (pSM->uSourceTimeNanoSec != uSourceTimeNanoSec) )
+         return 0;
+
+      u8 uBuffer[CTRL_SETTINGS_STORE_MAX_DATA_SIZE];
+      memcpy(uBuffer, pSM->uData, iDataSize);
+
+      __sync_synchronize();
+      if ( pSM->uGeneration != uGeneration )
+         continue;
+      memcpy(pData, uBuffer, iDataSize);
+      return 1;
+   }
+   return 0;
+}
+
+static int _ctrl_settings_store_load_binary(type_ctrl_settings_store* pStore, const char* szTextFile, u32 uSourceSize, u32 uSourceTimeSec, u32 uSourceTimeNanoSec, void* pData, int iDataSize)
+{
+   char szFile[MAX_FILE_PATH_SIZE];
+   _ctrl_settings_store_get_binary_file_name(szTextFile, szFile);
+   int fd = open(szFile, O_RDONLY);
+   if ( fd < 0 )
+      return 0;
+
+   u8 uBuffer[sizeof(t_ctrl_settings_binary_header) + CTRL_SETTINGS_STORE_MAX_DATA_SIZE];
+   int iExpected = sizeof(t_ctrl_settings_binary_header) + iDataSize;
+   int iRead = (int)read(fd, uBuffer, iExpected + 1);
+   close(fd);
+   if ( iRead != iExpected )
+      return 0;
+
+   t_ctrl_settings_binary_header* pHeader = (t_ctrl_settings_binary_header*)uBuffer;
+   if ( (pHeader->uMagic != CTRL_SETTINGS_BINARY_MAGIC) || (pHeader->uVersion != _ctrl_settings_store_get_version(pStore, iDataSize)) || (pHeader->uDataSize != (u32)iDataSize) )
+      return 0;
+   if ( (pHeader->uSourceSize != uSourceSize) || (pHeader->uSourceTimeSec != uSourceTimeSec) || (pHeader->uSourceTimeNanoSec != uSourceTimeNanoSec) )
+      return 0;
+   u32 uCRC = pHeader->uCRC;
+   pHeader->uCRC = 0;
+   if ( uCRC != base_compute_crc32(uBuffer, iExpected) )
+   {
+      log_softerror_and_alarm("[CtrlSettingsStore] Invalid binary settings file %s (CRC).", szFile);
+      return 0;
+   }
+   memcpy(pData, uBuffer + sizeof(t_ctrl_settings_binary_header), iDataSize);
+   return 1;
+}
+
+int ctrl_settings_store_load(type_ctrl_settings_store* pStore, const char* szTextFile, void* pData, int iDataSize)
+{
+   if ( (NULL == pStore) || (NULL == szTextFile) || (NULL == pData) )
+      return 0;
+   if ( (iDataSize <= 0) || (iDataSize > CTRL_SETTINGS_STORE_MAX_DATA_SIZE) )
+      return 0;
+
+   u32 uSourceSize = 0, uSourceTimeSec = 0, uSourceTimeNanoSec = 0;
+   if ( ! _ctrl_settings_store_get_source_info(szTextFile, &uSourceSize, &uSourceTimeSec, &uSourceTimeNanoSec) )
+      return 0;
+
+   u32 uTimeStart = get_current_timestamp_micros();
+   if ( _ctrl_settings_store_load_shared_mem(pStore, uSourceSize, uSourceTimeSec, uSourceTimeNanoSec, pData, iDataSize) )
+   {
+      log_line("[CtrlSettingsStore] Loaded %s from shared memory (%u us).", szTextFile, get_current_timestamp_micros() - uTimeStart);
+      return 1;
+   }
+   if ( _ctrl_settings_store_load_binary(pStore, szTextFile, uSourceSize, uSourceTimeSec, uSourceTimeNanoSec, pData, iDataSize) )
+   {
+      log_line("[CtrlSettingsStore] Loaded %s from binary file (%u us).", szTextFile, get_current_timestamp_micros() - uTimeStart);
+      return 1;
+   }
+   return 0;
+}
+
+static void _ctrl_settings_store_save_binary(type_ctrl_settings_store* pStore, const char* szTextFile, u32 uSourceSize, u32 uSourceTimeSec, u32 uSourceTimeNanoSec, void* pData, int iDataSize)
+{
+   u8 uBuffer[sizeof(t_ctrl_settings_binary_header) + CTRL_SETTINGS_STORE_MAX_DATA_SIZE];
+   int iTotalSize = sizeof(t_ctrl_settings_binary_header) + iDataSize;
+   t_ctrl_settings_binary_header* pHeader = (t_ctrl_settings_binary_header*)uBuffer;
+   pHeader->uMagic = CTRL_SETTINGS_BINARY_MAGIC;
+   pHeader->uVersion = _ctrl_settings_store_get_version(pStore, iDataSize);
+   pHeader->uDataSize = (u32)iDataSize;
+   pHeader->uSourceSize = uSourceSize;
+   pHeader->uSourceTimeSec = uSourceTimeSec;
+   pHeader->uSourceTimeNanoSec = uSourceTimeNanoSec;
+   pHeader->uCRC = 0;
+   memcpy(uBuffer + sizeof(t_ctrl_settings_binary_header), pData, iDataSize);
+   pHeader->uCRC = base_compute_crc32(uBuffer, iTotalSize);
+
+   // Write to a temporary file and rename it, as several processes can parse and save the settings at the same time
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   char szFileTmp[MAX_FILE_PATH_SIZE+16];
+   _ctrl_settings_store_get_binary_file_name(szTextFile, szFile);
+   snprintf(szFileTmp, sizeof(szFileTmp)/sizeof(szFileTmp[0]), "%s.%d", szFile, (int)getpid());
+
+   int iOk = 0;
+   int fd = open(szFileTmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if ( fd >= 0 )
+   {
+      if ( iTotalSize == (int)write(fd, uBuffer, iTotalSize) )
+         iOk = 1;
+      close(fd);
+      if ( iOk && (0 != rename(szFileTmp, szFile)) )
+         iOk = 0;
+      if ( ! iOk )
+         unlink(szFileTmp);
+   }
+   if ( ! iOk )
+      log_softerror_and_alarm("[CtrlSettingsStore] Failed to save binary settings file: %s", szFile);
+}
+
+static void _ctrl_settings_store_write_shared_mem(type_ctrl_settings_store* pStore, u32 uSourceSize, u32 uSourceTimeSec, u32 uSourceTimeNanoSec, void* pData, int iDataSize)
+{
+   if ( ! _ctrl_settings_store_open(pStore) )
+      return;
+
+   // Single publisher: no lock needed, the generation is odd while the content changes
+   shared_mem_ctrl_settings* pSM = pStore->pSharedMem;
+   u32 uGeneration = pSM->uGeneration | 0x01;
+   pSM->uGeneration = uGeneration;
+   __sync_synchronize();
+
+   pSM->uVersion = _ctrl_settings_store_get_version(pStore, iDataSize);
+   pSM->uDataSize = (u32)iDataSize;
+   pSM->uSourceSize = uSourceSize;
+   pSM->uSourceTimeSec = uSourceTimeSec;
+   pSM->uSourceTimeNanoSec = uSourceTimeNanoSec;
+   pSM->uTimePublished = get_current_timestamp_ms();
+   memcpy(pSM->uData, pData, iDataSize);
+
+   __sync_synchronize();
+   pSM->uGeneration = uGeneration + 1;
+}
+
+static int _ctrl_settings_store_check_data(const char* szTextFile, void* pData, int iDataSize)
+{
+   if ( (NULL == szTextFile) || (NULL == pData) )
+      return 0;
+   if ( (iDataSize <= 0) || (iDataSize > CTRL_SETTINGS_STORE_MAX_DATA_SIZE) )
+   {
+      log_softerror_and_alarm("[CtrlSettingsStore] Invalid settings size (%d bytes) for %s.", iDataSize, szTextFile);
+      return 0;
+   }
+   return 1;
+}
+
+int ctrl_settings_store_publish(type_ctrl_settings_store* pStore, const char* szTextFile, void* pData, int iDataSize)
+{
+   if ( (NULL == pStore) || (! pStore->iIsPublisher) )
+      return 0;
+   if ( ! _ctrl_settings_store_check_data(szTextFile, pData, iDataSize) )
+      return 0;
+
+   u32 uSourceSize = 0, uSourceTimeSec = 0, uSourceTimeNanoSec = 0;
+   if ( ! _ctrl_settings_store_get_source_info(szTextFile, &uSourceSize, &uSourceTimeSec, &uSourceTimeNanoSec) )
+      return 0;
+
+   _ctrl_settings_store_write_shared_mem(pStore, uSourceSize, uSourceTimeSec, uSourceTimeNanoSec, pData, iDataSize);
+   return 1;
+}
+
+int ctrl_settings_store_save_snapshot(type_ctrl_settings_store* pStore, const char* szTextFile, void* pData, int iDataSize)
+{
+   if ( NULL == pStore )
+      return 0;
+   if ( ! _ctrl_settings_store_check_data(szTextFile, pData, iDataSize) )
+      return 0;
+
+   u32 uSourceSize = 0, uSourceTimeSec = 0, uSourceTimeNanoSec = 0;
+   if ( ! _ctrl_settings_store_get_source_info(szTextFile, &uSourceSize, &uSourceTimeSec, &uSourceTimeNanoSec) )
+      return 0;
+
+   _ctrl_settings_store_save_binary(pStore, szTextFile, uSourceSize, uSourceTimeSec, uSourceTimeNanoSec, pData, iDataSize);
+   if ( pStore->iIsPublisher )
+      _ctrl_settings_store_write_shared_mem(pStore, uSourceSize, uSourceTimeSec, uSourceTimeNanoSec, pData, iDataSize);
+   return 1;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "base.h"
+
+// Fast load path for the controller settings and preferences files.
+// Each settings text file gets a binary snapshot next to it (same name, .bin extension), and the settings are
+// also published in shared memory by the only process that changes them at runtime (ruby_central).
+// Both keep the size and modification time of the text file they were created from, so a text file written
+// by other means (update, import) invalidates them and the text file is parsed again. They are also valid only
+// for the build that wrote them, so changes to the settings structures need no version increase.
+// Saves write only the text file (and update the shared memory); the binary snapshot is written when a process
+// has to parse the text file, so it costs one extra SD card write per change, not per save.
+// A generation counter (odd while the publisher writes) lets readers get a consistent copy from the shared memory.
+
+#define SHARED_MEM_CONTROLLER_SETTINGS "/SYSTEM_SHARED_MEM_RUBY_CONTROLLER_SETTINGS"
+#define SHARED_MEM_CONTROLLER_PREFERENCES "/SYSTEM_SHARED_MEM_RUBY_CONTROLLER_PREFERENCES"
+#define CTRL_SETTINGS_STORE_MAX_DATA_SIZE 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+   u32 uGeneration; // Odd while the publisher writes
+   u32 uVersion;
+   u32 uDataSize;
+   u32 uSourceSize;
+   u32 uSourceTimeSec;
+   u32 uSourceTimeNanoSec;
+   u32 uTimePublished;
+   u8 uData[CTRL_SETTINGS_STORE_MAX_DATA_SIZE];
+} __attribute__((packed)) shared_mem_ctrl_settings;
+
+typedef struct
+{
+   const char* szSharedMemName;
+   u32 uVersion; // Computed from the build and the data size on first use, set it to 0
+   shared_mem_ctrl_settings* pSharedMem;
+   int iIsPublisher;
+   u32 uTimeLastOpenAttempt;
+} type_ctrl_settings_store;
+
+// Makes this process the publisher of the settings in shared memory
+int ctrl_settings_store_set_publisher(type_ctrl_settings_store* pStore);
+
+// Loads the settings from shared memory or from the binary snapshot, if any of them matches the text file.
+// Returns 0 if the text file must be parsed; pData is not changed then.
+int ctrl_settings_store_load(type_ctrl_settings_store* pStore, const char* szTextFile, void* pData, int iDataSize);
+
+// Called after the text file was saved: updates the shared memory, if this process is the publisher
+int ctrl_settings_store_publish(type_ctrl_settings_store* pStore, const char* szTextFile, void* pData, int iDataSize);
+
+// Called after the text file was parsed: writes the binary snapshot and, for the publisher, updates the shared memory
+int ctrl_settings_store_save_snapshot(type_ctrl_settings_store* pStore, const char* szTextFile, void* pData, int iDataSize);
+
+void ctrl_settings_store_close(type_ctrl_settings_store* pStore);
+
+#ifdef __cplusplus
+}
+#endif
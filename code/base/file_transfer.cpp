@@ -0,0 +1,291 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "base.h"
+#include "file_transfer.h"
+
+#define FILE_TRANSFER_MIN_MATCH 4
+#define FILE_TRANSFER_HASH_BITS 12
+#define FILE_TRANSFER_MAX_OFFSET 0xFFFF
+
+static u32 _file_transfer_hash(u8* pData)
+{
+   u32 uValue = ((u32)pData[0]) | (((u32)pData[1])<<8) | (((u32)pData[2])<<16) | (((u32)pData[3])<<24);
+   return (uValue * 2654435761U) >> (32 - FILE_TRANSFER_HASH_BITS);
+}
+
+// Writes a length in the 255 run format used after a token nibble of 15
+static int _file_transfer_write_length(int iLength, u8* pOutput, int iPos, int iMaxOutputSize)
+{
+   while ( iLength >= 255 )
+   {
+      if ( iPos >= iMaxOutputSize )
+         return -1;
+      pOutput[iPos++] = 255;
+      iLength -= 255;
+   }
+   if ( iPos >= iMaxOutputSize )
+      return -1;
+   pOutput[iPos++] = (u8)iLength;
+   return iPos;
+}
+
+static int _file_transfer_write_sequence(u8* pLiterals, int iLiterals, int iOffset, int iMatchLength, u8* pOutput, int iPos, int iMaxOutputSize)
+{
+   if ( iPos >= iMaxOutputSize )
+      return -1;
+
+   int iTokenPos = iPos++;
+   u8 uToken = (iLiterals >= 15)?0xF0:(u8)(iLiterals<<4);
+   if ( iLiterals >= 15 )
+   {
+      iPos = _file_transfer_write_length(iLiterals - 15, pOutput, iPos, iMaxOutputSize);
+      if ( iPos < 0 )
+         return -1;
+   }
+   if ( iPos + iLiterals > iMaxOutputSize )
+      return -1;
+   memcpy(pOutput + iPos, pLiterals, iLiterals);
+   iPos += iLiterals;
+
+   if ( iMatchLength > 0 )
+   {
+      int iMatchCode = iMatchLength - FILE_TRANSFER_MIN_MATCH;
+      uToken |= (iMatchCode >= 15)?0x0F:(u8)iMatchCode;
+      if ( iPos + 2 > iMaxOutputSize )
+         return -1;
+      pOutput[iPos++] = (u8)(iOffset & 0xFF);
+      pOutput[iPos++] = (u8)((iOffset >> 8) & 0xFF);
+      if ( iMatchCode >= 15 )
+      {
+         iPos = _file_transfer_write_length(iMatchCode - 15, pOutput, iPos, iMaxOutputSize);
+         if ( iPos < 0 )
+            return -1;
+      }
+   }
+   pOutput[iTokenPos] = uToken;
+   return iPos;
+}
+
+// Sequences: token (high nibble: literals count, low nibble: match length - 4), literals count extension,
+// literals, match offset (2 bytes, little endian), match length extension. The last sequence has only literals.
+
+int file_transfer_compress(u8* pData, int iSize, u8* pOutput, int iMaxOutputSize)
+{
+   if ( (NULL == pData) || (NULL == pOutput) || (iSize <= 0) || (iSize > 0xFFFF) )
+      return -1;
+
+   // Must get smaller than the input
+   if ( iMaxOutputSize > iSize - 1 )
+      iMaxOutputSize = iSize - 1;
+
+   u16 uTable[1<<FILE_TRANSFER_HASH_BITS];
+   memset(uTable, 0, sizeof(uTable));
+
+   int iPos = 0;
+   int iAnchor = 0;
+   int iOut = 0;
+
+   while ( iPos + FILE_TRANSFER_MIN_MATCH <= iSize )
+   {
+      u32 uHash = _file_transfer_hash(pData + iPos);
+      int iRef = ((int)uTable[uHash]) - 1;
+      uTable[uHash] = (u16)(iPos+1);
+
+      if ( (iRef < 0) || (iPos - iRef > FILE_TRANSFER_MAX_OFFSET) || (0 != memcmp(pData + iRef, pData + iPos, FILE_TRANSFER_MIN_MATCH)) )
+      {
+         iPos++;
+         continue;
+      }
+
+      int iLength = FILE_TRANSFER_MIN_MATCH;
+      while ( (iPos + iLength < iSize) && (pData[iRef + iLength] == pData[iPos + iLength]) )
+         iLength++;
+
+      iOut = _file_transfer_write_sequence(pData + iAnchor, iPos - iAnchor, iPos - iRef, iLength, pOutput, iOut, iMaxOutputSize);
+      if ( iOut < 0 )
+         return -1;
+      iPos += iLength;
+      iAnchor = iPos;
+   }
+
+   if ( iAnchor < iSize )
+   {
+      iOut = _file_transfer_write_sequence(pData + iAnchor, iSize - iAnchor, 0, 0, pOutput, iOut, iMaxOutputSize);
+      if ( iOut < 0 )
+         return -1;
+   }
+   return iOut;
+}
+
+int file_transfer_decompress(u8* pData, int iSize, u8* pOutput, int iMaxOutputSize)
+{
+   if ( (NULL == pData) || (NULL == pOutput) || (iSize <= 0) )
+      return -1;
+
+   int iPos = 0;
+   int iOut = 0;
+   while ( iPos < iSize )
+   {
+      u8 uToken = pData[iPos++];
+      int iLiterals = uToken >> 4;
+      if ( 15 == iLiterals )
+      {
+         u8 uByte = 255;
+         while ( 255 == uByte )
+         {
+            if ( iPos >= iSize )
+               return -1;
+            uByte = pData[iPos++];
+            iLiterals += uByte;
+         }
+      }
+      if ( (iPos + iLiterals > iSize) || (iOut + iLiterals > iMaxOutputSize) )
+         return -1;
+      memcpy(pOutput + iOut, pData + iPos, iLiterals);
+      iPos += iLiterals;
+      iOut += iLiterals;
+
+      // Last sequence has only literals
+      if ( iPos >= iSize )
+         break;
+
+      if ( iPos + 2 > iSize )
+         return -1;
+      int iOffset = ((int)pData[iPos]) | (((int)pData[iPos+1]) << 8);
+      iPos += 2;
+      if ( (0 == iOffset) || (iOffset > iOut) )
+         return -1;
+
+      int iLength = (uToken & 0x0F) + FILE_TRANSFER_MIN_MATCH;
+      if ( (uToken & 0x0F) == 15 )
+      {
+         u8 uByte = 255;
+         while ( 255 == uByte )
+         {
+            if ( iPos >= iSize )
+               return -1;
+            uByte = pData[iPos++];
+            iLength += uByte;
+         }
+      }
+      if ( iOut + iLength > iMaxOutputSize )
+         return -1;
+
+      // Byte by byte copy: the match can overlap the output (repeated patterns)
+      u8* pSrc = pOutput + iOut - iOffset;
+      for( int i=0; i<iLength; i++ )
+         pOutput[iOut+i] = pSrc[i];
+      iOut += iLength;
+   }
+   return iOut;
+}
+
+void file_transfer_bitmap_set(u32* pBitmap, int iIndex)
+{
+   if ( (NULL == pBitmap) || (iIndex < 0) || (iIndex >= FILE_TRANSFER_WINDOW_SEGMENTS) )
+      return;
+   pBitmap[iIndex/32] |= ((u32)1) << (iIndex % 32);
+}
+
+void file_transfer_bitmap_clear(u32* pBitmap, int iIndex)
+{
+   if ( (NULL == pBitmap) || (iIndex < 0) || (iIndex >= FILE_TRANSFER_WINDOW_SEGMENTS) )
+      return;
+   pBitmap[iIndex/32] &= ~(((u32)1) << (iIndex % 32));
+}
+
+bool file_transfer_bitmap_get(u32* pBitmap, int iIndex)
+{
+   if ( (NULL == pBitmap) || (iIndex < 0) || (iIndex >= FILE_TRANSFER_WINDOW_SEGMENTS) )
+      return false;
+   return (pBitmap[iIndex/32] & (((u32)1) << (iIndex % 32)))?true:false;
+}
+
+int file_transfer_get_window_segments(u32 uWindowStart, u32 uSegmentsCount)
+{
+   if ( uWindowStart >= uSegmentsCount )
+      return 0;
+   u32 uCount = uSegmentsCount - uWindowStart;
+   if ( uCount > FILE_TRANSFER_WINDOW_SEGMENTS )
+      uCount = FILE_TRANSFER_WINDOW_SEGMENTS;
+   return (int)uCount;
+}
+
+bool file_transfer_bitmap_is_complete(u32* pBitmap, u32 uWindowStart, u32 uSegmentsCount)
+{
+   int iCount = file_transfer_get_window_segments(uWindowStart, uSegmentsCount);
+   for( int i=0; i<iCount; i++ )
+   {
+      if ( ! file_transfer_bitmap_get(pBitmap, i) )
+         return false;
+   }
+   return true;
+}
+
+void file_transfer_pacing_init(t_file_transfer_pacing* pPacing, u32 uMaxBytesPerSec, u32 uTimeNow)
+{
+   if ( NULL == pPacing )
+      return;
+   pPacing->uMaxBytesPerSec = uMaxBytesPerSec;
+   pPacing->uTimeLastUpdate = uTimeNow;
+   pPacing->iBudgetBytes = 0;
+}
+
+bool file_transfer_pacing_consume(t_file_transfer_pacing* pPacing, int iBytes, u32 uTimeNow)
+{
+   if ( NULL == pPacing )
+      return false;
+   if ( 0 == pPacing->uMaxBytesPerSec )
+      return true;
+
+   // Burst is limited to 50 ms worth of data, but it must fit at least a full packet
+   int iMaxBudget = (int)(pPacing->uMaxBytesPerSec/20);
+   if ( iMaxBudget < FILE_TRANSFER_SEGMENT_SIZE + 200 )
+      iMaxBudget = FILE_TRANSFER_SEGMENT_SIZE + 200;
+
+   u32 uElapsed = uTimeNow - pPacing->uTimeLastUpdate;
+   if ( uElapsed > 1000 )
+      uElapsed = 1000;
+   int iAdd = (int)(((unsigned long long)uElapsed * (unsigned long long)pPacing->uMaxBytesPerSec) / 1000);
+   if ( iAdd > 0 )
+   {
+      pPacing->uTimeLastUpdate = uTimeNow;
+      pPacing->iBudgetBytes += iAdd;
+      if ( pPacing->iBudgetBytes > iMaxBudget )
+         pPacing->iBudgetBytes = iMaxBudget;
+   }
+
+   if ( pPacing->iBudgetBytes < iBytes )
+      return false;
+   pPacing->iBudgetBytes -= iBytes;
+   return true;
+}
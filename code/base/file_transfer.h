@@ -0,0 +1,40 @@
+#pragma once
+#include "base.h"
+
+// Bulk file transfer between vehicle and controller (vehicle logs download, core plugins upload).
+// Files are sent in fixed size segments, a window of segments at a time. The receiver acknowledges the window
+// with a bitmap of the segments it has (selective ACK), the sender sends again only the missing ones.
+// Each segment is LZ compressed (literals and back references, LZ4 like block format) and sent compressed
+// only if it gets smaller (archives are sent as they are).
+// The sender paces the segments with a token bucket, so the transfer does not take the bandwidth of the video link.
+
+#define FILE_TRANSFER_SEGMENT_SIZE 1024
+#define FILE_TRANSFER_WINDOW_SEGMENTS 64
+#define FILE_TRANSFER_WINDOW_BITMAP_WORDS (FILE_TRANSFER_WINDOW_SEGMENTS/32)
+#define FILE_TRANSFER_MAX_FILE_SIZE (FILE_TRANSFER_SEGMENT_SIZE*5000)
+
+#define FILE_TRANSFER_SEGMENT_FLAG_COMPRESSED 0x01
+
+typedef struct
+{
+   u32 uMaxBytesPerSec; // 0: no limit
+   u32 uTimeLastUpdate;
+   int iBudgetBytes;
+} t_file_transfer_pacing;
+
+// Returns the compressed size, or -1 if the data does not get smaller (or is larger than 64K)
+int file_transfer_compress(u8* pData, int iSize, u8* pOutput, int iMaxOutputSize);
+// Returns the decompressed size, or -1 if the input is invalid or the output buffer is too small
+int file_transfer_decompress(u8* pData, int iSize, u8* pOutput, int iMaxOutputSize);
+
+void file_transfer_bitmap_set(u32* pBitmap, int iIndex);
+void file_transfer_bitmap_clear(u32* pBitmap, int iIndex);
+bool file_transfer_bitmap_get(u32* pBitmap, int iIndex);
+// Count of segments in the window that starts at uWindowStart, for a file of uSegmentsCount segments
+int file_transfer_get_window_segments(u32 uWindowStart, u32 uSegmentsCount);
+// True if all the segments of the window are set in the bitmap
+bool file_transfer_bitmap_is_complete(u32* pBitmap, u32 uWindowStart, u32 uSegmentsCount);
+
+void file_transfer_pacing_init(t_file_transfer_pacing* pPacing, u32 uMaxBytesPerSec, u32 uTimeNow);
+// Returns true and takes the bytes from the budget if a packet of iBytes can be sent now
+bool file_transfer_pacing_consume(t_file_transfer_pacing* pPacing, int iBytes, u32 uTimeNow);
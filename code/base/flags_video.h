@@ -45,6 +45,18 @@
 #define VIDEO_STATUS_FLAGS2_HAS_DEBUG_TIMESTAMPS ((u32)(((u32)0x01)<<8))
 #define VIDEO_STATUS_FLAGS2_IS_IFRAME ((u32)(((u32)0x01)<<9))
 #define VIDEO_STATUS_FLAGS2_IS_ON_LOWER_BITRATE ((u32)(((u32)0x01)<<10))
+#define VIDEO_STATUS_FLAGS2_IS_NAL_ALIGNED ((u32)(((u32)0x01)<<11))
+#define VIDEO_STATUS_FLAGS2_IS_FRAME_START ((u32)(((u32)0x01)<<12))
+#define VIDEO_STATUS_FLAGS2_IS_FRAME_END ((u32)(((u32)0x01)<<13))
+#define VIDEO_STATUS_FLAGS2_MASK_FRAME_PRIORITY ((u32)(((u32)0x03)<<14))
+#define VIDEO_STATUS_FLAGS2_SHIFT_FRAME_PRIORITY 14
+#define VIDEO_STATUS_FLAGS2_MASK_PAYLOAD_LENGTH ((u32)0xFFFF0000)
+#define VIDEO_STATUS_FLAGS2_SHIFT_PAYLOAD_LENGTH 16
+
+// Frame priority classes of video packets (in VIDEO_STATUS_FLAGS2_MASK_FRAME_PRIORITY)
+#define VIDEO_FRAME_PRIORITY_NONREF 0
+#define VIDEO_FRAME_PRIORITY_REF 1
+#define VIDEO_FRAME_PRIORITY_IFRAME 2
 
 
 // Highest bit in video bitrate field tells if vehicle adjusted the videobitrate
@@ -58,3 +70,5 @@
 #define VIDEO_FLAG_RETRANSMISSIONS_FAST      ((u32)(((u32)0x01)<<3))
 #define VIDEO_FLAG_GENERATE_H265             ((u32)(((u32)0x01)<<4))
 #define VIDEO_FLAG_NEW_ADAPTIVE_ALGORITHM    ((u32)(((u32)0x01)<<5))
+#define VIDEO_FLAG_NAL_ALIGNED_PACKETS       ((u32)(((u32)0x01)<<6))
+#define VIDEO_FLAG_FRAME_PRIORITY_CLASSES    ((u32)(((u32)0x01)<<7))
@@ -818,6 +818,9 @@ radio_hw_info_t* hardware_radio_sik_try_detect_on_port(const char* szSerialPort)
    {
       if ( hardware_get_serial_baud_rates()[i] < 57000 )
          break;
+      // SiK radios serial speed goes up to 115200 bps
+      if ( hardware_get_serial_baud_rates()[i] > 115200 )
+         continue;
       iBaudRatesList[iBaudRatesCount] = hardware_get_serial_baud_rates()[i];
       iBaudRatesCount++;
    }
@@ -45,7 +45,7 @@
 #include "hw_procs.h"
 #include "../common/string_utils.h"
 
-int s_OptionsSerialBaudRatesC[] = { 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200 };
+int s_OptionsSerialBaudRatesC[] = { 1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600 };
 
 int s_iHardwareSerialPortsWasInitialized = 0;
 
@@ -428,6 +428,9 @@ int hardware_configure_serial(const char* szDevName, long baudRate)
       case 38400: cfsetospeed(&options, B38400); break;
       case 57600: cfsetospeed(&options, B57600); break;
       case 115200: cfsetospeed(&options, B115200); break;
+      case 230400: cfsetospeed(&options, B230400); break;
+      case 460800: cfsetospeed(&options, B460800); break;
+      case 921600: cfsetospeed(&options, B921600); break;
       default:    cfsetospeed(&options, B57600); break;
    }
 
@@ -498,6 +501,9 @@ int hardware_open_serial_port(const char* szDevName, long baudRate)
       case 38400: cfsetospeed(&options, B38400); break;
       case 57600: cfsetospeed(&options, B57600); break;
       case 115200: cfsetospeed(&options, B115200); break;
+      case 230400: cfsetospeed(&options, B230400); break;
+      case 460800: cfsetospeed(&options, B460800); break;
+      case 921600: cfsetospeed(&options, B921600); break;
       default:    cfsetospeed(&options, B57600); iUsedDefaultRate = 1; break;
    }
 
@@ -0,0 +1,381 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "mavlink_router.h"
+#include "../../mavlink/common/mavlink.h"
+
+typedef struct
+{
+   u32 uIntervalMs;
+   u32 uFlags;
+} type_mavlink_router_rule;
+
+typedef struct
+{
+   bool bUsed;
+   u32 uMsgId;
+   u8 uSysId;
+   u8 uCompId;
+   u32 uTimeLastSent;
+   int iPendingLength;
+   u8 uPendingFrame[MAVLINK_ROUTER_MAX_FRAME_LENGTH];
+} type_mavlink_router_slot;
+
+static mavlink_router_output_callback s_pMAVLinkRouterOutputCallback = NULL;
+static bool s_bMAVLinkRouterShaping = true;
+static type_mavlink_router_rule s_MAVLinkRouterRules[MAVLINK_ROUTER_MAX_MSG_ID];
+static type_mavlink_router_slot s_MAVLinkRouterSlots[MAVLINK_ROUTER_MAX_SLOTS];
+static type_mavlink_router_stats s_MAVLinkRouterStats;
+static u32 s_uMAVLinkRouterTimeNow = 0;
+
+// Holds the start of a frame split across reads, until the frame is complete
+static u8 s_uMAVLinkRouterPartialBuffer[MAVLINK_ROUTER_MAX_FRAME_LENGTH];
+static int s_iMAVLinkRouterPartialLength = 0;
+
+void mavlink_router_init(mavlink_router_output_callback pCallback)
+{
+   s_pMAVLinkRouterOutputCallback = pCallback;
+   mavlink_router_set_default_rates();
+   mavlink_router_reset();
+   log_line("[MAVLinkRouter] Init done.");
+}
+
+void mavlink_router_reset()
+{
+   memset(s_MAVLinkRouterSlots, 0, sizeof(s_MAVLinkRouterSlots));
+   memset(&s_MAVLinkRouterStats, 0, sizeof(s_MAVLinkRouterStats));
+   s_iMAVLinkRouterPartialLength = 0;
+}
+
+void mavlink_router_set_default_rates()
+{
+   memset(s_MAVLinkRouterRules, 0, sizeof(s_MAVLinkRouterRules));
+
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_ATTITUDE, 100, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_GLOBAL_POSITION_INT, 200, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_GPS_RAW_INT, 200, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_VFR_HUD, 200, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_LOCAL_POSITION_NED, 200, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_SYS_STATUS, 500, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_RC_CHANNELS, 500, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_RC_CHANNELS_RAW, 500, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_SERVO_OUTPUT_RAW, 500, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT, 500, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_BATTERY_STATUS, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_RAW_IMU, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_SCALED_IMU, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_SCALED_IMU2, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_SCALED_PRESSURE, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_SCALED_PRESSURE2, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_VIBRATION, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_TERRAIN_REPORT, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_WIND_COV, 1000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_SYSTEM_TIME, 2000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+   mavlink_router_set_msg_rate(MAVLINK_MSG_ID_POWER_STATUS, 2000, MAVLINK_ROUTER_FLAG_LATEST_ONLY);
+}
+
+void mavlink_router_set_msg_rate(u32 uMsgId, u32 uIntervalMs, u32 uFlags)
+{
+   if ( uMsgId >= MAVLINK_ROUTER_MAX_MSG_ID )
+   {
+      log_softerror_and_alarm("[MAVLinkRouter] Can't set rate for msg id %u, max supported msg id is %d.", uMsgId, MAVLINK_ROUTER_MAX_MSG_ID-1);
+      return;
+   }
+   s_MAVLinkRouterRules[uMsgId].uIntervalMs = uIntervalMs;
+   s_MAVLinkRouterRules[uMsgId].uFlags = uFlags;
+}
+
+bool mavlink_router_load_config(const char* szFile)
+{
+   if ( (NULL == szFile) || (0 == szFile[0]) )
+      return false;
+   FILE* fd = fopen(szFile, "r");
+   if ( NULL == fd )
+      return false;
+
+   int iCount = 0;
+   char szLine[256];
+   while ( NULL != fgets(szLine, sizeof(szLine), fd) )
+   {
+      if ( (szLine[0] == '#') || (szLine[0] == 10) || (szLine[0] == 13) )
+         continue;
+      u32 uMsgId = 0, uIntervalMs = 0, uFlags = 0;
+      if ( 3 != sscanf(szLine, "%u %u %u", &uMsgId, &uIntervalMs, &uFlags) )
+      {
+         log_softerror_and_alarm("[MAVLinkRouter] Invalid line in config file %s: %s", szFile, szLine);
+         continue;
+      }
+      mavlink_router_set_msg_rate(uMsgId, uIntervalMs, uFlags);
+      iCount++;
+   }
+   fclose(fd);
+   log_line("[MAVLinkRouter] Loaded %d rate rules from %s", iCount, szFile);
+   return true;
+}
+
+static void _mavlink_router_output(u8* pFrame, int iLength)
+{
+   s_MAVLinkRouterStats.uFramesForwarded++;
+   s_MAVLinkRouterStats.uBytesForwarded += iLength;
+   if ( NULL != s_pMAVLinkRouterOutputCallback )
+      s_pMAVLinkRouterOutputCallback(pFrame, iLength);
+}
+
+// Returns the full frame length, 0 if more bytes are needed to know it
+static int _mavlink_router_get_frame_length(u8* pData, int iLength)
+{
+   if ( pData[0] == MAVLINK_STX_MAVLINK1 )
+   {
+      if ( iLength < 2 )
+         return 0;
+      return MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1 + pData[1] + MAVLINK_NUM_CHECKSUM_BYTES;
+   }
+   if ( iLength < 3 )
+      return 0;
+   int iFrameLength = MAVLINK_CORE_HEADER_LEN + 1 + pData[1] + MAVLINK_NUM_CHECKSUM_BYTES;
+   if ( pData[2] & MAVLINK_IFLAG_SIGNED )
+      iFrameLength += MAVLINK_SIGNATURE_BLOCK_LEN;
+   return iFrameLength;
+}
+
+static bool _mavlink_router_check_frame_crc(u8* pFrame, u32 uMsgId)
+{
+   const mavlink_msg_entry_t* pEntry = mavlink_get_msg_entry(uMsgId);
+   // Not in this dialect, can't check it
+   if ( NULL == pEntry )
+      return true;
+
+   int iHeaderLength = (pFrame[0] == MAVLINK_STX_MAVLINK1)?(MAVLINK_CORE_HEADER_MAVLINK1_LEN + 1):(MAVLINK_CORE_HEADER_LEN + 1);
+   int iPayloadLength = pFrame[1];
+   u16 uCRC = crc_calculate(pFrame + 1, iHeaderLength - 1 + iPayloadLength);
+   crc_accumulate(pEntry->crc_extra, &uCRC);
+   return (pFrame[iHeaderLength + iPayloadLength] == (uCRC & 0xFF)) && (pFrame[iHeaderLength + iPayloadLength + 1] == (uCRC >> 8));
+}
+
+static type_mavlink_router_slot* _mavlink_router_get_slot(u32 uMsgId, u8 uSysId, u8 uCompId)
+{
+   type_mavlink_router_slot* pFreeSlot = NULL;
+   for( int i=0; i<MAVLINK_ROUTER_MAX_SLOTS; i++ )
+   {
+      if ( ! s_MAVLinkRouterSlots[i].bUsed )
+      {
+         if ( NULL == pFreeSlot )
+            pFreeSlot = &(s_MAVLinkRouterSlots[i]);
+         continue;
+      }
+      if ( (s_MAVLinkRouterSlots[i].uMsgId == uMsgId) && (s_MAVLinkRouterSlots[i].uSysId == uSysId) && (s_MAVLinkRouterSlots[i].uCompId == uCompId) )
+         return &(s_MAVLinkRouterSlots[i]);
+   }
+   if ( NULL != pFreeSlot )
+   {
+      pFreeSlot->bUsed = true;
+      pFreeSlot->uMsgId = uMsgId;
+      pFreeSlot->uSysId = uSysId;
+      pFreeSlot->uCompId = uCompId;
+      pFreeSlot->uTimeLastSent = 0;
+      pFreeSlot->iPendingLength = 0;
+   }
+   return pFreeSlot;
+}
+
+static void _mavlink_router_on_frame(u8* pFrame, int iLength, u32 uMsgId)
+{
+   s_MAVLinkRouterStats.uFramesIn++;
+
+   if ( (! s_bMAVLinkRouterShaping) || (uMsgId >= MAVLINK_ROUTER_MAX_MSG_ID) || (0 == s_MAVLinkRouterRules[uMsgId].uIntervalMs) )
+   {
+      _mavlink_router_output(pFrame, iLength);
+      return;
+   }
+
+   u8 uSysId = (pFrame[0] == MAVLINK_STX_MAVLINK1)?pFrame[3]:pFrame[5];
+   u8 uCompId = (pFrame[0] == MAVLINK_STX_MAVLINK1)?pFrame[4]:pFrame[6];
+   type_mavlink_router_slot* pSlot = _mavlink_router_get_slot(uMsgId, uSysId, uCompId);
+
+   // Too many sources, don't shape this one
+   if ( NULL == pSlot )
+   {
+      _mavlink_router_output(pFrame, iLength);
+      return;
+   }
+
+   if ( s_uMAVLinkRouterTimeNow >= pSlot->uTimeLastSent + s_MAVLinkRouterRules[uMsgId].uIntervalMs )
+   {
+      if ( pSlot->iPendingLength > 0 )
+         s_MAVLinkRouterStats.uFramesDropped++;
+      pSlot->iPendingLength = 0;
+      pSlot->uTimeLastSent = s_uMAVLinkRouterTimeNow;
+      _mavlink_router_output(pFrame, iLength);
+      return;
+   }
+
+   if ( ! (s_MAVLinkRouterRules[uMsgId].uFlags & MAVLINK_ROUTER_FLAG_LATEST_ONLY) )
+   {
+      s_MAVLinkRouterStats.uFramesDropped++;
+      return;
+   }
+   if ( pSlot->iPendingLength > 0 )
+      s_MAVLinkRouterStats.uFramesDropped++;
+   memcpy(pSlot->uPendingFrame, pFrame, iLength);
+   pSlot->iPendingLength = iLength;
+}
+
+// Processes all the complete frames in the buffer, in place.
+// Returns the number of bytes used; the rest is the start of an incomplete frame.
+static int _mavlink_router_parse_frames(u8* pData, int iLength)
+{
+   int iPos = 0;
+   while ( iPos < iLength )
+   {
+      if ( (pData[iPos] != MAVLINK_STX_MAVLINK1) && (pData[iPos] != MAVLINK_STX) )
+      {
+         s_MAVLinkRouterStats.uBytesSkipped++;
+         iPos++;
+         continue;
+      }
+
+      int iFrameLength = _mavlink_router_get_frame_length(pData + iPos, iLength - iPos);
+      if ( (0 == iFrameLength) || (iPos + iFrameLength > iLength) )
+         break;
+
+      u8* pFrame = pData + iPos;
+      u32 uMsgId = pFrame[5];
+      if ( pFrame[0] == MAVLINK_STX )
+         uMsgId = ((u32)pFrame[7]) | (((u32)pFrame[8]) << 8) | (((u32)pFrame[9]) << 16);
+
+      // Not a frame start (or a corrupted frame), resync on the next start marker
+      if ( ! _mavlink_router_check_frame_crc(pFrame, uMsgId) )
+      {
+         s_MAVLinkRouterStats.uFramesInvalid++;
+         s_MAVLinkRouterStats.uBytesSkipped++;
+         iPos++;
+         continue;
+      }
+
+      _mavlink_router_on_frame(pFrame, iFrameLength, uMsgId);
+      iPos += iFrameLength;
+   }
+   return iPos;
+}
+
+void mavlink_router_add_data(u8* pData, int iLength, u32 uTimeNow)
+{
+   if ( (NULL == pData) || (iLength <= 0) )
+      return;
+
+   s_uMAVLinkRouterTimeNow = uTimeNow;
+   s_MAVLinkRouterStats.uBytesIn += iLength;
+
+   // Finish the frame started in the previous reads first. Only the bytes
+   // that complete it are copied, the rest of the input is parsed in place.
+   while ( (s_iMAVLinkRouterPartialLength > 0) && (iLength > 0) )
+   {
+      int iFrameLength = _mavlink_router_get_frame_length(s_uMAVLinkRouterPartialBuffer, s_iMAVLinkRouterPartialLength);
+      int iCopy = 3 - s_iMAVLinkRouterPartialLength;
+      if ( 0 != iFrameLength )
+         iCopy = iFrameLength - s_iMAVLinkRouterPartialLength;
+      if ( iCopy > iLength )
+         iCopy = iLength;
+      memcpy(&(s_uMAVLinkRouterPartialBuffer[s_iMAVLinkRouterPartialLength]), pData, iCopy);
+      s_iMAVLinkRouterPartialLength += iCopy;
+      pData += iCopy;
+      iLength -= iCopy;
+
+      if ( 0 == iFrameLength )
+         continue;
+      if ( s_iMAVLinkRouterPartialLength < iFrameLength )
+         return;
+
+      // On a bad frame the parser resyncs inside the buffer; what is left is
+      // the start of the next frame and is completed on the next iteration
+      int iUsed = _mavlink_router_parse_frames(s_uMAVLinkRouterPartialBuffer, s_iMAVLinkRouterPartialLength);
+      if ( (iUsed > 0) && (iUsed < s_iMAVLinkRouterPartialLength) )
+         memmove(s_uMAVLinkRouterPartialBuffer, &(s_uMAVLinkRouterPartialBuffer[iUsed]), s_iMAVLinkRouterPartialLength - iUsed);
+      s_iMAVLinkRouterPartialLength -= iUsed;
+   }
+
+   if ( iLength <= 0 )
+      return;
+
+   int iUsed = _mavlink_router_parse_frames(pData, iLength);
+   if ( iUsed < iLength )
+   {
+      memcpy(s_uMAVLinkRouterPartialBuffer, pData + iUsed, iLength - iUsed);
+      s_iMAVLinkRouterPartialLength = iLength - iUsed;
+   }
+}
+
+static void _mavlink_router_send_pending(u32 uTimeNow, bool bForce)
+{
+   for( int i=0; i<MAVLINK_ROUTER_MAX_SLOTS; i++ )
+   {
+      type_mavlink_router_slot* pSlot = &(s_MAVLinkRouterSlots[i]);
+      if ( (! pSlot->bUsed) || (0 == pSlot->iPendingLength) )
+         continue;
+      if ( (! bForce) && (uTimeNow < pSlot->uTimeLastSent + s_MAVLinkRouterRules[pSlot->uMsgId].uIntervalMs) )
+         continue;
+      pSlot->uTimeLastSent = uTimeNow;
+      int iLength = pSlot->iPendingLength;
+      pSlot->iPendingLength = 0;
+      _mavlink_router_output(pSlot->uPendingFrame, iLength);
+   }
+}
+
+void mavlink_router_periodic_loop(u32 uTimeNow)
+{
+   s_uMAVLinkRouterTimeNow = uTimeNow;
+   _mavlink_router_send_pending(uTimeNow, false);
+}
+
+void mavlink_router_set_shaping(bool bEnable)
+{
+   if ( bEnable == s_bMAVLinkRouterShaping )
+      return;
+   s_bMAVLinkRouterShaping = bEnable;
+   log_line("[MAVLinkRouter] Downlink shaping is %s.", bEnable?"enabled":"disabled");
+
+   // Flush the pending frames
+   if ( ! bEnable )
+      _mavlink_router_send_pending(s_uMAVLinkRouterTimeNow, true);
+}
+
+bool mavlink_router_is_shaping_enabled()
+{
+   return s_bMAVLinkRouterShaping;
+}
+
+type_mavlink_router_stats* mavlink_router_get_stats()
+{
+   return &s_MAVLinkRouterStats;
+}
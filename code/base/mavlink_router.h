@@ -0,0 +1,47 @@
+#pragma once
+#include "base.h"
+
+// Routes the MAVLink data received from the flight controller to the controller.
+// Frames (v1 and v2) are found in place in the serial data and passed to the output callback
+// as pointers into the input buffer; only frames split across serial reads are copied.
+// Frames with a known message id and a bad CRC are dropped; unknown message ids are forwarded as they are.
+// Downlink shaping: rate limited message ids are forwarded at most once per interval (per source system/component).
+// For latest-only message ids the newest frame received inside the interval is kept and sent when the interval elapses,
+// so the controller always gets the latest value. All other messages (params, missions, commands, status texts,
+// heartbeats) are forwarded right away.
+
+#define MAVLINK_ROUTER_MAX_MSG_ID 512
+#define MAVLINK_ROUTER_MAX_FRAME_LENGTH 280
+#define MAVLINK_ROUTER_MAX_SLOTS 48
+
+#define MAVLINK_ROUTER_FLAG_LATEST_ONLY 0x01
+
+typedef void (*mavlink_router_output_callback)(u8* pFrame, int iLength);
+
+typedef struct
+{
+   u32 uFramesIn;
+   u32 uFramesForwarded;
+   u32 uFramesDropped; // Dropped by shaping (older values replaced by newer ones)
+   u32 uFramesInvalid; // Bad CRC
+   u32 uBytesIn;
+   u32 uBytesForwarded;
+   u32 uBytesSkipped; // Bytes outside of valid frames
+} type_mavlink_router_stats;
+
+void mavlink_router_init(mavlink_router_output_callback pCallback);
+void mavlink_router_reset();
+void mavlink_router_set_shaping(bool bEnable);
+bool mavlink_router_is_shaping_enabled();
+
+void mavlink_router_set_default_rates();
+// Interval 0 removes the rate limit for that message id
+void mavlink_router_set_msg_rate(u32 uMsgId, u32 uIntervalMs, u32 uFlags);
+// Optional config file, one rule per line: msgid interval_ms flags. Lines starting with # are comments.
+bool mavlink_router_load_config(const char* szFile);
+
+void mavlink_router_add_data(u8* pData, int iLength, u32 uTimeNow);
+// Sends the pending latest-only frames whose interval elapsed
+void mavlink_router_periodic_loop(u32 uTimeNow);
+
+type_mavlink_router_stats* mavlink_router_get_stats();
@@ -251,6 +251,13 @@ bool Model::reloadIfChanged(bool bLoadStats)
 }
 
 bool Model::loadFromFile(const char* filename, bool bLoadStats)
+{
+   u32 uParseTimeMs = 0;
+   int iResult = parseFile(filename, bLoadStats, &uParseTimeMs);
+   return completeLoadFromFile(filename, bLoadStats, iResult, uParseTimeMs);
+}
+
+int Model::parseFile(const char* filename, bool bLoadStats, u32* puParseTimeMs)
 {
    char szFileNormal[MAX_FILE_PATH_SIZE];
    char szFileBackup[MAX_FILE_PATH_SIZE];
@@ -271,7 +278,17 @@ bool Model::loadFromFile(const char* filename, bool bLoadStats)
 
    int iVersionMain = 0;
    int iVersionBackup = 0;
-   FILE* fd = fopen(szFileNormal, "r");
+   int iResult = MODEL_PARSE_FAILED;
+   FILE* fd = NULL;
+   bool bLoadedFromSnapshot = loadBinarySnapshot(szFileNormal, &iVersionMain);
+   if ( bLoadedFromSnapshot )
+   {
+      bMainFileLoadedOk = true;
+      iLoadedFileVersion = iVersionMain;
+      iResult = MODEL_PARSE_FROM_SNAPSHOT;
+   }
+   else
+      fd = fopen(szFileNormal, "r");
    if ( NULL != fd )
    {
       if ( 1 != fscanf(fd, "%*s %d", &iVersionMain) )
@@ -291,88 +308,83 @@ bool Model::loadFromFile(const char* filename, bool bLoadStats)
          if ( bMainFileLoadedOk )
          {
             iLoadedFileVersion = iVersionMain;
+            iResult = MODEL_PARSE_FROM_TEXT;
          }
          else
             log_softerror_and_alarm("Invalid vehicle configuration file: %s",szFileNormal);
       }
       fclose(fd);
+      if ( bMainFileLoadedOk )
+         saveBinarySnapshot(szFileNormal, iVersionMain);
+   }
+
+   if ( ! bMainFileLoadedOk )
+   {
+      fd = fopen(szFileBackup, "r");
+      if ( NULL != fd )
+      {
+         if ( 1 != fscanf(fd, "%*s %d", &iVersionBackup) )
+         {
+            log_softerror_and_alarm("Load model: Error on version line. Invalid vehicle configuration file: %s", szFileBackup);
+            bBackupFileLoadedOk = false;
+         }
+         else
+         {
+            //log_line("Found model file version: %d.", iVersion);
+            if ( 8 == iVersionBackup )
+               bBackupFileLoadedOk = loadVersion8(fd);
+            if ( 9 == iVersionBackup )
+               bBackupFileLoadedOk = loadVersion9(fd);
+            if ( 10 == iVersionBackup )
+               bBackupFileLoadedOk = loadVersion10(fd);
+            if ( bBackupFileLoadedOk )
+            {
+               iLoadedFileVersion = iVersionBackup;
+               iResult = MODEL_PARSE_FROM_BACKUP;
+            }
+            else
+               log_softerror_and_alarm("Invalid vehicle configuration file: %s",szFileBackup);
+         }
+         fclose(fd);
+      }
    }
-   else
-      bMainFileLoadedOk = false;
 
-   if ( bMainFileLoadedOk )
+   if ( ! bLoadStats ) 
+      memcpy((u8*)&m_Stats, (u8*)&stats, sizeof(type_vehicle_stats_info));
+
+   if ( NULL != puParseTimeMs )
+      *puParseTimeMs = get_current_timestamp_ms() - timeStart;
+   return iResult;
+}
+
+bool Model::completeLoadFromFile(const char* filename, bool bLoadStats, int iParseResult, u32 uParseTimeMs)
+{
+   if ( (MODEL_PARSE_FROM_SNAPSHOT == iParseResult) || (MODEL_PARSE_FROM_TEXT == iParseResult) )
    {
-      if ( ! bLoadStats ) 
-         memcpy((u8*)&m_Stats, (u8*)&stats, sizeof(type_vehicle_stats_info));
       validate_settings();
 
-      timeStart = get_current_timestamp_ms() - timeStart;
-      char szFreq1[64];
-      char szFreq2[64];
-      char szFreq3[64];
-      strcpy(szFreq1, str_format_frequency(radioLinksParams.link_frequency_khz[0]));
-      strcpy(szFreq2, str_format_frequency(radioLinksParams.link_frequency_khz[1]));
-      strcpy(szFreq3, str_format_frequency(radioLinksParams.link_frequency_khz[2]));
-      //log_line("Loaded vehicle successfully (%u ms) from file: %s; version %d, save count: %d, vehicle name: [%s], vehicle id: %u, software: %d.%d (b%d), is in control mode: %s, is in developer mode: %s, %d radio links, 1st link: %s, 2nd link: %s, 3rd link: %s",
-      // timeStart, filename, iLoadedFileVersion, iSaveCount, vehicle_name, uVehicleId, (sw_version >> 8) & 0xFF, sw_version & 0xFF, sw_version>>16, is_spectator?"no (is spectator)":"yes", (bDeveloperMode?"yes":"no"), radioLinksParams.links_count, szFreq1, szFreq2, szFreq3);
-
-      log_line("Loaded vehicle (%s) successfully from file: %s; name: [%s], VID: %u, software: %d.%d (b%d), on time: %02d:%02d",
-         bLoadStats?"with stats":"without stats",
+      log_line("Loaded vehicle (%s) successfully (%u ms, %s) from file: %s; name: [%s], VID: %u, software: %d.%d (b%d), on time: %02d:%02d",
+         bLoadStats?"with stats":"without stats", uParseTimeMs, (MODEL_PARSE_FROM_SNAPSHOT == iParseResult)?"binary snapshot":"text",
          filename, vehicle_name, uVehicleId, (sw_version >> 8) & 0xFF, sw_version & 0xFF, sw_version>>16,
          m_Stats.uCurrentOnTime/60, m_Stats.uCurrentOnTime%60);
       constructLongName();
       return true;
    }
 
-
-   fd = fopen(szFileBackup, "r");
-   if ( NULL != fd )
+   if ( MODEL_PARSE_FROM_BACKUP != iParseResult )
    {
-      if ( 1 != fscanf(fd, "%*s %d", &iVersionBackup) )
-      {
-         log_softerror_and_alarm("Load model: Error on version line. Invalid vehicle configuration file: %s", szFileBackup);
-         bBackupFileLoadedOk = false;
-      }
-      else
-      {
-         //log_line("Found model file version: %d.", iVersion);
-         if ( 8 == iVersionBackup )
-            bBackupFileLoadedOk = loadVersion8(fd);
-         if ( 9 == iVersionBackup )
-            bBackupFileLoadedOk = loadVersion9(fd);
-         if ( 10 == iVersionBackup )
-            bBackupFileLoadedOk = loadVersion10(fd);
-         if ( bBackupFileLoadedOk )
-         {
-            iLoadedFileVersion = iVersionBackup;
-         }
-         else
-            log_softerror_and_alarm("Invalid vehicle configuration file: %s",szFileBackup);
-      }
-      fclose(fd);
-   }
-   else
-      bBackupFileLoadedOk = false;
-
-   if ( !bBackupFileLoadedOk )
-   {
-      if ( ! bLoadStats ) 
-         memcpy((u8*)&m_Stats, (u8*)&stats, sizeof(type_vehicle_stats_info));
       log_softerror_and_alarm("Failed to load vehicle configuration from file: %s (missing file, missing backup)",filename);
       resetToDefaults(true);
       return false;
    }
 
-   if ( ! bLoadStats ) 
-      memcpy((u8*)&m_Stats, (u8*)&stats, sizeof(type_vehicle_stats_info));
    validate_settings();
 
-   timeStart = get_current_timestamp_ms() - timeStart;
-   log_line("Loaded vehicle successfully (%d ms) from backup file: %s; version %d, save count: %d, vehicle name: [%s], vehicle id: %u, software: %d.%d (b%d), is in control mode: %s", timeStart, filename, iLoadedFileVersion, iSaveCount, vehicle_name, uVehicleId, (sw_version >> 8) & 0xFF, sw_version & 0xFF, sw_version>>16, is_spectator?"no (is spectator)":"yes");
+   log_line("Loaded vehicle successfully (%u ms) from backup file: %s; version %d, save count: %d, vehicle name: [%s], vehicle id: %u, software: %d.%d (b%d), is in control mode: %s", uParseTimeMs, filename, iLoadedFileVersion, iSaveCount, vehicle_name, uVehicleId, (sw_version >> 8) & 0xFF, sw_version & 0xFF, sw_version>>16, is_spectator?"no (is spectator)":"yes");
 
    constructLongName();
    
-   fd = fopen(szFileNormal, "w");
+   FILE* fd = fopen(filename, "w");
    if ( NULL != fd )
    {
       saveVersion10(fd, false);
@@ -953,8 +965,6 @@ bool Model::loadVersion8(FILE* fd)
    if ( rxtx_sync_type < 0 || rxtx_sync_type >= RXTX_SYNC_TYPE_LAST )
       rxtx_sync_type = RXTX_SYNC_TYPE_NONE;
 
-   validate_settings();
-
    /*
    log_line("---------------------------------------");
    log_line("Loaded radio links %d:", radioLinksParams.links_count);
@@ -1517,8 +1527,6 @@ bool Model::loadVersion9(FILE* fd)
    if ( rxtx_sync_type < 0 || rxtx_sync_type >= RXTX_SYNC_TYPE_LAST )
       rxtx_sync_type = RXTX_SYNC_TYPE_NONE;
 
-   validate_settings();
-
    /*
    log_line("---------------------------------------");
    log_line("Loaded radio links %d:", radioLinksParams.links_count);
@@ -2123,8 +2131,6 @@ bool Model::loadVersion10(FILE* fd)
    if ( rxtx_sync_type < 0 || rxtx_sync_type >= RXTX_SYNC_TYPE_LAST )
       rxtx_sync_type = RXTX_SYNC_TYPE_NONE;
 
-   validate_settings();
-
    /*
    log_line("---------------------------------------");
    log_line("Loaded radio links %d:", radioLinksParams.links_count);
@@ -2179,6 +2185,7 @@ bool Model::saveToFile(const char* filename, bool isOnController)
       fflush(fd);
       fclose(fd);
    }
+   saveBinarySnapshot(filename, 10);
    log_line("Saved vehicle successfully to file: %s; name: [%s], VID: %u, software: %d.%d (b%d), is on controller: %s, on time: %02d:%02d",
          filename, vehicle_name, uVehicleId, (sw_version >> 8) & 0xFF, sw_version & 0xFF, sw_version>>16,
          isOnController?"yes":"no",
@@ -4129,6 +4136,7 @@ void Model::resetRelayParamsToDefaults(type_relay_parameters* pRelayParams)
 {
    if ( NULL == pRelayParams )
       return;
+   memset(pRelayParams, 0, sizeof(type_relay_parameters));
    pRelayParams->isRelayEnabledOnRadioLinkId = -1;
    pRelayParams->uCurrentRelayMode = 0;
    pRelayParams->uRelayFrequencyKhz = 0;
@@ -4307,6 +4315,8 @@ void Model::resetCameraToDefaults(int iCameraIndex)
          continue;
       if ( iCameraIndex == -1 )
       {
+         // Clear unused bytes too, so that model sections hashes match between vehicle and controller
+         memset(&(camera_params[k]), 0, sizeof(type_camera_parameters));
          camera_params[k].iCameraType = 0;
          camera_params[k].iForcedCameraType = 0;
          camera_params[k].szCameraName[0] = 0;
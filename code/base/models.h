@@ -15,6 +15,12 @@
 
 #define MODEL_MAX_OSD_PROFILES 5
 
+// Model::parseFile() results
+#define MODEL_PARSE_FAILED 0
+#define MODEL_PARSE_FROM_SNAPSHOT 1
+#define MODEL_PARSE_FROM_TEXT 2
+#define MODEL_PARSE_FROM_BACKUP 3
+
 #define CAMERA_FLAG_FORCE_MODE_1 1
 #define CAMERA_FLAG_AWB_MODE_OLD ((u32)(((u32)0x01)<<1))
 #define CAMERA_FLAG_IR_FILTER_OFF ((u32)(((u32)0x01)<<2))
@@ -458,6 +464,19 @@ typedef struct
    u32 dummyhwc2[3];
 } type_hardware_capabilities;
 
+// Sections of the model binary snapshot, of the shared memory model and of the vehicle-controller model sync. Ids are 1...MODEL_BINARY_SECTIONS_COUNT
+#define MODEL_BINARY_SECTION_GENERAL 1
+#define MODEL_BINARY_SECTION_HARDWARE 2
+#define MODEL_BINARY_SECTION_RADIO 3
+#define MODEL_BINARY_SECTION_VIDEO 4
+#define MODEL_BINARY_SECTION_CAMERAS 5
+#define MODEL_BINARY_SECTION_OSD 6
+#define MODEL_BINARY_SECTION_RC 7
+#define MODEL_BINARY_SECTION_TELEMETRY_FUNCTIONS 8
+#define MODEL_BINARY_SECTION_STATS 9
+#define MODEL_BINARY_SECTIONS_COUNT 9
+#define MODEL_BINARY_MAX_SECTION_MEMBERS 32
+
 class Model
 {
    public:
@@ -545,7 +564,20 @@ class Model
 
       bool reloadIfChanged(bool bLoadStats);
       bool loadFromFile(const char* filename, bool bLoadStats = false);
+      // loadFromFile() in two steps, to parse many model files in parallel:
+      // parseFile() only reads the model (snapshot, text or backup file) and can run on any thread;
+      // completeLoadFromFile() validates the settings (uses the hardware info) and logs, on the caller thread.
+      int  parseFile(const char* filename, bool bLoadStats, u32* puParseTimeMs);
+      bool completeLoadFromFile(const char* filename, bool bLoadStats, int iParseResult, u32 uParseTimeMs);
       bool saveToFile(const char* filename, bool isOnController);
+      // Binary snapshot of the model, saved next to the text model file (same name, .mdb extension).
+      // Loads with a single read; used only while it matches the text model file it was created from.
+      bool loadBinarySnapshot(const char* szModelFile, int* piSourceVersion);
+      bool saveBinarySnapshot(const char* szModelFile, int iSourceVersion);
+      // Model members stored in a binary snapshot section (MODEL_BINARY_SECTION_*). Returns the members count
+      int getBinarySnapshotSectionMembers(u32 uSectionId, u8** ppMembers, int* piSizes);
+      // Same members, without the ones local to each side (save counter). Used to sync the model between vehicle and controller
+      int getSyncSectionMembers(u32 uSectionId, u8** ppMembers, int* piSizes);
       int  getLoadedFileVersion();
       bool isRunningOnOpenIPCHardware();
       void populateHWInfo();
@@ -0,0 +1,416 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "base.h"
+#include "models.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Binary snapshot of a model: a header followed by sections. Each section has its own id, version, size and CRC.
+// A section is the raw content of a group of model members, so any change to those members (types, order)
+// must increase the section version. A snapshot with a missing or older section is not used:
+// the model is loaded from the text file instead and a new snapshot is saved.
+// The header keeps the size, modification time and CRC of the content of the text model file the snapshot was created from,
+// so a text model file written by other means (received from vehicle, restored from backup) invalidates the snapshot,
+// even if it has the same size and time (files extracted from archives of vehicles with unsynced clocks).
+
+#define MODEL_BINARY_MAGIC 0x4D444252
+#define MODEL_BINARY_FORMAT_VERSION 2
+#define MODEL_BINARY_MAX_FILE_SIZE 512000
+
+typedef struct
+{
+   u32 uMagic;
+   u32 uFormatVersion;
+   u32 uSectionsCount;
+   u32 uSourceVersion; // version of the text model file the snapshot was created from
+   u32 uSourceSize;
+   u32 uSourceTimeSec;
+   u32 uSourceTimeNanoSec;
+   u32 uSourceCRC; // of the content of the text model file
+   u32 uCRC; // of the header fields above
+} __attribute__((packed)) t_model_binary_header;
+
+typedef struct
+{
+   u32 uSectionId;
+   u32 uSectionVersion;
+   u32 uSize;
+   u32 uCRC;
+} __attribute__((packed)) t_model_binary_section_header;
+
+// Section id and current version, for each of the MODEL_BINARY_SECTIONS_COUNT sections
+static const u32 s_uModelBinarySections[MODEL_BINARY_SECTIONS_COUNT][2] =
+{
+   { MODEL_BINARY_SECTION_GENERAL, 1 },
+   { MODEL_BINARY_SECTION_HARDWARE, 1 },
+   { MODEL_BINARY_SECTION_RADIO, 1 },
+   { MODEL_BINARY_SECTION_VIDEO, 1 },
+   { MODEL_BINARY_SECTION_CAMERAS, 1 },
+   { MODEL_BINARY_SECTION_OSD, 1 },
+   { MODEL_BINARY_SECTION_RC, 1 },
+   { MODEL_BINARY_SECTION_TELEMETRY_FUNCTIONS, 1 },
+   { MODEL_BINARY_SECTION_STATS, 1 }
+};
+
+static void _model_binary_get_file_name(const char* szModelFile, char* szOutput)
+{
+   strncpy(szOutput, szModelFile, MAX_FILE_PATH_SIZE-1);
+   szOutput[MAX_FILE_PATH_SIZE-1] = 0;
+   int iLen = strlen(szOutput);
+   if ( iLen < 4 )
+      return;
+   szOutput[iLen-3] = 'm';
+   szOutput[iLen-2] = 'd';
+   szOutput[iLen-1] = 'b';
+}
+
+static bool _model_binary_get_source_info(const char* szModelFile, t_model_binary_header* pHeader)
+{
+   struct stat statSource;
+   if ( 0 != stat(szModelFile, &statSource) )
+      return false;
+   pHeader->uSourceSize = (u32) statSource.st_size;
+   pHeader->uSourceTimeSec = (u32) statSource.st_mtim.tv_sec;
+   pHeader->uSourceTimeNanoSec = (u32) statSource.st_mtim.tv_nsec;
+   if ( (statSource.st_size <= 0) || (statSource.st_size > MODEL_BINARY_MAX_FILE_SIZE) )
+      return false;
+
+   int fd = open(szModelFile, O_RDONLY);
+   if ( fd < 0 )
+      return false;
+   u8* pBuffer = (u8*) malloc(statSource.st_size);
+   if ( NULL == pBuffer )
+   {
+      close(fd);
+      return false;
+   }
+   int iRead = (int)read(fd, pBuffer, statSource.st_size);
+   close(fd);
+   if ( iRead == (int)statSource.st_size )
+      pHeader->uSourceCRC = base_compute_crc32(pBuffer, iRead);
+   free(pBuffer);
+   return (iRead == (int)statSource.st_size);
+}
+
+// Returns the number of members in the section, or 0 for an unknown section
+
+int Model::getBinarySnapshotSectionMembers(u32 uSectionId, u8** ppMembers, int* piSizes)
+{
+   int iCount = 0;
+   #define MODEL_BINARY_ADD_MEMBER(member) { ppMembers[iCount] = (u8*)&(member); piSizes[iCount] = (int)sizeof(member); iCount++; }
+
+   if ( MODEL_BINARY_SECTION_GENERAL == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(iSaveCount);
+      MODEL_BINARY_ADD_MEMBER(sw_version);
+      MODEL_BINARY_ADD_MEMBER(uVehicleId);
+      MODEL_BINARY_ADD_MEMBER(uControllerId);
+      MODEL_BINARY_ADD_MEMBER(uModelFlags);
+      MODEL_BINARY_ADD_MEMBER(vehicle_name);
+      MODEL_BINARY_ADD_MEMBER(is_spectator);
+      MODEL_BINARY_ADD_MEMBER(vehicle_type);
+      MODEL_BINARY_ADD_MEMBER(rxtx_sync_type);
+      MODEL_BINARY_ADD_MEMBER(alarms);
+      MODEL_BINARY_ADD_MEMBER(m_iRadioInterfacesGraphRefreshInterval);
+      MODEL_BINARY_ADD_MEMBER(enableDHCP);
+      MODEL_BINARY_ADD_MEMBER(camera_rc_channels);
+      MODEL_BINARY_ADD_MEMBER(enc_flags);
+      MODEL_BINARY_ADD_MEMBER(iGPSCount);
+      MODEL_BINARY_ADD_MEMBER(bDeveloperMode);
+      MODEL_BINARY_ADD_MEMBER(uDeveloperFlags);
+   }
+   else if ( MODEL_BINARY_SECTION_HARDWARE == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(hwCapabilities);
+      MODEL_BINARY_ADD_MEMBER(hardwareInterfacesInfo);
+      MODEL_BINARY_ADD_MEMBER(processesPriorities);
+   }
+   else if ( MODEL_BINARY_SECTION_RADIO == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(radioInterfacesParams);
+      MODEL_BINARY_ADD_MEMBER(radioLinksParams);
+      MODEL_BINARY_ADD_MEMBER(relay_params);
+   }
+   else if ( MODEL_BINARY_SECTION_VIDEO == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(video_params);
+      MODEL_BINARY_ADD_MEMBER(video_link_profiles);
+   }
+   else if ( MODEL_BINARY_SECTION_CAMERAS == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(iCameraCount);
+      MODEL_BINARY_ADD_MEMBER(iCurrentCamera);
+      MODEL_BINARY_ADD_MEMBER(camera_params);
+   }
+   else if ( MODEL_BINARY_SECTION_OSD == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(osd_params);
+   }
+   else if ( MODEL_BINARY_SECTION_RC == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(rc_params);
+   }
+   else if ( MODEL_BINARY_SECTION_TELEMETRY_FUNCTIONS == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(telemetry_params);
+      MODEL_BINARY_ADD_MEMBER(audio_params);
+      MODEL_BINARY_ADD_MEMBER(functions_params);
+      MODEL_BINARY_ADD_MEMBER(alarms_params);
+   }
+   else if ( MODEL_BINARY_SECTION_STATS == uSectionId )
+   {
+      MODEL_BINARY_ADD_MEMBER(m_Stats);
+   }
+
+   #undef MODEL_BINARY_ADD_MEMBER
+   return iCount;
+}
+
+int Model::getSyncSectionMembers(u32 uSectionId, u8** ppMembers, int* piSizes)
+{
+   int iCount = getBinarySnapshotSectionMembers(uSectionId, ppMembers, piSizes);
+   for( int i=0; i<iCount; i++ )
+   {
+      if ( ppMembers[i] != (u8*)&iSaveCount )
+         continue;
+      for( int k=i; k<iCount-1; k++ )
+      {
+         ppMembers[k] = ppMembers[k+1];
+         piSizes[k] = piSizes[k+1];
+      }
+      iCount--;
+      break;
+   }
+   return iCount;
+}
+
+bool Model::saveBinarySnapshot(const char* szModelFile, int iSourceVersion)
+{
+   u8* pMembers[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iSizes[MODEL_BINARY_MAX_SECTION_MEMBERS];
+
+   t_model_binary_header header;
+   memset(&header, 0, sizeof(header));
+   if ( ! _model_binary_get_source_info(szModelFile, &header) )
+      return false;
+   header.uMagic = MODEL_BINARY_MAGIC;
+   header.uFormatVersion = MODEL_BINARY_FORMAT_VERSION;
+   header.uSectionsCount = MODEL_BINARY_SECTIONS_COUNT;
+   header.uSourceVersion = (u32)iSourceVersion;
+   header.uCRC = base_compute_crc32((u8*)&header, sizeof(header) - sizeof(u32));
+
+   int iTotalSize = sizeof(t_model_binary_header);
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      int iCount = getBinarySnapshotSectionMembers(s_uModelBinarySections[i][0], pMembers, iSizes);
+      iTotalSize += sizeof(t_model_binary_section_header);
+      for( int k=0; k<iCount; k++ )
+         iTotalSize += iSizes[k];
+   }
+
+   u8* pBuffer = (u8*) malloc(iTotalSize);
+   if ( NULL == pBuffer )
+      return false;
+
+   memcpy(pBuffer, &header, sizeof(header));
+   int iPos = sizeof(header);
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      t_model_binary_section_header* pSection = (t_model_binary_section_header*)(pBuffer + iPos);
+      iPos += sizeof(t_model_binary_section_header);
+      u8* pSectionData = pBuffer + iPos;
+      int iCount = getBinarySnapshotSectionMembers(s_uModelBinarySections[i][0], pMembers, iSizes);
+      for( int k=0; k<iCount; k++ )
+      {
+         memcpy(pBuffer + iPos, pMembers[k], iSizes[k]);
+         iPos += iSizes[k];
+      }
+      pSection->uSectionId = s_uModelBinarySections[i][0];
+      pSection->uSectionVersion = s_uModelBinarySections[i][1];
+      pSection->uSize = (u32)(pBuffer + iPos - pSectionData);
+      pSection->uCRC = base_compute_crc32(pSectionData, (int)pSection->uSize);
+   }
+
+   // Write to a temporary file and rename it, as several processes can load and save the snapshot at the same time
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   char szFileTmp[MAX_FILE_PATH_SIZE+16];
+   _model_binary_get_file_name(szModelFile, szFile);
+   snprintf(szFileTmp, sizeof(szFileTmp)/sizeof(szFileTmp[0]), "%s.%d", szFile, (int)getpid());
+
+   bool bOk = false;
+   int fd = open(szFileTmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if ( fd >= 0 )
+   {
+      if ( iTotalSize == (int)write(fd, pBuffer, iTotalSize) )
+         bOk = true;
+      close(fd);
+      if ( bOk && (0 != rename(szFileTmp, szFile)) )
+         bOk = false;
+      if ( ! bOk )
+         unlink(szFileTmp);
+   }
+   free(pBuffer);
+
+   if ( ! bOk )
+      log_softerror_and_alarm("Failed to save model binary snapshot to file: %s", szFile);
+   return bOk;
+}
+
+// Loads the model from the binary snapshot of the text model file, if the snapshot exists, is valid
+// and still matches the text model file. The model is not changed otherwise.
+
+bool Model::loadBinarySnapshot(const char* szModelFile, int* piSourceVersion)
+{
+   t_model_binary_header headerSource;
+   if ( ! _model_binary_get_source_info(szModelFile, &headerSource) )
+      return false;
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   _model_binary_get_file_name(szModelFile, szFile);
+   int fd = open(szFile, O_RDONLY);
+   if ( fd < 0 )
+      return false;
+
+   struct stat statFile;
+   if ( (0 != fstat(fd, &statFile)) || (statFile.st_size < (int)sizeof(t_model_binary_header)) || (statFile.st_size > MODEL_BINARY_MAX_FILE_SIZE) )
+   {
+      close(fd);
+      return false;
+   }
+
+   int iFileSize = (int)statFile.st_size;
+   u8* pBuffer = (u8*) malloc(iFileSize);
+   if ( NULL == pBuffer )
+   {
+      close(fd);
+      return false;
+   }
+   int iRead = (int)read(fd, pBuffer, iFileSize);
+   close(fd);
+
+   t_model_binary_header* pHeader = (t_model_binary_header*)pBuffer;
+   if ( (iRead != iFileSize) || (pHeader->uMagic != MODEL_BINARY_MAGIC) || (pHeader->uFormatVersion != MODEL_BINARY_FORMAT_VERSION) ||
+        (pHeader->uCRC != base_compute_crc32(pBuffer, sizeof(t_model_binary_header) - sizeof(u32))) )
+   {
+      log_line("Model binary snapshot %s is invalid. Ignoring it.", szFile);
+      free(pBuffer);
+      return false;
+   }
+
+   if ( (pHeader->uSourceSize != headerSource.uSourceSize) || (pHeader->uSourceTimeSec != headerSource.uSourceTimeSec) ||
+        (pHeader->uSourceTimeNanoSec != headerSource.uSourceTimeNanoSec) || (pHeader->uSourceCRC != headerSource.uSourceCRC) )
+   {
+      free(pBuffer);
+      return false;
+   }
+
+   // Find and validate all the sections before changing anything in the model
+
+   u8* pMembers[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iSizes[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   u8* pSectionsData[MODEL_BINARY_SECTIONS_COUNT];
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+      pSectionsData[i] = NULL;
+
+   int iPos = sizeof(t_model_binary_header);
+   for( u32 u=0; u<pHeader->uSectionsCount; u++ )
+   {
+      if ( iPos + (int)sizeof(t_model_binary_section_header) > iFileSize )
+         break;
+      t_model_binary_section_header* pSection = (t_model_binary_section_header*)(pBuffer + iPos);
+      iPos += sizeof(t_model_binary_section_header);
+      if ( (pSection->uSize > (u32)iFileSize) || (iPos + (int)pSection->uSize > iFileSize) )
+         break;
+      u8* pSectionData = pBuffer + iPos;
+      iPos += pSection->uSize;
+
+      // Sections unknown to this version are skipped
+      int iIndex = -1;
+      for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+         if ( s_uModelBinarySections[i][0] == pSection->uSectionId )
+            iIndex = i;
+      if ( -1 == iIndex )
+         continue;
+
+      int iCount = getBinarySnapshotSectionMembers(pSection->uSectionId, pMembers, iSizes);
+      int iExpectedSize = 0;
+      for( int k=0; k<iCount; k++ )
+         iExpectedSize += iSizes[k];
+
+      if ( (pSection->uSectionVersion != s_uModelBinarySections[iIndex][1]) || ((int)pSection->uSize != iExpectedSize) )
+      {
+         log_line("Model binary snapshot %s has an older section %u (version %u, %u bytes). Ignoring it.", szFile, pSection->uSectionId, pSection->uSectionVersion, pSection->uSize);
+         free(pBuffer);
+         return false;
+      }
+      if ( pSection->uCRC != base_compute_crc32(pSectionData, (int)pSection->uSize) )
+      {
+         log_softerror_and_alarm("Model binary snapshot %s has an invalid CRC on section %u. Ignoring it.", szFile, pSection->uSectionId);
+         free(pBuffer);
+         return false;
+      }
+      pSectionsData[iIndex] = pSectionData;
+   }
+
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      if ( NULL == pSectionsData[i] )
+      {
+         log_line("Model binary snapshot %s is missing section %u. Ignoring it.", szFile, s_uModelBinarySections[i][0]);
+         free(pBuffer);
+         return false;
+      }
+   }
+
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      u8* pData = pSectionsData[i];
+      int iCount = getBinarySnapshotSectionMembers(s_uModelBinarySections[i][0], pMembers, iSizes);
+      for( int k=0; k<iCount; k++ )
+      {
+         memcpy(pMembers[k], pData, iSizes[k]);
+         pData += iSizes[k];
+      }
+   }
+
+   if ( NULL != piSourceVersion )
+      *piSourceVersion = (int)pHeader->uSourceVersion;
+   free(pBuffer);
+
+   // Same as when loading from the text model file
+   if ( hardware_is_vehicle() )
+      sw_version = (SYSTEM_SW_VERSION_MAJOR * 256 + SYSTEM_SW_VERSION_MINOR) | (SYSTEM_SW_BUILD_NUMBER<<16);
+   return true;
+}
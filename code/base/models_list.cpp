@@ -32,6 +32,52 @@
 #include "base.h"
 #include "hardware.h"
 #include "models.h"
+#include "models_list.h"
+#include "models_shared_mem.h"
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+
+// The controller keeps a lightweight index of its controller and spectator models (id, name, type, last used time)
+// in the models folder. At startup only the index is read: a model is loaded from its file the first time it is accessed.
+// Each index entry keeps the size and the CRC of the content of the model file it was created from, so a model file
+// written by other means (update, import, restore) invalidates its entry and that model is loaded at startup.
+// (file times are not used: the clock is not set at boot on most controllers, so they can't be trusted)
+// Model slots not loaded yet are NULL; use the getters in this file, they load the model on access.
+
+#define MODELS_INDEX_MAGIC 0x4D444958
+#define MODELS_INDEX_VERSION 2
+#define MODELS_LIST_MAX_LOAD_THREADS 4
+
+typedef struct
+{
+   u32 uVehicleId;
+   u8 uVehicleType;
+   u8 uIsSpectator;
+   char szVehicleName[MAX_VEHICLE_NAME_LENGTH];
+   u32 uLastUsedTime;
+   u32 uSourceSize; // 0 for an unused entry
+   u32 uSourceCRC;
+} __attribute__((packed)) t_models_index_entry;
+
+typedef struct
+{
+   u32 uMagic;
+   u32 uVersion;
+   u32 uCRC; // of the entries
+   t_models_index_entry controllerModels[MAX_MODELS];
+   t_models_index_entry spectatorModels[MAX_MODELS_SPECTATOR];
+} __attribute__((packed)) t_models_index;
+
+typedef struct
+{
+   bool bSpectator;
+   int iIndex;
+   Model* pModel;
+   int iParseResult;
+   u32 uParseTimeMs;
+   char szFile[MAX_FILE_PATH_SIZE];
+} t_models_list_load_job;
 
 Model* s_pModelsSpectator[MAX_MODELS_SPECTATOR];
 int s_iModelsSpectatorCount = 0;
@@ -43,11 +89,352 @@ Model* s_pCurrentModel = NULL;
 
 static bool s_bLoadedAllModels = false;
 
+static t_models_index s_ModelsIndex;
+static bool s_bModelsIndexChanged = false;
+
+static t_models_list_load_job s_ModelsLoadJobs[MAX_MODELS + MAX_MODELS_SPECTATOR];
+static int s_iModelsLoadJobsCount = 0;
+static volatile int s_iModelsLoadNextJob = 0;
+
+static void _models_list_get_file_name(bool bSpectator, int iIndex, char* szFile)
+{
+   char szFolderM[MAX_FILE_PATH_SIZE];
+   strcpy(szFolderM, FOLDER_CONFIG_MODELS);
+   strcat(szFolderM, bSpectator?FILE_VEHICLE_SPECTATOR:FILE_VEHICLE_CONTROLL);
+   sprintf(szFile, szFolderM, iIndex);
+}
+
+static t_models_index_entry* _models_index_get_entry(bool bSpectator, int iIndex)
+{
+   if ( bSpectator )
+      return &s_ModelsIndex.spectatorModels[iIndex];
+   return &s_ModelsIndex.controllerModels[iIndex];
+}
+
+static void _models_index_load()
+{
+   memset((u8*)&s_ModelsIndex, 0, sizeof(t_models_index));
+   s_bModelsIndexChanged = false;
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   strcpy(szFile, FOLDER_CONFIG_MODELS);
+   strcat(szFile, FILE_VEHICLE_MODELS_INDEX);
+   FILE* fd = fopen(szFile, "rb");
+   if ( NULL == fd )
+   {
+      log_line("No models index file. All models will be loaded.");
+      return;
+   }
+   int iRead = fread((u8*)&s_ModelsIndex, 1, sizeof(t_models_index), fd);
+   fclose(fd);
+
+   u8* pEntries = (u8*)&s_ModelsIndex.controllerModels[0];
+   int iEntriesSize = (int)(sizeof(t_models_index) - 3*sizeof(u32));
+   if ( (iRead != (int)sizeof(t_models_index)) ||
+        (s_ModelsIndex.uMagic != MODELS_INDEX_MAGIC) ||
+        (s_ModelsIndex.uVersion != MODELS_INDEX_VERSION) ||
+        (s_ModelsIndex.uCRC != base_compute_crc32(pEntries, iEntriesSize)) )
+   {
+      log_softerror_and_alarm("Invalid models index file. All models will be loaded.");
+      memset((u8*)&s_ModelsIndex, 0, sizeof(t_models_index));
+   }
+}
+
+static void _models_index_save()
+{
+   if ( ! s_bModelsIndexChanged )
+      return;
+   s_bModelsIndexChanged = false;
+
+   s_ModelsIndex.uMagic = MODELS_INDEX_MAGIC;
+   s_ModelsIndex.uVersion = MODELS_INDEX_VERSION;
+   s_ModelsIndex.uCRC = base_compute_crc32((u8*)&s_ModelsIndex.controllerModels[0], (int)(sizeof(t_models_index) - 3*sizeof(u32)));
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   char szFileTmp[MAX_FILE_PATH_SIZE+16];
+   strcpy(szFile, FOLDER_CONFIG_MODELS);
+   strcat(szFile, FILE_VEHICLE_MODELS_INDEX);
+   snprintf(szFileTmp, sizeof(szFileTmp)/sizeof(szFileTmp[0]), "%s.%d", szFile, (int)getpid());
+
+   FILE* fd = fopen(szFileTmp, "wb");
+   if ( NULL == fd )
+   {
+      log_softerror_and_alarm("Failed to save models index file.");
+      return;
+   }
+   int iWritten = fwrite((u8*)&s_ModelsIndex, 1, sizeof(t_models_index), fd);
+   fclose(fd);
+   if ( (iWritten != (int)sizeof(t_models_index)) || (0 != rename(szFileTmp, szFile)) )
+   {
+      log_softerror_and_alarm("Failed to save models index file.");
+      unlink(szFileTmp);
+   }
+}
+
+// Returns false if the file can't be read
+
+static bool _models_index_get_source_info(const char* szFile, u32* puSize, u32* puCRC)
+{
+   *puSize = 0;
+   *puCRC = 0;
+   FILE* fd = fopen(szFile, "rb");
+   if ( NULL == fd )
+      return false;
+
+   u8* pBuffer = NULL;
+   long lSize = 0;
+   if ( 0 == fseek(fd, 0, SEEK_END) )
+      lSize = ftell(fd);
+   if ( lSize > 0 )
+   {
+      pBuffer = (u8*) malloc(lSize);
+      fseek(fd, 0, SEEK_SET);
+      if ( (NULL != pBuffer) && (lSize != (long)fread(pBuffer, 1, lSize, fd)) )
+         lSize = 0;
+   }
+   fclose(fd);
+   if ( (lSize <= 0) || (NULL == pBuffer) )
+   {
+      if ( NULL != pBuffer )
+         free(pBuffer);
+      return false;
+   }
+   *puSize = (u32) lSize;
+   *puCRC = base_compute_crc32(pBuffer, (int)lSize);
+   free(pBuffer);
+   return true;
+}
+
+static bool _models_index_is_valid(t_models_index_entry* pEntry, const char* szFile)
+{
+   if ( 0 == pEntry->uSourceSize )
+      return false;
+   u32 uSize = 0;
+   u32 uCRC = 0;
+   if ( ! _models_index_get_source_info(szFile, &uSize, &uCRC) )
+      return false;
+   if ( (pEntry->uSourceSize != uSize) || (pEntry->uSourceCRC != uCRC) )
+      return false;
+   return true;
+}
+
+// Called after the model file was loaded or saved
+
+static void _models_index_update(bool bSpectator, int iIndex, Model* pModel, const char* szFile)
+{
+   t_models_index_entry* pEntry = _models_index_get_entry(bSpectator, iIndex);
+   if ( pEntry->uVehicleId != pModel->uVehicleId )
+      pEntry->uLastUsedTime = 0;
+   pEntry->uVehicleId = pModel->uVehicleId;
+   pEntry->uVehicleType = pModel->vehicle_type;
+   pEntry->uIsSpectator = pModel->is_spectator?1:0;
+   strncpy(pEntry->szVehicleName, pModel->vehicle_name, MAX_VEHICLE_NAME_LENGTH-1);
+   pEntry->szVehicleName[MAX_VEHICLE_NAME_LENGTH-1] = 0;
+
+   u32 uSize = 0;
+   u32 uCRC = 0;
+   _models_index_get_source_info(szFile, &uSize, &uCRC);
+   pEntry->uSourceSize = uSize;
+   pEntry->uSourceCRC = uCRC;
+   s_bModelsIndexChanged = true;
+}
+
+static void _models_index_set_used(u32 uVehicleId)
+{
+   u32 uTimeNow = (u32) time(NULL);
+   for( int i=0; i<s_iModelsCount; i++ )
+      if ( s_ModelsIndex.controllerModels[i].uVehicleId == uVehicleId )
+      {
+         s_ModelsIndex.controllerModels[i].uLastUsedTime = uTimeNow;
+         s_bModelsIndexChanged = true;
+      }
+   for( int i=0; i<s_iModelsSpectatorCount; i++ )
+      if ( s_ModelsIndex.spectatorModels[i].uVehicleId == uVehicleId )
+      {
+         s_ModelsIndex.spectatorModels[i].uLastUsedTime = uTimeNow;
+         s_bModelsIndexChanged = true;
+      }
+   _models_index_save();
+}
+
+// Keeps the index entries in the same order as the slots when the slots are moved in memory.
+// Moved entries no longer match the file in their slot until it is saved again.
+
+static void _models_index_move(bool bSpectator, int iFrom, int iTo)
+{
+   t_models_index_entry entry;
+   memcpy((u8*)&entry, (u8*)_models_index_get_entry(bSpectator, iFrom), sizeof(t_models_index_entry));
+   if ( iFrom > iTo )
+   {
+      for( int i=iFrom; i>iTo; i-- )
+         memcpy((u8*)_models_index_get_entry(bSpectator, i), (u8*)_models_index_get_entry(bSpectator, i-1), sizeof(t_models_index_entry));
+   }
+   else
+   {
+      for( int i=iFrom; i<iTo; i++ )
+         memcpy((u8*)_models_index_get_entry(bSpectator, i), (u8*)_models_index_get_entry(bSpectator, i+1), sizeof(t_models_index_entry));
+   }
+   memcpy((u8*)_models_index_get_entry(bSpectator, iTo), (u8*)&entry, sizeof(t_models_index_entry));
+
+   int iMin = (iFrom < iTo)?iFrom:iTo;
+   int iMax = (iFrom < iTo)?iTo:iFrom;
+   for( int i=iMin; i<=iMax; i++ )
+      _models_index_get_entry(bSpectator, i)->uSourceSize = 0;
+   s_bModelsIndexChanged = true;
+}
+
+static u32 _models_list_get_slot_vehicle_id(bool bSpectator, int iIndex)
+{
+   Model* pModel = bSpectator?s_pModelsSpectator[iIndex]:s_pModels[iIndex];
+   if ( NULL != pModel )
+      return pModel->uVehicleId;
+   return _models_index_get_entry(bSpectator, iIndex)->uVehicleId;
+}
+
+// Puts a model loaded from the slot file in the slot. The current model object is used if it is the same vehicle.
+
+static Model* _models_list_assign_slot(bool bSpectator, int iIndex, Model* pModel, bool bLoaded, const char* szFile)
+{
+   t_models_index_entry* pEntry = _models_index_get_entry(bSpectator, iIndex);
+   if ( bLoaded )
+      _models_index_update(bSpectator, iIndex, pModel, szFile);
+   else
+   {
+      log_softerror_and_alarm("Failed to load %s model %d (VID %u) from file: %s. Using default settings for it.",
+         bSpectator?"spectator":"controller", iIndex+1, pEntry->uVehicleId, szFile);
+      pModel->resetToDefaults(false);
+      pModel->uVehicleId = pEntry->uVehicleId;
+      pModel->vehicle_type = pEntry->uVehicleType;
+      pModel->is_spectator = (pEntry->uIsSpectator != 0);
+      strncpy(pModel->vehicle_name, pEntry->szVehicleName, MAX_VEHICLE_NAME_LENGTH-1);
+      pModel->vehicle_name[MAX_VEHICLE_NAME_LENGTH-1] = 0;
+   }
+
+   if ( (NULL != s_pCurrentModel) && (s_pCurrentModel->uVehicleId == pModel->uVehicleId) )
+   {
+      delete pModel;
+      pModel = s_pCurrentModel;
+   }
+   if ( bSpectator )
+      s_pModelsSpectator[iIndex] = pModel;
+   else
+      s_pModels[iIndex] = pModel;
+   return pModel;
+}
+
+// Loads the model in the slot, if it was not loaded yet
+
+static Model* _models_list_materialize(bool bSpectator, int iIndex)
+{
+   Model* pModel = bSpectator?s_pModelsSpectator[iIndex]:s_pModels[iIndex];
+   if ( NULL != pModel )
+      return pModel;
+
+   t_models_index_entry* pEntry = _models_index_get_entry(bSpectator, iIndex);
+   if ( (NULL != s_pCurrentModel) && (s_pCurrentModel->uVehicleId == pEntry->uVehicleId) )
+   {
+      if ( bSpectator )
+         s_pModelsSpectator[iIndex] = s_pCurrentModel;
+      else
+         s_pModels[iIndex] = s_pCurrentModel;
+      return s_pCurrentModel;
+   }
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   _models_list_get_file_name(bSpectator, iIndex, szFile);
+   pModel = new Model();
+   bool bLoaded = pModel->loadFromFile(szFile, true);
+   pModel = _models_list_assign_slot(bSpectator, iIndex, pModel, bLoaded, szFile);
+   _models_index_save();
+   return pModel;
+}
+
+static void* _thread_load_models(void* pParam)
+{
+   while ( true )
+   {
+      int iJob = __sync_fetch_and_add(&s_iModelsLoadNextJob, 1);
+      if ( iJob >= s_iModelsLoadJobsCount )
+         break;
+      t_models_list_load_job* pJob = &s_ModelsLoadJobs[iJob];
+      pJob->iParseResult = pJob->pModel->parseFile(pJob->szFile, true, &pJob->uParseTimeMs);
+   }
+   return NULL;
+}
+
+// Loads all the models not loaded yet from the controller and/or spectator lists.
+// Only parsing the model files is done in parallel. Validating the models (it uses the hardware info and
+// non reentrant string helpers), the slots and the index are done on the calling thread.
+
+static void _models_list_load_all(bool bController, bool bSpectator)
+{
+   s_iModelsLoadJobsCount = 0;
+   for( int k=0; k<2; k++ )
+   {
+      bool bSpect = (k == 1);
+      if ( (bSpect && (!bSpectator)) || ((!bSpect) && (!bController)) )
+         continue;
+      int iCount = bSpect?s_iModelsSpectatorCount:s_iModelsCount;
+      for( int i=0; i<iCount; i++ )
+      {
+         if ( NULL != (bSpect?s_pModelsSpectator[i]:s_pModels[i]) )
+            continue;
+         if ( (NULL != s_pCurrentModel) && (s_pCurrentModel->uVehicleId == _models_index_get_entry(bSpect, i)->uVehicleId) )
+         {
+            _models_list_materialize(bSpect, i);
+            continue;
+         }
+         t_models_list_load_job* pJob = &s_ModelsLoadJobs[s_iModelsLoadJobsCount];
+         pJob->bSpectator = bSpect;
+         pJob->iIndex = i;
+         pJob->pModel = new Model();
+         pJob->iParseResult = MODEL_PARSE_FAILED;
+         pJob->uParseTimeMs = 0;
+         _models_list_get_file_name(bSpect, i, pJob->szFile);
+         s_iModelsLoadJobsCount++;
+      }
+   }
+   if ( 0 == s_iModelsLoadJobsCount )
+      return;
+
+   u32 uTimeStart = get_current_timestamp_ms();
+
+   // Parsing checks the hardware type: detect it once here, before the worker threads start.
+   hardware_is_vehicle();
+   s_iModelsLoadNextJob = 0;
+
+   pthread_t threads[MODELS_LIST_MAX_LOAD_THREADS];
+   int iThreads = 0;
+   while ( (iThreads < MODELS_LIST_MAX_LOAD_THREADS) && (iThreads < s_iModelsLoadJobsCount-1) )
+   {
+      if ( 0 != pthread_create(&threads[iThreads], NULL, &_thread_load_models, NULL) )
+      {
+         log_softerror_and_alarm("Failed to create thread to load models.");
+         break;
+      }
+      iThreads++;
+   }
+   _thread_load_models(NULL);
+   for( int i=0; i<iThreads; i++ )
+      pthread_join(threads[i], NULL);
+
+   for( int i=0; i<s_iModelsLoadJobsCount; i++ )
+   {
+      t_models_list_load_job* pJob = &s_ModelsLoadJobs[i];
+      bool bLoaded = pJob->pModel->completeLoadFromFile(pJob->szFile, true, pJob->iParseResult, pJob->uParseTimeMs);
+      _models_list_assign_slot(pJob->bSpectator, pJob->iIndex, pJob->pModel, bLoaded, pJob->szFile);
+      pJob->pModel = NULL;
+   }
+   _models_index_save();
+   log_line("Loaded %d models in %u ms, using %d worker threads.", s_iModelsLoadJobsCount, get_current_timestamp_ms() - uTimeStart, iThreads);
+   s_iModelsLoadJobsCount = 0;
+}
+
 bool loadAllModels()
 {
    log_line("Loading all models from storage...");
    s_bLoadedAllModels = true;
-  
+
    bool bSucceeded = true;
 
    if ( NULL != s_pCurrentModel )
@@ -81,24 +468,39 @@ bool loadAllModels()
    s_iModelsCount = 0;
    s_iModelsSpectatorCount = 0;
 
+   _models_index_load();
+
+   // Models with a valid index entry are loaded on first access
+
+   int iNotLoaded = 0;
    strcpy(szFile, FOLDER_CONFIG);
    strcat(szFile, FILE_CONFIG_CURRENT_VEHICLE_COUNT);
    int count = load_simple_config_fileI(szFile, 0);
    if (count < 0 )
       count = 0;
+   if ( count > MAX_MODELS )
+      count = MAX_MODELS;
    log_line("Loading %d controller models...", count);
    for( int i=0; i<count; i++ )
    {
-      char szFolderM[MAX_FILE_PATH_SIZE];
-      strcpy(szFolderM, FOLDER_CONFIG_MODELS);
-      strcat(szFolderM, FILE_VEHICLE_CONTROLL);
-      sprintf(szFile, szFolderM, i);
-      s_pModels[i] = new Model();
-      if ( ! s_pModels[i]->loadFromFile(szFile, true) )
+      _models_list_get_file_name(false, i, szFile);
+      s_pModels[i] = NULL;
+      if ( _models_index_is_valid(&s_ModelsIndex.controllerModels[i], szFile) )
+      {
+         if ( s_pCurrentModel->uVehicleId == s_ModelsIndex.controllerModels[i].uVehicleId )
+            s_pModels[i] = s_pCurrentModel;
+         else
+            iNotLoaded++;
+         s_iModelsCount++;
+         continue;
+      }
+      Model* pModel = new Model();
+      if ( ! pModel->loadFromFile(szFile, true) )
+      {
+         delete pModel;
          break;
-
-      if ( s_pCurrentModel->uVehicleId == s_pModels[i]->uVehicleId )
-         s_pModels[i] = s_pCurrentModel;
+      }
+      _models_list_assign_slot(false, i, pModel, true, szFile);
       s_iModelsCount++;
    }
    log_line("Loaded %d controller models.", s_iModelsCount);
@@ -106,29 +508,52 @@ bool loadAllModels()
    s_iModelsSpectatorCount = 0;
    while( s_iModelsSpectatorCount < MAX_MODELS_SPECTATOR )
    {
-      char szBuff[256];
-      char szFolderM[MAX_FILE_PATH_SIZE];
-      strcpy(szFolderM, FOLDER_CONFIG_MODELS);
-      strcat(szFolderM, FILE_VEHICLE_SPECTATOR);
-      sprintf(szBuff, szFolderM, s_iModelsSpectatorCount);
-      s_pModelsSpectator[s_iModelsSpectatorCount] = new Model();
-      if( access( szBuff, R_OK ) == -1 )
+      _models_list_get_file_name(true, s_iModelsSpectatorCount, szFile);
+      if( access( szFile, R_OK ) == -1 )
          break;
-      if ( ! s_pModelsSpectator[s_iModelsSpectatorCount]->loadFromFile(szBuff, true) )
+      s_pModelsSpectator[s_iModelsSpectatorCount] = NULL;
+      if ( _models_index_is_valid(&s_ModelsIndex.spectatorModels[s_iModelsSpectatorCount], szFile) )
+      {
+         if ( s_pCurrentModel->uVehicleId == s_ModelsIndex.spectatorModels[s_iModelsSpectatorCount].uVehicleId )
+            s_pModelsSpectator[s_iModelsSpectatorCount] = s_pCurrentModel;
+         else
+            iNotLoaded++;
+         s_iModelsSpectatorCount++;
+         continue;
+      }
+      Model* pModel = new Model();
+      if ( ! pModel->loadFromFile(szFile, true) )
+      {
+         delete pModel;
          break;
-      if ( s_pCurrentModel->uVehicleId == s_pModelsSpectator[s_iModelsSpectatorCount]->uVehicleId )
-         s_pModelsSpectator[s_iModelsSpectatorCount] = s_pCurrentModel;
+      }
+      _models_list_assign_slot(true, s_iModelsSpectatorCount, pModel, true, szFile);
       s_iModelsSpectatorCount++;
    }
    log_line("Loaded %d spectator models.", s_iModelsSpectatorCount);
+   log_line("%d models are in the index and will be loaded on first use.", iNotLoaded);
+   _models_index_save();
 
    log_line("Loaded controller models:");
    for( int i=0; i<s_iModelsCount; i++ )
-      log_line("Controller model %d: [%s], VID: %u", i+1, s_pModels[i]->getLongName(), s_pModels[i]->uVehicleId);
-
+   {
+      if ( NULL != s_pModels[i] )
+         log_line("Controller model %d: [%s], VID: %u", i+1, s_pModels[i]->getLongName(), s_pModels[i]->uVehicleId);
+      else
+         log_line("Controller model %d: [%s], VID: %u (not loaded yet)", i+1, s_ModelsIndex.controllerModels[i].szVehicleName, s_ModelsIndex.controllerModels[i].uVehicleId);
+   }
    return true;
 }
 
+void loadAllModelsFull()
+{
+   if ( ! s_bLoadedAllModels )
+      loadAllModels();
+   if ( hardware_is_vehicle() )
+      return;
+   _models_list_load_all(true, true);
+}
+
 bool saveCurrentModel()
 {
    if ( NULL == s_pCurrentModel )
@@ -145,18 +570,20 @@ bool saveCurrentModel()
    s_pCurrentModel->saveToFile(szFile, hardware_is_station());
 
    if ( hardware_is_vehicle() )
+   {
+      models_shared_mem_publish(s_pCurrentModel);
       return true;
+   }
 
    for( int i=0; i<s_iModelsSpectatorCount; i++ )
    {
-      if ( s_pModelsSpectator[i]->uVehicleId != s_pCurrentModel->uVehicleId )
+      if ( _models_list_get_slot_vehicle_id(true, i) != s_pCurrentModel->uVehicleId )
          continue;
       char szBuff[256];
-      char szFolderM[MAX_FILE_PATH_SIZE];
-      strcpy(szFolderM, FOLDER_CONFIG_MODELS);
-      strcat(szFolderM, FILE_VEHICLE_SPECTATOR);
-      sprintf(szBuff, szFolderM, i);
-      s_pModelsSpectator[i]->saveToFile(szBuff, hardware_is_station());
+      _models_list_get_file_name(true, i, szBuff);
+      Model* pModel = _models_list_materialize(true, i);
+      pModel->saveToFile(szBuff, hardware_is_station());
+      _models_index_update(true, i, pModel, szBuff);
    }
 
    log_line("Saving %d controller models.", s_iModelsCount);
@@ -165,14 +592,14 @@ bool saveCurrentModel()
    save_simple_config_fileI(szFile, s_iModelsCount);
    for( int i=0; i<s_iModelsCount; i++ )
    {
-      if ( s_pModels[i]->uVehicleId != s_pCurrentModel->uVehicleId )
+      if ( _models_list_get_slot_vehicle_id(false, i) != s_pCurrentModel->uVehicleId )
          continue;
-      char szFolderM[MAX_FILE_PATH_SIZE];
-      strcpy(szFolderM, FOLDER_CONFIG_MODELS);
-      strcat(szFolderM, FILE_VEHICLE_CONTROLL);
-      sprintf(szFile, szFolderM, i);
-      s_pModels[i]->saveToFile(szFile, hardware_is_station());
+      _models_list_get_file_name(false, i, szFile);
+      Model* pModel = _models_list_materialize(false, i);
+      pModel->saveToFile(szFile, hardware_is_station());
+      _models_index_update(false, i, pModel, szFile);
    }
+   _models_index_save();
    return true;
 }
 
@@ -201,19 +628,21 @@ void setCurrentModel(u32 uVehicleId)
 {
    for( int i=0; i<s_iModelsCount; i++ )
    {
-       if ( (NULL != s_pModels[i]) && (s_pModels[i]->uVehicleId == uVehicleId) )
+       if ( _models_list_get_slot_vehicle_id(false, i) == uVehicleId )
        {
           log_line("Set current vehicle to controller vehicle index %d (VID %u)", i, uVehicleId);
-          s_pCurrentModel = s_pModels[i];
+          s_pCurrentModel = _models_list_materialize(false, i);
+          _models_index_set_used(uVehicleId);
           return;
        }
    }
    for( int i=0; i<s_iModelsSpectatorCount; i++ )
    {
-       if ( (NULL != s_pModelsSpectator[i]) && (s_pModelsSpectator[i]->uVehicleId == uVehicleId) )
+       if ( _models_list_get_slot_vehicle_id(true, i) == uVehicleId )
        {
           log_line("Set current vehicle to controller spectator vehicle index %d (VID %u)", i, uVehicleId);
-          s_pCurrentModel = s_pModelsSpectator[i];
+          s_pCurrentModel = _models_list_materialize(true, i);
+          _models_index_set_used(uVehicleId);
           return;
        }
    }
@@ -244,17 +673,30 @@ Model* getSpectatorModel(int iIndex)
 {
    if ( iIndex < 0 || iIndex > s_iModelsSpectatorCount )
       return NULL;
+   if ( iIndex < s_iModelsSpectatorCount )
+      return _models_list_materialize(true, iIndex);
    return s_pModelsSpectator[iIndex];
 }
 
+u32 getSpectatorModelIdAtIndex(int iIndex)
+{
+   if ( iIndex < 0 || iIndex >= s_iModelsSpectatorCount )
+      return 0;
+   return _models_list_get_slot_vehicle_id(true, iIndex);
+}
+
 
 Model* addSpectatorModel(u32 vehicleId)
 {
+   _models_list_load_all(false, true);
+
    int index = 0;
    for( index = 0; index < s_iModelsSpectatorCount; index++ )
       if ( s_pModelsSpectator[index]->uVehicleId == vehicleId )
       {
          // Move it to top of the list;
+         _models_index_move(true, index, 0);
+         _models_index_save();
          Model* tmp = s_pModelsSpectator[index];
          for( int i=index-1; i >=0; i-- )
             if (i >=0 )
@@ -265,6 +707,12 @@ Model* addSpectatorModel(u32 vehicleId)
 
    // New vehicle, add it on top of the list, move the other ones down the list.
 
+   int iLast = s_iModelsSpectatorCount;
+   if ( iLast > MAX_MODELS_SPECTATOR-1 )
+      iLast = MAX_MODELS_SPECTATOR-1;
+   _models_index_move(true, iLast, 0);
+   memset((u8*)&s_ModelsIndex.spectatorModels[0], 0, sizeof(t_models_index_entry));
+
    for( int i=s_iModelsSpectatorCount-1; i >= 0; i-- )
    {
       if ( i < MAX_MODELS_SPECTATOR-1 )
@@ -286,7 +734,9 @@ Model* addSpectatorModel(u32 vehicleId)
       strcat(szFolderM, FILE_VEHICLE_SPECTATOR);
       sprintf(szBuff, szFolderM, i);
       s_pModelsSpectator[i]->saveToFile(szBuff, true);
+      _models_index_update(true, i, s_pModelsSpectator[i], szBuff);
    }
+   _models_index_save();
 
    return s_pModelsSpectator[0];
 }
@@ -295,7 +745,10 @@ void moveSpectatorModelToTop(int index)
 {
    if ( index < 0 || index >= s_iModelsSpectatorCount )
       return;
-        
+
+   _models_list_load_all(false, true);
+   _models_index_move(true, index, 0);
+   _models_index_save();
    Model* tmp = s_pModelsSpectator[index];
    for( int i=index-1; i >=0; i-- )
       if (i >=0 )
@@ -307,9 +760,18 @@ Model* getModelAtIndex(int index)
 {
    if ( index < 0 || index >= MAX_MODELS )
       return NULL;
+   if ( index < s_iModelsCount )
+      return _models_list_materialize(false, index);
    return s_pModels[index];
 }
 
+u32 getModelIdAtIndex(int index)
+{
+   if ( index < 0 || index >= s_iModelsCount )
+      return 0;
+   return _models_list_get_slot_vehicle_id(false, index);
+}
+
 Model* addNewModel()
 {
    if ( s_iModelsCount >= MAX_MODELS-1 )
@@ -324,7 +786,9 @@ Model* addNewModel()
    strcat(szFolderM, FILE_VEHICLE_CONTROLL);
    sprintf(szBuff, szFolderM, s_iModelsCount);
    s_pModels[s_iModelsCount]->saveToFile(szBuff, true);
+   _models_index_update(false, s_iModelsCount, s_pModels[s_iModelsCount], szBuff);
    s_iModelsCount++;
+   _models_index_save();
 
    char szFile[MAX_FILE_PATH_SIZE];
    strcpy(szFile, FOLDER_CONFIG);
@@ -372,18 +836,18 @@ Model* findModelWithId(u32 uVehicleId, u32 uSrcId)
       return s_pCurrentModel;
 
    for( int i=0; i<s_iModelsCount; i++ )
-      if ( s_pModels[i]->uVehicleId == uVehicleId )
-         return s_pModels[i];
+      if ( _models_list_get_slot_vehicle_id(false, i) == uVehicleId )
+         return _models_list_materialize(false, i);
 
    for( int i=0; i<s_iModelsSpectatorCount; i++ )
-      if ( s_pModelsSpectator[i]->uVehicleId == uVehicleId )
-         return s_pModelsSpectator[i];
+      if ( _models_list_get_slot_vehicle_id(true, i) == uVehicleId )
+         return _models_list_materialize(true, i);
 
    log_softerror_and_alarm("Tried to find an inexistent VID: %u (source id: %u). Current loaded vehicles:", uVehicleId, uSrcId);
    for( int i=0; i<s_iModelsCount; i++ )
-      log_softerror_and_alarm("Vehicle Ctrlr %d: %u", i, s_pModels[i]->uVehicleId);
+      log_softerror_and_alarm("Vehicle Ctrlr %d: %u", i, _models_list_get_slot_vehicle_id(false, i));
    for( int i=0; i<s_iModelsSpectatorCount; i++ )
-      log_softerror_and_alarm("Vehicle Spect %d: %u", i, s_pModelsSpectator[i]->uVehicleId);
+      log_softerror_and_alarm("Vehicle Spect %d: %u", i, _models_list_get_slot_vehicle_id(true, i));
    if ( NULL == s_pCurrentModel )
       log_softerror_and_alarm("Current vehicle: NULL");
    else
@@ -400,11 +864,11 @@ bool controllerHasModelWithId(u32 uVehicleId)
    }
 
    for( int i=0; i<s_iModelsCount; i++ )
-      if ( s_pModels[i]->uVehicleId == uVehicleId )
+      if ( _models_list_get_slot_vehicle_id(false, i) == uVehicleId )
          return true;
 
    for( int i=0; i<s_iModelsSpectatorCount; i++ )
-      if ( s_pModelsSpectator[i]->uVehicleId == uVehicleId )
+      if ( _models_list_get_slot_vehicle_id(true, i) == uVehicleId )
          return true;
 
    return false;
@@ -432,6 +896,8 @@ Model* deleteModel(Model* pModel)
       return s_pCurrentModel;
    }
 
+   _models_list_load_all(true, true);
+
    char szFile[MAX_FILE_PATH_SIZE];      
    bool bDeletedController = false;
    bool bDeletedSpectator = false;
@@ -466,6 +932,8 @@ Model* deleteModel(Model* pModel)
       strcat(szFolderM, FILE_VEHICLE_CONTROLL);
       sprintf(szFile, szFolderM, s_iModelsCount);
       unlink(szFile);
+      _models_index_move(false, pos, s_iModelsCount);
+      memset((u8*)&s_ModelsIndex.controllerModels[s_iModelsCount], 0, sizeof(t_models_index_entry));
       szFile[strlen(szFile)-3] = 0;
       strcat(szFile, "bak");
       unlink(szFile);
@@ -480,6 +948,7 @@ Model* deleteModel(Model* pModel)
          strcat(szFolderM, FILE_VEHICLE_CONTROLL);
          sprintf(szFile, szFolderM, i);
          s_pModels[i]->saveToFile(szFile, hardware_is_station());
+         _models_index_update(false, i, s_pModels[i], szFile);
       }
       bDeletedController = true;
       break;
@@ -515,6 +984,8 @@ Model* deleteModel(Model* pModel)
       strcat(szFolderM, FILE_VEHICLE_SPECTATOR);
       sprintf(szFile, szFolderM, s_iModelsSpectatorCount);
       unlink(szFile);
+      _models_index_move(true, pos, s_iModelsSpectatorCount);
+      memset((u8*)&s_ModelsIndex.spectatorModels[s_iModelsSpectatorCount], 0, sizeof(t_models_index_entry));
       szFile[strlen(szFile)-3] = 0;
       strcat(szFile, "bak");
       unlink(szFile);
@@ -526,6 +997,7 @@ Model* deleteModel(Model* pModel)
          strcat(szFolderM, FILE_VEHICLE_SPECTATOR);
          sprintf(szFile, szFolderM, i);
          s_pModelsSpectator[i]->saveToFile(szFile, hardware_is_station());
+         _models_index_update(true, i, s_pModelsSpectator[i], szFile);
       }
       bDeletedSpectator = true;
       break;
@@ -533,6 +1005,7 @@ Model* deleteModel(Model* pModel)
 
    if ( (!bDeletedSpectator) && (!bDeletedController) )
       log_softerror_and_alarm("Tried to delete a model that is not in the list.");
+   _models_index_save();
    return s_pCurrentModel;
 }
 
@@ -543,8 +1016,8 @@ void saveControllerModel(Model* pModel)
 
    for( int i=0; i<s_iModelsCount; i++ )
    {
-      if ( s_pModels[i]->uVehicleId == pModel->uVehicleId )
-      if ( s_pModels[i]->is_spectator == pModel->is_spectator )
+      if ( _models_list_get_slot_vehicle_id(false, i) == pModel->uVehicleId )
+      if ( _models_list_materialize(false, i)->is_spectator == pModel->is_spectator )
       {
          log_line("Found matching vehicle in controller's list while saving a model. Save it in controller's models list too.");
          char szFile[MAX_FILE_PATH_SIZE];
@@ -554,14 +1027,15 @@ void saveControllerModel(Model* pModel)
          sprintf(szFile, szFolderM, i);
          pModel->saveToFile(szFile, true);
          s_pModels[i]->loadFromFile(szFile, true);
+         _models_index_update(false, i, s_pModels[i], szFile);
          break;
       }
    }
 
    for( int i=0; i<s_iModelsSpectatorCount; i++ )
    {
-      if ( s_pModelsSpectator[i]->uVehicleId == pModel->uVehicleId )
-      if ( s_pModelsSpectator[i]->is_spectator == pModel->is_spectator )
+      if ( _models_list_get_slot_vehicle_id(true, i) == pModel->uVehicleId )
+      if ( _models_list_materialize(true, i)->is_spectator == pModel->is_spectator )
       {
          log_line("Found matching spectator vehicle in list.");
          char szFile[MAX_FILE_PATH_SIZE];
@@ -571,9 +1045,11 @@ void saveControllerModel(Model* pModel)
          sprintf(szFile, szFolderM, i);
          pModel->saveToFile(szFile, true);
          s_pModelsSpectator[i]->loadFromFile(szFile, true);
+         _models_index_update(true, i, s_pModelsSpectator[i], szFile);
          break;
       }
    }
+   _models_index_save();
 
    if ( NULL != s_pCurrentModel )
    if ( pModel->uVehicleId == s_pCurrentModel->uVehicleId )
@@ -591,9 +1067,10 @@ Model* setControllerCurrentModel(u32 uVehicleId)
 {
    for( int i=0; i<s_iModelsCount; i++ )
    {
-      if ( s_pModels[i]->uVehicleId == uVehicleId )
+      if ( _models_list_get_slot_vehicle_id(false, i) == uVehicleId )
       {
-         s_pCurrentModel = s_pModels[i];
+         s_pCurrentModel = _models_list_materialize(false, i);
+         _models_index_set_used(uVehicleId);
          log_line("Set VID %u, index %d as current controller model", uVehicleId, i);
          return s_pCurrentModel;
       }
@@ -601,9 +1078,10 @@ Model* setControllerCurrentModel(u32 uVehicleId)
 
    for( int i=0; i<s_iModelsSpectatorCount; i++ )
    {
-      if ( s_pModelsSpectator[i]->uVehicleId == uVehicleId )
+      if ( _models_list_get_slot_vehicle_id(true, i) == uVehicleId )
       {
-         s_pCurrentModel = s_pModelsSpectator[i];
+         s_pCurrentModel = _models_list_materialize(true, i);
+         _models_index_set_used(uVehicleId);
          log_line("Set VID %u, index %d as current spectator model", uVehicleId, i);
          return s_pCurrentModel;
       }
@@ -619,7 +1097,8 @@ void logControllerModels()
    for( int i=0; i<s_iModelsCount; i++ )
    {
       if ( NULL == s_pModels[i] )
-         log_error_and_alarm("Controller model %d: is NULL.", i+1);
+         log_line("Controller model %d: VID %u, not loaded yet, last used: %u",
+            i+1, s_ModelsIndex.controllerModels[i].uVehicleId, s_ModelsIndex.controllerModels[i].uLastUsedTime);
       else
          log_line("Controller model %d: VID %u, ptr: %X, is spectator: %s, must sync: %s",
             i+1, s_pModels[i]->uVehicleId, s_pModels[i], s_pModels[i]->is_spectator?"yes":"no", s_pModels[i]->b_mustSyncFromVehicle?"yes":"no");
@@ -627,8 +1106,9 @@ void logControllerModels()
 
    for( int i=0; i<s_iModelsSpectatorCount; i++ )
    {
-      if ( NULL == s_pModels[i] )
-         log_error_and_alarm("Spectator model %d: is NULL.", i+1);
+      if ( NULL == s_pModelsSpectator[i] )
+         log_line("Spectator model %d: VID %u, not loaded yet, last used: %u",
+            i+1, s_ModelsIndex.spectatorModels[i].uVehicleId, s_ModelsIndex.spectatorModels[i].uLastUsedTime);
       else
          log_line("Spectator model %d: VID %u, ptr: %X, is spectator: %s, must sync: %s",
          i+1, s_pModelsSpectator[i]->uVehicleId, s_pModelsSpectator[i], s_pModelsSpectator[i]->is_spectator?"yes":"no", s_pModelsSpectator[i]->b_mustSyncFromVehicle?"yes":"no");
@@ -4,7 +4,11 @@
 #include "models.h"
 
 
+// Only the models with no valid entry in the models index are loaded from storage;
+// the other ones are loaded on first access (getModelAtIndex, getSpectatorModel, findModelWithId...).
 bool loadAllModels();
+// Loads all the models not loaded yet, in parallel. Use it before iterating the models lists.
+void loadAllModelsFull();
 bool saveCurrentModel();
 Model* getCurrentModel();
 bool reloadCurrentModel();
@@ -16,10 +20,14 @@ int getControllerModelsSpectatorCount();
 void deleteAllModels();
 
 Model* getSpectatorModel(int iIndex);
+// Does not load the model
+u32 getSpectatorModelIdAtIndex(int iIndex);
 Model* addSpectatorModel(u32 vehicleId);
 void moveSpectatorModelToTop(int index);
 
 Model* getModelAtIndex(int index);
+// Does not load the model
+u32 getModelIdAtIndex(int index);
 Model* addNewModel();
 void replaceModel(int index, Model* pModel);
 Model* findModelWithId(u32 uVehicleId, u32 uSrcId);
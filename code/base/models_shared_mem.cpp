@@ -0,0 +1,336 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "base.h"
+#include "models_shared_mem.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static shared_mem_model* s_pSharedMemModel = NULL;
+static bool s_bSharedMemModelIsWrite = false;
+static int s_iSharedMemModelWriteFd = -1; // Kept open by writers, for the write lock
+static u32 s_uTimeLastSharedMemModelOpenAttempt = 0;
+
+// Generations of the published model and sections last copied (or published) by this process
+static u32 s_uSharedMemModelLocalGeneration = 0;
+static u32 s_uSharedMemModelLocalSectionGeneration[MODEL_BINARY_SECTIONS_COUNT];
+
+static u8* s_pSharedMemModelReadBuffer = NULL;
+
+static int _models_shared_mem_compute_layout(Model* pModel, u32* puOffsets, u32* puSizes)
+{
+   u8* pMembers[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iSizes[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iTotalSize = 0;
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      int iCount = pModel->getBinarySnapshotSectionMembers(i+1, pMembers, iSizes);
+      puOffsets[i] = iTotalSize;
+      puSizes[i] = 0;
+      for( int k=0; k<iCount; k++ )
+         puSizes[i] += iSizes[k];
+      iTotalSize += puSizes[i];
+   }
+   return iTotalSize;
+}
+
+// Does not clear the content (as open_shared_mem does), as several processes can publish the model
+
+static bool _models_shared_mem_open(bool bWrite)
+{
+   if ( NULL != s_pSharedMemModel )
+   {
+      if ( s_bSharedMemModelIsWrite || (! bWrite) )
+         return true;
+      munmap(s_pSharedMemModel, sizeof(shared_mem_model));
+      s_pSharedMemModel = NULL;
+   }
+   if ( -1 != s_iSharedMemModelWriteFd )
+   {
+      close(s_iSharedMemModelWriteFd);
+      s_iSharedMemModelWriteFd = -1;
+   }
+
+   // Readers retry at most once a second, the model is not published until a process saves it
+   u32 uTimeNow = get_current_timestamp_ms();
+   if ( (! bWrite) && (0 != s_uTimeLastSharedMemModelOpenAttempt) && (uTimeNow < s_uTimeLastSharedMemModelOpenAttempt + 1000) )
+      return false;
+   s_uTimeLastSharedMemModelOpenAttempt = uTimeNow;
+
+   int fd = -1;
+   if ( bWrite )
+      fd = shm_open(SHARED_MEM_MODEL, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+   else
+      fd = shm_open(SHARED_MEM_MODEL, O_RDONLY, S_IRUSR | S_IWUSR);
+   if ( fd < 0 )
+   {
+      if ( bWrite )
+         log_softerror_and_alarm("[SharedMemModel] Failed to open shared memory model for write: %s", strerror(errno));
+      return false;
+   }
+   if ( bWrite && (0 != ftruncate(fd, sizeof(shared_mem_model))) )
+   {
+      log_softerror_and_alarm("[SharedMemModel] Failed to init (ftruncate) shared memory model.");
+      close(fd);
+      return false;
+   }
+   struct stat statShm;
+   if ( (0 != fstat(fd, &statShm)) || (statShm.st_size < (int)sizeof(shared_mem_model)) )
+   {
+      close(fd);
+      return false;
+   }
+   void* pAddress = mmap(NULL, sizeof(shared_mem_model), bWrite?(PROT_READ | PROT_WRITE):PROT_READ, MAP_SHARED, fd, 0);
+   if ( bWrite && (MAP_FAILED != pAddress) )
+      s_iSharedMemModelWriteFd = fd;
+   else
+      close(fd);
+   if ( MAP_FAILED == pAddress )
+   {
+      log_softerror_and_alarm("[SharedMemModel] Failed to map shared memory model for %s.", bWrite?"write":"read");
+      return false;
+   }
+   s_pSharedMemModel = (shared_mem_model*)pAddress;
+   s_bSharedMemModelIsWrite = bWrite;
+   log_line("[SharedMemModel] Opened shared memory model in %s mode.", bWrite?"write":"read");
+   return true;
+}
+
+void models_shared_mem_close()
+{
+   if ( NULL != s_pSharedMemModel )
+      munmap(s_pSharedMemModel, sizeof(shared_mem_model));
+   s_pSharedMemModel = NULL;
+   if ( -1 != s_iSharedMemModelWriteFd )
+      close(s_iSharedMemModelWriteFd);
+   s_iSharedMemModelWriteFd = -1;
+   if ( NULL != s_pSharedMemModelReadBuffer )
+      free(s_pSharedMemModelReadBuffer);
+   s_pSharedMemModelReadBuffer = NULL;
+}
+
+// The write lock is a fcntl lock on the shared memory file: the kernel releases it if the writer dies,
+// so there is never more than one writer. fcntl locks are per process: a process publishes from a single thread.
+
+static bool _models_shared_mem_write_lock(bool bLock)
+{
+   struct flock lockInfo;
+   memset(&lockInfo, 0, sizeof(lockInfo));
+   lockInfo.l_type = bLock?F_WRLCK:F_UNLCK;
+   lockInfo.l_whence = SEEK_SET;
+   lockInfo.l_start = 0;
+   lockInfo.l_len = 1;
+   if ( ! bLock )
+      return (0 == fcntl(s_iSharedMemModelWriteFd, F_SETLK, &lockInfo));
+
+   // Wait at most 50 ms for the other writer; the model file is still saved if publishing fails
+   for( int i=0; i<500; i++ )
+   {
+      if ( 0 == fcntl(s_iSharedMemModelWriteFd, F_SETLK, &lockInfo) )
+         return true;
+      if ( (errno != EACCES) && (errno != EAGAIN) && (errno != EINTR) )
+         break;
+      hardware_sleep_micros(100);
+   }
+   return false;
+}
+
+bool models_shared_mem_publish(Model* pModel)
+{
+   if ( NULL == pModel )
+      return false;
+
+   u32 uOffsets[MODEL_BINARY_SECTIONS_COUNT];
+   u32 uSizes[MODEL_BINARY_SECTIONS_COUNT];
+   int iDataSize = _models_shared_mem_compute_layout(pModel, uOffsets, uSizes);
+   if ( iDataSize > SHARED_MEM_MODEL_MAX_DATA_SIZE )
+   {
+      log_softerror_and_alarm("[SharedMemModel] Model is too big (%d bytes) to be published.", iDataSize);
+      return false;
+   }
+   if ( ! _models_shared_mem_open(true) )
+      return false;
+
+   shared_mem_model* pSM = s_pSharedMemModel;
+
+   if ( ! _models_shared_mem_write_lock(true) )
+   {
+      log_softerror_and_alarm("[SharedMemModel] Shared memory model is locked by another process (%s). Model not published.", strerror(errno));
+      return false;
+   }
+
+   // Move the generation to odd while writing. A writer that died while publishing left it odd already
+   u32 uGeneration = pSM->uGeneration | 0x01;
+   pSM->uGeneration = uGeneration;
+   __sync_synchronize();
+
+   u32 uNewGeneration = uGeneration + 1;
+   bool bLayoutChanged = (pSM->uDataSize != (u32)iDataSize);
+   u32 uChangedSections = 0;
+   u8* pMembers[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iSizes[MODEL_BINARY_MAX_SECTION_MEMBERS];
+
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      int iCount = pModel->getBinarySnapshotSectionMembers(i+1, pMembers, iSizes);
+      u8* pData = &(pSM->uData[uOffsets[i]]);
+      bool bChanged = bLayoutChanged;
+      for( int k=0; k<iCount; k++ )
+      {
+         if ( bChanged || (0 != memcmp(pData, pMembers[k], iSizes[k])) )
+         {
+            memcpy(pData, pMembers[k], iSizes[k]);
+            bChanged = true;
+         }
+         pData += iSizes[k];
+      }
+      pSM->uSectionOffset[i] = uOffsets[i];
+      pSM->uSectionSize[i] = uSizes[i];
+      if ( bChanged )
+      {
+         pSM->uSectionGeneration[i] = uNewGeneration;
+         uChangedSections |= (((u32)1) << i);
+      }
+      s_uSharedMemModelLocalSectionGeneration[i] = pSM->uSectionGeneration[i];
+   }
+
+   pSM->uDataSize = (u32)iDataSize;
+   pSM->uVehicleId = pModel->uVehicleId;
+   pSM->uSaveCount = (u32)pModel->getSaveCount();
+   pSM->uTimePublished = get_current_timestamp_ms();
+
+   __sync_synchronize();
+   pSM->uGeneration = uNewGeneration;
+   _models_shared_mem_write_lock(false);
+   s_uSharedMemModelLocalGeneration = uNewGeneration;
+   log_line("[SharedMemModel] Published model (generation %u), changed sections mask: 0x%X", uNewGeneration, uChangedSections);
+   return true;
+}
+
+bool models_shared_mem_update(Model* pModel, bool bLoadStats, u32* puChangedSections)
+{
+   if ( NULL != puChangedSections )
+      *puChangedSections = 0;
+   if ( NULL == pModel )
+      return false;
+   if ( ! _models_shared_mem_open(false) )
+      return false;
+
+   shared_mem_model* pSM = s_pSharedMemModel;
+   u32 uOffsets[MODEL_BINARY_SECTIONS_COUNT];
+   u32 uSizes[MODEL_BINARY_SECTIONS_COUNT];
+   int iDataSize = _models_shared_mem_compute_layout(pModel, uOffsets, uSizes);
+   if ( iDataSize > SHARED_MEM_MODEL_MAX_DATA_SIZE )
+      return false;
+
+   if ( NULL == s_pSharedMemModelReadBuffer )
+      s_pSharedMemModelReadBuffer = (u8*) malloc(SHARED_MEM_MODEL_MAX_DATA_SIZE);
+   if ( NULL == s_pSharedMemModelReadBuffer )
+      return false;
+
+   for( int iRetry=0; iRetry<20; iRetry++ )
+   {
+      u32 uGeneration = pSM->uGeneration;
+      if ( (0 == uGeneration) || (uGeneration == s_uSharedMemModelLocalGeneration) )
+         return false;
+      if ( uGeneration & 0x01 )
+      {
+         hardware_sleep_micros(200);
+         continue;
+      }
+      __sync_synchronize();
+
+      if ( pSM->uDataSize != (u32)iDataSize )
+      {
+         log_softerror_and_alarm("[SharedMemModel] Published model has a different layout (%u bytes, expected %d bytes).", pSM->uDataSize, iDataSize);
+         return false;
+      }
+
+      u32 uSectionGeneration[MODEL_BINARY_SECTIONS_COUNT];
+      u32 uChangedSections = 0;
+      for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+      {
+         uSectionGeneration[i] = pSM->uSectionGeneration[i];
+         if ( uSectionGeneration[i] == s_uSharedMemModelLocalSectionGeneration[i] )
+            continue;
+         if ( (! bLoadStats) && ((i+1) == MODEL_BINARY_SECTION_STATS) )
+            continue;
+         memcpy(s_pSharedMemModelReadBuffer + uOffsets[i], &(pSM->uData[uOffsets[i]]), uSizes[i]);
+         uChangedSections |= (((u32)1) << i);
+      }
+
+      __sync_synchronize();
+      if ( pSM->uGeneration != uGeneration )
+         continue;
+
+      // Got a consistent copy, apply it
+
+      u8* pMembers[MODEL_BINARY_MAX_SECTION_MEMBERS];
+      int iSizes[MODEL_BINARY_MAX_SECTION_MEMBERS];
+      for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+      {
+         if ( ! (uChangedSections & (((u32)1) << i)) )
+            continue;
+         int iCount = pModel->getBinarySnapshotSectionMembers(i+1, pMembers, iSizes);
+         u8* pData = s_pSharedMemModelReadBuffer + uOffsets[i];
+         for( int k=0; k<iCount; k++ )
+         {
+            memcpy(pMembers[k], pData, iSizes[k]);
+            pData += iSizes[k];
+         }
+         s_uSharedMemModelLocalSectionGeneration[i] = uSectionGeneration[i];
+      }
+      s_uSharedMemModelLocalGeneration = uGeneration;
+      // Same as after loading the model from file
+      pModel->validate_settings();
+      pModel->constructLongName();
+      if ( NULL != puChangedSections )
+         *puChangedSections = uChangedSections;
+      return true;
+   }
+   return false;
+}
+
+bool models_shared_mem_reload(Model* pModel, const char* szModelFile, bool bLoadStats)
+{
+   if ( NULL == pModel )
+      return false;
+   u32 uTimeStart = get_current_timestamp_micros();
+   u32 uChangedSections = 0;
+   if ( models_shared_mem_update(pModel, bLoadStats, &uChangedSections) )
+   {
+      log_line("[SharedMemModel] Updated model from shared memory (%u us), changed sections mask: 0x%X", get_current_timestamp_micros() - uTimeStart, uChangedSections);
+      return true;
+   }
+   return pModel->loadFromFile(szModelFile, bLoadStats);
+}
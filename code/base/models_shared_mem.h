@@ -0,0 +1,38 @@
+#pragma once
+#include "base.h"
+#include "models.h"
+
+// Current vehicle model published in shared memory by the process that saves it, so that the other
+// processes can update their model copy on a model changed notification without loading the model file.
+// The content is the same as the model binary snapshot sections. A generation counter (odd while a
+// process writes the model) lets readers get a consistent copy, and each section keeps the generation
+// it last changed in, so readers copy only the changed sections.
+
+#define SHARED_MEM_MODEL "/SYSTEM_SHARED_MEM_RUBY_MODEL"
+#define SHARED_MEM_MODEL_MAX_DATA_SIZE 65536
+
+typedef struct
+{
+   u32 uGeneration; // Odd while a process writes the model
+   u32 uDataSize; // Total size of the sections, must match the readers layout
+   u32 uVehicleId;
+   u32 uSaveCount;
+   u32 uTimePublished;
+   u32 uSectionGeneration[MODEL_BINARY_SECTIONS_COUNT];
+   u32 uSectionOffset[MODEL_BINARY_SECTIONS_COUNT];
+   u32 uSectionSize[MODEL_BINARY_SECTIONS_COUNT];
+   u8 uData[SHARED_MEM_MODEL_MAX_DATA_SIZE];
+} __attribute__((packed)) shared_mem_model;
+
+// Publishes the model. Only the sections that differ from the already published model are marked as changed.
+// Returns false if the model can't be published (another process holds the write lock); readers load the model file then.
+bool models_shared_mem_publish(Model* pModel);
+
+// Updates the model with the sections changed since the last update of this process.
+// Returns false if no newer model was published (or it can't be read); the model must be loaded from file then.
+bool models_shared_mem_update(Model* pModel, bool bLoadStats, u32* puChangedSections);
+
+// Reloads the model after a model changed notification: from the shared memory if a newer model was published, from the model file otherwise.
+bool models_shared_mem_reload(Model* pModel, const char* szModelFile, bool bLoadStats);
+
+void models_shared_mem_close();
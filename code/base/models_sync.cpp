@@ -0,0 +1,188 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "base.h"
+#include "models_sync.h"
+
+int models_sync_get_section_data(Model* pModel, u32 uSectionId, u8* pBuffer, int iMaxSize)
+{
+   if ( (NULL == pModel) || (NULL == pBuffer) )
+      return -1;
+   u8* pMembers[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iSizes[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iCount = pModel->getSyncSectionMembers(uSectionId, pMembers, iSizes);
+   if ( 0 == iCount )
+      return -1;
+   int iPos = 0;
+   for( int i=0; i<iCount; i++ )
+   {
+      if ( iPos + iSizes[i] > iMaxSize )
+         return -1;
+      memcpy(pBuffer + iPos, pMembers[i], iSizes[i]);
+      iPos += iSizes[i];
+   }
+   return iPos;
+}
+
+bool models_sync_set_section_data(Model* pModel, u32 uSectionId, u8* pData, int iSize)
+{
+   if ( (NULL == pModel) || (NULL == pData) )
+      return false;
+   u8* pMembers[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iSizes[MODEL_BINARY_MAX_SECTION_MEMBERS];
+   int iCount = pModel->getSyncSectionMembers(uSectionId, pMembers, iSizes);
+   int iTotalSize = 0;
+   for( int i=0; i<iCount; i++ )
+      iTotalSize += iSizes[i];
+   if ( (0 == iCount) || (iTotalSize != iSize) )
+      return false;
+   for( int i=0; i<iCount; i++ )
+   {
+      memcpy(pMembers[i], pData, iSizes[i]);
+      pData += iSizes[i];
+   }
+   return true;
+}
+
+u32 models_sync_get_section_crc(Model* pModel, u32 uSectionId)
+{
+   u8 uBuffer[MODEL_SYNC_MAX_SECTION_SIZE];
+   int iSize = models_sync_get_section_data(pModel, uSectionId, uBuffer, sizeof(uBuffer));
+   if ( iSize <= 0 )
+      return 0;
+   return base_compute_crc32(uBuffer, iSize);
+}
+
+void models_sync_compute_hashes(Model* pModel, t_model_sync_hashes* pHashes)
+{
+   if ( NULL == pHashes )
+      return;
+   memset(pHashes, 0, sizeof(t_model_sync_hashes));
+   pHashes->uFormatVersion = MODEL_SYNC_FORMAT_VERSION;
+   pHashes->uSectionsCount = MODEL_BINARY_SECTIONS_COUNT;
+
+   u8 uBuffer[MODEL_SYNC_MAX_SECTION_SIZE];
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      int iSize = models_sync_get_section_data(pModel, i+1, uBuffer, sizeof(uBuffer));
+      if ( iSize <= 0 )
+         continue;
+      pHashes->uSectionSize[i] = (u16)iSize;
+      pHashes->uSectionCRC[i] = base_compute_crc32(uBuffer, iSize);
+   }
+}
+
+u32 models_sync_get_changed_sections(t_model_sync_hashes* pHashes, t_model_sync_hashes* pRemoteHashes)
+{
+   if ( (NULL == pHashes) || (NULL == pRemoteHashes) )
+      return MAX_U32;
+   if ( (pHashes->uFormatVersion != pRemoteHashes->uFormatVersion) || (pHashes->uSectionsCount != pRemoteHashes->uSectionsCount) )
+      return MAX_U32;
+
+   u32 uChangedSections = 0;
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      if ( (0 == pHashes->uSectionSize[i]) || (pHashes->uSectionSize[i] != pRemoteHashes->uSectionSize[i]) )
+         return MAX_U32;
+      if ( pHashes->uSectionCRC[i] != pRemoteHashes->uSectionCRC[i] )
+         uChangedSections |= (((u32)1) << i);
+   }
+   return uChangedSections;
+}
+
+int models_sync_encode(u8* pData, int iSize, u8* pOutput, int iMaxOutputSize)
+{
+   int iPos = 0;
+   int iOut = 0;
+   while ( iPos < iSize )
+   {
+      if ( 0 != pData[iPos] )
+      {
+         if ( iOut >= iMaxOutputSize )
+            return -1;
+         pOutput[iOut++] = pData[iPos++];
+         continue;
+      }
+      int iCount = 0;
+      while ( (iPos < iSize) && (0 == pData[iPos]) && (iCount < 255) )
+      {
+         iPos++;
+         iCount++;
+      }
+      if ( iOut + 2 > iMaxOutputSize )
+         return -1;
+      pOutput[iOut++] = 0;
+      pOutput[iOut++] = (u8)iCount;
+   }
+   return iOut;
+}
+
+int models_sync_decode(u8* pData, int iSize, u8* pOutput, int iMaxOutputSize)
+{
+   int iPos = 0;
+   int iOut = 0;
+   while ( iPos < iSize )
+   {
+      if ( 0 != pData[iPos] )
+      {
+         if ( iOut >= iMaxOutputSize )
+            return -1;
+         pOutput[iOut++] = pData[iPos++];
+         continue;
+      }
+      if ( iPos + 1 >= iSize )
+         return -1;
+      int iCount = pData[iPos+1];
+      iPos += 2;
+      if ( (0 == iCount) || (iOut + iCount > iMaxOutputSize) )
+         return -1;
+      memset(pOutput + iOut, 0, iCount);
+      iOut += iCount;
+   }
+   return iOut;
+}
+
+bool models_sync_get_changed_range(u8* pOldData, u8* pNewData, int iSize, int* piOffset, int* piLength)
+{
+   int iStart = 0;
+   while ( (iStart < iSize) && (pOldData[iStart] == pNewData[iStart]) )
+      iStart++;
+   if ( iStart >= iSize )
+      return false;
+   int iEnd = iSize-1;
+   while ( (iEnd > iStart) && (pOldData[iEnd] == pNewData[iEnd]) )
+      iEnd--;
+   if ( NULL != piOffset )
+      *piOffset = iStart;
+   if ( NULL != piLength )
+      *piLength = iEnd - iStart + 1;
+   return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "base.h"
+#include "models.h"
+
+// Model sync between vehicle and controller, using the model binary sections.
+// The controller sends the hashes (CRC) of its model sections when requesting the model settings,
+// the vehicle sends back only the sections that are different. Small changes to a section are sent as patches.
+// Section data is zero run length encoded (model structures are mostly zeros).
+// The controller checks the resulting model against the section hashes and acks it with its own hashes (COMMAND_ID_MODEL_SYNC_ACK);
+// the vehicle uses the sections as the base for the next changes only after a matching ack, and sends them again otherwise.
+// The controller keeps the transfer state per vehicle.
+
+#define MODEL_SYNC_FORMAT_VERSION 1
+#define MODEL_SYNC_MAX_SECTION_SIZE 2048
+#define MODEL_SYNC_MAX_ENCODED_SIZE (2*MODEL_SYNC_MAX_SECTION_SIZE)
+#define MODEL_SYNC_SEGMENT_SIZE 150 // Same as the small segments of the full model settings, for slow links
+#define MODEL_SYNC_MAX_PATCH_SIZE 64
+
+typedef struct
+{
+   u8 uFormatVersion;
+   u8 uSectionsCount;
+   u16 uSectionSize[MODEL_BINARY_SECTIONS_COUNT];
+   u32 uSectionCRC[MODEL_BINARY_SECTIONS_COUNT];
+} __attribute__((packed)) t_model_sync_hashes;
+
+// Returns the section size, or -1 on error
+int models_sync_get_section_data(Model* pModel, u32 uSectionId, u8* pBuffer, int iMaxSize);
+bool models_sync_set_section_data(Model* pModel, u32 uSectionId, u8* pData, int iSize);
+u32 models_sync_get_section_crc(Model* pModel, u32 uSectionId);
+
+void models_sync_compute_hashes(Model* pModel, t_model_sync_hashes* pHashes);
+// Returns the bitmask of different sections (bit = section id - 1), or MAX_U32 if the sections layouts are different (full model must be sent)
+u32 models_sync_get_changed_sections(t_model_sync_hashes* pHashes, t_model_sync_hashes* pRemoteHashes);
+
+// Zero run length encoding: a zero byte is followed by the count of zeros (1..255), other bytes are stored as is
+// Return the output size, or -1 if the output buffer is too small
+int models_sync_encode(u8* pData, int iSize, u8* pOutput, int iMaxOutputSize);
+int models_sync_decode(u8* pData, int iSize, u8* pOutput, int iMaxOutputSize);
+
+// Finds the range of bytes that are different. Returns false if there are no differences
+bool models_sync_get_changed_range(u8* pOldData, u8* pNewData, int iSize, int* piOffset, int* piLength);
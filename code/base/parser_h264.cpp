@@ -52,6 +52,7 @@ void ParserH264::init(int iExpectedISlices)
    m_uLastNALUType = 0;
    m_uConsecutiveNALUs = 0;
    m_bStateIsInsideIFrame = false;
+   m_bStateIsInsideNonRefFrame = false;
    m_uCurrentFrameType = 0;
    m_uLastFrameType = 0;
    m_uTimeDurationOfLastFrame = 0;
@@ -61,25 +62,81 @@ void ParserH264::init(int iExpectedISlices)
    m_uSizeLastFrame = 0;
    m_uCurrentDetectedKeyframeIntervalMs = 0;
    m_uFramesSinceLastKeyframe = 0;
+   m_uPrevNALUType = 0;
+   m_iNALBoundariesCount = 0;
+   m_iCarriedBoundaryBytes = 0;
 
    m_uDebugFramesCounter = 0;
    m_uDebugTimeStartFramesCounter = 0;
    m_uDebugDetectedFPS = 0;
 }
 
+// Returns the offset of the next 0x01 byte (the last byte of a start code) or iDataLength if none
+// memchr is vectorized by the C library, so it is much faster than checking each byte in a loop
+
+int ParserH264::findNextStartCodeEnd(u8* pData, int iOffset, int iDataLength)
+{
+   if ( iOffset >= iDataLength )
+      return iDataLength;
+   u8* pFound = (u8*) memchr(pData + iOffset, 0x01, iDataLength - iOffset);
+   if ( NULL == pFound )
+      return iDataLength;
+   return (int)(pFound - pData);
+}
+
+void ParserH264::onNewFrameStart(u32 uFrameType, bool bIsKeyframe, u32 uTimeNowMs)
+{
+   m_uDebugFramesCounter++;
+   if ( uTimeNowMs >= m_uDebugTimeStartFramesCounter + 5000 )
+   {
+      m_uDebugTimeStartFramesCounter = uTimeNowMs;
+      m_uDebugDetectedFPS = m_uDebugFramesCounter/5;
+      m_uDebugFramesCounter = 0;
+   }
+   m_uLastFrameType = m_uCurrentFrameType;
+   m_uCurrentFrameType = uFrameType;
+   m_uTimeDurationOfLastFrame = uTimeNowMs - m_uTimeStartOfCurrentFrame;
+   m_uTimeStartOfCurrentFrame = uTimeNowMs;
+   m_uFramesSinceLastKeyframe++;
+   m_uSizeLastFrame = m_uSizeCurrentFrame;
+   m_uSizeCurrentFrame = 0;
+
+   if ( bIsKeyframe )
+   {
+      m_uCurrentDetectedKeyframeIntervalMs = uTimeNowMs - m_uTimeLastStartOfIFrame;
+      m_uTimeLastStartOfIFrame = uTimeNowMs;
+      m_uFramesSinceLastKeyframe = 0;
+   }
+}
+
 // Returns true if an start of a new frame was found
 bool ParserH264::parseData(u8* pData, int iDataLength, u32 uTimeNowMs)
 {
+   m_iNALBoundariesCount = 0;
+
    if ( (NULL == pData) || (iDataLength <= 0) )
       return false;
 
    bool bFoundFrameStart = false;
+   int iOffset = 0;
+   int iNextStartCodeEnd = -1;
 
-   while ( iDataLength > 0 )
+   while ( iOffset < iDataLength )
    {
-       m_uStateCurrentToken = (m_uStateCurrentToken<<8) | (*pData);
-       pData++;
-       iDataLength--;
+       // Skip directly to two bytes before the next 0x01 byte, as the start code check
+       // needs only the two zero bytes before it. Do not skip the NAL header byte after a start code.
+       if ( (iOffset > iNextStartCodeEnd) && ((m_uStateCurrentToken & 0xFF) != 0x01) )
+       {
+          iNextStartCodeEnd = findNextStartCodeEnd(pData, iOffset, iDataLength);
+          if ( iNextStartCodeEnd - 2 > iOffset )
+          {
+             m_uSizeCurrentFrame += (u32)(iNextStartCodeEnd - 2 - iOffset);
+             iOffset = iNextStartCodeEnd - 2;
+          }
+       }
+
+       m_uStateCurrentToken = (m_uStateCurrentToken<<8) | pData[iOffset];
+       iOffset++;
        m_uSizeCurrentFrame++;
 
        if ( (m_uStateCurrentToken & 0xFFFFFF00) != 0x0100 )
@@ -87,6 +144,23 @@ bool ParserH264::parseData(u8* pData, int iDataLength, u32 uTimeNowMs)
 
        m_uCurrentNALUType = m_uStateCurrentToken & 0b11111;
 
+       // A NAL boundary is where a slice or a non VCL unit (SEI, SPS, PPS, AUD) follows a slice.
+       // Non VCL units are kept together with the slice that follows them.
+       // Start code might have begun in the previous buffer, then the boundary offset is negative (-1 to -3).
+
+       bool bPrevIsSlice = (m_uPrevNALUType == 1) || (m_uPrevNALUType == 5);
+       m_uPrevNALUType = m_uCurrentNALUType;
+       int iBoundaryIndex = -1;
+       if ( bPrevIsSlice && (m_iNALBoundariesCount < MAX_PARSER_NAL_BOUNDARIES) )
+       if ( (m_uCurrentNALUType == 1) || (m_uCurrentNALUType == 5) || ((m_uCurrentNALUType >= 6) && (m_uCurrentNALUType <= 9)) )
+       {
+          iBoundaryIndex = m_iNALBoundariesCount;
+          m_iNALBoundariesOffsets[iBoundaryIndex] = iOffset - 4;
+          // Non VCL units after a slice always start a new access unit (frame)
+          m_bNALBoundariesIsFrameStart[iBoundaryIndex] = (m_uCurrentNALUType >= 6);
+          m_iNALBoundariesCount++;
+       }
+
        // P-frame is 1, I-frame is 5
        if ( (m_uCurrentNALUType != 1) && (m_uCurrentNALUType != 5) )
           continue;
@@ -110,33 +184,20 @@ bool ParserH264::parseData(u8* pData, int iDataLength, u32 uTimeNowMs)
        else
           m_bStateIsInsideIFrame = false;
 
+       // nal_ref_idc is zero for non reference slices
+       if ( 0 == ((m_uStateCurrentToken >> 5) & 0x03) )
+          m_bStateIsInsideNonRefFrame = true;
+       else
+          m_bStateIsInsideNonRefFrame = false;
+
        // P or I frame just started. Compute info
 
        if ( 0 == m_iStateCurrentParsedSlices )
        {
           bFoundFrameStart = true;
-          
-          m_uDebugFramesCounter++;
-          if ( uTimeNowMs >= m_uDebugTimeStartFramesCounter + 5000 )
-          {
-             m_uDebugTimeStartFramesCounter = uTimeNowMs;
-             m_uDebugDetectedFPS = m_uDebugFramesCounter/5;
-             m_uDebugFramesCounter = 0;
-          }
-          m_uLastFrameType = m_uCurrentFrameType;
-          m_uCurrentFrameType = m_uCurrentNALUType;
-          m_uTimeDurationOfLastFrame = uTimeNowMs - m_uTimeStartOfCurrentFrame;
-          m_uTimeStartOfCurrentFrame = uTimeNowMs;
-          m_uFramesSinceLastKeyframe++;
-          m_uSizeLastFrame = m_uSizeCurrentFrame;
-          m_uSizeCurrentFrame = 0;
-
-          if ( m_uCurrentNALUType == 5 )
-          {
-             m_uCurrentDetectedKeyframeIntervalMs = uTimeNowMs - m_uTimeLastStartOfIFrame;
-             m_uTimeLastStartOfIFrame = uTimeNowMs;
-             m_uFramesSinceLastKeyframe = 0;
-          }
+          if ( -1 != iBoundaryIndex )
+             m_bNALBoundariesIsFrameStart[iBoundaryIndex] = true;
+          onNewFrameStart(m_uCurrentNALUType, (m_uCurrentNALUType == 5), uTimeNowMs);
        }
 
        m_iStateCurrentParsedSlices++;
@@ -191,6 +252,11 @@ bool ParserH264::IsInsideIFrame()
    return m_bStateIsInsideIFrame;
 }
 
+bool ParserH264::IsInsideNonReferenceFrame()
+{
+   return m_bStateIsInsideNonRefFrame;
+}
+
 u32 ParserH264::getFramesSinceLastKeyframe()
 {
    return m_uFramesSinceLastKeyframe;
@@ -199,4 +265,28 @@ u32 ParserH264::getFramesSinceLastKeyframe()
 u32 ParserH264::getDetectedFPS()
 {
    return m_uDebugDetectedFPS;
-}
\ No newline at end of file
+}
+
+int ParserH264::getLastParsedNALBoundariesCount()
+{
+   return m_iNALBoundariesCount;
+}
+
+int ParserH264::getLastParsedNALBoundaryOffset(int iIndex)
+{
+   if ( (iIndex < 0) || (iIndex >= m_iNALBoundariesCount) )
+      return 0;
+   return m_iNALBoundariesOffsets[iIndex];
+}
+
+bool ParserH264::isLastParsedNALBoundaryFrameStart(int iIndex)
+{
+   if ( (iIndex < 0) || (iIndex >= m_iNALBoundariesCount) )
+      return false;
+   return m_bNALBoundariesIsFrameStart[iIndex];
+}
+
+int ParserH264::getLastParsedCarriedBoundaryBytes()
+{
+   return m_iCarriedBoundaryBytes;
+}
@@ -1,16 +1,21 @@
 #pragma once
 #include "base.h"
 
+// Max NAL units boundaries recorded for one parsed input buffer
+#define MAX_PARSER_NAL_BOUNDARIES 64
+// Max bytes at the end of a buffer that can belong to a boundary reported with the next buffer
+#define MAX_PARSER_CARRIED_BOUNDARY_BYTES 8
+
 class ParserH264
 {
    public:
       ParserH264();
       virtual ~ParserH264();
       
-      void init(int iExpectedISlices);
+      virtual void init(int iExpectedISlices);
 
       // Returns true if an start of a new frame was found
-      bool parseData(u8* pData, int iDataLength, u32 uTimeNowMs);
+      virtual bool parseData(u8* pData, int iDataLength, u32 uTimeNowMs);
 
       u32 getStartTimeOfCurrentFrame();
       u32 getCurrentFrameType();
@@ -20,15 +25,32 @@ class ParserH264
       int getDetectedSlices();
       u32 getCurrentlyDetectedKeyframeIntervalMs();
       bool IsInsideIFrame();
+      // True for frames not used as reference by other frames (can be lost without affecting other frames)
+      bool IsInsideNonReferenceFrame();
       u32 getFramesSinceLastKeyframe();
       u32 getDetectedFPS();
 
+      // NAL units boundaries found in the last buffer passed to parseData
+      // Offsets are relative to the start of that buffer and point to the start code (00 00 01).
+      // An offset is negative (-1 to -3) if the start code began in the previous buffer, or down to
+      // -MAX_PARSER_CARRIED_BOUNDARY_BYTES for a boundary carried from the previous buffer (see below).
+      int getLastParsedNALBoundariesCount();
+      int getLastParsedNALBoundaryOffset(int iIndex);
+      bool isLastParsedNALBoundaryFrameStart(int iIndex);
+      // Bytes at the end of the last buffer that start a NAL unit whose boundary type is not known yet
+      // (not enough bytes parsed). Its boundary is reported with the next buffer, at a negative offset.
+      int getLastParsedCarriedBoundaryBytes();
+
    protected:
+      static int findNextStartCodeEnd(u8* pData, int iOffset, int iDataLength);
+      void onNewFrameStart(u32 uFrameType, bool bIsKeyframe, u32 uTimeNowMs);
+
       int m_iExpectedISlices;
       int m_iDetectedISlices;
       int m_iStateCurrentParsedSlices;
       u32 m_uStateCurrentToken;
       bool m_bStateIsInsideIFrame;
+      bool m_bStateIsInsideNonRefFrame;
       u32 m_uCurrentNALUType;
       u32 m_uLastNALUType;
       u32 m_uConsecutiveNALUs;
@@ -41,6 +63,12 @@ class ParserH264
       u32 m_uSizeLastFrame;
       u32 m_uCurrentDetectedKeyframeIntervalMs;
       u32 m_uFramesSinceLastKeyframe;
+      u32 m_uPrevNALUType;
+
+      int m_iNALBoundariesCount;
+      int m_iNALBoundariesOffsets[MAX_PARSER_NAL_BOUNDARIES];
+      bool m_bNALBoundariesIsFrameStart[MAX_PARSER_NAL_BOUNDARIES];
+      int m_iCarriedBoundaryBytes;
 
       u32 m_uDebugFramesCounter;
       u32 m_uDebugTimeStartFramesCounter;
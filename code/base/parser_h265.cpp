@@ -0,0 +1,181 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "base.h"
+#include "parser_h265.h"
+
+
+
+// H265 NAL unit types used by the parser
+#define H265_NAL_TYPE_MAX_VCL 31
+#define H265_NAL_TYPE_IRAP_FIRST 16 // BLA, IDR, CRA
+#define H265_NAL_TYPE_IRAP_LAST 23
+#define H265_NAL_TYPE_VPS 32
+#define H265_NAL_TYPE_AUD 35
+#define H265_NAL_TYPE_PREFIX_SEI 39
+
+
+ParserH265::ParserH265()
+{
+   init(1);
+}
+
+ParserH265::~ParserH265()
+{
+}
+
+void ParserH265::init(int iExpectedISlices)
+{
+   ParserH264::init(iExpectedISlices);
+   m_uPrevNALUType = MAX_U32;
+   m_iPendingSliceHeaderBytes = 0;
+   m_iPendingSliceBoundaryIndex = -1;
+   m_iSlicesInCurrentFrame = 0;
+}
+
+// Returns true if an start of a new frame was found
+bool ParserH265::parseData(u8* pData, int iDataLength, u32 uTimeNowMs)
+{
+   m_iNALBoundariesCount = 0;
+   if ( (NULL == pData) || (iDataLength <= 0) )
+      return false;
+
+   // A slice boundary whose slice header was not parsed yet in the previous buffer is reported with this buffer
+   m_iPendingSliceBoundaryIndex = -1;
+   if ( m_iCarriedBoundaryBytes > 0 )
+   {
+      m_iNALBoundariesOffsets[0] = -m_iCarriedBoundaryBytes;
+      m_bNALBoundariesIsFrameStart[0] = false;
+      m_iNALBoundariesCount = 1;
+      if ( m_iPendingSliceHeaderBytes > 0 )
+         m_iPendingSliceBoundaryIndex = 0;
+      m_iCarriedBoundaryBytes = 0;
+   }
+
+   bool bFoundFrameStart = false;
+   int iOffset = 0;
+   int iNextStartCodeEnd = -1;
+
+   while ( iOffset < iDataLength )
+   {
+       // Skip directly to two bytes before the next 0x01 byte, as the start code check
+       // needs only the two zero bytes before it. Do not skip the NAL header or the slice header start.
+       if ( (iOffset > iNextStartCodeEnd) && (0 == m_iPendingSliceHeaderBytes) && ((m_uStateCurrentToken & 0xFF) != 0x01) )
+       {
+          iNextStartCodeEnd = findNextStartCodeEnd(pData, iOffset, iDataLength);
+          if ( iNextStartCodeEnd - 2 > iOffset )
+          {
+             m_uSizeCurrentFrame += (u32)(iNextStartCodeEnd - 2 - iOffset);
+             iOffset = iNextStartCodeEnd - 2;
+          }
+       }
+
+       m_uStateCurrentToken = (m_uStateCurrentToken<<8) | pData[iOffset];
+       iOffset++;
+       m_uSizeCurrentFrame++;
+
+       // H265 NAL header is two bytes. First byte of slice header after it has the first_slice_segment_in_pic_flag as MSB
+       if ( m_iPendingSliceHeaderBytes > 0 )
+       {
+          m_iPendingSliceHeaderBytes--;
+          if ( 0 != m_iPendingSliceHeaderBytes )
+             continue;
+          if ( ! (m_uStateCurrentToken & 0x80) )
+          {
+             m_iSlicesInCurrentFrame++;
+             continue;
+          }
+
+          // First slice of a new frame
+
+          // Slices count is detected on keyframes, as for H264
+          if ( m_bStateIsInsideIFrame && (m_iSlicesInCurrentFrame > 0) )
+             m_iDetectedISlices = m_iSlicesInCurrentFrame;
+          m_iSlicesInCurrentFrame = 1;
+
+          bool bIsKeyframe = (m_uCurrentNALUType >= H265_NAL_TYPE_IRAP_FIRST) && (m_uCurrentNALUType <= H265_NAL_TYPE_IRAP_LAST);
+          m_bStateIsInsideIFrame = bIsKeyframe;
+          // Sub-layer non reference pictures have even NAL types up to RSV_VCL_N14
+          m_bStateIsInsideNonRefFrame = (m_uCurrentNALUType <= 14) && (0 == (m_uCurrentNALUType & 0x01));
+
+          bFoundFrameStart = true;
+          if ( -1 != m_iPendingSliceBoundaryIndex )
+             m_bNALBoundariesIsFrameStart[m_iPendingSliceBoundaryIndex] = true;
+          m_iPendingSliceBoundaryIndex = -1;
+          onNewFrameStart(m_uCurrentNALUType, bIsKeyframe, uTimeNowMs);
+          continue;
+       }
+
+       if ( (m_uStateCurrentToken & 0xFFFFFF00) != 0x0100 )
+          continue;
+
+       m_uCurrentNALUType = (m_uStateCurrentToken >> 1) & 0x3F;
+
+       // Same boundaries rule as for H264: a slice or a prefix non VCL unit (VPS, SPS, PPS, AUD, prefix SEI)
+       // following a slice. Suffix SEI stays with the slice before it.
+
+       bool bPrevIsSlice = (m_uPrevNALUType <= H265_NAL_TYPE_MAX_VCL);
+       m_uPrevNALUType = m_uCurrentNALUType;
+       int iBoundaryIndex = -1;
+       if ( bPrevIsSlice && (m_iNALBoundariesCount < MAX_PARSER_NAL_BOUNDARIES) )
+       if ( (m_uCurrentNALUType <= H265_NAL_TYPE_MAX_VCL) ||
+            ((m_uCurrentNALUType >= H265_NAL_TYPE_VPS) && (m_uCurrentNALUType <= H265_NAL_TYPE_AUD)) ||
+            (m_uCurrentNALUType == H265_NAL_TYPE_PREFIX_SEI) )
+       {
+          iBoundaryIndex = m_iNALBoundariesCount;
+          m_iNALBoundariesOffsets[iBoundaryIndex] = iOffset - 4;
+          m_bNALBoundariesIsFrameStart[iBoundaryIndex] = (m_uCurrentNALUType > H265_NAL_TYPE_MAX_VCL);
+          m_iNALBoundariesCount++;
+       }
+
+       // The slice boundary (if any) is a frame start only if the slice header says so
+       if ( m_uCurrentNALUType <= H265_NAL_TYPE_MAX_VCL )
+       {
+          m_iPendingSliceHeaderBytes = 2;
+          m_iPendingSliceBoundaryIndex = iBoundaryIndex;
+       }
+   }
+
+   // The slice header of the last boundary is in the next buffer: report that boundary with the next buffer.
+   // It is always the last one found, as the slice header comes right after the start code.
+   if ( (m_iPendingSliceHeaderBytes > 0) && (-1 != m_iPendingSliceBoundaryIndex) )
+   {
+      int iBytes = iDataLength - m_iNALBoundariesOffsets[m_iPendingSliceBoundaryIndex];
+      if ( iBytes <= MAX_PARSER_CARRIED_BOUNDARY_BYTES )
+      {
+         m_iCarriedBoundaryBytes = iBytes;
+         m_iNALBoundariesCount--;
+      }
+      m_iPendingSliceBoundaryIndex = -1;
+   }
+
+   return bFoundFrameStart;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "base.h"
+#include "parser_h264.h"
+
+// Same frames stats and NAL boundaries as ParserH264, for H265 (HEVC) streams.
+// Frame starts are detected using the first_slice_segment_in_pic_flag of each slice.
+// Keyframes are the IRAP frames (IDR, CRA, BLA).
+
+class ParserH265: public ParserH264
+{
+   public:
+      ParserH265();
+      virtual ~ParserH265();
+
+      virtual void init(int iExpectedISlices);
+
+      // Returns true if an start of a new frame was found
+      virtual bool parseData(u8* pData, int iDataLength, u32 uTimeNowMs);
+
+   protected:
+      int m_iPendingSliceHeaderBytes;
+      int m_iPendingSliceBoundaryIndex;
+      int m_iSlicesInCurrentFrame;
+};
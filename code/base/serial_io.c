@@ -0,0 +1,367 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <fcntl.h>
+#include <termios.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+
+#include "serial_io.h"
+
+typedef struct
+{
+   int iFD;
+   char szName[64];
+   u8 uRingBuffer[SERIAL_IO_RING_BUFFER_SIZE];
+   int iReadPos;
+   int iWritePos;
+   int iBufferedBytes;
+   int iHungUp;
+   int iIsTTY;
+   type_serial_io_port_stats stats;
+} type_serial_io_port;
+
+static int s_iSerialIOEpollFD = -1;
+static type_serial_io_port s_SerialIOPorts[SERIAL_IO_MAX_PORTS];
+static u32 s_uSerialIOTimeLastStatsUpdate = 0;
+
+int serial_io_init()
+{
+   if ( -1 != s_iSerialIOEpollFD )
+      return 1;
+   for( int i=0; i<SERIAL_IO_MAX_PORTS; i++ )
+   {
+      memset(&s_SerialIOPorts[i], 0, sizeof(type_serial_io_port));
+      s_SerialIOPorts[i].iFD = -1;
+   }
+   s_iSerialIOEpollFD = epoll_create1(EPOLL_CLOEXEC);
+   if ( -1 == s_iSerialIOEpollFD )
+   {
+      log_error_and_alarm("[SerialIO] Failed to create epoll, error: %d (%s)", errno, strerror(errno));
+      return 0;
+   }
+   log_line("[SerialIO] Init done.");
+   return 1;
+}
+
+void serial_io_uninit()
+{
+   for( int i=0; i<SERIAL_IO_MAX_PORTS; i++ )
+   {
+      if ( -1 != s_SerialIOPorts[i].iFD )
+         serial_io_remove_port(i);
+   }
+   if ( -1 != s_iSerialIOEpollFD )
+      close(s_iSerialIOEpollFD);
+   s_iSerialIOEpollFD = -1;
+}
+
+static void _serial_io_set_low_latency(int iFD, const char* szName)
+{
+   struct termios options;
+   if ( 0 == tcgetattr(iFD, &options) )
+   {
+      options.c_cc[VMIN] = 0;
+      options.c_cc[VTIME] = 0;
+      tcsetattr(iFD, TCSANOW, &options);
+   }
+
+   int iFlags = fcntl(iFD, F_GETFL, 0);
+   if ( iFlags != -1 )
+      fcntl(iFD, F_SETFL, iFlags | O_NONBLOCK);
+
+   // Not supported by all serial drivers (it's fine if it fails)
+   struct serial_struct serialInfo;
+   if ( 0 == ioctl(iFD, TIOCGSERIAL, &serialInfo) )
+   {
+      serialInfo.flags |= ASYNC_LOW_LATENCY;
+      if ( 0 == ioctl(iFD, TIOCSSERIAL, &serialInfo) )
+         log_line("[SerialIO] Set low latency mode on serial port %s", szName);
+   }
+}
+
+int serial_io_add_port(int iFD, const char* szName)
+{
+   if ( iFD < 0 )
+      return -1;
+   if ( (-1 == s_iSerialIOEpollFD) && (! serial_io_init()) )
+      return -1;
+
+   int iPortId = -1;
+   for( int i=0; i<SERIAL_IO_MAX_PORTS; i++ )
+   {
+      if ( -1 == s_SerialIOPorts[i].iFD )
+      {
+         iPortId = i;
+         break;
+      }
+   }
+   if ( -1 == iPortId )
+   {
+      log_softerror_and_alarm("[SerialIO] No more room to add serial port %s", (NULL != szName)?szName:"N/A");
+      return -1;
+   }
+
+   type_serial_io_port* pPort = &s_SerialIOPorts[iPortId];
+   memset(pPort, 0, sizeof(type_serial_io_port));
+   pPort->iFD = iFD;
+   if ( NULL != szName )
+      strncpy(pPort->szName, szName, sizeof(pPort->szName)-1);
+
+   pPort->iIsTTY = isatty(iFD)?1:0;
+   if ( pPort->iIsTTY )
+      _serial_io_set_low_latency(iFD, pPort->szName);
+
+   struct epoll_event ev;
+   memset(&ev, 0, sizeof(ev));
+   ev.events = EPOLLIN;
+   ev.data.u32 = (u32)iPortId;
+   if ( 0 != epoll_ctl(s_iSerialIOEpollFD, EPOLL_CTL_ADD, iFD, &ev) )
+   {
+      log_softerror_and_alarm("[SerialIO] Failed to add serial port %s (fd %d) to epoll, error: %d (%s)", pPort->szName, iFD, errno, strerror(errno));
+      pPort->iFD = -1;
+      return -1;
+   }
+   log_line("[SerialIO] Added serial port %s (fd %d), port id: %d", pPort->szName, iFD, iPortId);
+   return iPortId;
+}
+
+void serial_io_remove_port(int iPortId)
+{
+   if ( (iPortId < 0) || (iPortId >= SERIAL_IO_MAX_PORTS) )
+      return;
+   type_serial_io_port* pPort = &s_SerialIOPorts[iPortId];
+   if ( -1 == pPort->iFD )
+      return;
+   if ( -1 != s_iSerialIOEpollFD )
+      epoll_ctl(s_iSerialIOEpollFD, EPOLL_CTL_DEL, pPort->iFD, NULL);
+   log_line("[SerialIO] Removed serial port %s (fd %d), port id: %d", pPort->szName, pPort->iFD, iPortId);
+   pPort->iFD = -1;
+   pPort->iHungUp = 0;
+   pPort->iBufferedBytes = 0;
+   pPort->iReadPos = 0;
+   pPort->iWritePos = 0;
+}
+
+int serial_io_get_port_fd(int iPortId)
+{
+   if ( (iPortId < 0) || (iPortId >= SERIAL_IO_MAX_PORTS) )
+      return -1;
+   return s_SerialIOPorts[iPortId].iFD;
+}
+
+int serial_io_is_port_hung_up(int iPortId)
+{
+   if ( (iPortId < 0) || (iPortId >= SERIAL_IO_MAX_PORTS) )
+      return 0;
+   return s_SerialIOPorts[iPortId].iHungUp;
+}
+
+// The port is taken out of the wait, as a hung up fd is always ready and would wake up the wait right away.
+// The owner of the fd closes it and opens the port again.
+static void _serial_io_set_port_hung_up(type_serial_io_port* pPort)
+{
+   if ( pPort->iHungUp )
+      return;
+   pPort->iHungUp = 1;
+   if ( -1 != s_iSerialIOEpollFD )
+      epoll_ctl(s_iSerialIOEpollFD, EPOLL_CTL_DEL, pPort->iFD, NULL);
+   log_softerror_and_alarm("[SerialIO] Serial port %s (fd %d) hung up or failed.", pPort->szName, pPort->iFD);
+}
+
+// Reads all the available data from the port into the ring buffer.
+// bHangUpReported: the wait reported a hang up or an error on the port.
+static int _serial_io_drain_port(type_serial_io_port* pPort, int bHangUpReported)
+{
+   int iTotalRead = 0;
+   u8 uTmp[1024];
+   while ( 1 )
+   {
+      int iRead = read(pPort->iFD, uTmp, sizeof(uTmp));
+      // A tty set to VMIN = VTIME = 0 returns 0 (not EAGAIN) when there is no data, so for a tty
+      // it's the end of file only if the wait reported a hang up. For pipes and files it's the end of file.
+      if ( 0 == iRead )
+      {
+         if ( bHangUpReported || (! pPort->iIsTTY) )
+            _serial_io_set_port_hung_up(pPort);
+         break;
+      }
+      if ( iRead < 0 )
+      {
+         if ( (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR) )
+            _serial_io_set_port_hung_up(pPort);
+         break;
+      }
+      pPort->stats.uTotalReads++;
+      pPort->stats.uTotalBytesRead += iRead;
+      pPort->stats.uTmpBytesLastSecond += iRead;
+      iTotalRead += iRead;
+
+      // Keep the newest data if the buffer is full
+      int iFree = SERIAL_IO_RING_BUFFER_SIZE - pPort->iBufferedBytes;
+      if ( iRead > iFree )
+      {
+         int iDrop = iRead - iFree;
+         if ( iDrop > pPort->iBufferedBytes )
+            iDrop = pPort->iBufferedBytes;
+         pPort->iReadPos = (pPort->iReadPos + iDrop) % SERIAL_IO_RING_BUFFER_SIZE;
+         pPort->iBufferedBytes -= iDrop;
+         pPort->stats.uTotalOverflowBytes += iDrop;
+         pPort->stats.uOverflowsCount++;
+      }
+      u8* pData = uTmp;
+      if ( iRead > SERIAL_IO_RING_BUFFER_SIZE )
+      {
+         pPort->stats.uTotalOverflowBytes += iRead - SERIAL_IO_RING_BUFFER_SIZE;
+         pData += iRead - SERIAL_IO_RING_BUFFER_SIZE;
+         iRead = SERIAL_IO_RING_BUFFER_SIZE;
+      }
+      int iFirst = SERIAL_IO_RING_BUFFER_SIZE - pPort->iWritePos;
+      if ( iFirst > iRead )
+         iFirst = iRead;
+      memcpy(&pPort->uRingBuffer[pPort->iWritePos], pData, iFirst);
+      if ( iRead > iFirst )
+         memcpy(&pPort->uRingBuffer[0], pData + iFirst, iRead - iFirst);
+      pPort->iWritePos = (pPort->iWritePos + iRead) % SERIAL_IO_RING_BUFFER_SIZE;
+      pPort->iBufferedBytes += iRead;
+      if ( (u32)pPort->iBufferedBytes > pPort->stats.uMaxBufferedBytes )
+         pPort->stats.uMaxBufferedBytes = (u32)pPort->iBufferedBytes;
+
+      if ( iRead < (int)sizeof(uTmp) )
+         break;
+   }
+   return iTotalRead;
+}
+
+int serial_io_wait_and_read(int iTimeoutMs)
+{
+   if ( -1 == s_iSerialIOEpollFD )
+      return -1;
+
+   struct epoll_event events[SERIAL_IO_MAX_PORTS];
+   int iCount = epoll_wait(s_iSerialIOEpollFD, events, SERIAL_IO_MAX_PORTS, iTimeoutMs);
+   if ( iCount < 0 )
+   {
+      if ( errno == EINTR )
+         return 0;
+      log_softerror_and_alarm("[SerialIO] Failed to wait for serial data, error: %d (%s)", errno, strerror(errno));
+      return -1;
+   }
+
+   int iPortsWithData = 0;
+   for( int i=0; i<iCount; i++ )
+   {
+      u32 uPortId = events[i].data.u32;
+      if ( uPortId >= SERIAL_IO_MAX_PORTS )
+         continue;
+      type_serial_io_port* pPort = &s_SerialIOPorts[uPortId];
+      if ( (-1 == pPort->iFD) || pPort->iHungUp )
+         continue;
+      pPort->stats.uTotalWakeups++;
+      if ( _serial_io_drain_port(pPort, (events[i].events & (EPOLLHUP | EPOLLERR))?1:0) > 0 )
+         iPortsWithData++;
+      if ( events[i].events & (EPOLLHUP | EPOLLERR) )
+         _serial_io_set_port_hung_up(pPort);
+   }
+   // Woken up with no data: let the caller sleep, so it does not spin
+   if ( (iCount > 0) && (0 == iPortsWithData) )
+      return -1;
+   return iPortsWithData;
+}
+
+int serial_io_get_buffered_bytes(int iPortId)
+{
+   if ( (iPortId < 0) || (iPortId >= SERIAL_IO_MAX_PORTS) )
+      return 0;
+   return s_SerialIOPorts[iPortId].iBufferedBytes;
+}
+
+int serial_io_read(int iPortId, u8* pBuffer, int iMaxLength)
+{
+   if ( (iPortId < 0) || (iPortId >= SERIAL_IO_MAX_PORTS) || (NULL == pBuffer) || (iMaxLength <= 0) )
+      return 0;
+   type_serial_io_port* pPort = &s_SerialIOPorts[iPortId];
+   int iLength = pPort->iBufferedBytes;
+   if ( iLength > iMaxLength )
+      iLength = iMaxLength;
+   if ( 0 == iLength )
+      return 0;
+
+   int iFirst = SERIAL_IO_RING_BUFFER_SIZE - pPort->iReadPos;
+   if ( iFirst > iLength )
+      iFirst = iLength;
+   memcpy(pBuffer, &pPort->uRingBuffer[pPort->iReadPos], iFirst);
+   if ( iLength > iFirst )
+      memcpy(pBuffer + iFirst, &pPort->uRingBuffer[0], iLength - iFirst);
+   pPort->iReadPos = (pPort->iReadPos + iLength) % SERIAL_IO_RING_BUFFER_SIZE;
+   pPort->iBufferedBytes -= iLength;
+   return iLength;
+}
+
+void serial_io_update_stats(u32 uTimeNow)
+{
+   if ( uTimeNow < s_uSerialIOTimeLastStatsUpdate + 1000 )
+      return;
+   u32 uDeltaTime = uTimeNow - s_uSerialIOTimeLastStatsUpdate;
+   s_uSerialIOTimeLastStatsUpdate = uTimeNow;
+   for( int i=0; i<SERIAL_IO_MAX_PORTS; i++ )
+   {
+      type_serial_io_port_stats* pStats = &s_SerialIOPorts[i].stats;
+      if ( uDeltaTime < 5000 )
+         pStats->uBytesPerSecond = (pStats->uTmpBytesLastSecond * 1000) / uDeltaTime;
+      else
+         pStats->uBytesPerSecond = 0;
+      pStats->uTmpBytesLastSecond = 0;
+   }
+}
+
+type_serial_io_port_stats* serial_io_get_port_stats(int iPortId)
+{
+   if ( (iPortId < 0) || (iPortId >= SERIAL_IO_MAX_PORTS) )
+      return NULL;
+   return &s_SerialIOPorts[iPortId].stats;
+}
+
+void serial_io_log_stats()
+{
+   for( int i=0; i<SERIAL_IO_MAX_PORTS; i++ )
+   {
+      type_serial_io_port* pPort = &s_SerialIOPorts[i];
+      if ( -1 == pPort->iFD )
+         continue;
+      log_line("[SerialIO] Port %s: %u bytes/sec, total read: %u bytes in %u reads, %u wakeups, max buffered: %u bytes, overflows: %u (%u bytes lost)",
+         pPort->szName, pPort->stats.uBytesPerSecond, pPort->stats.uTotalBytesRead, pPort->stats.uTotalReads,
+         pPort->stats.uTotalWakeups, pPort->stats.uMaxBufferedBytes, pPort->stats.uOverflowsCount, pPort->stats.uTotalOverflowBytes);
+   }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "base.h"
+
+// Event driven reads from serial ports: all the registered ports are waited on with a single epoll,
+// so one wakeup serves a burst of data on any port. Ready ports are drained (non blocking reads until empty)
+// into a ring buffer per port; the caller then consumes the buffered data.
+// Ports are set to non blocking raw reads (VMIN = VTIME = 0) and the low latency serial flag, if the driver supports it.
+
+#define SERIAL_IO_MAX_PORTS 4
+#define SERIAL_IO_RING_BUFFER_SIZE 8192
+
+typedef struct
+{
+   u32 uTotalBytesRead;
+   u32 uTotalReads;
+   u32 uTotalWakeups; // Times the port had data when the wait returned
+   u32 uTotalOverflowBytes; // Bytes lost because the ring buffer was full
+   u32 uOverflowsCount;
+   u32 uBytesPerSecond; // Computed over the last second
+   u32 uMaxBufferedBytes;
+   u32 uTmpBytesLastSecond;
+} type_serial_io_port_stats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int serial_io_init();
+void serial_io_uninit();
+
+// Returns the port id, or -1 on failure
+int serial_io_add_port(int iFD, const char* szName);
+void serial_io_remove_port(int iPortId);
+int serial_io_get_port_fd(int iPortId);
+// The port hung up (device unplugged, pipe closed) or failed and it's no longer waited on.
+// The caller removes the port, closes the fd and opens the port again.
+int serial_io_is_port_hung_up(int iPortId);
+
+// Waits up to iTimeoutMs for data on any port (0: don't wait) and reads all the available data from the ready ports.
+// Returns the number of ports that got new data, 0 on timeout, -1 on error or if the wait returned with no new data
+// (the caller sleeps then).
+int serial_io_wait_and_read(int iTimeoutMs);
+
+int serial_io_get_buffered_bytes(int iPortId);
+// Returns the number of bytes copied from the port ring buffer
+int serial_io_read(int iPortId, u8* pBuffer, int iMaxLength);
+
+// Call about once a second to update the per port rates
+void serial_io_update_stats(u32 uTimeNow);
+type_serial_io_port_stats* serial_io_get_port_stats(int iPortId);
+void serial_io_log_stats();
+
+#ifdef __cplusplus
+}  
+#endif
@@ -262,6 +262,24 @@ void shared_mem_video_link_graphs_close(shared_mem_video_link_graphs* pAddress)
       munmap(pAddress, sizeof(shared_mem_video_link_graphs));
 }
 
+shared_mem_video_player_stats* shared_mem_video_player_stats_open_for_read()
+{
+   void *retVal = open_shared_mem_for_read(SHARED_MEM_VIDEO_PLAYER_STATS, sizeof(shared_mem_video_player_stats));
+   return (shared_mem_video_player_stats*)retVal;
+}
+
+shared_mem_video_player_stats* shared_mem_video_player_stats_open_for_write()
+{
+   void *retVal = open_shared_mem_for_write(SHARED_MEM_VIDEO_PLAYER_STATS, sizeof(shared_mem_video_player_stats));
+   return (shared_mem_video_player_stats*)retVal;
+}
+
+void shared_mem_video_player_stats_close(shared_mem_video_player_stats* pAddress)
+{
+   if ( NULL != pAddress )
+      munmap(pAddress, sizeof(shared_mem_video_player_stats));
+}
+
 
 t_packet_header_rc_info_downstream* shared_mem_rc_downstream_info_open_read()
 {
@@ -17,6 +17,7 @@
 #define SHARED_MEM_VIDEO_STREAM_INFO_STATS_RADIO_OUT "/SYSTEM_SHARED_MEM_STATION_VIDEO_STREAM_INFO_RADIO_OUT"
 #define SHARED_MEM_VIDEO_LINK_STATS "/SYSTEM_SHARED_MEM_STATION_VIDEO_LINK_STATS"
 #define SHARED_MEM_VIDEO_LINK_GRAPHS "/SYSTEM_SHARED_MEM_STATION_VIDEO_LINK_GRAPHS"
+#define SHARED_MEM_VIDEO_PLAYER_STATS "/SYSTEM_SHARED_MEM_STATION_VIDEO_PLAYER_STATS"
 #define SHARED_MEM_RC_DOWNLOAD_INFO "R_SHARED_MEM_VEHICLE_RC_DOWNLOAD_INFO"
 #define SHARED_MEM_RC_UPSTREAM_FRAME "R_SHARED_MEM_RC_UPSTREAM_FRAME"
 
@@ -198,6 +199,26 @@ typedef struct
    
 } __attribute__((packed)) shared_mem_video_info_stats;
 
+// Written by the video player (Radxa), once a second
+// Frame age: time from the video data being fed to the decoder to the decoded frame being on screen (page flip done)
+
+typedef struct
+{
+   u32 uTimeLastUpdate;
+   u8 uLowestLatencyMode; // 1: newest decoded frame is shown at next vblank, 0: frames are paced on their timestamps
+   u32 uFramesDecoded; // in the last interval
+   u32 uFramesDisplayed;
+   u32 uFramesDropped;
+   u32 uFrameAgeMinMicros;
+   u32 uFrameAgeAvgMicros;
+   u32 uFrameAgeMaxMicros;
+   u32 uDecodeTimeAvgMicros;
+   u32 uPlayoutDelayMicros; // Current delay added to the frames timestamps when pacing
+   u32 uMaxDisplayIntervalErrorMicros; // Max difference between displayed frames intervals and their timestamps intervals (judder)
+   u32 uTotalFramesDisplayed;
+   u32 uTotalFramesDropped;
+} __attribute__((packed)) shared_mem_video_player_stats;
+
 #define MAX_RADIO_TX_TIMES_HISTORY_INTERVALS 50
 
 typedef struct
@@ -263,6 +284,10 @@ shared_mem_video_link_graphs* shared_mem_video_link_graphs_open_for_read();
 shared_mem_video_link_graphs* shared_mem_video_link_graphs_open_for_write();
 void shared_mem_video_link_graphs_close(shared_mem_video_link_graphs* pAddress);
 
+shared_mem_video_player_stats* shared_mem_video_player_stats_open_for_read();
+shared_mem_video_player_stats* shared_mem_video_player_stats_open_for_write();
+void shared_mem_video_player_stats_close(shared_mem_video_player_stats* pAddress);
+
 t_packet_header_rc_info_downstream* shared_mem_rc_downstream_info_open_read();
 t_packet_header_rc_info_downstream* shared_mem_rc_downstream_info_open_write();
 void shared_mem_rc_downstream_info_close(t_packet_header_rc_info_downstream* pRCInfo);
@@ -88,6 +88,8 @@ typedef struct
    u32 total_DiscardedLostPackets;
    u32 total_DiscardedBuffers;
    u32 total_DiscardedSegments;
+   u32 total_OutputFramesComplete; // Only for NAL aligned video streams
+   u32 total_OutputFramesDamaged;  // Only for NAL aligned video streams
 
    int currentPacketsInBuffers;
    int maxPacketsInBuffers;
@@ -235,7 +237,7 @@ typedef struct
 
    u32 uIntervalsAdaptive1;
    u32 uIntervalsAdaptive2;
-   u32 uIntervalsAdaptive3;
+   u32 uIntervalsAdaptive3; // Predictive algorithm: predicted loss (per mille) in the low 16 bits, target level in the high 16 bits
 
    int iCurrentTargetLevelShift;
    int iLastRequestedLevelShiftRetryCount;
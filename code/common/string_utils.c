@@ -256,7 +256,9 @@ char* str_get_packet_type(int iPacketType)
       case PACKET_TYPE_RUBY_PAIRING_REQUEST:     strcpy(s_szPacketType, "PACKET_TYPE_RUBY_PAIRING_REQUEST"); break;
       case PACKET_TYPE_RUBY_PAIRING_CONFIRMATION: strcpy(s_szPacketType, "PACKET_TYPE_RUBY_PAIRING_CONFIRMATION"); break;
       case PACKET_TYPE_RUBY_RADIO_CONFIG_UPDATED: strcpy(s_szPacketType, "PACKET_TYPE_RUBY_RADIO_CONFIG_UPDATED"); break;
+      case PACKET_TYPE_RUBY_MODEL_SECTION:       strcpy(s_szPacketType, "PACKET_TYPE_RUBY_MODEL_SECTION"); break;
       case PACKET_TYPE_RUBY_LOG_FILE_SEGMENT:    strcpy(s_szPacketType, "PACKET_TYPE_RUBY_LOG_FILE_SEGMENT"); break;
+      case PACKET_TYPE_RUBY_FILE_TRANSFER_SEGMENT: strcpy(s_szPacketType, "PACKET_TYPE_RUBY_FILE_TRANSFER_SEGMENT"); break;
       case PACKET_TYPE_RUBY_ALARM:               strcpy(s_szPacketType, "PACKET_TYPE_RUBY_ALARM"); break;
       case PACKET_TYPE_VIDEO_DATA_FULL:          strcpy(s_szPacketType, "PACKET_TYPE_VIDEO_DATA_FULL"); break;
       case PACKET_TYPE_AUDIO_SEGMENT:            strcpy(s_szPacketType, "PACKET_TYPE_AUDIO_SEGMENT"); break;
@@ -274,6 +276,7 @@ char* str_get_packet_type(int iPacketType)
 
       case PACKET_TYPE_RUBY_TELEMETRY_SHORT:      strcpy(s_szPacketType, "PACKET_TYPE_RUBY_TELEMETRY_SHORT"); break;
       case PACKET_TYPE_RUBY_TELEMETRY_EXTENDED:   strcpy(s_szPacketType, "PACKET_TYPE_RUBY_TELEMETRY_EXTENDED"); break;
+      case PACKET_TYPE_RUBY_TELEMETRY_EXTENDED_DELTA: strcpy(s_szPacketType, "PACKET_TYPE_RUBY_TELEMETRY_EXTENDED_DELTA"); break;
       case PACKET_TYPE_FC_TELEMETRY:              strcpy(s_szPacketType, "PACKET_TYPE_FC_TELEMETRY"); break;
       case PACKET_TYPE_FC_TELEMETRY_EXTENDED:     strcpy(s_szPacketType, "PACKET_TYPE_FC_TELEMETRY_EXTENDED"); break;
       case PACKET_TYPE_FC_RC_CHANNELS:            strcpy(s_szPacketType, "PACKET_TYPE_FC_RC_CHANNELS"); break;
@@ -383,7 +386,8 @@ char* str_get_packet_history_symbol(int iPacketType, int iRepeatCount)
       s_szOSDRenderRxHistoryPacketSymbol[0] = 'D';
 
    if ( iPacketType == PACKET_TYPE_RUBY_TELEMETRY_SHORT ||
-        iPacketType == PACKET_TYPE_RUBY_TELEMETRY_EXTENDED )
+        iPacketType == PACKET_TYPE_RUBY_TELEMETRY_EXTENDED ||
+        iPacketType == PACKET_TYPE_RUBY_TELEMETRY_EXTENDED_DELTA )
       s_szOSDRenderRxHistoryPacketSymbol[0] = 'R';
 
    if ( iPacketType == PACKET_TYPE_RC_TELEMETRY ||
@@ -411,9 +415,15 @@ char* str_get_packet_history_symbol(int iPacketType, int iRepeatCount)
    if ( iPacketType == PACKET_TYPE_RUBY_MODEL_SETTINGS )
       s_szOSDRenderRxHistoryPacketSymbol[0] = 'M';
 
+   if ( iPacketType == PACKET_TYPE_RUBY_MODEL_SECTION )
+      s_szOSDRenderRxHistoryPacketSymbol[0] = 'M';
+
    if ( iPacketType == PACKET_TYPE_RUBY_RADIO_CONFIG_UPDATED )
       s_szOSDRenderRxHistoryPacketSymbol[0] = 'U';
 
+   if ( iPacketType == PACKET_TYPE_RUBY_FILE_TRANSFER_SEGMENT )
+      s_szOSDRenderRxHistoryPacketSymbol[0] = 'F';
+
    if ( iPacketType == PACKET_TYPE_RUBY_ALARM )
       s_szOSDRenderRxHistoryPacketSymbol[0] = 'a';
 
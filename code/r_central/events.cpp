@@ -152,13 +152,7 @@ void onMainVehicleChanged(bool bRemovePreviousVehicleState)
       }
    }
 
-   for ( int i=0; i<g_iPluginsOSDCount; i++ )
-   {
-      if ( NULL == g_pPluginsOSD[i] )
-         continue;
-      if ( NULL != g_pPluginsOSD[i]->pFunctionOnNewVehicle )
-         (*(g_pPluginsOSD[i]->pFunctionOnNewVehicle))(g_pCurrentModel->uVehicleId);
-   }
+   osd_plugins_on_new_vehicle(g_pCurrentModel->uVehicleId);
    osd_widgets_on_main_vehicle_changed(g_pCurrentModel->uVehicleId);
    
    warnings_on_changed_vehicle();
@@ -32,6 +32,8 @@
 #include <pthread.h>
 //#include "../base/radio_utils.h"
 #include "../base/ctrl_settings.h"
+#include "../base/models_sync.h"
+#include "../base/file_transfer.h"
 #include "../common/models_connect_frequencies.h"
 #include "../common/string_utils.h"
 #include "handle_commands.h"
@@ -93,6 +95,25 @@ static int s_CommandReplyLength = 0;
 static int s_iCountRetriesToGetModelSettingsCommand = 0;
 static int s_RetryGetCorePluginsCounter = 0;
 
+// Model sync (see base/models_sync.h): changed model sections received from each vehicle for its current transfer
+typedef struct
+{
+   u32 uVehicleId;
+   u32 uTransferId;
+   u32 uTimeLastUpdate;
+   bool bTransferDone;
+   bool bHasVehicleHashes; // Only the get all params response has the vehicle's hashes of all the sections
+   bool bRequestFullModel; // Set when the synced model did not match the vehicle's one
+   t_model_sync_hashes vehicleHashes;
+   u32 uSectionsMask;
+   u32 uReceivedSectionsMask;
+   u32 uReceivedSegments[MODEL_BINARY_SECTIONS_COUNT];
+   t_packet_header_model_section sectionsHeaders[MODEL_BINARY_SECTIONS_COUNT];
+   u8 uSectionsData[MODEL_BINARY_SECTIONS_COUNT][MODEL_SYNC_MAX_ENCODED_SIZE];
+} type_model_sync_transfer;
+
+static type_model_sync_transfer s_ModelSyncTransfers[MAX_CONCURENT_VEHICLES];
+
 
 #define MAX_FILE_SEGMENTS_TO_DOWNLOAD 5000
 
@@ -107,6 +128,25 @@ static u32 s_uCountFileSegmentsDownloaded = 0;
 static u32 s_uLastFileSegmentRequestTime = 0;
 static u32 s_uLastTimeDownloadProgress = 0;
 
+// Bulk download (see base/file_transfer.h): segments are written to a partial file as they are received,
+// and the received segments are saved in a state file after each window, so an interrupted download can be resumed.
+static bool s_bFileDownloadBulk = false;
+static u32 s_uFileDownloadTransferId = 0;
+static u32 s_uFileDownloadSize = 0;
+static u32 s_uFileDownloadWindowStart = 0;
+static u32 s_uFileDownloadWindowAck[FILE_TRANSFER_WINDOW_BITMAP_WORDS];
+static u32 s_uFileDownloadLastWindowRequestTime = 0;
+static u32 s_uFileDownloadLastSegmentTime = 0;
+static int s_iFileDownloadStallRestarts = 0; // Download restarts with no segments received in between
+static FILE* s_pFileDownloadPart = NULL;
+
+// Bulk upload: missing segments of a window are sent without response, the last one asks for the window acknowledge
+static bool s_bFileUploadBulk = true;
+static u32 s_uFileUploadTransferId = 0;
+static u32 s_uFileUploadWindowStart = 0;
+static u32 s_uFileUploadSentBitmap[FILE_TRANSFER_WINDOW_BITMAP_WORDS];
+static t_file_transfer_pacing s_FileUploadPacing;
+
 Menu* s_pMenuVehicleHWInfo = NULL;
 Menu* s_pMenuUSBInfoVehicle = NULL;
 
@@ -338,6 +378,235 @@ int handle_commands_on_full_model_settings_received(u32 uVehicleId, int iRespons
    return 0;
 }
 
+type_model_sync_transfer* _model_sync_get_transfer(u32 uVehicleId)
+{
+   int iIndex = -1;
+   for( int i=0; i<MAX_CONCURENT_VEHICLES; i++ )
+   {
+      if ( s_ModelSyncTransfers[i].uVehicleId == uVehicleId )
+         return &(s_ModelSyncTransfers[i]);
+      if ( (-1 == iIndex) && (0 == s_ModelSyncTransfers[i].uVehicleId) )
+         iIndex = i;
+   }
+
+   // No free slot: reuse the one not used for the longest time
+   if ( -1 == iIndex )
+   {
+      iIndex = 0;
+      for( int i=1; i<MAX_CONCURENT_VEHICLES; i++ )
+      {
+         if ( s_ModelSyncTransfers[i].uTimeLastUpdate < s_ModelSyncTransfers[iIndex].uTimeLastUpdate )
+            iIndex = i;
+      }
+   }
+   memset(&(s_ModelSyncTransfers[iIndex]), 0, sizeof(type_model_sync_transfer));
+   s_ModelSyncTransfers[iIndex].uVehicleId = uVehicleId;
+   s_ModelSyncTransfers[iIndex].uTimeLastUpdate = g_TimeNow;
+   return &(s_ModelSyncTransfers[iIndex]);
+}
+
+// Returns true if the model sync flag must not be used for the next model settings request from the vehicle (it's cleared then)
+
+bool _model_sync_must_request_full_model(u32 uVehicleId)
+{
+   type_model_sync_transfer* pTransfer = _model_sync_get_transfer(uVehicleId);
+   if ( ! pTransfer->bRequestFullModel )
+      return false;
+   pTransfer->bRequestFullModel = false;
+   return true;
+}
+
+void _model_sync_on_verify_failed(type_model_sync_transfer* pTransfer, Model* pModel)
+{
+   pTransfer->bRequestFullModel = true;
+   pModel->b_mustSyncFromVehicle = true;
+}
+
+// Lets the vehicle know the model the controller has now, so that it uses it as the base for the next changes it sends
+
+void _model_sync_send_ack(type_model_sync_transfer* pTransfer, t_model_sync_hashes* pHashes)
+{
+   u8 uBuffer[sizeof(u32) + sizeof(t_model_sync_hashes)];
+   memcpy(uBuffer, (u8*)&(pTransfer->uTransferId), sizeof(u32));
+   memcpy(uBuffer + sizeof(u32), (u8*)pHashes, sizeof(t_model_sync_hashes));
+   if ( ! handle_commands_send_single_oneway_command_to_vehicle(pTransfer->uVehicleId, 1, COMMAND_ID_MODEL_SYNC_ACK, 0, uBuffer, sizeof(uBuffer), 0) )
+      log_line("[ModelSync] Can't ack transfer id %u to VID %u now, another command is in progress. Vehicle will send the changes again.", pTransfer->uTransferId, pTransfer->uVehicleId);
+}
+
+// Builds the vehicle model from the local model and the received model sections and handles it as received model settings
+
+void _model_sync_on_sections_complete(type_model_sync_transfer* pTransfer)
+{
+   u32 uVehicleId = pTransfer->uVehicleId;
+   int iIndexRuntime = -1;
+   for( int i=0; i<MAX_CONCURENT_VEHICLES; i++ )
+   {
+      if ( g_VehiclesRuntimeInfo[i].uVehicleId == uVehicleId )
+      {
+         iIndexRuntime = i;
+         break;
+      }
+   }
+   if ( (-1 == iIndexRuntime) || (NULL == g_VehiclesRuntimeInfo[iIndexRuntime].pModel) )
+   {
+      log_softerror_and_alarm("[ModelSync] Received model sections for vehicle not found in the runtime list (VID %u). Ignoring them.", uVehicleId);
+      return;
+   }
+   Model* pModel = g_VehiclesRuntimeInfo[iIndexRuntime].pModel;
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   sprintf(szFile, "%s/model_sync.mdl", FOLDER_RUBY_TEMP);
+   Model modelTemp;
+   if ( (! pModel->saveToFile(szFile, true)) || (! modelTemp.loadFromFile(szFile, true)) )
+   {
+      log_softerror_and_alarm("[ModelSync] Failed to create temporary model file (%s).", szFile);
+      pModel->b_mustSyncFromVehicle = true;
+      return;
+   }
+
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      if ( ! (pTransfer->uSectionsMask & (((u32)1) << i)) )
+         continue;
+
+      t_packet_header_model_section* pPHMS = &(pTransfer->sectionsHeaders[i]);
+      u8 uData[MODEL_SYNC_MAX_SECTION_SIZE];
+      int iSize = 0;
+      if ( pPHMS->uFlags & MODEL_SECTION_FLAG_PATCH )
+      {
+         iSize = models_sync_get_section_data(&modelTemp, i+1, uData, sizeof(uData));
+         u32 uCRC = base_compute_crc32(uData, iSize);
+         if ( uCRC == pPHMS->uSectionCRC )
+         {
+            log_line("[ModelSync] Patch for model section %d is already applied.", i+1);
+            continue;
+         }
+         if ( (uCRC != pPHMS->uBaseCRC) || ((int)pPHMS->uOffset + (int)pPHMS->uTotalSize > iSize) )
+         {
+            log_softerror_and_alarm("[ModelSync] Received patch for model section %d does not match the local model section. Sync full model settings.", i+1);
+            _model_sync_on_verify_failed(pTransfer, pModel);
+            return;
+         }
+         memcpy(&(uData[pPHMS->uOffset]), &(pTransfer->uSectionsData[i][0]), pPHMS->uTotalSize);
+      }
+      else
+         iSize = models_sync_decode(&(pTransfer->uSectionsData[i][0]), pPHMS->uTotalSize, uData, sizeof(uData));
+
+      if ( (iSize <= 0) || (base_compute_crc32(uData, iSize) != pPHMS->uSectionCRC) || (! models_sync_set_section_data(&modelTemp, i+1, uData, iSize)) )
+      {
+         log_softerror_and_alarm("[ModelSync] Received invalid data for model section %d. Sync full model settings.", i+1);
+         _model_sync_on_verify_failed(pTransfer, pModel);
+         return;
+      }
+   }
+
+   // The unchanged sections must match the vehicle's ones too, not just the received ones
+   t_model_sync_hashes hashes;
+   models_sync_compute_hashes(&modelTemp, &hashes);
+   if ( pTransfer->bHasVehicleHashes )
+   {
+      u32 uDifferentSections = models_sync_get_changed_sections(&hashes, &(pTransfer->vehicleHashes));
+      if ( 0 != uDifferentSections )
+      {
+         log_softerror_and_alarm("[ModelSync] Synced model of VID %u does not match the vehicle model (different sections: 0x%X). Sync full model settings.", uVehicleId, uDifferentSections);
+         _model_sync_on_verify_failed(pTransfer, pModel);
+         return;
+      }
+   }
+
+   if ( ! modelTemp.saveToFile(szFile, true) )
+   {
+      log_softerror_and_alarm("[ModelSync] Failed to save temporary model file (%s).", szFile);
+      pModel->b_mustSyncFromVehicle = true;
+      return;
+   }
+   FILE* fd = fopen(szFile, "rb");
+   if ( NULL == fd )
+   {
+      log_softerror_and_alarm("[ModelSync] Failed to read temporary model file (%s).", szFile);
+      pModel->b_mustSyncFromVehicle = true;
+      return;
+   }
+   u8 uBuffer[5048];
+   int length = fread(uBuffer, 1, 5000, fd);
+   fclose(fd);
+
+   bool bUnsolicited = ! g_VehiclesRuntimeInfo[iIndexRuntime].bWaitingForModelSettings;
+   log_line("[ModelSync] Got all changed model sections (mask 0x%X) from VID %u, %s, %s.", pTransfer->uSectionsMask, uVehicleId, bUnsolicited?"unsolicited":"expected", pTransfer->bHasVehicleHashes?"verified all sections":"verified changed sections");
+   g_VehiclesRuntimeInfo[iIndexRuntime].bWaitingForModelSettings = false;
+   g_VehiclesRuntimeInfo[iIndexRuntime].uTimeLastReceivedModelSettings = g_TimeNow;
+   onEventReceivedModelSettings(uVehicleId, uBuffer, length, bUnsolicited);
+
+   if ( s_CommandType == COMMAND_ID_GET_ALL_PARAMS_ZIP )
+   {
+      s_CommandType = 0;
+      s_bHasCommandInProgress = false;
+   }
+   _model_sync_send_ack(pTransfer, &hashes);
+}
+
+void _model_sync_start_transfer(type_model_sync_transfer* pTransfer, u32 uTransferId, u32 uSectionsMask)
+{
+   pTransfer->uTimeLastUpdate = g_TimeNow;
+   if ( uTransferId == pTransfer->uTransferId )
+      return;
+   pTransfer->uTransferId = uTransferId;
+   pTransfer->bTransferDone = false;
+   pTransfer->bHasVehicleHashes = false;
+   pTransfer->uSectionsMask = uSectionsMask;
+   pTransfer->uReceivedSectionsMask = 0;
+   memset(pTransfer->uReceivedSegments, 0, sizeof(pTransfer->uReceivedSegments));
+}
+
+void handle_commands_on_model_section_received(u8* pPacketBuffer)
+{
+   if ( NULL == pPacketBuffer )
+      return;
+   t_packet_header* pPH = (t_packet_header*)pPacketBuffer;
+   t_packet_header_model_section* pPHMS = (t_packet_header_model_section*)(pPacketBuffer + sizeof(t_packet_header));
+   u8* pData = pPacketBuffer + sizeof(t_packet_header) + sizeof(t_packet_header_model_section);
+   int iDataSize = (int)pPH->total_length - sizeof(t_packet_header) - sizeof(t_packet_header_model_section);
+   if ( pPH->packet_flags & PACKET_FLAGS_BIT_EXTRA_DATA )
+   {
+      u8 size = *(((u8*)pPH) + pPH->total_length-1);
+      iDataSize -= size;
+   }
+
+   int iSectionIndex = (int)pPHMS->uSectionId - 1;
+   int iPos = (int)pPHMS->uSegmentIndex * MODEL_SYNC_SEGMENT_SIZE;
+   if ( (iSectionIndex < 0) || (iSectionIndex >= MODEL_BINARY_SECTIONS_COUNT) ||
+        (pPHMS->uSegmentsCount < 1) || (pPHMS->uSegmentsCount > 32) || (pPHMS->uSegmentIndex >= pPHMS->uSegmentsCount) ||
+        (pPHMS->uTotalSize > MODEL_SYNC_MAX_ENCODED_SIZE) || (iDataSize < 0) || (iPos + iDataSize > (int)pPHMS->uTotalSize) ||
+        (! (pPHMS->uSectionsMask & (((u32)1) << iSectionIndex))) )
+   {
+      log_softerror_and_alarm("[ModelSync] Received invalid model section segment from VID %u (section %d, segment %d of %d, %d bytes). Ignoring it.",
+         pPH->vehicle_id_src, (int)pPHMS->uSectionId, (int)pPHMS->uSegmentIndex+1, (int)pPHMS->uSegmentsCount, iDataSize);
+      return;
+   }
+
+   type_model_sync_transfer* pTransfer = _model_sync_get_transfer(pPH->vehicle_id_src);
+   _model_sync_start_transfer(pTransfer, pPHMS->uTransferId, pPHMS->uSectionsMask);
+   if ( pTransfer->bTransferDone )
+      return;
+   if ( pTransfer->uReceivedSegments[iSectionIndex] & (((u32)1) << pPHMS->uSegmentIndex) )
+      return;
+
+   memcpy(&(pTransfer->uSectionsData[iSectionIndex][iPos]), pData, iDataSize);
+   memcpy(&(pTransfer->sectionsHeaders[iSectionIndex]), pPHMS, sizeof(t_packet_header_model_section));
+   pTransfer->uReceivedSegments[iSectionIndex] |= (((u32)1) << pPHMS->uSegmentIndex);
+   if ( pTransfer->uReceivedSegments[iSectionIndex] == (MAX_U32 >> (32 - pPHMS->uSegmentsCount)) )
+      pTransfer->uReceivedSectionsMask |= (((u32)1) << iSectionIndex);
+
+   log_line("[ModelSync] Received model section %d segment %d of %d (%d bytes) from VID %u, transfer id %u, received sections: 0x%X of 0x%X",
+      iSectionIndex+1, (int)pPHMS->uSegmentIndex+1, (int)pPHMS->uSegmentsCount, iDataSize, pPH->vehicle_id_src, pPHMS->uTransferId, pTransfer->uReceivedSectionsMask, pTransfer->uSectionsMask);
+
+   if ( pTransfer->uReceivedSectionsMask != pTransfer->uSectionsMask )
+      return;
+
+   pTransfer->bTransferDone = true;
+   _model_sync_on_sections_complete(pTransfer);
+}
+
 void _handle_received_command_response_to_get_all_params_zip(u8* pPacket, int iLength)
 {
    s_iCountRetriesToGetModelSettingsCommand = 0;
@@ -354,7 +623,49 @@ void _handle_received_command_response_to_get_all_params_zip(u8* pPacket, int iL
       iDataLength -= (int)size;
    }
 
-   
+   // Vehicle sends back only the changed model sections, in separate packets
+   if ( pPHCR->command_response_param == COMMAND_GET_ALL_PARAMS_RESPONSE_MODEL_SYNC )
+   {
+      if ( iDataLength < (int)(sizeof(t_model_sync_hashes) + 2*sizeof(u32)) )
+      {
+         log_softerror_and_alarm("[Commands] Received invalid model sync response (%d bytes) from VID %u. Ignoring it.", iDataLength, pPH->vehicle_id_src);
+         return;
+      }
+      u32 uTransferId = 0;
+      u32 uSectionsMask = 0;
+      memcpy((u8*)&uTransferId, pDataBuffer + sizeof(t_model_sync_hashes), sizeof(u32));
+      memcpy((u8*)&uSectionsMask, pDataBuffer + sizeof(t_model_sync_hashes) + sizeof(u32), sizeof(u32));
+      log_line("[Commands] Received model sync response from VID %u, transfer id %u, changed sections: 0x%X", pPH->vehicle_id_src, uTransferId, uSectionsMask);
+      type_model_sync_transfer* pTransfer = _model_sync_get_transfer(pPH->vehicle_id_src);
+      _model_sync_start_transfer(pTransfer, uTransferId, uSectionsMask);
+      if ( pTransfer->bHasVehicleHashes )
+         return;
+      memcpy((u8*)&(pTransfer->vehicleHashes), pDataBuffer, sizeof(t_model_sync_hashes));
+      pTransfer->bHasVehicleHashes = true;
+
+      if ( (0 == uSectionsMask) && (! pTransfer->bTransferDone) )
+      {
+         pTransfer->bTransferDone = true;
+         _model_sync_on_sections_complete(pTransfer);
+      }
+      // The sections were received before this response: check the resulting model against the vehicle's one now
+      else if ( pTransfer->bTransferDone )
+      {
+         Model* pModel = findModelWithId(pPH->vehicle_id_src, 0);
+         if ( NULL != pModel )
+         {
+            t_model_sync_hashes hashes;
+            models_sync_compute_hashes(pModel, &hashes);
+            if ( 0 != models_sync_get_changed_sections(&hashes, &(pTransfer->vehicleHashes)) )
+            {
+               log_softerror_and_alarm("[ModelSync] Synced model of VID %u does not match the vehicle model. Sync full model settings.", pPH->vehicle_id_src);
+               _model_sync_on_verify_failed(pTransfer, pModel);
+            }
+         }
+      }
+      return;
+   }
+
    // Did we a full, complete, single zip response?
    if ( iDataLength > 500 )
    {
@@ -508,6 +819,7 @@ bool handle_commands_start_on_pairing()
    s_uCountFileSegmentsDownloaded = 0;
    s_uLastFileSegmentRequestTime = 0;
    s_uLastTimeDownloadProgress = 0;
+   s_bFileDownloadBulk = false;
 
    for( u32 u=0; u<MAX_FILE_SEGMENTS_TO_DOWNLOAD; u++ )
       s_pListFileSegments[u] = NULL;
@@ -516,22 +828,36 @@ bool handle_commands_start_on_pairing()
    return true;
 }
 
-bool handle_commands_stop_on_pairing()
-{
-   log_line("[Commands] Handle stop pairing...");
+void _handle_download_file_save_state();
 
+void _handle_download_file_reset_state()
+{
    if ( 0 < s_uCountFileSegmentsToDownload )
    {
-       for( u32 u=0; u<s_uCountFileSegmentsToDownload; u++ )
-       {
-          if ( NULL != s_pListFileSegments[u] )
-             free(s_pListFileSegments[u]);
-          s_pListFileSegments[u] = NULL;
-       }
+      for( u32 u=0; u<s_uCountFileSegmentsToDownload; u++ )
+      {
+         if ( NULL != s_pListFileSegments[u] )
+            free(s_pListFileSegments[u]);
+         s_pListFileSegments[u] = NULL;
+      }
    }
+   if ( NULL != s_pFileDownloadPart )
+      fclose(s_pFileDownloadPart);
+   s_pFileDownloadPart = NULL;
+   s_bFileDownloadBulk = false;
    s_uFileIdToDownload = 0;
    s_uFileToDownloadState = 0xFF;
    s_uCountFileSegmentsToDownload = 0;
+}
+
+bool handle_commands_stop_on_pairing()
+{
+   log_line("[Commands] Handle stop pairing...");
+
+   // Partial bulk downloads are kept on storage, to be resumed later
+   if ( s_bFileDownloadBulk && (NULL != g_pCurrentModel) )
+      _handle_download_file_save_state();
+   _handle_download_file_reset_state();
    s_uCountFileSegmentsDownloaded = 0;
    s_uLastFileSegmentRequestTime = 0;
    s_uLastTimeDownloadProgress = 0;
@@ -557,9 +883,318 @@ void merge_osd_params(osd_parameters_t* pParamsVehicleSrc, osd_parameters_t* pPa
 }
 
 
+static void _handle_download_file_get_partial_files(u32 uFileId, char* szPartFile, char* szStateFile)
+{
+   sprintf(szPartFile, "%sdownload_%u.part", FOLDER_RUBY_TEMP, uFileId);
+   sprintf(szStateFile, "%sdownload_%u.state", FOLDER_RUBY_TEMP, uFileId);
+}
+
+// Moves the received vehicle logs archive to the vehicle media folder
+void _handle_download_file_save_logs_archive(const char* szSourceFile)
+{
+   char szComm[512];
+   char szFolder[256];
+   char szBuff[256];
+
+   sprintf(szFolder, FOLDER_MEDIA_VEHICLE_DATA, g_pCurrentModel->uVehicleId);
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "mkdir -p %s", szFolder);
+   hw_execute_bash_command(szComm, NULL);
+   sprintf(szBuff, "logs_%s_%u_%u.zip", g_pCurrentModel->getShortName(), g_pCurrentModel->m_Stats.uTotalFlights, g_pCurrentModel->m_Stats.uTotalOnTime);
+   for( int i=0; i<(int)strlen(szBuff); i++ )
+      if ( szBuff[i] == ' ' )
+         szBuff[i] = '-';
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "mv -f %s %s/%s", szSourceFile, szFolder, szBuff);
+   hw_execute_bash_command(szComm, NULL);
+}
+
+void _handle_download_file_save_state()
+{
+   if ( NULL != s_pFileDownloadPart )
+      fflush(s_pFileDownloadPart);
+
+   char szPartFile[MAX_FILE_PATH_SIZE];
+   char szStateFile[MAX_FILE_PATH_SIZE];
+   _handle_download_file_get_partial_files(s_uFileIdToDownload, szPartFile, szStateFile);
+   FILE* fd = fopen(szStateFile, "w");
+   if ( NULL == fd )
+   {
+      log_softerror_and_alarm("[FileTransfer] Failed to save download state to file [%s].", szStateFile);
+      return;
+   }
+   fprintf(fd, "%u %u %u %u %u %u\n", g_pCurrentModel->uVehicleId, s_uFileIdToDownload, s_uFileDownloadTransferId, s_uFileDownloadSize, s_uFileToDownloadSegmentSize, s_uCountFileSegmentsToDownload);
+   for( u32 u=0; u<s_uCountFileSegmentsToDownload; u++ )
+      fputc(s_bListFileSegmentsToDownload[u]?'0':'1', fd);
+   fprintf(fd, "\n");
+   fclose(fd);
+}
+
+// Returns true if there is a partial download of the same file from the current vehicle. Marks the segments already received.
+bool _handle_download_file_load_state()
+{
+   char szPartFile[MAX_FILE_PATH_SIZE];
+   char szStateFile[MAX_FILE_PATH_SIZE];
+   _handle_download_file_get_partial_files(s_uFileIdToDownload, szPartFile, szStateFile);
+   if ( access(szPartFile, R_OK) == -1 )
+      return false;
+
+   FILE* fd = fopen(szStateFile, "r");
+   if ( NULL == fd )
+      return false;
+
+   u32 uVehicleId = 0, uFileId = 0, uTransferId = 0, uFileSize = 0, uSegmentSize = 0, uSegmentsCount = 0;
+   if ( 6 != fscanf(fd, "%u %u %u %u %u %u", &uVehicleId, &uFileId, &uTransferId, &uFileSize, &uSegmentSize, &uSegmentsCount) )
+   {
+      fclose(fd);
+      return false;
+   }
+   if ( (uVehicleId != g_pCurrentModel->uVehicleId) || (uFileId != s_uFileIdToDownload) || (uTransferId != s_uFileDownloadTransferId) ||
+        (uFileSize != s_uFileDownloadSize) || (uSegmentSize != s_uFileToDownloadSegmentSize) || (uSegmentsCount != s_uCountFileSegmentsToDownload) )
+   {
+      fclose(fd);
+      log_line("[FileTransfer] Partial download of file id %u is from a different file. Start a new download.", s_uFileIdToDownload);
+      return false;
+   }
+
+   int iChar = fgetc(fd);
+   while ( (iChar == ' ') || (iChar == '\n') || (iChar == '\r') )
+      iChar = fgetc(fd);
+   for( u32 u=0; u<s_uCountFileSegmentsToDownload; u++ )
+   {
+      if ( iChar == EOF )
+         break;
+      if ( iChar == '1' )
+      {
+         s_bListFileSegmentsToDownload[u] = false;
+         s_uListFileSegmentsSize[u] = (u16)s_uFileToDownloadSegmentSize;
+         s_uCountFileSegmentsDownloaded++;
+      }
+      iChar = fgetc(fd);
+   }
+   fclose(fd);
+   return true;
+}
+
+void _handle_download_file_set_window(u32 uWindowStart)
+{
+   s_uFileDownloadWindowStart = uWindowStart;
+   memset(s_uFileDownloadWindowAck, 0, sizeof(s_uFileDownloadWindowAck));
+   int iCount = file_transfer_get_window_segments(uWindowStart, s_uCountFileSegmentsToDownload);
+   for( int i=0; i<iCount; i++ )
+   {
+      if ( ! s_bListFileSegmentsToDownload[uWindowStart + i] )
+         file_transfer_bitmap_set(s_uFileDownloadWindowAck, i);
+   }
+   s_uFileDownloadLastWindowRequestTime = 0;
+}
+
+bool _handle_download_file_bulk_start(t_packet_header_download_file_info* pFileInfo, t_packet_header_download_file_bulk_info* pBulkInfo)
+{
+   if ( (pBulkInfo->uSegmentSize != FILE_TRANSFER_SEGMENT_SIZE) || (pBulkInfo->uWindowSegments != FILE_TRANSFER_WINDOW_SEGMENTS) || (0 == pBulkInfo->uFileSize) )
+      return false;
+   u32 uSegmentsCount = (pBulkInfo->uFileSize + FILE_TRANSFER_SEGMENT_SIZE - 1) / FILE_TRANSFER_SEGMENT_SIZE;
+   if ( uSegmentsCount >= MAX_FILE_SEGMENTS_TO_DOWNLOAD )
+      return false;
+
+   _handle_download_file_reset_state();
+   s_bFileDownloadBulk = true;
+   s_uFileIdToDownload = pFileInfo->file_id;
+   s_uFileToDownloadState = 1;
+   s_uFileToDownloadSegmentSize = FILE_TRANSFER_SEGMENT_SIZE;
+   s_uFileDownloadTransferId = pBulkInfo->uTransferId;
+   s_uFileDownloadSize = pBulkInfo->uFileSize;
+   s_uCountFileSegmentsToDownload = uSegmentsCount;
+   s_uCountFileSegmentsDownloaded = 0;
+   for( u32 u=0; u<s_uCountFileSegmentsToDownload; u++ )
+   {
+      s_bListFileSegmentsToDownload[u] = true;
+      s_uListFileSegmentsSize[u] = 0;
+   }
+
+   char szPartFile[MAX_FILE_PATH_SIZE];
+   char szStateFile[MAX_FILE_PATH_SIZE];
+   _handle_download_file_get_partial_files(s_uFileIdToDownload, szPartFile, szStateFile);
+
+   bool bResumed = _handle_download_file_load_state();
+   if ( bResumed )
+      s_pFileDownloadPart = fopen(szPartFile, "r+b");
+   if ( NULL == s_pFileDownloadPart )
+   {
+      bResumed = false;
+      s_uCountFileSegmentsDownloaded = 0;
+      for( u32 u=0; u<s_uCountFileSegmentsToDownload; u++ )
+         s_bListFileSegmentsToDownload[u] = true;
+      s_pFileDownloadPart = fopen(szPartFile, "w+b");
+   }
+   if ( NULL == s_pFileDownloadPart )
+   {
+      log_softerror_and_alarm("[FileTransfer] Failed to create file [%s] for the download.", szPartFile);
+      _handle_download_file_reset_state();
+      return false;
+   }
+   _handle_download_file_save_state();
+
+   u32 uFirstMissing = 0;
+   while ( (uFirstMissing < s_uCountFileSegmentsToDownload) && (! s_bListFileSegmentsToDownload[uFirstMissing]) )
+      uFirstMissing++;
+   if ( uFirstMissing >= s_uCountFileSegmentsToDownload )
+      uFirstMissing = 0;
+   _handle_download_file_set_window(uFirstMissing - (uFirstMissing % FILE_TRANSFER_WINDOW_SEGMENTS));
+
+   s_uFileDownloadLastSegmentTime = g_TimeNow;
+   s_uLastTimeDownloadProgress = g_TimeNow;
+   log_line("[FileTransfer] Start bulk download of file id %u (%u bytes, %u segments, transfer id %u), %s, %u segments already received.",
+      s_uFileIdToDownload, s_uFileDownloadSize, s_uCountFileSegmentsToDownload, s_uFileDownloadTransferId, bResumed?"resumed":"new download", s_uCountFileSegmentsDownloaded);
+   return true;
+}
+
+void _handle_download_file_bulk_completed()
+{
+   char szPartFile[MAX_FILE_PATH_SIZE];
+   char szStateFile[MAX_FILE_PATH_SIZE];
+   _handle_download_file_get_partial_files(s_uFileIdToDownload, szPartFile, szStateFile);
+
+   bool bValidFile = false;
+   if ( NULL != s_pFileDownloadPart )
+   {
+      u8* pFile = (u8*) malloc(s_uFileDownloadSize);
+      if ( NULL != pFile )
+      {
+         fflush(s_pFileDownloadPart);
+         fseek(s_pFileDownloadPart, 0, SEEK_SET);
+         if ( s_uFileDownloadSize == fread(pFile, 1, s_uFileDownloadSize, s_pFileDownloadPart) )
+            bValidFile = (base_compute_crc32(pFile, (int)s_uFileDownloadSize) == s_uFileDownloadTransferId);
+         free(pFile);
+      }
+      fclose(s_pFileDownloadPart);
+      s_pFileDownloadPart = NULL;
+   }
+
+   unlink(szStateFile);
+   if ( ! bValidFile )
+   {
+      log_softerror_and_alarm("[FileTransfer] Downloaded file id %u has an invalid CRC. Discard it.", s_uFileIdToDownload);
+      unlink(szPartFile);
+      if ( s_uFileIdToDownload == FILE_ID_VEHICLE_LOGS_ARCHIVE )
+         warnings_add(0, "Failed to download vehicle logs. Try again.");
+      _handle_download_file_reset_state();
+      return;
+   }
+
+   log_line("[FileTransfer] Received entire file id %u using bulk download, %u bytes.", s_uFileIdToDownload, s_uFileDownloadSize);
+   if ( s_uFileIdToDownload == FILE_ID_VEHICLE_LOGS_ARCHIVE )
+   {
+      warnings_add(0, "Received complete vehicles logs.");
+      _handle_download_file_save_logs_archive(szPartFile);
+   }
+   else
+      unlink(szPartFile);
+   _handle_download_file_reset_state();
+}
+
+void _handle_download_file_show_progress()
+{
+   if ( g_TimeNow <= s_uLastTimeDownloadProgress + 5000 )
+      return;
+   s_uLastTimeDownloadProgress = g_TimeNow;
+   char szBuff[128];
+   if ( s_uCountFileSegmentsToDownload > 0 )
+      sprintf(szBuff, "Downloading %d%%", s_uCountFileSegmentsDownloaded*100 / s_uCountFileSegmentsToDownload );
+   else
+      strcpy(szBuff, "Downloading ...");
+   warnings_add(0, szBuff);
+}
+
+void handle_commands_on_file_transfer_segment_received(u8* pPacketBuffer)
+{
+   if ( (NULL == pPacketBuffer) || (! s_bFileDownloadBulk) || (NULL == s_pFileDownloadPart) )
+      return;
+
+   t_packet_header* pPH = (t_packet_header*)pPacketBuffer;
+   if ( (NULL == g_pCurrentModel) || (pPH->vehicle_id_src != g_pCurrentModel->uVehicleId) )
+      return;
+   int iDataSize = (int)pPH->total_length - sizeof(t_packet_header) - sizeof(t_packet_header_file_transfer_segment);
+   if ( pPH->packet_flags & PACKET_FLAGS_BIT_EXTRA_DATA )
+   {
+      u8 size = *(((u8*)pPH) + pPH->total_length-1);
+      iDataSize -= size;
+   }
+   if ( iDataSize < 0 )
+      return;
+
+   t_packet_header_file_transfer_segment PHFTS;
+   memcpy((u8*)&PHFTS, pPacketBuffer + sizeof(t_packet_header), sizeof(t_packet_header_file_transfer_segment));
+   u8* pData = pPacketBuffer + sizeof(t_packet_header) + sizeof(t_packet_header_file_transfer_segment);
+
+   if ( (PHFTS.uFileId != s_uFileIdToDownload) || (PHFTS.uTransferId != s_uFileDownloadTransferId) || (PHFTS.uFileSize != s_uFileDownloadSize) ||
+        (PHFTS.uSegmentSize != s_uFileToDownloadSegmentSize) || (PHFTS.uSegmentIndex >= s_uCountFileSegmentsToDownload) || ((int)PHFTS.uDataSize > iDataSize) )
+   {
+      log_softerror_and_alarm("[FileTransfer] Received invalid or unexpected file segment %u (file id %u, transfer id %u).", PHFTS.uSegmentIndex, PHFTS.uFileId, PHFTS.uTransferId);
+      return;
+   }
+
+   s_uFileDownloadLastSegmentTime = g_TimeNow;
+   s_iFileDownloadStallRestarts = 0;
+   u32 uIndex = PHFTS.uSegmentIndex;
+   if ( ! s_bListFileSegmentsToDownload[uIndex] )
+      return;
+
+   int iSegmentSize = (int)(s_uFileDownloadSize - uIndex * s_uFileToDownloadSegmentSize);
+   if ( iSegmentSize > (int)s_uFileToDownloadSegmentSize )
+      iSegmentSize = (int)s_uFileToDownloadSegmentSize;
+
+   u8 uSegment[FILE_TRANSFER_SEGMENT_SIZE];
+   int iSize = -1;
+   if ( PHFTS.uFlags & FILE_TRANSFER_SEGMENT_FLAG_COMPRESSED )
+      iSize = file_transfer_decompress(pData, PHFTS.uDataSize, uSegment, iSegmentSize);
+   else if ( PHFTS.uDataSize == iSegmentSize )
+   {
+      memcpy(uSegment, pData, iSegmentSize);
+      iSize = iSegmentSize;
+   }
+   if ( iSize != iSegmentSize )
+   {
+      log_softerror_and_alarm("[FileTransfer] Received invalid data for file segment %u.", uIndex);
+      return;
+   }
+
+   fseek(s_pFileDownloadPart, uIndex * s_uFileToDownloadSegmentSize, SEEK_SET);
+   if ( iSize != (int)fwrite(uSegment, 1, iSize, s_pFileDownloadPart) )
+   {
+      log_softerror_and_alarm("[FileTransfer] Failed to write file segment %u to storage.", uIndex);
+      return;
+   }
+
+   s_bListFileSegmentsToDownload[uIndex] = false;
+   s_uListFileSegmentsSize[uIndex] = (u16)iSize;
+   s_uCountFileSegmentsDownloaded++;
+   if ( (uIndex >= s_uFileDownloadWindowStart) && (uIndex < s_uFileDownloadWindowStart + FILE_TRANSFER_WINDOW_SEGMENTS) )
+      file_transfer_bitmap_set(s_uFileDownloadWindowAck, (int)(uIndex - s_uFileDownloadWindowStart));
+
+   _handle_download_file_show_progress();
+}
+
+bool handle_commands_has_partial_file_download(u32 uFileId)
+{
+   if ( NULL == g_pCurrentModel )
+      return false;
+   char szPartFile[MAX_FILE_PATH_SIZE];
+   char szStateFile[MAX_FILE_PATH_SIZE];
+   _handle_download_file_get_partial_files(uFileId, szPartFile, szStateFile);
+   if ( access(szPartFile, R_OK) == -1 )
+      return false;
+   FILE* fd = fopen(szStateFile, "r");
+   if ( NULL == fd )
+      return false;
+   u32 uVehicleId = 0;
+   if ( 1 != fscanf(fd, "%u", &uVehicleId) )
+      uVehicleId = 0;
+   fclose(fd);
+   return (uVehicleId == g_pCurrentModel->uVehicleId);
+}
+
 void _handle_download_file_response()
 {
-   u32 uFileId = s_CommandParam;
+   u32 uFileId = s_CommandParam & 0x007FFFFF;
    u8* pBuffer = &s_CommandReplyBuffer[0] + sizeof(t_packet_header) + sizeof(t_packet_header_command_response);
    t_packet_header_download_file_info* pFileInfo = (t_packet_header_download_file_info*)pBuffer;
    log_line("[Commands]: Received file download request response from vehicle (file id %d, name: [%s]), segments: %u, segment size: %u, file state: %s", pFileInfo->file_id, pFileInfo->szFileName, pFileInfo->segments_count, pFileInfo->segment_size, pFileInfo->isReady?"file ready":"file preprocessing");
@@ -571,6 +1206,19 @@ void _handle_download_file_response()
       s_uFileToDownloadState = pFileInfo->isReady;
    }
 
+   if ( pFileInfo->isReady == 1 )
+   if ( s_CommandReplyLength >= (int)(sizeof(t_packet_header) + sizeof(t_packet_header_command_response) + sizeof(t_packet_header_download_file_info) + sizeof(t_packet_header_download_file_bulk_info)) )
+   {
+      t_packet_header_download_file_bulk_info bulkInfo;
+      memcpy((u8*)&bulkInfo, pBuffer + sizeof(t_packet_header_download_file_info), sizeof(t_packet_header_download_file_bulk_info));
+      if ( _handle_download_file_bulk_start(pFileInfo, &bulkInfo) )
+      {
+         if ( pFileInfo->file_id == FILE_ID_VEHICLE_LOGS_ARCHIVE )
+            warnings_add(0, (s_uCountFileSegmentsDownloaded > 0)?"Resuming download of vehicle logs...":"Downloading vehicle logs...");
+         return;
+      }
+   }
+
    if ( pFileInfo->isReady == 1 )
    {
       s_uLastFileSegmentRequestTime = g_TimeNow;
@@ -666,16 +1314,7 @@ void _handle_download_file_segment_response()
       uTotalSize += (u32) s_uListFileSegmentsSize[u];
    }
 
-   if ( g_TimeNow > s_uLastTimeDownloadProgress + 5000 )
-   {
-      s_uLastTimeDownloadProgress = g_TimeNow;
-      char szBuff[128];
-      if ( s_uCountFileSegmentsToDownload > 0 )
-         sprintf(szBuff, "Downloading %d%%", s_uCountFileSegmentsDownloaded*100 / s_uCountFileSegmentsToDownload );
-      else
-         strcpy(szBuff, "Downloading ...");
-      warnings_add(0, szBuff);
-   }
+   _handle_download_file_show_progress();
 
    if ( bHasMoreSegmentsToDownload )
       return;
@@ -707,32 +1346,10 @@ void _handle_download_file_segment_response()
       else
          log_softerror_and_alarm("[Commands] Failed to write received vehicle logs zip file to storage (%s).", szFile);
 
-      char szFolder[256];
-      char szBuff[256];
-
-      sprintf(szFolder, FOLDER_MEDIA_VEHICLE_DATA, g_pCurrentModel->uVehicleId);
-      snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "mkdir -p %s", szFolder);
-      hw_execute_bash_command(szComm, NULL);
-      sprintf(szBuff, "logs_%s_%u_%u.zip", g_pCurrentModel->getShortName(), g_pCurrentModel->m_Stats.uTotalFlights, g_pCurrentModel->m_Stats.uTotalOnTime);
-      for( int i=0; i<(int)strlen(szBuff); i++ )
-         if ( szBuff[i] == ' ' )
-            szBuff[i] = '-';
-      snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "mv -f %s/vehicle_logs.zip %s/%s", FOLDER_RUBY_TEMP, szFolder, szBuff);
-      hw_execute_bash_command(szComm, NULL);
+      _handle_download_file_save_logs_archive(szFile);
    }
 
-   if ( 0 < s_uCountFileSegmentsToDownload )
-   {
-       for( u32 u=0; u<s_uCountFileSegmentsToDownload; u++ )
-       {
-          if ( NULL != s_pListFileSegments[u] )
-             free(s_pListFileSegments[u]);
-          s_pListFileSegments[u] = NULL;
-       }
-   }
-   s_uFileIdToDownload = 0;
-   s_uFileToDownloadState = 0xFF;
-   s_uCountFileSegmentsToDownload = 0;
+   _handle_download_file_reset_state();
 }
 
 
@@ -800,6 +1417,28 @@ bool handle_last_command_result()
          }
          break;
 
+      case COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT:
+         if ( s_CommandReplyLength >= (int)(sizeof(t_packet_header) + sizeof(t_packet_header_command_response) + sizeof(t_file_transfer_window)) )
+         {
+            t_file_transfer_window window;
+            memcpy((u8*)&window, &s_CommandReplyBuffer[0] + sizeof(t_packet_header) + sizeof(t_packet_header_command_response), sizeof(t_file_transfer_window));
+            if ( (window.uTransferId == s_uFileUploadTransferId) && (window.uWindowStart < g_CurrentUploadingFile.uTotalSegments) )
+            {
+               // The bitmap in the packed struct is not aligned
+               u32 uAckBitmap[FILE_TRANSFER_WINDOW_BITMAP_WORDS];
+               memcpy(uAckBitmap, window.uAckBitmap, sizeof(uAckBitmap));
+               int iCount = file_transfer_get_window_segments(window.uWindowStart, g_CurrentUploadingFile.uTotalSegments);
+               for( int i=0; i<iCount; i++ )
+               {
+                  if ( file_transfer_bitmap_get(uAckBitmap, i) )
+                     g_CurrentUploadingFile.bSegmentsUploaded[window.uWindowStart + i] = true;
+               }
+            }
+            // Segments that are still missing get sent again
+            memset(s_uFileUploadSentBitmap, 0, sizeof(s_uFileUploadSentBitmap));
+         }
+         break;
+
       case COMMAND_ID_UPLOAD_FILE_SEGMENT:
          {
              if ( g_CurrentUploadingFile.uLastSegmentIndexUploaded < g_CurrentUploadingFile.uTotalSegments )
@@ -2020,6 +2659,17 @@ bool _commands_check_send_get_settings()
 
       log_line("[Commands] Send request to router to request model settings from vehicle.");
       reset_model_settings_download_buffers(g_pCurrentModel->uVehicleId);
+
+      // Send the hashes of the local model sections, so that the vehicle sends back only the changed ones.
+      // Older vehicles ignore them and send back the full model settings.
+      // After a synced model did not match the vehicle's one, the full model settings are requested once.
+      if ( (! g_bIsFirstConnectionToCurrentVehicle) && (! _model_sync_must_request_full_model(g_pCurrentModel->uVehicleId)) )
+      {
+         t_model_sync_hashes hashes;
+         models_sync_compute_hashes(g_pCurrentModel, &hashes);
+         flags |= COMMAND_GET_ALL_PARAMS_FLAG_MODEL_SYNC;
+         return handle_commands_send_to_vehicle(COMMAND_ID_GET_ALL_PARAMS_ZIP, flags, (u8*)&hashes, sizeof(t_model_sync_hashes));
+      }
       return handle_commands_send_to_vehicle(COMMAND_ID_GET_ALL_PARAMS_ZIP, flags, NULL, 0);
    }
 
@@ -2072,6 +2722,81 @@ bool _commands_check_send_get_settings()
    return false;
 }
 
+static u32 _commands_get_file_transfer_max_bytes_per_sec()
+{
+   ControllerSettings* pCS = get_ControllerSettings();
+   if ( (NULL == pCS) || (pCS->iFileTransferMaxKbps <= 0) )
+      return DEFAULT_FILE_TRANSFER_MAX_KBPS * 1000 / 8;
+   return (u32)pCS->iFileTransferMaxKbps * 1000 / 8;
+}
+
+bool _commands_check_download_file_window()
+{
+   // Window complete: save the progress and move to the next window with missing segments
+   if ( file_transfer_bitmap_is_complete(s_uFileDownloadWindowAck, s_uFileDownloadWindowStart, s_uCountFileSegmentsToDownload) )
+   {
+      _handle_download_file_save_state();
+      u32 uFirstMissing = 0;
+      while ( (uFirstMissing < s_uCountFileSegmentsToDownload) && (! s_bListFileSegmentsToDownload[uFirstMissing]) )
+         uFirstMissing++;
+      if ( uFirstMissing >= s_uCountFileSegmentsToDownload )
+      {
+         _handle_download_file_bulk_completed();
+         return false;
+      }
+      _handle_download_file_set_window(uFirstMissing - (uFirstMissing % FILE_TRANSFER_WINDOW_SEGMENTS));
+   }
+
+   // No segments for a while (the vehicle may have released or changed the file): save the progress
+   // and request the file again, resuming the download. Give up after a few restarts with no progress.
+   if ( g_TimeNow > s_uFileDownloadLastSegmentTime + 10000 )
+   {
+      u32 uFileId = s_uFileIdToDownload;
+      _handle_download_file_save_state();
+      _handle_download_file_reset_state();
+      s_iFileDownloadStallRestarts++;
+      if ( s_iFileDownloadStallRestarts > 3 )
+      {
+         log_softerror_and_alarm("[FileTransfer] Download of file id %u stalled. Give up.", uFileId);
+         s_iFileDownloadStallRestarts = 0;
+         if ( uFileId == FILE_ID_VEHICLE_LOGS_ARCHIVE )
+            warnings_add(0, "Failed to download vehicle logs. Try again.");
+         return false;
+      }
+      log_line("[FileTransfer] Download of file id %u stalled. Request it again and resume the download (retry %d).", uFileId, s_iFileDownloadStallRestarts);
+      handle_commands_send_to_vehicle(COMMAND_ID_DOWNLOAD_FILE, uFileId | COMMAND_DOWNLOAD_FILE_FLAG_RESUME, NULL, 0);
+      return true;
+   }
+
+   // Ask again for the missing segments once the vehicle had the time to send the window and segments stopped coming
+   u32 uMaxBytesPerSec = _commands_get_file_transfer_max_bytes_per_sec();
+   if ( 0 != s_uFileDownloadLastWindowRequestTime )
+   {
+      int iMissing = 0;
+      int iCount = file_transfer_get_window_segments(s_uFileDownloadWindowStart, s_uCountFileSegmentsToDownload);
+      for( int i=0; i<iCount; i++ )
+      {
+         if ( ! file_transfer_bitmap_get(s_uFileDownloadWindowAck, i) )
+            iMissing++;
+      }
+      u32 uTimeout = 300 + (u32)iMissing * (FILE_TRANSFER_SEGMENT_SIZE + 100) * 1000 / uMaxBytesPerSec;
+      if ( g_TimeNow < s_uFileDownloadLastWindowRequestTime + uTimeout )
+         return false;
+      if ( g_TimeNow < s_uFileDownloadLastSegmentTime + 300 )
+         return false;
+   }
+
+   t_file_transfer_window window;
+   window.uFileId = s_uFileIdToDownload;
+   window.uTransferId = s_uFileDownloadTransferId;
+   window.uWindowStart = s_uFileDownloadWindowStart;
+   memcpy(window.uAckBitmap, s_uFileDownloadWindowAck, sizeof(window.uAckBitmap));
+   window.uMaxBytesPerSec = uMaxBytesPerSec;
+   if ( handle_commands_send_single_oneway_command(0, COMMAND_ID_DOWNLOAD_FILE_WINDOW, 0, (u8*)&window, sizeof(t_file_transfer_window), 0) )
+      s_uFileDownloadLastWindowRequestTime = g_TimeNow;
+   return true;
+}
+
 bool _commands_check_download_file_segments()
 {
    if ( s_bHasCommandInProgress )
@@ -2080,6 +2805,9 @@ bool _commands_check_download_file_segments()
    if ( s_uFileIdToDownload == 0 )
       return false;
 
+   if ( s_bFileDownloadBulk )
+      return _commands_check_download_file_window();
+
    if ( (s_uFileToDownloadState == 1) && (s_uCountFileSegmentsToDownload == 0) )
       return false;
 
@@ -2106,6 +2834,98 @@ bool _commands_check_download_file_segments()
 }
 
 
+bool _commands_check_upload_file_window()
+{
+   u32 uSegmentsCount = g_CurrentUploadingFile.uTotalSegments;
+
+   // Move to the first window that has segments not acknowledged by the vehicle
+   while ( s_uFileUploadWindowStart < uSegmentsCount )
+   {
+      bool bWindowDone = true;
+      int iCount = file_transfer_get_window_segments(s_uFileUploadWindowStart, uSegmentsCount);
+      for( int i=0; i<iCount; i++ )
+      {
+         if ( ! g_CurrentUploadingFile.bSegmentsUploaded[s_uFileUploadWindowStart + i] )
+         {
+            bWindowDone = false;
+            break;
+         }
+      }
+      if ( ! bWindowDone )
+         break;
+      s_uFileUploadWindowStart += FILE_TRANSFER_WINDOW_SEGMENTS;
+      memset(s_uFileUploadSentBitmap, 0, sizeof(s_uFileUploadSentBitmap));
+   }
+
+   if ( s_uFileUploadWindowStart >= uSegmentsCount )
+   {
+      warnings_add(0, "Finished uploading core plugins to vehicle.");
+      g_bHasFileUploadInProgress = false;
+      return false;
+   }
+
+   int iCount = file_transfer_get_window_segments(s_uFileUploadWindowStart, uSegmentsCount);
+   int iRemaining = 0;
+   for( int i=0; i<iCount; i++ )
+   {
+      if ( (! g_CurrentUploadingFile.bSegmentsUploaded[s_uFileUploadWindowStart + i]) && (! file_transfer_bitmap_get(s_uFileUploadSentBitmap, i)) )
+         iRemaining++;
+   }
+
+   // All missing segments were sent and the acknowledge did not come back: send them again
+   if ( 0 == iRemaining )
+   {
+      memset(s_uFileUploadSentBitmap, 0, sizeof(s_uFileUploadSentBitmap));
+      return false;
+   }
+
+   for( int i=0; i<iCount; i++ )
+   {
+      u32 uIndex = s_uFileUploadWindowStart + (u32)i;
+      if ( g_CurrentUploadingFile.bSegmentsUploaded[uIndex] || file_transfer_bitmap_get(s_uFileUploadSentBitmap, i) )
+         continue;
+
+      t_packet_header_file_transfer_segment PHFTS;
+      PHFTS.uFileId = g_CurrentUploadingFile.uFileId;
+      PHFTS.uTransferId = s_uFileUploadTransferId;
+      PHFTS.uFileSize = g_CurrentUploadingFile.currentUploadSegment.uTotalFileSize;
+      PHFTS.uSegmentIndex = uIndex;
+      PHFTS.uSegmentSize = (u16)g_CurrentUploadingFile.currentUploadSegment.uSegmentSize;
+      PHFTS.uFlags = 0;
+
+      u8 buffer[MAX_PACKET_TOTAL_SIZE];
+      u8* pData = buffer + sizeof(t_packet_header_file_transfer_segment);
+      int iSize = (int)g_CurrentUploadingFile.uSegmentsSize[uIndex];
+      int iDataSize = file_transfer_compress(g_CurrentUploadingFile.pSegments[uIndex], iSize, pData, iSize);
+      if ( iDataSize > 0 )
+         PHFTS.uFlags |= FILE_TRANSFER_SEGMENT_FLAG_COMPRESSED;
+      else
+      {
+         memcpy(pData, g_CurrentUploadingFile.pSegments[uIndex], iSize);
+         iDataSize = iSize;
+      }
+      PHFTS.uDataSize = (u16)iDataSize;
+      memcpy(buffer, (u8*)&PHFTS, sizeof(t_packet_header_file_transfer_segment));
+      int iLength = (int)sizeof(t_packet_header_file_transfer_segment) + iDataSize;
+
+      if ( ! file_transfer_pacing_consume(&s_FileUploadPacing, iLength + sizeof(t_packet_header) + sizeof(t_packet_header_command), g_TimeNow) )
+         return false;
+
+      file_transfer_bitmap_set(s_uFileUploadSentBitmap, i);
+      g_CurrentUploadingFile.uTimeLastUploadSegment = g_TimeNow;
+
+      // Last missing segment of the window asks for the window acknowledge
+      if ( 1 == iRemaining )
+      {
+         handle_commands_send_to_vehicle(COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT, 0, buffer, iLength);
+         return true;
+      }
+      handle_commands_send_single_oneway_command(0, COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT, 0, buffer, iLength, 0);
+      iRemaining--;
+   }
+   return false;
+}
+
 bool _commands_check_upload_file_segments()
 {
    if ( s_bHasCommandInProgress )
@@ -2126,6 +2946,9 @@ bool _commands_check_upload_file_segments()
       return false;    
    }
 
+   if ( s_bFileUploadBulk )
+      return _commands_check_upload_file_window();
+
    if ( g_TimeNow < g_CurrentUploadingFile.uTimeLastUploadSegment + 100 )
       return false;
 
@@ -2298,7 +3121,17 @@ void handle_commands_on_response_received(u8* pPacketBuffer, int iLength)
         (pPHCR->command_response_flags & COMMAND_RESPONSE_FLAGS_FAILED_INVALID_PARAMS) )
    {
       s_bLastCommandSucceeded = false;
-      if ( pPHCR->origin_command_type == COMMAND_ID_UPLOAD_FILE_SEGMENT )
+      if ( (pPHCR->origin_command_type == COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT) && (pPHCR->command_response_flags & COMMAND_RESPONSE_FLAGS_UNKNOWN_COMMAND) )
+      {
+         log_line("[Commands] Vehicle does not support bulk file uploads. Upload the file one segment at a time.");
+         s_bFileUploadBulk = false;
+         for( u32 u=0; u<g_CurrentUploadingFile.uTotalSegments; u++ )
+            g_CurrentUploadingFile.bSegmentsUploaded[u] = false;
+         s_CommandType = 0;
+         s_bHasCommandInProgress = false;
+         return;
+      }
+      if ( (pPHCR->origin_command_type == COMMAND_ID_UPLOAD_FILE_SEGMENT) || (pPHCR->origin_command_type == COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT) )
       {
          g_CurrentUploadingFile.uTotalSegments = 0;
          g_bHasFileUploadInProgress = false;
@@ -2436,6 +3269,11 @@ bool handle_commands_send_to_vehicle(u8 commandType, u32 param, u8* pBuffer, int
       s_CommandTimeout = 250;
       s_CommandMaxResendCounter = 10;
    }
+   if ( s_CommandType == COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT )
+   {
+      s_CommandTimeout = 200;
+      s_CommandMaxResendCounter = 10;
+   }
 
    if ( s_CommandType == COMMAND_ID_SET_RADIO_LINK_FLAGS )
    {
@@ -2734,6 +3572,26 @@ void handle_commands_initiate_file_upload(u32 uFileId, const char* szFileName)
    g_CurrentUploadingFile.currentUploadSegment.uSegmentSize = lSegmentSize;
    strncpy(g_CurrentUploadingFile.currentUploadSegment.szFileName, szFileName, 127);
 
+   // The transfer id of bulk uploads is the CRC of the file
+   s_uFileUploadTransferId = 0;
+   s_bFileUploadBulk = false;
+   u8* pFile = (u8*) malloc(lSize);
+   if ( NULL != pFile )
+   {
+      long lPos = 0;
+      for( u32 u=0; u<g_CurrentUploadingFile.uTotalSegments; u++ )
+      {
+         memcpy(pFile + lPos, g_CurrentUploadingFile.pSegments[u], g_CurrentUploadingFile.uSegmentsSize[u]);
+         lPos += g_CurrentUploadingFile.uSegmentsSize[u];
+      }
+      s_uFileUploadTransferId = base_compute_crc32(pFile, (int)lSize);
+      free(pFile);
+      s_bFileUploadBulk = true;
+   }
+   s_uFileUploadWindowStart = 0;
+   memset(s_uFileUploadSentBitmap, 0, sizeof(s_uFileUploadSentBitmap));
+   file_transfer_pacing_init(&s_FileUploadPacing, _commands_get_file_transfer_max_bytes_per_sec(), g_TimeNow);
+
    g_CurrentUploadingFile.uLastSegmentIndexUploaded = 0xFFFFFFFF;
    g_bHasFileUploadInProgress = true;
 }
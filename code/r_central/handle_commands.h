@@ -7,6 +7,8 @@ bool handle_commands_start_on_pairing();
 bool handle_commands_stop_on_pairing();
 
 int handle_commands_on_full_model_settings_received(u32 uVehicleId, int iResponseParam, u8* pData, int iLength);
+void handle_commands_on_model_section_received(u8* pPacketBuffer);
+void handle_commands_on_file_transfer_segment_received(u8* pPacketBuffer);
 u8* handle_commands_get_last_command_response();
 
 void handle_commands_loop();
@@ -34,5 +36,7 @@ void handle_commands_reset_has_received_vehicle_core_plugins_info();
 bool handle_commands_has_received_vehicle_core_plugins_info();
 
 void handle_commands_initiate_file_upload(u32 uFileId, const char* szFileName);
+// True if an interrupted bulk download of this file from the current vehicle can be resumed
+bool handle_commands_has_partial_file_download(u32 uFileId);
 
 bool handle_commands_send_developer_flags(bool bEnableDevMode, u32 uDevFlags);
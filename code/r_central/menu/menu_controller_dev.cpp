@@ -38,6 +38,7 @@
 #include "../../base/utils.h"
 #include "../pairing.h"
 #include "../link_watch.h"
+#include "../osd/osd_profiler.h"
 
 
 
@@ -110,6 +111,13 @@ void MenuControllerDev::addItems()
    m_pItemsSlider[9]->setCurrentValue(pCS->iDevRxLoopTimeout);
    m_IndexRxLoopTimeout = addMenuItem(m_pItemsSlider[9]);
 
+   m_pItemsSelect[17] = new MenuItemSelect("Record Adaptive Video Stats", "Records the link stats used by the predictive adaptive video algorithm to the logs folder (log_adaptive_video.csv), to replay them with test_adaptive_replay. The file is rotated at 4 MB.");
+   m_pItemsSelect[17]->addSelection("No");
+   m_pItemsSelect[17]->addSelection("Yes");
+   m_pItemsSelect[17]->setIsEditable();
+   m_pItemsSelect[17]->setSelectedIndex(pCS->iDevLogAdaptiveVideoStats);
+   m_IndexLogAdaptiveVideoStats = addMenuItem(m_pItemsSelect[17]);
+
    addMenuItem(new MenuItemSection("OSD"));
 
    m_pItemsSelect[3] = new MenuItemSelect("OSD Render FPS", "How often should the OSD be drawn.");
@@ -121,13 +129,18 @@ void MenuControllerDev::addItems()
    m_pItemsSelect[3]->setSelection( (pCS->iRenderFPS-10)/5 );
    m_IndexRenderOSDFSP = addMenuItem(m_pItemsSelect[3]);
 
-   m_pItemsSelect[13] = new MenuItemSelect("Show UI/OSD CPU Usage", "Shows the CPU resources used by the UI and OSD interface.");
+   m_pItemsSelect[13] = new MenuItemSelect("Show UI/OSD CPU Usage", "Shows the CPU resources used by the UI and OSD interface. The profiler shows the time used by each OSD element and menu.");
    m_pItemsSelect[13]->addSelection("No");
    m_pItemsSelect[13]->addSelection("Yes");
+   m_pItemsSelect[13]->addSelection("With Profiler");
    m_pItemsSelect[13]->setIsEditable();
    m_pItemsSelect[13]->setSelectedIndex(pP->iShowCPULoad);
    m_IndexCPULoad = addMenuItem(m_pItemsSelect[13]);
 
+   m_IndexSaveOSDProfiler = -1;
+   if ( 2 == pP->iShowCPULoad )
+      m_IndexSaveOSDProfiler = addMenuItem(new MenuItem("Save OSD Profiler Data", "Saves the recorded UI/OSD frame times to the logs folder (log_osd_profiler.csv)."));
+
    m_pItemsSelect[14] = new MenuItemSelect("Pause OSD", "Pause/Resume OSD using the [Cancel]/[Back] button.");
    m_pItemsSelect[14]->addSelection("No");
    m_pItemsSelect[14]->addSelection("Yes");
@@ -135,6 +148,24 @@ void MenuControllerDev::addItems()
    m_pItemsSelect[14]->setSelectedIndex(pCS->iFreezeOSD);
    m_IndexFreezeOSD = addMenuItem(m_pItemsSelect[14]);
 
+   m_IndexTripleBuffering = -1;
+   m_IndexVideoLowestLatency = -1;
+   #if defined (HW_PLATFORM_RADXA_ZERO3)
+   m_pItemsSelect[15] = new MenuItemSelect("Display Triple Buffering", "Uses three display buffers for the OSD, so drawing a new frame never waits for the display refresh. Uses more memory.");
+   m_pItemsSelect[15]->addSelection("No");
+   m_pItemsSelect[15]->addSelection("Yes");
+   m_pItemsSelect[15]->setIsEditable();
+   m_pItemsSelect[15]->setSelectedIndex(pCS->iDisplayTripleBuffering);
+   m_IndexTripleBuffering = addMenuItem(m_pItemsSelect[15]);
+
+   m_pItemsSelect[16] = new MenuItemSelect("Video Display Mode", "Paced: video frames are shown at the same intervals they were received at. Lowest latency: the newest decoded frame is shown at the next display refresh. Applies when the video player is restarted.");
+   m_pItemsSelect[16]->addSelection("Paced");
+   m_pItemsSelect[16]->addSelection("Lowest latency");
+   m_pItemsSelect[16]->setIsEditable();
+   m_pItemsSelect[16]->setSelectedIndex(pCS->iVideoDisplayLowestLatency);
+   m_IndexVideoLowestLatency = addMenuItem(m_pItemsSelect[16]);
+   #endif
+
    addMenuItem(new MenuItemSection("Other Settings"));
 
    m_IndexVersion = addMenuItem(new MenuItem("Modules versions", "Get all modules versions."));
@@ -241,6 +272,14 @@ void MenuControllerDev::onSelectItem()
       bUpdatedController = true;
    }
 
+   if ( m_IndexLogAdaptiveVideoStats == m_SelectedIndex )
+   {
+      pCS->iDevLogAdaptiveVideoStats = m_pItemsSelect[17]->getSelectedIndex();
+      save_ControllerSettings();
+      send_control_message_to_router(PACKET_TYPE_LOCAL_CONTROL_CONTROLLER_CHANGED, PACKET_COMPONENT_LOCAL_CONTROL);
+      return;
+   }
+
    if ( m_IndexRxLoopTimeout == m_SelectedIndex )
    {
       pCS->iDevRxLoopTimeout = m_pItemsSlider[9]->getCurrentValue();
@@ -260,6 +299,23 @@ void MenuControllerDev::onSelectItem()
       return;
    }
 
+   if ( (-1 != m_IndexTripleBuffering) && (m_IndexTripleBuffering == m_SelectedIndex) )
+   {
+      pCS->iDisplayTripleBuffering = m_pItemsSelect[15]->getSelectedIndex();
+      save_ControllerSettings();
+      // Display buffers are created when the display is initialized
+      ruby_mark_reinit_hdmi_display();
+      return;
+   }
+
+   if ( (-1 != m_IndexVideoLowestLatency) && (m_IndexVideoLowestLatency == m_SelectedIndex) )
+   {
+      pCS->iVideoDisplayLowestLatency = m_pItemsSelect[16]->getSelectedIndex();
+      save_ControllerSettings();
+      send_control_message_to_router(PACKET_TYPE_LOCAL_CONTROL_CONTROLLER_CHANGED, PACKET_COMPONENT_LOCAL_CONTROL);
+      return;
+   }
+
    if ( m_IndexCPULoad == m_SelectedIndex )
    {
       pP->iShowCPULoad = m_pItemsSelect[13]->getSelectedIndex();
@@ -268,6 +324,15 @@ void MenuControllerDev::onSelectItem()
       return;
    }
 
+   if ( (-1 != m_IndexSaveOSDProfiler) && (m_IndexSaveOSDProfiler == m_SelectedIndex) )
+   {
+      if ( osd_profiler_save_csv() )
+         addMessage("Saved OSD profiler data to the logs folder.");
+      else
+         addMessage("No OSD profiler data to save.");
+      return;
+   }
+
    if ( m_IndexFreezeOSD == m_SelectedIndex )
    {
       pCS->iFreezeOSD = m_pItemsSelect[14]->getSelectedIndex();
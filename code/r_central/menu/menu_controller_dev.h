@@ -24,9 +24,13 @@ class MenuControllerDev: public Menu
       int m_IndexPingClockSpeed;
       int m_IndexWiFiChangeDelay;
       int m_IndexRxLoopTimeout;
+      int m_IndexLogAdaptiveVideoStats;
       int m_IndexRenderOSDFSP;
       int m_IndexCPULoad;
+      int m_IndexSaveOSDProfiler;
       int m_IndexFreezeOSD;
+      int m_IndexTripleBuffering;
+      int m_IndexVideoLowestLatency;
       int m_IndexVersion;
       int m_IndexResetDev;
 };
\ No newline at end of file
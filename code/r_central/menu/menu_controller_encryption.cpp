@@ -77,6 +77,7 @@ void MenuControllerEncryption::addItems()
    m_IndexChangePass = addMenuItem(m_pItemPass);
 
    int countEncr = 0;
+   loadAllModelsFull();
    for( int i=0; i<getControllerModelsCount(); i++ )
    {
       Model* pModel = getModelAtIndex(i);
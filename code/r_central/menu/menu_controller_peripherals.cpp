@@ -265,7 +265,7 @@ void MenuControllerPeripherals::valuesToUI()
       bool bFoundSpeed = false;
       for(int n=0; n<m_pItemsSelect[11+i*2]->getSelectionsCount(); n++ )
       {
-         if ( (pInfo->iPortUsage == SERIAL_PORT_USAGE_SIK_RADIO) && (hardware_get_serial_baud_rates()[n] < 57000) )
+         if ( (pInfo->iPortUsage == SERIAL_PORT_USAGE_SIK_RADIO) && ((hardware_get_serial_baud_rates()[n] < 57000) || (hardware_get_serial_baud_rates()[n] > 115200)) )
             m_pItemsSelect[11+i*2]->setSelectionIndexDisabled(n);
          else
             m_pItemsSelect[11+i*2]->setSelectionIndexEnabled(n);
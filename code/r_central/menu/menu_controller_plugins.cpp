@@ -111,6 +111,27 @@ void MenuControllerPlugins::readPlugins()
       addMenuItem(new MenuItemText("No plugins installed on the system."));
    }
 
+   // Render cost of the OSD plugins rendered so far
+   bool bAddedRenderTimes = false;
+   for( int i=0; i<m_iCountOSDPlugins; i++ )
+   {
+      plugin_osd_t* pPluginOSD = osd_plugins_get(i);
+      if ( (NULL == pPluginOSD) || ((0 == pPluginOSD->uCountRenders) && (! pPluginOSD->bSuspended)) )
+         continue;
+      if ( ! bAddedRenderTimes )
+         addMenuItem(new MenuItemSection("OSD Plugins Render Time"));
+      bAddedRenderTimes = true;
+
+      char szBuff[256];
+      if ( pPluginOSD->bSuspended )
+         snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "%s: not responding, hidden until it finishes rendering.", osd_plugins_get_short_name(i));
+      else if ( pPluginOSD->uRenderIntervalMs > 0 )
+         snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "%s: %.1f ms (max %.1f ms), updated every %u ms", osd_plugins_get_short_name(i), pPluginOSD->uAvgRenderMicros/1000.0, pPluginOSD->uMaxRenderMicros/1000.0, pPluginOSD->uRenderIntervalMs);
+      else
+         snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "%s: %.1f ms (max %.1f ms)", osd_plugins_get_short_name(i), pPluginOSD->uAvgRenderMicros/1000.0, pPluginOSD->uMaxRenderMicros/1000.0);
+      addMenuItem(new MenuItemText(szBuff, true));
+   }
+
    addMenuItem(new MenuItemSection("Manage Plugins"));
 
    m_IndexImport = addMenuItem(new MenuItem("Import Plugins", "Import new plugins from a USB memory stick."));
@@ -241,7 +262,10 @@ void MenuControllerPlugins::onSelectItem()
          if ( iAction == 0 )
             pPlugin->nEnabled = 0;
          if ( iAction == 1 )
+         {
             pPlugin->nEnabled = 1;
+            osd_plugins_reset_render_stats(m_IndexSelectedPlugin);
+         }
          save_PluginsSettings();
          valuesToUI();
          return;
@@ -69,6 +69,9 @@ MenuSearch::MenuSearch(void)
 
    m_pModelOriginal = g_pCurrentModel;
 
+   // Search compares found vehicles with all the controller's models
+   loadAllModelsFull();
+
    if ( NULL != g_pCurrentModel )
       log_line("Search open: has a current model: VID %u, name: [%s]", g_pCurrentModel->uVehicleId, g_pCurrentModel->getLongName());
    else
@@ -56,6 +56,7 @@ void MenuSpectator::onShow()
    
    removeAllItems();
    m_IndexSelectedVehicle = -1;
+   loadAllModelsFull();
 
    for( int i=0; i<getControllerModelsSpectatorCount(); i++ )
    {
@@ -85,6 +85,15 @@ MenuSystemDevLogs::MenuSystemDevLogs(void)
    m_pItemsSelect[2]->addSelection("Enabled");
    m_IndexEnableLiveLog = addMenuItem(m_pItemsSelect[2]);
 
+   m_pItemsSelect[8] = new MenuItemSelect("Logs Download Speed", "Maximum speed used to download the vehicle logs, so that the download does not take the bandwidth of the video link.");
+   m_pItemsSelect[8]->addSelection("100 kbps");
+   m_pItemsSelect[8]->addSelection("200 kbps");
+   m_pItemsSelect[8]->addSelection("400 kbps");
+   m_pItemsSelect[8]->addSelection("800 kbps");
+   m_pItemsSelect[8]->addSelection("2 Mbps");
+   m_pItemsSelect[8]->setIsEditable();
+   m_IndexFileTransferSpeed = addMenuItem(m_pItemsSelect[8]);
+
    m_IndexGetVehicleLogs = addMenuItem( new MenuItem("Get Vehicle Logs") );
    m_IndexZipAllLogs = addMenuItem( new MenuItem("Export all logs", "Exports all controller logs and all vehicle logs (that are already downloaded) to a USB memort stick.") );
    m_pMenuItems[m_IndexZipAllLogs]->showArrow();
@@ -99,9 +108,19 @@ MenuSystemDevLogs::MenuSystemDevLogs(void)
    //   m_pMenuItems[i]->setTextColor(get_Color_Dev());
 }
 
+static const int s_iFileTransferSpeedsKbps[] = { 100, 200, 400, 800, 2000 };
+
 void MenuSystemDevLogs::valuesToUI()
 {
    Preferences* pP = get_Preferences();
+   ControllerSettings* pCS = get_ControllerSettings();
+
+   m_pItemsSelect[8]->setSelectedIndex(2);
+   for( int i=0; i<(int)(sizeof(s_iFileTransferSpeedsKbps)/sizeof(s_iFileTransferSpeedsKbps[0])); i++ )
+   {
+      if ( pCS->iFileTransferMaxKbps >= s_iFileTransferSpeedsKbps[i] )
+         m_pItemsSelect[8]->setSelectedIndex(i);
+   }
 
    char szFile[128];
    strcpy(szFile, FOLDER_CONFIG);
@@ -351,9 +370,24 @@ void MenuSystemDevLogs::onSelectItem()
          valuesToUI();  
    }
 
+   if ( m_IndexFileTransferSpeed == m_SelectedIndex )
+   {
+      ControllerSettings* pCS = get_ControllerSettings();
+      int iIndex = m_pItemsSelect[8]->getSelectedIndex();
+      if ( (iIndex >= 0) && (iIndex < (int)(sizeof(s_iFileTransferSpeedsKbps)/sizeof(s_iFileTransferSpeedsKbps[0]))) )
+         pCS->iFileTransferMaxKbps = s_iFileTransferSpeedsKbps[iIndex];
+      save_ControllerSettings();
+      valuesToUI();
+      return;
+   }
+
    if ( m_IndexGetVehicleLogs == m_SelectedIndex )
    {
-      if ( ! handle_commands_send_to_vehicle(COMMAND_ID_DOWNLOAD_FILE, FILE_ID_VEHICLE_LOGS_ARCHIVE, NULL, 0) )
+      // Continue an interrupted download, if any: the vehicle keeps the logs archive it already made
+      u32 uParam = FILE_ID_VEHICLE_LOGS_ARCHIVE;
+      if ( handle_commands_has_partial_file_download(FILE_ID_VEHICLE_LOGS_ARCHIVE) )
+         uParam |= COMMAND_DOWNLOAD_FILE_FLAG_RESUME;
+      if ( ! handle_commands_send_to_vehicle(COMMAND_ID_DOWNLOAD_FILE, uParam, NULL, 0) )
          valuesToUI();
       else
          menu_discard_all();
@@ -25,6 +25,7 @@ class MenuSystemDevLogs: public Menu
       int m_IndexLogLevelVehicle;
       int m_IndexLogLevelController;
       int m_IndexEnableLiveLog;
+      int m_IndexFileTransferSpeed;
       int m_IndexGetVehicleLogs;
       int m_IndexZipAllLogs;
       int m_IndexClearControllerLogs;
@@ -149,6 +149,7 @@ MenuSystemExpert::MenuSystemExpert(void)
    m_pItemsSelect[13] = new MenuItemSelect("Show UI/OSD CPU Usage", "Shows the CPU resources used by the UI and OSD interface.");
    m_pItemsSelect[13]->addSelection("No");
    m_pItemsSelect[13]->addSelection("Yes");
+   m_pItemsSelect[13]->addSelection("With Profiler");
    m_pItemsSelect[13]->setUseMultiViewLayout();
    m_IndexCPULoad = addMenuItem(m_pItemsSelect[13]);
 
@@ -200,7 +200,7 @@ void MenuVehiclePeripherals::valuesToUI()
       bool bFoundSpeed = false;
       for(int n=0; n<m_pItemsSelect[i*2+1]->getSelectionsCount(); n++ )
       {
-         if ( (uUsage == SERIAL_PORT_USAGE_SIK_RADIO) && (hardware_get_serial_baud_rates()[n] < 57000) )
+         if ( (uUsage == SERIAL_PORT_USAGE_SIK_RADIO) && ((hardware_get_serial_baud_rates()[n] < 57000) || (hardware_get_serial_baud_rates()[n] > 115200)) )
             m_pItemsSelect[i*2+1]->setSelectionIndexDisabled(n);
          else
             m_pItemsSelect[i*2+1]->setSelectionIndexEnabled(n);
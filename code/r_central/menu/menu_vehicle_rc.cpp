@@ -156,6 +156,12 @@ MenuVehicleRC::MenuVehicleRC(void)
    m_pItemsSelect[2]->setIsEditable();
    m_IndexRCFrames = addMenuItem(m_pItemsSelect[2]);
 
+   m_pItemsSelect[6] = new MenuItemSelect("Low Latency RC Path", "RC frames skip the controller radio queue and are sent to the flight controller as soon as they reach the vehicle. Uses more CPU on the controller and on the vehicle.");
+   m_pItemsSelect[6]->addSelection("Disabled");
+   m_pItemsSelect[6]->addSelection("Enabled");
+   m_pItemsSelect[6]->setIsEditable();
+   m_IndexLowLatencyPath = addMenuItem(m_pItemsSelect[6]);
+
    m_IndexChannels = addMenuItem(new MenuItem("Channels Assignment", "Change which RC channels are assigned to which sticks, joysticks and buttons."));
    m_pMenuItems[m_IndexChannels]->showArrow();
 
@@ -251,6 +257,7 @@ void MenuVehicleRC::updateUIState(bool bEnable)
    ControllerInterfacesSettings* pCI = get_ControllerInterfacesSettings();
    m_pItemsSelect[1]->setEnabled(bEnable);
    m_pItemsSelect[2]->setEnabled(bEnable);
+   m_pItemsSelect[6]->setEnabled(bEnable);
    m_pItemsSlider[0]->setEnabled(bEnable);
    m_pMenuItems[m_IndexChannels]->setEnabled(bEnable);
    m_pMenuItems[m_IndexExpo]->setEnabled(bEnable);
@@ -288,6 +295,7 @@ void MenuVehicleRC::valuesToUI()
    m_pItemsSelect[1]->setSelection(index);
 
    m_pItemsSelect[2]->setSelection(g_pCurrentModel->rc_params.rc_frames_per_second/5-1);
+   m_pItemsSelect[6]->setSelectedIndex((g_pCurrentModel->rc_params.flags & RC_FLAGS_LOW_LATENCY_PATH)?1:0);
 
    m_pItemsSlider[0]->setCurrentValue(g_pCurrentModel->rc_params.rc_failsafe_timeout_ms);
 
@@ -1111,6 +1119,20 @@ void MenuVehicleRC::onSelectItem()
          valuesToUI();
    }
 
+   if ( m_IndexLowLatencyPath == m_SelectedIndex )
+   {
+      rc_parameters_t params;
+      memcpy(&params, &g_pCurrentModel->rc_params, sizeof(rc_parameters_t));
+      if ( 0 == m_pItemsSelect[6]->getSelectedIndex() )
+         params.flags &= ~RC_FLAGS_LOW_LATENCY_PATH;
+      else
+         params.flags |= RC_FLAGS_LOW_LATENCY_PATH;
+      if ( params.flags == g_pCurrentModel->rc_params.flags )
+         return;
+      if ( ! handle_commands_send_to_vehicle(COMMAND_ID_SET_RC_PARAMS, 0, (u8*)&params, sizeof(rc_parameters_t)) )
+         valuesToUI();
+   }
+
    if ( m_IndexFailsafeTime == m_SelectedIndex )
    {
       int timeout = m_pItemsSlider[0]->getCurrentValue();
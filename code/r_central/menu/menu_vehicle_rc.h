@@ -52,6 +52,7 @@ class MenuVehicleRC: public Menu
       int m_IndexRCInputType;
       int m_IndexHIDPrimary;
       int m_IndexRCFrames;
+      int m_IndexLowLatencyPath;
       int m_IndexChannelsCount;
       int m_IndexChannels;
       int m_IndexThrotleReverse;
@@ -108,6 +108,7 @@ void MenuVehicleRelay::onShow()
    sprintf(szBuff, "Selects the vehicle to relay using the currently active vehicle: %s.", g_pCurrentModel->getLongName());
    m_pItemsSelect[0] = new MenuItemSelect("Vehicle To Relay", szBuff);  
    m_pItemsSelect[0]->addSelection("None");
+   loadAllModelsFull();
    for( int i=0; i<getControllerModelsCount(); i++ )
    {
       Model *pModel = getModelAtIndex(i);
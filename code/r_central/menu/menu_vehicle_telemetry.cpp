@@ -77,6 +77,12 @@ MenuVehicleTelemetry::MenuVehicleTelemetry(void)
    m_pItemsSelect[11]->setIsEditable();
    m_IndexAlwaysArmed = addMenuItem(m_pItemsSelect[11]);
 
+   m_pItemsSelect[12] = new MenuItemSelect("Shape MAVLink downlink", "Limits the rate of the high rate MAVLink messages (attitude, position, sensors) sent back to the controller, keeping only the latest values. Parameters, missions and commands are not affected.");
+   m_pItemsSelect[12]->addSelection("No");
+   m_pItemsSelect[12]->addSelection("Yes");
+   m_pItemsSelect[12]->setIsEditable();
+   m_IndexShapeMAVLink = addMenuItem(m_pItemsSelect[12]);
+
    addSeparator();
 
    m_pItemsSelect[1] = new MenuItemSelect("Vehicle Serial Port", "The Ruby vehicle port at which the flight controller connects to.");
@@ -162,6 +168,8 @@ void MenuVehicleTelemetry::valuesToUI()
    m_pItemsSelect[8]->setSelection(g_pCurrentModel->iGPSCount);
 
    m_pItemsSelect[11]->setSelection((g_pCurrentModel->telemetry_params.flags & TELEMETRY_FLAGS_FORCE_ARMED)?1:0);
+   m_pItemsSelect[12]->setSelection((g_pCurrentModel->telemetry_params.flags & TELEMETRY_FLAGS_DONT_SHAPE_MAVLINK_DOWNLINK)?0:1);
+   m_pItemsSelect[12]->setEnabled(g_pCurrentModel->telemetry_params.fc_telemetry_type == TELEMETRY_TYPE_MAVLINK);
 
    m_pItemsRange[0]->setCurrentValue(g_pCurrentModel->telemetry_params.controller_mavlink_id);
    if ( g_pCurrentModel->telemetry_params.fc_telemetry_type == TELEMETRY_TYPE_NONE )
@@ -387,6 +395,20 @@ void MenuVehicleTelemetry::onSelectItem()
          valuesToUI();    
    }
 
+   if ( m_IndexShapeMAVLink == m_SelectedIndex )
+   {
+      telemetry_parameters_t params;
+      memcpy(&params, &g_pCurrentModel->telemetry_params, sizeof(telemetry_parameters_t));
+   
+      if ( 0 == m_pItemsSelect[12]->getSelectedIndex() )
+         params.flags |= TELEMETRY_FLAGS_DONT_SHAPE_MAVLINK_DOWNLINK;
+      else
+         params.flags &= (~TELEMETRY_FLAGS_DONT_SHAPE_MAVLINK_DOWNLINK);
+  
+      if ( ! handle_commands_send_to_vehicle(COMMAND_ID_SET_TELEMETRY_PARAMETERS, 0, (u8*)&params, sizeof(telemetry_parameters_t)) )
+         valuesToUI();
+   }
+
    if ( m_IndexTelemetryNoFCMessages == m_SelectedIndex )
    {
       telemetry_parameters_t params;
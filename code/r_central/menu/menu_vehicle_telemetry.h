@@ -24,6 +24,7 @@ class MenuVehicleTelemetry: public Menu
       int m_IndexTelemetryRequestStreams;
       int m_IndexTelemetryControllerSysId;
       int m_IndexAlwaysArmed;
+      int m_IndexShapeMAVLink;
       int m_IndexInfoSysId;
       int m_IndexRemoveDuplicateMsg;
       int m_IndexRUpdateRate;
@@ -90,9 +90,9 @@ MenuVehicleVideoBidirectional::MenuVehicleVideoBidirectional(void)
    m_pItemsSelect[5]->setMargin(dxMargin);
    m_IndexAdaptiveVideoLevel = addMenuItem(m_pItemsSelect[5]);
 
-   m_pItemsSelect[0] = new MenuItemSelect("Algorithm", "Change the way adaptive video works.");
+   m_pItemsSelect[0] = new MenuItemSelect("Algorithm", "Change the way adaptive video works. Default: step the video level up/down based on recent link problems. Predictive: estimate the link loss and its trend and pick the video level expected to keep the video latency low.");
    m_pItemsSelect[0]->addSelection("Default");
-   m_pItemsSelect[0]->addSelection("New");
+   m_pItemsSelect[0]->addSelection("Predictive");
    m_pItemsSelect[0]->setIsEditable();
    m_pItemsSelect[0]->setMargin(dxMargin);
    m_IndexAdaptiveAlgorithm = addMenuItem(m_pItemsSelect[0]);
@@ -132,7 +132,6 @@ void MenuVehicleVideoBidirectional::valuesToUI()
       adaptiveVideo = 0;
 
    m_pItemsSelect[0]->setSelection( (g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_NEW_ADAPTIVE_ALGORITHM)?1:0);
-   m_pItemsSelect[0]->setEnabled(false);
    if (adaptiveKeyframe && (! g_pCurrentModel->isVideoLinkFixedOneWay()) )
    {
       m_pItemsSelect[1]->setSelectedIndex(1);
@@ -161,6 +160,7 @@ void MenuVehicleVideoBidirectional::valuesToUI()
    {
       m_pItemsSelect[2]->setSelectedIndex(1);
       m_pItemsSelect[5]->setEnabled(true);
+      m_pItemsSelect[0]->setEnabled(true);
       m_pItemsSlider[0]->setEnabled(true);
       m_pItemsSelect[9]->setEnabled(true);
       m_pItemsSelect[10]->setEnabled(true);
@@ -178,6 +178,7 @@ void MenuVehicleVideoBidirectional::valuesToUI()
    {
       m_pItemsSelect[2]->setSelectedIndex(0);
       m_pItemsSelect[5]->setEnabled(false);
+      m_pItemsSelect[0]->setEnabled(false);
       m_pItemsSlider[0]->setEnabled(false);
       m_pItemsSelect[9]->setEnabled(false);
       m_pItemsSelect[10]->setEnabled(false);
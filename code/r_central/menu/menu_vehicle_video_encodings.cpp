@@ -112,6 +112,18 @@ MenuVehicleVideoEncodings::MenuVehicleVideoEncodings(void)
    m_pItemsSelect[19]->setIsEditable();
    m_IndexECSchemeSpread = addMenuItem(m_pItemsSelect[19]);
 
+   m_pItemsSelect[20] = new MenuItemSelect("Packetization", "Fixed size fills each video packet completely. NAL aligned starts each video packet at a new slice or frame, so a lost packet damages only one slice, at the cost of some padding.");
+   m_pItemsSelect[20]->addSelection("Fixed size");
+   m_pItemsSelect[20]->addSelection("NAL aligned");
+   m_pItemsSelect[20]->setIsEditable();
+   m_IndexNALAlignedPackets = addMenuItem(m_pItemsSelect[20]);
+
+   m_pItemsSelect[21] = new MenuItemSelect("Frame Priority", "Sends I-frames at a more robust radio datarate and, when the radio link is congested, drops error correction and retransmissions of non reference frames first.");
+   m_pItemsSelect[21]->addSelection("Off");
+   m_pItemsSelect[21]->addSelection("On");
+   m_pItemsSelect[21]->setIsEditable();
+   m_IndexFramePriority = addMenuItem(m_pItemsSelect[21]);
+
    addMenuItem(new MenuItemSection("H264 Encoder Settings"));
 
    m_pItemsSelect[4] = new MenuItemSelect("H264 Profile", "The higher the H264 profile, the higher the CPU usage on encode and decode and higher the end to end video latencey. Higher profiles can have lower video quality as more compression algorithms are used.");
@@ -197,6 +209,8 @@ void MenuVehicleVideoEncodings::valuesToUI()
    u32 uECSpread = uECSpreadLow + (uECSpreadHigh*2);
 
    m_pItemsSelect[19]->setSelectedIndex((int) uECSpread);
+   m_pItemsSelect[20]->setSelectedIndex((g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_NAL_ALIGNED_PACKETS)?1:0);
+   m_pItemsSelect[21]->setSelectedIndex((g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_FRAME_PRIORITY_CLASSES)?1:0);
 
    m_pItemsSelect[4]->setSelectedIndex((g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_ENABLE_LOCAL_HDMI_OUTPUT)?1:0);
 
@@ -481,6 +495,44 @@ void MenuVehicleVideoEncodings::onSelectItem()
    if ( m_IndexH264Headers == m_SelectedIndex )
       sendVideoLinkProfile();
 
+   if ( m_IndexNALAlignedPackets == m_SelectedIndex )
+   {
+      video_parameters_t paramsOld;
+      memcpy(&paramsOld, &g_pCurrentModel->video_params, sizeof(video_parameters_t));
+      int index = m_pItemsSelect[20]->getSelectedIndex();
+      if ( index == 0 )
+         g_pCurrentModel->video_params.uVideoExtraFlags &= ~(VIDEO_FLAG_NAL_ALIGNED_PACKETS);
+      else
+         g_pCurrentModel->video_params.uVideoExtraFlags |= VIDEO_FLAG_NAL_ALIGNED_PACKETS;
+
+      video_parameters_t paramsNew;
+      memcpy(&paramsNew, &g_pCurrentModel->video_params, sizeof(video_parameters_t));
+      memcpy(&g_pCurrentModel->video_params, &paramsOld, sizeof(video_parameters_t));
+
+      if ( ! handle_commands_send_to_vehicle(COMMAND_ID_SET_VIDEO_PARAMS, 0, (u8*)&paramsNew, sizeof(video_parameters_t)) )
+         valuesToUI();
+      return;
+   }
+
+   if ( m_IndexFramePriority == m_SelectedIndex )
+   {
+      video_parameters_t paramsOld;
+      memcpy(&paramsOld, &g_pCurrentModel->video_params, sizeof(video_parameters_t));
+      int index = m_pItemsSelect[21]->getSelectedIndex();
+      if ( index == 0 )
+         g_pCurrentModel->video_params.uVideoExtraFlags &= ~(VIDEO_FLAG_FRAME_PRIORITY_CLASSES);
+      else
+         g_pCurrentModel->video_params.uVideoExtraFlags |= VIDEO_FLAG_FRAME_PRIORITY_CLASSES;
+
+      video_parameters_t paramsNew;
+      memcpy(&paramsNew, &g_pCurrentModel->video_params, sizeof(video_parameters_t));
+      memcpy(&g_pCurrentModel->video_params, &paramsOld, sizeof(video_parameters_t));
+
+      if ( ! handle_commands_send_to_vehicle(COMMAND_ID_SET_VIDEO_PARAMS, 0, (u8*)&paramsNew, sizeof(video_parameters_t)) )
+         valuesToUI();
+      return;
+   }
+
    if ( m_IndexH264SPSTimings == m_SelectedIndex )
    {
       video_parameters_t paramsOld;
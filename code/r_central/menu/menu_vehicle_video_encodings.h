@@ -17,6 +17,8 @@ class MenuVehicleVideoEncodings: public Menu
 
       int m_IndexPacketSize, m_IndexBlockPackets, m_IndexBlockFECs, m_IndexECSchemeSpread;
       int m_IndexDataRate;
+      int m_IndexNALAlignedPackets;
+      int m_IndexFramePriority;
       int m_IndexH264Profile, m_IndexH264Level, m_IndexH264Refresh, m_IndexH264Headers;
       int m_IndexH264SPSTimings;
       int m_IndexH264Slices;
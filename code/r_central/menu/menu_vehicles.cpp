@@ -69,6 +69,7 @@ void MenuVehicles::onShow()
 
    log_line("[Menu] MenuVehicles: Last selected vehicle index: %d", m_iLastSelectedVehicle);
    m_IndexSelectedVehicle = -1;
+   loadAllModelsFull();
 
    addTopLine("Select the vehicle to control:");
    bool bCurrentVehicleFound = false;
@@ -39,6 +39,7 @@
 #include "osd_plugins.h"
 #include "osd_links.h"
 #include "osd_widgets.h"
+#include "osd_profiler.h"
 #include "../../common/string_utils.h"
 #include "../../../mavlink/common/mavlink.h"
 #include <math.h>
@@ -2766,7 +2767,11 @@ void osd_render_all()
    osd_set_colors();
 
    if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_ENABLED )
+   {
+      osd_profiler_begin("elements");
       osd_render_elements();
+      osd_profiler_end();
+   }
 
    // Set again default OSD colors as OSD elements might have just flashed (yellow)
 
@@ -2775,17 +2780,30 @@ void osd_render_all()
    osd_set_colors();
 
    if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_ENABLED )
+   {
+      osd_profiler_begin("instruments");
       osd_render_instruments();
+      osd_profiler_end();
+   }
 
-
+   osd_profiler_begin("widgets");
    osd_widgets_render(pModel->uVehicleId, osd_get_current_layout_index());
+   osd_profiler_end();
+   osd_profiler_begin("plugins");
    osd_plugins_render();
+   osd_profiler_end();
    g_pRenderEngine->drawBackgroundBoundingBoxes(false);
 
    if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_ENABLED )
+   {
+      osd_profiler_begin("stats");
       osd_render_stats();
+      osd_profiler_end();
+   }
      
+   osd_profiler_begin("warnings");
    osd_render_warnings();
+   osd_profiler_end();
    
    if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_ENABLED )
    if ( (NULL != p) && (p->iShowProcessesMonitor) )
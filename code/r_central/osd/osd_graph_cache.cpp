@@ -0,0 +1,270 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../../base/base.h"
+#include <math.h>
+#include "../../renderer/render_engine.h"
+#include "../shared_vars.h"
+#include "osd_graph_cache.h"
+
+void osd_graph_cache_init(type_osd_graph_cache* pGraph)
+{
+   if ( NULL == pGraph )
+      return;
+   memset(pGraph, 0, sizeof(type_osd_graph_cache));
+   pGraph->pPixels = NULL;
+}
+
+void osd_graph_cache_free(type_osd_graph_cache* pGraph)
+{
+   if ( NULL == pGraph )
+      return;
+   if ( NULL != pGraph->pPixels )
+      free(pGraph->pPixels);
+   osd_graph_cache_init(pGraph);
+}
+
+bool osd_graph_cache_begin(type_osd_graph_cache* pGraph, float fWidth, float fHeight, int iColumns, u32 uScaleKey)
+{
+   if ( (NULL == pGraph) || (NULL == g_pRenderEngine) || (! g_pRenderEngine->canDrawBitmaps()) )
+      return false;
+
+   int iPixelWidth = fWidth / g_pRenderEngine->getPixelWidth();
+   int iPixelHeight = fHeight / g_pRenderEngine->getPixelHeight();
+   if ( (iPixelWidth <= 0) || (iPixelHeight <= 0) || (iColumns <= 0) || (iColumns > OSD_GRAPH_CACHE_MAX_COLUMNS) )
+      return false;
+
+   pGraph->iColumnsDrawnLastFrame = 0;
+
+   bool bRebuild = false;
+   if ( (iPixelWidth != pGraph->iPixelWidth) || (iPixelHeight != pGraph->iPixelHeight) || (NULL == pGraph->pPixels) )
+   {
+      if ( NULL != pGraph->pPixels )
+         free(pGraph->pPixels);
+      pGraph->pPixels = (u32*) malloc(iPixelWidth * iPixelHeight * sizeof(u32));
+      pGraph->iPixelWidth = 0;
+      pGraph->iPixelHeight = 0;
+      if ( NULL == pGraph->pPixels )
+      {
+         log_softerror_and_alarm("[OSDGraphCache] Failed to allocate graph bitmap (%d x %d px).", iPixelWidth, iPixelHeight);
+         return false;
+      }
+      pGraph->iPixelWidth = iPixelWidth;
+      pGraph->iPixelHeight = iPixelHeight;
+      bRebuild = true;
+   }
+
+   if ( (iColumns != pGraph->iColumns) || (uScaleKey != pGraph->uScaleKey) )
+      bRebuild = true;
+
+   if ( bRebuild )
+   {
+      memset(pGraph->pPixels, 0, pGraph->iPixelWidth * pGraph->iPixelHeight * sizeof(u32));
+      memset(pGraph->bColumnValid, 0, sizeof(pGraph->bColumnValid));
+      pGraph->iColumns = iColumns;
+      pGraph->uScaleKey = uScaleKey;
+   }
+   return true;
+}
+
+int osd_graph_cache_get_column_start(type_osd_graph_cache* pGraph, int iColumn)
+{
+   return (iColumn * pGraph->iPixelWidth) / pGraph->iColumns;
+}
+
+int osd_graph_cache_get_column_end(type_osd_graph_cache* pGraph, int iColumn)
+{
+   return ((iColumn+1) * pGraph->iPixelWidth) / pGraph->iColumns;
+}
+
+bool osd_graph_cache_column_changed(type_osd_graph_cache* pGraph, int iColumn, u32 uColumnKey)
+{
+   return osd_graph_cache_column_data_changed(pGraph, iColumn, (u8*)&uColumnKey, sizeof(u32));
+}
+
+bool osd_graph_cache_column_data_changed(type_osd_graph_cache* pGraph, int iColumn, const u8* pKeyData, int iKeyLength)
+{
+   if ( (NULL == pGraph) || (NULL == pGraph->pPixels) || (iColumn < 0) || (iColumn >= pGraph->iColumns) )
+      return false;
+
+   if ( (NULL == pKeyData) || (iKeyLength <= 0) || (iKeyLength > OSD_GRAPH_CACHE_MAX_KEY_BYTES) )
+      pGraph->bColumnValid[iColumn] = false;
+   else
+   {
+      if ( pGraph->bColumnValid[iColumn] && (pGraph->uColumnKeysLength[iColumn] == iKeyLength) )
+      if ( 0 == memcmp(pGraph->uColumnKeys[iColumn], pKeyData, iKeyLength) )
+         return false;
+      memcpy(pGraph->uColumnKeys[iColumn], pKeyData, iKeyLength);
+      pGraph->uColumnKeysLength[iColumn] = (u8)iKeyLength;
+      pGraph->bColumnValid[iColumn] = true;
+   }
+   pGraph->iColumnsDrawnLastFrame++;
+
+   int xStart = osd_graph_cache_get_column_start(pGraph, iColumn);
+   int xEnd = osd_graph_cache_get_column_end(pGraph, iColumn);
+   if ( xEnd > xStart )
+   for( int y=0; y<pGraph->iPixelHeight; y++ )
+      memset(pGraph->pPixels + y*pGraph->iPixelWidth + xStart, 0, (xEnd-xStart)*sizeof(u32));
+   return true;
+}
+
+// Blends a premultiplied pixel over a premultiplied pixel
+static inline u32 _osd_graph_cache_blend(u32 uDest, u32 uSrc)
+{
+   u32 uAlpha = uSrc >> 24;
+   if ( 255 == uAlpha )
+      return uSrc;
+   u32 uInv = 255 - uAlpha;
+   u32 uRB = (((uDest & 0x00FF00FF) * uInv) >> 8) & 0x00FF00FF;
+   u32 uAG = (((uDest >> 8) & 0x00FF00FF) * uInv) & 0xFF00FF00;
+   return uSrc + uRB + uAG;
+}
+
+static void _osd_graph_cache_fill_span(type_osd_graph_cache* pGraph, int iColumn, int x, int y, int w, int h, u32 uPixel)
+{
+   int xStart = osd_graph_cache_get_column_start(pGraph, iColumn);
+   int xEnd = osd_graph_cache_get_column_end(pGraph, iColumn);
+   if ( x < xStart )
+   {
+      w -= xStart - x;
+      x = xStart;
+   }
+   if ( x + w > xEnd )
+      w = xEnd - x;
+   if ( y < 0 )
+   {
+      h += y;
+      y = 0;
+   }
+   if ( y + h > pGraph->iPixelHeight )
+      h = pGraph->iPixelHeight - y;
+   if ( (w <= 0) || (h <= 0) )
+      return;
+
+   for( int yy=y; yy<y+h; yy++ )
+   {
+      u32* pLine = pGraph->pPixels + yy*pGraph->iPixelWidth + x;
+      for( int xx=0; xx<w; xx++ )
+         pLine[xx] = _osd_graph_cache_blend(pLine[xx], uPixel);
+   }
+}
+
+void osd_graph_cache_fill_rect(type_osd_graph_cache* pGraph, int iColumn, float x, float y, float w, float h, u32 uPixel)
+{
+   if ( (NULL == pGraph) || (NULL == pGraph->pPixels) || (iColumn < 0) || (iColumn >= pGraph->iColumns) )
+      return;
+   int ix = (int)x;
+   int iy = (int)y;
+   _osd_graph_cache_fill_span(pGraph, iColumn, ix, iy, (int)(x+w) - ix, (int)(y+h) - iy, uPixel);
+}
+
+void osd_graph_cache_draw_line(type_osd_graph_cache* pGraph, int iColumn, float x1, float y1, float x2, float y2, int iThickness, u32 uPixel)
+{
+   if ( (NULL == pGraph) || (NULL == pGraph->pPixels) || (iColumn < 0) || (iColumn >= pGraph->iColumns) )
+      return;
+   if ( iThickness < 1 )
+      iThickness = 1;
+   if ( x2 < x1 )
+   {
+      float f = x1; x1 = x2; x2 = f;
+      f = y1; y1 = y2; y2 = f;
+   }
+
+   int iHalf = iThickness/2;
+   if ( x2 - x1 < 1.0 )
+   {
+      int iy1 = (int)((y1 < y2)?y1:y2);
+      int iy2 = (int)((y1 < y2)?y2:y1);
+      _osd_graph_cache_fill_span(pGraph, iColumn, (int)x1 - iHalf, iy1 - iHalf, iThickness, iy2 - iy1 + iThickness, uPixel);
+      return;
+   }
+
+   // Only the part of the line inside the column is drawn, one vertical span for each pixel column
+   int xStart = osd_graph_cache_get_column_start(pGraph, iColumn);
+   int xEnd = osd_graph_cache_get_column_end(pGraph, iColumn);
+   int ix1 = (int)x1;
+   int ix2 = (int)x2;
+   if ( ix1 < xStart - iThickness )
+      ix1 = xStart - iThickness;
+   if ( ix2 > xEnd + iThickness )
+      ix2 = xEnd + iThickness;
+
+   float fSlope = (y2-y1)/(x2-x1);
+   for( int x=ix1; x<=ix2; x++ )
+   {
+      float fxA = (x < x1)?x1:(float)x;
+      float fxB = (x+1 > x2)?x2:(float)(x+1);
+      float yA = y1 + (fxA-x1)*fSlope;
+      float yB = y1 + (fxB-x1)*fSlope;
+      int iyTop = (int)((yA < yB)?yA:yB);
+      int iyBottom = (int)((yA < yB)?yB:yA);
+      _osd_graph_cache_fill_span(pGraph, iColumn, x, iyTop - iHalf, 1, iyBottom - iyTop + iThickness, uPixel);
+   }
+}
+
+void osd_graph_cache_draw_dotted_hline(type_osd_graph_cache* pGraph, int iColumn, float y, u32 uPixel)
+{
+   if ( (NULL == pGraph) || (NULL == pGraph->pPixels) || (iColumn < 0) || (iColumn >= pGraph->iColumns) )
+      return;
+   int iy = (int)y;
+   if ( (iy < 0) || (iy >= pGraph->iPixelHeight) )
+      return;
+   int xStart = osd_graph_cache_get_column_start(pGraph, iColumn);
+   int xEnd = osd_graph_cache_get_column_end(pGraph, iColumn);
+   u32* pLine = pGraph->pPixels + iy*pGraph->iPixelWidth;
+   for( int x=xStart; x<xEnd; x++ )
+   {
+      if ( (x % 5) <= 2 )
+         pLine[x] = _osd_graph_cache_blend(pLine[x], uPixel);
+   }
+}
+
+void osd_graph_cache_draw(type_osd_graph_cache* pGraph, float xPos, float yPos)
+{
+   if ( (NULL == pGraph) || (NULL == pGraph->pPixels) || (NULL == g_pRenderEngine) )
+      return;
+   g_pRenderEngine->drawBitmap(xPos, yPos, pGraph->pPixels, pGraph->iPixelWidth, pGraph->iPixelHeight);
+}
+
+u32 osd_graph_cache_key(u32 uKey, u32 uValue)
+{
+   return (uKey ^ uValue) * 16777619u;
+}
+
+// Color components are in 0...255 range and alpha in 0...1 range, same as for the render engine setFill/setStroke
+u32 osd_graph_cache_pixel(float r, float g, float b, float a)
+{
+   if ( a < 0.0 )
+      a = 0.0;
+   if ( a > 1.0 )
+      a = 1.0;
+   return g_pRenderEngine->makeBitmapPixel((u8)r, (u8)g, (u8)b, (u8)(a*255.0));
+}
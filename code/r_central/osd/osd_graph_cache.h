@@ -0,0 +1,51 @@
+#pragma once
+#include "../../base/base.h"
+
+// Cached OSD graphs: the graph content (bars, lines, grid) is rasterized into a bitmap that is kept between frames
+// and blitted once per frame. Each column of the graph has a key computed from the history values drawn in it;
+// only the columns whose key changed (new history slices) are drawn again. The whole bitmap is rebuilt only when
+// the graph size, the number of columns or the scale changes.
+// Column keys are compared as is, not hashed, so different history values never match.
+// Coordinates used by the draw functions are in pixels, relative to the top left corner of the graph.
+
+#define OSD_GRAPH_CACHE_MAX_COLUMNS 512
+#define OSD_GRAPH_CACHE_KEY_START 2166136261u
+#define OSD_GRAPH_CACHE_MAX_KEY_BYTES 72
+
+typedef struct
+{
+   int iPixelWidth;
+   int iPixelHeight;
+   int iColumns;
+   u32 uScaleKey;
+   u32* pPixels;
+   u8 uColumnKeys[OSD_GRAPH_CACHE_MAX_COLUMNS][OSD_GRAPH_CACHE_MAX_KEY_BYTES];
+   u8 uColumnKeysLength[OSD_GRAPH_CACHE_MAX_COLUMNS];
+   bool bColumnValid[OSD_GRAPH_CACHE_MAX_COLUMNS];
+   int iColumnsDrawnLastFrame;
+} type_osd_graph_cache;
+
+void osd_graph_cache_init(type_osd_graph_cache* pGraph);
+void osd_graph_cache_free(type_osd_graph_cache* pGraph);
+
+// Returns false if the graph can't be cached (render engine can't draw bitmaps or invalid size).
+// The caller must then draw the graph using the render engine vector functions.
+bool osd_graph_cache_begin(type_osd_graph_cache* pGraph, float fWidth, float fHeight, int iColumns, u32 uScaleKey);
+
+// Returns true if the column must be drawn (the key changed or the cache was rebuilt). The column is cleared.
+bool osd_graph_cache_column_changed(type_osd_graph_cache* pGraph, int iColumn, u32 uColumnKey);
+// Same, for keys longer than 32 bits (up to OSD_GRAPH_CACHE_MAX_KEY_BYTES; longer keys always redraw the column)
+bool osd_graph_cache_column_data_changed(type_osd_graph_cache* pGraph, int iColumn, const u8* pKeyData, int iKeyLength);
+int osd_graph_cache_get_column_start(type_osd_graph_cache* pGraph, int iColumn);
+int osd_graph_cache_get_column_end(type_osd_graph_cache* pGraph, int iColumn);
+
+// Draw functions only change pixels inside the column iColumn
+void osd_graph_cache_fill_rect(type_osd_graph_cache* pGraph, int iColumn, float x, float y, float w, float h, u32 uPixel);
+void osd_graph_cache_draw_line(type_osd_graph_cache* pGraph, int iColumn, float x1, float y1, float x2, float y2, int iThickness, u32 uPixel);
+void osd_graph_cache_draw_dotted_hline(type_osd_graph_cache* pGraph, int iColumn, float y, u32 uPixel);
+
+void osd_graph_cache_draw(type_osd_graph_cache* pGraph, float xPos, float yPos);
+
+// Hash used for the scale key of a graph
+u32 osd_graph_cache_key(u32 uKey, u32 uValue);
+u32 osd_graph_cache_pixel(float r, float g, float b, float a);
@@ -41,23 +41,246 @@
 #include "../../radio/radiolink.h"
 #include "../../radio/radiopackets2.h"
 #include "../../renderer/render_engine.h"
+#include "../../renderer/render_engine_ui_commands.h"
 #include "../pairing.h"
 #include "../ruby_central.h"
 #include "../local_stats.h"
 #include "../link_watch.h"
 
 #include <dlfcn.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <dirent.h>
 #include <string.h>
+#include <math.h>
 
 #include "../colors.h"
 #include "osd.h"
+#include "osd_profiler.h"
 
 plugin_osd_t* g_pPluginsOSD[MAX_OSD_PLUGINS];
 int g_iPluginsOSDCount = 0;
 bool g_bOSDPluginsNeedTelemetryStreams = false;
 
+// Draw buffer content under the plugin being rendered into its surface
+static u32* s_pOSDPluginsBackgroundPixels = NULL;
+static int s_iOSDPluginsBackgroundPixelsCount = 0;
+
+typedef struct
+{
+   int iLength;
+   int iTelemetryType;
+} type_osd_plugin_stream_data_header;
+
+typedef struct _plugin_osd_worker
+{
+   plugin_osd_t* pPluginOSD;
+   pthread_t thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   bool bStop;
+
+   // Render request, set by the UI thread
+   bool bRenderRequested;
+   vehicle_and_telemetry_info_t telemetryInfo;
+   vehicle_and_telemetry_info2_t telemetryInfo2;
+   plugin_settings_info_t2 settings;
+   plugin_settings_info_t2_extra settingsExtra;
+   float xPos, yPos, fWidth, fHeight;
+   float fStrokeSize;
+
+   // Render in progress, used only by the plugin thread
+   vehicle_and_telemetry_info_t telemetryInfoRender;
+   vehicle_and_telemetry_info2_t telemetryInfo2Render;
+   plugin_settings_info_t2 settingsRender;
+   plugin_settings_info_t2_extra settingsExtraRender;
+
+   bool bRendering;
+   u32 uTimeRenderStart;
+   u32 uLastRenderMicros;
+   bool bNewListReady;
+   bool bListValid;
+   float xPosList, yPosList;
+   type_render_ui_command_list* pListRecording;
+   type_render_ui_command_list* pListReady;
+
+   // Callbacks queued by the UI thread
+   bool bNewVehicle;
+   u32 uNewVehicleId;
+   u8 uStreamQueue[OSD_PLUGIN_STREAM_QUEUE_SIZE];
+   int iStreamQueueBytes;
+   u8 uStreamQueueWork[OSD_PLUGIN_STREAM_QUEUE_SIZE];
+   u32 uCountDroppedStreamData;
+   int iRequestTelemetryStreams;
+} plugin_osd_worker_t;
+
+static void* _osd_plugin_worker_thread(void* pParam)
+{
+   plugin_osd_worker_t* pWorker = (plugin_osd_worker_t*)pParam;
+   plugin_osd_t* pPluginOSD = pWorker->pPluginOSD;
+
+   pthread_mutex_lock(&pWorker->mutex);
+   while ( ! pWorker->bStop )
+   {
+      if ( (! pWorker->bRenderRequested) && (! pWorker->bNewVehicle) && (0 == pWorker->iStreamQueueBytes) )
+      {
+         pthread_cond_wait(&pWorker->cond, &pWorker->mutex);
+         continue;
+      }
+
+      bool bNewVehicle = pWorker->bNewVehicle;
+      u32 uNewVehicleId = pWorker->uNewVehicleId;
+      pWorker->bNewVehicle = false;
+
+      int iStreamBytes = pWorker->iStreamQueueBytes;
+      if ( iStreamBytes > 0 )
+         memcpy(pWorker->uStreamQueueWork, pWorker->uStreamQueue, iStreamBytes);
+      pWorker->iStreamQueueBytes = 0;
+
+      bool bRender = pWorker->bRenderRequested;
+      float xPos = pWorker->xPos, yPos = pWorker->yPos;
+      float fWidth = pWorker->fWidth, fHeight = pWorker->fHeight;
+      if ( bRender )
+      {
+         pWorker->bRenderRequested = false;
+         memcpy(&pWorker->telemetryInfoRender, &pWorker->telemetryInfo, sizeof(vehicle_and_telemetry_info_t));
+         memcpy(&pWorker->telemetryInfo2Render, &pWorker->telemetryInfo2, sizeof(vehicle_and_telemetry_info2_t));
+         memcpy(&pWorker->settingsRender, &pWorker->settings, sizeof(plugin_settings_info_t2));
+         memcpy(&pWorker->settingsExtraRender, &pWorker->settingsExtra, sizeof(plugin_settings_info_t2_extra));
+         pWorker->telemetryInfoRender.pExtraInfo = &pWorker->telemetryInfo2Render;
+         pWorker->settingsRender.pExtraInfo = &pWorker->settingsExtraRender;
+         pWorker->bRendering = true;
+         pWorker->uTimeRenderStart = get_current_timestamp_ms();
+      }
+      float fStrokeSize = pWorker->fStrokeSize;
+      pthread_mutex_unlock(&pWorker->mutex);
+
+      if ( bNewVehicle && (NULL != pPluginOSD->pFunctionOnNewVehicle) )
+         (*(pPluginOSD->pFunctionOnNewVehicle))(uNewVehicleId);
+
+      int iPos = 0;
+      while ( iPos + (int)sizeof(type_osd_plugin_stream_data_header) <= iStreamBytes )
+      {
+         type_osd_plugin_stream_data_header header;
+         memcpy(&header, &(pWorker->uStreamQueueWork[iPos]), sizeof(header));
+         iPos += sizeof(header);
+         if ( NULL != pPluginOSD->pFunctionOnTelemetryStreamData )
+            (*(pPluginOSD->pFunctionOnTelemetryStreamData))(&(pWorker->uStreamQueueWork[iPos]), header.iLength, header.iTelemetryType);
+         iPos += header.iLength;
+      }
+
+      int iRequestTelemetryStreams = 0;
+      if ( NULL != pPluginOSD->pFunctionRequestTelemetryStreams )
+         iRequestTelemetryStreams = (*(pPluginOSD->pFunctionRequestTelemetryStreams))();
+
+      u32 uMicros = 0;
+      if ( bRender )
+      {
+         u32 uTimeStart = get_current_timestamp_micros();
+         render_engine_ui_record_to(pWorker->pListRecording, fStrokeSize);
+         (*(pPluginOSD->pFunctionRender))(&pWorker->telemetryInfoRender, &pWorker->settingsRender, xPos, yPos, fWidth, fHeight);
+         render_engine_ui_record_to(NULL, 0.0);
+         uMicros = get_current_timestamp_micros() - uTimeStart;
+      }
+
+      pthread_mutex_lock(&pWorker->mutex);
+      pWorker->iRequestTelemetryStreams = iRequestTelemetryStreams;
+      if ( bRender )
+      {
+         type_render_ui_command_list* pList = pWorker->pListReady;
+         pWorker->pListReady = pWorker->pListRecording;
+         pWorker->pListRecording = pList;
+         if ( pWorker->pListReady->uCountDroppedCommands > 0 )
+            log_softerror_and_alarm("[OSDPlugins] Plugin %s: %u draw calls did not fit in the commands list.", pPluginOSD->szUID, pWorker->pListReady->uCountDroppedCommands);
+         pWorker->xPosList = xPos;
+         pWorker->yPosList = yPos;
+         pWorker->bNewListReady = true;
+         pWorker->bListValid = true;
+         pWorker->bRendering = false;
+         pWorker->uLastRenderMicros = uMicros;
+      }
+   }
+   pthread_mutex_unlock(&pWorker->mutex);
+   return NULL;
+}
+
+static void _osd_plugin_start_worker(plugin_osd_t* pPluginOSD)
+{
+   pPluginOSD->pWorker = NULL;
+   if ( ! render_engine_has_lock() )
+   {
+      log_line("[OSDPlugins] No render engine lock. Plugin %s renders on the UI thread.", pPluginOSD->szUID);
+      return;
+   }
+
+   plugin_osd_worker_t* pWorker = (plugin_osd_worker_t*) malloc(sizeof(plugin_osd_worker_t));
+   if ( NULL == pWorker )
+      return;
+   memset(pWorker, 0, sizeof(plugin_osd_worker_t));
+   pWorker->pPluginOSD = pPluginOSD;
+   pWorker->pListRecording = (type_render_ui_command_list*) malloc(sizeof(type_render_ui_command_list));
+   pWorker->pListReady = (type_render_ui_command_list*) malloc(sizeof(type_render_ui_command_list));
+   if ( (NULL == pWorker->pListRecording) || (NULL == pWorker->pListReady) )
+   {
+      log_softerror_and_alarm("[OSDPlugins] Failed to allocate the commands lists for plugin %s. It renders on the UI thread.", pPluginOSD->szUID);
+      if ( NULL != pWorker->pListRecording )
+         free(pWorker->pListRecording);
+      if ( NULL != pWorker->pListReady )
+         free(pWorker->pListReady);
+      free(pWorker);
+      return;
+   }
+   pWorker->pListReady->iCountCommands = 0;
+
+   if ( NULL != pPluginOSD->pFunctionRequestTelemetryStreams )
+      pWorker->iRequestTelemetryStreams = (*(pPluginOSD->pFunctionRequestTelemetryStreams))();
+
+   pthread_mutex_init(&pWorker->mutex, NULL);
+   pthread_cond_init(&pWorker->cond, NULL);
+   if ( 0 != pthread_create(&pWorker->thread, NULL, &_osd_plugin_worker_thread, pWorker) )
+   {
+      log_softerror_and_alarm("[OSDPlugins] Failed to create the render thread for plugin %s. It renders on the UI thread.", pPluginOSD->szUID);
+      pthread_cond_destroy(&pWorker->cond);
+      pthread_mutex_destroy(&pWorker->mutex);
+      free(pWorker->pListRecording);
+      free(pWorker->pListReady);
+      free(pWorker);
+      return;
+   }
+   pPluginOSD->pWorker = pWorker;
+   log_line("[OSDPlugins] Started render thread for plugin %s.", pPluginOSD->szUID);
+}
+
+// Returns false if the plugin thread is stuck in a plugin call: the thread is left running then
+// and the plugin library must not be unloaded.
+static bool _osd_plugin_stop_worker(plugin_osd_t* pPluginOSD)
+{
+   plugin_osd_worker_t* pWorker = pPluginOSD->pWorker;
+   if ( NULL == pWorker )
+      return true;
+   pPluginOSD->pWorker = NULL;
+
+   pthread_mutex_lock(&pWorker->mutex);
+   pWorker->bStop = true;
+   bool bStuck = pWorker->bRendering && (get_current_timestamp_ms() > pWorker->uTimeRenderStart + OSD_PLUGIN_NOT_RESPONDING_MS);
+   pthread_cond_signal(&pWorker->cond);
+   pthread_mutex_unlock(&pWorker->mutex);
+
+   if ( bStuck )
+   {
+      log_softerror_and_alarm("[OSDPlugins] Plugin %s is not responding, leaving its thread and library loaded.", pPluginOSD->szUID);
+      pthread_detach(pWorker->thread);
+      return false;
+   }
+   pthread_join(pWorker->thread, NULL);
+   pthread_cond_destroy(&pWorker->cond);
+   pthread_mutex_destroy(&pWorker->mutex);
+   free(pWorker->pListRecording);
+   free(pWorker->pListReady);
+   free(pWorker);
+   return true;
+}
+
 void _osd_plugins_populate_public_telemetry_info()
 {
    int iVehicleIndex = osd_get_current_data_source_vehicle_index();
@@ -296,6 +519,11 @@ void _osd_load_plugin(const char* szFile)
    strcpy(g_pPluginsOSD[g_iPluginsOSDCount]->szPluginFile, szFile);
    g_pPluginsOSD[g_iPluginsOSDCount]->bBoundingBox = false;
    g_pPluginsOSD[g_iPluginsOSDCount]->bHighlight = false;
+   g_pPluginsOSD[g_iPluginsOSDCount]->pSurface = NULL;
+   g_pPluginsOSD[g_iPluginsOSDCount]->iSurfaceWidth = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->iSurfaceHeight = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->pWorker = NULL;
+   osd_plugins_reset_render_stats(g_iPluginsOSDCount);
    g_pPluginsOSD[g_iPluginsOSDCount]->pLibrary = dlopen(szFile, RTLD_LAZY | RTLD_GLOBAL);
 
    if ( g_pPluginsOSD[g_iPluginsOSDCount]->pLibrary == NULL)
@@ -361,14 +589,19 @@ void _osd_load_plugin(const char* szFile)
       return;
    }
 
+   _osd_plugin_start_worker(g_pPluginsOSD[g_iPluginsOSDCount-1]);
    log_line("Loaded OSD plugin: %s, UID: %s, file: [%s]", szPluginName, szPluginUID, szFile);
 }
 
 void osd_plugins_load()
 {
    for( int i=0; i<g_iPluginsOSDCount; i++ )
+   {
+      if ( ! _osd_plugin_stop_worker(g_pPluginsOSD[i]) )
+         continue;
       if ( NULL != g_pPluginsOSD[i]->pLibrary )
          dlclose(g_pPluginsOSD[i]->pLibrary);
+   }
       
    g_iPluginsOSDCount = 0;
    g_bOSDPluginsNeedTelemetryStreams = false;
@@ -402,6 +635,257 @@ void osd_plugins_load()
    log_line("Loaded %d OSD plugins.", g_iPluginsOSDCount);
 }
 
+static void _osd_plugin_update_render_cost(int iIndex, u32 uMicros)
+{
+   plugin_osd_t* pPluginOSD = g_pPluginsOSD[iIndex];
+   pPluginOSD->uLastRenderMicros = uMicros;
+   if ( 0 == pPluginOSD->uCountRenders )
+      pPluginOSD->uAvgRenderMicros = uMicros;
+   else
+      pPluginOSD->uAvgRenderMicros = (pPluginOSD->uAvgRenderMicros*7 + uMicros)/8;
+   if ( uMicros > pPluginOSD->uMaxRenderMicros )
+      pPluginOSD->uMaxRenderMicros = uMicros;
+   pPluginOSD->uCountRenders++;
+   pPluginOSD->uTimeLastRender = g_TimeNow;
+
+   pPluginOSD->uRenderIntervalMs = (pPluginOSD->uAvgRenderMicros * OSD_PLUGIN_RENDER_INTERVAL_FACTOR)/1000;
+   if ( pPluginOSD->uRenderIntervalMs > OSD_PLUGIN_MAX_RENDER_INTERVAL_MS )
+      pPluginOSD->uRenderIntervalMs = OSD_PLUGIN_MAX_RENDER_INTERVAL_MS;
+}
+
+static bool _osd_plugin_alloc_surface(plugin_osd_t* pPluginOSD, int iWidth, int iHeight)
+{
+   if ( iWidth*iHeight > s_iOSDPluginsBackgroundPixelsCount )
+   {
+      if ( NULL != s_pOSDPluginsBackgroundPixels )
+         free(s_pOSDPluginsBackgroundPixels);
+      s_iOSDPluginsBackgroundPixelsCount = 0;
+      s_pOSDPluginsBackgroundPixels = (u32*) malloc(iWidth*iHeight*sizeof(u32));
+      if ( NULL == s_pOSDPluginsBackgroundPixels )
+         return false;
+      s_iOSDPluginsBackgroundPixelsCount = iWidth*iHeight;
+   }
+
+   if ( (NULL != pPluginOSD->pSurface) && (iWidth == pPluginOSD->iSurfaceWidth) && (iHeight == pPluginOSD->iSurfaceHeight) )
+      return true;
+   if ( NULL != pPluginOSD->pSurface )
+      free(pPluginOSD->pSurface);
+   pPluginOSD->iSurfaceWidth = 0;
+   pPluginOSD->iSurfaceHeight = 0;
+   pPluginOSD->pSurface = (u32*) malloc(iWidth*iHeight*sizeof(u32));
+   if ( NULL == pPluginOSD->pSurface )
+      return false;
+   pPluginOSD->iSurfaceWidth = iWidth;
+   pPluginOSD->iSurfaceHeight = iHeight;
+   return true;
+}
+
+// Draws the plugin output into its surface, or composites the surface from the last render if the plugin was rendered recently.
+// The plugin output is drawn directly in the draw buffer: the area is saved and cleared before, then the plugin output
+// is copied to its surface, the area is restored and the surface is blended over it.
+// The plugin output is either the commands list recorded by the plugin thread or, with no plugin thread, the plugin render call.
+
+static void _osd_plugin_draw_output(int iIndex, vehicle_and_telemetry_info_t* pTelemetryInfo, plugin_settings_info_t2* pSettings, float xPos, float yPos, float fWidth, float fHeight, type_render_ui_command_list* pList)
+{
+   plugin_osd_t* pPluginOSD = g_pPluginsOSD[iIndex];
+
+   float xSurface = xPos - OSD_PLUGIN_SURFACE_MARGIN_PX * g_pRenderEngine->getPixelWidth();
+   float ySurface = yPos - OSD_PLUGIN_SURFACE_MARGIN_PX * g_pRenderEngine->getPixelHeight();
+   int iWidth = fWidth * g_pRenderEngine->getScreenWidth() + 2*OSD_PLUGIN_SURFACE_MARGIN_PX;
+   int iHeight = fHeight * g_pRenderEngine->getScreenHeight() + 2*OSD_PLUGIN_SURFACE_MARGIN_PX;
+   bool bUseSurface = g_pRenderEngine->canDrawBitmaps() && (iWidth > 0) && (iHeight > 0) && (iWidth*iHeight <= OSD_PLUGIN_MAX_SURFACE_PIXELS);
+
+   pPluginOSD->bSurfaceValid = false;
+   if ( bUseSurface && (! _osd_plugin_alloc_surface(pPluginOSD, iWidth, iHeight)) )
+      bUseSurface = false;
+
+   if ( bUseSurface )
+   {
+      g_pRenderEngine->readBitmap(xSurface, ySurface, s_pOSDPluginsBackgroundPixels, iWidth, iHeight);
+      g_pRenderEngine->writeBitmap(xSurface, ySurface, NULL, iWidth, iHeight);
+   }
+
+   u32 uMicros = 0;
+   if ( NULL != pList )
+      render_engine_ui_replay(pList);
+   else
+   {
+      u32 uTimeStart = get_current_timestamp_micros();
+      (*(pPluginOSD->pFunctionRender))(pTelemetryInfo, pSettings, xPos, yPos, fWidth, fHeight);
+      uMicros = get_current_timestamp_micros() - uTimeStart;
+   }
+
+   if ( bUseSurface )
+   {
+      g_pRenderEngine->readBitmap(xSurface, ySurface, pPluginOSD->pSurface, iWidth, iHeight);
+      g_pRenderEngine->writeBitmap(xSurface, ySurface, s_pOSDPluginsBackgroundPixels, iWidth, iHeight);
+      g_pRenderEngine->drawBitmap(xSurface, ySurface, pPluginOSD->pSurface, iWidth, iHeight);
+      pPluginOSD->fSurfaceX = xSurface;
+      pPluginOSD->fSurfaceY = ySurface;
+      pPluginOSD->bSurfaceValid = true;
+   }
+   if ( NULL == pList )
+      _osd_plugin_update_render_cost(iIndex, uMicros);
+}
+
+static bool _osd_plugin_draw_cached_surface(plugin_osd_t* pPluginOSD, float xPos, float yPos, float fWidth, float fHeight)
+{
+   if ( ! pPluginOSD->bSurfaceValid )
+      return false;
+   float xSurface = xPos - OSD_PLUGIN_SURFACE_MARGIN_PX * g_pRenderEngine->getPixelWidth();
+   float ySurface = yPos - OSD_PLUGIN_SURFACE_MARGIN_PX * g_pRenderEngine->getPixelHeight();
+   int iWidth = fWidth * g_pRenderEngine->getScreenWidth() + 2*OSD_PLUGIN_SURFACE_MARGIN_PX;
+   int iHeight = fHeight * g_pRenderEngine->getScreenHeight() + 2*OSD_PLUGIN_SURFACE_MARGIN_PX;
+   if ( (iWidth != pPluginOSD->iSurfaceWidth) || (iHeight != pPluginOSD->iSurfaceHeight) )
+      return false;
+   if ( (fabs(xSurface - pPluginOSD->fSurfaceX) > 0.0001) || (fabs(ySurface - pPluginOSD->fSurfaceY) > 0.0001) )
+      return false;
+   g_pRenderEngine->drawBitmap(xSurface, ySurface, pPluginOSD->pSurface, iWidth, iHeight);
+   pPluginOSD->uCountCachedFrames++;
+   return true;
+}
+
+static void _osd_plugin_render(int iIndex, vehicle_and_telemetry_info_t* pTelemetryInfo, plugin_settings_info_t2* pSettings, float xPos, float yPos, float fWidth, float fHeight, bool bForceRender)
+{
+   plugin_osd_t* pPluginOSD = g_pPluginsOSD[iIndex];
+   plugin_osd_worker_t* pWorker = pPluginOSD->pWorker;
+   bool bRenderDue = bForceRender || (g_TimeNow >= pPluginOSD->uTimeLastRender + pPluginOSD->uRenderIntervalMs);
+
+   if ( NULL == pWorker )
+   {
+      if ( (! bRenderDue) && _osd_plugin_draw_cached_surface(pPluginOSD, xPos, yPos, fWidth, fHeight) )
+         return;
+      _osd_plugin_draw_output(iIndex, pTelemetryInfo, pSettings, xPos, yPos, fWidth, fHeight, NULL);
+      return;
+   }
+
+   // The commands list is replayed under the worker lock: the plugin thread swaps the lists under it.
+   // The plugin thread never takes the render engine lock while holding the worker lock.
+   pthread_mutex_lock(&pWorker->mutex);
+
+   if ( pWorker->bRendering && (get_current_timestamp_ms() > pWorker->uTimeRenderStart + OSD_PLUGIN_NOT_RESPONDING_MS) )
+   {
+      if ( ! pPluginOSD->bSuspended )
+         log_softerror_and_alarm("[OSDPlugins] Plugin %s is not responding (rendering for %u ms). Hiding it until it finishes.", osd_plugins_get_short_name(iIndex), get_current_timestamp_ms() - pWorker->uTimeRenderStart);
+      pPluginOSD->bSuspended = true;
+      pthread_mutex_unlock(&pWorker->mutex);
+      return;
+   }
+   if ( pPluginOSD->bSuspended )
+      log_line("[OSDPlugins] Plugin %s is responding again.", osd_plugins_get_short_name(iIndex));
+   pPluginOSD->bSuspended = false;
+
+   bool bNewList = pWorker->bNewListReady;
+   if ( bNewList )
+   {
+      pWorker->bNewListReady = false;
+      _osd_plugin_update_render_cost(iIndex, pWorker->uLastRenderMicros);
+   }
+
+   if ( bRenderDue && (! pWorker->bRendering) && (! pWorker->bRenderRequested) && (! bNewList) )
+   {
+      memcpy(&pWorker->telemetryInfo, pTelemetryInfo, sizeof(vehicle_and_telemetry_info_t));
+      memcpy(&pWorker->telemetryInfo2, pTelemetryInfo->pExtraInfo, sizeof(vehicle_and_telemetry_info2_t));
+      memcpy(&pWorker->settings, pSettings, sizeof(plugin_settings_info_t2));
+      memcpy(&pWorker->settingsExtra, pSettings->pExtraInfo, sizeof(plugin_settings_info_t2_extra));
+      pWorker->xPos = xPos;
+      pWorker->yPos = yPos;
+      pWorker->fWidth = fWidth;
+      pWorker->fHeight = fHeight;
+      pWorker->fStrokeSize = g_pRenderEngine->getStrokeSize();
+      pWorker->bRenderRequested = true;
+      pthread_cond_signal(&pWorker->cond);
+   }
+
+   bool bListInPlace = pWorker->bListValid && (fabs(pWorker->xPosList - xPos) < 0.0001) && (fabs(pWorker->yPosList - yPos) < 0.0001);
+   if ( bNewList && bListInPlace )
+      _osd_plugin_draw_output(iIndex, pTelemetryInfo, pSettings, xPos, yPos, fWidth, fHeight, pWorker->pListReady);
+   else if ( (! _osd_plugin_draw_cached_surface(pPluginOSD, xPos, yPos, fWidth, fHeight)) && bListInPlace )
+      _osd_plugin_draw_output(iIndex, pTelemetryInfo, pSettings, xPos, yPos, fWidth, fHeight, pWorker->pListReady);
+
+   pthread_mutex_unlock(&pWorker->mutex);
+}
+
+void osd_plugins_on_new_vehicle(u32 uVehicleId)
+{
+   for ( int i=0; i<g_iPluginsOSDCount; i++ )
+   {
+      if ( NULL == g_pPluginsOSD[i] )
+         continue;
+      if ( NULL == g_pPluginsOSD[i]->pFunctionOnNewVehicle )
+         continue;
+      plugin_osd_worker_t* pWorker = g_pPluginsOSD[i]->pWorker;
+      if ( NULL == pWorker )
+      {
+         (*(g_pPluginsOSD[i]->pFunctionOnNewVehicle))(uVehicleId);
+         continue;
+      }
+      pthread_mutex_lock(&pWorker->mutex);
+      pWorker->bNewVehicle = true;
+      pWorker->uNewVehicleId = uVehicleId;
+      pthread_cond_signal(&pWorker->cond);
+      pthread_mutex_unlock(&pWorker->mutex);
+   }
+}
+
+void osd_plugins_on_telemetry_stream_data(u8* pData, int iLength, int iTelemetryType)
+{
+   if ( (NULL == pData) || (iLength <= 0) )
+      return;
+
+   for( int i=0; i<g_iPluginsOSDCount; i++ )
+   {
+      if ( NULL == g_pPluginsOSD[i] )
+         continue;
+      if ( (NULL == g_pPluginsOSD[i]->pFunctionRequestTelemetryStreams) || (NULL == g_pPluginsOSD[i]->pFunctionOnTelemetryStreamData) )
+         continue;
+      if ( ! osd_plugins_request_telemetry_streams(i) )
+         continue;
+
+      plugin_osd_worker_t* pWorker = g_pPluginsOSD[i]->pWorker;
+      if ( NULL == pWorker )
+      {
+         (*(g_pPluginsOSD[i]->pFunctionOnTelemetryStreamData))(pData, iLength, iTelemetryType);
+         continue;
+      }
+
+      type_osd_plugin_stream_data_header header;
+      header.iLength = iLength;
+      header.iTelemetryType = iTelemetryType;
+      pthread_mutex_lock(&pWorker->mutex);
+      if ( pWorker->iStreamQueueBytes + (int)sizeof(header) + iLength > OSD_PLUGIN_STREAM_QUEUE_SIZE )
+      {
+         pWorker->uCountDroppedStreamData++;
+         if ( 1 == (pWorker->uCountDroppedStreamData % 100) )
+            log_softerror_and_alarm("[OSDPlugins] Plugin %s is not consuming the telemetry stream data fast enough, dropped %u packets so far.", osd_plugins_get_short_name(i), pWorker->uCountDroppedStreamData);
+      }
+      else
+      {
+         memcpy(&(pWorker->uStreamQueue[pWorker->iStreamQueueBytes]), &header, sizeof(header));
+         memcpy(&(pWorker->uStreamQueue[pWorker->iStreamQueueBytes + sizeof(header)]), pData, iLength);
+         pWorker->iStreamQueueBytes += sizeof(header) + iLength;
+         pthread_cond_signal(&pWorker->cond);
+      }
+      pthread_mutex_unlock(&pWorker->mutex);
+   }
+}
+
+int osd_plugins_request_telemetry_streams(int index)
+{
+   if ( (index < 0) || (index >= g_iPluginsOSDCount) || (NULL == g_pPluginsOSD[index]) )
+      return 0;
+   if ( NULL == g_pPluginsOSD[index]->pFunctionRequestTelemetryStreams )
+      return 0;
+   plugin_osd_worker_t* pWorker = g_pPluginsOSD[index]->pWorker;
+   if ( NULL == pWorker )
+      return (*(g_pPluginsOSD[index]->pFunctionRequestTelemetryStreams))();
+
+   pthread_mutex_lock(&pWorker->mutex);
+   int iRes = pWorker->iRequestTelemetryStreams;
+   pthread_mutex_unlock(&pWorker->mutex);
+   return iRes;
+}
+
 void osd_plugins_render()
 {
    if ( g_bToglleAllOSDOff || g_bToglleOSDOff )
@@ -436,12 +920,8 @@ void osd_plugins_render()
          break;
       }
 
-      if ( NULL != g_pPluginsOSD[i]->pFunctionRequestTelemetryStreams )
-      {
-         int iRes = (*(g_pPluginsOSD[i]->pFunctionRequestTelemetryStreams))();
-         if ( iRes > 0 )
-            g_bOSDPluginsNeedTelemetryStreams = true;
-      }      
+      if ( osd_plugins_request_telemetry_streams(i) > 0 )
+         g_bOSDPluginsNeedTelemetryStreams = true;
    }
 
    osd_set_colors();
@@ -476,6 +956,8 @@ void osd_plugins_render()
          continue;
       if ( NULL == g_pPluginsOSD[i]->pFunctionRender )
          continue;
+      if ( g_pPluginsOSD[i]->bSuspended )
+         continue;
 
       if ( !(pModel->osd_params.instruments_flags[osd_get_current_layout_index()] & (INSTRUMENTS_FLAG_SHOW_FIRST_OSD_PLUGIN<<i)) )
          continue;
@@ -557,7 +1039,10 @@ void osd_plugins_render()
       float xPos = osd_getMarginX() + (1.0-2.0*osd_getMarginX())*pPlugin->fXPos[iModelSettingsIndex][osdLayoutIndex];
       float yPos = osd_getMarginY() + (1.0-2.0*osd_getMarginY())*pPlugin->fYPos[iModelSettingsIndex][osdLayoutIndex];
 
-      (*(g_pPluginsOSD[i]->pFunctionRender))(&telemetry_info, &plugin_settings, xPos, yPos, pPlugin->fWidth[iModelSettingsIndex][osdLayoutIndex], pPlugin->fHeight[iModelSettingsIndex][osdLayoutIndex]);
+      // Render every frame while the plugins layout is edited
+      osd_profiler_begin(osd_plugins_get_short_name(i));
+      _osd_plugin_render(i, &telemetry_info, &plugin_settings, xPos, yPos, pPlugin->fWidth[iModelSettingsIndex][osdLayoutIndex], pPlugin->fHeight[iModelSettingsIndex][osdLayoutIndex], bAnyHighlight);
+      osd_profiler_end();
 
       if ( g_pPluginsOSD[i]->bBoundingBox )
       {
@@ -638,8 +1123,12 @@ void osd_plugins_delete(int index)
    if ( index < 0 || index >= g_iPluginsOSDCount )
       return;
 
+   if ( _osd_plugin_stop_worker(g_pPluginsOSD[index]) )
    if ( NULL != g_pPluginsOSD[index]->pLibrary )
       dlclose(g_pPluginsOSD[index]->pLibrary);
+   if ( NULL != g_pPluginsOSD[index]->pSurface )
+      free(g_pPluginsOSD[index]->pSurface);
+   g_pPluginsOSD[index]->pSurface = NULL;
 
    char szComm[1024];
    sprintf(szComm, "rm -rf %s", g_pPluginsOSD[index]->szPluginFile);
@@ -650,6 +1139,21 @@ void osd_plugins_delete(int index)
    g_iPluginsOSDCount--;
 }
 
+void osd_plugins_reset_render_stats(int index)
+{
+   if ( index < 0 || index >= MAX_OSD_PLUGINS || (NULL == g_pPluginsOSD[index]) )
+      return;
+   g_pPluginsOSD[index]->bSurfaceValid = false;
+   g_pPluginsOSD[index]->uTimeLastRender = 0;
+   g_pPluginsOSD[index]->uRenderIntervalMs = 0;
+   g_pPluginsOSD[index]->uLastRenderMicros = 0;
+   g_pPluginsOSD[index]->uAvgRenderMicros = 0;
+   g_pPluginsOSD[index]->uMaxRenderMicros = 0;
+   g_pPluginsOSD[index]->uCountRenders = 0;
+   g_pPluginsOSD[index]->uCountCachedFrames = 0;
+   g_pPluginsOSD[index]->bSuspended = false;
+}
+
 int osd_plugin_get_settings_count(int index )
 {
    if ( index < 0 || index >= g_iPluginsOSDCount )
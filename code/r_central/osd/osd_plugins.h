@@ -4,6 +4,24 @@
 // The info in OSD plugins structure is not persistent, is created only at runtime.
 // The persistent info about a plugin is stored in SinglePluginSettings, in common plugin_settings file
 
+// Each plugin renders on its own thread: its RenderEngineUI calls are recorded into a commands list
+// (see renderer/render_engine_ui_commands.h) that the UI thread replays. The other plugin callbacks
+// (new vehicle, telemetry streams) are queued to the same thread, so a plugin is never called concurrently.
+// If the thread can't be created, the plugin is rendered directly on the UI thread.
+// Plugins are rendered into a cached surface (when the render engine supports bitmaps) that is composited
+// on the frames the plugin is not rendered on. Each plugin is rendered at most once every
+// (average render time * OSD_PLUGIN_RENDER_INTERVAL_FACTOR).
+// A plugin that is still rendering after OSD_PLUGIN_NOT_RESPONDING_MS is marked as not responding and
+// is hidden until its render call returns.
+#define OSD_PLUGIN_RENDER_INTERVAL_FACTOR 20
+#define OSD_PLUGIN_MAX_RENDER_INTERVAL_MS 1000
+#define OSD_PLUGIN_NOT_RESPONDING_MS 2000
+#define OSD_PLUGIN_STREAM_QUEUE_SIZE 16384
+#define OSD_PLUGIN_SURFACE_MARGIN_PX 4
+#define OSD_PLUGIN_MAX_SURFACE_PIXELS (1024*1024)
+
+struct _plugin_osd_worker;
+
 typedef struct
 {
    char szUID[MAX_PLUGIN_NAME_LENGTH];
@@ -34,6 +52,24 @@ typedef struct
 
    bool bBoundingBox;
    bool bHighlight;
+
+   // Render surface and cost
+   u32* pSurface;
+   int iSurfaceWidth;
+   int iSurfaceHeight;
+   float fSurfaceX;
+   float fSurfaceY;
+   bool bSurfaceValid;
+   u32 uTimeLastRender;
+   u32 uRenderIntervalMs;
+   u32 uLastRenderMicros;
+   u32 uAvgRenderMicros;
+   u32 uMaxRenderMicros;
+   u32 uCountRenders;
+   u32 uCountCachedFrames;
+   bool bSuspended; // Not responding: the render call did not return in OSD_PLUGIN_NOT_RESPONDING_MS
+
+   struct _plugin_osd_worker* pWorker; // Render thread of the plugin, NULL if the plugin is rendered on the UI thread
 } __attribute__((packed)) plugin_osd_t;
 
 extern plugin_osd_t* g_pPluginsOSD[MAX_OSD_PLUGINS];
@@ -43,6 +79,11 @@ extern bool g_bOSDPluginsNeedTelemetryStreams;
 void osd_plugins_load();
 void osd_plugins_render();
 
+void osd_plugins_on_new_vehicle(u32 uVehicleId);
+void osd_plugins_on_telemetry_stream_data(u8* pData, int iLength, int iTelemetryType);
+// Returns the last answer of the plugin to requestTelemetryStreams
+int osd_plugins_request_telemetry_streams(int index);
+
 int osd_plugins_get_count();
 plugin_osd_t* osd_plugins_get(int index);
 
@@ -50,6 +91,7 @@ char* osd_plugins_get_name(int index);
 char* osd_plugins_get_short_name(int index);
 char* osd_plugins_get_uid(int index);
 void osd_plugins_delete(int index);
+void osd_plugins_reset_render_stats(int index);
 
 SinglePluginSettings* osd_get_settings_for_plugin_for_model(const char* szPluginUID, Model* pModel);
 
@@ -0,0 +1,407 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../../base/base.h"
+#include "../../base/config.h"
+#include "../../renderer/render_engine.h"
+#include "../colors.h"
+#include "../fonts.h"
+#include "../shared_vars.h"
+#include "../timers.h"
+#include "osd_common.h"
+#include "osd_profiler.h"
+
+static bool s_bOSDProfilerEnabled = false;
+static bool s_bOSDProfilerInFrame = false;
+static u32 s_uOSDProfilerFrameIndex = 0;
+static u32 s_uOSDProfilerFrameStartMicros = 0;
+
+static type_osd_profiler_element s_OSDProfilerElements[OSD_PROFILER_MAX_ELEMENTS];
+static int s_iOSDProfilerElementsCount = 0;
+
+static type_osd_profiler_frame s_OSDProfilerFrames[OSD_PROFILER_HISTORY_FRAMES];
+static int s_iOSDProfilerCurrentFrame = 0;
+static int s_iOSDProfilerFramesCount = 0;
+
+static int s_iOSDProfilerStackDepth = 0;
+static int s_iOSDProfilerStackSample[OSD_PROFILER_MAX_DEPTH];
+static int s_iOSDProfilerStackElement[OSD_PROFILER_MAX_DEPTH];
+static u32 s_uOSDProfilerStackStart[OSD_PROFILER_MAX_DEPTH];
+
+static u32 s_uOSDProfilerFrameElementMicros[OSD_PROFILER_MAX_ELEMENTS];
+static u32 s_uOSDProfilerTotalDroppedSamples = 0;
+static u32 s_uOSDProfilerLastTimeLogDroppedSamples = 0;
+
+void osd_profiler_set_enabled(bool bEnabled)
+{
+   if ( bEnabled == s_bOSDProfilerEnabled )
+      return;
+   if ( bEnabled )
+   {
+      osd_profiler_reset();
+      log_line("[OSDProfiler] Enabled.");
+   }
+   else
+      log_line("[OSDProfiler] Disabled.");
+   s_bOSDProfilerEnabled = bEnabled;
+   s_bOSDProfilerInFrame = false;
+}
+
+bool osd_profiler_is_enabled()
+{
+   return s_bOSDProfilerEnabled;
+}
+
+void osd_profiler_reset()
+{
+   memset(s_OSDProfilerElements, 0, sizeof(s_OSDProfilerElements));
+   s_iOSDProfilerElementsCount = 0;
+   s_iOSDProfilerCurrentFrame = 0;
+   s_iOSDProfilerFramesCount = 0;
+   s_iOSDProfilerStackDepth = 0;
+   s_bOSDProfilerInFrame = false;
+   s_uOSDProfilerTotalDroppedSamples = 0;
+}
+
+void osd_profiler_start_frame()
+{
+   if ( ! s_bOSDProfilerEnabled )
+      return;
+
+   s_uOSDProfilerFrameIndex++;
+   s_iOSDProfilerCurrentFrame = (s_iOSDProfilerCurrentFrame + 1) % OSD_PROFILER_HISTORY_FRAMES;
+   type_osd_profiler_frame* pFrame = &s_OSDProfilerFrames[s_iOSDProfilerCurrentFrame];
+   pFrame->uFrameIndex = s_uOSDProfilerFrameIndex;
+   pFrame->uTimeStartMs = g_TimeNow;
+   pFrame->uDurationMicros = 0;
+   pFrame->iCountSamples = 0;
+   pFrame->iCountDroppedSamples = 0;
+   s_iOSDProfilerStackDepth = 0;
+   memset(s_uOSDProfilerFrameElementMicros, 0, sizeof(s_uOSDProfilerFrameElementMicros));
+   s_uOSDProfilerFrameStartMicros = get_current_timestamp_micros();
+   s_bOSDProfilerInFrame = true;
+}
+
+void osd_profiler_end_frame()
+{
+   if ( (! s_bOSDProfilerEnabled) || (! s_bOSDProfilerInFrame) )
+      return;
+
+   // Close elements left open
+   while ( s_iOSDProfilerStackDepth > 0 )
+      osd_profiler_end();
+
+   type_osd_profiler_frame* pFrame = &s_OSDProfilerFrames[s_iOSDProfilerCurrentFrame];
+   pFrame->uDurationMicros = get_current_timestamp_micros() - s_uOSDProfilerFrameStartMicros;
+   if ( s_iOSDProfilerFramesCount < OSD_PROFILER_HISTORY_FRAMES )
+      s_iOSDProfilerFramesCount++;
+
+   if ( pFrame->iCountDroppedSamples > 0 )
+   {
+      s_uOSDProfilerTotalDroppedSamples += (u32)pFrame->iCountDroppedSamples;
+      if ( g_TimeNow > s_uOSDProfilerLastTimeLogDroppedSamples + 10000 )
+      {
+         s_uOSDProfilerLastTimeLogDroppedSamples = g_TimeNow;
+         log_softerror_and_alarm("[OSDProfiler] Frame %u has %d samples, max %d per frame: %d samples not recorded (%u total).",
+            pFrame->uFrameIndex, pFrame->iCountSamples + pFrame->iCountDroppedSamples, OSD_PROFILER_MAX_FRAME_SAMPLES, pFrame->iCountDroppedSamples, s_uOSDProfilerTotalDroppedSamples);
+      }
+   }
+
+   for( int i=0; i<s_iOSDProfilerElementsCount; i++ )
+   {
+      type_osd_profiler_element* pElement = &s_OSDProfilerElements[i];
+      if ( pElement->uLastFrameIndex != s_uOSDProfilerFrameIndex )
+      {
+         // Not drawn this frame: average decays towards zero
+         pElement->uAvgMicros = (pElement->uAvgMicros*7)/8;
+         pElement->uMaxMicros = (pElement->uMaxMicros*63)/64;
+         continue;
+      }
+      u32 uMicros = s_uOSDProfilerFrameElementMicros[i];
+      pElement->uLastFrameMicros = uMicros;
+      pElement->uAvgMicros = (pElement->uAvgMicros*7 + uMicros)/8;
+      pElement->uMaxMicros = (pElement->uMaxMicros*63)/64;
+      if ( uMicros > pElement->uMaxMicros )
+         pElement->uMaxMicros = uMicros;
+   }
+   s_bOSDProfilerInFrame = false;
+}
+
+static int _osd_profiler_get_element_index(const char* szName)
+{
+   for( int i=0; i<s_iOSDProfilerElementsCount; i++ )
+   {
+      if ( 0 == strncmp(s_OSDProfilerElements[i].szName, szName, OSD_PROFILER_MAX_NAME-1) )
+         return i;
+   }
+   if ( s_iOSDProfilerElementsCount >= OSD_PROFILER_MAX_ELEMENTS )
+      return -1;
+
+   int iIndex = s_iOSDProfilerElementsCount;
+   memset(&s_OSDProfilerElements[iIndex], 0, sizeof(type_osd_profiler_element));
+   strncpy(s_OSDProfilerElements[iIndex].szName, szName, OSD_PROFILER_MAX_NAME-1);
+   s_OSDProfilerElements[iIndex].szName[OSD_PROFILER_MAX_NAME-1] = 0;
+   s_iOSDProfilerElementsCount++;
+   return iIndex;
+}
+
+void osd_profiler_begin(const char* szName)
+{
+   if ( (! s_bOSDProfilerEnabled) || (! s_bOSDProfilerInFrame) || (NULL == szName) )
+      return;
+
+   // Keep counting the depth past the max depth, so that begin/end calls stay paired
+   int iDepth = s_iOSDProfilerStackDepth;
+   s_iOSDProfilerStackDepth++;
+   if ( iDepth >= OSD_PROFILER_MAX_DEPTH )
+      return;
+
+   s_iOSDProfilerStackSample[iDepth] = -1;
+   s_uOSDProfilerStackStart[iDepth] = get_current_timestamp_micros();
+
+   int iElement = _osd_profiler_get_element_index(szName);
+   s_iOSDProfilerStackElement[iDepth] = iElement;
+   if ( iElement < 0 )
+      return;
+   type_osd_profiler_frame* pFrame = &s_OSDProfilerFrames[s_iOSDProfilerCurrentFrame];
+   if ( pFrame->iCountSamples >= OSD_PROFILER_MAX_FRAME_SAMPLES )
+   {
+      pFrame->iCountDroppedSamples++;
+      return;
+   }
+
+   type_osd_profiler_sample* pSample = &pFrame->samples[pFrame->iCountSamples];
+   pSample->uElementIndex = (u8)iElement;
+   pSample->uDepth = (u8)iDepth;
+   pSample->uStartMicros = s_uOSDProfilerStackStart[iDepth] - s_uOSDProfilerFrameStartMicros;
+   pSample->uDurationMicros = 0;
+   s_iOSDProfilerStackSample[iDepth] = pFrame->iCountSamples;
+   pFrame->iCountSamples++;
+}
+
+void osd_profiler_end()
+{
+   if ( (! s_bOSDProfilerEnabled) || (! s_bOSDProfilerInFrame) || (s_iOSDProfilerStackDepth <= 0) )
+      return;
+
+   s_iOSDProfilerStackDepth--;
+   int iDepth = s_iOSDProfilerStackDepth;
+   if ( iDepth >= OSD_PROFILER_MAX_DEPTH )
+      return;
+   int iElement = s_iOSDProfilerStackElement[iDepth];
+   if ( iElement < 0 )
+      return;
+
+   u32 uDurationMicros = get_current_timestamp_micros() - s_uOSDProfilerStackStart[iDepth];
+   if ( -1 != s_iOSDProfilerStackSample[iDepth] )
+   {
+      type_osd_profiler_frame* pFrame = &s_OSDProfilerFrames[s_iOSDProfilerCurrentFrame];
+      pFrame->samples[s_iOSDProfilerStackSample[iDepth]].uDurationMicros = uDurationMicros;
+   }
+
+   type_osd_profiler_element* pElement = &s_OSDProfilerElements[iElement];
+   pElement->uCalls++;
+   pElement->uLastFrameIndex = s_uOSDProfilerFrameIndex;
+   s_uOSDProfilerFrameElementMicros[iElement] += uDurationMicros;
+}
+
+static void _osd_profiler_set_element_color(int iElement, float fAlpha)
+{
+   static const u8 s_uColors[8][3] = { {250,120,60}, {80,180,250}, {120,220,90}, {240,200,60}, {200,110,230}, {90,220,200}, {250,90,120}, {170,170,250} };
+   const u8* pColor = s_uColors[iElement % 8];
+   g_pRenderEngine->setFill(pColor[0], pColor[1], pColor[2], fAlpha);
+   g_pRenderEngine->setStroke(pColor[0], pColor[1], pColor[2], fAlpha);
+}
+
+void osd_profiler_render()
+{
+   if ( (! s_bOSDProfilerEnabled) || (0 == s_iOSDProfilerFramesCount) )
+      return;
+
+   // Show the last completed frame
+   int iFrame = s_iOSDProfilerCurrentFrame;
+   if ( s_bOSDProfilerInFrame )
+      iFrame = (iFrame + OSD_PROFILER_HISTORY_FRAMES - 1) % OSD_PROFILER_HISTORY_FRAMES;
+   type_osd_profiler_frame* pFrame = &s_OSDProfilerFrames[iFrame];
+
+   char szBuff[128];
+   u32 uFontId = g_idFontOSDSmall;
+   float height_text = g_pRenderEngine->textHeight(uFontId);
+   float fWidth = 0.4;
+   float fMargin = 0.01;
+   float hBar = height_text*0.9;
+   float hHistory = height_text*2.5;
+   float fHeight = height_text*1.5 + hBar*OSD_PROFILER_MAX_DEPTH*0.5 + hHistory + height_text*(OSD_PROFILER_TOP_ELEMENTS+1.5) + 2.0*fMargin;
+   float xPos = 1.0 - fWidth - osd_getMarginX() - 0.02;
+   float yPos = osd_getMarginY() + osd_getBarHeight() + osd_getSecondBarHeight() + 0.06;
+
+   g_pRenderEngine->setStrokeSize(0);
+   g_pRenderEngine->setFill(0,0,0,0.7);
+   g_pRenderEngine->setStroke(0,0,0,0.7);
+   g_pRenderEngine->drawRoundRect(xPos, yPos, fWidth, fHeight, 1.5*POPUP_ROUND_MARGIN);
+
+   xPos += fMargin/g_pRenderEngine->getAspectRatio();
+   yPos += fMargin;
+   fWidth -= 2.0*fMargin/g_pRenderEngine->getAspectRatio();
+
+   // Scale of the flame bar and history: at least one frame interval at 30 fps
+   u32 uMaxFrameMicros = 33000;
+   for( int i=0; i<s_iOSDProfilerFramesCount; i++ )
+   {
+      if ( s_OSDProfilerFrames[i].uDurationMicros > uMaxFrameMicros )
+         uMaxFrameMicros = s_OSDProfilerFrames[i].uDurationMicros;
+   }
+
+   osd_set_colors_text(get_Color_Dev());
+   if ( pFrame->iCountDroppedSamples > 0 )
+      snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "UI frame: %.1f ms (scale %.0f ms), %d samples not shown", pFrame->uDurationMicros/1000.0, uMaxFrameMicros/1000.0, pFrame->iCountDroppedSamples);
+   else
+      snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "UI frame: %.1f ms (scale %.0f ms)", pFrame->uDurationMicros/1000.0, uMaxFrameMicros/1000.0);
+   g_pRenderEngine->drawText(xPos, yPos, uFontId, szBuff);
+   yPos += height_text*1.5;
+
+   // Flame bar of the last frame: one row for each nesting level
+
+   int iMaxDepthShown = OSD_PROFILER_MAX_DEPTH/2;
+   for( int i=0; i<pFrame->iCountSamples; i++ )
+   {
+      type_osd_profiler_sample* pSample = &pFrame->samples[i];
+      if ( pSample->uDepth >= iMaxDepthShown )
+         continue;
+      float x = xPos + fWidth * (float)pSample->uStartMicros / (float)uMaxFrameMicros;
+      float w = fWidth * (float)pSample->uDurationMicros / (float)uMaxFrameMicros;
+      if ( w < g_pRenderEngine->getPixelWidth() )
+         w = g_pRenderEngine->getPixelWidth();
+      if ( x + w > xPos + fWidth )
+         continue;
+      float y = yPos + pSample->uDepth * hBar;
+      _osd_profiler_set_element_color(pSample->uElementIndex, 0.8);
+      g_pRenderEngine->drawRect(x, y, w, hBar - g_pRenderEngine->getPixelHeight());
+      if ( w > g_pRenderEngine->textWidth(uFontId, s_OSDProfilerElements[pSample->uElementIndex].szName) )
+      {
+         g_pRenderEngine->setColors(get_Color_Dev());
+         g_pRenderEngine->drawTextNoOutline(x + g_pRenderEngine->getPixelWidth()*2.0, y, uFontId, s_OSDProfilerElements[pSample->uElementIndex].szName);
+      }
+   }
+   yPos += hBar*iMaxDepthShown + height_text*0.5;
+
+   // Frame times history, oldest on the left
+
+   float wFrame = fWidth/(float)OSD_PROFILER_HISTORY_FRAMES;
+   g_pRenderEngine->setFill(150,150,250,0.8);
+   g_pRenderEngine->setStroke(150,150,250,0.8);
+   for( int i=0; i<s_iOSDProfilerFramesCount; i++ )
+   {
+      int iIndex = (s_iOSDProfilerCurrentFrame + OSD_PROFILER_HISTORY_FRAMES - i) % OSD_PROFILER_HISTORY_FRAMES;
+      float h = hHistory * (float)s_OSDProfilerFrames[iIndex].uDurationMicros / (float)uMaxFrameMicros;
+      if ( h < g_pRenderEngine->getPixelHeight() )
+         continue;
+      g_pRenderEngine->drawRect(xPos + fWidth - (i+1)*wFrame, yPos + hHistory - h, wFrame, h);
+   }
+   yPos += hHistory + height_text*0.5;
+
+   // Costliest elements, by average time per frame
+
+   int iTop[OSD_PROFILER_TOP_ELEMENTS];
+   int iTopCount = 0;
+   for( int i=0; i<s_iOSDProfilerElementsCount; i++ )
+   {
+      int iPos = iTopCount;
+      while ( (iPos > 0) && (s_OSDProfilerElements[iTop[iPos-1]].uAvgMicros < s_OSDProfilerElements[i].uAvgMicros) )
+         iPos--;
+      if ( iPos >= OSD_PROFILER_TOP_ELEMENTS )
+         continue;
+      int iLast = (iTopCount < OSD_PROFILER_TOP_ELEMENTS)?iTopCount:(OSD_PROFILER_TOP_ELEMENTS-1);
+      for( int k=iLast; k>iPos; k-- )
+         iTop[k] = iTop[k-1];
+      iTop[iPos] = i;
+      if ( iTopCount < OSD_PROFILER_TOP_ELEMENTS )
+         iTopCount++;
+   }
+
+   osd_set_colors_text(get_Color_Dev());
+   g_pRenderEngine->drawText(xPos, yPos, uFontId, "Element");
+   g_pRenderEngine->drawTextLeft(xPos + fWidth*0.8, yPos, uFontId, "avg ms");
+   g_pRenderEngine->drawTextLeft(xPos + fWidth, yPos, uFontId, "max ms");
+   yPos += height_text;
+   for( int i=0; i<iTopCount; i++ )
+   {
+      type_osd_profiler_element* pElement = &s_OSDProfilerElements[iTop[i]];
+      _osd_profiler_set_element_color(iTop[i], 0.9);
+      g_pRenderEngine->drawRect(xPos, yPos + height_text*0.2, height_text*0.6/g_pRenderEngine->getAspectRatio(), height_text*0.6);
+      osd_set_colors_text(get_Color_Dev());
+      g_pRenderEngine->drawText(xPos + height_text/g_pRenderEngine->getAspectRatio(), yPos, uFontId, pElement->szName);
+      snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "%.2f", pElement->uAvgMicros/1000.0);
+      g_pRenderEngine->drawTextLeft(xPos + fWidth*0.8, yPos, uFontId, szBuff);
+      snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "%.2f", pElement->uMaxMicros/1000.0);
+      g_pRenderEngine->drawTextLeft(xPos + fWidth, yPos, uFontId, szBuff);
+      yPos += height_text;
+   }
+   osd_set_colors();
+}
+
+bool osd_profiler_save_csv()
+{
+   if ( 0 == s_iOSDProfilerFramesCount )
+      return false;
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   strcpy(szFile, FOLDER_LOGS);
+   strcat(szFile, LOG_FILE_OSD_PROFILER);
+   FILE* fd = fopen(szFile, "w");
+   if ( NULL == fd )
+   {
+      log_softerror_and_alarm("[OSDProfiler] Failed to create file %s", szFile);
+      return false;
+   }
+
+   fprintf(fd, "frame,time_ms,frame_us,element,depth,start_us,duration_us\n");
+   int iFrame = (s_iOSDProfilerCurrentFrame + OSD_PROFILER_HISTORY_FRAMES - s_iOSDProfilerFramesCount + 1) % OSD_PROFILER_HISTORY_FRAMES;
+   for( int i=0; i<s_iOSDProfilerFramesCount; i++ )
+   {
+      type_osd_profiler_frame* pFrame = &s_OSDProfilerFrames[iFrame];
+      iFrame = (iFrame + 1) % OSD_PROFILER_HISTORY_FRAMES;
+      if ( 0 == pFrame->uDurationMicros )
+         continue;
+      for( int k=0; k<pFrame->iCountSamples; k++ )
+      {
+         type_osd_profiler_sample* pSample = &pFrame->samples[k];
+         fprintf(fd, "%u,%u,%u,%s,%d,%u,%u\n", pFrame->uFrameIndex, pFrame->uTimeStartMs, pFrame->uDurationMicros,
+            s_OSDProfilerElements[pSample->uElementIndex].szName, (int)pSample->uDepth, pSample->uStartMicros, pSample->uDurationMicros);
+      }
+   }
+   fclose(fd);
+
+   log_line("[OSDProfiler] Saved %d frames to %s (%u samples were not recorded, max %d per frame). Elements (avg/max us per frame):", s_iOSDProfilerFramesCount, szFile, s_uOSDProfilerTotalDroppedSamples, OSD_PROFILER_MAX_FRAME_SAMPLES);
+   for( int i=0; i<s_iOSDProfilerElementsCount; i++ )
+      log_line("[OSDProfiler] %s: %u / %u us, %u calls", s_OSDProfilerElements[i].szName, s_OSDProfilerElements[i].uAvgMicros, s_OSDProfilerElements[i].uMaxMicros, s_OSDProfilerElements[i].uCalls);
+   return true;
+}
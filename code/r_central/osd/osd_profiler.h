@@ -0,0 +1,55 @@
+#pragma once
+#include "../../base/base.h"
+
+// OSD/UI frame time profiler (developer mode). Render entry points are wrapped in
+// osd_profiler_begin/osd_profiler_end calls; the CPU time of each element is recorded for the last frames
+// and can be shown as an overlay (flame bar for the last frame, frame times history, costliest elements)
+// or saved to a CSV file. Calls can be nested. Nothing is recorded while the profiler is disabled.
+
+#define OSD_PROFILER_MAX_ELEMENTS 64
+#define OSD_PROFILER_MAX_FRAME_SAMPLES 96
+#define OSD_PROFILER_HISTORY_FRAMES 120
+#define OSD_PROFILER_MAX_DEPTH 8
+#define OSD_PROFILER_MAX_NAME 32
+#define OSD_PROFILER_TOP_ELEMENTS 8
+
+typedef struct
+{
+   u8 uElementIndex;
+   u8 uDepth;
+   u32 uStartMicros; // Relative to the start of the frame
+   u32 uDurationMicros;
+} type_osd_profiler_sample;
+
+typedef struct
+{
+   u32 uFrameIndex;
+   u32 uTimeStartMs;
+   u32 uDurationMicros;
+   int iCountSamples;
+   int iCountDroppedSamples; // Samples that did not fit in the samples list (their time is still counted for the elements)
+   type_osd_profiler_sample samples[OSD_PROFILER_MAX_FRAME_SAMPLES];
+} type_osd_profiler_frame;
+
+typedef struct
+{
+   char szName[OSD_PROFILER_MAX_NAME];
+   u32 uCalls;
+   u32 uLastFrameMicros; // Time used in the last frame it was drawn in
+   u32 uAvgMicros; // Average time per frame
+   u32 uMaxMicros; // Max time per frame, decays slowly
+   u32 uLastFrameIndex;
+} type_osd_profiler_element;
+
+void osd_profiler_set_enabled(bool bEnabled);
+bool osd_profiler_is_enabled();
+void osd_profiler_reset();
+
+void osd_profiler_start_frame();
+void osd_profiler_end_frame();
+void osd_profiler_begin(const char* szName);
+void osd_profiler_end();
+
+void osd_profiler_render();
+// Saves the recorded frames to the logs folder. Returns false if there is nothing to save or on failure.
+bool osd_profiler_save_csv();
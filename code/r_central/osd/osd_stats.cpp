@@ -49,6 +49,7 @@
 #include "osd_stats_video_bitrate.h"
 #include "osd_stats_radio.h"
 #include "osd_widgets.h"
+#include "osd_profiler.h"
 #include "../local_stats.h"
 #include "../launchers_controller.h"
 #include "../link_watch.h"
@@ -2024,7 +2025,7 @@ float osd_render_stats_rc_get_height(float scale)
 
    height += 0.05*scale;
    height += 4*height_text*s_OSDStatsLineSpacing;
-   height += 5*height_text*s_OSDStatsLineSpacing;
+   height += 8*height_text*s_OSDStatsLineSpacing;
    return height;
 }
 
@@ -2247,6 +2248,27 @@ float osd_render_stats_rc(float xPos, float yPos, float scale)
    g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
    y += height_text*s_OSDStatsLineSpacing;
 
+   g_pRenderEngine->drawText(xPos, y, s_idFontStats, "Jitter p50/p95:");
+   strcpy(szBuff, "N/A");
+   if ( g_SM_DownstreamInfoRC.histJitter.uCount > 0 )
+      sprintf(szBuff, "%u/%u ms", packet_rc_latency_histogram_get_percentile(&g_SM_DownstreamInfoRC.histJitter, 50), packet_rc_latency_histogram_get_percentile(&g_SM_DownstreamInfoRC.histJitter, 95));
+   g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
+   y += height_text*s_OSDStatsLineSpacing;
+
+   g_pRenderEngine->drawText(xPos, y, s_idFontStats, "To FC p50/p95:");
+   strcpy(szBuff, "N/A");
+   if ( g_SM_DownstreamInfoRC.histToFC.uCount > 0 )
+      sprintf(szBuff, "%u/%u ms", packet_rc_latency_histogram_get_percentile(&g_SM_DownstreamInfoRC.histToFC, 50), packet_rc_latency_histogram_get_percentile(&g_SM_DownstreamInfoRC.histToFC, 95));
+   g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
+   y += height_text*s_OSDStatsLineSpacing;
+
+   g_pRenderEngine->drawText(xPos, y, s_idFontStats, "Stick to FC (est):");
+   strcpy(szBuff, "N/A");
+   if ( g_SM_DownstreamInfoRC.histStickToFC.uCount > 0 )
+      sprintf(szBuff, "%u/%u/%u ms", packet_rc_latency_histogram_get_percentile(&g_SM_DownstreamInfoRC.histStickToFC, 50), packet_rc_latency_histogram_get_percentile(&g_SM_DownstreamInfoRC.histStickToFC, 95), (u32)g_SM_DownstreamInfoRC.histStickToFC.uMaxMs);
+   g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
+   y += height_text*s_OSDStatsLineSpacing;
+
    return height;
 }
 
@@ -3460,6 +3482,8 @@ float osd_render_stats_dev_get_height()
    if ( p->iDebugShowDevVideoStats )
    {
       height += 1.0*(hGraph + height_text) + 4.0*(hGraphSmall + height_text);
+      if ( NULL != g_pSM_VideoPlayerStats )
+         height += 3 * height_text * s_OSDStatsLineSpacing;
    }
    return height;
 }
@@ -4034,6 +4058,23 @@ float osd_render_stats_dev(float xPos, float yPos, float scale)
       g_pRenderEngine->drawLine(xBarSt, yTopGrid, xBarSt, yBottomGrid);
    }
 */
+
+   if ( NULL != g_pSM_VideoPlayerStats )
+   {
+      strcpy(szBuff, "N/A");
+      if ( g_SM_VideoPlayerStats.uFramesDisplayed > 0 )
+         sprintf(szBuff, "%.1f/%.1f ms", (float)g_SM_VideoPlayerStats.uFrameAgeAvgMicros/1000.0, (float)g_SM_VideoPlayerStats.uFrameAgeMaxMicros/1000.0);
+      _osd_stats_draw_line(xPos, rightMargin, y, s_idFontStats, "Video frame age avg/max:", szBuff);
+      y += height_text*s_OSDStatsLineSpacing;
+
+      sprintf(szBuff, "%u/%u/%u", g_SM_VideoPlayerStats.uFramesDecoded, g_SM_VideoPlayerStats.uFramesDisplayed, g_SM_VideoPlayerStats.uFramesDropped);
+      _osd_stats_draw_line(xPos, rightMargin, y, s_idFontStats, "Frames dec/shown/drop:", szBuff);
+      y += height_text*s_OSDStatsLineSpacing;
+
+      sprintf(szBuff, "%.1f ms", (float)g_SM_VideoPlayerStats.uMaxDisplayIntervalErrorMicros/1000.0);
+      _osd_stats_draw_line(xPos, rightMargin, y, s_idFontStats, g_SM_VideoPlayerStats.uLowestLatencyMode?"Judder (lowest latency):":"Judder (paced):", szBuff);
+      y += height_text*s_OSDStatsLineSpacing;
+   }
    }
    return height;
 }
@@ -4803,6 +4844,18 @@ void _osd_stats_autoarange_bottom()
    }
 }
 
+// Names used by the OSD profiler, by stats panel id
+static const char* _osd_stats_get_panel_name(int iPanelId)
+{
+   static const char* s_szOSDStatsPanelsNames[] = { "stats unknown", "stats dev", "stats video graphs", "stats video", "stats tx gap",
+      "stats video bitrate", "stats video decode", "stats radio links", "stats radio interfaces", "stats efficiency",
+      "stats rc", "stats video snapshot", "stats keyframe", "stats unknown", "stats adaptive video", "stats telemetry",
+      "stats audio", "stats rx history", "stats rx history vehicle" };
+   if ( (iPanelId < 0) || (iPanelId >= (int)(sizeof(s_szOSDStatsPanelsNames)/sizeof(s_szOSDStatsPanelsNames[0]))) )
+      return s_szOSDStatsPanelsNames[0];
+   return s_szOSDStatsPanelsNames[iPanelId];
+}
+
 void osd_render_stats_panels()
 {
    if ( NULL == g_pCurrentModel )
@@ -5072,6 +5125,8 @@ void osd_render_stats_panels()
 
    for( int i=0; i<s_iCountOSDStatsBoundingBoxes; i++ )
    {
+      osd_profiler_begin(_osd_stats_get_panel_name(s_iOSDStatsBoundingBoxesIds[i]));
+
       if ( s_iOSDStatsBoundingBoxesIds[i] == 14 )
          osd_render_stats_adaptive_video(s_iOSDStatsBoundingBoxesX[i], s_iOSDStatsBoundingBoxesY[i]);
       
@@ -5144,6 +5199,8 @@ void osd_render_stats_panels()
       //char szBuff[32];
       //sprintf(szBuff, "%d", i);
       //g_pRenderEngine->drawText(s_iOSDStatsBoundingBoxesX[i], s_iOSDStatsBoundingBoxesY[i], s_idFontStats, szBuff);
+
+      osd_profiler_end();
    }
 
 
@@ -5157,7 +5214,9 @@ void osd_render_stats_panels()
 
    if ( pModel->osd_params.osd_flags3[osd_get_current_layout_index()] & OSD_FLAG3_SHOW_RADIO_RX_GRAPH_CONTROLLER )
    {
+      osd_profiler_begin("stats rx graph");
       osd_render_stats_radio_interfaces_graph(0.0, 0.0, &g_SM_RadioStatsInterfaceRxGraph);
+      osd_profiler_end();
    }
 
    if ( p->iDebugShowFullRXStats )
@@ -382,21 +382,38 @@ void osd_render_stats_adaptive_video(float xPos, float yPos)
    g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
    y += height_text*s_OSDStatsLineSpacing;
 
-   g_pRenderEngine->drawText(xPos, y, s_idFontStats, "Video Thresholds Up:");
-   if ( adaptiveVideoIsOn )
-      sprintf(szBuff, "%u, %u", (g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive2 & 0xFF ), (g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive2 >> 8) & 0xFF );
+   // The predictive algorithm has no thresholds; it shows its predicted loss and target level instead
+   if ( adaptiveVideoIsOn && (g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_NEW_ADAPTIVE_ALGORITHM) )
+   {
+      u32 uAdaptive3 = g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive3;
+      g_pRenderEngine->drawText(xPos, y, s_idFontStats, "Predicted Loss:");
+      sprintf(szBuff, "%.1f%%", (float)(uAdaptive3 & 0xFFFF)/10.0);
+      g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
+      y += height_text*s_OSDStatsLineSpacing;
+
+      g_pRenderEngine->drawText(xPos, y, s_idFontStats, "Predicted Target Level:");
+      sprintf(szBuff, "%u", (uAdaptive3 >> 16) & 0xFFFF);
+      g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
+      y += height_text*s_OSDStatsLineSpacing;
+   }
    else
-      strcpy(szBuff, "Disabled");
-   g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
-   y += height_text*s_OSDStatsLineSpacing;
+   {
+      g_pRenderEngine->drawText(xPos, y, s_idFontStats, "Video Thresholds Up:");
+      if ( adaptiveVideoIsOn )
+         sprintf(szBuff, "%u, %u", (g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive2 & 0xFF ), (g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive2 >> 8) & 0xFF );
+      else
+         strcpy(szBuff, "Disabled");
+      g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
+      y += height_text*s_OSDStatsLineSpacing;
 
-   g_pRenderEngine->drawText(xPos, y, s_idFontStats, "Video Thresholds Down:");
-   if ( adaptiveVideoIsOn )
-      sprintf(szBuff, "%u, %u", (g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive2>>16) & 0xFF, (g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive2 >> 24) & 0xFF );
-   else
-      strcpy(szBuff, "Disabled");
-   g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
-   y += height_text*s_OSDStatsLineSpacing;
+      g_pRenderEngine->drawText(xPos, y, s_idFontStats, "Video Thresholds Down:");
+      if ( adaptiveVideoIsOn )
+         sprintf(szBuff, "%u, %u", (g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive2>>16) & 0xFF, (g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uIntervalsAdaptive2 >> 24) & 0xFF );
+      else
+         strcpy(szBuff, "Disabled");
+      g_pRenderEngine->drawTextLeft(rightMargin, y, s_idFontStats, szBuff);
+      y += height_text*s_OSDStatsLineSpacing;
+   }
 
 
    if ( g_TimeNow < g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iIndexVehicleRuntimeInfo].uTimeLastRequestedLevelShift + 700 )
@@ -47,6 +47,7 @@
 #include "osd_stats.h"
 #include "osd_stats_dev.h"
 #include "osd_stats_radio.h"
+#include "osd_graph_cache.h"
 #include "../local_stats.h"
 #include "../launchers_controller.h"
 #include "../pairing.h"
@@ -1765,6 +1766,80 @@ float osd_render_stats_radio_interfaces_graph_get_width(shared_mem_radio_stats*
    return 0.0001;
 }
 
+static type_osd_graph_cache s_GraphCacheRadioRxInterfaces[MAX_RADIO_INTERFACES];
+static bool s_bGraphCacheRadioRxInterfacesInitialized = false;
+
+// Heights of the received and lost packets bars for a slice of the rx graph
+static void _osd_rx_graph_get_bars_heights(shared_mem_radio_stats_interface_rx_graph* pInterface, int k, float hGraph, float maxRecv, float* pfBar, float* pfBarLost)
+{
+   float hBar = hGraph * (float)(pInterface->rxPackets[k]) / maxRecv;
+   float hBarLost = hGraph * (float)(pInterface->rxPacketsLost[k] + pInterface->rxPacketsBad[k]) / maxRecv;
+      
+   if ( (pInterface->rxPacketsLost[k] + pInterface->rxPacketsBad[k]) != 0 )
+   {
+      if ( hBarLost > hGraph * 0.9 )
+         hBarLost = 0.9;
+      if ( hBarLost < 0.05 * hGraph )
+            hBarLost = 0.05 * hGraph;
+   }
+   if ( hBar + hBarLost > hGraph )
+   {
+      hBar = hBar * (hGraph / (hBar + hBarLost));
+      hBarLost = hBarLost * (hGraph / (hBar + hBarLost));
+   }
+
+   if ( (pInterface->rxPacketsLost[k] + pInterface->rxPacketsBad[k]) != 0 )
+      hBarLost = ((int)(hBarLost/g_pRenderEngine->getPixelHeight())) * g_pRenderEngine->getPixelHeight();
+   hBar = ((int)(hBar/g_pRenderEngine->getPixelHeight())) * g_pRenderEngine->getPixelHeight();
+   *pfBar = hBar;
+   *pfBarLost = hBarLost;
+}
+
+// Draws the bars of an interface rx graph from a cached bitmap. Only the slices that changed are drawn again in the bitmap.
+// Returns false if the bars can't be drawn from a cached bitmap.
+static bool _osd_render_radio_rx_graph_bars_cached(int iInterface, shared_mem_radio_stats_interface_rx_graph* pInterface, float xPos, float yPos, float fWidth, float hGraph, float maxRecv)
+{
+   if ( (iInterface < 0) || (iInterface >= MAX_RADIO_INTERFACES) )
+      return false;
+   if ( ! s_bGraphCacheRadioRxInterfacesInitialized )
+   {
+      for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+         osd_graph_cache_init(&s_GraphCacheRadioRxInterfaces[i]);
+      s_bGraphCacheRadioRxInterfacesInitialized = true;
+   }
+
+   double* pc = get_Color_OSDText();
+   u32 uScaleKey = osd_graph_cache_key(OSD_GRAPH_CACHE_KEY_START, (u32)maxRecv);
+   uScaleKey = osd_graph_cache_key(uScaleKey, ((u32)pc[0]) | (((u32)pc[1])<<8) | (((u32)pc[2])<<16));
+   uScaleKey = osd_graph_cache_key(uScaleKey, (u32)(s_fOSDStatsGraphLinesAlpha*1000.0));
+
+   type_osd_graph_cache* pGraph = &s_GraphCacheRadioRxInterfaces[iInterface];
+   if ( ! osd_graph_cache_begin(pGraph, fWidth, hGraph, MAX_RX_GRAPH_SLICES, uScaleKey) )
+      return false;
+
+   float hPixel = g_pRenderEngine->getPixelHeight();
+   u32 uPixelBar = osd_graph_cache_pixel(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
+   u32 uPixelLost = osd_graph_cache_pixel(255,0,50,0.9);
+
+   for( int k=0; k<MAX_RX_GRAPH_SLICES; k++ )
+   {
+      u32 uLost = pInterface->rxPacketsLost[k] + pInterface->rxPacketsBad[k];
+      if ( ! osd_graph_cache_column_changed(pGraph, k, pInterface->rxPackets[k] | (uLost << 8)) )
+         continue;
+
+      float hBar = 0.0;
+      float hBarLost = 0.0;
+      _osd_rx_graph_get_bars_heights(pInterface, k, hGraph, maxRecv, &hBar, &hBarLost);
+      int xStart = osd_graph_cache_get_column_start(pGraph, k);
+      int iBarWidth = osd_graph_cache_get_column_end(pGraph, k) - xStart - 1;
+      if ( 0 != uLost )
+         osd_graph_cache_fill_rect(pGraph, k, xStart, (hGraph - hBarLost)/hPixel, iBarWidth, hBarLost/hPixel, uPixelLost);
+      osd_graph_cache_fill_rect(pGraph, k, xStart, (hGraph - hBarLost - hBar)/hPixel, iBarWidth, hBar/hPixel, uPixelBar);
+   }
+   osd_graph_cache_draw(pGraph, xPos, yPos);
+   return true;
+}
+
 float osd_render_stats_radio_interfaces_graph( float xPos, float yPos, shared_mem_radio_stats_interfaces_rx_graph* pStats)
 {
    if ( NULL == pStats || NULL == g_pCurrentModel )
@@ -1882,43 +1957,29 @@ float osd_render_stats_radio_interfaces_graph( float xPos, float yPos, shared_me
 
       xBar = xPos;
 
+      bool bBarsCached = _osd_render_radio_rx_graph_bars_cached(i, &pStats->interfaces[i], xPos, yPos, fWidth, hGraph, maxRecv);
+
       for( int k=0; k<MAX_RX_GRAPH_SLICES; k++ )
       {
-         g_pRenderEngine->setFill(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
-         g_pRenderEngine->setStroke(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
-         g_pRenderEngine->setStrokeSize(fStroke);
-         
-         float hBar = hGraph * (float)(pStats->interfaces[i].rxPackets[k]) / maxRecv;
-         float hBarLost = hGraph * (float)(pStats->interfaces[i].rxPacketsLost[k] + pStats->interfaces[i].rxPacketsBad[k]) / maxRecv;
-            
-         if ( (pStats->interfaces[i].rxPacketsLost[k] + pStats->interfaces[i].rxPacketsBad[k]) != 0 )
+         if ( ! bBarsCached )
          {
-            if ( hBarLost > hGraph * 0.9 )
-               hBarLost = 0.9;
-            if ( hBarLost < 0.05 * hGraph )
-                  hBarLost = 0.05 * hGraph;
-         }
-         if ( hBar + hBarLost > hGraph )
-         {
-            hBar = hBar * (hGraph / (hBar + hBarLost));
-            hBarLost = hBarLost * (hGraph / (hBar + hBarLost));
-         }
+            float hBar = 0.0;
+            float hBarLost = 0.0;
+            _osd_rx_graph_get_bars_heights(&pStats->interfaces[i], k, hGraph, maxRecv, &hBar, &hBarLost);
 
-         if ( (pStats->interfaces[i].rxPacketsLost[k] + pStats->interfaces[i].rxPacketsBad[k]) != 0 )
-         {
-            hBarLost = ((int)(hBarLost/g_pRenderEngine->getPixelHeight())) * g_pRenderEngine->getPixelHeight();
-            g_pRenderEngine->setStroke(255,0,50,0.9);
-            g_pRenderEngine->setFill(255,0,50,0.9);
+            if ( (pStats->interfaces[i].rxPacketsLost[k] + pStats->interfaces[i].rxPacketsBad[k]) != 0 )
+            {
+               g_pRenderEngine->setStroke(255,0,50,0.9);
+               g_pRenderEngine->setFill(255,0,50,0.9);
+               g_pRenderEngine->setStrokeSize(fStroke);
+               g_pRenderEngine->drawRect(xBar, yPos + hGraph - hBarLost, fBarWidth - g_pRenderEngine->getPixelWidth(), hBarLost);
+            }
+
+            g_pRenderEngine->setFill(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
+            g_pRenderEngine->setStroke(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
             g_pRenderEngine->setStrokeSize(fStroke);
-            g_pRenderEngine->drawRect(xBar, yPos + hGraph - hBarLost, fBarWidth - g_pRenderEngine->getPixelWidth(), hBarLost);
+            g_pRenderEngine->drawRect(xBar, yPos + hGraph - hBarLost - hBar, fBarWidth - g_pRenderEngine->getPixelWidth(), hBar);
          }
-         
-         hBar = ((int)(hBar/g_pRenderEngine->getPixelHeight())) * g_pRenderEngine->getPixelHeight();
-
-         g_pRenderEngine->setFill(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
-         g_pRenderEngine->setStroke(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
-         g_pRenderEngine->setStrokeSize(fStroke);
-         g_pRenderEngine->drawRect(xBar, yPos + hGraph - hBarLost - hBar, fBarWidth - g_pRenderEngine->getPixelWidth(), hBar);
          xBar += fBarWidth;
 
          if ( (pStats->interfaces[i].rxPacketsLost[k] + pStats->interfaces[i].rxPacketsBad[k]) > 0 )
@@ -35,6 +35,7 @@
 #include <math.h>
 #include "osd_stats_video_bitrate.h"
 #include "osd_common.h"
+#include "osd_graph_cache.h"
 #include "../colors.h"
 #include "../shared_vars.h"
 #include "../timers.h"
@@ -45,6 +46,323 @@ extern float s_fOSDStatsGraphLinesAlpha;
 extern u32 s_idFontStats;
 extern u32 s_idFontStatsSmall;
 
+static type_osd_graph_cache s_GraphCacheVideoBitrate;
+static type_osd_graph_cache s_GraphCacheVideoQuantization;
+static bool s_bGraphCachesVideoBitrateInitialized = false;
+
+static void _osd_render_video_bitrate_graph(float xGraph, float y, float widthGraph, float hGraph, float widthBar, u32 uMaxGraphValue)
+{
+   float wPixel = g_pRenderEngine->getPixelWidth();
+   float hPixel = g_pRenderEngine->getPixelHeight();
+
+   g_pRenderEngine->setStrokeSize(OSD_STRIKE_WIDTH);
+   //g_pRenderEngine->setStroke(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
+   //g_pRenderEngine->setFill(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
+   g_pRenderEngine->drawLine(xGraph, y+hGraph, xGraph + widthGraph, y+hGraph);
+
+   for( float i=0; i<=widthGraph-2.0*wPixel; i+= 5*wPixel )
+   {
+      g_pRenderEngine->drawLine(xGraph+i, y, xGraph + i + 2.0*wPixel, y);
+      g_pRenderEngine->drawLine(xGraph+i, y+0.5*hGraph, xGraph + i + 2.0*wPixel, y+0.5*hGraph);
+   }
+
+   float hDataratePrev = 0.0;
+   float hDatarateLowPrev = 0.0;
+   float hVideoBitratePrev = 0.0;
+   float hVideoBitrateAvgPrev = 0.0;
+   float hTotalBitrateAvgPrev = 0.0;
+
+   g_pRenderEngine->setStrokeSize(2.0);
+   float xBarMiddle = xGraph + widthBar*0.5 - g_pRenderEngine->getPixelWidth();
+   for( int i=0; i<(int)g_SM_DevVideoBitrateHistory.uTotalDataPoints; i++ )
+   {
+      float hDatarate = g_SM_DevVideoBitrateHistory.history[i].uMinVideoDataRateMbps*hGraph/uMaxGraphValue;
+      float hDatarateLow = hDatarate*DEFAULT_VIDEO_LINK_MAX_LOAD_PERCENT/100.0;
+      float hVideoBitrate = g_SM_DevVideoBitrateHistory.history[i].uVideoBitrateKb*hGraph/uMaxGraphValue/1000.0;
+      float hVideoBitrateAvg = g_SM_DevVideoBitrateHistory.history[i].uVideoBitrateAvgKb*hGraph/uMaxGraphValue/1000.0;
+      float hTotalBitrateAvg = g_SM_DevVideoBitrateHistory.history[i].uTotalVideoBitrateAvgKb*hGraph/uMaxGraphValue/1000.0;
+      if ( i != 0 )
+      {
+         g_pRenderEngine->setStroke(200,200,255, s_fOSDStatsGraphLinesAlpha);
+         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hVideoBitratePrev+hPixel, xBarMiddle, y+hGraph-hVideoBitrate+hPixel);
+
+         g_pRenderEngine->setStroke(250,230,50, s_fOSDStatsGraphLinesAlpha);
+         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hVideoBitrateAvgPrev, xBarMiddle, y+hGraph-hVideoBitrateAvg);
+
+         g_pRenderEngine->setStroke(255,250,220, s_fOSDStatsGraphLinesAlpha);
+         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hTotalBitrateAvgPrev, xBarMiddle, y+hGraph-hTotalBitrateAvg);
+
+         g_pRenderEngine->setStroke(250,50,100, s_fOSDStatsGraphLinesAlpha);
+
+         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hDataratePrev, xBarMiddle, y+hGraph-hDataratePrev);
+         if ( i != g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
+         if ( fabs(hDatarate-hDataratePrev) >= g_pRenderEngine->getPixelHeight() )           
+            g_pRenderEngine->drawLine(xBarMiddle, y+hGraph-hDatarate, xBarMiddle, y+hGraph-hDataratePrev);
+         
+         g_pRenderEngine->setStroke(250,100,150, s_fOSDStatsGraphLinesAlpha);
+
+         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hDatarateLow, xBarMiddle, y+hGraph-hDatarateLow);
+         if ( i != g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
+         if ( fabs(hDatarateLow-hDatarateLowPrev) >= g_pRenderEngine->getPixelHeight() )           
+            g_pRenderEngine->drawLine(xBarMiddle, y+hGraph-hDatarateLow, xBarMiddle, y+hGraph-hDatarateLowPrev);
+      
+         if ( g_SM_DevVideoBitrateHistory.history[i-1].uVideoProfileSwitches != g_SM_DevVideoBitrateHistory.history[i].uVideoProfileSwitches )
+         if ( (g_SM_DevVideoBitrateHistory.history[i-1].uVideoProfileSwitches>>4) != (g_SM_DevVideoBitrateHistory.history[i].uVideoProfileSwitches>>4) )
+         {
+            int iVideoProfile = (g_SM_DevVideoBitrateHistory.history[i-1].uVideoProfileSwitches)>>4;
+
+            if ( iVideoProfile == VIDEO_PROFILE_LQ )
+               g_pRenderEngine->setStroke(250,50,50, s_fOSDStatsGraphLinesAlpha);
+            else if ( iVideoProfile == VIDEO_PROFILE_MQ )
+               g_pRenderEngine->setStroke(200,250,50, s_fOSDStatsGraphLinesAlpha);
+            else
+               g_pRenderEngine->setStroke(50,250,50, s_fOSDStatsGraphLinesAlpha);
+
+            g_pRenderEngine->drawLine(xBarMiddle - widthBar*0.5, y, xBarMiddle - widthBar*0.5, y + hGraph);
+         }
+
+         if ( i == g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
+         {
+            g_pRenderEngine->setStroke(100,100,250, 1.0);
+            g_pRenderEngine->drawLine(xBarMiddle+widthBar*0.5, y+hGraph, xBarMiddle+widthBar*0.5, y);
+         }
+      }
+
+      hDataratePrev = hDatarate;
+      hDatarateLowPrev = hDatarateLow;
+      hVideoBitratePrev = hVideoBitrate;
+      hVideoBitrateAvgPrev = hVideoBitrateAvg;
+      hTotalBitrateAvgPrev = hTotalBitrateAvg;
+      xBarMiddle += widthBar;
+   }
+}
+
+// Adds to the column key all the fields of the data point iIndex and if it's the current data point.
+// Returns the key length.
+static int _osd_video_bitrate_graph_add_item_key(u8* pKey, int iIndex)
+{
+   const int iPointSize = (int)sizeof(shared_mem_dev_video_bitrate_history_datapoint);
+   if ( (iIndex < 0) || (iIndex >= (int)g_SM_DevVideoBitrateHistory.uTotalDataPoints) )
+   {
+      memset(pKey, 0, iPointSize + 1);
+      return iPointSize + 1;
+   }
+   pKey[0] = (iIndex == (int)g_SM_DevVideoBitrateHistory.uCurrentDataPoint)?2:1;
+   memcpy(pKey + 1, &g_SM_DevVideoBitrateHistory.history[iIndex], iPointSize);
+   return iPointSize + 1;
+}
+
+// Draws the lines of the data point k (the lines from the previous data point to it), clipped to column iColumn.
+// Same geometry as _osd_render_video_bitrate_graph, in graph pixels.
+static void _osd_video_bitrate_graph_draw_item(type_osd_graph_cache* pGraph, int iColumn, int k, float fHeight, float fColWidth, u32 uMaxGraphValue)
+{
+   shared_mem_dev_video_bitrate_history_datapoint* pPoint = &g_SM_DevVideoBitrateHistory.history[k];
+   shared_mem_dev_video_bitrate_history_datapoint* pPrev = &g_SM_DevVideoBitrateHistory.history[k-1];
+   float xMiddle = (k+0.5)*fColWidth - 1.0;
+   float xMiddlePrev = xMiddle - fColWidth;
+
+   float hDatarate = pPoint->uMinVideoDataRateMbps*fHeight/uMaxGraphValue;
+   float hDatarateLow = hDatarate*DEFAULT_VIDEO_LINK_MAX_LOAD_PERCENT/100.0;
+   float hDataratePrev = pPrev->uMinVideoDataRateMbps*fHeight/uMaxGraphValue;
+   float hDatarateLowPrev = hDataratePrev*DEFAULT_VIDEO_LINK_MAX_LOAD_PERCENT/100.0;
+   float hVideoBitrate = pPoint->uVideoBitrateKb*fHeight/uMaxGraphValue/1000.0;
+   float hVideoBitratePrev = pPrev->uVideoBitrateKb*fHeight/uMaxGraphValue/1000.0;
+   float hVideoBitrateAvg = pPoint->uVideoBitrateAvgKb*fHeight/uMaxGraphValue/1000.0;
+   float hVideoBitrateAvgPrev = pPrev->uVideoBitrateAvgKb*fHeight/uMaxGraphValue/1000.0;
+   float hTotalBitrateAvg = pPoint->uTotalVideoBitrateAvgKb*fHeight/uMaxGraphValue/1000.0;
+   float hTotalBitrateAvgPrev = pPrev->uTotalVideoBitrateAvgKb*fHeight/uMaxGraphValue/1000.0;
+
+   osd_graph_cache_draw_line(pGraph, iColumn, xMiddlePrev, fHeight-hVideoBitratePrev+1.0, xMiddle, fHeight-hVideoBitrate+1.0, 2, osd_graph_cache_pixel(200,200,255, s_fOSDStatsGraphLinesAlpha));
+   osd_graph_cache_draw_line(pGraph, iColumn, xMiddlePrev, fHeight-hVideoBitrateAvgPrev, xMiddle, fHeight-hVideoBitrateAvg, 2, osd_graph_cache_pixel(250,230,50, s_fOSDStatsGraphLinesAlpha));
+   osd_graph_cache_draw_line(pGraph, iColumn, xMiddlePrev, fHeight-hTotalBitrateAvgPrev, xMiddle, fHeight-hTotalBitrateAvg, 2, osd_graph_cache_pixel(255,250,220, s_fOSDStatsGraphLinesAlpha));
+
+   u32 uPixel = osd_graph_cache_pixel(250,50,100, s_fOSDStatsGraphLinesAlpha);
+   osd_graph_cache_draw_line(pGraph, iColumn, xMiddlePrev, fHeight-hDataratePrev, xMiddle, fHeight-hDataratePrev, 2, uPixel);
+   if ( k != (int)g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
+   if ( fabs(hDatarate-hDataratePrev) >= 1.0 )
+      osd_graph_cache_draw_line(pGraph, iColumn, xMiddle, fHeight-hDatarate, xMiddle, fHeight-hDataratePrev, 2, uPixel);
+
+   uPixel = osd_graph_cache_pixel(250,100,150, s_fOSDStatsGraphLinesAlpha);
+   osd_graph_cache_draw_line(pGraph, iColumn, xMiddlePrev, fHeight-hDatarateLow, xMiddle, fHeight-hDatarateLow, 2, uPixel);
+   if ( k != (int)g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
+   if ( fabs(hDatarateLow-hDatarateLowPrev) >= 1.0 )
+      osd_graph_cache_draw_line(pGraph, iColumn, xMiddle, fHeight-hDatarateLow, xMiddle, fHeight-hDatarateLowPrev, 2, uPixel);
+
+   if ( (pPrev->uVideoProfileSwitches>>4) != (pPoint->uVideoProfileSwitches>>4) )
+   {
+      int iVideoProfile = (pPrev->uVideoProfileSwitches)>>4;
+      if ( iVideoProfile == VIDEO_PROFILE_LQ )
+         uPixel = osd_graph_cache_pixel(250,50,50, s_fOSDStatsGraphLinesAlpha);
+      else if ( iVideoProfile == VIDEO_PROFILE_MQ )
+         uPixel = osd_graph_cache_pixel(200,250,50, s_fOSDStatsGraphLinesAlpha);
+      else
+         uPixel = osd_graph_cache_pixel(50,250,50, s_fOSDStatsGraphLinesAlpha);
+      osd_graph_cache_draw_line(pGraph, iColumn, xMiddle - fColWidth*0.5, 0, xMiddle - fColWidth*0.5, fHeight, 2, uPixel);
+   }
+
+   if ( k == (int)g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
+      osd_graph_cache_draw_line(pGraph, iColumn, xMiddle + fColWidth*0.5, fHeight, xMiddle + fColWidth*0.5, 0, 2, osd_graph_cache_pixel(100,100,250, 1.0));
+}
+
+static u32 _osd_video_graphs_get_colors_key()
+{
+   double* pc = get_Color_OSDTextOutline();
+   u32 uKey = osd_graph_cache_key(OSD_GRAPH_CACHE_KEY_START, (u32)(s_fOSDStatsGraphLinesAlpha*1000.0));
+   uKey = osd_graph_cache_key(uKey, ((u32)pc[0]) | (((u32)pc[1])<<8) | (((u32)pc[2])<<16));
+   uKey = osd_graph_cache_key(uKey, (u32)(pc[3]*1000.0));
+   return uKey;
+}
+
+// Returns false if the graph can't be drawn from the cached bitmap
+static bool _osd_render_video_bitrate_graph_cached(float xGraph, float y, float widthGraph, float hGraph, u32 uMaxGraphValue)
+{
+   if ( ! s_bGraphCachesVideoBitrateInitialized )
+   {
+      osd_graph_cache_init(&s_GraphCacheVideoBitrate);
+      osd_graph_cache_init(&s_GraphCacheVideoQuantization);
+      s_bGraphCachesVideoBitrateInitialized = true;
+   }
+
+   int iCount = (int)g_SM_DevVideoBitrateHistory.uTotalDataPoints;
+   u32 uScaleKey = osd_graph_cache_key(_osd_video_graphs_get_colors_key(), uMaxGraphValue);
+   // Bitmap has 2 more pixel lines for the bottom line of the graph
+   type_osd_graph_cache* pGraph = &s_GraphCacheVideoBitrate;
+   if ( ! osd_graph_cache_begin(pGraph, widthGraph, hGraph + 2.0*g_pRenderEngine->getPixelHeight(), iCount, uScaleKey) )
+      return false;
+
+   float fHeight = hGraph/g_pRenderEngine->getPixelHeight();
+   float fColWidth = (float)pGraph->iPixelWidth/(float)iCount;
+   double* pc = get_Color_OSDTextOutline();
+   u32 uPixelGrid = osd_graph_cache_pixel(pc[0], pc[1], pc[2], pc[3]);
+
+   for( int iColumn=0; iColumn<iCount; iColumn++ )
+   {
+      u8 uKey[OSD_GRAPH_CACHE_MAX_KEY_BYTES];
+      int iKeyLength = 0;
+      for( int k=iColumn-2; k<=iColumn+2; k++ )
+         iKeyLength += _osd_video_bitrate_graph_add_item_key(uKey + iKeyLength, k);
+      if ( ! osd_graph_cache_column_data_changed(pGraph, iColumn, uKey, iKeyLength) )
+         continue;
+
+      osd_graph_cache_draw_dotted_hline(pGraph, iColumn, 0, uPixelGrid);
+      osd_graph_cache_draw_dotted_hline(pGraph, iColumn, fHeight*0.5, uPixelGrid);
+      osd_graph_cache_fill_rect(pGraph, iColumn, 0, fHeight, pGraph->iPixelWidth, 1, uPixelGrid);
+
+      for( int k=iColumn-1; k<=iColumn+2; k++ )
+      {
+         if ( (k >= 1) && (k < iCount) )
+            _osd_video_bitrate_graph_draw_item(pGraph, iColumn, k, fHeight, fColWidth, uMaxGraphValue);
+      }
+   }
+   osd_graph_cache_draw(pGraph, xGraph, y);
+   return true;
+}
+
+static void _osd_render_video_quantization_graph(float xGraph, float y, float widthGraph, float hGraph, float widthBar, u32 uMinQuant, u32 uMaxQuant)
+{
+   float wPixel = g_pRenderEngine->getPixelWidth();
+
+   g_pRenderEngine->setStrokeSize(OSD_STRIKE_WIDTH);
+   //g_pRenderEngine->setStroke(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
+   //g_pRenderEngine->setFill(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
+   
+   for( float i=0; i<=widthGraph-2.0*wPixel; i+= 5*wPixel )
+   {
+      g_pRenderEngine->drawLine(xGraph+i, y, xGraph + i + 2.0*wPixel, y);
+      g_pRenderEngine->drawLine(xGraph+i, y+0.5*hGraph, xGraph + i + 2.0*wPixel, y+0.5*hGraph);
+      g_pRenderEngine->drawLine(xGraph+i, y+hGraph, xGraph + i + 2.0*wPixel, y+hGraph);
+   }
+
+   u32 uMaxDelta = uMaxQuant - uMinQuant;
+   float hVideoQuantizationPrev = 0.0;
+   float xBarMiddle = xGraph + widthBar*0.5 - g_pRenderEngine->getPixelWidth();
+
+   g_pRenderEngine->setStroke(150,200,250, s_fOSDStatsGraphLinesAlpha*0.9);
+         
+   g_pRenderEngine->setStrokeSize(2.0);
+
+   for( int i=0; i<(int)g_SM_DevVideoBitrateHistory.uTotalDataPoints; i++ )
+   {
+      float hVideoQuantization = (g_SM_DevVideoBitrateHistory.history[i].uVideoQuantization-uMinQuant)*hGraph/uMaxDelta;
+ 
+      if ( (g_SM_DevVideoBitrateHistory.history[i].uVideoQuantization == 0xFF) ||
+           (i > 0 && g_SM_DevVideoBitrateHistory.history[i-1].uVideoQuantization == 0xFF ) )
+      {
+ 
+         g_pRenderEngine->setFill(100,100,200, s_fOSDStatsGraphLinesAlpha*0.6);
+         g_pRenderEngine->setStroke(150,200,250, s_fOSDStatsGraphLinesAlpha*0.9*0.6);   
+         g_pRenderEngine->setStrokeSize(0.0);
+      
+         g_pRenderEngine->drawRect(xBarMiddle-widthBar*0.5, y+4.0*g_pRenderEngine->getPixelHeight(), widthBar, hGraph-8.0*g_pRenderEngine->getPixelHeight());
+ 
+         g_pRenderEngine->setStroke(150,200,250, s_fOSDStatsGraphLinesAlpha*0.9);   
+         g_pRenderEngine->setStrokeSize(2.0);
+      }
+      else if ( i != 0 )
+         g_pRenderEngine->drawLine(xBarMiddle, y+hGraph-hVideoQuantization, xBarMiddle+widthBar, y+hGraph-hVideoQuantizationPrev);
+ 
+      hVideoQuantizationPrev = hVideoQuantization;
+      xBarMiddle += widthBar;
+   }
+}
+
+// Returns false if the graph can't be drawn from the cached bitmap
+static bool _osd_render_video_quantization_graph_cached(float xGraph, float y, float widthGraph, float hGraph, u32 uMinQuant, u32 uMaxQuant)
+{
+   int iCount = (int)g_SM_DevVideoBitrateHistory.uTotalDataPoints;
+   u32 uScaleKey = osd_graph_cache_key(_osd_video_graphs_get_colors_key(), uMinQuant | (uMaxQuant<<16));
+   type_osd_graph_cache* pGraph = &s_GraphCacheVideoQuantization;
+   if ( ! osd_graph_cache_begin(pGraph, widthGraph, hGraph + 2.0*g_pRenderEngine->getPixelHeight(), iCount, uScaleKey) )
+      return false;
+
+   u32 uMaxDelta = uMaxQuant - uMinQuant;
+   float fHeight = hGraph/g_pRenderEngine->getPixelHeight();
+   float fColWidth = (float)pGraph->iPixelWidth/(float)iCount;
+   double* pc = get_Color_OSDTextOutline();
+   u32 uPixelGrid = osd_graph_cache_pixel(pc[0], pc[1], pc[2], pc[3]);
+   u32 uPixelLine = osd_graph_cache_pixel(150,200,250, s_fOSDStatsGraphLinesAlpha*0.9);
+   u32 uPixelGap = osd_graph_cache_pixel(100,100,200, s_fOSDStatsGraphLinesAlpha*0.6);
+
+   for( int iColumn=0; iColumn<iCount; iColumn++ )
+   {
+      // Quantization values are 8 bits: the key holds the 4 values as is, 0xFFFF for no data point
+      u8 uKey[8];
+      int iKeyLength = 0;
+      for( int k=iColumn-2; k<=iColumn+1; k++ )
+      {
+         u16 uValue = 0xFFFF;
+         if ( (k >= 0) && (k < iCount) )
+            uValue = g_SM_DevVideoBitrateHistory.history[k].uVideoQuantization;
+         memcpy(uKey + iKeyLength, &uValue, sizeof(u16));
+         iKeyLength += sizeof(u16);
+      }
+      if ( ! osd_graph_cache_column_data_changed(pGraph, iColumn, uKey, iKeyLength) )
+         continue;
+
+      osd_graph_cache_draw_dotted_hline(pGraph, iColumn, 0, uPixelGrid);
+      osd_graph_cache_draw_dotted_hline(pGraph, iColumn, fHeight*0.5, uPixelGrid);
+      osd_graph_cache_draw_dotted_hline(pGraph, iColumn, fHeight, uPixelGrid);
+
+      for( int k=iColumn-1; k<=iColumn+1; k++ )
+      {
+         if ( (k < 0) || (k >= iCount) )
+            continue;
+         float xMiddle = (k+0.5)*fColWidth - 1.0;
+         u32 uQuant = g_SM_DevVideoBitrateHistory.history[k].uVideoQuantization;
+         if ( (uQuant == 0xFF) || ((k > 0) && (g_SM_DevVideoBitrateHistory.history[k-1].uVideoQuantization == 0xFF)) )
+            osd_graph_cache_fill_rect(pGraph, iColumn, xMiddle - fColWidth*0.5, 4.0, fColWidth, fHeight - 8.0, uPixelGap);
+         else if ( k != 0 )
+         {
+            float hQuant = ((int)uQuant - (int)uMinQuant)*fHeight/uMaxDelta;
+            float hQuantPrev = ((int)g_SM_DevVideoBitrateHistory.history[k-1].uVideoQuantization - (int)uMinQuant)*fHeight/uMaxDelta;
+            osd_graph_cache_draw_line(pGraph, iColumn, xMiddle, fHeight - hQuant, xMiddle + fColWidth, fHeight - hQuantPrev, 2, uPixelLine);
+         }
+      }
+   }
+   osd_graph_cache_draw(pGraph, xGraph, y);
+   return true;
+}
+
 float osd_render_stats_video_bitrate_history_get_height()
 {
    float height_text = g_pRenderEngine->textHeight(s_idFontStats);
@@ -84,8 +402,6 @@ void osd_render_stats_video_bitrate_history(float xPos, float yPos)
    float height_text_small = g_pRenderEngine->textHeight(s_idFontStatsSmall);
    float hGraph = height_text * 3.5;
    float hGraph2 = height_text * 2.0;
-   float wPixel = g_pRenderEngine->getPixelWidth();
-   float hPixel = g_pRenderEngine->getPixelHeight();
 
    float width = osd_render_stats_video_bitrate_history_get_width();
    float height = osd_render_stats_video_bitrate_history_get_height();
@@ -175,86 +491,9 @@ void osd_render_stats_video_bitrate_history(float xPos, float yPos)
    g_pRenderEngine->drawText(xPos + dxGraph*0.2, y+hGraph-height_text_small*0.6, s_idFontStatsSmall,szBuff);
    g_pRenderEngine->drawText(xPos + dxGraph + widthGraph + 3.0*g_pRenderEngine->getPixelWidth(), y+hGraph-height_text_small*0.6, s_idFontStatsSmall,szBuff);
 
-   g_pRenderEngine->setStrokeSize(OSD_STRIKE_WIDTH);
-   //g_pRenderEngine->setStroke(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
-   //g_pRenderEngine->setFill(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
-   g_pRenderEngine->drawLine(xPos+dxGraph, y+hGraph, xPos + dxGraph + widthGraph, y+hGraph);
-
-   for( float i=0; i<=widthGraph-2.0*wPixel; i+= 5*wPixel )
-   {
-      g_pRenderEngine->drawLine(xPos+dxGraph+i, y, xPos + dxGraph + i + 2.0*wPixel, y);
-      g_pRenderEngine->drawLine(xPos+dxGraph+i, y+0.5*hGraph, xPos + dxGraph + i + 2.0*wPixel, y+0.5*hGraph);
-   }
-
-   float hDataratePrev = 0.0;
-   float hDatarateLowPrev = 0.0;
-   float hVideoBitratePrev = 0.0;
-   float hVideoBitrateAvgPrev = 0.0;
-   float hTotalBitrateAvgPrev = 0.0;
-
-   g_pRenderEngine->setStrokeSize(2.0);
-   float xBarMiddle = xPos + dxGraph + widthBar*0.5 - g_pRenderEngine->getPixelWidth();
-   for( int i=0; i<(int)g_SM_DevVideoBitrateHistory.uTotalDataPoints; i++ )
-   {
-      float hDatarate = g_SM_DevVideoBitrateHistory.history[i].uMinVideoDataRateMbps*hGraph/uMaxGraphValue;
-      float hDatarateLow = hDatarate*DEFAULT_VIDEO_LINK_MAX_LOAD_PERCENT/100.0;
-      float hVideoBitrate = g_SM_DevVideoBitrateHistory.history[i].uVideoBitrateKb*hGraph/uMaxGraphValue/1000.0;
-      float hVideoBitrateAvg = g_SM_DevVideoBitrateHistory.history[i].uVideoBitrateAvgKb*hGraph/uMaxGraphValue/1000.0;
-      float hTotalBitrateAvg = g_SM_DevVideoBitrateHistory.history[i].uTotalVideoBitrateAvgKb*hGraph/uMaxGraphValue/1000.0;
-      if ( i != 0 )
-      {
-         g_pRenderEngine->setStroke(200,200,255, s_fOSDStatsGraphLinesAlpha);
-         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hVideoBitratePrev+hPixel, xBarMiddle, y+hGraph-hVideoBitrate+hPixel);
-
-         g_pRenderEngine->setStroke(250,230,50, s_fOSDStatsGraphLinesAlpha);
-         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hVideoBitrateAvgPrev, xBarMiddle, y+hGraph-hVideoBitrateAvg);
-
-         g_pRenderEngine->setStroke(255,250,220, s_fOSDStatsGraphLinesAlpha);
-         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hTotalBitrateAvgPrev, xBarMiddle, y+hGraph-hTotalBitrateAvg);
-
-         g_pRenderEngine->setStroke(250,50,100, s_fOSDStatsGraphLinesAlpha);
-
-         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hDataratePrev, xBarMiddle, y+hGraph-hDataratePrev);
-         if ( i != g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
-         if ( fabs(hDatarate-hDataratePrev) >= g_pRenderEngine->getPixelHeight() )           
-            g_pRenderEngine->drawLine(xBarMiddle, y+hGraph-hDatarate, xBarMiddle, y+hGraph-hDataratePrev);
-         
-         g_pRenderEngine->setStroke(250,100,150, s_fOSDStatsGraphLinesAlpha);
-
-         g_pRenderEngine->drawLine(xBarMiddle-widthBar, y+hGraph-hDatarateLow, xBarMiddle, y+hGraph-hDatarateLow);
-         if ( i != g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
-         if ( fabs(hDatarateLow-hDatarateLowPrev) >= g_pRenderEngine->getPixelHeight() )           
-            g_pRenderEngine->drawLine(xBarMiddle, y+hGraph-hDatarateLow, xBarMiddle, y+hGraph-hDatarateLowPrev);
-      
-         if ( g_SM_DevVideoBitrateHistory.history[i-1].uVideoProfileSwitches != g_SM_DevVideoBitrateHistory.history[i].uVideoProfileSwitches )
-         if ( (g_SM_DevVideoBitrateHistory.history[i-1].uVideoProfileSwitches>>4) != (g_SM_DevVideoBitrateHistory.history[i].uVideoProfileSwitches>>4) )
-         {
-            int iVideoProfile = (g_SM_DevVideoBitrateHistory.history[i-1].uVideoProfileSwitches)>>4;
-
-            if ( iVideoProfile == VIDEO_PROFILE_LQ )
-               g_pRenderEngine->setStroke(250,50,50, s_fOSDStatsGraphLinesAlpha);
-            else if ( iVideoProfile == VIDEO_PROFILE_MQ )
-               g_pRenderEngine->setStroke(200,250,50, s_fOSDStatsGraphLinesAlpha);
-            else
-               g_pRenderEngine->setStroke(50,250,50, s_fOSDStatsGraphLinesAlpha);
+   if ( ! _osd_render_video_bitrate_graph_cached(xPos+dxGraph, y, widthGraph, hGraph, uMaxGraphValue) )
+      _osd_render_video_bitrate_graph(xPos+dxGraph, y, widthGraph, hGraph, widthBar, uMaxGraphValue);
 
-            g_pRenderEngine->drawLine(xBarMiddle - widthBar*0.5, y, xBarMiddle - widthBar*0.5, y + hGraph);
-         }
-
-         if ( i == g_SM_DevVideoBitrateHistory.uCurrentDataPoint )
-         {
-            g_pRenderEngine->setStroke(100,100,250, 1.0);
-            g_pRenderEngine->drawLine(xBarMiddle+widthBar*0.5, y+hGraph, xBarMiddle+widthBar*0.5, y);
-         }
-      }
-
-      hDataratePrev = hDatarate;
-      hDatarateLowPrev = hDatarateLow;
-      hVideoBitratePrev = hVideoBitrate;
-      hVideoBitrateAvgPrev = hVideoBitrateAvg;
-      hTotalBitrateAvgPrev = hTotalBitrateAvg;
-      xBarMiddle += widthBar;
-   }
    y += hGraph + height_text*0.4;
    g_pRenderEngine->setStrokeSize(1.0);
    
@@ -337,8 +576,6 @@ void osd_render_stats_video_bitrate_history(float xPos, float yPos)
          uMaxQuant = uMinQuant + 2;
       }
 
-      u32 uMaxDelta = uMaxQuant - uMinQuant;
-
       y += height_text*0.6;
       yBottomGraph = y + hGraph2;
       yBottomGraph = ((int)(yBottomGraph/g_pRenderEngine->getPixelHeight())) * g_pRenderEngine->getPixelHeight();
@@ -355,47 +592,8 @@ void osd_render_stats_video_bitrate_history(float xPos, float yPos)
       g_pRenderEngine->drawText(xPos, y+hGraph2-height_text_small*0.6, s_idFontStatsSmall,szBuff);
       g_pRenderEngine->drawText(xPos + dxGraph + widthGraph + 3.0*g_pRenderEngine->getPixelWidth(), y+hGraph2-height_text_small*0.6, s_idFontStatsSmall,szBuff);
 
-      g_pRenderEngine->setStrokeSize(OSD_STRIKE_WIDTH);
-      //g_pRenderEngine->setStroke(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
-      //g_pRenderEngine->setFill(pc[0], pc[1], pc[2], s_fOSDStatsGraphLinesAlpha);
-      
-      for( float i=0; i<=widthGraph-2.0*wPixel; i+= 5*wPixel )
-      {
-         g_pRenderEngine->drawLine(xPos+dxGraph+i, y, xPos + dxGraph + i + 2.0*wPixel, y);
-         g_pRenderEngine->drawLine(xPos+dxGraph+i, y+0.5*hGraph2, xPos + dxGraph + i + 2.0*wPixel, y+0.5*hGraph2);
-         g_pRenderEngine->drawLine(xPos+dxGraph+i, y+hGraph2, xPos + dxGraph + i + 2.0*wPixel, y+hGraph2);
-      }
-
-      float hVideoQuantizationPrev = 0.0;
-      xBarMiddle = xPos + dxGraph + widthBar*0.5 - g_pRenderEngine->getPixelWidth();
-
-      g_pRenderEngine->setStroke(150,200,250, s_fOSDStatsGraphLinesAlpha*0.9);
-            
-      g_pRenderEngine->setStrokeSize(2.0);
-
-      for( int i=0; i<(int)g_SM_DevVideoBitrateHistory.uTotalDataPoints; i++ )
-      {
-         float hVideoQuantization = (g_SM_DevVideoBitrateHistory.history[i].uVideoQuantization-uMinQuant)*hGraph2/uMaxDelta;
-    
-         if ( (g_SM_DevVideoBitrateHistory.history[i].uVideoQuantization == 0xFF) ||
-              (i > 0 && g_SM_DevVideoBitrateHistory.history[i-1].uVideoQuantization == 0xFF ) )
-         {
-    
-            g_pRenderEngine->setFill(100,100,200, s_fOSDStatsGraphLinesAlpha*0.6);
-            g_pRenderEngine->setStroke(150,200,250, s_fOSDStatsGraphLinesAlpha*0.9*0.6);   
-            g_pRenderEngine->setStrokeSize(0.0);
-         
-            g_pRenderEngine->drawRect(xBarMiddle-widthBar*0.5, y+4.0*g_pRenderEngine->getPixelHeight(), widthBar, hGraph2-8.0*g_pRenderEngine->getPixelHeight());
-    
-            g_pRenderEngine->setStroke(150,200,250, s_fOSDStatsGraphLinesAlpha*0.9);   
-            g_pRenderEngine->setStrokeSize(2.0);
-         }
-         else if ( i != 0 )
-            g_pRenderEngine->drawLine(xBarMiddle, y+hGraph2-hVideoQuantization, xBarMiddle+widthBar, y+hGraph2-hVideoQuantizationPrev);
-    
-         hVideoQuantizationPrev = hVideoQuantization;
-         xBarMiddle += widthBar;
-      }
+      if ( ! _osd_render_video_quantization_graph_cached(xPos+dxGraph, y, widthGraph, hGraph2, uMinQuant, uMaxQuant) )
+         _osd_render_video_quantization_graph(xPos+dxGraph, y, widthGraph, hGraph2, widthBar, uMinQuant, uMaxQuant);
    }
    g_pRenderEngine->setStrokeSize(0);
    osd_set_colors();
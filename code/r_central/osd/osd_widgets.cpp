@@ -32,6 +32,7 @@
 #include "osd_widgets.h"
 #include "osd_common.h"
 #include "osd_widgets_builtin.h"
+#include "osd_profiler.h"
 
 #include "../../base/config.h"
 #include "../../base/models_list.h"
@@ -292,11 +293,7 @@ int osd_widget_add_to_model(type_osd_widget* pWidget, u32 uVehicleId)
          bool bValidModel = false;
          for( int k=0; k<getControllerModelsCount(); k++ )
          {
-            Model *p = getModelAtIndex(k);
-            if ( NULL == p )
-               continue;
-
-            if ( p->uVehicleId == pWidget->display_info[i][0].uVehicleId )
+            if ( getModelIdAtIndex(k) == pWidget->display_info[i][0].uVehicleId )
             {
                bValidModel = true;
                break;
@@ -372,7 +369,9 @@ void osd_widgets_render(u32 uCurrentVehicleId, int iOSDScreen)
          if ( s_ListOSDWidgets[iWidget].display_info[iModel][iOSDScreen].uVehicleId == uCurrentVehicleId )
          if ( s_ListOSDWidgets[iWidget].display_info[iModel][iOSDScreen].bShow )
          {
+            osd_profiler_begin(s_ListOSDWidgets[iWidget].info.szName);
             _osd_render_widget(iWidget, iModel, uCurrentVehicleId, iOSDScreen);
+            osd_profiler_end();
          }
       }
    }
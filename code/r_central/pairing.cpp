@@ -451,6 +451,9 @@ void _pairing_close_shared_mem()
    shared_mem_controller_audio_decode_stats_close(g_pSM_AudioDecodeStats);
    g_pSM_AudioDecodeStats = NULL;
 
+   shared_mem_video_player_stats_close(g_pSM_VideoPlayerStats);
+   g_pSM_VideoPlayerStats = NULL;
+
 
    shared_mem_radio_stats_rx_hist_close(g_pSM_HistoryRxStats);
    g_pSM_HistoryRxStats = NULL;
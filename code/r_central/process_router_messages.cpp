@@ -1079,17 +1079,8 @@ int _process_received_message_from_router(u8* pPacketBuffer)
          }
          u8* pTelemetryData = pPacketBuffer + sizeof(t_packet_header)+sizeof(t_packet_header_telemetry_raw);
 
-         for( int i=0; i<g_iPluginsOSDCount; i++ )
-         {
-            if ( NULL == g_pPluginsOSD[i]->pFunctionRequestTelemetryStreams ||
-                 NULL == g_pPluginsOSD[i]->pFunctionOnTelemetryStreamData ||
-                 NULL == g_pCurrentModel )
-               continue;
-
-            int iRes = (*(g_pPluginsOSD[i]->pFunctionRequestTelemetryStreams))();
-            if ( iRes )
-               (*(g_pPluginsOSD[i]->pFunctionOnTelemetryStreamData))(pTelemetryData, len, g_pCurrentModel->telemetry_params.fc_telemetry_type);
-         }
+         if ( NULL != g_pCurrentModel )
+            osd_plugins_on_telemetry_stream_data(pTelemetryData, len, g_pCurrentModel->telemetry_params.fc_telemetry_type);
       }
       return 0;
    }
@@ -1206,6 +1197,20 @@ int _process_received_message_from_router(u8* pPacketBuffer)
       return 0;
    }
 
+   if ( pPH->packet_type == PACKET_TYPE_RUBY_MODEL_SECTION )
+   if ( g_bFirstModelPairingDone )
+   {
+      handle_commands_on_model_section_received(pPacketBuffer);
+      return 0;
+   }
+
+   if ( pPH->packet_type == PACKET_TYPE_RUBY_FILE_TRANSFER_SEGMENT )
+   if ( g_bFirstModelPairingDone )
+   {
+      handle_commands_on_file_transfer_segment_received(pPacketBuffer);
+      return 0;
+   }
+
    if ( pPH->packet_type == PACKET_TYPE_LOCAL_CONTROL_RECEIVED_VEHICLE_LOG_SEGMENT )
    if ( g_bFirstModelPairingDone )
    {
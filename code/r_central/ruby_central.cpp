@@ -51,6 +51,7 @@
 #include <dirent.h>
 #include <string.h>
 #include <sys/resource.h>
+#include <pthread.h>
 
 #include "ruby_central.h"
 #include "../radio/radiolink.h"
@@ -86,6 +87,7 @@
 #include "osd_common.h"
 #include "osd_plugins.h"
 #include "osd_widgets.h"
+#include "osd_profiler.h"
 #include "menu.h"
 #include "fonts.h"
 #include "popup.h"
@@ -140,6 +142,14 @@ static u32 s_TimeLastRecordingStop = 0;
 static bool s_bFreezeOSD = false;
 static u32 s_uTimeFreezeOSD = 0;
 
+static pthread_mutex_t s_MutexUIState;
+static bool s_bMutexUIStateInitialized = false;
+// The render engine lock (see render_engine.h) is taken after the UI state lock.
+static u32 s_uRenderedFramesCount = 0;
+static pthread_t s_pThreadRender;
+static volatile bool s_bRenderThreadRunning = false;
+static volatile bool s_bRenderThreadMustStop = false;
+
 shared_mem_process_stats* s_pProcessStatsCentral = NULL;
 
 Popup popupNoModel("No vehicle defined or linked to!", 0.22, 0.45, 5);
@@ -188,12 +198,15 @@ void load_resources()
    osd_load_resources();
 }
 
-void _draw_background()
+void _draw_background(bool bDrawImage)
 {
-   if ( isMenuOn() )
-      g_pRenderEngine->drawImage(0, 0, 1,1, s_idBgImageMenu);
-   else
-      g_pRenderEngine->drawImage(0, 0, 1,1, s_idBgImage);
+   if ( bDrawImage )
+   {
+      if ( isMenuOn() )
+         g_pRenderEngine->drawImage(0, 0, 1,1, s_idBgImageMenu);
+      else
+         g_pRenderEngine->drawImage(0, 0, 1,1, s_idBgImage);
+   }
 
    double cc[4] = { 80,30,40,1.0 };
 
@@ -647,9 +660,50 @@ void _render_video_background()
    g_pRenderEngine->drawText((1.0-width_text)*0.5, 0.45, g_idFontOSDBig, szText);
 }
 
+// The static layer plane (if any) holds the background image and the video bands, as they change rarely.
+// It is redrawn only when its content changes, and turned off when there is nothing to show on it.
+
+void _render_static_layer(u32 uBgImageId, int iBandHeight, int iBandWidth)
+{
+   if ( (0 == uBgImageId) && (iBandHeight <= 1) && (iBandWidth <= 1) )
+   {
+      g_pRenderEngine->hideStaticLayer();
+      return;
+   }
+
+   u32 uHash = uBgImageId * 2654435761U;
+   uHash ^= ((u32)iBandHeight << 16) ^ (u32)iBandWidth;
+   if ( ! g_pRenderEngine->beginStaticLayer(uHash) )
+      return;
+
+   if ( 0 != uBgImageId )
+      g_pRenderEngine->drawImage(0, 0, 1,1, uBgImageId);
+   else
+   {
+      double c[4] = {0,0,0,1};
+      g_pRenderEngine->setGlobalAlfa(1.0);
+      g_pRenderEngine->setColors(c);
+      if ( iBandHeight > 1 )
+      {
+         float fHBand = (float)iBandHeight/(float)g_pRenderEngine->getScreenHeight() + g_pRenderEngine->getPixelHeight();
+         g_pRenderEngine->drawRect(0, 0, 1.0, fHBand);
+         g_pRenderEngine->drawRect(0, 1.0-fHBand, 1.0, fHBand);
+      }
+      if ( iBandWidth > 1 )
+      {
+         float fWBand = (float)iBandWidth/(float)g_pRenderEngine->getScreenWidth() + g_pRenderEngine->getPixelWidth();
+         g_pRenderEngine->drawRect(0, 0, fWBand, 1.0);
+         g_pRenderEngine->drawRect(1.0-fWBand, 0, fWBand, 1.0);
+      }
+   }
+   g_pRenderEngine->endStaticLayer();
+}
+
 void _render_background_and_paddings(bool bForceBackground)
 { 
    bool showBg = true;
+   bool bUseStaticLayer = g_pRenderEngine->hasStaticLayer();
+   u32 uStaticBgImageId = 0;
 
    if ( ! g_bSearching )
    if ( g_bIsRouterReady )
@@ -675,11 +729,22 @@ void _render_background_and_paddings(bool bForceBackground)
    if ( showBg || bForceBackground || (! link_has_received_videostream(0)) )
    {
       if ( bForceBackground || (! pairing_isStarted()) )
-         _draw_background();
+      {
+         _draw_background(! bUseStaticLayer);
+         uStaticBgImageId = isMenuOn()?s_idBgImageMenu:s_idBgImage;
+      }
       else
          _render_video_background();
    }
 
+   if ( bUseStaticLayer && (0 != uStaticBgImageId) )
+   {
+      _render_static_layer(uStaticBgImageId, 0, 0);
+      return;
+   }
+
+   int iStaticBandHeight = 0;
+   int iStaticBandWidth = 0;
    float fScreenAspect = (float)(g_pRenderEngine->getScreenWidth())/(float)(g_pRenderEngine->getScreenHeight());
    if ( (!g_bSearching) || g_bSearchFoundVehicle )
    if ( (NULL != g_pCurrentModel) && (!bForceBackground) )
@@ -692,45 +757,74 @@ void _render_background_and_paddings(bool bForceBackground)
       if ( fVideoAspect > fScreenAspect+0.01 )
       {
          int h = 1 + 0.5*(g_pRenderEngine->getScreenHeight() - g_pRenderEngine->getScreenWidth()/fVideoAspect);
-         if ( h > 1 )
+         if ( bUseStaticLayer )
+            iStaticBandHeight = h;
+         else if ( h > 1 )
          {
             float fHBand = (float)h/(float)g_pRenderEngine->getScreenHeight();
             fHBand += g_pRenderEngine->getPixelHeight();
-            g_pRenderEngine->drawRect(0, 0, 1.0, fHBand);
-            g_pRenderEngine->drawRect(0,1.0-fHBand, 1.0, fHBand);
+            // Bands do not change while the video resolution is the same, keep them from previous frames
+            if ( g_pRenderEngine->beginCachedRegion(RENDER_REGION_ID_VIDEO_BAND_1, 0, 0, 1.0, fHBand, (u32)h) )
+            {
+               g_pRenderEngine->drawRect(0, 0, 1.0, fHBand);
+               g_pRenderEngine->endCachedRegion();
+            }
+            if ( g_pRenderEngine->beginCachedRegion(RENDER_REGION_ID_VIDEO_BAND_2, 0, 1.0-fHBand, 1.0, fHBand, (u32)h) )
+            {
+               g_pRenderEngine->drawRect(0,1.0-fHBand, 1.0, fHBand);
+               g_pRenderEngine->endCachedRegion();
+            }
          }
       }
       else if ( fVideoAspect < fScreenAspect-0.01 )
       {
          int w = 1 + 0.5*(g_pRenderEngine->getScreenWidth() - g_pRenderEngine->getScreenHeight()*fVideoAspect);
-         if ( w > 1 )
+         if ( bUseStaticLayer )
+            iStaticBandWidth = w;
+         else if ( w > 1 )
          {
             float fWBand = (float)w/(float)g_pRenderEngine->getScreenWidth();
             fWBand += g_pRenderEngine->getPixelWidth();
-            g_pRenderEngine->drawRect(0, 0, fWBand, 1.0);
-            g_pRenderEngine->drawRect(1.0-fWBand, 0, fWBand, 1.0);
+            if ( g_pRenderEngine->beginCachedRegion(RENDER_REGION_ID_VIDEO_BAND_1, 0, 0, fWBand, 1.0, (u32)w) )
+            {
+               g_pRenderEngine->drawRect(0, 0, fWBand, 1.0);
+               g_pRenderEngine->endCachedRegion();
+            }
+            if ( g_pRenderEngine->beginCachedRegion(RENDER_REGION_ID_VIDEO_BAND_2, 1.0-fWBand, 0, fWBand, 1.0, (u32)w) )
+            {
+               g_pRenderEngine->drawRect(1.0-fWBand, 0, fWBand, 1.0);
+               g_pRenderEngine->endCachedRegion();
+            }
          }
       }
    }
+
+   if ( bUseStaticLayer )
+      _render_static_layer(0, iStaticBandHeight, iStaticBandWidth);
 }
 
-void render_all(u32 timeNow, bool bForceBackground, bool bDoInputLoop)
+static void _lock_render_engine()
+{
+   render_engine_lock();
+}
+
+static void _unlock_render_engine()
+{
+   render_engine_unlock();
+}
+
+// Draws the UI into the frame started by the render engine. Reads the UI state.
+static void _render_ui_frame(u32 timeNow, bool bForceBackground)
 {
    ControllerSettings* pCS = get_ControllerSettings();
    Preferences* p = get_Preferences();
 
-   if ( pCS->iFreezeOSD && s_bFreezeOSD )
-      return;
-
-   if ( g_bVideoPlaying )
-   {
-      _render_video_player(timeNow);
-      return;
-   }
+   osd_profiler_set_enabled((NULL != pCS) && (0 != pCS->iDeveloperMode) && (2 == p->iShowCPULoad));
+   osd_profiler_start_frame();
 
-   g_pRenderEngine->startFrame();
-   
+   osd_profiler_begin("background");
    _render_background_and_paddings(bForceBackground);
+   osd_profiler_end();
    
    if ( (!g_bSearching) || g_bSearchFoundVehicle )
    if ( ! bForceBackground )
@@ -742,13 +836,19 @@ void render_all(u32 timeNow, bool bForceBackground, bool bDoInputLoop)
       if ( NULL == g_pPopupLooking )
       {
          u32 t = get_current_timestamp_micros();
+         osd_profiler_begin("osd");
          osd_render_all();
+         osd_profiler_end();
          t = get_current_timestamp_micros() - t;
          if ( t < 300000 )
             s_iMicroTimeOSDRender = s_iMicroTimeOSDRender*0.8 + t*0.2;
       }
       if ( g_bIsRouterReady )
+      {
+         osd_profiler_begin("alarms");
          alarms_render();
+         osd_profiler_end();
+      }
    }
 
    if ( NULL != pCS && (0 != pCS->iDeveloperMode) )
@@ -801,16 +901,26 @@ void render_all(u32 timeNow, bool bForceBackground, bool bDoInputLoop)
    }
 
    u32 t = get_current_timestamp_micros();
+   osd_profiler_begin("popups");
    popups_render();
+   osd_profiler_end();
+   osd_profiler_begin("menus");
    menu_render();
+   osd_profiler_end();
+   osd_profiler_begin("popups topmost");
    popups_render_topmost();
+   osd_profiler_end();
 
    t = get_current_timestamp_micros() - t;
    if ( t < 300000 )
       s_iMicroTimeMenuRender = (s_iMicroTimeMenuRender*8 + t*2)/10;
   
    if ( handle_commands_is_command_in_progress() )
+   {
+      osd_profiler_begin("commands");
       render_commands();
+      osd_profiler_end();
+   }
 
    s_iFPSCount++;
    if ( timeNow >= s_iFPSLastTimeCheck + 1000 )
@@ -825,10 +935,71 @@ void render_all(u32 timeNow, bool bForceBackground, bool bDoInputLoop)
    if ( g_bIsRouterPacketsHistoryGraphOn )
       render_router_pachets_history();
 
+   // The profiler overlay shows the previous frame, so it's not included in the measured times
+   osd_profiler_end_frame();
+   osd_profiler_render();
+
    if ( NULL != p && p->iOSDFlipVertical )
       g_pRenderEngine->rotate180();
+}
+
+void render_all(u32 timeNow, bool bForceBackground, bool bDoInputLoop)
+{
+   ControllerSettings* pCS = get_ControllerSettings();
+
+   if ( pCS->iFreezeOSD && s_bFreezeOSD )
+      return;
+
+   _lock_render_engine();
+   if ( g_bVideoPlaying )
+      _render_video_player(timeNow);
+   else
+   {
+      g_pRenderEngine->startFrame();
+      _render_ui_frame(timeNow, bForceBackground);
+      g_pRenderEngine->endFrame();
+   }
+   s_uRenderedFramesCount++;
+   _unlock_render_engine();
+}
+
+// Renders an UI frame from the render thread. Only drawing the UI needs the UI state lock:
+// waiting for the back buffer, clearing it and queueing the page flip are done outside of it.
+static void _render_thread_frame()
+{
+   ruby_lock_ui_state();
+   ControllerSettings* pCS = get_ControllerSettings();
+   bool bCanRender = (! s_bRenderThreadMustStop) && (! g_bMarkedHDMIReinit) && (! rx_scope_is_started());
+   bool bIsUIFrame = bCanRender && (! g_bVideoPlaying) && (! (pCS->iFreezeOSD && s_bFreezeOSD));
+   // Video player screen: as before, all under the UI lock
+   if ( bCanRender && (! bIsUIFrame) )
+      render_all(get_current_timestamp_ms(), false, false);
+   ruby_unlock_ui_state();
+   if ( ! bIsUIFrame )
+      return;
+
+   _lock_render_engine();
+   g_pRenderEngine->startFrame();
+   u32 uFramesCount = s_uRenderedFramesCount;
+   _unlock_render_engine();
+
+   ruby_lock_ui_state();
+   _lock_render_engine();
+   if ( s_bRenderThreadMustStop || g_bMarkedHDMIReinit || rx_scope_is_started() )
+   {
+      _unlock_render_engine();
+      ruby_unlock_ui_state();
+      return;
+   }
+   // The processing loop rendered a frame meanwhile (synchronous render): start again on the current back buffer
+   if ( uFramesCount != s_uRenderedFramesCount )
+      g_pRenderEngine->startFrame();
+   _render_ui_frame(get_current_timestamp_ms(), false);
+   ruby_unlock_ui_state();
 
    g_pRenderEngine->endFrame();
+   s_uRenderedFramesCount++;
+   _unlock_render_engine();
 }
 
 
@@ -2018,6 +2189,17 @@ void synchronize_shared_mems()
    if ( NULL != g_pSMVoltage )
       memcpy((u8*)&g_SMVoltage, g_pSMVoltage, sizeof(t_shared_mem_i2c_current));
 
+   #if defined (HW_PLATFORM_RADXA_ZERO3)
+   // Created by the video player when it starts
+   static u32 s_uTimeLastTryOpenVideoPlayerStats = 0;
+   if ( (NULL == g_pSM_VideoPlayerStats) && link_has_received_videostream(0) && (g_TimeNow > s_uTimeLastTryOpenVideoPlayerStats + 2000) )
+   {
+      s_uTimeLastTryOpenVideoPlayerStats = g_TimeNow;
+      g_pSM_VideoPlayerStats = shared_mem_video_player_stats_open_for_read();
+   }
+   if ( NULL != g_pSM_VideoPlayerStats )
+      memcpy((u8*)&g_SM_VideoPlayerStats, g_pSM_VideoPlayerStats, sizeof(shared_mem_video_player_stats));
+   #endif
 }
 
 void ruby_processing_loop(bool bNoKeys)
@@ -2025,6 +2207,7 @@ void ruby_processing_loop(bool bNoKeys)
    ControllerSettings* pCS = get_ControllerSettings();
 
    hardware_sleep_ms(20);
+   ruby_lock_ui_state();
    try_read_messages_from_router(7);
    keyboard_consume_input_events();
    u32 uSumEvent = keyboard_get_triggered_input_events();
@@ -2078,16 +2261,108 @@ void ruby_processing_loop(bool bNoKeys)
       link_watch_loop();
       warnings_periodic_loop();
    }
+   ruby_unlock_ui_state();
 }
 
-void main_loop_r_central()
+void ruby_lock_ui_state()
 {
-   ControllerSettings* pCS = get_ControllerSettings();
+   if ( s_bMutexUIStateInitialized )
+      pthread_mutex_lock(&s_MutexUIState);
+}
 
-   hardware_sleep_ms(2);
-   
-   ruby_processing_loop(false);
+void ruby_unlock_ui_state()
+{
+   if ( s_bMutexUIStateInitialized )
+      pthread_mutex_unlock(&s_MutexUIState);
+}
+
+bool ruby_is_render_thread_running()
+{
+   return s_bRenderThreadRunning;
+}
+
+// Renders the UI at the configured FPS, in sync with the display refresh.
+// Only drawing the UI is done while holding the UI state lock; waiting for the display refresh, clearing the
+// back buffer and queueing the page flip are done outside of it, so the processing loop is not blocked by the display.
+
+static void* _thread_render(void *argument)
+{
+   log_line("[RenderThread] Started.");
+   u32 uTimeLastFrameMicros = get_current_timestamp_micros();
+   #if defined (HW_PLATFORM_RADXA_ZERO3)
+   u32 uLastFlipsCount = 0;
+   #endif
+
+   while ( ! s_bRenderThreadMustStop )
+   {
+      u32 uRefreshPeriodMicros = 0;
+      #if defined (HW_PLATFORM_RADXA_ZERO3)
+      // Last frame must be on screen before drawing into the other buffer.
+      // Frames are timed from the moment the last one was shown (the vblank)
+      ruby_drm_core_wait_for_flip_done(100);
+      if ( ruby_drm_get_main_display_info()->iRefreshRate > 0 )
+         uRefreshPeriodMicros = 1000000/ruby_drm_get_main_display_info()->iRefreshRate;
+      if ( uLastFlipsCount != ruby_drm_core_get_flips_count() )
+      {
+         uLastFlipsCount = ruby_drm_core_get_flips_count();
+         uTimeLastFrameMicros = ruby_drm_core_get_last_flip_done_time_micros();
+      }
+      #endif
+
+      ControllerSettings* pCS = get_ControllerSettings();
+      u32 uFrameMicros = 1000000/15;
+      if ( 0 != pCS->iRenderFPS )
+         uFrameMicros = 1000000/pCS->iRenderFPS;
+
+      // Start drawing one display refresh before the target time, so the new frame is shown at the vblank closest to it
+      u32 uWaitMicros = uFrameMicros;
+      if ( uRefreshPeriodMicros < uFrameMicros )
+         uWaitMicros = uFrameMicros - uRefreshPeriodMicros;
+      u32 uElapsedMicros = get_current_timestamp_micros() - uTimeLastFrameMicros;
+      if ( uElapsedMicros < uWaitMicros )
+      {
+         u32 uSleepMicros = uWaitMicros - uElapsedMicros;
+         if ( uSleepMicros > 5000 )
+            uSleepMicros = 5000;
+         hardware_sleep_micros(uSleepMicros);
+         continue;
+      }
+
+      uTimeLastFrameMicros = get_current_timestamp_micros();
+
+      _render_thread_frame();
+   }
+   log_line("[RenderThread] Stopped.");
+   return NULL;
+}
+
+static void _start_render_thread()
+{
+   if ( s_bRenderThreadRunning || (! s_bMutexUIStateInitialized) || (! render_engine_has_lock()) )
+      return;
+   s_bRenderThreadMustStop = false;
+   s_bRenderThreadRunning = true;
+   if ( 0 != pthread_create(&s_pThreadRender, NULL, &_thread_render, NULL) )
+   {
+      log_softerror_and_alarm("Failed to create render thread. Rendering from the main loop.");
+      s_bRenderThreadRunning = false;
+      return;
+   }
+   log_line("Created render thread.");
+}
+
+static void _stop_render_thread()
+{
+   if ( ! s_bRenderThreadRunning )
+      return;
+   s_bRenderThreadMustStop = true;
+   pthread_join(s_pThreadRender, NULL);
+   s_bRenderThreadRunning = false;
+   log_line("Render thread was stopped.");
+}
 
+static void _main_loop_r_central_steps(ControllerSettings* pCS)
+{
    if ( s_StartSequence != START_SEQ_COMPLETED && s_StartSequence != START_SEQ_FAILED )
    {
       hardware_sleep_ms(5);
@@ -2103,6 +2378,15 @@ void main_loop_r_central()
 
    if ( g_bMarkedHDMIReinit )
    {
+      // The render thread uses the render engine and the display buffers without the UI lock:
+      // stop it while they are recreated. It waits for the UI lock, so release it meanwhile.
+      // The main loop starts the render thread again.
+      if ( s_bRenderThreadRunning )
+      {
+         ruby_unlock_ui_state();
+         _stop_render_thread();
+         ruby_lock_ui_state();
+      }
       g_bMarkedHDMIReinit = false;
       menu_discard_all();
       ruby_reinit_hdmi_display();
@@ -2110,6 +2394,9 @@ void main_loop_r_central()
 
    compute_cpu_load(g_TimeNow);
 
+   if ( ! s_bRenderThreadRunning )
+      _start_render_thread();
+
    int dt = 1000/15;
    if ( 0 != pCS->iRenderFPS )
       dt = 1000/pCS->iRenderFPS;
@@ -2117,7 +2404,8 @@ void main_loop_r_central()
    {
       ruby_signal_alive();
       s_TimeLastRender = g_TimeNow;
-      render_all(g_TimeNow, false, false);
+      if ( ! s_bRenderThreadRunning )
+         render_all(g_TimeNow, false, false);
       if ( NULL != s_pProcessStatsCentral )
          s_pProcessStatsCentral->lastActiveTime = g_TimeNow;
 
@@ -2165,6 +2453,19 @@ void main_loop_r_central()
    }
 }
 
+void main_loop_r_central()
+{
+   ControllerSettings* pCS = get_ControllerSettings();
+
+   hardware_sleep_ms(2);
+   
+   ruby_processing_loop(false);
+
+   ruby_lock_ui_state();
+   _main_loop_r_central_steps(pCS);
+   ruby_unlock_ui_state();
+}
+
 void ruby_signal_alive()
 {
    if ( NULL != s_pProcessStatsCentral )
@@ -2219,6 +2520,8 @@ void handle_sigint(int sig)
    g_bQuit = true;
 } 
 
+// bench_render (r_tests) links the UI code without this main and drives render_all() itself
+#ifndef RUBY_BENCH_RENDER
 int main(int argc, char *argv[])
 {
    signal(SIGPIPE, SIG_IGN);
@@ -2316,6 +2619,10 @@ int main(int argc, char *argv[])
    if ( ! load_ControllerSettings() )
       save_ControllerSettings();
 
+   // ruby_central is the only process that changes the settings at runtime: the other processes load them from shared memory
+   publish_Preferences();
+   publish_ControllerSettings();
+
    hardware_i2c_load_device_settings();
 
    if ( ! load_ControllerInterfacesSettings() )
@@ -2339,8 +2646,10 @@ int main(int argc, char *argv[])
    if ( iHDMIIndex < 0 )
       iHDMIIndex = hdmi_get_best_resolution_index_for(1920, 1080, 60);
    log_line("HDMI mode to use: %d", iHDMIIndex);
+   ruby_drm_core_set_triple_buffering(get_ControllerSettings()->iDisplayTripleBuffering);
    ruby_drm_core_init(0, DRM_FORMAT_ARGB8888, hdmi_get_current_resolution_width(), hdmi_get_current_resolution_height(), hdmi_get_current_resolution_refresh());
    ruby_drm_core_set_plane_properties_and_buffer(ruby_drm_core_get_main_draw_buffer_id());
+   ruby_drm_core_setup_static_layer_plane();
    #endif
 
    Menu::setRenderMode(p->iMenuStyle);
@@ -2401,6 +2710,17 @@ int main(int argc, char *argv[])
    memset(&g_VideoInfoStatsFromVehicleCameraOut, 0, sizeof(shared_mem_video_info_stats));
    memset(&g_VideoInfoStatsFromVehicleRadioOut, 0, sizeof(shared_mem_video_info_stats));
 
+   pthread_mutexattr_t attrUIState;
+   pthread_mutexattr_init(&attrUIState);
+   pthread_mutexattr_settype(&attrUIState, PTHREAD_MUTEX_RECURSIVE);
+   if ( 0 == pthread_mutex_init(&s_MutexUIState, &attrUIState) )
+      s_bMutexUIStateInitialized = true;
+   else
+      log_softerror_and_alarm("Failed to create UI state mutex. Rendering from the main loop.");
+   pthread_mutexattr_destroy(&attrUIState);
+
+   render_engine_init_lock();
+
    s_StartSequence = START_SEQ_PRE_LOAD_CONFIG;
    log_line("Started main loop.");
    g_TimeStart = get_current_timestamp_ms();
@@ -2414,8 +2734,10 @@ int main(int argc, char *argv[])
 
       if ( rx_scope_is_started() )
       {
+         ruby_lock_ui_state();
          try_read_messages_from_router(10);
          rx_scope_loop();
+         ruby_unlock_ui_state();
       }
       else
       {
@@ -2427,6 +2749,8 @@ int main(int argc, char *argv[])
             log_softerror_and_alarm("Main processing loop took too long (%u ms).", dTime);
       }
    }
+
+   _stop_render_thread();
    
    keyboard_uninit();
    
@@ -2458,6 +2782,7 @@ int main(int argc, char *argv[])
 
    return 0;
 }
+#endif
 
 
 void ruby_set_active_model_id(u32 uVehicleId)
@@ -2493,6 +2818,8 @@ void ruby_reinit_hdmi_display()
 
    pairing_stop();
 
+   // Other threads (OSD plugins) use the render engine under its lock
+   _lock_render_engine();
    free_all_fonts();
    render_free_engine();
    
@@ -2505,11 +2832,14 @@ void ruby_reinit_hdmi_display()
    if ( iHDMIIndex < 0 )
       iHDMIIndex = hdmi_get_best_resolution_index_for(1920, 1080, 60);
    log_line("HDMI mode to use: %d", iHDMIIndex);
+   ruby_drm_core_set_triple_buffering(get_ControllerSettings()->iDisplayTripleBuffering);
    ruby_drm_core_init(0, DRM_FORMAT_ARGB8888, hdmi_get_current_resolution_width(), hdmi_get_current_resolution_height(), hdmi_get_current_resolution_refresh());
    ruby_drm_core_set_plane_properties_and_buffer(ruby_drm_core_get_main_draw_buffer_id());
+   ruby_drm_core_setup_static_layer_plane();
    #endif
 
    g_pRenderEngine = render_init_engine();
+   _unlock_render_engine();
    log_line("Render Engine was initialized.");
    
    load_resources();
@@ -33,6 +33,12 @@ Popup* ruby_get_startup_popup();
 void ruby_processing_loop(bool bNoKeys);
 
 void render_all(u32 timeNow, bool bForceBackground = false, bool bDoInputLoop = false);
+
+// UI state (menus, popups, models, stats copies) is changed by the processing loop and read by the render thread.
+// Both hold this (recursive) lock while using it, so the render thread always draws a consistent state.
+void ruby_lock_ui_state();
+void ruby_unlock_ui_state();
+bool ruby_is_render_thread_running();
 int ruby_start_recording();
 int ruby_stop_recording();
 
@@ -64,6 +64,9 @@ shared_mem_radio_stats_rx_hist g_SM_HistoryRxStatsVehicle;
 shared_mem_audio_decode_stats* g_pSM_AudioDecodeStats = NULL;
 shared_mem_audio_decode_stats g_SM_AudioDecodeStats;
 
+shared_mem_video_player_stats* g_pSM_VideoPlayerStats = NULL;
+shared_mem_video_player_stats g_SM_VideoPlayerStats;
+
 shared_mem_video_info_stats* g_pSM_VideoInfoStatsOutput = NULL;
 shared_mem_video_info_stats g_SM_VideoInfoStatsOutput;
 
@@ -39,6 +39,9 @@ extern shared_mem_radio_stats_rx_hist g_SM_HistoryRxStatsVehicle;
 extern shared_mem_audio_decode_stats* g_pSM_AudioDecodeStats;
 extern shared_mem_audio_decode_stats g_SM_AudioDecodeStats;
 
+extern shared_mem_video_player_stats* g_pSM_VideoPlayerStats;
+extern shared_mem_video_player_stats g_SM_VideoPlayerStats;
+
 extern shared_mem_video_info_stats* g_pSM_VideoInfoStatsOutput;
 extern shared_mem_video_info_stats g_SM_VideoInfoStatsOutput;
 
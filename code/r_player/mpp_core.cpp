@@ -34,6 +34,7 @@
 #define READ_VIDEO_BUF_SIZE (1024*1024) // SZ_1M https://github.com/rockchip-linux/mpp/blob/ed377c99a733e2cdbcc457a6aa3f0fcd438a9dff/osal/inc/mpp_common.h#L179
 #define MAX_VIDEO_FRAMES 24  // min 16 and 20+ recommended (mpp/readme.txt)
 #define CODEC_ALIGN(x, a)   (((x)+(a)-1)&~((a)-1))
+#define MAX_DISPLAY_QUEUE_FRAMES 6
 
 typedef struct
 {
@@ -41,6 +42,16 @@ typedef struct
    type_drm_buffer drmBufferInfo;
 } type_mpp_frame_info;
 
+// Decoded frames waiting to be displayed. The MPP buffer is referenced until the frame is off screen,
+// so the decoder does not reuse it while it's scanned out (frames are displayed directly from the decoder buffers)
+typedef struct
+{
+   int iFrameIndex;
+   MppBuffer pBuffer;
+   u32 uTimeFedMicros; // Frame timestamp: time the video data was fed to the decoder
+   u32 uTimeDecodedMicros;
+} type_mpp_display_frame;
+
 MppCtx g_MPPCtx;
 MppApi* g_pMPPApi = NULL;
 MppBufferGroup g_MPPBufferGroup = NULL;
@@ -58,8 +69,24 @@ bool g_bMPPStreamChangedFlag = false;
 pthread_t g_MPPDecodeThread;
 pthread_t g_MPPUpdateDisplayThread;
 extern bool g_bQuit;
-int g_iMPPFrameBufferIndexToDisplay = -1;
-uint32_t g_uMPPDRMBufferIdToDisplay = 0;
+
+pthread_mutex_t g_MutexMPPDisplayQueue = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_CondMPPDisplayQueue = PTHREAD_COND_INITIALIZER;
+type_mpp_display_frame g_MPPDisplayQueue[MAX_DISPLAY_QUEUE_FRAMES];
+int g_iMPPDisplayQueueStart = 0;
+int g_iMPPDisplayQueueCount = 0;
+bool g_bMPPLowestLatencyMode = false;
+// Set by the decode thread while the frames buffers are reinitialized (resolution change). The display thread
+// gives back the frame on screen, confirms with g_bMPPDisplayPaused and does not use g_Frames until the request is cleared.
+bool g_bMPPDisplayPauseRequested = false;
+bool g_bMPPDisplayPaused = false;
+pthread_cond_t g_CondMPPDisplayPaused = PTHREAD_COND_INITIALIZER;
+
+// Stats for the current interval, protected by the display queue mutex
+u32 g_uMPPStatsFramesDecoded = 0;
+u32 g_uMPPStatsFramesDropped = 0;
+u32 g_uMPPStatsDecodeTimeSumMicros = 0;
+shared_mem_video_player_stats* g_pSMVideoPlayerStats = NULL;
 
 int _mpp_send_command(MpiCmd command, RK_U32 value)
 {
@@ -83,7 +110,8 @@ int mpp_feed_data_to_decoder(void* pData, int iLength)
     struct timespec spec;
     clock_gettime(1, &spec);
     uint64_t tTime = spec.tv_sec * 1000 + spec.tv_nsec / 1e6;
-    mpp_packet_set_pts(g_MPPInputPacket,(RK_S64) tTime);
+    // Used as the frames timestamps for display pacing and frame age stats
+    mpp_packet_set_pts(g_MPPInputPacket,(RK_S64) get_current_timestamp_micros());
 
     int iStallCount = 0;
     int iElapsed = 0;
@@ -216,25 +244,251 @@ void _mpp_core_periodic_checks()
    //ruby_drm_set_object_property(pPlaneInfo, "CRTC_X", uCrtX);
 }
 
+void mpp_set_lowest_latency_mode(bool bEnable)
+{
+   g_bMPPLowestLatencyMode = bEnable;
+   log_line("[MPP] Display mode: %s", bEnable?"lowest latency (newest frame at next vblank)":"paced on frames timestamps");
+}
+
+void _mpp_display_queue_push(int iFrameIndex, MppBuffer pBuffer, u32 uTimeFedMicros)
+{
+   mpp_buffer_inc_ref(pBuffer);
+   if ( 0 == uTimeFedMicros )
+      uTimeFedMicros = get_current_timestamp_micros();
+
+   pthread_mutex_lock(&g_MutexMPPDisplayQueue);
+   if ( g_iMPPDisplayQueueCount >= MAX_DISPLAY_QUEUE_FRAMES )
+   {
+      mpp_buffer_put(g_MPPDisplayQueue[g_iMPPDisplayQueueStart].pBuffer);
+      g_iMPPDisplayQueueStart = (g_iMPPDisplayQueueStart + 1) % MAX_DISPLAY_QUEUE_FRAMES;
+      g_iMPPDisplayQueueCount--;
+      g_uMPPStatsFramesDropped++;
+   }
+   type_mpp_display_frame* pFrame = &g_MPPDisplayQueue[(g_iMPPDisplayQueueStart + g_iMPPDisplayQueueCount) % MAX_DISPLAY_QUEUE_FRAMES];
+   pFrame->iFrameIndex = iFrameIndex;
+   pFrame->pBuffer = pBuffer;
+   pFrame->uTimeFedMicros = uTimeFedMicros;
+   pFrame->uTimeDecodedMicros = get_current_timestamp_micros();
+   g_iMPPDisplayQueueCount++;
+   g_uMPPStatsFramesDecoded++;
+   g_uMPPStatsDecodeTimeSumMicros += pFrame->uTimeDecodedMicros - uTimeFedMicros;
+   pthread_cond_signal(&g_CondMPPDisplayQueue);
+   pthread_mutex_unlock(&g_MutexMPPDisplayQueue);
+}
+
+void _mpp_display_queue_flush_locked()
+{
+   while ( g_iMPPDisplayQueueCount > 0 )
+   {
+      mpp_buffer_put(g_MPPDisplayQueue[g_iMPPDisplayQueueStart].pBuffer);
+      g_iMPPDisplayQueueStart = (g_iMPPDisplayQueueStart + 1) % MAX_DISPLAY_QUEUE_FRAMES;
+      g_iMPPDisplayQueueCount--;
+   }
+}
+
+static void _mpp_get_timeout_ms(struct timespec* pTime, int iMs)
+{
+   clock_gettime(CLOCK_REALTIME, pTime);
+   pTime->tv_nsec += iMs*1000*1000;
+   if ( pTime->tv_nsec >= 1000*1000*1000 )
+   {
+      pTime->tv_sec++;
+      pTime->tv_nsec -= 1000*1000*1000;
+   }
+}
+
+// Called from the decode thread before the frames buffers are reinitialized: drops the queued frames and
+// waits for the display thread to give back the frame it has on screen (or in flight)
+void _mpp_display_pause()
+{
+   pthread_mutex_lock(&g_MutexMPPDisplayQueue);
+   g_bMPPDisplayPauseRequested = true;
+   _mpp_display_queue_flush_locked();
+   pthread_cond_signal(&g_CondMPPDisplayQueue);
+   u32 uTimeStart = get_current_timestamp_ms();
+   while ( (! g_bMPPDisplayPaused) && (! g_bQuit) )
+   {
+      if ( get_current_timestamp_ms() > uTimeStart + 500 )
+      {
+         log_softerror_and_alarm("[MPP] Display thread did not pause for frames reinit.");
+         break;
+      }
+      struct timespec ts;
+      _mpp_get_timeout_ms(&ts, 10);
+      pthread_cond_timedwait(&g_CondMPPDisplayPaused, &g_MutexMPPDisplayQueue, &ts);
+   }
+   pthread_mutex_unlock(&g_MutexMPPDisplayQueue);
+}
+
+void _mpp_display_resume()
+{
+   pthread_mutex_lock(&g_MutexMPPDisplayQueue);
+   g_bMPPDisplayPauseRequested = false;
+   pthread_cond_signal(&g_CondMPPDisplayQueue);
+   pthread_mutex_unlock(&g_MutexMPPDisplayQueue);
+}
+
+// Lowest latency mode: shows the newest decoded frame at the next vblank, older frames are dropped.
+// Paced mode: each frame is shown at its timestamp plus a playout delay that follows the decode time,
+// so that frames are shown at the same intervals they were received at (no judder from decode time variations).
+
 void* _mpp_thread_update_display(void *param)
 {
    log_line("[MPPThreadUpdateDisplay] Started.");
-   u32 uLastDRMBufferIdDisplayed = 0;
+   hw_increase_current_thread_priority("MPPUpdateDisplay", 40);
+
+   type_mpp_display_frame frameOnScreen;
+   frameOnScreen.pBuffer = NULL;
+   bool bHasFrameOnScreen = false;
+   u32 uTimeFlipFrameOnScreen = 0;
+   u32 uPlayoutDelayMicros = 0;
+
+   u32 uTimeLastStatsUpdate = get_current_timestamp_ms();
+   u32 uStatsFramesDisplayed = 0;
+   u32 uStatsAgeMin = MAX_U32;
+   u32 uStatsAgeMax = 0;
+   u32 uStatsAgeSum = 0;
+   u32 uStatsMaxIntervalError = 0;
+   u32 uStatsTotalDisplayed = 0;
+   u32 uStatsTotalDropped = 0;
 
    while ( (!g_bMPPFrameEOS) && (!g_bQuit) )
    {
-      if ( uLastDRMBufferIdDisplayed == g_uMPPDRMBufferIdToDisplay )
+      u32 uTimeNowMs = get_current_timestamp_ms();
+      if ( uTimeNowMs >= uTimeLastStatsUpdate + 1000 )
       {
-         hardware_sleep_ms(1);
+         uTimeLastStatsUpdate = uTimeNowMs;
+         pthread_mutex_lock(&g_MutexMPPDisplayQueue);
+         u32 uDecoded = g_uMPPStatsFramesDecoded;
+         u32 uDropped = g_uMPPStatsFramesDropped;
+         u32 uDecodeTimeSum = g_uMPPStatsDecodeTimeSumMicros;
+         g_uMPPStatsFramesDecoded = 0;
+         g_uMPPStatsFramesDropped = 0;
+         g_uMPPStatsDecodeTimeSumMicros = 0;
+         pthread_mutex_unlock(&g_MutexMPPDisplayQueue);
+
+         uStatsTotalDisplayed += uStatsFramesDisplayed;
+         uStatsTotalDropped += uDropped;
+         if ( NULL != g_pSMVideoPlayerStats )
+         {
+            g_pSMVideoPlayerStats->uLowestLatencyMode = g_bMPPLowestLatencyMode?1:0;
+            g_pSMVideoPlayerStats->uFramesDecoded = uDecoded;
+            g_pSMVideoPlayerStats->uFramesDisplayed = uStatsFramesDisplayed;
+            g_pSMVideoPlayerStats->uFramesDropped = uDropped;
+            g_pSMVideoPlayerStats->uFrameAgeMinMicros = (uStatsFramesDisplayed > 0)?uStatsAgeMin:0;
+            g_pSMVideoPlayerStats->uFrameAgeAvgMicros = (uStatsFramesDisplayed > 0)?(uStatsAgeSum/uStatsFramesDisplayed):0;
+            g_pSMVideoPlayerStats->uFrameAgeMaxMicros = uStatsAgeMax;
+            g_pSMVideoPlayerStats->uDecodeTimeAvgMicros = (uDecoded > 0)?(uDecodeTimeSum/uDecoded):0;
+            g_pSMVideoPlayerStats->uPlayoutDelayMicros = g_bMPPLowestLatencyMode?0:uPlayoutDelayMicros;
+            g_pSMVideoPlayerStats->uMaxDisplayIntervalErrorMicros = uStatsMaxIntervalError;
+            g_pSMVideoPlayerStats->uTotalFramesDisplayed = uStatsTotalDisplayed;
+            g_pSMVideoPlayerStats->uTotalFramesDropped = uStatsTotalDropped;
+            g_pSMVideoPlayerStats->uTimeLastUpdate = uTimeNowMs;
+         }
+         uStatsFramesDisplayed = 0;
+         uStatsAgeMin = MAX_U32;
+         uStatsAgeMax = 0;
+         uStatsAgeSum = 0;
+         uStatsMaxIntervalError = 0;
+      }
+
+      type_mpp_display_frame frame;
+      bool bGotFrame = false;
+      int iWaitMicros = 0;
+
+      pthread_mutex_lock(&g_MutexMPPDisplayQueue);
+      // Frames buffers are reinitialized: give back the frame on screen and wait for the new buffers
+      if ( g_bMPPDisplayPauseRequested )
+      {
+         if ( bHasFrameOnScreen )
+            mpp_buffer_put(frameOnScreen.pBuffer);
+         bHasFrameOnScreen = false;
+         g_bMPPDisplayPaused = true;
+         pthread_cond_signal(&g_CondMPPDisplayPaused);
+         while ( g_bMPPDisplayPauseRequested && (!g_bMPPFrameEOS) && (!g_bQuit) )
+         {
+            struct timespec ts;
+            _mpp_get_timeout_ms(&ts, 10);
+            pthread_cond_timedwait(&g_CondMPPDisplayQueue, &g_MutexMPPDisplayQueue, &ts);
+         }
+         g_bMPPDisplayPaused = false;
+      }
+      if ( 0 == g_iMPPDisplayQueueCount )
+      {
+         struct timespec ts;
+         _mpp_get_timeout_ms(&ts, 10);
+         pthread_cond_timedwait(&g_CondMPPDisplayQueue, &g_MutexMPPDisplayQueue, &ts);
+      }
+      if ( g_iMPPDisplayQueueCount > 0 )
+      {
+         u32 uTimeNow = get_current_timestamp_micros();
+         // Drop the frames that are replaced by a newer frame that is due too
+         while ( g_iMPPDisplayQueueCount > 1 )
+         {
+            type_mpp_display_frame* pNext = &g_MPPDisplayQueue[(g_iMPPDisplayQueueStart + 1) % MAX_DISPLAY_QUEUE_FRAMES];
+            if ( ! g_bMPPLowestLatencyMode )
+            if ( (int)(uTimeNow - (pNext->uTimeFedMicros + uPlayoutDelayMicros)) < 0 )
+               break;
+            mpp_buffer_put(g_MPPDisplayQueue[g_iMPPDisplayQueueStart].pBuffer);
+            g_iMPPDisplayQueueStart = (g_iMPPDisplayQueueStart + 1) % MAX_DISPLAY_QUEUE_FRAMES;
+            g_iMPPDisplayQueueCount--;
+            g_uMPPStatsFramesDropped++;
+         }
+         type_mpp_display_frame* pHead = &g_MPPDisplayQueue[g_iMPPDisplayQueueStart];
+         iWaitMicros = (int)((pHead->uTimeFedMicros + uPlayoutDelayMicros) - uTimeNow);
+         if ( g_bMPPLowestLatencyMode || (iWaitMicros <= 0) )
+         {
+            frame = *pHead;
+            g_iMPPDisplayQueueStart = (g_iMPPDisplayQueueStart + 1) % MAX_DISPLAY_QUEUE_FRAMES;
+            g_iMPPDisplayQueueCount--;
+            bGotFrame = true;
+         }
+      }
+      pthread_mutex_unlock(&g_MutexMPPDisplayQueue);
+
+      if ( ! bGotFrame )
+      {
+         if ( iWaitMicros > 0 )
+            hardware_sleep_micros((iWaitMicros < 2000)?iWaitMicros:2000);
          continue;
       }
 
-      ruby_drm_core_set_plane_buffer(g_uMPPDRMBufferIdToDisplay);
-      uLastDRMBufferIdDisplayed = g_uMPPDRMBufferIdToDisplay;
-      
-      //log_line("Disp buff index %d, id %u", g_iMPPFrameBufferIndexToDisplay, g_uMPPDRMBufferIdToDisplay);
+      // Playout delay follows the highest recent decode time, and decreases slowly
+      u32 uDecodeTime = frame.uTimeDecodedMicros - frame.uTimeFedMicros;
+      if ( uDecodeTime > uPlayoutDelayMicros )
+         uPlayoutDelayMicros = uDecodeTime;
+      else
+         uPlayoutDelayMicros -= (uPlayoutDelayMicros - uDecodeTime)/64;
+
+      ruby_drm_core_set_plane_buffer(g_Frames[frame.iFrameIndex].drmBufferInfo.uBufferId);
+      ruby_drm_core_wait_for_flip_done(50);
+      u32 uTimeFlip = ruby_drm_core_get_last_flip_done_time_micros();
 
+      // Previous frame is off screen now, the decoder can reuse its buffer
+      if ( bHasFrameOnScreen )
+      {
+         mpp_buffer_put(frameOnScreen.pBuffer);
+         u32 uIntervalFrames = frame.uTimeFedMicros - frameOnScreen.uTimeFedMicros;
+         u32 uIntervalDisplay = uTimeFlip - uTimeFlipFrameOnScreen;
+         u32 uError = (uIntervalDisplay > uIntervalFrames)?(uIntervalDisplay - uIntervalFrames):(uIntervalFrames - uIntervalDisplay);
+         if ( uError > uStatsMaxIntervalError )
+            uStatsMaxIntervalError = uError;
+      }
+      frameOnScreen = frame;
+      bHasFrameOnScreen = true;
+      uTimeFlipFrameOnScreen = uTimeFlip;
+
+      u32 uAge = uTimeFlip - frame.uTimeFedMicros;
+      uStatsFramesDisplayed++;
+      uStatsAgeSum += uAge;
+      if ( uAge < uStatsAgeMin )
+         uStatsAgeMin = uAge;
+      if ( uAge > uStatsAgeMax )
+         uStatsAgeMax = uAge;
    }
+
+   if ( bHasFrameOnScreen )
+      mpp_buffer_put(frameOnScreen.pBuffer);
    log_line("[MPPThreadUpdateDisplay] Finsihed.");
    return NULL;
 }
@@ -261,7 +515,9 @@ void* _mpp_thread_frame_decode(void *param)
       if ( mpp_frame_get_info_change(pFrame) )
       {
          log_line("[MPPThreadDecoder] Received new frame resolution update.");
+         _mpp_display_pause();
          _mpp_init_frames(pFrame);
+         _mpp_display_resume();
          g_bMPPStreamChangedFlag = true;
          g_bMPPFrameEOS = (mpp_frame_get_eos(pFrame))?true:false;
          mpp_frame_deinit(&pFrame);
@@ -305,9 +561,8 @@ void* _mpp_thread_frame_decode(void *param)
          //log_line("[MPPThreadDecoder] Received a frame in primeId buffer index %d (max %d)", iPrimeIndex, MAX_VIDEO_FRAMES);
          //s_iLastPrimeBufferIndex = iPrimeIndex;
          
-         //ruby_drm_core_set_plane_buffer(g_Frames[iPrimeIndex].drmBufferInfo.uBufferId);
-         g_iMPPFrameBufferIndexToDisplay = iPrimeIndex;
-         g_uMPPDRMBufferIdToDisplay = g_Frames[iPrimeIndex].drmBufferInfo.uBufferId;
+         if ( -1 != iPrimeIndex )
+            _mpp_display_queue_push(iPrimeIndex, pBuffer, (u32)mpp_frame_get_pts(pFrame));
          u32 uTimeNow = get_current_timestamp_ms();
          if ( uTimeNow > g_uTimeMPPPeriodicChecks + 1000 )
          {
@@ -354,6 +609,10 @@ int mpp_init(bool bUseH265Decoder)
    log_line("[MPP] Done check for codec %s. Success.", (bUseH265Decoder?"H265":"H264"));
 
    g_bMPPStreamChangedFlag = false;
+   g_iMPPDisplayQueueStart = 0;
+   g_iMPPDisplayQueueCount = 0;
+   if ( NULL == g_pSMVideoPlayerStats )
+      g_pSMVideoPlayerStats = shared_mem_video_player_stats_open_for_write();
    g_pInputBuffer = (uint8_t*)malloc(READ_VIDEO_BUF_SIZE);
    if ( NULL == g_pInputBuffer )
    {
@@ -423,6 +682,9 @@ int mpp_uninit()
 {
    log_line("[MPP] Doing MPP Un-initialization...");
   
+   pthread_mutex_lock(&g_MutexMPPDisplayQueue);
+   _mpp_display_queue_flush_locked();
+   pthread_mutex_unlock(&g_MutexMPPDisplayQueue);
    g_pMPPApi->reset(g_MPPCtx);
    if ( g_MPPBufferGroup )
    {
@@ -446,6 +708,8 @@ int mpp_uninit()
 
    g_bMPPFramesBuffersInitialised = false;
    g_uTimeFirstFrame = 0;
+   shared_mem_video_player_stats_close(g_pSMVideoPlayerStats);
+   g_pSMVideoPlayerStats = NULL;
    log_line("[MPP] Done MPP Un-initialization.");
    return 0;
 }
@@ -4,6 +4,7 @@
 #include "../base/config.h"
 #include "../base/hardware.h"
 #include "../base/hw_procs.h"
+#include "../base/shared_mem.h"
 #include "../renderer/drm_core.h"
 #include <ctype.h>
 #include <pthread.h>
@@ -16,6 +17,8 @@
 int mpp_init(bool bUseH265Decoder);
 int mpp_uninit();
 int mpp_start_decoding_thread();
+// Lowest latency: newest decoded frame is shown at the next vblank. Otherwise frames are paced on their timestamps.
+void mpp_set_lowest_latency_mode(bool bEnable);
 int mpp_feed_data_to_decoder(void* pData, int iLength);
 int mpp_mark_end_of_stream();
 bool mpp_get_clear_stream_changed_flag();
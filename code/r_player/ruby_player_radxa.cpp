@@ -590,6 +590,7 @@ int main(int argc, char *argv[])
       printf("-p Play the live video stream from pipe\n");
       printf("-u Play the live video stream from UDP socket\n");
       printf("-h265 use H265 decoder\n");
+      printf("-lowlat show the newest decoded frame at next vblank, instead of pacing frames on their timestamps\n");
       printf("-f [filename] Play H264 file\n");
       printf("-m [wxh@r] Sets a custom video mode\n");
       printf("-i init UI layer too when playing stream or files\n");
@@ -612,6 +613,8 @@ int main(int argc, char *argv[])
          g_bInitUILayerToo = true;
       if ( 0 == strcmp(argv[iParam], "-h265") )
          g_bUseH265Decoder = true;
+      if ( 0 == strcmp(argv[iParam], "-lowlat") )
+         mpp_set_lowest_latency_mode(true);
       if ( 0 == strcmp(argv[iParam], "-d") )
       {
          g_bDebug = true;
@@ -52,6 +52,7 @@
 #include "../base/shared_mem.h"
 #include "../base/encr.h"
 #include "../base/models.h"
+#include "../base/models_shared_mem.h"
 #include "../base/hardware.h"
 #include "../base/hw_procs.h"
 #include "../base/utils.h"
@@ -577,6 +578,8 @@ int r_start_vehicle(int argc, char *argv[])
       strcat(szFile, FILE_CONFIG_CURRENT_VEHICLE_MODEL);
       modelVehicle.saveToFile(szFile, false);
    }
+   // The vehicle processes update their model from the published model on model changed notifications
+   models_shared_mem_publish(&modelVehicle);
 
    for( int i=0; i<modelVehicle.hardwareInterfacesInfo.serial_bus_count; i++ )
    {
@@ -554,6 +554,19 @@ int send_packet_to_radio_interfaces(u8* pPacketData, int nPacketLength, int iSen
       if ( s_bReceivedInvalidRadioPackets )
          pPH->vehicle_id_src = 0;
 
+      // Time the RC frame spent in the router, before the CRC is computed
+      if ( (pPH->packet_flags & PACKET_FLAGS_MASK_MODULE) == PACKET_COMPONENT_RC )
+      if ( pPH->packet_type == PACKET_TYPE_RC_FULL_FRAME )
+      if ( pPH->total_length >= sizeof(t_packet_header) + sizeof(t_packet_header_rc_full_frame_upstream) )
+      {
+         t_packet_header_rc_full_frame_upstream* pRCFrame = (t_packet_header_rc_full_frame_upstream*)(pData + sizeof(t_packet_header));
+         u32 uTimeNowMs = get_current_timestamp_ms();
+         u32 uDelay = 0;
+         if ( (0 != pRCFrame->uTimeSentMs) && (uTimeNowMs >= pRCFrame->uTimeSentMs) )
+            uDelay = uTimeNowMs - pRCFrame->uTimeSentMs;
+         pRCFrame->uRouterDelayMs = (u8)((uDelay > 255)?255:uDelay);
+      }
+
       nLength -= pPH->total_length;
       pData += pPH->total_length;
    }
@@ -42,6 +42,7 @@
 #include "../base/commands.h"
 #include "../base/ruby_ipc.h"
 #include "../base/parser_h264.h"
+#include "../base/parser_h265.h"
 #include "../base/camera_utils.h"
 #include "../common/string_utils.h"
 #include "../common/radio_stats.h"
@@ -50,6 +51,7 @@
 #include "../radio/radiolink.h"
 #include "../radio/radio_duplicate_det.h"
 #include "../radio/radio_tx.h"
+#include "../radio/radiopackets_telemetry_delta.h"
 #include "ruby_rt_station.h"
 #include "relay_rx.h"
 #include "links_utils.h"
@@ -68,6 +70,7 @@ u32 s_TimeLastLoggedSearchingRubyTelemetry = 0;
 u32 s_TimeLastLoggedSearchingRubyTelemetryVehicleId = 0;
 
 ParserH264 s_ParserH264RadioInput;
+ParserH265 s_ParserH265RadioInput;
 
 #define MAX_ALARMS_HISTORY 50
 
@@ -80,6 +83,7 @@ void init_radio_rx_structures()
       s_uLastReceivedAlarmsIndexes[i] = MAX_U32;
 
    s_ParserH264RadioInput.init(camera_get_active_camera_h264_slices(g_pCurrentModel));
+   s_ParserH265RadioInput.init(camera_get_active_camera_h264_slices(g_pCurrentModel));
 }
 
 void _process_extra_data_from_packet(u8 dataType, u8 dataSize, u8* pExtraData)
@@ -380,7 +384,14 @@ int _process_received_ruby_message(int iInterfaceIndex, u8* pPacketBuffer)
       return 0;
    }
 
-   if ( pPH->packet_type == PACKET_TYPE_RUBY_MODEL_SETTINGS )
+   if ( pPH->packet_type == PACKET_TYPE_RUBY_FILE_TRANSFER_SEGMENT )
+   {
+      if ( -1 != g_fIPCToCentral )
+         ruby_ipc_channel_send_message(g_fIPCToCentral, (u8*)pPH, pPH->total_length);
+      return 0;
+   }
+
+   if ( (pPH->packet_type == PACKET_TYPE_RUBY_MODEL_SETTINGS) || (pPH->packet_type == PACKET_TYPE_RUBY_MODEL_SECTION) )
    {
       if ( -1 != g_fIPCToCentral )
          ruby_ipc_channel_send_message(g_fIPCToCentral, (u8*)pPH, pPH->total_length);
@@ -539,7 +550,7 @@ void _process_received_single_packet_while_searching(int interfaceIndex, u8* pDa
    }   
 }
 
-void _parse_single_packet_h264_data(u8* pPacketData, bool bIsRelayed)
+void _parse_single_packet_h264_data(u8* pPacketData, u32 uVideoStreamType, bool bIsRelayed)
 {
    if ( NULL == pPacketData )
       return;
@@ -548,25 +559,28 @@ void _parse_single_packet_h264_data(u8* pPacketData, bool bIsRelayed)
    t_packet_header_video_full_77* pPHVF = (t_packet_header_video_full_77*) (pPacketData+sizeof(t_packet_header));
    int iVideoDataLength = pPHVF->video_data_length;    
    u8* pData = pPacketData + sizeof(t_packet_header) + sizeof(t_packet_header_video_full_77);
+   ParserH264* pParser = &s_ParserH264RadioInput;
+   if ( uVideoStreamType == VIDEO_TYPE_H265 )
+      pParser = &s_ParserH265RadioInput;
 
-   bool bStartOfFrameDetected = s_ParserH264RadioInput.parseData(pData, iVideoDataLength, g_TimeNow);
+   bool bStartOfFrameDetected = pParser->parseData(pData, iVideoDataLength, g_TimeNow);
    if ( ! bStartOfFrameDetected )
       return;
    
    if ( g_iDebugShowKeyFramesAfterRelaySwitch > 0 )
-   if ( s_ParserH264RadioInput.IsInsideIFrame() )
+   if ( pParser->IsInsideIFrame() )
    {
       log_line("[Debug] Received video keyframe from VID %u after relay switch.", pPH->vehicle_id_src);
       g_iDebugShowKeyFramesAfterRelaySwitch--;
    }
 
-   u32 uLastFrameDuration = s_ParserH264RadioInput.getTimeDurationOfLastCompleteFrame();
+   u32 uLastFrameDuration = pParser->getTimeDurationOfLastCompleteFrame();
    if ( uLastFrameDuration > 127 )
       uLastFrameDuration = 127;
    if ( uLastFrameDuration < 1 )
       uLastFrameDuration = 1;
 
-   u32 uLastFrameSize = s_ParserH264RadioInput.getSizeOfLastCompleteFrame();
+   u32 uLastFrameSize = pParser->getSizeOfLastCompleteFrame();
    uLastFrameSize /= 1000; // transform to kbytes
 
    if ( uLastFrameSize > 127 )
@@ -578,14 +592,14 @@ void _parse_single_packet_h264_data(u8* pPacketData, bool bIsRelayed)
  
    u32 uNextIndex = (g_SM_VideoInfoStatsRadioIn.uLastIndex+1) % MAX_FRAMES_SAMPLES;
   
-   if ( s_ParserH264RadioInput.IsInsideIFrame() )
+   if ( pParser->IsInsideIFrame() )
       g_SM_VideoInfoStatsRadioIn.uFramesTypesAndSizes[uNextIndex] |= (1<<7);
    else
       g_SM_VideoInfoStatsRadioIn.uFramesTypesAndSizes[uNextIndex] &= 0x7F;
 
-   g_SM_VideoInfoStatsRadioIn.uKeyframeIntervalMs = s_ParserH264RadioInput.getCurrentlyDetectedKeyframeIntervalMs();
-   g_SM_VideoInfoStatsRadioIn.uDetectedFPS = s_ParserH264RadioInput.getDetectedFPS();
-   g_SM_VideoInfoStatsRadioIn.uDetectedSlices = (u32) s_ParserH264RadioInput.getDetectedSlices();
+   g_SM_VideoInfoStatsRadioIn.uKeyframeIntervalMs = pParser->getCurrentlyDetectedKeyframeIntervalMs();
+   g_SM_VideoInfoStatsRadioIn.uDetectedFPS = pParser->getDetectedFPS();
+   g_SM_VideoInfoStatsRadioIn.uDetectedSlices = (u32) pParser->getDetectedSlices();
 }
 
 
@@ -704,10 +718,10 @@ int _process_received_video_data_packet(int iInterfaceIndex, u8* pPacket, int iP
 
    if ( ! ( pPH->packet_flags & PACKET_FLAGS_BIT_RETRANSMITED) )
    if ( pPHVF->video_block_packet_index < pPHVF->block_packets )
-   if ( uVideoStreamType == VIDEO_TYPE_H264 )
+   if ( (uVideoStreamType == VIDEO_TYPE_H264) || (uVideoStreamType == VIDEO_TYPE_H265) )
    if ( pModel->osd_params.osd_flags[pModel->osd_params.layout] & OSD_FLAG_SHOW_STATS_VIDEO_KEYFRAMES_INFO )
    if ( get_ControllerSettings()->iShowVideoStreamInfoCompactType == 0 )
-      _parse_single_packet_h264_data(pPacket, bIsRelayedPacket);
+      _parse_single_packet_h264_data(pPacket, uVideoStreamType, bIsRelayedPacket);
 
    if ( ! (pPH->packet_flags & PACKET_FLAGS_BIT_RETRANSMITED) )
    if ( pPHVF->uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_HAS_DEBUG_TIMESTAMPS )
@@ -736,9 +750,55 @@ int _process_received_video_data_packet(int iInterfaceIndex, u8* pPacket, int iP
 // Returns 1 if end of a video block was reached
 // Returns -1 if the packet is not for this vehicle or was not processed
 
+// Rebuilds the full Ruby telemetry packet from the compact one received on serial radio links.
+// Returns the length of the rebuilt packet or 0 if it can't be rebuilt yet (keyframe missing)
+int _rebuild_ruby_telemetry_from_delta_packet(int iInterfaceIndex, u8* pData, int iLength, u8* pOutput, int iMaxOutputLength)
+{
+   static bool s_bTelemetryDeltaStatesInitialized = false;
+   static type_telemetry_delta_state s_TelemetryDeltaStates[MAX_RADIO_INTERFACES];
+   static u32 s_uTelemetryDeltaVehicleIds[MAX_RADIO_INTERFACES];
+
+   if ( (iInterfaceIndex < 0) || (iInterfaceIndex >= MAX_RADIO_INTERFACES) )
+      return 0;
+   if ( ! s_bTelemetryDeltaStatesInitialized )
+   {
+      s_bTelemetryDeltaStatesInitialized = true;
+      for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+      {
+         telemetry_delta_init_state(&s_TelemetryDeltaStates[i]);
+         s_uTelemetryDeltaVehicleIds[i] = 0;
+      }
+   }
+
+   t_packet_header* pPH = (t_packet_header*)pData;
+   if ( s_uTelemetryDeltaVehicleIds[iInterfaceIndex] != pPH->vehicle_id_src )
+   {
+      telemetry_delta_init_state(&s_TelemetryDeltaStates[iInterfaceIndex]);
+      s_uTelemetryDeltaVehicleIds[iInterfaceIndex] = pPH->vehicle_id_src;
+   }
+
+   int iResult = telemetry_delta_decode_packet(&s_TelemetryDeltaStates[iInterfaceIndex], pData, iLength, pOutput, iMaxOutputLength);
+   if ( iResult < 0 )
+   {
+      log_softerror_and_alarm("Received invalid compact Ruby telemetry packet (%d bytes) on radio interface %d.", iLength, iInterfaceIndex+1);
+      return 0;
+   }
+   return iResult;
+}
+
 int process_received_single_radio_packet(int interfaceIndex, u8* pData, int length)
 {
    t_packet_header* pPH = (t_packet_header*)pData;
+
+   static u8 s_uRebuiltTelemetryPacket[MAX_PACKET_TOTAL_SIZE];
+   if ( pPH->packet_type == PACKET_TYPE_RUBY_TELEMETRY_EXTENDED_DELTA )
+   {
+      length = _rebuild_ruby_telemetry_from_delta_packet(interfaceIndex, pData, length, s_uRebuiltTelemetryPacket, sizeof(s_uRebuiltTelemetryPacket));
+      if ( length <= 0 )
+         return 0;
+      pData = s_uRebuiltTelemetryPacket;
+      pPH = (t_packet_header*)pData;
+   }
      
    if ( NULL != g_pProcessStats )
       g_pProcessStats->lastRadioRxTime = g_TimeNow;
@@ -141,6 +141,8 @@ ProcessorRxVideo::ProcessorRxVideo(u32 uVehicleId, u32 uVideoStreamIndex)
       m_pRXBlocksStack[i] = NULL;
 
    m_bPaused = false;
+   m_bOutputFrameInProgress = false;
+   m_bOutputFrameDamaged = false;
 }
 
 ProcessorRxVideo::~ProcessorRxVideo()
@@ -359,6 +361,8 @@ void ProcessorRxVideo::resetReceiveState()
    m_SM_VideoDecodeStats.currentPacketsInBuffers = 0;
    m_SM_VideoDecodeStats.maxPacketsInBuffers = 10;
    m_SM_VideoDecodeStats.total_DiscardedSegments = 0;
+   m_SM_VideoDecodeStats.total_OutputFramesComplete = 0;
+   m_SM_VideoDecodeStats.total_OutputFramesDamaged = 0;
 
    
    m_SM_VideoDecodeStatsHistory.totalCurrentlyMissingPackets = 0;
@@ -426,6 +430,7 @@ void ProcessorRxVideo::resetReceiveBuffersBlock(int rx_buffer_block_index)
       m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[k].uTimeLastRetrySent = 0;
       m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[k].video_data_length = 0;
       m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[k].packet_length = 0;
+      m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[k].uVideoStatusFlags2 = 0;
    }
 
    m_pRXBlocksStack[rx_buffer_block_index]->video_block_index = MAX_U32;
@@ -494,6 +499,8 @@ void ProcessorRxVideo::resetRetransmissionsStats()
 
    m_SM_VideoDecodeStats.total_DiscardedLostPackets = 0;
    m_SM_VideoDecodeStats.total_DiscardedSegments = 0;
+   m_SM_VideoDecodeStats.total_OutputFramesComplete = 0;
+   m_SM_VideoDecodeStats.total_OutputFramesDamaged = 0;
    m_SM_VideoDecodeStats.total_DiscardedBuffers = 0;
 
    log("[VideoRx] VID %u, video stream %u: Reseting retransmissions stats complete", m_uVehicleId, m_uVideoStreamIndex);
@@ -640,9 +647,12 @@ void ProcessorRxVideo::sendPacketToOutput(int rx_buffer_block_index, int block_p
    if ( ! (m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[block_packet_index].uState & RX_PACKET_STATE_RECEIVED) )
    {
       m_SM_VideoDecodeStats.total_DiscardedLostPackets++;
+      updateOutputFramesStats(0, true);
       return;
    }
 
+   updateOutputFramesStats(m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[block_packet_index].uVideoStatusFlags2, false);
+
    m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[block_packet_index].uState |= RX_PACKET_STATE_OUTPUTED;
 
    m_uLastOutputVideoBlockIndex = m_pRXBlocksStack[rx_buffer_block_index]->video_block_index;
@@ -653,9 +663,60 @@ void ProcessorRxVideo::sendPacketToOutput(int rx_buffer_block_index, int block_p
    int lengthVideo = m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[block_packet_index].video_data_length;
    int packet_length = m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[block_packet_index].packet_length;
 
+   // NAL aligned packets are zero padded after the last NAL unit (usually at the end of a frame), don't output the padding.
+   // Reconstructed packets have no payload length and are output whole. Packets with debug timestamps are left unchanged,
+   // as the timestamps are after the full video data.
+   u32 uVideoStatusFlags2 = m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[block_packet_index].uVideoStatusFlags2;
+   if ( uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_IS_NAL_ALIGNED )
+   if ( ! (uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_HAS_DEBUG_TIMESTAMPS) )
+   {
+      int iPayloadLength = (int)((uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_MASK_PAYLOAD_LENGTH) >> VIDEO_STATUS_FLAGS2_SHIFT_PAYLOAD_LENGTH);
+      if ( (iPayloadLength > 0) && (iPayloadLength < lengthVideo) )
+         lengthVideo = iPayloadLength;
+   }
+
    rx_video_output_video_data(m_uVehicleId, (m_SM_VideoDecodeStats.video_stream_and_type >> 4) & 0x0F , m_SM_VideoDecodeStats.width, m_SM_VideoDecodeStats.height, pBuffer, lengthVideo, packet_length);
 }
 
+// Keeps track of complete/damaged output frames, using the frame boundaries
+// marked by the vehicle when it uses NAL aligned video packets
+
+void ProcessorRxVideo::updateOutputFramesStats(u32 uVideoStatusFlags2, bool bPacketLost)
+{
+   if ( bPacketLost )
+   {
+      m_bOutputFrameDamaged = true;
+      return;
+   }
+   if ( ! (uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_IS_NAL_ALIGNED) )
+      return;
+
+   if ( uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_IS_FRAME_START )
+   {
+      // Previous frame end was lost or not marked
+      if ( m_bOutputFrameInProgress )
+      {
+         if ( m_bOutputFrameDamaged )
+            m_SM_VideoDecodeStats.total_OutputFramesDamaged++;
+         else
+            m_SM_VideoDecodeStats.total_OutputFramesComplete++;
+      }
+      m_bOutputFrameInProgress = true;
+      m_bOutputFrameDamaged = false;
+   }
+
+   if ( uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_IS_FRAME_END )
+   if ( m_bOutputFrameInProgress )
+   {
+      if ( m_bOutputFrameDamaged )
+         m_SM_VideoDecodeStats.total_OutputFramesDamaged++;
+      else
+         m_SM_VideoDecodeStats.total_OutputFramesComplete++;
+      m_bOutputFrameInProgress = false;
+      m_bOutputFrameDamaged = false;
+   }
+}
+
 void ProcessorRxVideo::pushIncompleteBlocksOut(int iStackIndexToDiscardTo, bool bTooOld)
 {
    // Discard blocks, do not output them (unless blocks are good and not too old)
@@ -711,6 +772,8 @@ void ProcessorRxVideo::pushIncompleteBlocksOut(int iStackIndexToDiscardTo, bool
       if ( bTooOld )
       {
          m_SM_VideoDecodeStats.total_DiscardedLostPackets += m_pRXBlocksStack[i]->data_packets - m_pRXBlocksStack[i]->received_data_packets;
+         if ( m_pRXBlocksStack[i]->received_data_packets < m_pRXBlocksStack[i]->data_packets )
+            m_bOutputFrameDamaged = true;
          resetReceiveBuffersBlock(i);
          continue;
       }
@@ -739,7 +802,10 @@ void ProcessorRxVideo::pushIncompleteBlocksOut(int iStackIndexToDiscardTo, bool
             sendPacketToOutput(i, k);
       }
       else
+      {
          m_SM_VideoDecodeStats.total_DiscardedLostPackets += m_pRXBlocksStack[i]->data_packets - m_pRXBlocksStack[i]->received_data_packets;
+         m_bOutputFrameDamaged = true;
+      }
 
       resetReceiveBuffersBlock(i);
    }
@@ -1437,6 +1503,34 @@ void ProcessorRxVideo::updateHistoryStatsBlockOutputed(int rx_buffer_block_index
    }
 }
 
+// Reconstructed packets don't have a video header. For NAL aligned streams, the frame start is recomputed
+// from the packet data: the packet starts with a start code and a non VCL unit or the first slice of a frame.
+
+static bool _rx_video_nal_aligned_packet_is_frame_start(u8* pData, int iLength, bool bIsH265)
+{
+   if ( (NULL == pData) || (iLength < 6) )
+      return false;
+   if ( (pData[0] != 0) || (pData[1] != 0) || (pData[2] != 1) )
+      return false;
+   if ( bIsH265 )
+   {
+      // Two bytes NAL header; first_slice_segment_in_pic_flag is the first bit of the slice header
+      u8 uNALUType = (pData[3] >> 1) & 0x3F;
+      if ( ((uNALUType >= 32) && (uNALUType <= 35)) || (uNALUType == 39) )
+         return true;
+      if ( uNALUType > 31 )
+         return false;
+      return (pData[5] & 0x80)?true:false;
+   }
+   u8 uNALUType = pData[3] & 0x1F;
+   if ( (uNALUType >= 6) && (uNALUType <= 9) )
+      return true;
+   // first_mb_in_slice is 0 (ue(v) coded as a single 1 bit)
+   if ( (uNALUType == 1) || (uNALUType == 5) )
+      return (pData[4] & 0x80)?true:false;
+   return false;
+}
+
 void ProcessorRxVideo::reconstructBlock(int rx_buffer_block_index)
 {
 
@@ -1447,6 +1541,7 @@ void ProcessorRxVideo::reconstructBlock(int rx_buffer_block_index)
 
    // Add existing data packets, mark and count the ones that are missing
 
+   u32 uNALAlignedFlag = 0;
    s_FECInfo.missing_packets_count = 0;
    for( int i=0; i<m_pRXBlocksStack[rx_buffer_block_index]->data_packets; i++ )
    {
@@ -1457,6 +1552,8 @@ void ProcessorRxVideo::reconstructBlock(int rx_buffer_block_index)
          s_FECInfo.missing_packets_count++;
          //s_VDStatsCache.total_BadOrLostPackets++;
       }
+      else
+         uNALAlignedFlag |= m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[i].uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_IS_NAL_ALIGNED;
    }
 
    if ( s_FECInfo.missing_packets_count > g_PD_ControllerLinkStats.tmp_video_streams_blocks_max_ec_packets_used[0] )
@@ -1487,11 +1584,26 @@ void ProcessorRxVideo::reconstructBlock(int rx_buffer_block_index)
       m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[s_FECInfo.fec_decode_missing_packets_indexes[i]].uState |= RX_PACKET_STATE_RECEIVED;
       m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[s_FECInfo.fec_decode_missing_packets_indexes[i]].video_data_length = m_pRXBlocksStack[rx_buffer_block_index]->video_data_length;
       m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[s_FECInfo.fec_decode_missing_packets_indexes[i]].packet_length = m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[s_FECInfo.fec_decode_missing_packets_indexes[i]].video_data_length;
+      m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[s_FECInfo.fec_decode_missing_packets_indexes[i]].uVideoStatusFlags2 = uNALAlignedFlag;
+      if ( uNALAlignedFlag )
+      if ( _rx_video_nal_aligned_packet_is_frame_start(m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[s_FECInfo.fec_decode_missing_packets_indexes[i]].pData, m_pRXBlocksStack[rx_buffer_block_index]->video_data_length, ((m_SM_VideoDecodeStats.video_stream_and_type >> 4) & 0x0F) == VIDEO_TYPE_H265) )
+         m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[s_FECInfo.fec_decode_missing_packets_indexes[i]].uVideoStatusFlags2 |= VIDEO_STATUS_FLAGS2_IS_FRAME_START;
       m_pRXBlocksStack[rx_buffer_block_index]->received_data_packets++;
 
       if ( m_SM_VideoDecodeStats.currentPacketsInBuffers > m_SM_VideoDecodeStats.maxPacketsInBuffers )
          m_SM_VideoDecodeStats.maxPacketsInBuffers = m_SM_VideoDecodeStats.currentPacketsInBuffers;
    }
+
+   // A reconstructed packet ends a frame if the next one in the block starts a frame
+   if ( uNALAlignedFlag )
+   for( u32 i=0; i<s_FECInfo.missing_packets_count; i++ )
+   {
+      int iIndex = s_FECInfo.fec_decode_missing_packets_indexes[i];
+      if ( iIndex+1 >= m_pRXBlocksStack[rx_buffer_block_index]->data_packets )
+         continue;
+      if ( m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[iIndex+1].uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_IS_FRAME_START )
+         m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[iIndex].uVideoStatusFlags2 |= VIDEO_STATUS_FLAGS2_IS_FRAME_END;
+   }
   //_rx_video_log_line("Reconstructed block %u, had %d missing packets", s_pRXBlocksStack[rx_buffer_block_index]->video_block_index, s_FECInfo.missing_packets_count);
 
 }
@@ -2052,6 +2164,7 @@ void ProcessorRxVideo::addPacketToReceivedBlocksBuffers(u8* pBuffer, int length,
    m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[pPHVF->video_block_packet_index].uState |= RX_PACKET_STATE_RECEIVED;
    m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[pPHVF->video_block_packet_index].video_data_length = pPHVF->video_data_length;
    m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[pPHVF->video_block_packet_index].packet_length = length;
+   m_pRXBlocksStack[rx_buffer_block_index]->packetsInfo[pPHVF->video_block_packet_index].uVideoStatusFlags2 = pPHVF->uVideoStatusFlags2;
 
    if ( length < 100 || length > MAX_PACKET_TOTAL_SIZE )
       log_softerror_and_alarm("Invalid video data size to copy (%d bytes)", length);
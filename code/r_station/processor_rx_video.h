@@ -38,6 +38,7 @@ typedef struct
    u8 uRetrySentCount;
    u32 uTimeFirstRetrySent;
    u32 uTimeLastRetrySent;
+   u32 uVideoStatusFlags2; // Recomputed for reconstructed packets, without the payload length
    u8* pData;
 }
 type_received_block_packet_info;
@@ -122,6 +123,7 @@ class ProcessorRxVideo
       void checkAndRequestMissingPackets();
       void checkAndDiscardBlocksTooOld();
       void sendPacketToOutput(int rx_buffer_block_index, int block_packet_index);
+      void updateOutputFramesStats(u32 uVideoStatusFlags2, bool bPacketLost);
       void pushIncompleteBlocksOut(int iStackIndexToDiscardTo, bool bTooOld);
       void pushFirstBlockOut();
 
@@ -139,6 +141,8 @@ class ProcessorRxVideo
       bool m_bInitialized;
       int m_iInstanceIndex;
       bool m_bPaused;
+      bool m_bOutputFrameInProgress;
+      bool m_bOutputFrameDamaged;
 
       // Configuration
 
@@ -1322,6 +1322,39 @@ void _preprocess_radio_out_packet(u8* pPacketBuffer)
 }
 
 
+bool _is_rc_low_latency_path_enabled()
+{
+   if ( g_bSearching || (NULL == g_pCurrentModel) || g_pCurrentModel->is_spectator )
+      return false;
+   if ( (! g_pCurrentModel->rc_params.rc_enabled) || (!(g_pCurrentModel->rc_params.flags & RC_FLAGS_LOW_LATENCY_PATH)) )
+      return false;
+   return true;
+}
+
+// On the low latency path, RC frames are sent right away instead of waiting in the radio queue
+// for the end of a video block; other messages from the RC process are still queued.
+void _read_ipc_rc_pipe(bool bLowLatency)
+{
+   int maxToRead = 10;
+   int maxPacketsToRead = maxToRead;
+   while ( (maxPacketsToRead > 0) && (NULL != ruby_ipc_try_read_message(g_fIPCFromRC, s_PipeBufferRCUplink, &s_PipeBufferRCUplinkPos, s_BufferRCUplink)) )
+   {
+      maxPacketsToRead--;
+      t_packet_header* pPH = (t_packet_header*)s_BufferRCUplink;      
+      if ( (pPH->packet_flags & PACKET_FLAGS_MASK_MODULE) == PACKET_COMPONENT_LOCAL_CONTROL )
+         packets_queue_add_packet(&s_QueueControlPackets, s_BufferRCUplink); 
+      else if ( bLowLatency && ((pPH->packet_flags & PACKET_FLAGS_MASK_MODULE) == PACKET_COMPONENT_RC) && (pPH->packet_type == PACKET_TYPE_RC_FULL_FRAME) )
+         send_packet_to_radio_interfaces(s_BufferRCUplink, pPH->total_length, -1);
+      else
+      {
+         _preprocess_radio_out_packet(s_BufferRCUplink);
+         packets_queue_add_packet(&s_QueueRadioPackets, s_BufferRCUplink);
+      }
+   }
+   if ( maxToRead - maxPacketsToRead > 6 )
+      log_line("Read %d messages from RC msgqueue.", maxToRead - maxPacketsToRead);
+}
+
 void _read_ipc_pipes(u32 uTimeNow)
 {
    s_uTimeLastTryReadIPCMessages = uTimeNow;
@@ -1360,21 +1393,9 @@ void _read_ipc_pipes(u32 uTimeNow)
    if ( maxToRead - maxPacketsToRead > 6 )
       log_line("Read %d messages from telemetry msgqueue.", maxToRead - maxPacketsToRead);
 
-   maxPacketsToRead = maxToRead;
-   while ( (maxPacketsToRead > 0) && (NULL != ruby_ipc_try_read_message(g_fIPCFromRC, s_PipeBufferRCUplink, &s_PipeBufferRCUplinkPos, s_BufferRCUplink)) )
-   {
-      maxPacketsToRead--;
-      t_packet_header* pPH = (t_packet_header*)s_BufferRCUplink;      
-      if ( (pPH->packet_flags & PACKET_FLAGS_MASK_MODULE) == PACKET_COMPONENT_LOCAL_CONTROL )
-         packets_queue_add_packet(&s_QueueControlPackets, s_BufferRCUplink); 
-      else
-      {
-         _preprocess_radio_out_packet(s_BufferRCUplink);
-         packets_queue_add_packet(&s_QueueRadioPackets, s_BufferRCUplink);
-      }
-   }
-   if ( maxToRead - maxPacketsToRead > 6 )
-      log_line("Read %d messages from RC msgqueue.", maxToRead - maxPacketsToRead);
+   // On the low latency path the RC msgqueue is read on each router loop
+   if ( ! _is_rc_low_latency_path_enabled() )
+      _read_ipc_rc_pipe(false);
 }
 
 void init_shared_memory_objects()
@@ -2398,6 +2419,8 @@ void _main_loop()
       _read_ipc_pipes(tTime1);
       _consume_ipc_messages();
    }
+   if ( _is_rc_low_latency_path_enabled() )
+      _read_ipc_rc_pipe(true);
 
    u32 tTime2 = get_current_timestamp_ms();
 
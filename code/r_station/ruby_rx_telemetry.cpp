@@ -42,6 +42,7 @@
 #include "../base/ctrl_interfaces.h"
 #include "../base/controller_utils.h"
 #include "../base/ruby_ipc.h"
+#include "../base/serial_io.h"
 #include "../common/string_utils.h"
 
 #include "timers.h"
@@ -78,6 +79,11 @@ int g_iSerialPortTelemetry = -1;
 int g_iSerialPortIndexTelemetryOutput = -1;
 int g_iSerialPortIndexTelemetryInput = -1;
 int g_iSerialPortTelemetrySpeed = 0;
+int s_iSerialIOPortDataLink = -1;
+int s_iSerialIOPortTelemetry = -1;
+u32 s_uTimeLastSerialIOStatsLog = 0;
+bool s_bReopenSerialPorts = false;
+u32 s_uTimeLastSerialPortsReopen = 0;
 
 bool g_bOutputTelemetryToSerial = false;
 bool g_bInputTelemetryFromSerial = false;
@@ -242,8 +248,33 @@ void process_data_telemetry_raw_download(u8* pBuffer, int length)
 
 void _process_data_rc_telemetry(u8* pBuffer, int length)
 {
-   if ( NULL != s_pPHDownstreamInfoRC )
-      memcpy((u8*)s_pPHDownstreamInfoRC, pBuffer + sizeof(t_packet_header), sizeof(t_packet_header_rc_info_downstream));
+   int iDataLength = length - (int)sizeof(t_packet_header);
+   if ( (NULL != s_pPHDownstreamInfoRC) && (iDataLength >= (int)RC_INFO_DOWNSTREAM_MIN_LENGTH) )
+   {
+      // Older vehicles don't send the latency info; the controller only histograms (after the radio part) are kept
+      u32 uLastFrameTimeSentMs = s_pPHDownstreamInfoRC->uLastFrameTimeSentMs;
+      if ( iDataLength > (int)RC_INFO_DOWNSTREAM_RADIO_LENGTH )
+         iDataLength = RC_INFO_DOWNSTREAM_RADIO_LENGTH;
+      memcpy((u8*)s_pPHDownstreamInfoRC, pBuffer + sizeof(t_packet_header), iDataLength);
+      if ( iDataLength < (int)RC_INFO_DOWNSTREAM_RADIO_LENGTH )
+         memset(((u8*)s_pPHDownstreamInfoRC) + iDataLength, 0, RC_INFO_DOWNSTREAM_RADIO_LENGTH - iDataLength);
+
+      // Clocks are not synchronized: the air time is estimated as half of the round trip
+      // (controller RC process -> vehicle -> controller, minus the time the echo waited on the vehicle)
+      u32 uTimeNowMs = get_current_timestamp_ms();
+      if ( (0 != s_pPHDownstreamInfoRC->uLastFrameTimeSentMs) && (uLastFrameTimeSentMs != s_pPHDownstreamInfoRC->uLastFrameTimeSentMs) )
+      if ( 0xFFFF != s_pPHDownstreamInfoRC->uLastFrameVehicleDelayMs )
+      if ( uTimeNowMs >= s_pPHDownstreamInfoRC->uLastFrameTimeSentMs + s_pPHDownstreamInfoRC->uLastFrameVehicleDelayMs )
+      {
+         u32 uRoundTrip = uTimeNowMs - s_pPHDownstreamInfoRC->uLastFrameTimeSentMs - s_pPHDownstreamInfoRC->uLastFrameVehicleDelayMs;
+         if ( uRoundTrip < 5000 )
+         {
+            packet_rc_latency_histogram_add(&s_pPHDownstreamInfoRC->histRoundTrip, uRoundTrip);
+            u32 uStickToFC = (u32)s_pPHDownstreamInfoRC->uLastFrameInputAgeMs + (u32)s_pPHDownstreamInfoRC->uLastFrameRouterDelayMs + uRoundTrip/2 + (u32)s_pPHDownstreamInfoRC->uLastFrameToFCMs;
+            packet_rc_latency_histogram_add(&s_pPHDownstreamInfoRC->histStickToFC, uStickToFC);
+         }
+      }
+   }
 
    if ( NULL != g_pProcessStats )
       g_pProcessStats->timeLastReceivedPacket = g_TimeNow;
@@ -373,6 +404,26 @@ void upload_datalink_packet()
    s_uDataLinkUploadSegmentIndex++;
 }
 
+void _add_serial_telemetry_data(u8* pData, int length)
+{
+   s_uRawTelemetryUploadTotalReadFromSerial += length;
+   while ( length > 0 )
+   {
+         if ( telemetryBufferToVehicleCount + length < telemetryBufferToVehicleMaxSize )
+         {
+            memcpy(&(telemetryBufferToVehicle[telemetryBufferToVehicleCount]), pData, length);
+            telemetryBufferToVehicleCount += length;
+            return;
+         }
+         int chunkSize = telemetryBufferToVehicleMaxSize-telemetryBufferToVehicleCount;
+         memcpy(&(telemetryBufferToVehicle[telemetryBufferToVehicleCount]), pData, chunkSize);
+         telemetryBufferToVehicleCount += chunkSize;
+         pData += chunkSize;
+         length -= chunkSize;
+         upload_telemetry_packet();
+   }
+}
+
 void try_read_serial_telemetry()
 {
    if ( -1 == g_iSerialPortTelemetry )
@@ -381,6 +432,28 @@ void try_read_serial_telemetry()
       return;
 
    u8 bufferIn[RAW_TELEMETRY_MAX_BUFFER];
+
+   // Serial data was already read by the serial I/O wait in the main loop, consume all of it
+   if ( -1 != s_iSerialIOPortTelemetry )
+   {
+      int length = 0;
+      while ( (length = serial_io_read(s_iSerialIOPortTelemetry, bufferIn, RAW_TELEMETRY_MAX_BUFFER)) > 0 )
+         _add_serial_telemetry_data(bufferIn, length);
+
+      // Serial port unplugged: close it, it's opened again from the periodic checks
+      if ( serial_io_is_port_hung_up(s_iSerialIOPortTelemetry) )
+      {
+         log_softerror_and_alarm("Serial connection for telemetry was lost. Closing it.");
+         serial_io_remove_port(s_iSerialIOPortTelemetry);
+         s_iSerialIOPortTelemetry = -1;
+         close(g_iSerialPortTelemetry);
+         g_iSerialPortTelemetry = -1;
+         s_bReopenSerialPorts = true;
+         s_uTimeLastSerialPortsReopen = g_TimeNow;
+      }
+      return;
+   }
+
    struct timeval to;
    to.tv_sec = 0;
    to.tv_usec = 1000; // 1 ms
@@ -397,24 +470,28 @@ void try_read_serial_telemetry()
    if ( length <= 0 )
       return;
 
-   s_uRawTelemetryUploadTotalReadFromSerial += length;
-   u8* pData = &bufferIn[0];
+   _add_serial_telemetry_data(bufferIn, length);
+}  
+
+void _add_serial_datalink_data(u8* pData, int length)
+{
+   //log_line("Serial datalink read %d bytes.", length);
    while ( length > 0 )
    {
-         if ( telemetryBufferToVehicleCount + length < telemetryBufferToVehicleMaxSize )
+         if ( dataLinkBufferToVehicleCount + length < dataLinkBufferToVehicleMaxSize )
          {
-            memcpy(&(telemetryBufferToVehicle[telemetryBufferToVehicleCount]), pData, length);
-            telemetryBufferToVehicleCount += length;
+            memcpy(&(dataLinkBufferToVehicle[dataLinkBufferToVehicleCount]), pData, length);
+            dataLinkBufferToVehicleCount += length;
             return;
          }
-         int chunkSize = telemetryBufferToVehicleMaxSize-telemetryBufferToVehicleCount;
-         memcpy(&(telemetryBufferToVehicle[telemetryBufferToVehicleCount]), pData, chunkSize);
-         telemetryBufferToVehicleCount += chunkSize;
+         int chunkSize = dataLinkBufferToVehicleMaxSize-dataLinkBufferToVehicleCount;
+         memcpy(&(dataLinkBufferToVehicle[dataLinkBufferToVehicleCount]), pData, chunkSize);
+         dataLinkBufferToVehicleCount += chunkSize;
          pData += chunkSize;
          length -= chunkSize;
-         upload_telemetry_packet();
+         upload_datalink_packet();
    }
-}  
+}
 
 void try_read_serial_datalink()
 {
@@ -424,6 +501,26 @@ void try_read_serial_datalink()
       return;
 
    u8 bufferIn[RAW_TELEMETRY_MAX_BUFFER];
+
+   if ( -1 != s_iSerialIOPortDataLink )
+   {
+      int length = 0;
+      while ( (length = serial_io_read(s_iSerialIOPortDataLink, bufferIn, RAW_TELEMETRY_MAX_BUFFER)) > 0 )
+         _add_serial_datalink_data(bufferIn, length);
+
+      if ( serial_io_is_port_hung_up(s_iSerialIOPortDataLink) )
+      {
+         log_softerror_and_alarm("Serial connection for auxiliary data link was lost. Closing it.");
+         serial_io_remove_port(s_iSerialIOPortDataLink);
+         s_iSerialIOPortDataLink = -1;
+         close(g_iSerialPortDataLink);
+         g_iSerialPortDataLink = -1;
+         s_bReopenSerialPorts = true;
+         s_uTimeLastSerialPortsReopen = g_TimeNow;
+      }
+      return;
+   }
+
    struct timeval to;
    to.tv_sec = 0;
    to.tv_usec = 1000; // 1 ms
@@ -440,30 +537,8 @@ void try_read_serial_datalink()
    if ( length <= 0 )
       return;
 
-   //log_line("Serial datalink read %d bytes.", length);
-   //char szBuff[2000];
-   //memcpy(szBuff, &bufferIn[0], length);
-   //szBuff[length] = 0;
-   //log_line("Sending datalink data: %s", szBuff);
-   
-
-   u8* pData = &bufferIn[0];
-   while ( length > 0 )
-   {
-         if ( dataLinkBufferToVehicleCount + length < dataLinkBufferToVehicleMaxSize )
-         {
-            memcpy(&(dataLinkBufferToVehicle[dataLinkBufferToVehicleCount]), pData, length);
-            dataLinkBufferToVehicleCount += length;
-            return;
-         }
-         int chunkSize = dataLinkBufferToVehicleMaxSize-dataLinkBufferToVehicleCount;
-         memcpy(&(dataLinkBufferToVehicle[dataLinkBufferToVehicleCount]), pData, chunkSize);
-         dataLinkBufferToVehicleCount += chunkSize;
-         pData += chunkSize;
-         length -= chunkSize;
-         upload_datalink_packet();
-   }
-}  
+   _add_serial_datalink_data(bufferIn, length);
+}
 
 void try_read_messages_from_router()
 {
@@ -599,7 +674,10 @@ void init_serial_ports()
       if ( -1 == g_iSerialPortDataLink )
          log_softerror_and_alarm("Failed to open serial port %s (%s) for auxiliary data link.", pPortInfo->szName, pPortInfo->szPortDeviceName);
       else
+      {
          log_line("Opened serial port %s (%s) for auxiliary data link successfully at %d bps.", pPortInfo->szName, pPortInfo->szPortDeviceName, (int)pPortInfo->lPortSpeed);
+         s_iSerialIOPortDataLink = serial_io_add_port(g_iSerialPortDataLink, pPortInfo->szPortDeviceName);
+      }
    }
    else
       log_line("No serial port configured for auxiliary data link. Skipping it.");
@@ -686,10 +764,35 @@ void init_serial_ports()
    if ( -1 != g_iSerialPortIndexTelemetryInput )
       g_bInputTelemetryFromSerial = true;
 
+   // Only wait for serial data when it's actually read
+   if ( g_bInputTelemetryFromSerial )
+      s_iSerialIOPortTelemetry = serial_io_add_port(g_iSerialPortTelemetry, pPortInfo->szPortDeviceName);
+
    log_line("Reading telemetry from serial port? %s", g_bInputTelemetryFromSerial?"yes":"no");
    log_line("Writing telemetry to serial port? %s", g_bOutputTelemetryToSerial?"yes":"no");
 }
 
+void reinit_serial_ports()
+{
+   serial_io_remove_port(s_iSerialIOPortDataLink);
+   serial_io_remove_port(s_iSerialIOPortTelemetry);
+   s_iSerialIOPortDataLink = -1;
+   s_iSerialIOPortTelemetry = -1;
+
+   if ( -1 != g_iSerialPortDataLink )
+      close(g_iSerialPortDataLink);
+   g_iSerialPortDataLink = -1;
+
+   if ( -1 != g_iSerialPortTelemetry )
+      close(g_iSerialPortTelemetry);
+   g_iSerialPortTelemetry = -1;
+
+   g_iSerialPortIndexDataLink = -1;
+   g_iSerialPortIndexTelemetryInput = -1;
+   g_iSerialPortIndexTelemetryOutput = -1;
+   init_serial_ports();
+}
+
 void checkTelemetrySettingsOnControllerChanged()
 {
    hardware_reload_serial_ports_settings();
@@ -763,19 +866,7 @@ void checkTelemetrySettingsOnControllerChanged()
    }
 
    log_line("Telemetry params or the auxiliary data link changed on the controller. Reinitializing serial ports and telemetry params...");
-
-   if ( -1 != g_iSerialPortDataLink )
-      close(g_iSerialPortDataLink);
-   g_iSerialPortDataLink = -1;
-
-   if ( -1 != g_iSerialPortTelemetry )
-      close(g_iSerialPortTelemetry);
-   g_iSerialPortTelemetry = -1;
-
-   g_iSerialPortIndexDataLink = -1;
-   g_iSerialPortIndexTelemetryInput = -1;
-   g_iSerialPortIndexTelemetryOutput = -1;
-   init_serial_ports();
+   reinit_serial_ports();
 }
 
 void periodic_checks()
@@ -788,6 +879,26 @@ void periodic_checks()
       s_TimeLastUplinkKbpsComputation = g_TimeNow;
    }
 
+   // Keep trying to open again the serial ports that were lost (unplugged), until they are back
+   if ( s_bReopenSerialPorts && (g_TimeNow >= s_uTimeLastSerialPortsReopen + 2000) )
+   {
+      s_uTimeLastSerialPortsReopen = g_TimeNow;
+      log_line("Trying to open again the lost serial ports...");
+      reinit_serial_ports();
+      s_bReopenSerialPorts = false;
+      if ( (-1 != g_iSerialPortIndexDataLink) && (-1 == g_iSerialPortDataLink) )
+         s_bReopenSerialPorts = true;
+      if ( ((-1 != g_iSerialPortIndexTelemetryInput) || (-1 != g_iSerialPortIndexTelemetryOutput)) && (-1 == g_iSerialPortTelemetry) )
+         s_bReopenSerialPorts = true;
+   }
+
+   serial_io_update_stats(g_TimeNow);
+   if ( g_TimeNow >= s_uTimeLastSerialIOStatsLog + 20000 )
+   {
+      s_uTimeLastSerialIOStatsLog = g_TimeNow;
+      serial_io_log_stats();
+   }
+
    if ( s_TelemetryUSBOutputInfo.bUSBTethering && (pCS->iTelemetryForwardUSBType == 0) )
    {
       if ( -1 != s_TelemetryUSBOutputInfo.socketUSBOutput )
@@ -916,6 +1027,7 @@ int main(int argc, char *argv[])
 
    load_ControllerInterfacesSettings();
    load_ControllerSettings();
+   serial_io_init();
    init_serial_ports();
 
    Preferences* p = get_Preferences();   
@@ -942,7 +1054,9 @@ int main(int argc, char *argv[])
 
    while (!g_bQuit) 
    {
-      hardware_sleep_ms(iSleepTime);
+      // Wakes up as soon as serial data is available on any of the serial ports (telemetry input, data link)
+      if ( serial_io_wait_and_read(iSleepTime) < 0 )
+         hardware_sleep_ms(iSleepTime);
 
       g_TimeNow = get_current_timestamp_ms();
       if ( NULL != g_pProcessStats )
@@ -995,6 +1109,10 @@ int main(int argc, char *argv[])
 
    log_line("Stopping...");
 
+   serial_io_uninit();
+   s_iSerialIOPortDataLink = -1;
+   s_iSerialIOPortTelemetry = -1;
+
    if ( -1 != g_iSerialPortDataLink )
       close(g_iSerialPortDataLink);
    g_iSerialPortDataLink = -1;
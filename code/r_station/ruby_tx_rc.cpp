@@ -95,6 +95,7 @@ u32 s_uLastTimeStampRCInFrame = 0;
 u8 s_uLastFrameIndexRCIn = 0;
 u32 s_uTimeLastRCFrameSent = 0;
 u32 s_uTimeBetweenRCFramesOutput = 100000;
+u32 s_uTimeLastRCInput = 0;
 
 void init_controller_settings();
 
@@ -407,6 +408,9 @@ int main (int argc, char *argv[])
             {
                s_uLastTimeStampRCInFrame = s_pSM_RCIn->uTimeStamp;
                s_uLastFrameIndexRCIn = s_pSM_RCIn->uFrameIndex;
+               s_uTimeLastRCInput = g_TimeNow;
+               if ( s_uLastTimeStampRCInFrame <= g_TimeNow )
+                  s_uTimeLastRCInput = s_uLastTimeStampRCInFrame;
                int nCh = g_pCurrentModel->rc_params.channelsCount;
                if ( nCh > (int)(s_pSM_RCIn->uChannelsCount) )
                   nCh = (int)(s_pSM_RCIn->uChannelsCount);
@@ -424,7 +428,10 @@ int main (int argc, char *argv[])
       if ( g_pCurrentModel->rc_params.inputType == RC_INPUT_TYPE_USB )
       {
          if ( handle_joysticks() )
+         {
             g_PHRCFUpstream.flags |= RC_FULL_FRAME_FLAGS_HAS_INPUT;
+            s_uTimeLastRCInput = g_TimeNow;
+         }
          else
             g_PHRCFUpstream.flags &= (~RC_FULL_FRAME_FLAGS_HAS_INPUT);
       }
@@ -436,7 +443,15 @@ int main (int argc, char *argv[])
          u32 uDelta = s_uTimeLastRCFrameSent + s_uTimeBetweenRCFramesOutput - g_TimeNow;
          if ( uDelta > 40 )
             uDelta = 40;
-         hardware_sleep_ms(uDelta/2);
+         // Low latency path: wake up close to the frame time to keep the frames interval jitter low
+         if ( g_pCurrentModel->rc_params.flags & RC_FLAGS_LOW_LATENCY_PATH )
+         {
+            iSleepTime = 1;
+            if ( uDelta > 2 )
+               hardware_sleep_ms(uDelta-2);
+         }
+         else
+            hardware_sleep_ms(uDelta/2);
          continue;
       }
 
@@ -451,6 +466,14 @@ int main (int argc, char *argv[])
 
       populate_rc_data(&g_PHRCFUpstream);
 
+      // Latency tracking: the router adds its own delay, the vehicle echoes the send time back
+      g_PHRCFUpstream.uTimeSentMs = get_current_timestamp_ms();
+      g_PHRCFUpstream.uInputAgeMs = 255;
+      if ( (0 != s_uTimeLastRCInput) && (s_uTimeLastRCInput <= g_PHRCFUpstream.uTimeSentMs) )
+      if ( g_PHRCFUpstream.uTimeSentMs - s_uTimeLastRCInput < 255 )
+         g_PHRCFUpstream.uInputAgeMs = (u8)(g_PHRCFUpstream.uTimeSentMs - s_uTimeLastRCInput);
+      g_PHRCFUpstream.uRouterDelayMs = 0;
+
       if ( NULL != s_pPHRCFUpstream )
          memcpy(s_pPHRCFUpstream, &g_PHRCFUpstream, sizeof(t_packet_header_rc_full_frame_upstream) );
 
@@ -56,6 +56,7 @@
 #include "../base/hw_procs.h"
 #include "../base/ruby_ipc.h"
 #include "../base/parser_h264.h"
+#include "../base/parser_h265.h"
 #include "../base/camera_utils.h"
 #include "../common/string_utils.h"
 #include "../radio/radiolink.h"
@@ -78,6 +79,7 @@ int s_fPipeVideoOutToPlayer = -1;
 bool s_bDidSentAnyDataToVideoPlayerPipe = false;
 
 ParserH264 s_ParserH264Output;
+ParserH265 s_ParserH265Output;
 
 u32 s_uLastIOErrorAlarmFlagsVideoPlayer = 0;
 u32 s_uLastIOErrorAlarmFlagsUSBPlayer = 0;
@@ -219,6 +221,8 @@ void _rx_video_output_launch_video_player()
    szCodec[0] = 0;
    if ( g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_GENERATE_H265 )
       strcpy(szCodec, " -h265");
+   if ( pcs->iVideoDisplayLowestLatency )
+      strcat(szCodec, " -lowlat");
 
    if ( pcs->iNiceRXVideo >= 0 )
    {
@@ -422,6 +426,7 @@ void rx_video_output_init()
    s_bDidSentAnyDataToVideoPlayerPipe = false;
    
    s_ParserH264Output.init(camera_get_active_camera_h264_slices(g_pCurrentModel));
+   s_ParserH265Output.init(camera_get_active_camera_h264_slices(g_pCurrentModel));
    
    s_VideoUSBOutputInfo.bVideoUSBTethering = false;
    s_VideoUSBOutputInfo.TimeLastVideoUSBTetheringCheck = 0;
@@ -621,19 +626,23 @@ void rx_video_output_disable_local_player_udp_output()
    s_iLocalVideoPlayerUDPSocket = -1;
 }
 
-void _processor_rx_video_forward_parse_h264_stream(u8* pBuffer, int length)
+void _processor_rx_video_forward_parse_h264_stream(u32 uVideoStreamType, u8* pBuffer, int length)
 {
-   bool bStartOfFrameDetected = s_ParserH264Output.parseData(pBuffer, length, g_TimeNow);
+   ParserH264* pParser = &s_ParserH264Output;
+   if ( uVideoStreamType == VIDEO_TYPE_H265 )
+      pParser = &s_ParserH265Output;
+
+   bool bStartOfFrameDetected = pParser->parseData(pBuffer, length, g_TimeNow);
    if ( ! bStartOfFrameDetected )
       return;
    
-   u32 uLastFrameDuration = s_ParserH264Output.getTimeDurationOfLastCompleteFrame();
+   u32 uLastFrameDuration = pParser->getTimeDurationOfLastCompleteFrame();
    if ( uLastFrameDuration > 127 )
       uLastFrameDuration = 127;
    if ( uLastFrameDuration < 1 )
       uLastFrameDuration = 1;
 
-   u32 uLastFrameSize = s_ParserH264Output.getSizeOfLastCompleteFrame();
+   u32 uLastFrameSize = pParser->getSizeOfLastCompleteFrame();
    uLastFrameSize /= 1000; // transform to kbytes
 
    if ( uLastFrameSize > 127 )
@@ -645,14 +654,14 @@ void _processor_rx_video_forward_parse_h264_stream(u8* pBuffer, int length)
  
    u32 uNextIndex = (g_SM_VideoInfoStatsOutput.uLastIndex+1) % MAX_FRAMES_SAMPLES;
   
-   if ( s_ParserH264Output.IsInsideIFrame() )
+   if ( pParser->IsInsideIFrame() )
       g_SM_VideoInfoStatsOutput.uFramesTypesAndSizes[uNextIndex] |= (1<<7);
    else
       g_SM_VideoInfoStatsOutput.uFramesTypesAndSizes[uNextIndex] &= 0x7F;
 
-   g_SM_VideoInfoStatsOutput.uKeyframeIntervalMs = s_ParserH264Output.getCurrentlyDetectedKeyframeIntervalMs();
-   g_SM_VideoInfoStatsOutput.uDetectedFPS = s_ParserH264Output.getDetectedFPS();
-   g_SM_VideoInfoStatsOutput.uDetectedSlices = (u32) s_ParserH264Output.getDetectedSlices();
+   g_SM_VideoInfoStatsOutput.uKeyframeIntervalMs = pParser->getCurrentlyDetectedKeyframeIntervalMs();
+   g_SM_VideoInfoStatsOutput.uDetectedFPS = pParser->getDetectedFPS();
+   g_SM_VideoInfoStatsOutput.uDetectedSlices = (u32) pParser->getDetectedSlices();
 }
 
 void _rx_video_output_to_video_player(u32 uVehicleId, int width, int height, u8* pBuffer, int length)
@@ -852,11 +861,11 @@ void rx_video_output_video_data(u32 uVehicleId, u8 uVideoStreamType, int width,
    }
 
    if ( NULL != g_pCurrentModel )
-   if ( uVideoStreamType == VIDEO_TYPE_H264 )
+   if ( (uVideoStreamType == VIDEO_TYPE_H264) || (uVideoStreamType == VIDEO_TYPE_H265) )
    if ( g_pCurrentModel->osd_params.osd_flags[g_pCurrentModel->osd_params.layout] & OSD_FLAG_SHOW_STATS_VIDEO_KEYFRAMES_INFO)
    if ( get_ControllerSettings()->iShowVideoStreamInfoCompactType == 0 )
    {
-      _processor_rx_video_forward_parse_h264_stream(pBuffer, video_data_length);
+      _processor_rx_video_forward_parse_h264_stream(uVideoStreamType, pBuffer, video_data_length);
    }
 
    if ( -1 != s_fPipeVideoOutToPlayer ) 
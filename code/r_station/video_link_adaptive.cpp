@@ -40,6 +40,7 @@
 #include "timers.h"
 
 #include "video_link_adaptive.h"
+#include "video_link_adaptive_predictive.h"
 #include "video_link_keyframe.h"
 #include "processor_rx_video.h"
 #include "links_utils.h"
@@ -48,10 +49,18 @@ extern t_packet_queue s_QueueRadioPackets;
 
 u32 s_uPauseAdjustmensUntilTime = 0;
 u32 s_uTimeStartGoodIntervalForProfileShiftUp = 0;
+u32 s_uTimeLastPeriodicResentCurrentAdaptiveLevel = 0;
+
+type_adaptive_predictive_state s_AdaptivePredictiveState[MAX_CONCURENT_VEHICLES];
+u32 s_uAdaptivePredictiveVehicleId[MAX_CONCURENT_VEHICLES];
+FILE* s_pFileAdaptivePredictiveStats = NULL;
 
 void video_link_adaptive_init(u32 uVehicleId)
 {
    s_uPauseAdjustmensUntilTime = 0;
+   int iIndex = getVehicleRuntimeIndex(uVehicleId);
+   if ( -1 != iIndex )
+      s_uAdaptivePredictiveVehicleId[iIndex] = 0;
    log_line("Initialized adaptive video info for VID: %u", uVehicleId);
    video_link_keyframe_init(uVehicleId);
 }
@@ -163,9 +172,69 @@ void _video_link_adaptive_check_send_to_vehicle(u32 uVehicleId, bool bForce)
 
 }
 
-void _video_link_adaptive_check_adjust_video_params(u32 uVehicleId)
+void _video_link_adaptive_check_send_and_resend(Model* pModel, u32 uVehicleId)
 {
-   Model* pModel = findModelWithId(uVehicleId, 143);
+   _video_link_adaptive_check_send_to_vehicle(uVehicleId, false);
+
+   if ( ! pModel->isVideoLinkFixedOneWay() )
+   if ( g_TimeNow > s_uTimeLastPeriodicResentCurrentAdaptiveLevel + 5000 )
+   {
+      s_uTimeLastPeriodicResentCurrentAdaptiveLevel = g_TimeNow;
+      _video_link_adaptive_check_send_to_vehicle(uVehicleId, true);
+   }
+}
+
+// Records the samples of the predictive algorithm, for replaying them with test_adaptive_replay.
+// Only when enabled from the controller developer settings. The file is rotated (to .old) when it gets to the max size.
+
+#define ADAPTIVE_VIDEO_STATS_LOG_MAX_SIZE (4*1024*1024)
+
+void _video_link_adaptive_close_predictive_stats_file()
+{
+   if ( NULL != s_pFileAdaptivePredictiveStats )
+      fclose(s_pFileAdaptivePredictiveStats);
+   s_pFileAdaptivePredictiveStats = NULL;
+}
+
+void _video_link_adaptive_record_predictive_sample(type_adaptive_predictive_sample* pSample, int iLevel)
+{
+   if ( (NULL == g_pControllerSettings) || (0 == g_pControllerSettings->iDevLogAdaptiveVideoStats) )
+   {
+      _video_link_adaptive_close_predictive_stats_file();
+      return;
+   }
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   strcpy(szFile, FOLDER_LOGS);
+   strcat(szFile, LOG_FILE_ADAPTIVE_VIDEO_STATS);
+
+   if ( (NULL != s_pFileAdaptivePredictiveStats) && (ftell(s_pFileAdaptivePredictiveStats) >= ADAPTIVE_VIDEO_STATS_LOG_MAX_SIZE) )
+   {
+      fclose(s_pFileAdaptivePredictiveStats);
+      s_pFileAdaptivePredictiveStats = NULL;
+      char szFileOld[MAX_FILE_PATH_SIZE+8];
+      snprintf(szFileOld, sizeof(szFileOld)/sizeof(szFileOld[0]), "%s.old", szFile);
+      rename(szFile, szFileOld);
+      log_line("Adaptive video: rotated link stats file %s", szFile);
+   }
+   if ( NULL == s_pFileAdaptivePredictiveStats )
+   {
+      s_pFileAdaptivePredictiveStats = fopen(szFile, "a");
+      if ( NULL == s_pFileAdaptivePredictiveStats )
+         return;
+      log_line("Adaptive video: recording link stats to %s", szFile);
+   }
+   fprintf(s_pFileAdaptivePredictiveStats, "%u,%d,%d,%d,%d,%d,%d,%d,%d\n",
+      pSample->uTimeMs, pSample->iRxQuality, pSample->iDbm,
+      pSample->iCleanPackets, pSample->iReconstructedPackets, pSample->iMissingPackets,
+      pSample->iMaxECUsed, pSample->iRetransmissionRequests, iLevel);
+}
+
+// Predictive algorithm (VIDEO_FLAG_NEW_ADAPTIVE_ALGORITHM): picks the level from the estimated and predicted link loss.
+// See video_link_adaptive_predictive.cpp
+void _video_link_adaptive_predictive_check_adjust_video_params(u32 uVehicleId)
+{
+   Model* pModel = findModelWithId(uVehicleId, 145);
    if ( NULL == pModel )
       return;
 
@@ -173,15 +242,98 @@ void _video_link_adaptive_check_adjust_video_params(u32 uVehicleId)
    if ( ! isAdaptiveVideoOn )
       return;
 
-   _video_link_adaptive_check_send_to_vehicle(uVehicleId, false);
+   _video_link_adaptive_check_send_and_resend(pModel, uVehicleId);
 
-   static u32 s_uTimeLastPeriodicResentCurrentAdaptiveLevel = 0;
-   if ( ! pModel->isVideoLinkFixedOneWay() )
-   if ( g_TimeNow > s_uTimeLastPeriodicResentCurrentAdaptiveLevel + 5000 )
+   int iVehicleIndex = getVehicleRuntimeIndex(uVehicleId);
+   if ( -1 == iVehicleIndex )
+      return;
+
+   shared_mem_controller_adaptive_video_info_vehicle* pAdaptiveInfo = &(g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[iVehicleIndex]);
+   if ( g_TimeNow < pAdaptiveInfo->uTimeLastLevelShiftDown + 50 )
+      return;
+   if ( g_TimeNow < pAdaptiveInfo->uTimeLastLevelShiftUp + 50 )
+      return;
+
+   int iLevelsHQ = pModel->get_video_profile_total_levels(pModel->video_params.user_selected_video_link_profile);
+   int iLevelsMQ = pModel->get_video_profile_total_levels(VIDEO_PROFILE_MQ);
+   int iLevelsLQ = pModel->get_video_profile_total_levels(VIDEO_PROFILE_LQ);
+   int iMaxLevels = iLevelsHQ + iLevelsMQ;
+   if ( ! (pModel->video_link_profiles[pModel->video_params.user_selected_video_link_profile].uProfileEncodingFlags & VIDEO_PROFILE_ENCODING_FLAG_USE_MEDIUM_ADAPTIVE_VIDEO) )
+      iMaxLevels += iLevelsLQ;
+   if ( iMaxLevels > ADAPTIVE_PREDICTIVE_MAX_LEVELS )
+      iMaxLevels = ADAPTIVE_PREDICTIVE_MAX_LEVELS;
+
+   type_adaptive_predictive_level levels[ADAPTIVE_PREDICTIVE_MAX_LEVELS];
+   for( int i=0; i<iMaxLevels; i++ )
    {
-      s_uTimeLastPeriodicResentCurrentAdaptiveLevel = g_TimeNow;
-      _video_link_adaptive_check_send_to_vehicle(uVehicleId, true);
+      pModel->get_level_shift_ec_scheme(i, &levels[i].iDataPackets, &levels[i].iECPackets);
+      if ( i < iLevelsHQ )
+         levels[i].iProfileStep = 0;
+      else if ( i < iLevelsHQ + iLevelsMQ )
+         levels[i].iProfileStep = 1;
+      else
+         levels[i].iProfileStep = 2;
+   }
+
+   type_adaptive_predictive_state* pState = &s_AdaptivePredictiveState[iVehicleIndex];
+   if ( s_uAdaptivePredictiveVehicleId[iVehicleIndex] != uVehicleId )
+   {
+      s_uAdaptivePredictiveVehicleId[iVehicleIndex] = uVehicleId;
+      adaptive_predictive_init(pState, pAdaptiveInfo->iCurrentTargetLevelShift, pModel->video_params.videoAdjustmentStrength);
    }
+   pState->iStrength = pModel->video_params.videoAdjustmentStrength;
+   adaptive_predictive_set_levels(pState, levels, iMaxLevels);
+   if ( pState->iCurrentLevel != pAdaptiveInfo->iCurrentTargetLevelShift )
+      adaptive_predictive_set_current_level(pState, pAdaptiveInfo->iCurrentTargetLevelShift);
+
+   // Use the last complete interval (current one is still being updated)
+   int iIndex = pAdaptiveInfo->iCurrentIntervalIndex - 1;
+   if ( iIndex < 0 )
+      iIndex = MAX_CONTROLLER_ADAPTIVE_VIDEO_INFO_INTERVALS-1;
+
+   type_adaptive_predictive_sample sample;
+   sample.uTimeMs = g_TimeNow;
+   sample.iRxQuality = -1;
+   sample.iDbm = 0;
+   for( int i=0; i<g_SM_RadioStats.countLocalRadioInterfaces; i++ )
+   {
+      if ( g_SM_RadioStats.radio_interfaces[i].timeLastRxPacket + 500 < g_TimeNow )
+         continue;
+      if ( g_SM_RadioStats.radio_interfaces[i].rxQuality > sample.iRxQuality )
+         sample.iRxQuality = g_SM_RadioStats.radio_interfaces[i].rxQuality;
+      if ( g_SM_RadioStats.radio_interfaces[i].lastDbmVideo < 0 )
+      if ( (0 == sample.iDbm) || (g_SM_RadioStats.radio_interfaces[i].lastDbmVideo > sample.iDbm) )
+         sample.iDbm = g_SM_RadioStats.radio_interfaces[i].lastDbmVideo;
+   }
+   sample.iCleanPackets = pAdaptiveInfo->uIntervalsOuputCleanVideoPackets[iIndex];
+   sample.iReconstructedPackets = pAdaptiveInfo->uIntervalsOuputRecontructedVideoPackets[iIndex];
+   sample.iMissingPackets = pAdaptiveInfo->uIntervalsMissingVideoPackets[iIndex];
+   sample.iRetransmissionRequests = pAdaptiveInfo->uIntervalsRequestedRetransmissions[iIndex];
+   sample.iMaxECUsed = g_PD_ControllerLinkStats.video_streams_blocks_max_ec_packets_used[0][0];
+
+   int iLevel = adaptive_predictive_add_sample(pState, &sample);
+   _video_link_adaptive_record_predictive_sample(&sample, iLevel);
+
+   pAdaptiveInfo->uIntervalsAdaptive3 = ((u32)(pState->fPredictedLoss*1000.0)) | (((u32)pState->iTargetLevel) << 16);
+
+   if ( iLevel > pAdaptiveInfo->iCurrentTargetLevelShift )
+      pAdaptiveInfo->uTimeLastLevelShiftDown = g_TimeNow;
+   else if ( iLevel < pAdaptiveInfo->iCurrentTargetLevelShift )
+      pAdaptiveInfo->uTimeLastLevelShiftUp = g_TimeNow;
+   pAdaptiveInfo->iCurrentTargetLevelShift = iLevel;
+}
+
+void _video_link_adaptive_check_adjust_video_params(u32 uVehicleId)
+{
+   Model* pModel = findModelWithId(uVehicleId, 143);
+   if ( NULL == pModel )
+      return;
+
+   int isAdaptiveVideoOn = ((pModel->video_link_profiles[pModel->video_params.user_selected_video_link_profile].uProfileEncodingFlags) & VIDEO_PROFILE_ENCODING_FLAG_ENABLE_ADAPTIVE_VIDEO_LINK)?1:0;
+   if ( ! isAdaptiveVideoOn )
+      return;
+
+   _video_link_adaptive_check_send_and_resend(pModel, uVehicleId);
 
    int iVehicleIndex = getVehicleRuntimeIndex(uVehicleId);
    if ( -1 == iVehicleIndex )
@@ -604,7 +756,15 @@ void video_link_adaptive_periodic_loop()
       else if ( isAdaptiveVideoOn )
       {
          if ( g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[i].iCurrentTargetLevelShift != -1 )
-            _video_link_adaptive_check_adjust_video_params(g_State.vehiclesRuntimeInfo[i].uVehicleId);
+         {
+            if ( pModel->video_params.uVideoExtraFlags & VIDEO_FLAG_NEW_ADAPTIVE_ALGORITHM )
+               _video_link_adaptive_predictive_check_adjust_video_params(g_State.vehiclesRuntimeInfo[i].uVehicleId);
+            else
+            {
+               _video_link_adaptive_close_predictive_stats_file();
+               _video_link_adaptive_check_adjust_video_params(g_State.vehiclesRuntimeInfo[i].uVehicleId);
+            }
+         }
       }
    }
 }
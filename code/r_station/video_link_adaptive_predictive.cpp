@@ -0,0 +1,275 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../base/base.h"
+#include "../base/config_video.h"
+#include "video_link_adaptive_predictive.h"
+
+// How far ahead (ms) to predict the link: time for a level change to reach the vehicle and take effect
+#define ADAPTIVE_PREDICTIVE_HORIZON_MS 400
+// Extra latency added by a video frame that needs retransmissions
+#define ADAPTIVE_PREDICTIVE_RETRANSMISSION_COST_MS 40
+#define ADAPTIVE_PREDICTIVE_BLOCKS_PER_FRAME 4
+// Each video profile step down (lower radio datarate) is expected to halve the packet loss
+#define ADAPTIVE_PREDICTIVE_PROFILE_STEP_LOSS_FACTOR 0.5
+// Signal drop (dB) that doubles the packet loss
+#define ADAPTIVE_PREDICTIVE_DBM_LOSS_DOUBLING 6.0
+
+void adaptive_predictive_init(type_adaptive_predictive_state* pState, int iCurrentLevel, int iStrength)
+{
+   if ( NULL == pState )
+      return;
+   memset(pState, 0, sizeof(type_adaptive_predictive_state));
+   pState->iCurrentLevel = iCurrentLevel;
+   pState->iTargetLevel = iCurrentLevel;
+   pState->iStrength = iStrength;
+   if ( pState->iStrength < 1 )
+      pState->iStrength = 1;
+   if ( pState->iStrength > 10 )
+      pState->iStrength = 10;
+}
+
+void adaptive_predictive_set_levels(type_adaptive_predictive_state* pState, type_adaptive_predictive_level* pLevels, int iLevelsCount)
+{
+   if ( (NULL == pState) || (NULL == pLevels) )
+      return;
+   if ( iLevelsCount > ADAPTIVE_PREDICTIVE_MAX_LEVELS )
+      iLevelsCount = ADAPTIVE_PREDICTIVE_MAX_LEVELS;
+   if ( iLevelsCount < 0 )
+      iLevelsCount = 0;
+   memcpy(pState->levels, pLevels, iLevelsCount * sizeof(type_adaptive_predictive_level));
+   pState->iLevelsCount = iLevelsCount;
+   if ( pState->iCurrentLevel >= iLevelsCount )
+      pState->iCurrentLevel = iLevelsCount-1;
+   if ( pState->iCurrentLevel < 0 )
+      pState->iCurrentLevel = 0;
+}
+
+void adaptive_predictive_set_current_level(type_adaptive_predictive_state* pState, int iCurrentLevel)
+{
+   if ( NULL == pState )
+      return;
+   pState->iCurrentLevel = iCurrentLevel;
+   pState->uTimeStartGoodIntervalForShiftUp = 0;
+}
+
+float adaptive_predictive_get_block_failure_probability(int iData, int iEC, float fLoss)
+{
+   if ( fLoss <= 0.0 )
+      return 0.0;
+   if ( fLoss >= 1.0 )
+      return 1.0;
+   if ( iData < 1 )
+      return 0.0;
+   if ( iEC < 0 )
+      iEC = 0;
+
+   // Binomial: block is rebuilt if at most iEC packets out of iData+iEC are lost
+   int n = iData + iEC;
+   double dTerm = 1.0;
+   for( int i=0; i<n; i++ )
+      dTerm *= (1.0 - fLoss);
+   double dSum = dTerm;
+   for( int k=1; k<=iEC; k++ )
+   {
+      dTerm = dTerm * (double)(n-k+1) / (double)k * fLoss / (1.0 - fLoss);
+      dSum += dTerm;
+   }
+   if ( dSum > 1.0 )
+      dSum = 1.0;
+   return (float)(1.0 - dSum);
+}
+
+// Least squares slope of the trend samples, in units per second
+static float _adaptive_predictive_get_trend_slope(type_adaptive_predictive_state* pState, int* pValues)
+{
+   if ( pState->iTrendCount < 3 )
+      return 0.0;
+
+   double dSumT = 0, dSumV = 0, dSumTT = 0, dSumTV = 0;
+   u32 uTimeRef = pState->uTrendTime[pState->iTrendIndex % pState->iTrendCount];
+   for( int i=0; i<pState->iTrendCount; i++ )
+   {
+      double t = (double)((int)(pState->uTrendTime[i] - uTimeRef))/1000.0;
+      double v = (double)pValues[i];
+      dSumT += t;
+      dSumV += v;
+      dSumTT += t*t;
+      dSumTV += t*v;
+   }
+   double n = (double)pState->iTrendCount;
+   double dDiv = n*dSumTT - dSumT*dSumT;
+   if ( dDiv < 0.000001 )
+      return 0.0;
+   return (float)((n*dSumTV - dSumT*dSumV)/dDiv);
+}
+
+static float _adaptive_predictive_get_level_latency_ms(type_adaptive_predictive_state* pState, int iLevel, float fLossAtCurrentLevel)
+{
+   type_adaptive_predictive_level* pLevel = &pState->levels[iLevel];
+   float fLoss = fLossAtCurrentLevel;
+   int iSteps = pLevel->iProfileStep - pState->levels[pState->iCurrentLevel].iProfileStep;
+   for( ; iSteps > 0; iSteps-- )
+      fLoss *= ADAPTIVE_PREDICTIVE_PROFILE_STEP_LOSS_FACTOR;
+   for( ; iSteps < 0; iSteps++ )
+      fLoss /= ADAPTIVE_PREDICTIVE_PROFILE_STEP_LOSS_FACTOR;
+   if ( fLoss > 0.95 )
+      fLoss = 0.95;
+
+   float fBlockFailure = adaptive_predictive_get_block_failure_probability(pLevel->iDataPackets, pLevel->iECPackets, fLoss);
+   float fFrameOk = 1.0;
+   for( int i=0; i<ADAPTIVE_PREDICTIVE_BLOCKS_PER_FRAME; i++ )
+      fFrameOk *= (1.0 - fBlockFailure);
+   return (1.0 - fFrameOk) * ADAPTIVE_PREDICTIVE_RETRANSMISSION_COST_MS;
+}
+
+// Returns the best quality level (lowest index) that keeps the predicted extra latency under the bound
+static int _adaptive_predictive_find_level(type_adaptive_predictive_state* pState, float fLoss, float fMaxLatencyMs, int iMinLevel)
+{
+   for( int i=iMinLevel; i<pState->iLevelsCount; i++ )
+   {
+      if ( _adaptive_predictive_get_level_latency_ms(pState, i, fLoss) <= fMaxLatencyMs )
+         return i;
+   }
+   return pState->iLevelsCount-1;
+}
+
+int adaptive_predictive_add_sample(type_adaptive_predictive_state* pState, type_adaptive_predictive_sample* pSample)
+{
+   if ( (NULL == pState) || (NULL == pSample) || (pState->iLevelsCount <= 0) )
+      return 0;
+
+   // Update estimators
+
+   int iTotal = pSample->iCleanPackets + pSample->iReconstructedPackets + pSample->iMissingPackets;
+   if ( iTotal > 0 )
+   {
+      float fLoss = (float)(pSample->iReconstructedPackets + pSample->iMissingPackets) / (float)iTotal;
+      // Max EC packets used in a block shows how bursty the losses are. It only slows down the shift up
+      // (slow estimate), as a single bad block is not a reason to go down.
+      type_adaptive_predictive_level* pCurrent = &pState->levels[pState->iCurrentLevel];
+      float fBurstLoss = 0.5 * (float)pSample->iMaxECUsed / (float)(pCurrent->iDataPackets + pCurrent->iECPackets);
+      if ( fBurstLoss < fLoss )
+         fBurstLoss = fLoss;
+      pState->fLossFast = 0.5 * pState->fLossFast + 0.5 * fLoss;
+      pState->fLossSlow = 0.9 * pState->fLossSlow + 0.1 * fBurstLoss;
+   }
+   pState->fRetransmissionsRate = 0.7 * pState->fRetransmissionsRate + 0.3 * (float)pSample->iRetransmissionRequests;
+
+   if ( pSample->iRxQuality >= 0 )
+   {
+      if ( pState->iTrendCount < ADAPTIVE_PREDICTIVE_TREND_SAMPLES )
+      {
+         pState->iTrendIndex = pState->iTrendCount;
+         pState->iTrendCount++;
+      }
+      else
+         pState->iTrendIndex = (pState->iTrendIndex + 1) % ADAPTIVE_PREDICTIVE_TREND_SAMPLES;
+      pState->iTrendQuality[pState->iTrendIndex] = pSample->iRxQuality;
+      pState->iTrendDbm[pState->iTrendIndex] = pSample->iDbm;
+      pState->uTrendTime[pState->iTrendIndex] = pSample->uTimeMs;
+   }
+
+   // Predict the loss at the horizon: the worst of the fast estimate and the radio link trend
+
+   float fPredictedLoss = pState->fLossFast;
+   if ( pState->iTrendCount >= 3 )
+   {
+      float fHorizon = (float)ADAPTIVE_PREDICTIVE_HORIZON_MS / 1000.0;
+      float fQuality = (float)pState->iTrendQuality[pState->iTrendIndex] + _adaptive_predictive_get_trend_slope(pState, pState->iTrendQuality) * fHorizon;
+      if ( fQuality < 0.0 )
+         fQuality = 0.0;
+      if ( fQuality < 100.0 )
+      if ( 1.0 - fQuality/100.0 > fPredictedLoss )
+         fPredictedLoss = 1.0 - fQuality/100.0;
+
+      if ( pSample->iDbm < 0 )
+      {
+         float fDbmDrop = -_adaptive_predictive_get_trend_slope(pState, pState->iTrendDbm) * fHorizon;
+         float fLoss = pState->fLossFast;
+         for( ; fDbmDrop >= ADAPTIVE_PREDICTIVE_DBM_LOSS_DOUBLING; fDbmDrop -= ADAPTIVE_PREDICTIVE_DBM_LOSS_DOUBLING )
+            fLoss *= 2.0;
+         if ( fLoss > fPredictedLoss )
+            fPredictedLoss = fLoss;
+      }
+   }
+   if ( fPredictedLoss > 0.95 )
+      fPredictedLoss = 0.95;
+   pState->fPredictedLoss = fPredictedLoss;
+
+   // Latency bound: higher adjustment strength means lower accepted extra latency (more protective)
+   float fMaxLatencyMs = 0.3 * (float)(11 - pState->iStrength);
+
+   // Frequent retransmissions mean the current level is not enough, whatever the estimate says
+   int iMinLevel = 0;
+   if ( pState->fRetransmissionsRate > 1.0 )
+      iMinLevel = pState->iCurrentLevel + 1;
+   if ( iMinLevel >= pState->iLevelsCount )
+      iMinLevel = pState->iLevelsCount-1;
+
+   int iTarget = _adaptive_predictive_find_level(pState, fPredictedLoss, fMaxLatencyMs, iMinLevel);
+   pState->iTargetLevel = iTarget;
+
+   // Go down right away, as far as needed
+   if ( iTarget > pState->iCurrentLevel )
+   {
+      pState->iCurrentLevel = iTarget;
+      pState->uTimeLastShiftDown = pSample->uTimeMs;
+      pState->uTimeStartGoodIntervalForShiftUp = 0;
+      return pState->iCurrentLevel;
+   }
+
+   // Go up one level at a time, only when the conservative estimate (slow average, half the latency bound)
+   // says so for a while. This keeps it from oscillating between levels.
+   float fConservativeLoss = fPredictedLoss;
+   if ( pState->fLossSlow > fConservativeLoss )
+      fConservativeLoss = pState->fLossSlow;
+   int iTargetUp = _adaptive_predictive_find_level(pState, fConservativeLoss, fMaxLatencyMs*0.5, iMinLevel);
+
+   if ( iTargetUp >= pState->iCurrentLevel )
+   {
+      pState->uTimeStartGoodIntervalForShiftUp = 0;
+      return pState->iCurrentLevel;
+   }
+
+   u32 uHoldTime = DEFAULT_MINIMUM_OK_INTERVAL_MS_TO_SWITCH_VIDEO_PROFILE_UP;
+   if ( 0 == pState->uTimeStartGoodIntervalForShiftUp )
+      pState->uTimeStartGoodIntervalForShiftUp = pSample->uTimeMs;
+   if ( pSample->uTimeMs < pState->uTimeStartGoodIntervalForShiftUp + uHoldTime )
+      return pState->iCurrentLevel;
+   if ( pSample->uTimeMs < pState->uTimeLastShiftDown + uHoldTime )
+      return pState->iCurrentLevel;
+
+   pState->iCurrentLevel--;
+   pState->uTimeLastShiftUp = pSample->uTimeMs;
+   pState->uTimeStartGoodIntervalForShiftUp = 0;
+   return pState->iCurrentLevel;
+}
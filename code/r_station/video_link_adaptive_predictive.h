@@ -0,0 +1,64 @@
+#pragma once
+#include "../base/base.h"
+
+// Predictive adaptive video: estimates the link loss from the video stream stats and the radio link trend
+// and picks the adaptive video level (EC scheme, video profile, radio datarate and video bitrate) that is predicted
+// to keep the extra latency from retransmissions under a bound. Does not depend on the runtime state,
+// so it can be replayed from recorded link stats.
+
+#define ADAPTIVE_PREDICTIVE_MAX_LEVELS 64
+#define ADAPTIVE_PREDICTIVE_TREND_SAMPLES 8
+
+typedef struct
+{
+   int iDataPackets;
+   int iECPackets;
+   int iProfileStep; // 0: user selected profile, 1: MQ, 2: LQ. Each step uses a lower (more robust) radio datarate and video bitrate
+} type_adaptive_predictive_level;
+
+typedef struct
+{
+   u32 uTimeMs;
+   int iRxQuality; // Best rx quality of the radio interfaces, 0...100, or -1 if unknown
+   int iDbm; // Best video dBm of the radio interfaces, or 0 if unknown
+   int iCleanPackets;
+   int iReconstructedPackets;
+   int iMissingPackets;
+   int iMaxECUsed; // Max EC packets used in a block
+   int iRetransmissionRequests;
+} type_adaptive_predictive_sample;
+
+typedef struct
+{
+   type_adaptive_predictive_level levels[ADAPTIVE_PREDICTIVE_MAX_LEVELS];
+   int iLevelsCount;
+   int iStrength; // 1...10, same as video_params.videoAdjustmentStrength
+
+   float fLossFast;
+   float fLossSlow;
+   float fRetransmissionsRate; // Average retransmission requests per sample
+   int iTrendQuality[ADAPTIVE_PREDICTIVE_TREND_SAMPLES];
+   int iTrendDbm[ADAPTIVE_PREDICTIVE_TREND_SAMPLES];
+   u32 uTrendTime[ADAPTIVE_PREDICTIVE_TREND_SAMPLES];
+   int iTrendCount;
+   int iTrendIndex;
+
+   int iCurrentLevel;
+   u32 uTimeLastShiftDown;
+   u32 uTimeLastShiftUp;
+   u32 uTimeStartGoodIntervalForShiftUp;
+
+   // Last computed values, for debug/stats
+   float fPredictedLoss;
+   int iTargetLevel;
+} type_adaptive_predictive_state;
+
+void adaptive_predictive_init(type_adaptive_predictive_state* pState, int iCurrentLevel, int iStrength);
+void adaptive_predictive_set_levels(type_adaptive_predictive_state* pState, type_adaptive_predictive_level* pLevels, int iLevelsCount);
+void adaptive_predictive_set_current_level(type_adaptive_predictive_state* pState, int iCurrentLevel);
+
+// Adds a new stats sample and returns the level to be used
+int adaptive_predictive_add_sample(type_adaptive_predictive_state* pState, type_adaptive_predictive_sample* pSample);
+
+// Probability that a block of iData + iEC packets can't be rebuilt, when each packet is lost with probability fLoss
+float adaptive_predictive_get_block_failure_probability(int iData, int iEC, float fLoss);
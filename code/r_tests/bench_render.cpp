@@ -0,0 +1,579 @@
+#include "../base/base.h"
+#include "../base/config.h"
+#include "../base/hardware.h"
+#include "../base/models.h"
+#include "../base/ctrl_settings.h"
+#include "../base/ctrl_preferences.h"
+#include "../renderer/render_engine_mem.h"
+#include "../renderer/render_kernels.h"
+#include "../r_central/ruby_central.h"
+#include "../r_central/shared_vars.h"
+#include "../r_central/shared_vars_state.h"
+#include "../r_central/shared_vars_ipc.h"
+#include "../r_central/timers.h"
+#include "../r_central/fonts.h"
+#include "../r_central/popup.h"
+#include "../r_central/osd/osd.h"
+#include "../r_central/osd/osd_common.h"
+#include "../r_central/menu/menu.h"
+#include "../r_central/menu/menu_root.h"
+#include "../r_central/menu/menu_vehicle_video.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// Renders the real UI (OSD, stats panels, menus) of ruby_central with the headless (memory) render engine
+// of the platform: raw engine on Pi, Cairo engine on Radxa. The UI reads synthetic vehicle telemetry and
+// shared memory stats, updated on each frame. No display, DRM device or router is used.
+// Run it from the Ruby folder (it loads the fonts and icons from the res folder, and the controller settings).
+// Also measures the cost of the drawing primitives of the engine. Can save the last frame of each scene as PNG.
+
+// Not exported by ruby_central.cpp and pairing.cpp headers
+void load_resources();
+extern bool s_isRXStarted;
+
+#define BENCH_VEHICLE_ID 0x42454E43
+
+typedef struct
+{
+   const char* szName;
+   void (*pFunction)(int iIndex);
+   int iCallsPerFrame;
+} type_bench_primitive;
+
+typedef struct
+{
+   const char* szName;
+   void (*pPrepare)();
+   void (*pRender)();
+} type_bench_scene;
+
+static u32 s_uFrame = 0;
+static u32* s_pBitmap = NULL;
+static int s_iBitmapWidth = 256;
+static int s_iBitmapHeight = 128;
+static u32 s_uLayoutFlags[3];
+
+static double s_ColorText[4] = {255,255,255,1.0};
+
+// Synthetic data, as received from the router and the vehicle: slow oscillations plus noise
+
+static u32 _to_fc_offset_value(float fValue, float fOffset)
+{
+   return (u32)((fValue + fOffset)*100.0);
+}
+
+void _update_synthetic_data()
+{
+   s_uFrame++;
+   float t = s_uFrame * 0.04;
+   g_TimeNow = get_current_timestamp_ms();
+   g_TimeNowMicros = get_current_timestamp_micros();
+
+   t_structure_vehicle_info* pRI = &g_VehiclesRuntimeInfo[0];
+   pRI->uTimeLastRecvFCTelemetry = g_TimeNow;
+   pRI->uTimeLastRecvFCTelemetryFull = g_TimeNow;
+   pRI->uTimeLastRecvRubyTelemetry = g_TimeNow;
+   pRI->uTimeLastRecvRubyTelemetryExtended = g_TimeNow;
+   pRI->uTimeLastRecvAnyRubyTelemetry = g_TimeNow;
+   pRI->uTimeLastRecvVehicleRxStats = g_TimeNow;
+
+   t_packet_header_fc_telemetry* pFC = &pRI->headerFCTelemetry;
+   pFC->altitude = _to_fc_offset_value(120.0 + 40.0*sin(t*0.3), 1000.0);
+   pFC->altitude_abs = _to_fc_offset_value(320.0 + 40.0*sin(t*0.3), 1000.0);
+   pFC->vspeed = _to_fc_offset_value(12.0*cos(t*0.3), 1000.0);
+   pFC->hspeed = _to_fc_offset_value(15.0 + 5.0*sin(t*0.7), 1000.0);
+   pFC->aspeed = _to_fc_offset_value(16.0 + 5.0*sin(t*0.7), 1000.0);
+   pFC->roll = _to_fc_offset_value(25.0*sin(t*0.35), 180.0);
+   pFC->pitch = _to_fc_offset_value(10.0*sin(t*0.5), 180.0);
+   pFC->heading = ((int)(t*10.0)) % 360;
+   pFC->distance = (u32)(100.0*(800.0 + 300.0*sin(t*0.1)));
+   pFC->total_distance = s_uFrame * 50;
+   pFC->voltage = 16400 - (s_uFrame % 2000);
+   pFC->current = (u16)(1000.0*(12.0 + 3.0*sin(t)));
+   pFC->mah = s_uFrame/10;
+   pFC->throttle = 40 + (s_uFrame/5) % 30;
+   pFC->arm_time = s_uFrame/25;
+   pFC->satelites = 14;
+   pFC->gps_fix_type = 3;
+   pFC->hdop = 90;
+   pFC->latitude = 473977420 + (int)(2000.0*sin(t*0.1));
+   pFC->longitude = 85455940 + (int)(2000.0*cos(t*0.1));
+   pFC->temperature = 100 + 35;
+   pFC->rc_rssi = 70 + rand()%20;
+   pFC->extra_info[5]++;
+
+   t_packet_header_ruby_telemetry_extended_v3* pRT = &pRI->headerRubyTelemetryExtended;
+   pRT->uVehicleId = BENCH_VEHICLE_ID;
+   pRT->downlink_tx_video_bitrate_bps = 6000000 + rand()%3000000;
+   pRT->downlink_tx_video_all_bitrate_bps = pRT->downlink_tx_video_bitrate_bps*5/4;
+   pRT->downlink_tx_data_bitrate_bps = 20000 + rand()%5000;
+   pRT->downlink_tx_video_packets_per_sec = 700 + rand()%200;
+   pRT->downlink_tx_data_packets_per_sec = 40 + rand()%10;
+   pRT->temperature = 55 + rand()%5;
+   pRT->cpu_load = 30 + rand()%20;
+   pRT->cpu_mhz = 1200;
+   pRT->txTimePerSec = 300 + rand()%100;
+
+   for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+   {
+      pRT->uplink_rssi_dbm[i] = 200 - 50 - rand()%30;
+      pRT->uplink_link_quality[i] = 70 + rand()%30;
+
+      shared_mem_radio_stats_radio_interface* pRadio = &g_SM_RadioStats.radio_interfaces[i];
+      pRadio->assignedLocalRadioLinkId = 0;
+      pRadio->assignedVehicleRadioLinkId = 0;
+      pRadio->openedForRead = 1;
+      pRadio->openedForWrite = 1;
+      pRadio->lastDbm = -50 - rand()%30;
+      pRadio->lastDbmVideo = pRadio->lastDbm;
+      pRadio->lastDbmData = pRadio->lastDbm - 2;
+      pRadio->lastRecvDataRate = -3;
+      pRadio->lastRecvDataRateVideo = -3;
+      pRadio->lastRecvDataRateData = 6000000;
+      pRadio->rxQuality = 70 + rand()%30;
+      pRadio->rxRelativeQuality = pRadio->rxQuality;
+      pRadio->rxPacketsPerSec = 700 + rand()%200;
+      pRadio->rxBytesPerSec = pRadio->rxPacketsPerSec * 1100;
+      pRadio->totalRxPackets += pRadio->rxPacketsPerSec/25;
+      pRadio->timeLastRxPacket = g_TimeNow;
+      pRadio->timeNow = g_TimeNow;
+      int iSlice = s_uFrame % MAX_HISTORY_RADIO_STATS_RECV_SLICES;
+      pRadio->hist_rxPacketsCount[iSlice] = 20 + rand()%20;
+      pRadio->hist_rxPacketsBadCount[iSlice] = ((rand()%10) == 0)?1:0;
+      pRadio->hist_rxPacketsLostCount[iSlice] = ((rand()%8) == 0)?(1+rand()%3):0;
+      pRadio->hist_rxGapMiliseconds[iSlice] = 2 + rand()%10;
+      pRadio->uSlicesUpdated = 1;
+
+      iSlice = s_uFrame % MAX_RX_GRAPH_SLICES;
+      g_SM_RadioStatsInterfaceRxGraph.interfaces[i].rxPackets[iSlice] = 20 + rand()%20;
+      g_SM_RadioStatsInterfaceRxGraph.interfaces[i].rxPacketsBad[iSlice] = ((rand()%10) == 0)?1:0;
+      g_SM_RadioStatsInterfaceRxGraph.interfaces[i].rxPacketsLost[iSlice] = ((rand()%8) == 0)?1:0;
+      g_SM_RadioStatsInterfaceRxGraph.interfaces[i].rxGapMiliseconds[iSlice] = 2 + rand()%10;
+
+      shared_mem_radio_stats_interface_rx_hist* pHist = &g_SM_HistoryRxStats.interfaces_history[i];
+      pHist->iCurrentSlice = s_uFrame % MAX_RADIO_STATS_INTERFACE_RX_HISTORY_SLICES;
+      pHist->uHistPacketsTypes[pHist->iCurrentSlice] = ((s_uFrame % 25) == 0)?0xFF:PACKET_TYPE_VIDEO_DATA_FULL;
+      pHist->uHistPacketsCount[pHist->iCurrentSlice] = 1 + rand()%8;
+      pHist->uTimeLastUpdate = g_TimeNow;
+
+      memcpy(&pRI->SMVehicleRxStats[i], pRadio, sizeof(shared_mem_radio_stats_radio_interface));
+   }
+   g_SM_RadioStatsInterfaceRxGraph.iCurrentSlice = s_uFrame % MAX_RX_GRAPH_SLICES;
+   g_SM_RadioStats.radio_links[0].rxPacketsPerSec = g_SM_RadioStats.radio_interfaces[0].rxPacketsPerSec;
+   g_SM_RadioStats.radio_links[0].rxBytesPerSec = g_SM_RadioStats.radio_interfaces[0].rxBytesPerSec;
+   g_SM_RadioStats.radio_links[0].txPacketsPerSec = 30 + rand()%10;
+   g_SM_RadioStats.radio_streams[0][STREAM_ID_VIDEO_1].uVehicleId = BENCH_VEHICLE_ID;
+   g_SM_RadioStats.radio_streams[0][STREAM_ID_VIDEO_1].rxBytesPerSec = pRT->downlink_tx_video_all_bitrate_bps/8;
+   g_SM_RadioStats.radio_streams[0][STREAM_ID_VIDEO_1].rxPacketsPerSec = pRT->downlink_tx_video_packets_per_sec;
+   g_SM_RadioStats.radio_streams[0][STREAM_ID_VIDEO_1].timeLastRxPacket = g_TimeNow;
+   g_SM_RadioStats.timeLastRxPacket = g_TimeNow;
+   g_SM_RadioStats.uTimeLastReceivedAResponseFromVehicle = g_TimeNow;
+
+   shared_mem_video_stream_stats* pVDS = &g_SM_VideoDecodeStats.video_streams[0];
+   pVDS->uVehicleId = BENCH_VEHICLE_ID;
+   pVDS->video_stream_and_type = VIDEO_TYPE_H264 << 4;
+   pVDS->video_link_profile = (VIDEO_PROFILE_HIGH_QUALITY << 4) | VIDEO_PROFILE_HIGH_QUALITY;
+   pVDS->width = 1280;
+   pVDS->height = 720;
+   pVDS->fps = 60;
+   pVDS->keyframe_ms = 1000;
+   pVDS->data_packets_per_block = 12;
+   pVDS->fec_packets_per_block = 4;
+   pVDS->video_data_length = 1100;
+   pVDS->fec_time = 2000 + rand()%1000;
+   pVDS->uLastSetVideoBitrate = 7000000;
+   pVDS->currentPacketsInBuffers = rand()%40;
+   pVDS->maxPacketsInBuffers = 200;
+   pVDS->total_OutputFramesComplete += 1;
+   if ( (rand()%50) == 0 )
+      pVDS->total_OutputFramesDamaged++;
+
+   shared_mem_video_info_stats* pVIS[2] = { &g_SM_VideoInfoStatsOutput, &g_SM_VideoInfoStatsRadioIn };
+   for( int k=0; k<2; k++ )
+   {
+      pVIS[k]->uLastIndex = s_uFrame;
+      int iIndex = s_uFrame % MAX_FRAMES_SAMPLES;
+      pVIS[k]->uFramesDuration[iIndex] = 15 + rand()%4;
+      if ( (s_uFrame % 60) == 0 )
+         pVIS[k]->uFramesTypesAndSizes[iIndex] = 0x80 | (60 + rand()%30);
+      else
+         pVIS[k]->uFramesTypesAndSizes[iIndex] = 10 + rand()%10;
+      pVIS[k]->uDetectedFPS = 60;
+      pVIS[k]->uDetectedSlices = 1;
+      pVIS[k]->uTimeLastUpdate = g_TimeNow;
+   }
+
+   g_SM_RouterVehiclesRuntimeInfo.uVehiclesIds[0] = BENCH_VEHICLE_ID;
+   g_SM_RouterVehiclesRuntimeInfo.uAverageCommandRoundtripMiliseconds[0] = 8 + rand()%5;
+   g_SM_RouterVehiclesRuntimeInfo.uRadioLinksDelayRoundtripMs[0][0] = 4 + rand()%3;
+   g_SM_RouterVehiclesRuntimeInfo.vehicles_adaptive_video[0].uLastSetVideoBitrate = pVDS->uLastSetVideoBitrate;
+}
+
+void _init_synthetic_vehicle()
+{
+   g_pCurrentModel = new Model();
+   g_pCurrentModel->resetToDefaults(true);
+   g_pCurrentModel->uVehicleId = BENCH_VEHICLE_ID;
+   g_pCurrentModel->is_spectator = false;
+   strcpy(g_pCurrentModel->vehicle_name, "Bench");
+   g_uActiveControllerModelVID = g_pCurrentModel->uVehicleId;
+
+   int iLayout = g_pCurrentModel->osd_params.layout;
+   g_pCurrentModel->osd_params.osd_flags2[iLayout] |= OSD_FLAG2_LAYOUT_ENABLED;
+   s_uLayoutFlags[0] = g_pCurrentModel->osd_params.osd_flags[iLayout];
+   s_uLayoutFlags[1] = g_pCurrentModel->osd_params.osd_flags2[iLayout];
+   s_uLayoutFlags[2] = g_pCurrentModel->osd_params.osd_flags3[iLayout];
+   osd_set_current_layout_index_and_source_model(g_pCurrentModel, iLayout);
+   osd_set_current_data_source_vehicle_index(0);
+
+   t_structure_vehicle_info* pRI = &g_VehiclesRuntimeInfo[0];
+   pRI->uVehicleId = g_pCurrentModel->uVehicleId;
+   pRI->pModel = g_pCurrentModel;
+   pRI->bGotRubyTelemetryInfo = true;
+   pRI->bGotRubyTelemetryExtraInfo = true;
+   pRI->bGotStatsVehicleRxCards = true;
+   pRI->bGotFCTelemetry = true;
+   pRI->bGotFCTelemetryExtra = true;
+   pRI->bFCTelemetrySourcePresent = true;
+   pRI->iFrequencyRubyTelemetryFull = 10;
+   pRI->iFrequencyFCTelemetryFull = 10;
+   pRI->bPairedConfirmed = true;
+   pRI->bIsArmed = true;
+   pRI->bHomeSet = true;
+   pRI->fHomeLat = 47.397742;
+   pRI->fHomeLon = 8.545594;
+   pRI->headerFCTelemetry.flags = FC_TELE_FLAGS_ARMED | FC_TELE_FLAGS_POS_CURRENT | FC_TELE_FLAGS_HAS_ATTITUDE;
+   pRI->headerFCTelemetry.fc_telemetry_type = g_pCurrentModel->telemetry_params.fc_telemetry_type;
+   pRI->headerRubyTelemetryExtended.radio_links_count = g_pCurrentModel->radioLinksParams.links_count;
+   for( int i=0; i<g_pCurrentModel->radioLinksParams.links_count; i++ )
+      pRI->headerRubyTelemetryExtended.uRadioFrequenciesKhz[i] = g_pCurrentModel->radioLinksParams.link_frequency_khz[i];
+   strcpy((char*)pRI->headerRubyTelemetryExtended.vehicle_name, g_pCurrentModel->vehicle_name);
+
+   g_SM_RadioStats.countLocalRadioInterfaces = hardware_get_radio_interfaces_count();
+   g_SM_RadioStats.countLocalRadioLinks = 1;
+   g_SM_RadioStats.countVehicleRadioLinks = g_pCurrentModel->radioLinksParams.links_count;
+   g_SM_RadioStats.refreshIntervalMs = 500;
+   g_SM_RadioStats.graphRefreshIntervalMs = 100;
+   g_SM_RadioStatsInterfaceRxGraph.uTimeSliceDurationMs = 40;
+
+   // As after a completed start sequence and pairing, with the router running
+   s_StartSequence = START_SEQ_COMPLETED;
+   s_isRXStarted = true;
+   g_bIsRouterReady = true;
+   g_RouterIsReadyTimestamp = 0;
+   g_bSearching = false;
+
+   for( int i=0; i<MAX_FRAMES_SAMPLES*2; i++ )
+      _update_synthetic_data();
+}
+
+void _set_layout_flags(u32 uFlags2Add, u32 uFlags3Add)
+{
+   int iLayout = g_pCurrentModel->osd_params.layout;
+   g_pCurrentModel->osd_params.osd_flags[iLayout] = s_uLayoutFlags[0];
+   g_pCurrentModel->osd_params.osd_flags2[iLayout] = s_uLayoutFlags[1] | uFlags2Add;
+   g_pCurrentModel->osd_params.osd_flags3[iLayout] = s_uLayoutFlags[2] | uFlags3Add;
+}
+
+// Primitives
+
+void _bench_rect(int iIndex)
+{
+   g_pRenderEngine->setFill(50,120,200,0.6);
+   g_pRenderEngine->setStroke(255,255,255,0.8);
+   g_pRenderEngine->drawRect(0.05 + 0.002*(iIndex%50), 0.1 + 0.003*(iIndex%40), 0.2, 0.1);
+}
+
+void _bench_small_rect(int iIndex)
+{
+   g_pRenderEngine->setFill(50,200,120,0.8);
+   g_pRenderEngine->setStroke(50,200,120,0.8);
+   g_pRenderEngine->drawRect(0.05 + 0.004*(iIndex%200), 0.5 + 0.001*(iIndex%100), 0.004, 0.05);
+}
+
+void _bench_round_rect(int iIndex)
+{
+   g_pRenderEngine->setFill(0,0,0,0.5);
+   g_pRenderEngine->setStroke(255,255,255,0.5);
+   g_pRenderEngine->drawRoundRect(0.1 + 0.002*(iIndex%50), 0.1, 0.3, 0.3, 0.03);
+}
+
+void _bench_line(int iIndex)
+{
+   g_pRenderEngine->setStroke(255,255,255,1.0);
+   g_pRenderEngine->setStrokeSize(2.0);
+   g_pRenderEngine->drawLine(0.1, 0.1 + 0.005*(iIndex%100), 0.9, 0.4 + 0.003*(iIndex%100));
+}
+
+void _bench_polyline(int iIndex)
+{
+   float x[30];
+   float y[30];
+   for( int i=0; i<30; i++ )
+   {
+      x[i] = 0.1 + 0.02*i;
+      y[i] = 0.5 + 0.1*sin((i+iIndex)*0.3);
+   }
+   g_pRenderEngine->setStroke(255,200,50,1.0);
+   g_pRenderEngine->setStrokeSize(2.0);
+   g_pRenderEngine->drawPolyLine(x, y, 30);
+}
+
+void _bench_triangle(int iIndex)
+{
+   g_pRenderEngine->setFill(255,50,50,0.7);
+   g_pRenderEngine->setStroke(255,50,50,0.7);
+   g_pRenderEngine->fillTriangle(0.5, 0.1 + 0.001*(iIndex%100), 0.45, 0.2, 0.55, 0.2);
+}
+
+void _bench_circle(int iIndex)
+{
+   g_pRenderEngine->setFill(255,255,255,0.7);
+   g_pRenderEngine->setStroke(255,255,255,0.7);
+   g_pRenderEngine->fillCircle(0.3 + 0.001*(iIndex%100), 0.6, 0.03);
+}
+
+void _bench_arc(int iIndex)
+{
+   g_pRenderEngine->setStroke(255,255,255,1.0);
+   g_pRenderEngine->setStrokeSize(2.0);
+   g_pRenderEngine->drawArc(0.5, 0.5, 0.1 + 0.001*(iIndex%50), 20, 160);
+}
+
+void _bench_text_short(int iIndex)
+{
+   char szBuff[32];
+   snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "%.1f m", 120.0 + iIndex);
+   g_pRenderEngine->setColors(s_ColorText);
+   g_pRenderEngine->drawText(0.05 + 0.01*(iIndex%40), 0.05 + 0.02*(iIndex%40), g_idFontOSD, szBuff);
+}
+
+void _bench_text_long(int iIndex)
+{
+   g_pRenderEngine->setColors(s_ColorText);
+   g_pRenderEngine->drawText(0.05, 0.05 + 0.02*(iIndex%40), g_idFontOSD, "Video: H264 1280x720 60fps, 8.2 Mbps, EC 12/4, keyframe 2 sec");
+}
+
+void _bench_text_left(int iIndex)
+{
+   char szBuff[32];
+   snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "%d dBm", -50 - iIndex%30);
+   g_pRenderEngine->setColors(s_ColorText);
+   g_pRenderEngine->drawTextLeft(0.9, 0.05 + 0.02*(iIndex%40), g_idFontOSDSmall, szBuff);
+}
+
+void _bench_message_lines(int iIndex)
+{
+   g_pRenderEngine->setColors(s_ColorText);
+   g_pRenderEngine->drawMessageLines(0.2, 0.2 + 0.01*(iIndex%20), "Sets the radio data rate used for the video stream. Lower data rates have a longer range but a lower maximum video bitrate.", 1.2, 0.3, g_idFontMenu);
+}
+
+void _bench_icon(int iIndex)
+{
+   g_pRenderEngine->drawIcon(0.05 + 0.02*(iIndex%40), 0.9, 0.03/g_pRenderEngine->getAspectRatio(), 0.03, g_idIconInfo);
+}
+
+void _bench_bitmap(int iIndex)
+{
+   g_pRenderEngine->drawBitmap(0.1 + 0.002*(iIndex%100), 0.3, s_pBitmap, s_iBitmapWidth, s_iBitmapHeight);
+}
+
+type_bench_primitive g_Primitives[] =
+{
+   { "rect 0.2x0.1", _bench_rect, 20 },
+   { "rect graph bar", _bench_small_rect, 200 },
+   { "round rect 0.3x0.3", _bench_round_rect, 10 },
+   { "line", _bench_line, 100 },
+   { "polyline 30 points", _bench_polyline, 20 },
+   { "filled triangle", _bench_triangle, 50 },
+   { "filled circle", _bench_circle, 50 },
+   { "arc", _bench_arc, 20 },
+   { "text short", _bench_text_short, 100 },
+   { "text long", _bench_text_long, 40 },
+   { "text right aligned", _bench_text_left, 100 },
+   { "message lines", _bench_message_lines, 10 },
+   { "icon", _bench_icon, 40 },
+   { "bitmap 256x128", _bench_bitmap, 20 },
+};
+
+// Scenes: the same calls as ruby_central render_all(), on the synthetic vehicle
+
+void _prepare_osd()
+{
+   _set_layout_flags(0, 0);
+   menu_discard_all();
+}
+
+void _prepare_stats()
+{
+   _set_layout_flags(OSD_FLAG2_SHOW_STATS_RADIO_LINKS | OSD_FLAG2_SHOW_STATS_RADIO_INTERFACES | OSD_FLAG2_SHOW_STATS_VIDEO | OSD_FLAG2_SHOW_TELEMETRY_STATS,
+      OSD_FLAG3_SHOW_VIDEO_BITRATE_HISTORY | OSD_FLAG3_SHOW_RADIO_RX_HISTORY_CONTROLLER | OSD_FLAG3_SHOW_RADIO_RX_GRAPH_CONTROLLER);
+   menu_discard_all();
+}
+
+void _prepare_menus()
+{
+   menu_discard_all();
+   add_menu_to_stack(new MenuRoot());
+   add_menu_to_stack(new MenuVehicleVideo());
+}
+
+void _prepare_full()
+{
+   _prepare_stats();
+   _prepare_menus();
+}
+
+void _render_osd()
+{
+   osd_render_all();
+}
+
+void _render_menus()
+{
+   menu_render();
+}
+
+type_bench_scene g_Scenes[] =
+{
+   { "osd", _prepare_osd, _render_osd },
+   { "stats", _prepare_stats, _render_osd },
+   { "menus", _prepare_menus, _render_menus },
+   { "full", _prepare_full, NULL },
+};
+
+int main(int argc, char *argv[])
+{
+   int iWidth = 1280;
+   int iHeight = 720;
+   int iFrames = 200;
+   const char* szPNGFolder = NULL;
+
+   for( int i=1; i<argc; i++ )
+   {
+      if ( (0 == strcmp(argv[i], "-size")) && (i+1 < argc) )
+      {
+         if ( 2 != sscanf(argv[++i], "%dx%d", &iWidth, &iHeight) )
+         {
+            printf("\nInvalid size: %s\n", argv[i]);
+            return -1;
+         }
+      }
+      else if ( (0 == strcmp(argv[i], "-frames")) && (i+1 < argc) )
+         iFrames = atoi(argv[++i]);
+      else if ( (0 == strcmp(argv[i], "-png")) && (i+1 < argc) )
+         szPNGFolder = argv[++i];
+      else
+      {
+         printf("\nbench_render [-size WxH] [-frames N] [-png output_folder]\n");
+         return -1;
+      }
+   }
+   if ( iFrames < 1 )
+      iFrames = 1;
+
+   log_init_local_only("BenchRender");
+   log_disable_stdout();
+
+   // Settings are only read: the bench must not change the controller config
+   load_Preferences();
+   load_ControllerSettings();
+   Preferences* p = get_Preferences();
+   Menu::setRenderMode(p->iMenuStyle);
+
+   g_pRenderEngine = render_init_engine_memory(iWidth, iHeight);
+   if ( (NULL == g_pRenderEngine) || (NULL == render_engine_memory_get_frame(NULL)) )
+   {
+      printf("\nFailed to create the render engine.\n");
+      return -1;
+   }
+   load_resources();
+   osd_apply_preferences();
+   menu_init();
+   shared_vars_state_reset_all_vehicles_runtime_info();
+   render_engine_init_lock();
+
+   if ( (0 == g_idFontOSD) || (0 == g_idFontMenu) )
+   {
+      printf("\nFailed to load the fonts. Run it from the Ruby folder.\n");
+      return -1;
+   }
+
+   _init_synthetic_vehicle();
+
+   s_pBitmap = (u32*) malloc(s_iBitmapWidth*s_iBitmapHeight*sizeof(u32));
+   for( int y=0; y<s_iBitmapHeight; y++ )
+   for( int x=0; x<s_iBitmapWidth; x++ )
+      s_pBitmap[y*s_iBitmapWidth+x] = g_pRenderEngine->makeBitmapPixel(x, y*2, 128, ((x/8+y/8)%2)?200:0);
+
+   printf("\nHeadless render benchmark: %d x %d, %d frames, span kernels: %s\n", iWidth, iHeight, iFrames, render_kernels_get_name());
+
+   // Empty frames: buffer clear and flip
+   u32 uTimeStart = get_current_timestamp_micros();
+   for( int i=0; i<iFrames; i++ )
+   {
+      g_pRenderEngine->startFrame();
+      g_pRenderEngine->endFrame();
+   }
+   u32 uTimeEmptyFrame = (get_current_timestamp_micros() - uTimeStart)/iFrames;
+   printf("\nEmpty frame (clear + flip): %u us\n", uTimeEmptyFrame);
+
+   printf("\nPrimitives (us per call):\n");
+   for( int k=0; k<(int)(sizeof(g_Primitives)/sizeof(g_Primitives[0])); k++ )
+   {
+      u32 uTimeTotal = 0;
+      int iCalls = 0;
+      for( int i=0; i<iFrames; i++ )
+      {
+         g_pRenderEngine->startFrame();
+         uTimeStart = get_current_timestamp_micros();
+         for( int n=0; n<g_Primitives[k].iCallsPerFrame; n++ )
+            (*(g_Primitives[k].pFunction))(n);
+         uTimeTotal += get_current_timestamp_micros() - uTimeStart;
+         iCalls += g_Primitives[k].iCallsPerFrame;
+         g_pRenderEngine->endFrame();
+      }
+      printf("  %-22s %8.2f\n", g_Primitives[k].szName, (double)uTimeTotal/(double)iCalls);
+   }
+
+   printf("\nScenes:\n");
+   char szFile[MAX_FILE_PATH_SIZE];
+   for( int s=0; s<(int)(sizeof(g_Scenes)/sizeof(g_Scenes[0])); s++ )
+   {
+      (*(g_Scenes[s].pPrepare))();
+      u32 uTimeMax = 0;
+      u32 uTimeTotal = 0;
+      for( int i=0; i<iFrames; i++ )
+      {
+         _update_synthetic_data();
+         u32 uTimeFrame = get_current_timestamp_micros();
+         if ( NULL == g_Scenes[s].pRender )
+            render_all(g_TimeNow);
+         else
+         {
+            g_pRenderEngine->startFrame();
+            (*(g_Scenes[s].pRender))();
+            g_pRenderEngine->endFrame();
+         }
+         uTimeFrame = get_current_timestamp_micros() - uTimeFrame;
+         uTimeTotal += uTimeFrame;
+         if ( uTimeFrame > uTimeMax )
+            uTimeMax = uTimeFrame;
+      }
+      printf("  %-8s %7.2f ms/frame (max %.2f ms), %6.1f frames/sec\n", g_Scenes[s].szName,
+         (double)uTimeTotal/(double)iFrames/1000.0, uTimeMax/1000.0, 1000000.0*(double)iFrames/(double)(uTimeTotal+1));
+
+      if ( NULL != szPNGFolder )
+      {
+         snprintf(szFile, sizeof(szFile)/sizeof(szFile[0]), "%s/bench_%s.png", szPNGFolder, g_Scenes[s].szName);
+         if ( render_engine_memory_save_png(szFile) )
+            printf("           saved %s\n", szFile);
+      }
+   }
+
+   menu_discard_all();
+   free(s_pBitmap);
+   render_free_engine_memory();
+   return 0;
+}
@@ -0,0 +1,289 @@
+#include "../base/base.h"
+#include "../r_station/video_link_adaptive_predictive.h"
+
+#include <stdlib.h>
+
+// Replays adaptive video link stats recorded by the controller (log_adaptive_video.csv, written when enabled in the controller developer menu
+// when the predictive adaptive video algorithm is used) through the predictive adaptive video algorithm.
+// Prints the level changes and a summary, to compare settings and changes to the algorithm offline.
+// CSV columns: time_ms, rx_quality, dbm, clean, reconstructed, missing, max_ec_used, retransmissions [, recorded level]
+// Run without a stats file (or with -fixtures) it checks the algorithm on built in link scenarios instead,
+// and returns non zero if any check fails.
+
+type_adaptive_predictive_level g_Levels[ADAPTIVE_PREDICTIVE_MAX_LEVELS];
+int g_iLevelsCount = 0;
+
+bool _parse_levels(const char* szLevels)
+{
+   // Format: data/ec/profile_step,data/ec/profile_step,...
+   g_iLevelsCount = 0;
+   const char* p = szLevels;
+   while ( (NULL != p) && (0 != *p) && (g_iLevelsCount < ADAPTIVE_PREDICTIVE_MAX_LEVELS) )
+   {
+      int iData = 0, iEC = 0, iStep = 0;
+      if ( 3 != sscanf(p, "%d/%d/%d", &iData, &iEC, &iStep) )
+         return false;
+      g_Levels[g_iLevelsCount].iDataPackets = iData;
+      g_Levels[g_iLevelsCount].iECPackets = iEC;
+      g_Levels[g_iLevelsCount].iProfileStep = iStep;
+      g_iLevelsCount++;
+      p = strchr(p, ',');
+      if ( NULL != p )
+         p++;
+   }
+   return (g_iLevelsCount > 0);
+}
+
+//----------------------------------------------------------------
+// Built in scenarios
+
+#define FIXTURE_SAMPLE_INTERVAL_MS 40
+#define FIXTURE_PACKETS_PER_SAMPLE 100
+
+typedef struct
+{
+   u32 uTimeMs;
+   int iLevel;
+   int iMaxLevel;
+   int iShiftsDown;
+   int iShiftsUp;
+   int iReversals;
+   int iLastDirection;
+   u32 uTimeLastShift;
+   u32 uTimeFirstShiftDown; // 0 if none
+} t_fixture_run;
+
+static int s_iFixtureChecksFailed = 0;
+static int s_iFixtureChecksCount = 0;
+
+static void _fixture_check(const char* szScenario, const char* szCheck, bool bOk)
+{
+   s_iFixtureChecksCount++;
+   if ( ! bOk )
+      s_iFixtureChecksFailed++;
+   printf("[%s] %s: %s\n", bOk?" OK ":"FAIL", szScenario, szCheck);
+}
+
+static void _fixture_start(type_adaptive_predictive_state* pState, t_fixture_run* pRun, int iStrength)
+{
+   adaptive_predictive_init(pState, 0, iStrength);
+   adaptive_predictive_set_levels(pState, g_Levels, g_iLevelsCount);
+   memset(pRun, 0, sizeof(t_fixture_run));
+   pRun->uTimeMs = 1000;
+}
+
+// Adds samples for iDurationMs with a fixed packet loss (spread evenly, a third of it unrecoverable)
+// and rx quality/dBm changing linearly from the start values to the end values
+static void _fixture_run(type_adaptive_predictive_state* pState, t_fixture_run* pRun, int iDurationMs, float fLoss, int iQualityStart, int iQualityEnd, int iDbmStart, int iDbmEnd)
+{
+   int iSamples = iDurationMs / FIXTURE_SAMPLE_INTERVAL_MS;
+   for( int i=0; i<iSamples; i++ )
+   {
+      type_adaptive_predictive_sample sample;
+      int iLost = (int)(fLoss * FIXTURE_PACKETS_PER_SAMPLE + 0.5);
+      sample.uTimeMs = pRun->uTimeMs;
+      sample.iRxQuality = iQualityStart + (iQualityEnd - iQualityStart) * i / iSamples;
+      sample.iDbm = iDbmStart + (iDbmEnd - iDbmStart) * i / iSamples;
+      sample.iMissingPackets = iLost/3;
+      sample.iReconstructedPackets = iLost - sample.iMissingPackets;
+      sample.iCleanPackets = FIXTURE_PACKETS_PER_SAMPLE - iLost;
+      sample.iMaxECUsed = (iLost > 0)?1:0;
+      sample.iRetransmissionRequests = (sample.iMissingPackets > 0)?1:0;
+
+      int iNewLevel = adaptive_predictive_add_sample(pState, &sample);
+      if ( iNewLevel != pRun->iLevel )
+      {
+         int iDirection = (iNewLevel > pRun->iLevel)?1:-1;
+         if ( (0 != pRun->iLastDirection) && (iDirection != pRun->iLastDirection) && (pRun->uTimeMs < pRun->uTimeLastShift + 2000) )
+            pRun->iReversals++;
+         if ( iDirection > 0 )
+         {
+            pRun->iShiftsDown++;
+            if ( 0 == pRun->uTimeFirstShiftDown )
+               pRun->uTimeFirstShiftDown = pRun->uTimeMs;
+         }
+         else
+            pRun->iShiftsUp++;
+         pRun->iLastDirection = iDirection;
+         pRun->uTimeLastShift = pRun->uTimeMs;
+         pRun->iLevel = iNewLevel;
+         if ( iNewLevel > pRun->iMaxLevel )
+            pRun->iMaxLevel = iNewLevel;
+      }
+      pRun->uTimeMs += FIXTURE_SAMPLE_INTERVAL_MS;
+   }
+}
+
+static int _run_fixtures(int iStrength)
+{
+   type_adaptive_predictive_state state;
+   t_fixture_run run;
+   char szCheck[128];
+
+   printf("\nChecking built in scenarios, strength %d, %d levels\n", iStrength, g_iLevelsCount);
+
+   // Clean link: stays on the best level
+   _fixture_start(&state, &run, iStrength);
+   _fixture_run(&state, &run, 30000, 0.0, 100, 100, -50, -50);
+   _fixture_check("clean link", "no level changes", (0 == run.iShiftsDown) && (0 == run.iShiftsUp) && (0 == run.iLevel));
+
+   // Sudden loss: goes down within 200 ms, then back up one level at a time once the link is clean again
+   _fixture_start(&state, &run, iStrength);
+   _fixture_run(&state, &run, 5000, 0.0, 100, 100, -50, -50);
+   u32 uTimeLossStart = run.uTimeMs;
+   _fixture_run(&state, &run, 10000, 0.2, 80, 80, -70, -70);
+   snprintf(szCheck, sizeof(szCheck), "goes down within 200 ms (went down after %d ms)", (0 == run.uTimeFirstShiftDown)?-1:(int)(run.uTimeFirstShiftDown - uTimeLossStart));
+   _fixture_check("sudden loss", szCheck, (0 != run.uTimeFirstShiftDown) && (run.uTimeFirstShiftDown <= uTimeLossStart + 200));
+   _fixture_check("sudden loss", "no shift up while the loss lasts", 0 == run.iShiftsUp);
+   int iShiftsDown = run.iShiftsDown;
+   _fixture_run(&state, &run, 30000, 0.0, 100, 100, -50, -50);
+   _fixture_check("recovery", "back on the best level", 0 == run.iLevel);
+   _fixture_check("recovery", "no shift down on a clean link", run.iShiftsDown == iShiftsDown);
+
+   // Steady moderate loss: settles on a level, does not oscillate
+   _fixture_start(&state, &run, iStrength);
+   _fixture_run(&state, &run, 3000, 0.05, 95, 95, -60, -60);
+   int iShifts = run.iShiftsDown + run.iShiftsUp;
+   _fixture_run(&state, &run, 30000, 0.05, 95, 95, -60, -60);
+   snprintf(szCheck, sizeof(szCheck), "settled after 3 s (%d level changes after)", run.iShiftsDown + run.iShiftsUp - iShifts);
+   _fixture_check("steady loss", szCheck, run.iShiftsDown + run.iShiftsUp - iShifts <= 1);
+   _fixture_check("steady loss", "no quick reversals", 0 == run.iReversals);
+
+   // Fading link: quality and dBm go down before the loss shows up; goes down before the loss starts
+   _fixture_start(&state, &run, iStrength);
+   _fixture_run(&state, &run, 3000, 0.0, 100, 100, -50, -50);
+   _fixture_run(&state, &run, 1500, 0.0, 100, 60, -50, -80);
+   uTimeLossStart = run.uTimeMs;
+   _fixture_run(&state, &run, 3000, 0.3, 60, 60, -80, -80);
+   _fixture_check("fading link", "goes down before the loss starts", (0 != run.uTimeFirstShiftDown) && (run.uTimeFirstShiftDown < uTimeLossStart));
+
+   printf("%d of %d checks failed\n", s_iFixtureChecksFailed, s_iFixtureChecksCount);
+   return (0 == s_iFixtureChecksFailed)?0:1;
+}
+
+int main(int argc, char *argv[])
+{
+   _parse_levels("8/2/0,8/3/0,8/4/0,8/3/1,8/4/1,8/5/1,8/4/2,8/6/2");
+
+   if ( (argc < 2) || (0 == strcmp(argv[1], "-fixtures")) )
+   {
+      int iStrength = 5;
+      if ( (argc > 3) && (0 == strcmp(argv[2], "-strength")) )
+         iStrength = atoi(argv[3]);
+      if ( argc < 2 )
+         printf("\ntest_adaptive_replay stats.csv [-strength 1..10] [-levels data/ec/step,data/ec/step,...] [-quiet]\ntest_adaptive_replay -fixtures [-strength 1..10]\n");
+      return _run_fixtures(iStrength);
+   }
+
+   int iStrength = 5;
+   bool bQuiet = false;
+
+   for( int i=2; i<argc; i++ )
+   {
+      if ( (0 == strcmp(argv[i], "-strength")) && (i+1 < argc) )
+         iStrength = atoi(argv[++i]);
+      else if ( (0 == strcmp(argv[i], "-levels")) && (i+1 < argc) )
+      {
+         if ( ! _parse_levels(argv[++i]) )
+         {
+            printf("\nInvalid levels: %s\n", argv[i]);
+            return -1;
+         }
+      }
+      else if ( 0 == strcmp(argv[i], "-quiet") )
+         bQuiet = true;
+      else
+      {
+         printf("\nInvalid parameter: %s\n", argv[i]);
+         return -1;
+      }
+   }
+
+   FILE* fd = fopen(argv[1], "r");
+   if ( NULL == fd )
+   {
+      printf("\nFailed to open stats file: %s\n", argv[1]);
+      return -1;
+   }
+
+   type_adaptive_predictive_state state;
+   adaptive_predictive_init(&state, 0, iStrength);
+   adaptive_predictive_set_levels(&state, g_Levels, g_iLevelsCount);
+
+   u32 uTimeAtLevel[ADAPTIVE_PREDICTIVE_MAX_LEVELS];
+   memset(uTimeAtLevel, 0, sizeof(uTimeAtLevel));
+   int iSamples = 0;
+   int iShifts = 0;
+   int iShiftsRecorded = 0;
+   int iReversals = 0;
+   int iLastDirection = 0;
+   u32 uTimeLastShift = 0;
+   u32 uTimeFirst = 0;
+   u32 uTimeLast = 0;
+   int iLevel = 0;
+   int iLastRecordedLevel = -1;
+
+   char szLine[256];
+   while ( NULL != fgets(szLine, sizeof(szLine), fd) )
+   {
+      type_adaptive_predictive_sample sample;
+      int iRecordedLevel = -1;
+      int iCount = sscanf(szLine, "%u,%d,%d,%d,%d,%d,%d,%d,%d", &sample.uTimeMs, &sample.iRxQuality, &sample.iDbm,
+         &sample.iCleanPackets, &sample.iReconstructedPackets, &sample.iMissingPackets,
+         &sample.iMaxECUsed, &sample.iRetransmissionRequests, &iRecordedLevel);
+      if ( iCount < 8 )
+         continue;
+
+      if ( 0 == iSamples )
+         uTimeFirst = sample.uTimeMs;
+      else if ( (iLevel >= 0) && (iLevel < ADAPTIVE_PREDICTIVE_MAX_LEVELS) )
+         uTimeAtLevel[iLevel] += sample.uTimeMs - uTimeLast;
+      uTimeLast = sample.uTimeMs;
+      iSamples++;
+
+      if ( iCount > 8 )
+      {
+         if ( (iLastRecordedLevel != -1) && (iRecordedLevel != iLastRecordedLevel) )
+            iShiftsRecorded++;
+         iLastRecordedLevel = iRecordedLevel;
+      }
+
+      int iNewLevel = adaptive_predictive_add_sample(&state, &sample);
+      if ( iNewLevel == iLevel )
+         continue;
+
+      int iDirection = (iNewLevel > iLevel)?1:-1;
+      // A change of direction shortly after the previous shift is an oscillation
+      if ( (0 != iLastDirection) && (iDirection != iLastDirection) && (sample.uTimeMs < uTimeLastShift + 2000) )
+         iReversals++;
+      iLastDirection = iDirection;
+      uTimeLastShift = sample.uTimeMs;
+      iShifts++;
+      if ( ! bQuiet )
+         printf("%u ms: level %d -> %d (%d/%d, step %d), predicted loss: %.3f, rx quality: %d%%, dbm: %d\n",
+            sample.uTimeMs - uTimeFirst, iLevel, iNewLevel,
+            g_Levels[iNewLevel].iDataPackets, g_Levels[iNewLevel].iECPackets, g_Levels[iNewLevel].iProfileStep,
+            state.fPredictedLoss, sample.iRxQuality, sample.iDbm);
+      iLevel = iNewLevel;
+   }
+   fclose(fd);
+
+   if ( 0 == iSamples )
+   {
+      printf("\nNo samples found in %s\n", argv[1]);
+      return -1;
+   }
+
+   printf("\nReplayed %d samples (%u ms), strength %d, %d levels\n", iSamples, uTimeLast - uTimeFirst, iStrength, g_iLevelsCount);
+   printf("Level shifts: %d, quick reversals (oscillations): %d\n", iShifts, iReversals);
+   if ( -1 != iLastRecordedLevel )
+      printf("Level shifts in the recorded session: %d\n", iShiftsRecorded);
+   for( int i=0; i<g_iLevelsCount; i++ )
+   {
+      if ( 0 == uTimeAtLevel[i] )
+         continue;
+      printf("Time at level %d (%d/%d, step %d): %u ms (%.1f%%)\n", i, g_Levels[i].iDataPackets, g_Levels[i].iECPackets, g_Levels[i].iProfileStep,
+         uTimeAtLevel[i], 100.0*(double)uTimeAtLevel[i]/(double)(uTimeLast - uTimeFirst + 1));
+   }
+   return 0;
+}
@@ -1515,7 +1515,7 @@ int main(int argc, char *argv[])
 
    do_generic_update();
 
-   loadAllModels();
+   loadAllModelsFull();
 
    if ( (iMajor < 6) || (iMajor == 6 && iMinor < 2) )
       do_update_to_62();
@@ -46,6 +46,7 @@
 #include "../radio/radiopackets2.h"
 #include "../radio/radiolink.h"
 #include "../radio/radio_tx.h"
+#include "../radio/radiopackets_telemetry_delta.h"
 
 u8 s_RadioRawPacket[MAX_PACKET_TOTAL_SIZE];
 
@@ -70,6 +71,7 @@ typedef struct
 } __attribute__((packed)) t_alarm_info;
 
 #define MAX_ALARMS_QUEUE 20
+#define MAX_SERIAL_RADIO_PACKET_SIZE 100
 
 t_alarm_info s_AlarmsQueue[MAX_ALARMS_QUEUE];
 int s_AlarmsPendingInQueue = 0;
@@ -141,7 +143,7 @@ int get_last_tx_minimum_video_radio_datarate_bps()
    return nMinRate;
 }
 
-int _compute_packet_datarate(bool bIsVideoPacket, bool bIsRetransmited, int iVehicleRadioLinkId, int iRadioInterface)
+int _compute_packet_datarate(bool bIsVideoPacket, bool bIsRetransmited, int iVideoFramePriority, int iVehicleRadioLinkId, int iRadioInterface)
 {
    int nRateTxVideo = DEFAULT_RADIO_DATARATE_VIDEO;
    if ( 0 != s_VideoAdaptiveTxDatarateBPS )
@@ -162,7 +164,14 @@ int _compute_packet_datarate(bool bIsVideoPacket, bool bIsRetransmited, int iVeh
 
    if ( bIsVideoPacket )
    {
+      // The last video datarate is used for the video bitrate checks and telemetry: keep the nominal one there
       s_LastTxDataRatesVideo[iRadioInterface] = nRateTxVideo;
+
+      // I-frames data goes one datarate level lower (more robust), if frame priority classes are enabled.
+      // Only for this packet.
+      if ( iVideoFramePriority == VIDEO_FRAME_PRIORITY_IFRAME )
+      if ( g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_FRAME_PRIORITY_CLASSES )
+         nRateTxVideo = video_stats_overwrites_get_lower_datarate_value(nRateTxVideo, 1);
       return nRateTxVideo;
    }
 
@@ -287,22 +296,26 @@ bool _send_packet_to_serial_radio_interface(int iLocalRadioLinkId, int iRadioInt
   
    bool bPacketsSent = true;
 
+   static bool s_bTelemetryDeltaStatesInitialized = false;
+   static type_telemetry_delta_state s_TelemetryDeltaStates[MAX_RADIO_INTERFACES];
+   if ( ! s_bTelemetryDeltaStatesInitialized )
+   {
+      s_bTelemetryDeltaStatesInitialized = true;
+      for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+         telemetry_delta_init_state(&s_TelemetryDeltaStates[i]);
+   }
+   u8 uTelemetryDeltaPacket[TELEMETRY_DELTA_MAX_PACKET_SIZE];
+
    u8* pData = pPacketData;
    int nLength = nPacketLength;
    while ( nLength > 0 )
    {
-      t_packet_header* pPH = (t_packet_header*)pData;
+      t_packet_header* pPHSource = (t_packet_header*)pData;
+      t_packet_header* pPH = pPHSource;
       if ( ! radio_can_send_packet_on_slow_link(iLocalRadioLinkId, pPH->packet_type, 0, g_TimeNow) )
       {
-         nLength -= pPH->total_length;
-         pData += pPH->total_length;
-         continue;
-      }
-
-      if ( pPH->total_length > 100 )
-      {
-         nLength -= pPH->total_length;
-         pData += pPH->total_length;
+         nLength -= pPHSource->total_length;
+         pData += pPHSource->total_length;
          continue;
       }
 
@@ -317,8 +330,35 @@ bool _send_packet_to_serial_radio_interface(int iLocalRadioLinkId, int iRadioInt
             send_alarm_to_controller(ALARM_ID_RADIO_LINK_DATA_OVERLOAD, (g_SM_RadioStats.radio_interfaces[iRadioInterfaceIndex].txBytesPerSec & 0xFFFFFF) | (((u32)iRadioInterfaceIndex)<<24),(u32)iAirRate,0);
          }
 
-         nLength -= pPH->total_length;
-         pData += pPH->total_length;
+         nLength -= pPHSource->total_length;
+         pData += pPHSource->total_length;
+         continue;
+      }
+
+      // Full Ruby telemetry is too big for serial links, send it as keyframes and deltas.
+      // A delta that does not fit is replaced by a keyframe (relative to zero values, it can be smaller).
+      if ( pPH->packet_type == PACKET_TYPE_RUBY_TELEMETRY_EXTENDED )
+      {
+         type_telemetry_delta_state* pDeltaState = &s_TelemetryDeltaStates[iRadioInterfaceIndex];
+         if ( telemetry_delta_encode_packet(pDeltaState, (u8*)pPH, uTelemetryDeltaPacket, MAX_SERIAL_RADIO_PACKET_SIZE, 0) > 0 )
+            pPH = (t_packet_header*)uTelemetryDeltaPacket;
+         else if ( telemetry_delta_encode_packet(pDeltaState, (u8*)pPH, uTelemetryDeltaPacket, MAX_SERIAL_RADIO_PACKET_SIZE, 1) > 0 )
+            pPH = (t_packet_header*)uTelemetryDeltaPacket;
+         else
+         {
+            static u32 s_uLastTimeLogTelemetryDeltaTooBig = 0;
+            if ( g_TimeNow > s_uLastTimeLogTelemetryDeltaTooBig + 10000 )
+            {
+               s_uLastTimeLogTelemetryDeltaTooBig = g_TimeNow;
+               log_softerror_and_alarm("Telemetry keyframe does not fit in a serial packet (max %d bytes), telemetry not sent on radio interface %d.", MAX_SERIAL_RADIO_PACKET_SIZE, iRadioInterfaceIndex+1);
+            }
+         }
+      }
+
+      if ( pPH->total_length > MAX_SERIAL_RADIO_PACKET_SIZE )
+      {
+         nLength -= pPHSource->total_length;
+         pData += pPHSource->total_length;
          continue;
       }
 
@@ -339,6 +379,9 @@ bool _send_packet_to_serial_radio_interface(int iLocalRadioLinkId, int iRadioInt
          int iWriteResult = radio_tx_send_serial_radio_packet(iRadioInterfaceIndex, (u8*)pPH, pPH->total_length);
          if ( iWriteResult > 0 )
          {
+            if ( pPH != pPHSource )
+               telemetry_delta_on_packet_sent(&s_TelemetryDeltaStates[iRadioInterfaceIndex], (u8*)pPHSource, (u8*)pPH);
+
             u32 microT2 = get_current_timestamp_micros();
             if ( microT2 > microT1 )
                g_RadioTxTimers.aTmpInterfacesTxTotalTimeMicros[iRadioInterfaceIndex] += microT2 - microT1;
@@ -369,14 +412,14 @@ bool _send_packet_to_serial_radio_interface(int iLocalRadioLinkId, int iRadioInt
          bPacketsSent = false;
          log_softerror_and_alarm("Radio serial interface %d is not opened for write. Can't send packet on it.", iRadioInterfaceIndex+1);
       }
-      nLength -= pPH->total_length;
-      pData += pPH->total_length;
+      nLength -= pPHSource->total_length;
+      pData += pPHSource->total_length;
    }
 
    return bPacketsSent;
 }
 
-bool _send_packet_to_wifi_radio_interface(int iLocalRadioLinkId, int iRadioInterfaceIndex, u8* pPacketData, int nPacketLength, bool bHasVideoPacket, bool bIsRetransmited)
+bool _send_packet_to_wifi_radio_interface(int iLocalRadioLinkId, int iRadioInterfaceIndex, u8* pPacketData, int nPacketLength, bool bHasVideoPacket, bool bIsRetransmited, int iVideoFramePriority)
 {
    if ( (NULL == pPacketData) || (nPacketLength <= 0) || (NULL == g_pCurrentModel) )
       return false;
@@ -389,7 +432,7 @@ bool _send_packet_to_wifi_radio_interface(int iLocalRadioLinkId, int iRadioInter
    if ( (iVehicleRadioLinkId < 0) || (iVehicleRadioLinkId >= g_pCurrentModel->radioLinksParams.links_count) )
       return false;
    
-   int nRateTx = _compute_packet_datarate(bHasVideoPacket, bIsRetransmited, iVehicleRadioLinkId, iRadioInterfaceIndex);
+   int nRateTx = _compute_packet_datarate(bHasVideoPacket, bIsRetransmited, iVideoFramePriority, iVehicleRadioLinkId, iRadioInterfaceIndex);
    
    static int nLastRateTxVideo = 0;
    if ( bHasVideoPacket && (nLastRateTxVideo != nRateTx) )
@@ -506,6 +549,7 @@ int send_packet_to_radio_interfaces(u8* pPacketData, int nPacketLength, int iSen
 
    bool bHasVideoPacket = false;
    bool bIsRetransmited = false;
+   int iVideoFramePriority = -1;
    bool bHasPingReplyPacket = false;
    bool bHasLowCapacityLinkOnlyPackets = false;
    bool bHasCommandParamsZipResponse = false;
@@ -627,6 +671,14 @@ int send_packet_to_radio_interfaces(u8* pPacketData, int nPacketLength, int iSen
       if ( uStreamId >= STREAM_ID_VIDEO_1 )
          bHasVideoPacket = true;
 
+      if ( pPH->packet_type == PACKET_TYPE_VIDEO_DATA_FULL )
+      {
+         t_packet_header_video_full_77* pPHVF = (t_packet_header_video_full_77*) (pData+sizeof(t_packet_header));
+         int iPriority = (int)((pPHVF->uVideoStatusFlags2 & VIDEO_STATUS_FLAGS2_MASK_FRAME_PRIORITY) >> VIDEO_STATUS_FLAGS2_SHIFT_FRAME_PRIORITY);
+         if ( iPriority > iVideoFramePriority )
+            iVideoFramePriority = iPriority;
+      }
+
       nLength -= pPH->total_length;
       pData += pPH->total_length;
    }
@@ -713,7 +765,7 @@ int send_packet_to_radio_interfaces(u8* pPacketData, int nPacketLength, int iSen
       {
          if ( bHasLowCapacityLinkOnlyPackets )
             continue;
-         if ( _send_packet_to_wifi_radio_interface(iRadioLinkId, iRadioInterfaceIndex, pPacketData, nPacketLength, bHasVideoPacket, bIsRetransmited) )
+         if ( _send_packet_to_wifi_radio_interface(iRadioLinkId, iRadioInterfaceIndex, pPacketData, nPacketLength, bHasVideoPacket, bIsRetransmited, iVideoFramePriority) )
          {
             bPacketSent = true;
             if ( bHasCommandParamsZipResponse )
@@ -32,6 +32,7 @@
 #include "../base/config.h"
 #include "../base/encr.h"
 #include "../base/models_list.h"
+#include "../base/models_shared_mem.h"
 #include "../base/shared_mem.h"
 #include "../base/ruby_ipc.h"
 #include "../base/hw_procs.h"
@@ -316,7 +317,7 @@ void _process_local_notification_model_changed(t_packet_header* pPH, int changeT
       char szFile[128];
       strcpy(szFile, FOLDER_CONFIG);
       strcat(szFile, FILE_CONFIG_CURRENT_VEHICLE_MODEL);
-      if ( ! g_pCurrentModel->loadFromFile(szFile, false) )
+      if ( ! models_shared_mem_reload(g_pCurrentModel, szFile, false) )
          log_error_and_alarm("Can't load current model vehicle.");
       ruby_ipc_channel_send_message(s_fIPCRouterToCommands, (u8*)pPH, pPH->total_length);
       return;
@@ -334,7 +335,7 @@ void _process_local_notification_model_changed(t_packet_header* pPH, int changeT
       char szFile[128];
       strcpy(szFile, FOLDER_CONFIG);
       strcat(szFile, FILE_CONFIG_CURRENT_VEHICLE_MODEL);
-      if ( ! g_pCurrentModel->loadFromFile(szFile, false) )
+      if ( ! models_shared_mem_reload(g_pCurrentModel, szFile, false) )
          log_error_and_alarm("Can't load current model vehicle.");
       hardware_reload_serial_ports_settings();
       if ( NULL != g_pProcessStats )
@@ -387,7 +388,7 @@ void _process_local_notification_model_changed(t_packet_header* pPH, int changeT
    char szFile[128];
    strcpy(szFile, FOLDER_CONFIG);
    strcat(szFile, FILE_CONFIG_CURRENT_VEHICLE_MODEL);
-   if ( ! g_pCurrentModel->loadFromFile(szFile, false) )
+   if ( ! models_shared_mem_reload(g_pCurrentModel, szFile, false) )
       log_error_and_alarm("Can't load current model vehicle.");
 
 
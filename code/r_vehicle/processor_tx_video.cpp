@@ -37,6 +37,7 @@
 #include "../radio/fec.h"
 #include "../base/camera_utils.h"
 #include "../base/parser_h264.h"
+#include "../base/parser_h265.h"
 #include "../common/string_utils.h"
 #include "shared_vars.h"
 #include "timers.h"
@@ -68,6 +69,7 @@ typedef struct
    u8 block_packets;
    u8 block_fecs;
    int video_data_length;
+   u8 uFramePriority; // highest frame priority class of the data packets in this block
    type_tx_packet_info packetsInfo[MAX_TOTAL_PACKETS_IN_BLOCK];
    int iAllocatedPackets = 0;
 }
@@ -90,6 +92,54 @@ u32 sTimeTotalFecTimeMicroSec = 0;
 
 ParserH264 s_ParserH264CameraOutput;
 ParserH264 s_ParserH264RadioOutput;
+ParserH265 s_ParserH265CameraOutput;
+ParserH265 s_ParserH265RadioOutput;
+
+ParserH264* process_data_tx_video_get_camera_output_parser()
+{
+   if ( ((s_CurrentPHVF.video_stream_and_type >> 4) & 0x0F) == VIDEO_TYPE_H265 )
+      return &s_ParserH265CameraOutput;
+   return &s_ParserH264CameraOutput;
+}
+
+// NAL aligned packetization state for the video packet currently being filled
+bool s_bCurrentPacketIsFrameStart = false;
+bool s_bCurrentPacketIsFrameEnd = false;
+int s_iCurrentPacketNALPayloadLength = 0;
+// Trailing bytes of the last input buffer that could be the beginning of a start code (00, 00 00, 00 00 01).
+// They are added with the next input buffer, so a start code split across input buffers still starts a video packet.
+u8 s_uNALPendingBytes[MAX_PARSER_CARRIED_BOUNDARY_BYTES];
+int s_iNALPendingBytesCount = 0;
+
+u32 s_uCountDroppedNonRefPackets = 0;
+
+// Frame priority classes: packets are tagged as I-frame, reference or non reference frame data.
+// When enabled, I-frame data is sent at a lower (more robust) radio datarate and, while the video tx is congested,
+// non reference blocks lose their EC packets and retransmissions first. Losing a non reference frame affects just that frame.
+
+bool _tx_video_uses_frame_priority()
+{
+   if ( NULL == g_pCurrentModel )
+      return false;
+   return (g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_FRAME_PRIORITY_CLASSES)?true:false;
+}
+
+bool _tx_video_is_congested()
+{
+   if ( 0 == g_uTimeLastVideoTxOverload )
+      return false;
+   return (g_TimeNow < g_uTimeLastVideoTxOverload + 1000);
+}
+
+u32 _tx_video_get_current_frame_priority()
+{
+   ParserH264* pParser = process_data_tx_video_get_camera_output_parser();
+   if ( pParser->IsInsideIFrame() )
+      return VIDEO_FRAME_PRIORITY_IFRAME;
+   if ( pParser->IsInsideNonReferenceFrame() )
+      return VIDEO_FRAME_PRIORITY_NONREF;
+   return VIDEO_FRAME_PRIORITY_REF;
+}
 
 u32 s_lCountBytesSend = 0;
 u32 s_lCountBytesVideoIn = 0; 
@@ -133,7 +183,7 @@ int ProcessorTxVideo::m_siInstancesCount = 0;
 
 bool process_data_tx_is_on_iframe()
 {
-   return s_ParserH264CameraOutput.IsInsideIFrame();
+   return process_data_tx_video_get_camera_output_parser()->IsInsideIFrame();
 }
 
 
@@ -472,6 +522,7 @@ void _reset_tx_buffers()
       s_BlocksTxBuffers[i].video_data_length = s_CurrentPHVF.video_data_length;
       s_BlocksTxBuffers[i].block_packets = s_CurrentPHVF.block_packets;
       s_BlocksTxBuffers[i].block_fecs = s_CurrentPHVF.block_fecs;
+      s_BlocksTxBuffers[i].uFramePriority = VIDEO_FRAME_PRIORITY_REF;
    }
 }
 
@@ -693,6 +744,15 @@ void _send_packet(int bufferIndex, int packetIndex, bool isRetransmitted, bool i
 
    s_BlocksTxBuffers[bufferIndex].packetsInfo[packetIndex].flags = PACKET_FLAG_SENT;
 
+   // Congested: drop EC packets of non reference blocks first
+   if ( (! isRetransmitted) && (packetIndex >= s_BlocksTxBuffers[bufferIndex].block_packets) )
+   if ( s_BlocksTxBuffers[bufferIndex].uFramePriority == VIDEO_FRAME_PRIORITY_NONREF )
+   if ( _tx_video_uses_frame_priority() && _tx_video_is_congested() )
+   {
+      s_uCountDroppedNonRefPackets++;
+      return;
+   }
+
    u8* pPacketData = s_BlocksTxBuffers[bufferIndex].packetsInfo[packetIndex].pRawData;
    t_packet_header* pPH = (t_packet_header*)(pPacketData);
    t_packet_header_video_full_77* pPHVF = (t_packet_header_video_full_77*)(pPacketData + sizeof(t_packet_header));
@@ -765,7 +825,8 @@ void _send_packet(int bufferIndex, int packetIndex, bool isRetransmitted, bool i
    if ( _inject_recoverable_faults(bufferIndex, pPH->stream_packet_idx, packetIndex, isRetransmitted) )
       return;
 
-   if ( ((s_CurrentPHVF.video_stream_and_type >> 4) & 0x0F) == VIDEO_TYPE_H264 )
+   if ( (((s_CurrentPHVF.video_stream_and_type >> 4) & 0x0F) == VIDEO_TYPE_H264) ||
+        (((s_CurrentPHVF.video_stream_and_type >> 4) & 0x0F) == VIDEO_TYPE_H265) )
    if ( (! isRetransmitted) && (! isDuplicationPacket) )
    if ( packetIndex < s_BlocksTxBuffers[bufferIndex].block_packets )
    if ( NULL != g_pCurrentModel )
@@ -773,17 +834,20 @@ void _send_packet(int bufferIndex, int packetIndex, bool isRetransmitted, bool i
         (g_iDebugShowKeyFramesAfterRelaySwitch > 0) )
    {
       u8* pVideoData = pPacketData + sizeof(t_packet_header) + sizeof(t_packet_header_video_full_77);
+      ParserH264* pParserRadioOutput = &s_ParserH264RadioOutput;
+      if ( ((s_CurrentPHVF.video_stream_and_type >> 4) & 0x0F) == VIDEO_TYPE_H265 )
+         pParserRadioOutput = &s_ParserH265RadioOutput;
       
-      bool bStartOfFrameDetected = s_ParserH264RadioOutput.parseData(pVideoData, pPHVF->video_data_length, g_TimeNow);
+      bool bStartOfFrameDetected = pParserRadioOutput->parseData(pVideoData, pPHVF->video_data_length, g_TimeNow);
       if ( bStartOfFrameDetected )
       {         
-         u32 uLastFrameDuration = s_ParserH264RadioOutput.getTimeDurationOfLastCompleteFrame();
+         u32 uLastFrameDuration = pParserRadioOutput->getTimeDurationOfLastCompleteFrame();
          if ( uLastFrameDuration > 127 )
             uLastFrameDuration = 127;
          if ( uLastFrameDuration < 1 )
             uLastFrameDuration = 1;
 
-         u32 uLastFrameSize = s_ParserH264RadioOutput.getSizeOfLastCompleteFrame();
+         u32 uLastFrameSize = pParserRadioOutput->getSizeOfLastCompleteFrame();
          uLastFrameSize /= 1000; // transform to kbytes
 
          if ( uLastFrameSize > 127 )
@@ -795,17 +859,17 @@ void _send_packet(int bufferIndex, int packetIndex, bool isRetransmitted, bool i
           
          u32 uNextIndex = (g_VideoInfoStatsRadioOut.uLastIndex+1) % MAX_FRAMES_SAMPLES;
          
-         if ( s_ParserH264RadioOutput.IsInsideIFrame() )
+         if ( pParserRadioOutput->IsInsideIFrame() )
             g_VideoInfoStatsRadioOut.uFramesTypesAndSizes[uNextIndex] |= (1<<7);
          else
             g_VideoInfoStatsRadioOut.uFramesTypesAndSizes[uNextIndex] &= 0x7F;
       
-         g_VideoInfoStatsRadioOut.uKeyframeIntervalMs = s_ParserH264RadioOutput.getCurrentlyDetectedKeyframeIntervalMs();
-         g_VideoInfoStatsRadioOut.uDetectedFPS = s_ParserH264RadioOutput.getDetectedFPS();
-         g_VideoInfoStatsRadioOut.uDetectedSlices = (u32) s_ParserH264RadioOutput.getDetectedSlices();
+         g_VideoInfoStatsRadioOut.uKeyframeIntervalMs = pParserRadioOutput->getCurrentlyDetectedKeyframeIntervalMs();
+         g_VideoInfoStatsRadioOut.uDetectedFPS = pParserRadioOutput->getDetectedFPS();
+         g_VideoInfoStatsRadioOut.uDetectedSlices = (u32) pParserRadioOutput->getDetectedSlices();
 
          if ( g_iDebugShowKeyFramesAfterRelaySwitch > 0 )
-         if ( s_ParserH264RadioOutput.IsInsideIFrame() )
+         if ( pParserRadioOutput->IsInsideIFrame() )
          {
             log_line("[Debug] Transmitting keyframe after relay switch.");
             g_iDebugShowKeyFramesAfterRelaySwitch--;
@@ -956,6 +1020,23 @@ int process_data_tx_video_send_packets_ready_to_send(int howMany)
 }
 
 
+// NAL aligned packetization: each video packet starts at a NAL unit boundary (slice or access unit start)
+// and is zero padded when the next NAL unit starts. Large NAL units just span multiple consecutive packets.
+// The payload length (without the padding) is sent in the video status flags, so the receiving side outputs only the payload;
+// zero padding between NAL units is still valid in H264/H265 byte streams, for packets reconstructed from EC data.
+
+bool _tx_video_is_nal_aligned()
+{
+   if ( NULL == g_pCurrentModel )
+      return false;
+   if ( ! (g_pCurrentModel->video_params.uVideoExtraFlags & VIDEO_FLAG_NAL_ALIGNED_PACKETS) )
+      return false;
+   if ( (((s_CurrentPHVF.video_stream_and_type >> 4) & 0x0F) != VIDEO_TYPE_H264) &&
+        (((s_CurrentPHVF.video_stream_and_type >> 4) & 0x0F) != VIDEO_TYPE_H265) )
+      return false;
+   return g_pCurrentModel->hasCamera();
+}
+
 // Returns true if a block is complete
 
 bool _onNewCompletePacketReadFromInput()
@@ -974,6 +1055,9 @@ bool _onNewCompletePacketReadFromInput()
 
       s_BlocksTxBuffers[s_currentReadBufferIndex].packetsInfo[s_currentReadBlockPacketIndex].currentReadPosition = 0;
       _reset_tx_buffers();
+      s_bCurrentPacketIsFrameStart = false;
+      s_bCurrentPacketIsFrameEnd = false;
+      s_iCurrentPacketNALPayloadLength = 0;
       return false;
    }
 
@@ -1022,10 +1106,34 @@ bool _onNewCompletePacketReadFromInput()
    s_CurrentPHVF.uVideoStatusFlags2 &= 0xFFFFFF00;
    s_CurrentPHVF.uVideoStatusFlags2 |= g_SM_VideoLinkStats.overwrites.currentH264QUantization & 0xFF;
      
-   if ( s_ParserH264CameraOutput.IsInsideIFrame() )
+   if ( process_data_tx_video_get_camera_output_parser()->IsInsideIFrame() )
       s_CurrentPHVF.uVideoStatusFlags2 |= VIDEO_STATUS_FLAGS2_IS_IFRAME;
    else
       s_CurrentPHVF.uVideoStatusFlags2 &= ~VIDEO_STATUS_FLAGS2_IS_IFRAME;
+
+   s_CurrentPHVF.uVideoStatusFlags2 &= ~(VIDEO_STATUS_FLAGS2_IS_NAL_ALIGNED | VIDEO_STATUS_FLAGS2_IS_FRAME_START | VIDEO_STATUS_FLAGS2_IS_FRAME_END | VIDEO_STATUS_FLAGS2_MASK_PAYLOAD_LENGTH);
+   if ( _tx_video_is_nal_aligned() )
+   {
+      s_CurrentPHVF.uVideoStatusFlags2 |= VIDEO_STATUS_FLAGS2_IS_NAL_ALIGNED;
+      if ( s_bCurrentPacketIsFrameStart )
+         s_CurrentPHVF.uVideoStatusFlags2 |= VIDEO_STATUS_FLAGS2_IS_FRAME_START;
+      if ( s_bCurrentPacketIsFrameEnd )
+         s_CurrentPHVF.uVideoStatusFlags2 |= VIDEO_STATUS_FLAGS2_IS_FRAME_END;
+      u32 uPayloadLength = (u32)s_CurrentPHVF.video_data_length;
+      if ( s_iCurrentPacketNALPayloadLength > 0 )
+         uPayloadLength = (u32)s_iCurrentPacketNALPayloadLength;
+      s_CurrentPHVF.uVideoStatusFlags2 |= (uPayloadLength << VIDEO_STATUS_FLAGS2_SHIFT_PAYLOAD_LENGTH) & VIDEO_STATUS_FLAGS2_MASK_PAYLOAD_LENGTH;
+   }
+   s_bCurrentPacketIsFrameStart = false;
+   s_bCurrentPacketIsFrameEnd = false;
+   s_iCurrentPacketNALPayloadLength = 0;
+
+   u32 uFramePriority = _tx_video_get_current_frame_priority();
+   s_CurrentPHVF.uVideoStatusFlags2 &= ~VIDEO_STATUS_FLAGS2_MASK_FRAME_PRIORITY;
+   s_CurrentPHVF.uVideoStatusFlags2 |= (uFramePriority << VIDEO_STATUS_FLAGS2_SHIFT_FRAME_PRIORITY) & VIDEO_STATUS_FLAGS2_MASK_FRAME_PRIORITY;
+   if ( (0 == s_currentReadBlockPacketIndex) || (uFramePriority > s_BlocksTxBuffers[s_currentReadBufferIndex].uFramePriority) )
+      s_BlocksTxBuffers[s_currentReadBufferIndex].uFramePriority = (u8)uFramePriority;
+
    s_CurrentPHVF.uExtraData = g_TimeNow;
    
 
@@ -1092,6 +1200,10 @@ bool _onNewCompletePacketReadFromInput()
          t_packet_header_video_full_77* pVideo = (t_packet_header_video_full_77*)(((u8*)(pHeader)) + sizeof(t_packet_header));
          memcpy(pHeader, &s_CurrentPH, sizeof(t_packet_header));
          memcpy(pVideo, &s_CurrentPHVF, sizeof(t_packet_header_video_full_77));
+         // Frame boundaries and payload length are meaningful only for data packets
+         pVideo->uVideoStatusFlags2 &= ~(VIDEO_STATUS_FLAGS2_IS_FRAME_START | VIDEO_STATUS_FLAGS2_IS_FRAME_END | VIDEO_STATUS_FLAGS2_MASK_PAYLOAD_LENGTH);
+         pVideo->uVideoStatusFlags2 &= ~VIDEO_STATUS_FLAGS2_MASK_FRAME_PRIORITY;
+         pVideo->uVideoStatusFlags2 |= (((u32)s_BlocksTxBuffers[s_currentReadBufferIndex].uFramePriority) << VIDEO_STATUS_FLAGS2_SHIFT_FRAME_PRIORITY) & VIDEO_STATUS_FLAGS2_MASK_FRAME_PRIORITY;
 
          s_currentReadBlockPacketIndex++;
          s_CurrentPHVF.video_block_packet_index++;
@@ -1145,6 +1257,7 @@ bool _onNewCompletePacketReadFromInput()
    s_BlocksTxBuffers[s_currentReadBufferIndex].video_data_length = s_CurrentPHVF.video_data_length;
    s_BlocksTxBuffers[s_currentReadBufferIndex].block_packets = s_CurrentPHVF.block_packets;
    s_BlocksTxBuffers[s_currentReadBufferIndex].block_fecs = s_CurrentPHVF.block_fecs;
+   s_BlocksTxBuffers[s_currentReadBufferIndex].uFramePriority = VIDEO_FRAME_PRIORITY_REF;
 
    // Reset info on the first packet of next video block to send
    s_BlocksTxBuffers[s_currentReadBufferIndex].packetsInfo[0].currentReadPosition = 0;
@@ -1182,6 +1295,8 @@ bool process_data_tx_video_init()
 
    s_ParserH264CameraOutput.init(camera_get_active_camera_h264_slices(g_pCurrentModel));
    s_ParserH264RadioOutput.init(camera_get_active_camera_h264_slices(g_pCurrentModel));
+   s_ParserH265CameraOutput.init(camera_get_active_camera_h264_slices(g_pCurrentModel));
+   s_ParserH265RadioOutput.init(camera_get_active_camera_h264_slices(g_pCurrentModel));
 
 
    s_uCountEncodingChanges = 0;
@@ -1231,6 +1346,7 @@ bool process_data_tx_video_init()
    s_BlocksTxBuffers[0].video_data_length = s_CurrentPHVF.video_data_length;
    s_BlocksTxBuffers[0].block_packets = s_CurrentPHVF.block_packets;
    s_BlocksTxBuffers[0].block_fecs = s_CurrentPHVF.block_fecs;
+   s_BlocksTxBuffers[0].uFramePriority = VIDEO_FRAME_PRIORITY_REF;
 
    s_BlocksTxBuffers[0].packetsInfo[0].flags = PACKET_FLAG_EMPTY;
    s_BlocksTxBuffers[0].packetsInfo[0].uTimestamp = 0;
@@ -1411,6 +1527,14 @@ void _process_command_resend_packets(u8* pPacketBuffer, u8 packetType)
            s_BlocksTxBuffers[bufferIndex].packetsInfo[requested_video_packet_index].flags != PACKET_FLAG_SENT )
          continue;
 
+      // Congested: do not retransmit non reference frames data
+      if ( s_BlocksTxBuffers[bufferIndex].uFramePriority == VIDEO_FRAME_PRIORITY_NONREF )
+      if ( _tx_video_uses_frame_priority() && _tx_video_is_congested() )
+      {
+         s_uCountDroppedNonRefPackets++;
+         continue;
+      }
+
       //log_line("Resending packet [%u/%d]", requested_video_block_index, requested_video_packet_index);
 
       _send_packet(bufferIndex, (int)requested_video_packet_index, true, false, false);
@@ -1487,6 +1611,14 @@ bool process_data_tx_video_loop()
       s_CurrentPHVF.fec_time = 2*sTimeTotalFecTimeMicroSec;
       sTimeTotalFecTimeMicroSec = 0;
 
+      static u32 s_uTimeLastDroppedNonRefPacketsLog = 0;
+      if ( (s_uCountDroppedNonRefPackets > 0) && (g_TimeNow > s_uTimeLastDroppedNonRefPacketsLog + 10000) )
+      {
+         s_uTimeLastDroppedNonRefPacketsLog = g_TimeNow;
+         log_line("[VideoTx] Tx congested: dropped %u EC/retransmitted packets of non reference frames in the last interval.", s_uCountDroppedNonRefPackets);
+         s_uCountDroppedNonRefPackets = 0;
+      }
+
       // Update retransmission statistics for the last 5 secs
       // Discard all the info older than 5 secs
 
@@ -1547,24 +1679,26 @@ void _parse_camera_source_h264_data(u8* pData, int iDataSize)
    if ( ! g_pCurrentModel->hasCamera() )
       return;
 
-   bool bStartOfFrameDetected = s_ParserH264CameraOutput.parseData(pData, iDataSize, g_TimeNow);
+   ParserH264* pParserCameraOutput = process_data_tx_video_get_camera_output_parser();
+
+   bool bStartOfFrameDetected = pParserCameraOutput->parseData(pData, iDataSize, g_TimeNow);
    if ( ! bStartOfFrameDetected )
       return;
 
    if ( g_iDebugShowKeyFramesAfterRelaySwitch > 0 )
-   if ( s_ParserH264CameraOutput.IsInsideIFrame() )
+   if ( pParserCameraOutput->IsInsideIFrame() )
    {
       log_line("[Debug] Start reading video keyframe from camera after relay switch.");
       g_iDebugShowKeyFramesAfterRelaySwitch--;
    }
 
-   u32 uLastFrameDuration = s_ParserH264CameraOutput.getTimeDurationOfLastCompleteFrame();
+   u32 uLastFrameDuration = pParserCameraOutput->getTimeDurationOfLastCompleteFrame();
    if ( uLastFrameDuration > 127 )
       uLastFrameDuration = 127;
    if ( uLastFrameDuration < 1 )
       uLastFrameDuration = 1;
 
-   u32 uLastFrameSize = s_ParserH264CameraOutput.getSizeOfLastCompleteFrame();
+   u32 uLastFrameSize = pParserCameraOutput->getSizeOfLastCompleteFrame();
    uLastFrameSize /= 1000; // transform to kbytes
 
    if ( uLastFrameSize > 127 )
@@ -1576,18 +1710,18 @@ void _parse_camera_source_h264_data(u8* pData, int iDataSize)
  
    u32 uNextIndex = (g_VideoInfoStatsCameraOutput.uLastIndex+1) % MAX_FRAMES_SAMPLES;
   
-   if ( s_ParserH264CameraOutput.IsInsideIFrame() )
+   if ( pParserCameraOutput->IsInsideIFrame() )
       g_VideoInfoStatsCameraOutput.uFramesTypesAndSizes[uNextIndex] |= (1<<7);
    else
       g_VideoInfoStatsCameraOutput.uFramesTypesAndSizes[uNextIndex] &= 0x7F;
 
-   g_VideoInfoStatsCameraOutput.uKeyframeIntervalMs = s_ParserH264CameraOutput.getCurrentlyDetectedKeyframeIntervalMs();
+   g_VideoInfoStatsCameraOutput.uKeyframeIntervalMs = pParserCameraOutput->getCurrentlyDetectedKeyframeIntervalMs();
 
-   if ( s_ParserH264CameraOutput.IsInsideIFrame() )
+   if ( pParserCameraOutput->IsInsideIFrame() )
       return;
 
-   g_VideoInfoStatsCameraOutput.uDetectedFPS = s_ParserH264CameraOutput.getDetectedFPS();
-   g_VideoInfoStatsCameraOutput.uDetectedSlices = (u32) s_ParserH264CameraOutput.getDetectedSlices();
+   g_VideoInfoStatsCameraOutput.uDetectedFPS = pParserCameraOutput->getDetectedFPS();
+   g_VideoInfoStatsCameraOutput.uDetectedSlices = (u32) pParserCameraOutput->getDetectedSlices();
    
 
    // We are on P frames now. Check if we need to set a different keyframe interval
@@ -1599,7 +1733,7 @@ void _parse_camera_source_h264_data(u8* pData, int iDataSize)
       return;
 
    bool bUpdateKeyframeIntervalNow = false;
-   u32 uTimeStartOfLastIFrame = s_ParserH264CameraOutput.getStartTimeOfLastIFrame();
+   u32 uTimeStartOfLastIFrame = pParserCameraOutput->getStartTimeOfLastIFrame();
 
    if ( g_SM_VideoLinkStats.overwrites.uCurrentPendingKeyframeMs > g_SM_VideoLinkStats.overwrites.uCurrentActiveKeyframeMs )
    if ( ((g_SM_VideoLinkStats.overwrites.uCurrentActiveKeyframeMs < 500 ) && (g_TimeNow >= uTimeStartOfLastIFrame + g_SM_VideoLinkStats.overwrites.uCurrentActiveKeyframeMs/2)) || 
@@ -1649,19 +1783,10 @@ void _parse_camera_source_h264_data(u8* pData, int iDataSize)
 }
 
 // Returns true if a complete block was read
-bool process_data_tx_video_on_new_data(u8* pData, int iDataSize)
+bool _add_video_data_to_tx_buffers(u8* pData, int iDataSize)
 {
-   if ( (NULL == pData) || (iDataSize <= 0) )
-      return false;
-
    bool bCompleteBlock = false;
 
-   // Always parse the input video stream as we might need to do keyframe adjustment
-   if ( NULL != g_pCurrentModel )
-     _parse_camera_source_h264_data(pData, iDataSize);
-
-   s_lCountBytesVideoIn += iDataSize;
-
    while ( iDataSize > 0 )
    {
       int iBytesLeftInCurrentVideoPacket =  process_data_tx_video_get_current_buffer_to_read_size();
@@ -1686,6 +1811,127 @@ bool process_data_tx_video_on_new_data(u8* pData, int iDataSize)
    return bCompleteBlock;
 }
 
+// Zero pads and completes the current video packet, if it has any data in it
+// Returns true if a complete block was read
+
+bool _close_current_nal_aligned_packet(bool bIsFrameEnd)
+{
+   int iReadPosition = s_BlocksTxBuffers[s_currentReadBufferIndex].packetsInfo[s_currentReadBlockPacketIndex].currentReadPosition;
+   if ( iReadPosition <= 0 )
+      return false;
+
+   int iBytesLeftInCurrentVideoPacket = process_data_tx_video_get_current_buffer_to_read_size();
+   if ( iBytesLeftInCurrentVideoPacket > 0 )
+      memset(process_data_tx_video_get_current_buffer_to_read_pointer(), 0, iBytesLeftInCurrentVideoPacket);
+   s_BlocksTxBuffers[s_currentReadBufferIndex].packetsInfo[s_currentReadBlockPacketIndex].currentReadPosition += iBytesLeftInCurrentVideoPacket;
+
+   s_iCurrentPacketNALPayloadLength = iReadPosition;
+   s_bCurrentPacketIsFrameEnd = bIsFrameEnd;
+   return _onNewCompletePacketReadFromInput();
+}
+
+// Adds the input bytes in the range [iFrom, iTo). Negative positions are in the pending bytes of the previous input buffer.
+// Returns true if a complete block was read
+
+bool _add_video_data_range_to_tx_buffers(u8* pPending, int iPendingCount, u8* pData, int iFrom, int iTo)
+{
+   bool bCompleteBlock = false;
+   if ( iFrom < -iPendingCount )
+      iFrom = -iPendingCount;
+   if ( (iFrom < 0) && (iFrom < iTo) )
+   {
+      int iEnd = (iTo < 0)?iTo:0;
+      bCompleteBlock |= _add_video_data_to_tx_buffers(pPending + iPendingCount + iFrom, iEnd - iFrom);
+      iFrom = iEnd;
+   }
+   if ( iFrom < iTo )
+      bCompleteBlock |= _add_video_data_to_tx_buffers(pData + iFrom, iTo - iFrom);
+   return bCompleteBlock;
+}
+
+// Uses the NAL boundaries found by the camera parser in this same input buffer
+// Returns true if a complete block was read
+
+bool _add_video_data_to_tx_buffers_nal_aligned(u8* pData, int iDataSize)
+{
+   bool bCompleteBlock = false;
+   ParserH264* pParserCameraOutput = process_data_tx_video_get_camera_output_parser();
+
+   u8 uPending[MAX_PARSER_CARRIED_BOUNDARY_BYTES];
+   int iPendingCount = s_iNALPendingBytesCount;
+   memcpy(uPending, s_uNALPendingBytes, iPendingCount);
+   s_iNALPendingBytesCount = 0;
+
+   // Keep back the end of this buffer if it can be the start of a split start code,
+   // or if it starts a NAL unit whose boundary the parser reports with the next buffer
+   int iHoldBack = 0;
+   if ( (iDataSize >= 3) && (pData[iDataSize-3] == 0) && (pData[iDataSize-2] == 0) && (pData[iDataSize-1] == 1) )
+      iHoldBack = 3;
+   else if ( (iDataSize >= 2) && (pData[iDataSize-2] == 0) && (pData[iDataSize-1] == 0) )
+      iHoldBack = 2;
+   else if ( pData[iDataSize-1] == 0 )
+      iHoldBack = 1;
+   if ( pParserCameraOutput->getLastParsedCarriedBoundaryBytes() > iHoldBack )
+      iHoldBack = pParserCameraOutput->getLastParsedCarriedBoundaryBytes();
+   if ( iHoldBack > iDataSize + iPendingCount )
+      iHoldBack = iDataSize + iPendingCount;
+   int iDataEnd = iDataSize - iHoldBack;
+
+   int iPos = -iPendingCount;
+   for( int i=0; i<pParserCameraOutput->getLastParsedNALBoundariesCount(); i++ )
+   {
+      int iOffset = pParserCameraOutput->getLastParsedNALBoundaryOffset(i);
+      if ( iOffset > iDataEnd )
+         break;
+      if ( iOffset > iPos )
+      {
+         bCompleteBlock |= _add_video_data_range_to_tx_buffers(uPending, iPendingCount, pData, iPos, iOffset);
+         iPos = iOffset;
+      }
+      bool bFrameStart = pParserCameraOutput->isLastParsedNALBoundaryFrameStart(i);
+      bCompleteBlock |= _close_current_nal_aligned_packet(bFrameStart);
+      if ( bFrameStart )
+         s_bCurrentPacketIsFrameStart = true;
+   }
+
+   if ( iPos < iDataEnd )
+      bCompleteBlock |= _add_video_data_range_to_tx_buffers(uPending, iPendingCount, pData, iPos, iDataEnd);
+
+   // Held back bytes can include some of the previous pending bytes, if this buffer is very small
+   for( int i=0; i<iHoldBack; i++ )
+   {
+      int iIndex = iDataEnd + i;
+      s_uNALPendingBytes[i] = (iIndex < 0)?uPending[iPendingCount + iIndex]:pData[iIndex];
+   }
+   s_iNALPendingBytesCount = iHoldBack;
+   return bCompleteBlock;
+}
+
+// Returns true if a complete block was read
+bool process_data_tx_video_on_new_data(u8* pData, int iDataSize)
+{
+   if ( (NULL == pData) || (iDataSize <= 0) )
+      return false;
+
+   // Always parse the input video stream as we might need to do keyframe adjustment
+   if ( NULL != g_pCurrentModel )
+     _parse_camera_source_h264_data(pData, iDataSize);
+
+   s_lCountBytesVideoIn += iDataSize;
+
+   if ( _tx_video_is_nal_aligned() )
+      return _add_video_data_to_tx_buffers_nal_aligned(pData, iDataSize);
+
+   bool bCompleteBlock = false;
+   if ( s_iNALPendingBytesCount > 0 )
+   {
+      bCompleteBlock |= _add_video_data_to_tx_buffers(s_uNALPendingBytes, s_iNALPendingBytesCount);
+      s_iNALPendingBytesCount = 0;
+   }
+   bCompleteBlock |= _add_video_data_to_tx_buffers(pData, iDataSize);
+   return bCompleteBlock;
+}
+
 void process_data_tx_video_signal_encoding_changed()
 {
    //log_line("TXVideo: Received request to update local encode parameters.");
@@ -1,4 +1,5 @@
 #pragma once
+#include "../base/parser_h264.h"
 
 #define MAX_VIDEO_BITRATE_HISTORY_VALUES 30
 // About 1.5 seconds of history at an update rate of 20 times/sec (50 ms)
@@ -72,6 +73,8 @@ int process_data_tx_video_get_current_buffer_to_read_size();
 bool process_data_tx_video_on_new_data(u8* pData, int iDataSize);
 
 bool process_data_tx_is_on_iframe();
+// H264 or H265 parser, based on the current video stream type
+ParserH264* process_data_tx_video_get_camera_output_parser();
 int process_data_tx_video_has_packets_ready_to_send();
 int process_data_tx_video_send_packets_ready_to_send(int howMany);
 
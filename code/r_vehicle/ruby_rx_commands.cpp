@@ -37,6 +37,9 @@
 #include "../base/commands.h"
 #include "../base/models.h"
 #include "../base/models_list.h"
+#include "../base/models_shared_mem.h"
+#include "../base/models_sync.h"
+#include "../base/file_transfer.h"
 #include "../base/radio_utils.h"
 #include "../base/hardware.h"
 #include "../base/hardware_camera.h"
@@ -116,12 +119,43 @@ typedef struct
 } __attribute__((packed)) t_structure_file_upload_info;
 
 t_structure_file_upload_info s_InfoLastFileUploaded;
+static u32 s_uFileUploadBulkTransferId = 0; // Transfer id (file CRC) of the bulk upload in progress
+static u32 s_uFileUploadBulkCompletedId = 0; // Transfer id of the last completed bulk upload
+static u32 s_uFileUploadBulkCompletedTime = 0;
+
+// Bulk download (see base/file_transfer.h): the file is kept in memory while the controller requests windows of segments
+static u8* s_pFileTransferData = NULL;
+static u32 s_uFileTransferFileId = 0;
+static u32 s_uFileTransferId = 0;
+static u32 s_uFileTransferSize = 0;
+static u32 s_uFileTransferWindowStart = 0;
+static u32 s_uFileTransferPendingBitmap[FILE_TRANSFER_WINDOW_BITMAP_WORDS];
+static u32 s_uFileTransferLastRequestTime = 0;
+static t_file_transfer_pacing s_FileTransferPacing;
 
 
 u8 s_bufferModelSettings[2048];
 int s_bufferModelSettingsLength = 0;
 
+// Model sync with the controller (see base/models_sync.h): model sections as the controller confirmed (acked) it has them,
+// and the sections of the last transfer, waiting for the controller's ack
+static bool s_bModelSyncControllerSupport = false;
+static u32 s_uModelSyncTransferId = 0;
+static bool s_bModelSyncAckedSectionsValid = false;
+static u8 s_uModelSyncAckedSections[MODEL_BINARY_SECTIONS_COUNT][MODEL_SYNC_MAX_SECTION_SIZE];
+static int s_iModelSyncAckedSectionsSize[MODEL_BINARY_SECTIONS_COUNT];
+static u32 s_uModelSyncPendingTransferId = 0; // 0: no transfer waiting for ack
+static u32 s_uModelSyncPendingTime = 0;
+static int s_iModelSyncPendingRetries = 0;
+static bool s_bModelSyncPendingIsReply = false; // Reply to a get all params command: the controller retries the command if needed
+static u8 s_uModelSyncPendingSections[MODEL_BINARY_SECTIONS_COUNT][MODEL_SYNC_MAX_SECTION_SIZE];
+static int s_iModelSyncPendingSectionsSize[MODEL_BINARY_SECTIONS_COUNT];
+
+#define MODEL_SYNC_ACK_TIMEOUT_MS 1500
+#define MODEL_SYNC_MAX_RETRIES 3
+
 void signalReloadModel(u32 uChangeType, u8 uExtraParam);
+void send_model_settings_to_controller();
 
 
 // Returns true if it was updated
@@ -237,8 +271,232 @@ void populate_model_settings_buffer()
 }
 
 
+void _model_sync_send_packets(t_packet_header_model_section* pPHMS, u8* pData, int iSize)
+{
+   int iCountSegments = (iSize + MODEL_SYNC_SEGMENT_SIZE - 1) / MODEL_SYNC_SEGMENT_SIZE;
+   if ( 0 == iCountSegments )
+      iCountSegments = 1;
+   pPHMS->uSegmentsCount = (u8)iCountSegments;
+
+   for( int iSegment=0; iSegment<iCountSegments; iSegment++ )
+   {
+      int iPos = iSegment * MODEL_SYNC_SEGMENT_SIZE;
+      int iSegmentSize = iSize - iPos;
+      if ( iSegmentSize > MODEL_SYNC_SEGMENT_SIZE )
+         iSegmentSize = MODEL_SYNC_SEGMENT_SIZE;
+      pPHMS->uSegmentIndex = (u8)iSegment;
+
+      t_packet_header PH;
+      radio_packet_init(&PH, PACKET_COMPONENT_RUBY, PACKET_TYPE_RUBY_MODEL_SECTION, STREAM_ID_DATA);
+      PH.vehicle_id_src = g_pCurrentModel->uVehicleId;
+      PH.total_length = sizeof(t_packet_header) + sizeof(t_packet_header_model_section) + iSegmentSize;
+
+      u8 packet[MAX_PACKET_TOTAL_SIZE];
+      memcpy(packet, (u8*)&PH, sizeof(t_packet_header));
+      memcpy(packet + sizeof(t_packet_header), (u8*)pPHMS, sizeof(t_packet_header_model_section));
+      memcpy(packet + sizeof(t_packet_header) + sizeof(t_packet_header_model_section), pData + iPos, iSegmentSize);
+      ruby_ipc_channel_send_message(s_fIPCToRouter, packet, PH.total_length);
+   }
+
+   if ( NULL != g_pProcessStats )
+      g_pProcessStats->lastIPCOutgoingTime = g_TimeNow;
+   if ( NULL != g_pProcessStats )
+      g_pProcessStats->lastActiveTime = get_current_timestamp_ms();
+}
+
+// Returns the total encoded size of the sections, or -1 on error
+
+int _model_sync_get_sections_encoded_size(u32 uSectionsMask)
+{
+   u8 uData[MODEL_SYNC_MAX_SECTION_SIZE];
+   u8 uEncoded[MODEL_SYNC_MAX_ENCODED_SIZE];
+   int iTotalSize = 0;
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      if ( ! (uSectionsMask & (((u32)1) << i)) )
+         continue;
+      int iSize = models_sync_get_section_data(g_pCurrentModel, i+1, uData, sizeof(uData));
+      if ( iSize <= 0 )
+         return -1;
+      int iEncodedSize = models_sync_encode(uData, iSize, uEncoded, sizeof(uEncoded));
+      if ( iEncodedSize <= 0 )
+         return -1;
+      iTotalSize += iEncodedSize;
+   }
+   return iTotalSize;
+}
+
+// The sections are used as the base for the next changes only after the controller acks them
+
+void _model_sync_set_pending_sections(u32 uTransferId, bool bIsReply)
+{
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+      s_iModelSyncPendingSectionsSize[i] = models_sync_get_section_data(g_pCurrentModel, i+1, &(s_uModelSyncPendingSections[i][0]), MODEL_SYNC_MAX_SECTION_SIZE);
+   s_uModelSyncPendingTransferId = uTransferId;
+   s_uModelSyncPendingTime = g_TimeNow;
+   s_bModelSyncPendingIsReply = bIsReply;
+}
+
+bool _model_sync_pending_sections_match(t_model_sync_hashes* pHashes)
+{
+   t_model_sync_hashes hashes;
+   memset(&hashes, 0, sizeof(t_model_sync_hashes));
+   hashes.uFormatVersion = MODEL_SYNC_FORMAT_VERSION;
+   hashes.uSectionsCount = MODEL_BINARY_SECTIONS_COUNT;
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      if ( s_iModelSyncPendingSectionsSize[i] <= 0 )
+         return false;
+      hashes.uSectionSize[i] = (u16)s_iModelSyncPendingSectionsSize[i];
+      hashes.uSectionCRC[i] = base_compute_crc32(&(s_uModelSyncPendingSections[i][0]), s_iModelSyncPendingSectionsSize[i]);
+   }
+   return (0 == models_sync_get_changed_sections(&hashes, pHashes));
+}
+
+// Sends the model sections that changed since they were last sent to controller, as patches if the changes are small.
+// Returns false if the controller does not support model sync (full model settings must be sent)
+
+bool _model_sync_send_changes_to_controller()
+{
+   if ( (! s_bModelSyncControllerSupport) || (! s_bModelSyncAckedSectionsValid) )
+      return false;
+
+   u8 uData[MODEL_BINARY_SECTIONS_COUNT][MODEL_SYNC_MAX_SECTION_SIZE];
+   int iSizes[MODEL_BINARY_SECTIONS_COUNT];
+   u32 uSectionsMask = 0;
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      iSizes[i] = models_sync_get_section_data(g_pCurrentModel, i+1, &(uData[i][0]), MODEL_SYNC_MAX_SECTION_SIZE);
+      if ( (iSizes[i] <= 0) || (iSizes[i] != s_iModelSyncAckedSectionsSize[i]) )
+         return false;
+      if ( 0 != memcmp(&(uData[i][0]), &(s_uModelSyncAckedSections[i][0]), iSizes[i]) )
+         uSectionsMask |= (((u32)1) << i);
+   }
+
+   if ( 0 == uSectionsMask )
+   {
+      log_line("[ModelSync] Controller already has the current model settings. Nothing to send.");
+      s_uModelSyncPendingTransferId = 0;
+      return true;
+   }
+
+   s_uModelSyncTransferId++;
+   int iTotalSent = 0;
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      if ( ! (uSectionsMask & (((u32)1) << i)) )
+         continue;
+
+      t_packet_header_model_section PHMS;
+      memset(&PHMS, 0, sizeof(t_packet_header_model_section));
+      PHMS.uTransferId = s_uModelSyncTransferId;
+      PHMS.uSectionsMask = uSectionsMask;
+      PHMS.uSectionId = (u8)(i+1);
+      PHMS.uSectionCRC = base_compute_crc32(&(uData[i][0]), iSizes[i]);
+
+      int iOffset = 0;
+      int iLength = 0;
+      models_sync_get_changed_range(&(s_uModelSyncAckedSections[i][0]), &(uData[i][0]), iSizes[i], &iOffset, &iLength);
+      if ( iLength <= MODEL_SYNC_MAX_PATCH_SIZE )
+      {
+         PHMS.uFlags = MODEL_SECTION_FLAG_PATCH;
+         PHMS.uOffset = (u16)iOffset;
+         PHMS.uTotalSize = (u16)iLength;
+         PHMS.uBaseCRC = base_compute_crc32(&(s_uModelSyncAckedSections[i][0]), iSizes[i]);
+         _model_sync_send_packets(&PHMS, &(uData[i][0]) + iOffset, iLength);
+         iTotalSent += iLength;
+         continue;
+      }
+
+      u8 uEncoded[MODEL_SYNC_MAX_ENCODED_SIZE];
+      int iEncodedSize = models_sync_encode(&(uData[i][0]), iSizes[i], uEncoded, sizeof(uEncoded));
+      if ( iEncodedSize <= 0 )
+         return false;
+      PHMS.uTotalSize = (u16)iEncodedSize;
+      _model_sync_send_packets(&PHMS, uEncoded, iEncodedSize);
+      iTotalSent += iEncodedSize;
+   }
+
+   _model_sync_set_pending_sections(s_uModelSyncTransferId, false);
+   log_line("[ModelSync] Sent changed model sections to controller (transfer id %u, sections mask: 0x%X), %d bytes. Waiting for ack.", s_uModelSyncTransferId, uSectionsMask, iTotalSent);
+   return true;
+}
+
+// The controller sent the hashes of its model after it applied the sections of a transfer
+
+void _model_sync_on_ack(u8* pData)
+{
+   u32 uTransferId = 0;
+   t_model_sync_hashes controllerHashes;
+   memcpy((u8*)&uTransferId, pData, sizeof(u32));
+   memcpy((u8*)&controllerHashes, pData + sizeof(u32), sizeof(t_model_sync_hashes));
+
+   if ( (0 == s_uModelSyncPendingTransferId) || (uTransferId != s_uModelSyncPendingTransferId) )
+   {
+      log_line("[ModelSync] Received ack for transfer id %u, not the pending one (%u). Ignoring it.", uTransferId, s_uModelSyncPendingTransferId);
+      return;
+   }
+   s_uModelSyncPendingTransferId = 0;
+   s_iModelSyncPendingRetries = 0;
+
+   if ( ! _model_sync_pending_sections_match(&controllerHashes) )
+   {
+      log_softerror_and_alarm("[ModelSync] Controller model does not match the sent model sections (transfer id %u). Send full model settings.", uTransferId);
+      s_bModelSyncAckedSectionsValid = false;
+      send_model_settings_to_controller();
+      return;
+   }
+
+   memcpy(s_uModelSyncAckedSections, s_uModelSyncPendingSections, sizeof(s_uModelSyncAckedSections));
+   memcpy(s_iModelSyncAckedSectionsSize, s_iModelSyncPendingSectionsSize, sizeof(s_iModelSyncAckedSectionsSize));
+   s_bModelSyncAckedSectionsValid = true;
+   log_line("[ModelSync] Controller acked transfer id %u, model sections match.", uTransferId);
+}
+
+// Sends the changes again if the controller did not ack them, full model settings after too many retries
+
+void _model_sync_check_pending_ack()
+{
+   if ( 0 == s_uModelSyncPendingTransferId )
+      return;
+
+   // Replies to get all params: the controller retries the command, the ack only confirms the sections
+   if ( s_bModelSyncPendingIsReply )
+   {
+      if ( g_TimeNow > s_uModelSyncPendingTime + 4*MODEL_SYNC_ACK_TIMEOUT_MS )
+      {
+         log_line("[ModelSync] No ack from controller for the model sections reply (transfer id %u).", s_uModelSyncPendingTransferId);
+         s_uModelSyncPendingTransferId = 0;
+      }
+      return;
+   }
+
+   if ( g_TimeNow < s_uModelSyncPendingTime + MODEL_SYNC_ACK_TIMEOUT_MS )
+      return;
+
+   s_iModelSyncPendingRetries++;
+   if ( s_iModelSyncPendingRetries > MODEL_SYNC_MAX_RETRIES )
+   {
+      log_softerror_and_alarm("[ModelSync] No ack from controller for the changed model sections (transfer id %u) after %d retries. Send full model settings.", s_uModelSyncPendingTransferId, MODEL_SYNC_MAX_RETRIES);
+      s_iModelSyncPendingRetries = 0;
+      s_bModelSyncAckedSectionsValid = false;
+      send_model_settings_to_controller();
+      return;
+   }
+   log_line("[ModelSync] No ack from controller for the changed model sections (transfer id %u). Send them again (retry %d).", s_uModelSyncPendingTransferId, s_iModelSyncPendingRetries);
+   if ( ! _model_sync_send_changes_to_controller() )
+   {
+      s_iModelSyncPendingRetries = 0;
+      send_model_settings_to_controller();
+   }
+}
+
 void send_model_settings_to_controller()
 {
+   if ( _model_sync_send_changes_to_controller() )
+      return;
+
+   s_uModelSyncPendingTransferId = 0;
    populate_model_settings_buffer();
 
    if ( 0 == s_bufferModelSettingsLength || s_bufferModelSettingsLength > MAX_PACKET_PAYLOAD )
@@ -552,6 +810,74 @@ void sendCommandReply(u8 responseFlags, int iResponseExtraParam, int delayMiliSe
 }
 
 
+// Replies to a get all params command that has the controller's model sections hashes, with the changed sections only.
+// Returns false if the full model settings must be sent instead
+
+bool _model_sync_reply_with_changed_sections(t_model_sync_hashes* pControllerHashes, bool bNewCommand)
+{
+   t_model_sync_hashes hashes;
+   models_sync_compute_hashes(g_pCurrentModel, &hashes);
+   u32 uSectionsMask = models_sync_get_changed_sections(&hashes, pControllerHashes);
+   if ( MAX_U32 == uSectionsMask )
+   {
+      log_line("[ModelSync] Controller has a different model layout. Send full model settings.");
+      s_bModelSyncControllerSupport = false;
+      s_bModelSyncAckedSectionsValid = false;
+      s_uModelSyncPendingTransferId = 0;
+      return false;
+   }
+
+   s_bModelSyncControllerSupport = true;
+
+   int iSize = _model_sync_get_sections_encoded_size(uSectionsMask);
+   if ( (iSize < 0) || (iSize >= s_ZIPParams_Model_BufferLength) )
+   {
+      log_line("[ModelSync] Changed model sections (mask 0x%X, %d bytes) are not smaller than the full model settings (%d bytes). Send full model settings.", uSectionsMask, iSize, s_ZIPParams_Model_BufferLength);
+      // The full model settings are the command response, the controller requests them again until it gets them
+      for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+         s_iModelSyncAckedSectionsSize[i] = models_sync_get_section_data(g_pCurrentModel, i+1, &(s_uModelSyncAckedSections[i][0]), MODEL_SYNC_MAX_SECTION_SIZE);
+      s_bModelSyncAckedSectionsValid = true;
+      s_uModelSyncPendingTransferId = 0;
+      return false;
+   }
+
+   // Retries of the same command use the same transfer id, so the controller keeps the segments it already has
+   if ( bNewCommand )
+      s_uModelSyncTransferId++;
+
+   u8 uBuffer[sizeof(t_model_sync_hashes) + 2*sizeof(u32)];
+   memcpy(uBuffer, (u8*)&hashes, sizeof(t_model_sync_hashes));
+   memcpy(uBuffer + sizeof(t_model_sync_hashes), (u8*)&s_uModelSyncTransferId, sizeof(u32));
+   memcpy(uBuffer + sizeof(t_model_sync_hashes) + sizeof(u32), (u8*)&uSectionsMask, sizeof(u32));
+   setCommandReplyBuffer(uBuffer, sizeof(uBuffer));
+   sendCommandReply(COMMAND_RESPONSE_FLAGS_OK, COMMAND_GET_ALL_PARAMS_RESPONSE_MODEL_SYNC, 20);
+
+   u8 uData[MODEL_SYNC_MAX_SECTION_SIZE];
+   u8 uEncoded[MODEL_SYNC_MAX_ENCODED_SIZE];
+   for( int i=0; i<MODEL_BINARY_SECTIONS_COUNT; i++ )
+   {
+      if ( ! (uSectionsMask & (((u32)1) << i)) )
+         continue;
+      int iDataSize = models_sync_get_section_data(g_pCurrentModel, i+1, uData, sizeof(uData));
+      int iEncodedSize = models_sync_encode(uData, iDataSize, uEncoded, sizeof(uEncoded));
+      t_packet_header_model_section PHMS;
+      memset(&PHMS, 0, sizeof(t_packet_header_model_section));
+      PHMS.uTransferId = s_uModelSyncTransferId;
+      PHMS.uSectionsMask = uSectionsMask;
+      PHMS.uSectionId = (u8)(i+1);
+      PHMS.uTotalSize = (u16)iEncodedSize;
+      PHMS.uSectionCRC = hashes.uSectionCRC[i];
+      _model_sync_send_packets(&PHMS, uEncoded, iEncodedSize);
+   }
+   // Until the controller acks the sections, later changes are sent as full model settings
+   s_bModelSyncAckedSectionsValid = false;
+   _model_sync_set_pending_sections(s_uModelSyncTransferId, true);
+   log_line("[ModelSync] Sent back changed model sections (transfer id %u, sections mask: 0x%X), %d bytes instead of %d bytes of full model settings.",
+      s_uModelSyncTransferId, uSectionsMask, iSize, s_ZIPParams_Model_BufferLength);
+   return true;
+}
+
+
 void save_config_file()
 {
    #if defined (HW_PLATFORM_RASPBERRY)
@@ -580,14 +906,198 @@ void save_config_file()
    #endif
 }
 
+void _file_transfer_release()
+{
+   if ( NULL != s_pFileTransferData )
+      free(s_pFileTransferData);
+   s_pFileTransferData = NULL;
+   s_uFileTransferFileId = 0;
+   s_uFileTransferId = 0;
+   s_uFileTransferSize = 0;
+   memset(s_uFileTransferPendingBitmap, 0, sizeof(s_uFileTransferPendingBitmap));
+}
+
+// Keeps the file in memory for the bulk download; the transfer id is the CRC of the file
+bool _file_transfer_load(u32 uFileId, const char* szFile)
+{
+   FILE* fd = fopen(szFile, "rb");
+   if ( NULL == fd )
+      return false;
+   fseek(fd, 0, SEEK_END);
+   long lSize = ftell(fd);
+   fseek(fd, 0, SEEK_SET);
+
+   if ( (lSize <= 0) || (lSize > FILE_TRANSFER_MAX_FILE_SIZE) )
+   {
+      fclose(fd);
+      log_line("[FileTransfer] File [%s] (%d bytes) can't be sent using bulk transfer.", szFile, (int)lSize);
+      _file_transfer_release();
+      return false;
+   }
+
+   if ( (NULL != s_pFileTransferData) && (s_uFileTransferFileId == uFileId) && (s_uFileTransferSize == (u32)lSize) )
+   {
+      fclose(fd);
+      return true;
+   }
+
+   _file_transfer_release();
+   s_pFileTransferData = (u8*) malloc(lSize);
+   if ( NULL == s_pFileTransferData )
+   {
+      fclose(fd);
+      log_softerror_and_alarm("[FileTransfer] Failed to allocate memory for file [%s] (%d bytes).", szFile, (int)lSize);
+      return false;
+   }
+   if ( lSize != (long)fread(s_pFileTransferData, 1, lSize, fd) )
+   {
+      fclose(fd);
+      log_softerror_and_alarm("[FileTransfer] Failed to read file [%s].", szFile);
+      _file_transfer_release();
+      return false;
+   }
+   fclose(fd);
+
+   s_uFileTransferFileId = uFileId;
+   s_uFileTransferSize = (u32)lSize;
+   s_uFileTransferId = base_compute_crc32(s_pFileTransferData, (int)lSize);
+   s_uFileTransferWindowStart = 0;
+   s_uFileTransferLastRequestTime = g_TimeNow;
+   log_line("[FileTransfer] Loaded file [%s] for bulk transfer: %u bytes, transfer id: %u", szFile, s_uFileTransferSize, s_uFileTransferId);
+   return true;
+}
+
+bool _process_file_download_window_request( u8* pBuffer, int length)
+{
+   if ( length < (int)(sizeof(t_packet_header) + sizeof(t_packet_header_command) + sizeof(t_file_transfer_window)) )
+      return true;
+
+   t_file_transfer_window window;
+   memcpy((u8*)&window, pBuffer + sizeof(t_packet_header) + sizeof(t_packet_header_command), sizeof(t_file_transfer_window));
+
+   // The file was released from memory (no requests for a while): load it again if it's still the same file
+   if ( (NULL == s_pFileTransferData) && (window.uFileId == FILE_ID_VEHICLE_LOGS_ARCHIVE) && (! hw_process_exists("zip")) )
+   {
+      char szFile[MAX_FILE_PATH_SIZE];
+      strcpy(szFile, FOLDER_RUBY_TEMP);
+      strcat(szFile, "logs.zip");
+      if ( access(szFile, R_OK) != -1 )
+         _file_transfer_load(window.uFileId, szFile);
+   }
+
+   if ( (NULL == s_pFileTransferData) || (window.uFileId != s_uFileTransferFileId) || (window.uTransferId != s_uFileTransferId) )
+   {
+      log_softerror_and_alarm("[FileTransfer] Received window request for file id %u, transfer id %u, but there is no such file ready to send.", window.uFileId, window.uTransferId);
+      return true;
+   }
+
+   u32 uSegmentsCount = (s_uFileTransferSize + FILE_TRANSFER_SEGMENT_SIZE - 1) / FILE_TRANSFER_SEGMENT_SIZE;
+   if ( (window.uWindowStart >= uSegmentsCount) || (0 != (window.uWindowStart % FILE_TRANSFER_WINDOW_SEGMENTS)) )
+   {
+      log_softerror_and_alarm("[FileTransfer] Received invalid window request (start segment %u of %u).", window.uWindowStart, uSegmentsCount);
+      return true;
+   }
+
+   // The bitmap in the packed struct is not aligned
+   u32 uAckBitmap[FILE_TRANSFER_WINDOW_BITMAP_WORDS];
+   memcpy(uAckBitmap, window.uAckBitmap, sizeof(uAckBitmap));
+
+   s_uFileTransferWindowStart = window.uWindowStart;
+   memset(s_uFileTransferPendingBitmap, 0, sizeof(s_uFileTransferPendingBitmap));
+   int iCount = file_transfer_get_window_segments(window.uWindowStart, uSegmentsCount);
+   for( int i=0; i<iCount; i++ )
+   {
+      if ( ! file_transfer_bitmap_get(uAckBitmap, i) )
+         file_transfer_bitmap_set(s_uFileTransferPendingBitmap, i);
+   }
+
+   u32 uMaxBytesPerSec = window.uMaxBytesPerSec;
+   if ( 0 == uMaxBytesPerSec )
+      uMaxBytesPerSec = DEFAULT_FILE_TRANSFER_MAX_KBPS * 1000 / 8;
+   if ( uMaxBytesPerSec != s_FileTransferPacing.uMaxBytesPerSec )
+      file_transfer_pacing_init(&s_FileTransferPacing, uMaxBytesPerSec, g_TimeNow);
+   s_uFileTransferLastRequestTime = g_TimeNow;
+   return true;
+}
+
+// Sends the pending segments of the current window, as allowed by the bandwidth cap. Returns true if segments are still pending.
+bool _file_transfer_send_pending_segments()
+{
+   if ( NULL == s_pFileTransferData )
+      return false;
+
+   u32 uSegmentsCount = (s_uFileTransferSize + FILE_TRANSFER_SEGMENT_SIZE - 1) / FILE_TRANSFER_SEGMENT_SIZE;
+   int iCount = file_transfer_get_window_segments(s_uFileTransferWindowStart, uSegmentsCount);
+   bool bSentAny = false;
+   bool bPending = false;
+
+   for( int i=0; i<iCount; i++ )
+   {
+      if ( ! file_transfer_bitmap_get(s_uFileTransferPendingBitmap, i) )
+         continue;
+
+      u32 uIndex = s_uFileTransferWindowStart + (u32)i;
+      u32 uOffset = uIndex * FILE_TRANSFER_SEGMENT_SIZE;
+      int iSize = (int)(s_uFileTransferSize - uOffset);
+      if ( iSize > FILE_TRANSFER_SEGMENT_SIZE )
+         iSize = FILE_TRANSFER_SEGMENT_SIZE;
+
+      t_packet_header_file_transfer_segment PHFTS;
+      PHFTS.uFileId = s_uFileTransferFileId;
+      PHFTS.uTransferId = s_uFileTransferId;
+      PHFTS.uFileSize = s_uFileTransferSize;
+      PHFTS.uSegmentIndex = uIndex;
+      PHFTS.uSegmentSize = FILE_TRANSFER_SEGMENT_SIZE;
+      PHFTS.uFlags = 0;
+
+      u8 packet[MAX_PACKET_TOTAL_SIZE];
+      u8* pData = packet + sizeof(t_packet_header) + sizeof(t_packet_header_file_transfer_segment);
+      int iDataSize = file_transfer_compress(s_pFileTransferData + uOffset, iSize, pData, iSize);
+      if ( iDataSize > 0 )
+         PHFTS.uFlags |= FILE_TRANSFER_SEGMENT_FLAG_COMPRESSED;
+      else
+      {
+         memcpy(pData, s_pFileTransferData + uOffset, iSize);
+         iDataSize = iSize;
+      }
+      PHFTS.uDataSize = (u16)iDataSize;
+
+      t_packet_header PH;
+      radio_packet_init(&PH, PACKET_COMPONENT_RUBY, PACKET_TYPE_RUBY_FILE_TRANSFER_SEGMENT, STREAM_ID_DATA);
+      PH.vehicle_id_src = g_pCurrentModel->uVehicleId;
+      PH.total_length = sizeof(t_packet_header) + sizeof(t_packet_header_file_transfer_segment) + iDataSize;
+
+      if ( ! file_transfer_pacing_consume(&s_FileTransferPacing, PH.total_length, get_current_timestamp_ms()) )
+      {
+         bPending = true;
+         break;
+      }
+
+      memcpy(packet, (u8*)&PH, sizeof(t_packet_header));
+      memcpy(packet + sizeof(t_packet_header), (u8*)&PHFTS, sizeof(t_packet_header_file_transfer_segment));
+      ruby_ipc_channel_send_message(s_fIPCToRouter, packet, PH.total_length);
+      file_transfer_bitmap_clear(s_uFileTransferPendingBitmap, i);
+      bSentAny = true;
+   }
+
+   if ( bSentAny )
+   if ( NULL != g_pProcessStats )
+      g_pProcessStats->lastIPCOutgoingTime = g_TimeNow;
+   return bPending;
+}
+
 bool _process_file_download_request( u8* pBuffer, int length)
 {
    t_packet_header_command* pPHC = (t_packet_header_command*)(pBuffer + sizeof(t_packet_header));
 
    t_packet_header_download_file_info PHDFInfo;
+   t_packet_header_download_file_bulk_info PHDFBulkInfo;
+   memset((u8*)&PHDFBulkInfo, 0, sizeof(t_packet_header_download_file_bulk_info));
+   bool bBulkTransfer = false;
 
-   u32 uFileId = pPHC->command_param & 0x00FFFFFF;
+   u32 uFileId = pPHC->command_param & 0x007FFFFF;
    bool bCheckStatus = (pPHC->command_param & 0xFF000000)?true:false;
+   bool bResume = (pPHC->command_param & COMMAND_DOWNLOAD_FILE_FLAG_RESUME)?true:false;
    PHDFInfo.file_id = uFileId;
    PHDFInfo.szFileName[0] = 0;
    PHDFInfo.segments_count = 0;
@@ -624,6 +1134,15 @@ bool _process_file_download_request( u8* pBuffer, int length)
                if ( fSize % PHDFInfo.segment_size )
                   PHDFInfo.segments_count++;
                log_line("File logs archive: %u bytes, %d segments, %d bytes/segment", fSize, PHDFInfo.segments_count, PHDFInfo.segment_size );
+
+               if ( _file_transfer_load(uFileId, szFile) )
+               {
+                  bBulkTransfer = true;
+                  PHDFBulkInfo.uTransferId = s_uFileTransferId;
+                  PHDFBulkInfo.uFileSize = s_uFileTransferSize;
+                  PHDFBulkInfo.uSegmentSize = FILE_TRANSFER_SEGMENT_SIZE;
+                  PHDFBulkInfo.uWindowSegments = FILE_TRANSFER_WINDOW_SEGMENTS;
+               }
             }
             else
                log_softerror_and_alarm("Failed to create archive with log files in file [%s]", szFile);
@@ -631,15 +1150,28 @@ bool _process_file_download_request( u8* pBuffer, int length)
       }
       else
       {
-         char szComm[256];
-         sprintf(szComm, "rm -rf %s/logs.zip", FOLDER_RUBY_TEMP);
-         hw_execute_bash_command(szComm, NULL);
-         sprintf(szComm, "zip %s/logs.zip %s/* > /dev/null 2>&1 &", FOLDER_RUBY_TEMP, FOLDER_LOGS);
-         hw_execute_bash_command(szComm, NULL);
+         char szFile[MAX_FILE_PATH_SIZE];
+         strcpy(szFile, FOLDER_RUBY_TEMP);
+         strcat(szFile, "logs.zip");
+         if ( bResume && (access(szFile, R_OK) != -1) )
+            log_line("Keep the existing logs archive, to resume the download.");
+         else
+         {
+            _file_transfer_release();
+            char szComm[256];
+            sprintf(szComm, "rm -rf %s/logs.zip", FOLDER_RUBY_TEMP);
+            hw_execute_bash_command(szComm, NULL);
+            sprintf(szComm, "zip %s/logs.zip %s/* > /dev/null 2>&1 &", FOLDER_RUBY_TEMP, FOLDER_LOGS);
+            hw_execute_bash_command(szComm, NULL);
+         }
       }
    }
 
-   setCommandReplyBuffer((u8*)&PHDFInfo, sizeof(PHDFInfo));
+   // Controllers that do not know about bulk transfers just ignore the extra info
+   u8 uBuffer[sizeof(t_packet_header_download_file_info) + sizeof(t_packet_header_download_file_bulk_info)];
+   memcpy(uBuffer, (u8*)&PHDFInfo, sizeof(t_packet_header_download_file_info));
+   memcpy(uBuffer + sizeof(t_packet_header_download_file_info), (u8*)&PHDFBulkInfo, sizeof(t_packet_header_download_file_bulk_info));
+   setCommandReplyBuffer(uBuffer, bBulkTransfer?sizeof(uBuffer):sizeof(t_packet_header_download_file_info));
    sendCommandReply(COMMAND_RESPONSE_FLAGS_OK, 0, 0);
    return true;
 }
@@ -747,10 +1279,13 @@ bool _process_file_segment_upload_request( u8* pBuffer, int length)
    log_line("Received request to upload file segment %u of %u (%d bytes) for file [%s], file id: %u", segmentData.uSegmentIndex+1, segmentData.uTotalSegments, segmentData.uSegmentSize, segmentData.szFileName, segmentData.uFileId);
 
 
+   // Segments left from a bulk upload are allocated only as they are received
    if ( (s_InfoLastFileUploaded.uLastFileId != segmentData.uFileId) ||
         (s_InfoLastFileUploaded.uTotalSegments != segmentData.uTotalSegments) ||
-        (s_InfoLastFileUploaded.uFileSize != segmentData.uTotalFileSize) )
+        (s_InfoLastFileUploaded.uFileSize != segmentData.uTotalFileSize) ||
+        (0 != s_uFileUploadBulkTransferId) )
    {
+      s_uFileUploadBulkTransferId = 0;
       for( u32 u=0; u<s_InfoLastFileUploaded.uTotalSegments; u++ )
       {
          if ( NULL != s_InfoLastFileUploaded.pSegments[u] )
@@ -825,6 +1360,179 @@ bool _process_file_segment_upload_request( u8* pBuffer, int length)
 }
 
 
+void _file_upload_release_segments()
+{
+   for( u32 u=0; u<s_InfoLastFileUploaded.uTotalSegments; u++ )
+   {
+      if ( NULL != s_InfoLastFileUploaded.pSegments[u] )
+         free(s_InfoLastFileUploaded.pSegments[u]);
+      s_InfoLastFileUploaded.pSegments[u] = NULL;
+   }
+   s_InfoLastFileUploaded.uLastFileId = MAX_U32;
+   s_InfoLastFileUploaded.uTotalSegments = 0;
+   s_uFileUploadBulkTransferId = 0;
+}
+
+bool _process_file_bulk_segment_upload_request( u8* pBuffer, int length)
+{
+   int iParamsLength = length - sizeof(t_packet_header) - sizeof(t_packet_header_command);
+   if ( iParamsLength < (int)sizeof(t_packet_header_file_transfer_segment) )
+   {
+      sendCommandReply(COMMAND_RESPONSE_FLAGS_FAILED_INVALID_PARAMS, 0, 0);
+      return true;
+   }
+
+   t_packet_header_file_transfer_segment PHFTS;
+   memcpy((u8*)&PHFTS, pBuffer + sizeof(t_packet_header) + sizeof(t_packet_header_command), sizeof(t_packet_header_file_transfer_segment));
+   u8* pData = pBuffer + sizeof(t_packet_header) + sizeof(t_packet_header_command) + sizeof(t_packet_header_file_transfer_segment);
+
+   u32 uSegmentsCount = 0;
+   if ( (PHFTS.uSegmentSize > 0) && (PHFTS.uSegmentSize <= FILE_TRANSFER_SEGMENT_SIZE) )
+      uSegmentsCount = (PHFTS.uFileSize + PHFTS.uSegmentSize - 1) / PHFTS.uSegmentSize;
+
+   if ( (0 == uSegmentsCount) || (uSegmentsCount > MAX_SEGMENTS_FILE_UPLOAD) || (PHFTS.uSegmentIndex >= uSegmentsCount) ||
+        ((int)PHFTS.uDataSize > iParamsLength - (int)sizeof(t_packet_header_file_transfer_segment)) )
+   {
+      log_softerror_and_alarm("[FileTransfer] Received invalid bulk upload segment %u (segment size: %d, file size: %u)", PHFTS.uSegmentIndex, (int)PHFTS.uSegmentSize, PHFTS.uFileSize);
+      sendCommandReply(COMMAND_RESPONSE_FLAGS_FAILED_INVALID_PARAMS, 0, 0);
+      return true;
+   }
+
+   t_file_transfer_window window;
+   memset((u8*)&window, 0, sizeof(t_file_transfer_window));
+   window.uFileId = PHFTS.uFileId;
+   window.uTransferId = PHFTS.uTransferId;
+   window.uWindowStart = PHFTS.uSegmentIndex - (PHFTS.uSegmentIndex % FILE_TRANSFER_WINDOW_SEGMENTS);
+   int iWindowCount = file_transfer_get_window_segments(window.uWindowStart, uSegmentsCount);
+   u32 uAckBitmap[FILE_TRANSFER_WINDOW_BITMAP_WORDS];
+   memset(uAckBitmap, 0, sizeof(uAckBitmap));
+
+   // Segments of an upload that was just completed (the last acknowledge was lost): just acknowledge them.
+   // Only for a short time, so a later upload of the same file is installed again.
+   if ( (0 != s_uFileUploadBulkCompletedId) && (g_TimeNow > s_uFileUploadBulkCompletedTime + 5000) )
+      s_uFileUploadBulkCompletedId = 0;
+
+   if ( (0 != s_uFileUploadBulkCompletedId) && (PHFTS.uTransferId == s_uFileUploadBulkCompletedId) )
+   {
+      for( int i=0; i<iWindowCount; i++ )
+         file_transfer_bitmap_set(uAckBitmap, i);
+      memcpy(window.uAckBitmap, uAckBitmap, sizeof(uAckBitmap));
+      setCommandReplyBuffer((u8*)&window, sizeof(t_file_transfer_window));
+      sendCommandReply(COMMAND_RESPONSE_FLAGS_OK, 0, 0);
+      return true;
+   }
+
+   if ( (s_InfoLastFileUploaded.uLastFileId != PHFTS.uFileId) || (s_uFileUploadBulkTransferId != PHFTS.uTransferId) )
+   {
+      _file_upload_release_segments();
+      s_uFileUploadBulkCompletedId = 0;
+      log_line("[FileTransfer] Start receiving bulk upload of file id %u, %u bytes, %u segments, transfer id: %u", PHFTS.uFileId, PHFTS.uFileSize, uSegmentsCount, PHFTS.uTransferId);
+      s_InfoLastFileUploaded.uLastFileId = PHFTS.uFileId;
+      s_InfoLastFileUploaded.szFileName[0] = 0;
+      s_InfoLastFileUploaded.uFileSize = PHFTS.uFileSize;
+      s_InfoLastFileUploaded.uTotalSegments = uSegmentsCount;
+      s_uFileUploadBulkTransferId = PHFTS.uTransferId;
+      for( u32 u=0; u<uSegmentsCount; u++ )
+      {
+         s_InfoLastFileUploaded.pSegments[u] = NULL;
+         s_InfoLastFileUploaded.uSegmentsSize[u] = 0;
+         s_InfoLastFileUploaded.bSegmentsReceived[u] = false;
+      }
+   }
+
+   u32 uIndex = PHFTS.uSegmentIndex;
+   int iSegmentSize = (int)(PHFTS.uFileSize - uIndex * PHFTS.uSegmentSize);
+   if ( iSegmentSize > (int)PHFTS.uSegmentSize )
+      iSegmentSize = (int)PHFTS.uSegmentSize;
+
+   if ( ! s_InfoLastFileUploaded.bSegmentsReceived[uIndex] )
+   {
+      if ( NULL == s_InfoLastFileUploaded.pSegments[uIndex] )
+         s_InfoLastFileUploaded.pSegments[uIndex] = (u8*)malloc(PHFTS.uSegmentSize);
+      if ( NULL == s_InfoLastFileUploaded.pSegments[uIndex] )
+      {
+         _file_upload_release_segments();
+         sendCommandReply(COMMAND_RESPONSE_FLAGS_FAILED, 0, 0);
+         return true;
+      }
+
+      int iSize = -1;
+      if ( PHFTS.uFlags & FILE_TRANSFER_SEGMENT_FLAG_COMPRESSED )
+         iSize = file_transfer_decompress(pData, PHFTS.uDataSize, s_InfoLastFileUploaded.pSegments[uIndex], iSegmentSize);
+      else if ( PHFTS.uDataSize == iSegmentSize )
+      {
+         memcpy(s_InfoLastFileUploaded.pSegments[uIndex], pData, iSegmentSize);
+         iSize = iSegmentSize;
+      }
+
+      if ( iSize == iSegmentSize )
+      {
+         s_InfoLastFileUploaded.uSegmentsSize[uIndex] = (u32)iSegmentSize;
+         s_InfoLastFileUploaded.bSegmentsReceived[uIndex] = true;
+      }
+      else
+         log_softerror_and_alarm("[FileTransfer] Received invalid data for bulk upload segment %u", uIndex);
+   }
+
+   bool bReceivedAll = true;
+   for( u32 u=0; u<s_InfoLastFileUploaded.uTotalSegments; u++ )
+   {
+      if ( ! s_InfoLastFileUploaded.bSegmentsReceived[u] )
+      {
+         bReceivedAll = false;
+         break;
+      }
+   }
+
+   if ( bReceivedAll )
+   {
+      bool bValidFile = false;
+      u8* pFile = (u8*) malloc(s_InfoLastFileUploaded.uFileSize);
+      if ( NULL != pFile )
+      {
+         u32 uPos = 0;
+         for( u32 u=0; u<s_InfoLastFileUploaded.uTotalSegments; u++ )
+         {
+            memcpy(pFile + uPos, s_InfoLastFileUploaded.pSegments[u], s_InfoLastFileUploaded.uSegmentsSize[u]);
+            uPos += s_InfoLastFileUploaded.uSegmentsSize[u];
+         }
+         bValidFile = (base_compute_crc32(pFile, (int)s_InfoLastFileUploaded.uFileSize) == PHFTS.uTransferId);
+         free(pFile);
+      }
+
+      if ( bValidFile )
+      {
+         log_line("[FileTransfer] Received entire file id %u using bulk upload, %u bytes", s_InfoLastFileUploaded.uLastFileId, s_InfoLastFileUploaded.uFileSize);
+         _process_received_uploaded_file();
+         _file_upload_release_segments();
+         s_uFileUploadBulkCompletedId = PHFTS.uTransferId;
+         s_uFileUploadBulkCompletedTime = g_TimeNow;
+         for( int i=0; i<iWindowCount; i++ )
+            file_transfer_bitmap_set(uAckBitmap, i);
+      }
+      else
+      {
+         // Corrupted file: receive it again
+         log_softerror_and_alarm("[FileTransfer] Received file id %u has an invalid CRC. Receive it again.", s_InfoLastFileUploaded.uLastFileId);
+         for( u32 u=0; u<s_InfoLastFileUploaded.uTotalSegments; u++ )
+            s_InfoLastFileUploaded.bSegmentsReceived[u] = false;
+      }
+   }
+   else
+   {
+      for( int i=0; i<iWindowCount; i++ )
+      {
+         if ( s_InfoLastFileUploaded.bSegmentsReceived[window.uWindowStart + i] )
+            file_transfer_bitmap_set(uAckBitmap, i);
+      }
+   }
+
+   memcpy(window.uAckBitmap, uAckBitmap, sizeof(uAckBitmap));
+   setCommandReplyBuffer((u8*)&window, sizeof(t_file_transfer_window));
+   sendCommandReply(COMMAND_RESPONSE_FLAGS_OK, 0, 0);
+   return true;
+}
+
 // returns true if it knows about the command, false if it's an unknown command
 
 bool process_command(u8* pBuffer, int length)
@@ -918,6 +1626,23 @@ bool process_command(u8* pBuffer, int length)
       return _process_file_segment_upload_request( pBuffer, length);    
    }
 
+   if ( uCommandType == COMMAND_ID_DOWNLOAD_FILE_WINDOW )
+   {
+      return _process_file_download_window_request( pBuffer, length);
+   }
+
+   if ( uCommandType == COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT )
+   {
+      return _process_file_bulk_segment_upload_request( pBuffer, length);
+   }
+
+   if ( uCommandType == COMMAND_ID_MODEL_SYNC_ACK )
+   {
+      if ( iParamsLength >= (int)(sizeof(u32) + sizeof(t_model_sync_hashes)) )
+         _model_sync_on_ack(pBuffer + sizeof(t_packet_header) + sizeof(t_packet_header_command));
+      return true;
+   }
+
    if ( uCommandType == COMMAND_ID_CLEAR_LOGS )
    {
       sendCommandReply(COMMAND_RESPONSE_FLAGS_OK, 0, 0);
@@ -3099,11 +3824,27 @@ bool process_command(u8* pBuffer, int length)
          }
       }
 
-      setCommandReplyBuffer(s_ZIPParams_Model_Buffer, s_ZIPParams_Model_BufferLength);
-      sendCommandReply(COMMAND_RESPONSE_FLAGS_OK, 1, 20);
-      log_line("Sent back to router all model settings in one single command response. Total compressed size: %d bytes", s_ZIPParams_Model_BufferLength);
-      
-      if ( bSendBackSmallSegments )
+      bool bSentModelSync = false;
+      if ( uCommandParam & COMMAND_GET_ALL_PARAMS_FLAG_MODEL_SYNC )
+      {
+         if ( iParamsLength >= (int)sizeof(t_model_sync_hashes) )
+            bSentModelSync = _model_sync_reply_with_changed_sections((t_model_sync_hashes*)(pBuffer + sizeof(t_packet_header)+sizeof(t_packet_header_command)), bNewZIPCommand);
+      }
+      else
+      {
+         s_bModelSyncControllerSupport = false;
+         s_bModelSyncAckedSectionsValid = false;
+         s_uModelSyncPendingTransferId = 0;
+      }
+
+      if ( ! bSentModelSync )
+      {
+         setCommandReplyBuffer(s_ZIPParams_Model_Buffer, s_ZIPParams_Model_BufferLength);
+         sendCommandReply(COMMAND_RESPONSE_FLAGS_OK, 1, 20);
+         log_line("Sent back to router all model settings in one single command response. Total compressed size: %d bytes", s_ZIPParams_Model_BufferLength);
+      }
+
+      if ( bSendBackSmallSegments && (! bSentModelSync) )
       {
          int iSegmentSize = 150;
          int iPos = 0;
@@ -3633,8 +4374,17 @@ void _periodic_loop()
       }
    }
 
+   if ( NULL != s_pFileTransferData )
+   if ( g_TimeNow > s_uFileTransferLastRequestTime + 60000 )
+   {
+      log_line("[FileTransfer] No more requests for file id %u. Release it from memory.", s_uFileTransferFileId);
+      _file_transfer_release();
+   }
+
    if ( process_sw_upload_is_started() )
       process_sw_upload_check_timeout(g_TimeNow);
+
+   _model_sync_check_pending_ack();
 }
 
 void handle_sigint_rc(int sig) 
@@ -3702,6 +4452,7 @@ int r_start_commands_rx(int argc, char* argv[])
    s_InfoLastFileUploaded.uFileSize = 0;
    s_InfoLastFileUploaded.uTotalSegments = 0;
    s_InfoLastFileUploaded.uLastCommandIdForThisFile = 0;
+   file_transfer_pacing_init(&s_FileTransferPacing, DEFAULT_FILE_TRANSFER_MAX_KBPS * 1000 / 8, get_current_timestamp_ms());
 
    g_TimeNow = get_current_timestamp_ms();
    g_TimeStart = get_current_timestamp_ms();
@@ -3791,12 +4542,12 @@ int r_start_commands_rx(int argc, char* argv[])
                if ( changeType == MODEL_CHANGED_STATS )
                {
                   log_line("Loading model including stats.");
-                  if ( ! g_pCurrentModel->loadFromFile(szFile, true) )
+                  if ( ! models_shared_mem_reload(g_pCurrentModel, szFile, true) )
                      log_error_and_alarm("Can't load current model vehicle.");
                }
                else
                {
-                  if ( ! g_pCurrentModel->loadFromFile(szFile, false) )
+                  if ( ! models_shared_mem_reload(g_pCurrentModel, szFile, false) )
                      log_error_and_alarm("Can't load current model vehicle.");
                }
             }
@@ -3837,6 +4588,9 @@ int r_start_commands_rx(int argc, char* argv[])
             on_received_command(s_BufferCommands, pPH->total_length);
       }
 
+      if ( _file_transfer_send_pending_segments() )
+         iSleepIntervalMS = 2;
+
       u32 tNow = get_current_timestamp_ms();
       if ( NULL != g_pProcessStats )
       {
@@ -40,6 +40,7 @@
 #include "../base/config.h"
 #include "../base/models.h"
 #include "../base/models_list.h"
+#include "../base/models_shared_mem.h"
 #include "../base/ruby_ipc.h"
 #include "../common/string_utils.h"
 
@@ -66,6 +67,7 @@ int s_LastHistorySlice = 0;
 u8 s_LastReceivedRCFrameIndex = 0;
 u8 s_QualityRecvCount[2];
 u8 s_QualityRecvIndex = 0;
+u32 s_uTimeLastRCFrameReceivedMs = 0;
 
 
 sem_t* s_pSemaphoreStop = NULL;
@@ -75,10 +77,39 @@ void process_data_rc_full_frame(u8* pBuffer, int length)
    if ( NULL == s_pPHDownstreamInfoRC )
       return;
 
+   if ( length < (int)(sizeof(t_packet_header) + RC_FULL_FRAME_UPSTREAM_MIN_LENGTH) )
+      return;
+
    t_packet_header_rc_full_frame_upstream* pPHRCF = (t_packet_header_rc_full_frame_upstream*)(pBuffer + sizeof(t_packet_header));
-   memcpy(&s_LastReceivedRCFrame, pPHRCF, sizeof(t_packet_header_rc_full_frame_upstream));
+   if ( length >= (int)(sizeof(t_packet_header) + sizeof(t_packet_header_rc_full_frame_upstream)) )
+      memcpy(&s_LastReceivedRCFrame, pPHRCF, sizeof(t_packet_header_rc_full_frame_upstream));
+   else
+   {
+      // Older controllers don't send the latency fields
+      memset(&s_LastReceivedRCFrame, 0, sizeof(t_packet_header_rc_full_frame_upstream));
+      memcpy(&s_LastReceivedRCFrame, pPHRCF, RC_FULL_FRAME_UPSTREAM_MIN_LENGTH);
+   }
+   pPHRCF = &s_LastReceivedRCFrame;
 
    g_TimeLastFrameReceived = g_TimeNow;
+
+   // Frames interval jitter, relative to the configured RC rate
+   u32 uTimeNowMs = get_current_timestamp_ms();
+   if ( (0 != s_uTimeLastRCFrameReceivedMs) && (0 != sModelVehicle.rc_params.rc_frames_per_second) )
+   {
+      int iInterval = (int)(uTimeNowMs - s_uTimeLastRCFrameReceivedMs);
+      int iJitter = iInterval - 1000/(int)sModelVehicle.rc_params.rc_frames_per_second;
+      if ( iJitter < 0 )
+         iJitter = -iJitter;
+      packet_rc_latency_histogram_add(&s_pPHDownstreamInfoRC->histJitter, (u32)iJitter);
+   }
+   s_uTimeLastRCFrameReceivedMs = uTimeNowMs;
+
+   // Echoed back to the controller (by the telemetry process) for the round trip and stick to FC latency
+   s_pPHDownstreamInfoRC->uLastFrameTimeSentMs = pPHRCF->uTimeSentMs;
+   s_pPHDownstreamInfoRC->uLastFrameInputAgeMs = pPHRCF->uInputAgeMs;
+   s_pPHDownstreamInfoRC->uLastFrameRouterDelayMs = pPHRCF->uRouterDelayMs;
+   s_pPHDownstreamInfoRC->uLastFrameRecvTimeMs = uTimeNowMs;
    s_pPHDownstreamInfoRC->recv_packets++;
    s_QualityRecvCount[s_QualityRecvIndex]++;
 
@@ -214,6 +245,9 @@ int r_start_rx_rc(int argc, char *argv[])
       hardware_sleep_ms(iSleepIntervalMS);
       if ( iSleepIntervalMS < 50 )
          iSleepIntervalMS += 10;
+      // Low latency path: keep polling the router msgqueue often while RC is enabled
+      if ( sModelVehicle.rc_params.rc_enabled && (sModelVehicle.rc_params.flags & RC_FLAGS_LOW_LATENCY_PATH) )
+         iSleepIntervalMS = 2;
 
       int val = 0;
       if ( NULL != s_pSemaphoreStop )
@@ -288,6 +322,8 @@ int r_start_rx_rc(int argc, char *argv[])
       while ( (maxMsgToRead > 0) && (NULL != ruby_ipc_try_read_message(s_fIPC_FromRouter, s_PipeTmpBufferRCFromRouter, &s_PipeTmpBufferRCFromRouterPos, s_BufferRCFromRouter)) )
       {
          iSleepIntervalMS = 2;
+         if ( sModelVehicle.rc_params.flags & RC_FLAGS_LOW_LATENCY_PATH )
+            iSleepIntervalMS = 1;
          maxMsgToRead--;
          t_packet_header* pPH = (t_packet_header*)&s_BufferRCFromRouter[0];
          if ( ! radio_packet_check_crc(s_BufferRCFromRouter, pPH->total_length) )
@@ -308,14 +344,20 @@ int r_start_rx_rc(int argc, char *argv[])
          {
             u8 changeType = (pPH->vehicle_id_src >> 8 ) & 0xFF;
             if ( changeType == MODEL_CHANGED_GENERIC ||
-                 changeType == MODEL_CHANGED_SWAPED_RADIO_INTERFACES )
+                 changeType == MODEL_CHANGED_SWAPED_RADIO_INTERFACES ||
+                 changeType == MODEL_CHANGED_RC_PARAMS )
             {
                log_line("Received request from router to reload model.");
                char szFile[128];
                strcpy(szFile, FOLDER_CONFIG);
                strcat(szFile, FILE_CONFIG_CURRENT_VEHICLE_MODEL);
-               sModelVehicle.loadFromFile(szFile, true);
-               log_line("RC Failsafe timeout: %d ms", sModelVehicle.rc_params.rc_failsafe_timeout_ms);
+               models_shared_mem_reload(&sModelVehicle, szFile, true);
+               log_line("RC Failsafe timeout: %d ms, low latency path: %s", sModelVehicle.rc_params.rc_failsafe_timeout_ms, (sModelVehicle.rc_params.flags & RC_FLAGS_LOW_LATENCY_PATH)?"yes":"no");
+            if ( NULL != s_pPHDownstreamInfoRC )
+            {
+               packet_rc_latency_histogram_reset(&s_pPHDownstreamInfoRC->histJitter);
+               s_uTimeLastRCFrameReceivedMs = 0;
+            }
             }
             else
                log_line("Model change does not affect RX RC. Don't update local model.");
@@ -56,7 +56,10 @@
 #include "../base/hardware_camera.h"
 #include "../base/models.h"
 #include "../base/models_list.h"
+#include "../base/models_shared_mem.h"
 #include "../base/commands.h"
+#include "../base/mavlink_router.h"
+#include "../base/serial_io.h"
 #include "../base/utils.h"
 #include "../base/ruby_ipc.h"
 #include "../base/vehicle_settings.h"
@@ -79,6 +82,11 @@ int s_PipeTmpBufferPos = 0;
 
 int s_iSerialDataLinkHandle = -1;
 int s_fSerialToFC = -1;
+int s_iSerialIOPortDataLink = -1;
+int s_iSerialIOPortFC = -1;
+u32 s_uTimeLastSerialIOStatsLog = 0;
+bool s_bReopenDataLinkSerialPort = false;
+u32 s_uTimeLastDataLinkSerialPortReopen = 0;
 bool bInputFromSTDIN = false;
 bool s_bRetrySetupTelemetry = true;
 
@@ -88,7 +96,7 @@ u32 s_uCurrentTelemetrySerialPortSpeed = DEFAULT_FC_TELEMETRY_SERIAL_SPEED;
 int s_iCurrentDataLinkSerialPortIndex = -1;
 u32 s_uCurrentDataLinkSerialPortSpeed = DEFAULT_FC_TELEMETRY_SERIAL_SPEED;
 
-u8 serialBufferIn[300];
+u8 serialBufferIn[1024];
 u8 serialBufferOut[300];
 
 u8  telemetryBufferFromFC[RAW_TELEMETRY_MAX_BUFFER];
@@ -128,6 +136,9 @@ int s_iFCSerialReadBytesTempLastSecond = 0;
 int s_iFCSerialReadBytesPerSecond = 0;
 
 t_packet_header_rc_info_downstream* s_pPHDownstreamInfoRC = NULL; // Info to send back to ground
+u32 s_uLastRCFrameRecvTimeSentToFC = 0;
+u16 s_uLastRCFrameToFCMs = 0;
+type_rc_latency_histogram s_HistRCToFC;
 
 shared_mem_video_info_stats* s_pSM_VideoInfoStats = NULL;
 shared_mem_video_info_stats* s_pSM_VideoInfoStatsRadioOut = NULL;
@@ -144,6 +155,8 @@ bool home_set = false;
 bool s_bMAVLinkSetupSent = false;
 bool s_bSendRCInfoBack = false;
 bool s_bSendFullMAVLinkBackToController = false;
+bool s_bUseMAVLinkRouter = false;
+u32 s_uTimeLastMAVLinkRouterStatsLog = 0;
 
 u32 s_CountMessagesFromFCPerSecond = 0;
 u32 s_CountMessagesFromFCPerSecondTemp = 0;
@@ -159,6 +172,7 @@ static bool s_bRadioInterfacesReinitIsInProgress = false;
 
 void open_datalink_serial_port();
 void open_telemetry_serial_port();
+void _update_mavlink_router_settings();
 
 int _open_pipes(bool bOpenReadPipes, bool bOpenWritePipes)
 {
@@ -769,6 +783,10 @@ void _send_rc_data_to_FC()
       bSend = true;
    if ( g_TimeNow >= g_TimeLastRCSentToFC + 1000/g_pCurrentModel->rc_params.rc_frames_per_second )
       bSend = true;
+   // Low latency path: forward each new frame as soon as the RX RC process got it
+   bool bNewFrame = (s_uLastRCFrameRecvTimeSentToFC != s_pPHDownstreamInfoRC->uLastFrameRecvTimeMs);
+   if ( bNewFrame && (g_pCurrentModel->rc_params.flags & RC_FLAGS_LOW_LATENCY_PATH) )
+      bSend = true;
 
    if ( ! bSend )
       return;
@@ -831,6 +849,19 @@ void _send_rc_data_to_FC()
    len = mavlink_msg_to_send_buffer(serialBufferOut, &msg);
    if ( len != write(s_fSerialToFC, serialBufferOut, len) )
       log_softerror_and_alarm("Failed to write to serial port to FC");
+
+   if ( bNewFrame && (0 != s_pPHDownstreamInfoRC->uLastFrameRecvTimeMs) )
+   {
+      s_uLastRCFrameRecvTimeSentToFC = s_pPHDownstreamInfoRC->uLastFrameRecvTimeMs;
+      u32 uTimeNowMs = get_current_timestamp_ms();
+      u32 uDelay = 0;
+      if ( uTimeNowMs >= s_uLastRCFrameRecvTimeSentToFC )
+         uDelay = uTimeNowMs - s_uLastRCFrameRecvTimeSentToFC;
+      if ( uDelay > 0xFFFF )
+         uDelay = 0xFFFF;
+      s_uLastRCFrameToFCMs = (u16)uDelay;
+      packet_rc_latency_histogram_add(&s_HistRCToFC, uDelay);
+   }
 }
 
 
@@ -875,7 +906,7 @@ void reload_model(u8 changeType)
    char szFile[128];
    strcpy(szFile, FOLDER_CONFIG);
    strcat(szFile, FILE_CONFIG_CURRENT_VEHICLE_MODEL);
-   if ( ! g_pCurrentModel->loadFromFile(szFile, false) )
+   if ( ! models_shared_mem_reload(g_pCurrentModel, szFile, false) )
       g_pCurrentModel->resetToDefaults(true);
 
    if ( changeType != MODEL_CHANGED_GENERIC )
@@ -956,6 +987,7 @@ void reload_model(u8 changeType)
       log_line("Flag to send back full mavlink/tml packet to controller is set.");
    else
       log_line("Flag to send back full mavlink/tml packet to controller is not set.");
+   _update_mavlink_router_settings();
 }
 
 void onRebootRequest()
@@ -1255,6 +1287,33 @@ void send_datalink_data_packet_to_controller()
       g_pProcessStats->lastIPCOutgoingTime = g_TimeNow;
 }
 
+// Called by the MAVLink router for each frame to forward. Keeps frames whole inside the raw telemetry packets.
+void _on_mavlink_router_frame(u8* pFrame, int iLength)
+{
+   if ( telemetryBufferFromFCCount + iLength > telemetryBufferFromFCMaxSize )
+      send_raw_telemetry_packet_to_controller();
+
+   while ( iLength > 0 )
+   {
+      int iChunkSize = iLength;
+      if ( iChunkSize > telemetryBufferFromFCMaxSize - telemetryBufferFromFCCount )
+         iChunkSize = telemetryBufferFromFCMaxSize - telemetryBufferFromFCCount;
+      memcpy(&(telemetryBufferFromFC[telemetryBufferFromFCCount]), pFrame, iChunkSize);
+      telemetryBufferFromFCCount += iChunkSize;
+      pFrame += iChunkSize;
+      iLength -= iChunkSize;
+      if ( iLength > 0 )
+         send_raw_telemetry_packet_to_controller();
+   }
+}
+
+void _update_mavlink_router_settings()
+{
+   s_bUseMAVLinkRouter = (g_pCurrentModel->telemetry_params.fc_telemetry_type == MODEL_TELEMETRY_TYPE_MAVLINK);
+   mavlink_router_set_shaping((g_pCurrentModel->telemetry_params.flags & TELEMETRY_FLAGS_DONT_SHAPE_MAVLINK_DOWNLINK)?false:true);
+   log_line("MAVLink router is %s, downlink shaping is %s.", s_bUseMAVLinkRouter?"used":"not used", mavlink_router_is_shaping_enabled()?"on":"off");
+}
+
 void addSerialDataToFCTelemetryBuffer(u8* pData, int dataLength)
 {
    bool bMustSendFullTelemetryPackets = false;
@@ -1268,6 +1327,12 @@ void addSerialDataToFCTelemetryBuffer(u8* pData, int dataLength)
    if ( ! bMustSendFullTelemetryPackets )
       return;
 
+   if ( s_bUseMAVLinkRouter )
+   {
+      mavlink_router_add_data(pData, dataLength, g_TimeNow);
+      return;
+   }
+
    /*
    log_line("adding %d bytes to sent to controller as telemetry.", dataLength);
 
@@ -1298,11 +1363,50 @@ void addSerialDataToFCTelemetryBuffer(u8* pData, int dataLength)
    }
 }
 
+void _process_serial_telemetry_data(u8* pData, int length)
+{
+   //printf("+%d", length);
+   //fflush(stdout);
+   s_uRawTelemetryDownloadTotalReadFromSerial += length;
+   s_iFCSerialReadBytesTempLastSecond += length;
+
+   addSerialDataToFCTelemetryBuffer(pData, length);
+
+   //log_line("Received %d bytes from FC", length);
+
+   if ( parse_telemetry_from_fc(pData, length, &sPHFCT, &sPHRTE, g_pCurrentModel->vehicle_type, g_pCurrentModel->telemetry_params.fc_telemetry_type) )
+   {
+      set_time_last_mavlink_message_from_fc(g_TimeNow);
+      s_CountMessagesFromFCPerSecondTemp++;
+   }
+}
+
 void try_read_serial_telemetry()
 {
    if ( -1 == s_fSerialToFC )
       return;
 
+   // Serial data was already read by the serial I/O wait in the main loop, consume all of it
+   if ( -1 != s_iSerialIOPortFC )
+   {
+      int length = 0;
+      while ( (length = serial_io_read(s_iSerialIOPortFC, serialBufferIn, sizeof(serialBufferIn))) > 0 )
+         _process_serial_telemetry_data(serialBufferIn, length);
+
+      // Serial port unplugged or input pipe closed: close it, it's opened again by the telemetry retry in the main loop
+      if ( serial_io_is_port_hung_up(s_iSerialIOPortFC) )
+      {
+         log_softerror_and_alarm("Serial connection to flight controller was lost. Closing it.");
+         serial_io_remove_port(s_iSerialIOPortFC);
+         s_iSerialIOPortFC = -1;
+         if ( ! bInputFromSTDIN )
+            close(s_fSerialToFC);
+         s_fSerialToFC = -1;
+         s_bRetrySetupTelemetry = true;
+      }
+      return;
+   }
+
    struct timeval to;
    to.tv_sec = 0;
    to.tv_usec = 2000; // 2 ms
@@ -1321,19 +1425,25 @@ void try_read_serial_telemetry()
    if ( length <= 0 )
       return;
 
-   //printf("+%d", length);
-   //fflush(stdout);
-   s_uRawTelemetryDownloadTotalReadFromSerial += length;
-   s_iFCSerialReadBytesTempLastSecond += length;
-
-   addSerialDataToFCTelemetryBuffer(serialBufferIn, length);
-
-   //log_line("Received %d bytes from FC", length);
+   _process_serial_telemetry_data(serialBufferIn, length);
+}
 
-   if ( parse_telemetry_from_fc(serialBufferIn, length, &sPHFCT, &sPHRTE, g_pCurrentModel->vehicle_type, g_pCurrentModel->telemetry_params.fc_telemetry_type) )
+void _process_serial_datalink_data(u8* pData, int length)
+{
+   while ( length > 0 )
    {
-      set_time_last_mavlink_message_from_fc(g_TimeNow);
-      s_CountMessagesFromFCPerSecondTemp++;
+      if ( dataLinkSerialBufferCount + length < dataLinkSerialBufferMaxSize )
+      {
+         memcpy(&(dataLinkSerialBuffer[dataLinkSerialBufferCount]), pData, length);
+         dataLinkSerialBufferCount += length;
+         return;
+      }
+      int chunkSize = dataLinkSerialBufferMaxSize-dataLinkSerialBufferCount;
+      memcpy(&(dataLinkSerialBuffer[dataLinkSerialBufferCount]), pData, chunkSize);
+      dataLinkSerialBufferCount += chunkSize;
+      pData += chunkSize;
+      length -= chunkSize;
+      send_datalink_data_packet_to_controller();
    }
 }
 
@@ -1342,6 +1452,25 @@ void try_read_serial_datalink()
    if ( -1 == s_iSerialDataLinkHandle )
       return;
 
+   if ( -1 != s_iSerialIOPortDataLink )
+   {
+      int length = 0;
+      while ( (length = serial_io_read(s_iSerialIOPortDataLink, serialBufferIn, sizeof(serialBufferIn))) > 0 )
+         _process_serial_datalink_data(serialBufferIn, length);
+
+      if ( serial_io_is_port_hung_up(s_iSerialIOPortDataLink) )
+      {
+         log_softerror_and_alarm("Serial connection for auxiliary data link was lost. Closing it.");
+         serial_io_remove_port(s_iSerialIOPortDataLink);
+         s_iSerialIOPortDataLink = -1;
+         close(s_iSerialDataLinkHandle);
+         s_iSerialDataLinkHandle = -1;
+         s_bReopenDataLinkSerialPort = true;
+         s_uTimeLastDataLinkSerialPortReopen = g_TimeNow;
+      }
+      return;
+   }
+
    struct timeval to;
    to.tv_sec = 0;
    to.tv_usec = 2000; // 2 ms
@@ -1360,27 +1489,7 @@ void try_read_serial_datalink()
    if ( length <= 0 )
       return;
 
-   char szBuff[2000];
-   memcpy(szBuff, &serialBufferIn[0], length);
-   szBuff[length] = 0;
-
-   u8* pData = &serialBufferIn[0];
-
-   while ( length > 0 )
-   {
-      if ( dataLinkSerialBufferCount + length < dataLinkSerialBufferMaxSize )
-      {
-         memcpy(&(dataLinkSerialBuffer[dataLinkSerialBufferCount]), pData, length);
-         dataLinkSerialBufferCount += length;
-         return;
-      }
-      int chunkSize = dataLinkSerialBufferMaxSize-dataLinkSerialBufferCount;
-      memcpy(&(dataLinkSerialBuffer[dataLinkSerialBufferCount]), pData, chunkSize);
-      dataLinkSerialBufferCount += chunkSize;
-      pData += chunkSize;
-      length -= chunkSize;
-      send_datalink_data_packet_to_controller();
-   }
+   _process_serial_datalink_data(serialBufferIn, length);
 }
 
 void _send_telemetry_to_controller()
@@ -1815,10 +1924,19 @@ void _send_telemetry_to_controller()
    {
       radio_packet_init(&sPH, PACKET_COMPONENT_TELEMETRY, PACKET_TYPE_RC_TELEMETRY, STREAM_ID_TELEMETRY);
       sPH.vehicle_id_src = g_pCurrentModel->uVehicleId;
-      sPH.total_length = (u16)sizeof(t_packet_header) + (u16)sizeof(t_packet_header_rc_info_downstream);
+      sPH.total_length = (u16)sizeof(t_packet_header) + (u16)RC_INFO_DOWNSTREAM_RADIO_LENGTH;
 
       memcpy(buffer, &sPH, sizeof(t_packet_header));
-      memcpy(buffer+sizeof(t_packet_header), (u8*)s_pPHDownstreamInfoRC, sizeof(t_packet_header_rc_info_downstream));
+      memcpy(buffer+sizeof(t_packet_header), (u8*)s_pPHDownstreamInfoRC, RC_INFO_DOWNSTREAM_RADIO_LENGTH);
+
+      // Vehicle side latency: how long the last frame waited here, so the controller can remove it from the round trip time
+      t_packet_header_rc_info_downstream* pRCInfo = (t_packet_header_rc_info_downstream*)(buffer+sizeof(t_packet_header));
+      u32 uTimeNowMs = get_current_timestamp_ms();
+      pRCInfo->uLastFrameVehicleDelayMs = 0xFFFF;
+      if ( (0 != pRCInfo->uLastFrameRecvTimeMs) && (uTimeNowMs >= pRCInfo->uLastFrameRecvTimeMs) && (uTimeNowMs - pRCInfo->uLastFrameRecvTimeMs < 0xFFFF) )
+         pRCInfo->uLastFrameVehicleDelayMs = (u16)(uTimeNowMs - pRCInfo->uLastFrameRecvTimeMs);
+      pRCInfo->uLastFrameToFCMs = s_uLastRCFrameToFCMs;
+      memcpy(&pRCInfo->histToFC, &s_HistRCToFC, sizeof(type_rc_latency_histogram));
       
       if ( s_bRouterReady && (! s_bRadioInterfacesReinitIsInProgress) )
       {
@@ -1843,6 +1961,23 @@ void _on_second_lapse_check()
    s_CountMessagesFromFCPerSecond = s_CountMessagesFromFCPerSecondTemp;
    s_CountMessagesFromFCPerSecondTemp = 0;
 
+   if ( s_bUseMAVLinkRouter && (g_TimeNow >= s_uTimeLastMAVLinkRouterStatsLog + 20000) )
+   {
+      s_uTimeLastMAVLinkRouterStatsLog = g_TimeNow;
+      type_mavlink_router_stats* pStats = mavlink_router_get_stats();
+      if ( pStats->uFramesIn > 0 )
+         log_line("[MAVLinkRouter] Frames in: %u, forwarded: %u, dropped by shaping: %u, invalid: %u; bytes in: %u, forwarded: %u, skipped: %u",
+            pStats->uFramesIn, pStats->uFramesForwarded, pStats->uFramesDropped, pStats->uFramesInvalid,
+            pStats->uBytesIn, pStats->uBytesForwarded, pStats->uBytesSkipped);
+   }
+
+   serial_io_update_stats(g_TimeNow);
+   if ( g_TimeNow >= s_uTimeLastSerialIOStatsLog + 20000 )
+   {
+      s_uTimeLastSerialIOStatsLog = g_TimeNow;
+      serial_io_log_stats();
+   }
+
    s_iFCSerialReadBytesPerSecond = s_iFCSerialReadBytesTempLastSecond;
    s_iFCSerialReadBytesTempLastSecond = 0;
 
@@ -1970,6 +2105,15 @@ void _send_rc_channel_freq_change(int nLink, int nUp, int nDown)
 
 void _periodic_loop()
 {
+   if ( s_bReopenDataLinkSerialPort && (g_TimeNow >= s_uTimeLastDataLinkSerialPortReopen + 2000) )
+   {
+      s_uTimeLastDataLinkSerialPortReopen = g_TimeNow;
+      log_line("Trying to open again the serial port for auxiliary data link...");
+      open_datalink_serial_port();
+      if ( (-1 != s_iSerialDataLinkHandle) || (s_iCurrentDataLinkSerialPortIndex < 0) )
+         s_bReopenDataLinkSerialPort = false;
+   }
+
    if ( g_TimeNow > s_uTimeLastCheckForRadioReinit + 500 )
    {
       s_uTimeLastCheckForRadioReinit = g_TimeNow; 
@@ -2068,6 +2212,8 @@ void _periodic_loop()
 
 void open_datalink_serial_port()
 {
+   serial_io_remove_port(s_iSerialIOPortDataLink);
+   s_iSerialIOPortDataLink = -1;
    if ( -1 != s_iSerialDataLinkHandle )
       close(s_iSerialDataLinkHandle);
    s_iSerialDataLinkHandle = -1;
@@ -2106,7 +2252,10 @@ void open_datalink_serial_port()
    if ( -1 == s_iSerialDataLinkHandle )
       log_softerror_and_alarm("Failed to open serial port %s (%s) for auxiliary datalink.", pPortInfo->szName, pPortInfo->szPortDeviceName );
    else
+   {
       log_line("Opened serial port %s (%s) for auxiliary datalink successfully.", pPortInfo->szName, pPortInfo->szPortDeviceName);
+      s_iSerialIOPortDataLink = serial_io_add_port(s_iSerialDataLinkHandle, pPortInfo->szPortDeviceName);
+   }
 }
 
 void open_telemetry_serial_port()
@@ -2114,6 +2263,8 @@ void open_telemetry_serial_port()
    if ( ! bInputFromSTDIN )
    if ( -1 != s_fSerialToFC )
    {
+      serial_io_remove_port(s_iSerialIOPortFC);
+      s_iSerialIOPortFC = -1;
       close(s_fSerialToFC);
       s_fSerialToFC = -1;
    }
@@ -2156,7 +2307,10 @@ void open_telemetry_serial_port()
    if ( -1 == s_fSerialToFC )
       log_softerror_and_alarm("Failed to open serial port %s (%s) to flight controller.", pPortInfo->szName, pPortInfo->szPortDeviceName);
    else
+   {
       log_line("Opened serial port %s (%s) to flight controller successfully at baudrate: %u.", pPortInfo->szName, pPortInfo->szPortDeviceName, (int)pPortInfo->lPortSpeed);
+      s_iSerialIOPortFC = serial_io_add_port(s_fSerialToFC, pPortInfo->szPortDeviceName);
+   }
 }
 
 void open_shared_mem_objects()
@@ -2322,6 +2476,15 @@ int main(int argc, char *argv[])
    else
       log_line("Flag to send back full mavlink/tml packet to controller is not set.");
 
+   mavlink_router_init(_on_mavlink_router_frame);
+   char szFile[128];
+   strcpy(szFile, FOLDER_CONFIG);
+   strcat(szFile, FILE_CONFIG_MAVLINK_ROUTER);
+   mavlink_router_load_config(szFile);
+   _update_mavlink_router_settings();
+
+   serial_io_init();
+
    g_TimeNow = get_current_timestamp_ms();
    process_stats_reset(g_pProcessStats, g_TimeNow);
 
@@ -2376,6 +2539,7 @@ int main(int argc, char *argv[])
       {
          log_line("Reading FC serial data from STDIN");
          s_fSerialToFC = STDIN_FILENO;
+         s_iSerialIOPortFC = serial_io_add_port(s_fSerialToFC, "stdin");
       }
       else
          open_telemetry_serial_port();
@@ -2400,6 +2564,8 @@ int main(int argc, char *argv[])
 
    _broadcast_vehicle_stats();
 
+   packet_rc_latency_histogram_reset(&s_HistRCToFC);
+
    g_TimeStart = get_current_timestamp_ms();
 
    int iSleepTime = 10;
@@ -2409,7 +2575,9 @@ int main(int argc, char *argv[])
 
    while ( !g_bQuit )
    {
-      hardware_sleep_ms(iSleepTime);
+      // Wakes up as soon as serial data is available on any of the serial ports (FC telemetry, data link)
+      if ( serial_io_wait_and_read(iSleepTime) < 0 )
+         hardware_sleep_ms(iSleepTime);
 
       g_TimeNow = get_current_timestamp_ms();
       u32 tTime0 = g_TimeNow;
@@ -2427,11 +2595,15 @@ int main(int argc, char *argv[])
       else
       {
          iSleepTime = 10;
+         if ( g_pCurrentModel->rc_params.rc_enabled && (g_pCurrentModel->rc_params.flags & RC_FLAGS_LOW_LATENCY_PATH) )
+            iSleepTime = 2;
          if ( g_TimeNow > get_time_last_mavlink_message_from_fc() + 4000 )
          if ( s_bRetrySetupTelemetry )
          {
             if ( ! bInputFromSTDIN )
             {
+               serial_io_remove_port(s_iSerialIOPortFC);
+               s_iSerialIOPortFC = -1;
                if ( -1 != s_fSerialToFC )
                   close(s_fSerialToFC);
                s_fSerialToFC = -1;
@@ -2474,6 +2646,9 @@ int main(int argc, char *argv[])
          _send_rc_data_to_FC();
 
 
+      if ( s_bUseMAVLinkRouter )
+         mavlink_router_periodic_loop(g_TimeNow);
+
       if ( g_pCurrentModel->telemetry_params.bControllerHasInputTelemetry || g_pCurrentModel->telemetry_params.bControllerHasOutputTelemetry )
       if ( telemetryBufferFromFCCount >= RAW_TELEMETRY_MIN_SEND_LENGTH || 
           (telemetryBufferFromFCCount > 0 && g_TimeNow >= telemetryBufferFromFCLastSendTime + RAW_TELEMETRY_SEND_TIMEOUT ) )
@@ -2539,6 +2714,10 @@ int main(int argc, char *argv[])
    s_fIPCToRouter = -1;
    s_fIPCFromRouter = -1;
 
+   serial_io_uninit();
+   s_iSerialIOPortDataLink = -1;
+   s_iSerialIOPortFC = -1;
+
    if ( -1 != s_iSerialDataLinkHandle )
       close(s_iSerialDataLinkHandle);
    s_iSerialDataLinkHandle = -1;
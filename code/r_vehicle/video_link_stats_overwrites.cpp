@@ -1265,6 +1265,11 @@ int video_stats_overwrites_get_next_level_down_radio_datarate_video(int iRadioLi
    return nRateTx;
 }
 
+int video_stats_overwrites_get_lower_datarate_value(int iDataRateBPS, int iLevelsDown)
+{
+   return _video_stats_overwrites_get_lower_datarate_value(iDataRateBPS, iLevelsDown);
+}
+
 u32 video_stats_overwrites_get_time_last_shift_down()
 {
    return s_uTimeLastShiftLevelDown;
@@ -12,5 +12,6 @@ bool video_stats_overwrites_decrease_videobitrate_overwrite();
 // Returns in bps or negative for MCS rates
 int video_stats_overwrites_get_current_radio_datarate_video(int iRadioLink, int iRadioInterface);
 int video_stats_overwrites_get_next_level_down_radio_datarate_video(int iRadioLink, int iRadioInterface);
+int video_stats_overwrites_get_lower_datarate_value(int iDataRateBPS, int iLevelsDown);
 
 u32 video_stats_overwrites_get_time_last_shift_down();
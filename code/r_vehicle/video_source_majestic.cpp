@@ -48,13 +48,12 @@
 #include <poll.h>
 
 #include "video_source_majestic.h"
+#include "processor_tx_video.h"
 #include "events.h"
 #include "timers.h"
 #include "shared_vars.h"
 #include "launchers_vehicle.h"
 
-extern ParserH264 s_ParserH264CameraOutput;
-
 int s_fInputVideoStreamUDPSocket = -1;
 int s_iInputVideoStreamUDPPort = 5600;
 u32 s_uTimeStartVideoInput = 0;
@@ -483,7 +482,7 @@ void video_source_majestic_periodic_checks()
       log_line("[VideoSourceUDP] Input video data: %u bytes/sec, %u bps, %u reads/sec",
          s_uDebugUDPInputBytes/10, s_uDebugUDPInputBytes/10*8, s_uDebugUDPInputReads/10);
       s_uDebugTimeLastUDPVideoInputCheck = g_TimeNow;
-      log_line("[VideoSourceUDP] Detected video stream fps: %d, slices: %d", (int)s_ParserH264CameraOutput.getDetectedFPS(), s_ParserH264CameraOutput.getDetectedSlices());
+      log_line("[VideoSourceUDP] Detected video stream fps: %d, slices: %d", (int)process_data_tx_video_get_camera_output_parser()->getDetectedFPS(), process_data_tx_video_get_camera_output_parser()->getDetectedSlices());
       s_uDebugUDPInputBytes = 0;
       s_uDebugUDPInputReads = 0;
    }
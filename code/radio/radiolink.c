@@ -241,6 +241,7 @@ void radio_reset_packets_default_frequencies(int iRCEnabled)
    s_uFrequencyRadioPacketsOnSlowLinkVehicleToController[PACKET_TYPE_VIDEO_SWITCH_VIDEO_KEYFRAME_TO_VALUE_ACK] = 50;
 
    s_uFrequencyRadioPacketsOnSlowLinkVehicleToController[PACKET_TYPE_RUBY_MODEL_SETTINGS] = 0; // Send at any rate
+   s_uFrequencyRadioPacketsOnSlowLinkVehicleToController[PACKET_TYPE_RUBY_MODEL_SECTION] = 0; // Send at any rate
 
    if( iRCEnabled )
    {
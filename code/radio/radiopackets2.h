@@ -170,6 +170,12 @@ typedef struct
       //                  u32 - local timestamp sent to video output;
       //    bit 1  - 0/1: is this video packet part of a I-frame
       //    bit 2  - 1: is on lower video bitrate
+      //    bit 3  - 1: packet is NAL aligned: video data starts at a NAL unit and is zero padded up to video_data_length
+      //    bit 4  - 1: packet starts a video frame (only for NAL aligned packets)
+      //    bit 5  - 1: packet ends a video frame (only for NAL aligned packets)
+      //    bit 6,7 - frame priority class: 0 - non reference frame, 1 - reference P frame, 2 - I-frame
+      //              (for EC packets: the highest class of the data packets in the block)
+      // Byte 2,3: used video data length in this packet, before zero padding (only for NAL aligned packets)
 
    u16 video_width;
    u16 video_height;
@@ -231,6 +237,27 @@ typedef struct
 #define PACKET_TYPE_RUBY_RADIO_CONFIG_UPDATED 9 // Sent by vehicle to controller to let it know about the current radio config.
                                            // Contains a type_relay_parameters, type_radio_interfaces_parameters and a type_radio_links_parameters
 
+#define PACKET_TYPE_RUBY_MODEL_SECTION 10 // Sent by vehicle to controller: a segment of a changed model section (or a patch to it), see base/models_sync.h
+// Contains a t_packet_header_model_section and then the segment data:
+//   * the zero run length encoded section data, for full sections
+//   * the changed bytes of the section, for patches (single segment)
+
+#define MODEL_SECTION_FLAG_PATCH 0x01
+
+typedef struct
+{
+   u32 uTransferId;
+   u32 uSectionsMask; // All the sections sent in this transfer (bit = section id - 1)
+   u8 uSectionId;
+   u8 uFlags; // MODEL_SECTION_FLAG_*
+   u8 uSegmentIndex;
+   u8 uSegmentsCount;
+   u16 uOffset; // Patches: offset of the changed bytes in the section data
+   u16 uTotalSize; // Full sections: encoded size of the section; patches: count of changed bytes
+   u32 uBaseCRC; // Patches: CRC of the section the patch applies to
+   u32 uSectionCRC; // CRC of the section data after this transfer
+} __attribute__((packed)) t_packet_header_model_section;
+
 
 //---------------------------------------
 // COMPONENT COMMANDS PACKETS
@@ -282,6 +309,21 @@ typedef struct
    u32 total_segments; // total segments in file
 } __attribute__((packed)) t_packet_header_file_segment;
 
+#define PACKET_TYPE_RUBY_FILE_TRANSFER_SEGMENT 14 // from vehicle to controller: a segment of a bulk file download, see base/file_transfer.h
+// Contains a t_packet_header_file_transfer_segment and then the segment data (compressed if the flag is set)
+// Same header is used for bulk uploads to vehicle (COMMAND_ID_UPLOAD_FILE_BULK_SEGMENT)
+
+typedef struct
+{
+   u32 uFileId;
+   u32 uTransferId; // CRC of the whole file
+   u32 uFileSize;
+   u32 uSegmentIndex;
+   u16 uSegmentSize; // Segment size used for this file; last segment can be smaller
+   u16 uDataSize; // Bytes of segment data in this packet
+   u8 uFlags; // FILE_TRANSFER_SEGMENT_FLAG_*
+} __attribute__((packed)) t_packet_header_file_transfer_segment;
+
 #define PACKET_TYPE_FIRST_PAIRING_DONE 16
 
 #define PACKET_TYPE_AUDIO_SEGMENT 18
@@ -339,6 +381,22 @@ typedef struct
 #define PACKET_TYPE_RUBY_TELEMETRY_VEHICLE_RX_CARDS_STATS 38 // has 1 byte (count cards) then (count cards * shared_mem_radio_stats_radio_interface) after the header
 #define PACKET_TYPE_RUBY_TELEMETRY_DEV_VIDEO_BITRATE_HISTORY 39 // has a shared_mem_dev_video_bitrate_history structure
 
+#define PACKET_TYPE_RUBY_TELEMETRY_EXTENDED_DELTA 40
+// Ruby telemetry extended, compact version used on serial (SiK) radio links. See radio/radiopackets_telemetry_delta.h
+// Contains:
+// t_packet_header
+// t_packet_header_ruby_telemetry_delta
+// (field index, value) pairs for the fields of the full telemetry (v3 + extra info + retransmissions) that are different from the keyframe
+
+#define FLAG_RUBY_TELEMETRY_DELTA_KEYFRAME 0x01 // Fields are relative to all zero values; this packet becomes the new keyframe
+
+typedef struct
+{
+   u8 uFlags;
+   u8 uKeyframeId; // The keyframe this packet is relative to (or the id of this keyframe)
+   u8 uFieldsCount;
+} __attribute__((packed)) t_packet_header_ruby_telemetry_delta;
+
 
 #define PACKET_TYPE_TELEMETRY_RAW_DOWNLOAD 41 // download telemetry data packet from vehicle to controller
 // payload is a packet_header_telemetry_raw structure and then is the actual telemetry data
@@ -57,3 +57,75 @@ u16 packet_header_rc_full_get_rc_channel_value(t_packet_header_rc_full_frame_ups
    else
       return ((pphrc->ch_lowBits[ch]) | (((pphrc->ch_highBits[ch>>1]) & 0x0F)<<8));
 }
+
+static u32 s_uRCLatencyHistogramBucketsLimits[RC_LATENCY_HISTOGRAM_BUCKETS] = { 2, 4, 6, 8, 10, 15, 20, 30, 40, 60, 100, 0xFFFF };
+
+void packet_rc_latency_histogram_reset(type_rc_latency_histogram* pHistogram)
+{
+   if ( NULL == pHistogram )
+      return;
+   memset(pHistogram, 0, sizeof(type_rc_latency_histogram));
+}
+
+void packet_rc_latency_histogram_add(type_rc_latency_histogram* pHistogram, u32 uValueMs)
+{
+   if ( NULL == pHistogram )
+      return;
+   if ( uValueMs > 0xFFFF )
+      uValueMs = 0xFFFF;
+
+   // Halve all the counters when they get full, so that recent values keep their weight
+   if ( pHistogram->uCount >= 0xFFFFFF )
+   {
+      pHistogram->uCount /= 2;
+      pHistogram->uSumMs /= 2;
+      for( int i=0; i<RC_LATENCY_HISTOGRAM_BUCKETS; i++ )
+         pHistogram->uBuckets[i] /= 2;
+   }
+   for( int i=0; i<RC_LATENCY_HISTOGRAM_BUCKETS; i++ )
+   {
+      if ( uValueMs > s_uRCLatencyHistogramBucketsLimits[i] )
+         continue;
+      if ( pHistogram->uBuckets[i] == 0xFFFF )
+      {
+         for( int k=0; k<RC_LATENCY_HISTOGRAM_BUCKETS; k++ )
+            pHistogram->uBuckets[k] /= 2;
+      }
+      pHistogram->uBuckets[i]++;
+      break;
+   }
+   if ( (0 == pHistogram->uCount) || (uValueMs < pHistogram->uMinMs) )
+      pHistogram->uMinMs = (u16)uValueMs;
+   pHistogram->uCount++;
+   pHistogram->uSumMs += uValueMs;
+   if ( uValueMs > pHistogram->uMaxMs )
+      pHistogram->uMaxMs = (u16)uValueMs;
+}
+
+u32 packet_rc_latency_histogram_get_bucket_limit(int iBucket)
+{
+   if ( (iBucket < 0) || (iBucket >= RC_LATENCY_HISTOGRAM_BUCKETS) )
+      return 0;
+   return s_uRCLatencyHistogramBucketsLimits[iBucket];
+}
+
+u32 packet_rc_latency_histogram_get_percentile(type_rc_latency_histogram* pHistogram, int iPercentile)
+{
+   if ( NULL == pHistogram )
+      return 0;
+   u32 uTotal = 0;
+   for( int i=0; i<RC_LATENCY_HISTOGRAM_BUCKETS; i++ )
+      uTotal += pHistogram->uBuckets[i];
+   if ( 0 == uTotal )
+      return 0;
+
+   u32 uTarget = (uTotal * (u32)iPercentile + 99) / 100;
+   u32 uSum = 0;
+   for( int i=0; i<RC_LATENCY_HISTOGRAM_BUCKETS-1; i++ )
+   {
+      uSum += pHistogram->uBuckets[i];
+      if ( uSum >= uTarget )
+         return s_uRCLatencyHistogramBucketsLimits[i];
+   }
+   return pHistogram->uMaxMs;
+}
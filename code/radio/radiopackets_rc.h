@@ -26,8 +26,30 @@ typedef struct
    u8 extra_info1; // not used, for future use
    u8 extra_info2; // not used, for future use
    u8 extra_info3; // not used, for future use
+
+   // Latency info. Not present in frames sent by older versions, check the packet length.
+   u32 uTimeSentMs; // Controller time when the frame was sent by the RC process
+   u8 uInputAgeMs; // Age of the RC input (sticks) values when the frame was sent
+   u8 uRouterDelayMs; // Time spent by the frame in the controller router before it was sent on radio
 } __attribute__((packed)) t_packet_header_rc_full_frame_upstream;
 
+// Frames sent by older versions don't have the latency info
+#define RC_FULL_FRAME_UPSTREAM_MIN_LENGTH (sizeof(t_packet_header_rc_full_frame_upstream) - sizeof(u32) - 2*sizeof(u8))
+
+
+#define RC_LATENCY_HISTOGRAM_BUCKETS 12
+
+// Histogram of latency (or jitter) values, in miliseconds.
+// Bucket upper limits are given by packet_rc_latency_histogram_get_bucket_limit()
+typedef struct
+{
+   u32 uCount;
+   u32 uSumMs;
+   u16 uMinMs;
+   u16 uMaxMs;
+   u16 uBuckets[RC_LATENCY_HISTOGRAM_BUCKETS];
+} __attribute__((packed)) type_rc_latency_histogram;
+
 
 #define RC_INFO_HISTORY_SIZE 50 // every 50ms
 
@@ -45,8 +67,26 @@ typedef struct
    u8 last_history_slice;
    u8 rc_rssi;
    u32 extra_flags; // not used now. for future use
+
+   // Latency info. Not present in the info sent by older versions, check the packet length.
+   u32 uLastFrameTimeSentMs; // uTimeSentMs of the last received frame (controller clock), echoed back to measure the round trip time
+   u8 uLastFrameInputAgeMs; // uInputAgeMs of the last received frame
+   u8 uLastFrameRouterDelayMs; // uRouterDelayMs of the last received frame
+   u16 uLastFrameVehicleDelayMs; // Time from receiving the last frame on the vehicle until this info was sent back
+   u16 uLastFrameToFCMs; // Time from receiving the last frame on the vehicle until it was sent to the flight controller
+   u32 uLastFrameRecvTimeMs; // Vehicle time when the last frame was received
+   type_rc_latency_histogram histJitter; // Deviation of the frames arrival interval (on the vehicle) from the RC rate interval
+   type_rc_latency_histogram histToFC; // From receiving a frame on the vehicle until sending it to the flight controller
+
+   // Computed on the controller when the info is received (not sent over radio)
+   type_rc_latency_histogram histRoundTrip; // Controller RC process -> vehicle -> controller
+   type_rc_latency_histogram histStickToFC; // Estimated: input age + controller router + half round trip + vehicle to FC
 } __attribute__((packed)) t_packet_header_rc_info_downstream;
 
+// Length of the RC info sent over radio, and the length sent by older versions
+#define RC_INFO_DOWNSTREAM_RADIO_LENGTH (sizeof(t_packet_header_rc_info_downstream) - 2*sizeof(type_rc_latency_histogram))
+#define RC_INFO_DOWNSTREAM_MIN_LENGTH (RC_INFO_DOWNSTREAM_RADIO_LENGTH - 2*sizeof(type_rc_latency_histogram) - 2*sizeof(u32) - 2*sizeof(u8) - 2*sizeof(u16))
+
 
 
 #ifdef __cplusplus
@@ -56,6 +96,12 @@ extern "C" {
 void packet_header_rc_full_set_rc_channel_value(t_packet_header_rc_full_frame_upstream* pphrc, u16 ch, u16 val);
 u16 packet_header_rc_full_get_rc_channel_value(t_packet_header_rc_full_frame_upstream* pphrc, u16 ch);
 
+void packet_rc_latency_histogram_reset(type_rc_latency_histogram* pHistogram);
+void packet_rc_latency_histogram_add(type_rc_latency_histogram* pHistogram, u32 uValueMs);
+u32 packet_rc_latency_histogram_get_bucket_limit(int iBucket);
+// Returns the upper limit of the bucket that contains the given percentile (0..100) of the values
+u32 packet_rc_latency_histogram_get_percentile(type_rc_latency_histogram* pHistogram, int iPercentile);
+
 #ifdef __cplusplus
 }  
 #endif
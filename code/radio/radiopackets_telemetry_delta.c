@@ -0,0 +1,357 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+         * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+       * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stddef.h>
+#include "radiopackets_telemetry_delta.h"
+
+#define TELEMETRY_DELTA_MAX_FIELDS 128
+
+typedef struct
+{
+   u16 uOffset;
+   u8 uSize; // 1, 2, 4: numeric field; other: bytes sent as they are
+} type_telemetry_delta_field;
+
+static type_telemetry_delta_field s_TelemetryDeltaFields[TELEMETRY_DELTA_MAX_FIELDS];
+static int s_iTelemetryDeltaFieldsCount = 0;
+
+static void _telemetry_delta_add_field(int iOffset, int iSize)
+{
+   if ( s_iTelemetryDeltaFieldsCount >= TELEMETRY_DELTA_MAX_FIELDS )
+   {
+      log_softerror_and_alarm("[TelemetryDelta] Too many telemetry fields.");
+      return;
+   }
+   s_TelemetryDeltaFields[s_iTelemetryDeltaFieldsCount].uOffset = (u16)iOffset;
+   s_TelemetryDeltaFields[s_iTelemetryDeltaFieldsCount].uSize = (u8)iSize;
+   s_iTelemetryDeltaFieldsCount++;
+}
+
+#define TELEMETRY_DELTA_FIELD(iBase, type, member) _telemetry_delta_add_field((iBase) + offsetof(type, member), sizeof(((type*)0)->member))
+#define TELEMETRY_DELTA_FIELD_ARRAY(iBase, type, member, iCount) \
+   for( int k=0; k<(iCount); k++ ) \
+      _telemetry_delta_add_field((iBase) + offsetof(type, member) + k*sizeof(((type*)0)->member[0]), sizeof(((type*)0)->member[0]))
+
+// The fields order must be the same on vehicle and controller; add new fields only at the end
+static void _telemetry_delta_build_fields()
+{
+   if ( s_iTelemetryDeltaFieldsCount > 0 )
+      return;
+
+   int iBase = 0;
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, flags);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, version);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, uVehicleId);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, vehicle_type);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, vehicle_name);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, radio_links_count);
+   TELEMETRY_DELTA_FIELD_ARRAY(iBase, t_packet_header_ruby_telemetry_extended_v3, uRadioFrequenciesKhz, MAX_RADIO_INTERFACES);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, uRelayLinks);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, downlink_tx_video_bitrate_bps);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, downlink_tx_video_all_bitrate_bps);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, downlink_tx_data_bitrate_bps);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, downlink_tx_video_packets_per_sec);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, downlink_tx_data_packets_per_sec);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, downlink_tx_compacted_packets_per_sec);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, temperature);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, cpu_load);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, cpu_mhz);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, throttled);
+   for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+   {
+      _telemetry_delta_add_field(iBase + offsetof(t_packet_header_ruby_telemetry_extended_v3, last_sent_datarate_bps) + (2*i)*sizeof(int), sizeof(int));
+      _telemetry_delta_add_field(iBase + offsetof(t_packet_header_ruby_telemetry_extended_v3, last_sent_datarate_bps) + (2*i+1)*sizeof(int), sizeof(int));
+   }
+   TELEMETRY_DELTA_FIELD_ARRAY(iBase, t_packet_header_ruby_telemetry_extended_v3, last_recv_datarate_bps, MAX_RADIO_INTERFACES);
+   TELEMETRY_DELTA_FIELD_ARRAY(iBase, t_packet_header_ruby_telemetry_extended_v3, uplink_rssi_dbm, MAX_RADIO_INTERFACES);
+   TELEMETRY_DELTA_FIELD_ARRAY(iBase, t_packet_header_ruby_telemetry_extended_v3, uplink_link_quality, MAX_RADIO_INTERFACES);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, uplink_rc_rssi);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, uplink_mavlink_rc_rssi);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, uplink_mavlink_rx_rssi);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, txTimePerSec);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, extraFlags);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_v3, extraSize);
+
+   iBase = sizeof(t_packet_header_ruby_telemetry_extended_v3);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info, flags);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info, uTimeNow);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info, uRelayedVehicleId);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info, uThrottleInput);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info, uThrottleOutput);
+   TELEMETRY_DELTA_FIELD_ARRAY(iBase, t_packet_header_ruby_telemetry_extended_extra_info, uDummy, 10);
+
+   iBase = sizeof(t_packet_header_ruby_telemetry_extended_v3) + sizeof(t_packet_header_ruby_telemetry_extended_extra_info);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsUnique);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsDuplicate);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsSegmentsUnique);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsSegmentsDuplicate);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsSegmentsRetried);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsUniqueLast5Sec);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsDuplicateLast5Sec);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsSegmentsUniqueLast5Sec);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsSegmentsDuplicateLast5Sec);
+   TELEMETRY_DELTA_FIELD(iBase, t_packet_header_ruby_telemetry_extended_extra_info_retransmissions, totalReceivedRetransmissionsRequestsSegmentsRetriedLast5Sec);
+}
+
+static u32 _telemetry_delta_read_value(u8* pData, int iSize)
+{
+   if ( 1 == iSize )
+      return *pData;
+   if ( 2 == iSize )
+   {
+      u16 uValue = 0;
+      memcpy(&uValue, pData, sizeof(u16));
+      return uValue;
+   }
+   u32 uValue = 0;
+   memcpy(&uValue, pData, sizeof(u32));
+   return uValue;
+}
+
+static void _telemetry_delta_write_value(u8* pData, int iSize, u32 uValue)
+{
+   if ( 1 == iSize )
+      *pData = (u8)uValue;
+   else if ( 2 == iSize )
+   {
+      u16 uValue16 = (u16)uValue;
+      memcpy(pData, &uValue16, sizeof(u16));
+   }
+   else
+      memcpy(pData, &uValue, sizeof(u32));
+}
+
+// Difference between the new and the keyframe value, as a signed value of the field size
+static int _telemetry_delta_get_difference(u32 uValue, u32 uBaseValue, int iSize)
+{
+   u32 uDiff = uValue - uBaseValue;
+   if ( 1 == iSize )
+      return (int)(signed char)(uDiff & 0xFF);
+   if ( 2 == iSize )
+      return (int)(short)(uDiff & 0xFFFF);
+   return (int)uDiff;
+}
+
+static int _telemetry_delta_write_varint(u8* pOutput, int iMaxLength, u32 uValue)
+{
+   int iLength = 0;
+   do
+   {
+      if ( iLength >= iMaxLength )
+         return -1;
+      u8 uByte = uValue & 0x7F;
+      uValue >>= 7;
+      if ( uValue != 0 )
+         uByte |= 0x80;
+      pOutput[iLength++] = uByte;
+   } while ( uValue != 0 );
+   return iLength;
+}
+
+static int _telemetry_delta_read_varint(u8* pInput, int iMaxLength, u32* puValue)
+{
+   u32 uValue = 0;
+   int iLength = 0;
+   int iShift = 0;
+   while ( iLength < iMaxLength )
+   {
+      u8 uByte = pInput[iLength++];
+      uValue |= ((u32)(uByte & 0x7F)) << iShift;
+      if ( ! (uByte & 0x80) )
+      {
+         *puValue = uValue;
+         return iLength;
+      }
+      iShift += 7;
+      if ( iShift > 28 )
+         return -1;
+   }
+   return -1;
+}
+
+void telemetry_delta_init_state(type_telemetry_delta_state* pState)
+{
+   if ( NULL == pState )
+      return;
+   memset(pState, 0, sizeof(type_telemetry_delta_state));
+   _telemetry_delta_build_fields();
+}
+
+int telemetry_delta_encode_packet(type_telemetry_delta_state* pState, u8* pFullPacket, u8* pOutput, int iMaxOutputLength, int bForceKeyframe)
+{
+   if ( (NULL == pState) || (NULL == pFullPacket) || (NULL == pOutput) )
+      return -1;
+   t_packet_header* pPH = (t_packet_header*)pFullPacket;
+   if ( pPH->packet_type != PACKET_TYPE_RUBY_TELEMETRY_EXTENDED )
+      return -1;
+   if ( pPH->total_length != sizeof(t_packet_header) + TELEMETRY_DELTA_FULL_SIZE )
+      return -1;
+   if ( iMaxOutputLength < (int)(sizeof(t_packet_header) + sizeof(t_packet_header_ruby_telemetry_delta)) )
+      return -1;
+
+   _telemetry_delta_build_fields();
+
+   u8 uZeros[TELEMETRY_DELTA_FULL_SIZE];
+   u8* pFull = pFullPacket + sizeof(t_packet_header);
+   u8* pBase = pState->uKeyframe;
+   int bIsKeyframe = 0;
+   if ( bForceKeyframe || (! pState->iHasKeyframe) || (pState->iPacketsSinceKeyframe >= TELEMETRY_DELTA_KEYFRAME_INTERVAL) )
+   {
+      memset(uZeros, 0, sizeof(uZeros));
+      pBase = uZeros;
+      bIsKeyframe = 1;
+   }
+
+   t_packet_header_ruby_telemetry_delta* pPHTD = (t_packet_header_ruby_telemetry_delta*)(pOutput + sizeof(t_packet_header));
+   pPHTD->uFlags = bIsKeyframe?FLAG_RUBY_TELEMETRY_DELTA_KEYFRAME:0;
+   pPHTD->uKeyframeId = bIsKeyframe?(pState->uKeyframeId+1):pState->uKeyframeId;
+   pPHTD->uFieldsCount = 0;
+
+   int iPos = sizeof(t_packet_header) + sizeof(t_packet_header_ruby_telemetry_delta);
+   for( int i=0; i<s_iTelemetryDeltaFieldsCount; i++ )
+   {
+      int iOffset = s_TelemetryDeltaFields[i].uOffset;
+      int iSize = s_TelemetryDeltaFields[i].uSize;
+      if ( 0 == memcmp(pFull + iOffset, pBase + iOffset, iSize) )
+         continue;
+      if ( iPos >= iMaxOutputLength )
+         return -1;
+      pOutput[iPos++] = (u8)i;
+
+      if ( (iSize == 1) || (iSize == 2) || (iSize == 4) )
+      {
+         int iDiff = _telemetry_delta_get_difference(_telemetry_delta_read_value(pFull + iOffset, iSize), _telemetry_delta_read_value(pBase + iOffset, iSize), iSize);
+         u32 uZigZag = (((u32)iDiff) << 1) ^ ((u32)(iDiff >> 31));
+         int iLength = _telemetry_delta_write_varint(pOutput + iPos, iMaxOutputLength - iPos, uZigZag);
+         if ( iLength < 0 )
+            return -1;
+         iPos += iLength;
+      }
+      else
+      {
+         if ( iPos + iSize > iMaxOutputLength )
+            return -1;
+         memcpy(pOutput + iPos, pFull + iOffset, iSize);
+         iPos += iSize;
+      }
+      pPHTD->uFieldsCount++;
+   }
+
+   memcpy(pOutput, pFullPacket, sizeof(t_packet_header));
+   t_packet_header* pPHOut = (t_packet_header*)pOutput;
+   pPHOut->packet_type = PACKET_TYPE_RUBY_TELEMETRY_EXTENDED_DELTA;
+   pPHOut->total_length = (u16)iPos;
+   return iPos;
+}
+
+void telemetry_delta_on_packet_sent(type_telemetry_delta_state* pState, u8* pFullPacket, u8* pEncodedPacket)
+{
+   if ( (NULL == pState) || (NULL == pFullPacket) || (NULL == pEncodedPacket) )
+      return;
+   t_packet_header_ruby_telemetry_delta* pPHTD = (t_packet_header_ruby_telemetry_delta*)(pEncodedPacket + sizeof(t_packet_header));
+   if ( pPHTD->uFlags & FLAG_RUBY_TELEMETRY_DELTA_KEYFRAME )
+   {
+      memcpy(pState->uKeyframe, pFullPacket + sizeof(t_packet_header), TELEMETRY_DELTA_FULL_SIZE);
+      pState->uKeyframeId = pPHTD->uKeyframeId;
+      pState->iHasKeyframe = 1;
+      pState->iPacketsSinceKeyframe = 0;
+   }
+   else
+      pState->iPacketsSinceKeyframe++;
+}
+
+int telemetry_delta_decode_packet(type_telemetry_delta_state* pState, u8* pDeltaPacket, int iLength, u8* pOutput, int iMaxOutputLength)
+{
+   if ( (NULL == pState) || (NULL == pDeltaPacket) || (NULL == pOutput) )
+      return -1;
+   if ( iLength < (int)(sizeof(t_packet_header) + sizeof(t_packet_header_ruby_telemetry_delta)) )
+      return -1;
+   if ( iMaxOutputLength < (int)sizeof(t_packet_header) + TELEMETRY_DELTA_FULL_SIZE )
+      return -1;
+
+   _telemetry_delta_build_fields();
+
+   t_packet_header_ruby_telemetry_delta* pPHTD = (t_packet_header_ruby_telemetry_delta*)(pDeltaPacket + sizeof(t_packet_header));
+   int bIsKeyframe = (pPHTD->uFlags & FLAG_RUBY_TELEMETRY_DELTA_KEYFRAME)?1:0;
+   if ( ! bIsKeyframe )
+   if ( (! pState->iHasKeyframe) || (pPHTD->uKeyframeId != pState->uKeyframeId) )
+      return 0;
+
+   u8 uFull[TELEMETRY_DELTA_FULL_SIZE];
+   if ( bIsKeyframe )
+      memset(uFull, 0, sizeof(uFull));
+   else
+      memcpy(uFull, pState->uKeyframe, sizeof(uFull));
+
+   int iPos = sizeof(t_packet_header) + sizeof(t_packet_header_ruby_telemetry_delta);
+   for( int i=0; i<(int)pPHTD->uFieldsCount; i++ )
+   {
+      if ( iPos >= iLength )
+         return -1;
+      int iField = pDeltaPacket[iPos++];
+      if ( iField >= s_iTelemetryDeltaFieldsCount )
+         return -1;
+      int iOffset = s_TelemetryDeltaFields[iField].uOffset;
+      int iSize = s_TelemetryDeltaFields[iField].uSize;
+
+      if ( (iSize == 1) || (iSize == 2) || (iSize == 4) )
+      {
+         u32 uZigZag = 0;
+         int iLen = _telemetry_delta_read_varint(pDeltaPacket + iPos, iLength - iPos, &uZigZag);
+         if ( iLen < 0 )
+            return -1;
+         iPos += iLen;
+         int iDiff = (int)((uZigZag >> 1) ^ (~(uZigZag & 1) + 1));
+         _telemetry_delta_write_value(uFull + iOffset, iSize, _telemetry_delta_read_value(uFull + iOffset, iSize) + (u32)iDiff);
+      }
+      else
+      {
+         if ( iPos + iSize > iLength )
+            return -1;
+         memcpy(uFull + iOffset, pDeltaPacket + iPos, iSize);
+         iPos += iSize;
+      }
+   }
+
+   if ( bIsKeyframe )
+   {
+      memcpy(pState->uKeyframe, uFull, sizeof(uFull));
+      pState->uKeyframeId = pPHTD->uKeyframeId;
+      pState->iHasKeyframe = 1;
+   }
+
+   memcpy(pOutput, pDeltaPacket, sizeof(t_packet_header));
+   t_packet_header* pPHOut = (t_packet_header*)pOutput;
+   pPHOut->packet_type = PACKET_TYPE_RUBY_TELEMETRY_EXTENDED;
+   pPHOut->total_length = (u16)(sizeof(t_packet_header) + TELEMETRY_DELTA_FULL_SIZE);
+   memcpy(pOutput + sizeof(t_packet_header), uFull, sizeof(uFull));
+   return (int)pPHOut->total_length;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../base/base.h"
+#include "radiopackets2.h"
+
+// Compact encoding of the Ruby extended telemetry (v3 + extra info + retransmissions info), for slow (serial) radio links.
+// A keyframe is sent every TELEMETRY_DELTA_KEYFRAME_INTERVAL packets, with all the non zero fields.
+// The other packets carry only the fields that are different from the last keyframe, so a lost packet
+// does not affect the next ones. Each field is sent as: field index (1 byte), then the difference from
+// the keyframe value as a zigzag varint (text fields are sent as is).
+// The receiver rebuilds the full PACKET_TYPE_RUBY_TELEMETRY_EXTENDED packet.
+
+#define TELEMETRY_DELTA_KEYFRAME_INTERVAL 10
+#define TELEMETRY_DELTA_FULL_SIZE ((int)(sizeof(t_packet_header_ruby_telemetry_extended_v3) + sizeof(t_packet_header_ruby_telemetry_extended_extra_info) + sizeof(t_packet_header_ruby_telemetry_extended_extra_info_retransmissions)))
+#define TELEMETRY_DELTA_MAX_PACKET_SIZE 400
+
+typedef struct
+{
+   u8 uKeyframe[TELEMETRY_DELTA_FULL_SIZE];
+   u8 uKeyframeId;
+   int iHasKeyframe;
+   int iPacketsSinceKeyframe;
+} type_telemetry_delta_state;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void telemetry_delta_init_state(type_telemetry_delta_state* pState);
+
+// Encodes a full Ruby telemetry extended packet (v3, with extra info and retransmissions info) into pOutput.
+// Sends a keyframe if bForceKeyframe is set, or if one is due. Does not change the state.
+// Returns the length of the encoded packet, or -1 if the input can't be encoded or does not fit in iMaxOutputLength.
+int telemetry_delta_encode_packet(type_telemetry_delta_state* pState, u8* pFullPacket, u8* pOutput, int iMaxOutputLength, int bForceKeyframe);
+// Call after the encoded packet was sent, so that the deltas refer to a keyframe the receiver can have.
+void telemetry_delta_on_packet_sent(type_telemetry_delta_state* pState, u8* pFullPacket, u8* pEncodedPacket);
+
+// Rebuilds the full Ruby telemetry extended packet into pOutput.
+// Returns the length of the rebuilt packet, 0 if the keyframe it refers to was not received, -1 on invalid data.
+int telemetry_delta_decode_packet(type_telemetry_delta_state* pState, u8* pDeltaPacket, int iLength, u8* pOutput, int iMaxOutputLength);
+
+#ifdef __cplusplus
+}  
+#endif
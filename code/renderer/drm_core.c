@@ -41,6 +41,9 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
 
 int s_fdDRM = -1;
 type_drm_display_attributes s_DRMDisplayAttributes;
@@ -48,6 +51,15 @@ type_drm_runtime_state s_DRMRuntimeState;
 
 
 int s_iDRMCoreInitialized = 0;
+int s_iDRMCoreMemoryOnly = 0;
+int s_iDRMDrawBuffersCount = 2;
+
+// Buffer swaps are non blocking page flips; the flip done event is consumed by ruby_drm_core_wait_for_flip_done
+pthread_mutex_t s_MutexDRMFlip = PTHREAD_MUTEX_INITIALIZER;
+int s_iDRMFlipPending = 0;
+uint32_t s_uDRMFlipSequence = 0; // Tags each queued flip, so a late event of an older flip does not complete a newer one
+uint32_t s_uDRMTimeLastFlipDoneMicros = 0;
+uint32_t s_uDRMFlipsCount = 0;
 
 static const char *_ruby_drm_core_get_connector_str(uint32_t conn_type)
 {
@@ -699,6 +711,12 @@ int ruby_drm_core_wait_for_display_connected()
    return 1;
 }
 
+void ruby_drm_core_set_triple_buffering(int iEnable)
+{
+   s_iDRMDrawBuffersCount = iEnable?3:2;
+   log_line("[DRMCore] Set triple buffering: %s", iEnable?"on":"off");
+}
+
 int ruby_drm_core_init(int iPlaneIndex, uint32_t uFormat, int iWidth, int iHeight, int iRefreshRate)
 {
    log_line("[DRMCore] Init (on plane index %d, format %s, w/h/r: %dx%d@%d)...",
@@ -738,10 +756,63 @@ int ruby_drm_core_init(int iPlaneIndex, uint32_t uFormat, int iWidth, int iHeigh
    
    //int64_t iZPos = _ruby_drm_get_object_property_value(s_DRMRuntimeState.objInfoPlane.pProperties, "zpos");
 
-   _ruby_drm_create_drm_surface_buffer(&s_DRMRuntimeState.drawBuffers[0]);
-   _ruby_drm_create_drm_surface_buffer(&s_DRMRuntimeState.drawBuffers[1]);
+   s_DRMRuntimeState.iDrawBuffersCount = s_iDRMDrawBuffersCount;
+   for( int i=0; i<s_DRMRuntimeState.iDrawBuffersCount; i++ )
+      _ruby_drm_create_drm_surface_buffer(&s_DRMRuntimeState.drawBuffers[i]);
    s_DRMRuntimeState.iActiveOnScreenDrawBuffer = 0;
 
+   s_iDRMFlipPending = 0;
+   s_uDRMFlipsCount = 0;
+
+   s_iDRMCoreInitialized = 1;
+   return 0;
+}
+
+// No DRM device is opened: the draw buffers are plain memory and buffer swaps only rotate them.
+int ruby_drm_core_init_memory(int iWidth, int iHeight)
+{
+   log_line("[DRMCore] Init memory only draw buffers (w/h: %dx%d)...", iWidth, iHeight);
+   if ( (iWidth <= 0) || (iHeight <= 0) )
+      return -1;
+
+   s_DRMDisplayAttributes.iWidth = iWidth;
+   s_DRMDisplayAttributes.iHeight = iHeight;
+   s_DRMDisplayAttributes.iRefreshRate = 60;
+   s_DRMDisplayAttributes.iInterleaved = 0;
+   s_DRMDisplayAttributes.iBPP = 32;
+
+   memset(&s_DRMRuntimeState, 0, sizeof(type_drm_runtime_state));
+   s_DRMRuntimeState.uPlaneFormat = DRM_FORMAT_ARGB8888;
+   s_DRMRuntimeState.iVideoSourceWidth = -1;
+   s_DRMRuntimeState.iVideoSourceHeight = -1;
+
+   s_DRMRuntimeState.iDrawBuffersCount = s_iDRMDrawBuffersCount;
+   for( int i=0; i<s_DRMRuntimeState.iDrawBuffersCount; i++ )
+   {
+      type_drm_buffer* pBuffer = &s_DRMRuntimeState.drawBuffers[i];
+      pBuffer->uWidth = iWidth;
+      pBuffer->uHeight = iHeight;
+      pBuffer->uStride = iWidth*4;
+      pBuffer->uSize = pBuffer->uStride * iHeight;
+      // Not DRM framebuffers, but the renderers tell the buffers apart by id
+      pBuffer->uBufferId = i+1;
+      pBuffer->pData = (uint8_t*) malloc(pBuffer->uSize);
+      if ( NULL == pBuffer->pData )
+      {
+         log_error_and_alarm("[DRMCore] Failed to allocate memory draw buffer %d.", i+1);
+         for( int k=0; k<i; k++ )
+            free(s_DRMRuntimeState.drawBuffers[k].pData);
+         memset(&s_DRMRuntimeState, 0, sizeof(type_drm_runtime_state));
+         return -1;
+      }
+      memset(pBuffer->pData, 0, pBuffer->uSize);
+   }
+   s_DRMRuntimeState.iActiveOnScreenDrawBuffer = 0;
+
+   s_iDRMFlipPending = 0;
+   s_uDRMFlipsCount = 0;
+   s_fdDRM = -1;
+   s_iDRMCoreMemoryOnly = 1;
    s_iDRMCoreInitialized = 1;
    return 0;
 }
@@ -750,6 +821,23 @@ int ruby_drm_core_uninit()
 {
    log_line("[DRMCore] Uninit");
 
+   if ( s_iDRMCoreMemoryOnly )
+   {
+      for( int i=0; i<s_DRMRuntimeState.iDrawBuffersCount; i++ )
+      {
+         if ( NULL != s_DRMRuntimeState.drawBuffers[i].pData )
+            free(s_DRMRuntimeState.drawBuffers[i].pData);
+         s_DRMRuntimeState.drawBuffers[i].pData = NULL;
+      }
+      s_iDRMCoreMemoryOnly = 0;
+      s_iDRMCoreInitialized = 0;
+      return 0;
+   }
+
+   // Make sure no other thread is waiting on a page flip while the device is closed
+   pthread_mutex_lock(&s_MutexDRMFlip);
+   s_iDRMFlipPending = 0;
+
    int iRet = drmModeSetCrtc(s_fdDRM, s_DRMRuntimeState.pOriginalCRTc->crtc_id, s_DRMRuntimeState.pOriginalCRTc->buffer_id, s_DRMRuntimeState.pOriginalCRTc->x, s_DRMRuntimeState.pOriginalCRTc->y,
       &s_DRMRuntimeState.objInfoConnector.uObjId, 1, &s_DRMRuntimeState.pOriginalCRTc->mode);
    if ( iRet < 0 )
@@ -770,6 +858,18 @@ int ruby_drm_core_uninit()
 */
 //////////
 
+   if ( s_DRMRuntimeState.iStaticLayerEnabled )
+   {
+      _ruby_drm_free_object_properties(&s_DRMRuntimeState.objInfoStaticLayerPlane);
+      _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.staticLayerBuffers[0]);
+      _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.staticLayerBuffers[1]);
+   }
+   if ( NULL != s_DRMRuntimeState.pStaticLayerPlane )
+      drmModeFreePlane(s_DRMRuntimeState.pStaticLayerPlane);
+   s_DRMRuntimeState.pStaticLayerPlane = NULL;
+   s_DRMRuntimeState.iStaticLayerEnabled = 0;
+   s_DRMRuntimeState.iStaticLayerOnScreen = 0;
+
    _ruby_drm_free_object_properties(&s_DRMRuntimeState.objInfoPlane);
    _ruby_drm_free_object_properties(&s_DRMRuntimeState.objInfoCRTc);
    _ruby_drm_free_object_properties(&s_DRMRuntimeState.objInfoConnector);
@@ -794,13 +894,14 @@ int ruby_drm_core_uninit()
       drmModeFreeResources(s_DRMRuntimeState.pAllDRMResources);
    s_DRMRuntimeState.pAllDRMResources = NULL;
 
-   _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.drawBuffers[0]);
-   _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.drawBuffers[1]);
+   for( int i=0; i<s_DRMRuntimeState.iDrawBuffersCount; i++ )
+      _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.drawBuffers[i]);
 
    if ( s_fdDRM >= 0 )
       close(s_fdDRM);
    s_fdDRM = -1;
    s_iDRMCoreInitialized = 0;
+   pthread_mutex_unlock(&s_MutexDRMFlip);
    return 0;
 }
 
@@ -819,9 +920,12 @@ type_drm_buffer* ruby_drm_core_get_main_draw_buffer()
    return &(s_DRMRuntimeState.drawBuffers[s_DRMRuntimeState.iActiveOnScreenDrawBuffer]);
 }
 
+// Buffers are used in a round robin order. The buffer after the one on screen is the back buffer:
+// with two buffers it's the one shown before (on screen until the pending flip is done), with three it's always free.
+
 type_drm_buffer* ruby_drm_core_get_back_draw_buffer()
 {
-   return &(s_DRMRuntimeState.drawBuffers[1-s_DRMRuntimeState.iActiveOnScreenDrawBuffer]);
+   return &(s_DRMRuntimeState.drawBuffers[(s_DRMRuntimeState.iActiveOnScreenDrawBuffer+1) % s_DRMRuntimeState.iDrawBuffersCount]);
 }
 
 uint32_t ruby_drm_core_get_main_draw_buffer_id()
@@ -830,18 +934,219 @@ uint32_t ruby_drm_core_get_main_draw_buffer_id()
 }
 uint32_t ruby_drm_core_get_back_draw_buffer_id()
 {
-   return s_DRMRuntimeState.drawBuffers[1-s_DRMRuntimeState.iActiveOnScreenDrawBuffer].uBufferId;
+   return s_DRMRuntimeState.drawBuffers[(s_DRMRuntimeState.iActiveOnScreenDrawBuffer+1) % s_DRMRuntimeState.iDrawBuffersCount].uBufferId;
+}
+
+int ruby_drm_core_get_draw_buffers_count()
+{
+   return s_DRMRuntimeState.iDrawBuffersCount;
+}
+
+type_drm_buffer* ruby_drm_core_get_draw_buffer(int iIndex)
+{
+   if ( (iIndex < 0) || (iIndex >= s_DRMRuntimeState.iDrawBuffersCount) )
+      return NULL;
+   return &(s_DRMRuntimeState.drawBuffers[iIndex]);
+}
+
+static void _ruby_drm_page_flip_handler(int fd, unsigned int uFrame, unsigned int uSec, unsigned int uUSec, void* pUserData)
+{
+   s_uDRMFlipsCount++;
+   s_uDRMTimeLastFlipDoneMicros = get_current_timestamp_micros();
+   if ( (uint32_t)(uintptr_t)pUserData == s_uDRMFlipSequence )
+      s_iDRMFlipPending = 0;
+}
+
+// Picks the static layer plane zpos from the range allowed by the plane: just below the main OSD plane
+// (above the video plane when possible). Returns 0 if the plane can be placed below the main OSD plane.
+
+static int _ruby_drm_get_static_layer_zpos()
+{
+   // Same values as used in ruby_drm_core_set_plane_properties_and_buffer
+   uint64_t uMainZPos = (s_DRMRuntimeState.objInfoPlane.iObjIndex == 0)?4:2;
+   type_drm_object_info* pObj = &s_DRMRuntimeState.objInfoStaticLayerPlane;
+
+   for (int i = 0; i < pObj->pProperties->count_props; i++)
+   {
+      drmModePropertyRes* pProp = pObj->ppPropertiesInfo[i];
+      if ( (NULL == pProp) || (0 != strcmp(pProp->name, "zpos")) )
+         continue;
+
+      if ( pProp->flags & DRM_MODE_PROP_IMMUTABLE )
+      {
+         s_DRMRuntimeState.iStaticLayerSetZPos = 0;
+         s_DRMRuntimeState.uStaticLayerZPos = pObj->pProperties->prop_values[i];
+      }
+      else
+      {
+         s_DRMRuntimeState.iStaticLayerSetZPos = 1;
+         s_DRMRuntimeState.uStaticLayerZPos = uMainZPos - 1;
+         if ( drm_property_type_is(pProp, DRM_MODE_PROP_RANGE) && (pProp->count_values >= 2) )
+         {
+            log_line("[DRMCore] Static layer plane zpos range: %d-%d", (int)pProp->values[0], (int)pProp->values[1]);
+            if ( s_DRMRuntimeState.uStaticLayerZPos > pProp->values[1] )
+               s_DRMRuntimeState.uStaticLayerZPos = pProp->values[1];
+            if ( s_DRMRuntimeState.uStaticLayerZPos < pProp->values[0] )
+               s_DRMRuntimeState.uStaticLayerZPos = pProp->values[0];
+         }
+      }
+      if ( s_DRMRuntimeState.uStaticLayerZPos >= uMainZPos )
+      {
+         log_line("[DRMCore] Static layer plane zpos (%d) can't be below the main OSD plane zpos (%d).", (int)s_DRMRuntimeState.uStaticLayerZPos, (int)uMainZPos);
+         return -1;
+      }
+      return 0;
+   }
+   log_line("[DRMCore] Static layer plane has no zpos property.");
+   return -1;
+}
+
+// Must be called with the flip mutex locked, on a reset atomic request
+
+static void _ruby_drm_add_static_layer_plane_on(int iBufferIndex)
+{
+   type_drm_object_info* pObj = &s_DRMRuntimeState.objInfoStaticLayerPlane;
+   ruby_drm_set_object_property(pObj, "FB_ID", s_DRMRuntimeState.staticLayerBuffers[iBufferIndex].uBufferId );
+   ruby_drm_set_object_property(pObj, "CRTC_ID", s_DRMRuntimeState.objInfoCRTc.uObjId );
+   ruby_drm_set_object_property(pObj, "CRTC_X", 0 );
+   ruby_drm_set_object_property(pObj, "CRTC_Y", 0 );
+   ruby_drm_set_object_property(pObj, "CRTC_W", s_DRMDisplayAttributes.iWidth );
+   ruby_drm_set_object_property(pObj, "CRTC_H", s_DRMDisplayAttributes.iHeight );
+   ruby_drm_set_object_property(pObj, "SRC_X", 0 );
+   ruby_drm_set_object_property(pObj, "SRC_Y", 0 );
+   ruby_drm_set_object_property(pObj, "SRC_W", ((uint64_t)s_DRMDisplayAttributes.iWidth)<<16 );
+   ruby_drm_set_object_property(pObj, "SRC_H", ((uint64_t)s_DRMDisplayAttributes.iHeight)<<16 );
+   if ( s_DRMRuntimeState.iStaticLayerSetZPos )
+      ruby_drm_set_object_property(pObj, "zpos", s_DRMRuntimeState.uStaticLayerZPos );
+}
+
+static void _ruby_drm_add_static_layer_plane_off()
+{
+   ruby_drm_set_object_property(&s_DRMRuntimeState.objInfoStaticLayerPlane, "FB_ID", 0 );
+   ruby_drm_set_object_property(&s_DRMRuntimeState.objInfoStaticLayerPlane, "CRTC_ID", 0 );
+}
+
+// Commits the atomic request as a non blocking page flip, or as a blocking commit if the flip can't be queued.
+// Must be called with the flip mutex locked.
+static int _ruby_drm_commit_flip()
+{
+   s_uDRMFlipSequence++;
+   int iRet = drmModeAtomicCommit(s_fdDRM, s_DRMRuntimeState.pAtomicRequest, DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, (void*)(uintptr_t)s_uDRMFlipSequence);
+   if ( 0 == iRet )
+   {
+      s_iDRMFlipPending = 1;
+      return 0;
+   }
+   s_iDRMFlipPending = 0;
+   iRet = drmModeAtomicCommit(s_fdDRM, s_DRMRuntimeState.pAtomicRequest, DRM_MODE_ATOMIC_ALLOW_MODESET, NULL);
+   // The blocking commit is on screen when it returns
+   if ( 0 == iRet )
+   {
+      s_uDRMFlipsCount++;
+      s_uDRMTimeLastFlipDoneMicros = get_current_timestamp_micros();
+   }
+   return iRet;
+}
+
+// Returns 1 if there is no page flip pending (anymore), 0 on timeout
+
+int ruby_drm_core_wait_for_flip_done(int iTimeoutMs)
+{
+   pthread_mutex_lock(&s_MutexDRMFlip);
+   if ( (! s_iDRMFlipPending) || (s_fdDRM < 0) )
+   {
+      pthread_mutex_unlock(&s_MutexDRMFlip);
+      return 1;
+   }
+
+   drmEventContext evContext;
+   memset(&evContext, 0, sizeof(evContext));
+   evContext.version = 2;
+   evContext.page_flip_handler = _ruby_drm_page_flip_handler;
+
+   uint32_t uTimeStart = get_current_timestamp_ms();
+   while ( s_iDRMFlipPending )
+   {
+      int iWaitMs = iTimeoutMs - (int)(get_current_timestamp_ms() - uTimeStart);
+      if ( iWaitMs <= 0 )
+         break;
+      struct pollfd pfd;
+      pfd.fd = s_fdDRM;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      int iRes = poll(&pfd, 1, iWaitMs);
+      if ( (iRes < 0) && (errno != EINTR) )
+      {
+         log_softerror_and_alarm("[DRMCore] Failed to wait for page flip (error %d)", errno);
+         s_iDRMFlipPending = 0;
+         break;
+      }
+      if ( (iRes > 0) && (pfd.revents & POLLIN) )
+         drmHandleEvent(s_fdDRM, &evContext);
+   }
+   int iDone = s_iDRMFlipPending?0:1;
+   pthread_mutex_unlock(&s_MutexDRMFlip);
+   return iDone;
+}
+
+int ruby_drm_core_wait_for_back_buffer_free(int iTimeoutMs)
+{
+   if ( s_DRMRuntimeState.iDrawBuffersCount > 2 )
+      return 1;
+   return ruby_drm_core_wait_for_flip_done(iTimeoutMs);
+}
+
+uint32_t ruby_drm_core_get_last_flip_done_time_micros()
+{
+   return s_uDRMTimeLastFlipDoneMicros;
+}
+
+uint32_t ruby_drm_core_get_flips_count()
+{
+   return s_uDRMFlipsCount;
 }
 
 int ruby_drm_swap_mainback_buffers()
 {
-   s_DRMRuntimeState.iActiveOnScreenDrawBuffer = 1 - s_DRMRuntimeState.iActiveOnScreenDrawBuffer;
+   if ( s_iDRMCoreMemoryOnly )
+   {
+      s_DRMRuntimeState.iActiveOnScreenDrawBuffer = (s_DRMRuntimeState.iActiveOnScreenDrawBuffer+1) % s_DRMRuntimeState.iDrawBuffersCount;
+      s_uDRMFlipsCount++;
+      s_uDRMTimeLastFlipDoneMicros = get_current_timestamp_micros();
+      return 0;
+   }
+
+   // The previous flip must be on screen before queueing a new one
+   if ( ! ruby_drm_core_wait_for_flip_done(100) )
+      log_softerror_and_alarm("[DRMCore] Timed out waiting for previous page flip.");
+
+   pthread_mutex_lock(&s_MutexDRMFlip);
+   s_DRMRuntimeState.iActiveOnScreenDrawBuffer = (s_DRMRuntimeState.iActiveOnScreenDrawBuffer+1) % s_DRMRuntimeState.iDrawBuffersCount;
    
    drmModeAtomicSetCursor(s_DRMRuntimeState.pAtomicRequest, 0);
 
    ruby_drm_set_object_property(&s_DRMRuntimeState.objInfoPlane, "FB_ID", s_DRMRuntimeState.drawBuffers[s_DRMRuntimeState.iActiveOnScreenDrawBuffer].uBufferId );
+   if ( s_DRMRuntimeState.iStaticLayerEnabled && s_DRMRuntimeState.iStaticLayerSwapQueued )
+   {
+      s_DRMRuntimeState.iStaticLayerSwapQueued = 0;
+      s_DRMRuntimeState.iStaticLayerActiveBuffer = 1 - s_DRMRuntimeState.iStaticLayerActiveBuffer;
+      if ( s_DRMRuntimeState.iStaticLayerOnScreen )
+         ruby_drm_set_object_property(&s_DRMRuntimeState.objInfoStaticLayerPlane, "FB_ID", s_DRMRuntimeState.staticLayerBuffers[s_DRMRuntimeState.iStaticLayerActiveBuffer].uBufferId );
+      else
+         _ruby_drm_add_static_layer_plane_on(s_DRMRuntimeState.iStaticLayerActiveBuffer);
+      s_DRMRuntimeState.iStaticLayerOnScreen = 1;
+   }
+   if ( s_DRMRuntimeState.iStaticLayerEnabled && s_DRMRuntimeState.iStaticLayerHideQueued )
+   {
+      s_DRMRuntimeState.iStaticLayerHideQueued = 0;
+      if ( s_DRMRuntimeState.iStaticLayerOnScreen )
+         _ruby_drm_add_static_layer_plane_off();
+      s_DRMRuntimeState.iStaticLayerOnScreen = 0;
+   }
 
-   int iRet = drmModeAtomicCommit(s_fdDRM, s_DRMRuntimeState.pAtomicRequest, DRM_MODE_ATOMIC_ALLOW_MODESET, NULL);
+   // Queue the flip for the next vblank and return; the caller waits for it only before drawing into the other buffer
+   int iRet = _ruby_drm_commit_flip();
+   pthread_mutex_unlock(&s_MutexDRMFlip);
    return iRet;
 
    //if ( (0 == s_iDRMTargetPlaneIndex) || (-1 == s_iDRMTargetPlaneIndex) )
@@ -873,6 +1178,7 @@ int ruby_drm_swap_mainback_buffers()
 
 int ruby_drm_core_set_plane_properties_and_buffer(uint32_t uBufferId)
 {
+   ruby_drm_core_wait_for_flip_done(100);
    uint64_t uSrcWidth = s_DRMDisplayAttributes.iWidth;
    uint64_t uSrcHeight = s_DRMDisplayAttributes.iHeight;
 
@@ -969,12 +1275,17 @@ int ruby_drm_core_set_plane_properties_and_buffer(uint32_t uBufferId)
    return iRet;
 }
 
+// Queues the buffer to be shown on the next vblank, without waiting for it (waits only for a previous pending flip)
+
 int ruby_drm_core_set_plane_buffer(uint32_t uBufferId)
 {
+   ruby_drm_core_wait_for_flip_done(100);
+   pthread_mutex_lock(&s_MutexDRMFlip);
    drmModeAtomicSetCursor(s_DRMRuntimeState.pAtomicRequest, 0);
 
    ruby_drm_set_object_property(&s_DRMRuntimeState.objInfoPlane, "FB_ID", uBufferId );
-   int iRet = drmModeAtomicCommit(s_fdDRM, s_DRMRuntimeState.pAtomicRequest, DRM_MODE_ATOMIC_ALLOW_MODESET, NULL);
+   int iRet = _ruby_drm_commit_flip();
+   pthread_mutex_unlock(&s_MutexDRMFlip);
    return iRet;
 }
 
@@ -1017,4 +1328,129 @@ void ruby_drm_set_video_source_size(int iWidth, int iHeight)
 {
    s_DRMRuntimeState.iVideoSourceWidth = iWidth;
    s_DRMRuntimeState.iVideoSourceHeight = iHeight;
-}
\ No newline at end of file
+}
+
+int ruby_drm_core_setup_static_layer_plane()
+{
+   if ( (! s_iDRMCoreInitialized) || (s_fdDRM < 0) || (NULL == s_DRMRuntimeState.pPlanesResources) )
+      return -1;
+   if ( s_DRMRuntimeState.iStaticLayerEnabled )
+      return 0;
+
+   // Any other ARGB plane usable on current CRTC, except the video plane (index 1)
+   s_DRMRuntimeState.objInfoStaticLayerPlane.uObjType = DRM_MODE_OBJECT_PLANE;
+   s_DRMRuntimeState.objInfoStaticLayerPlane.uObjId = 0xFFFFFFFF;
+   for (int i = 2; i < s_DRMRuntimeState.pPlanesResources->count_planes; i++)
+   {
+      if ( i == s_DRMRuntimeState.objInfoPlane.iObjIndex )
+         continue;
+      drmModePlanePtr pPlane = drmModeGetPlane(s_fdDRM, s_DRMRuntimeState.pPlanesResources->planes[i]);
+      if ( NULL == pPlane )
+         continue;
+      int iFormatOk = 0;
+      if ( pPlane->possible_crtcs & (1 << s_DRMRuntimeState.objInfoCRTc.iObjIndex) )
+      for (int j=0; j<pPlane->count_formats; j++)
+      {
+         if ( pPlane->formats[j] == DRM_FORMAT_ARGB8888 )
+         {
+            iFormatOk = 1;
+            break;
+         }
+      }
+      if ( iFormatOk )
+      {
+         s_DRMRuntimeState.pStaticLayerPlane = pPlane;
+         s_DRMRuntimeState.objInfoStaticLayerPlane.uObjId = s_DRMRuntimeState.pPlanesResources->planes[i];
+         s_DRMRuntimeState.objInfoStaticLayerPlane.iObjIndex = i;
+         break;
+      }
+      drmModeFreePlane(pPlane);
+   }
+
+   if ( 0xFFFFFFFF == s_DRMRuntimeState.objInfoStaticLayerPlane.uObjId )
+   {
+      log_line("[DRMCore] No free plane for the static layer. Static layer is disabled.");
+      return -1;
+   }
+   if ( 0 != _ruby_drm_get_object_properties(&s_DRMRuntimeState.objInfoStaticLayerPlane) )
+   {
+      drmModeFreePlane(s_DRMRuntimeState.pStaticLayerPlane);
+      s_DRMRuntimeState.pStaticLayerPlane = NULL;
+      return -1;
+   }
+   if ( (0 != _ruby_drm_create_drm_surface_buffer(&s_DRMRuntimeState.staticLayerBuffers[0])) ||
+        (0 != _ruby_drm_create_drm_surface_buffer(&s_DRMRuntimeState.staticLayerBuffers[1])) )
+   {
+      log_softerror_and_alarm("[DRMCore] Failed to create static layer buffers. Static layer is disabled.");
+      _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.staticLayerBuffers[0]);
+      _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.staticLayerBuffers[1]);
+      _ruby_drm_free_object_properties(&s_DRMRuntimeState.objInfoStaticLayerPlane);
+      drmModeFreePlane(s_DRMRuntimeState.pStaticLayerPlane);
+      s_DRMRuntimeState.pStaticLayerPlane = NULL;
+      return -1;
+   }
+
+   int iRet = -EINVAL;
+   if ( 0 == _ruby_drm_get_static_layer_zpos() )
+   {
+      // Only check that the plane can be shown; it's turned on by the first static layer swap
+      pthread_mutex_lock(&s_MutexDRMFlip);
+      s_DRMRuntimeState.iStaticLayerActiveBuffer = 0;
+      s_DRMRuntimeState.iStaticLayerSwapQueued = 0;
+      s_DRMRuntimeState.iStaticLayerHideQueued = 0;
+      s_DRMRuntimeState.iStaticLayerOnScreen = 0;
+      drmModeAtomicSetCursor(s_DRMRuntimeState.pAtomicRequest, 0);
+      _ruby_drm_add_static_layer_plane_on(0);
+      iRet = drmModeAtomicCommit(s_fdDRM, s_DRMRuntimeState.pAtomicRequest, DRM_MODE_ATOMIC_TEST_ONLY | DRM_MODE_ATOMIC_ALLOW_MODESET, NULL);
+      pthread_mutex_unlock(&s_MutexDRMFlip);
+   }
+   if ( 0 != iRet )
+   {
+      log_softerror_and_alarm("[DRMCore] Failed to set static layer plane (error %d). Static layer is disabled.", iRet);
+      _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.staticLayerBuffers[0]);
+      _ruby_drm_destroy_drm_surface_buffer(&s_DRMRuntimeState.staticLayerBuffers[1]);
+      _ruby_drm_free_object_properties(&s_DRMRuntimeState.objInfoStaticLayerPlane);
+      drmModeFreePlane(s_DRMRuntimeState.pStaticLayerPlane);
+      s_DRMRuntimeState.pStaticLayerPlane = NULL;
+      return -1;
+   }
+   s_DRMRuntimeState.iStaticLayerEnabled = 1;
+   log_line("[DRMCore] Static layer set up on plane index %d (plane id %u), zpos %d",
+      s_DRMRuntimeState.objInfoStaticLayerPlane.iObjIndex, s_DRMRuntimeState.objInfoStaticLayerPlane.uObjId, (int)s_DRMRuntimeState.uStaticLayerZPos);
+   return 0;
+}
+
+int ruby_drm_core_has_static_layer_plane()
+{
+   return s_DRMRuntimeState.iStaticLayerEnabled;
+}
+
+type_drm_buffer* ruby_drm_core_get_static_layer_draw_buffer(int iIndex)
+{
+   if ( (! s_DRMRuntimeState.iStaticLayerEnabled) || (iIndex < 0) || (iIndex > 1) )
+      return NULL;
+   return &(s_DRMRuntimeState.staticLayerBuffers[iIndex]);
+}
+
+type_drm_buffer* ruby_drm_core_get_static_layer_back_buffer()
+{
+   if ( ! s_DRMRuntimeState.iStaticLayerEnabled )
+      return NULL;
+   return &(s_DRMRuntimeState.staticLayerBuffers[1-s_DRMRuntimeState.iStaticLayerActiveBuffer]);
+}
+
+// The static layer buffers are swapped on the next main buffers swap
+
+void ruby_drm_core_queue_static_layer_swap()
+{
+   s_DRMRuntimeState.iStaticLayerSwapQueued = 1;
+   s_DRMRuntimeState.iStaticLayerHideQueued = 0;
+}
+
+// The static layer plane is turned off on the next main buffers swap, until the next static layer swap
+
+void ruby_drm_core_queue_static_layer_hide()
+{
+   s_DRMRuntimeState.iStaticLayerHideQueued = 1;
+   s_DRMRuntimeState.iStaticLayerSwapQueued = 0;
+}
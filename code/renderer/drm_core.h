@@ -11,6 +11,9 @@
 extern "C" {
 #endif  
 
+// 2 draw buffers by default, 3 when triple buffering is enabled
+#define DRM_CORE_MAX_DRAW_BUFFERS 3
+
 typedef struct
 {
   int iWidth;
@@ -62,9 +65,22 @@ typedef struct
    uint32_t uPlaneFormat;
    int iPlaneFormatIndex;
 
-   type_drm_buffer drawBuffers[2];
+   type_drm_buffer drawBuffers[DRM_CORE_MAX_DRAW_BUFFERS];
+   int iDrawBuffersCount;
    int iActiveOnScreenDrawBuffer;
 
+   // Optional second OSD plane, below the main one, for content that changes rarely
+   drmModePlanePtr pStaticLayerPlane;
+   type_drm_object_info objInfoStaticLayerPlane;
+   type_drm_buffer staticLayerBuffers[2];
+   int iStaticLayerEnabled;
+   int iStaticLayerOnScreen; // The plane is attached to the CRTC only while the static layer has content
+   int iStaticLayerActiveBuffer;
+   int iStaticLayerSwapQueued;
+   int iStaticLayerHideQueued;
+   int iStaticLayerSetZPos; // 0 if the plane zpos is immutable
+   uint64_t uStaticLayerZPos;
+
    drmModeAtomicReq* pAtomicRequest;
 
    int iVideoSourceWidth;
@@ -74,7 +90,11 @@ typedef struct
 int ruby_drm_core_is_display_connected();
 int ruby_drm_core_wait_for_display_connected();
 
+// Must be called before ruby_drm_core_init
+void ruby_drm_core_set_triple_buffering(int iEnable);
 int ruby_drm_core_init(int iPlaneIndex, uint32_t uFormat, int iWidth, int iHeight, int iRefreshRate);
+// Headless mode (benchmarks, tests): ARGB draw buffers in memory, nothing is shown on a display
+int ruby_drm_core_init_memory(int iWidth, int iHeight);
 int ruby_drm_core_uninit();
 int ruby_drm_core_get_fd();
 
@@ -84,7 +104,16 @@ type_drm_buffer* ruby_drm_core_get_main_draw_buffer();
 type_drm_buffer* ruby_drm_core_get_back_draw_buffer();
 uint32_t ruby_drm_core_get_main_draw_buffer_id();
 uint32_t ruby_drm_core_get_back_draw_buffer_id();
+int ruby_drm_core_get_draw_buffers_count();
+type_drm_buffer* ruby_drm_core_get_draw_buffer(int iIndex);
+// Queues a page flip to the back buffer (on next vblank) and returns without waiting for it
 int ruby_drm_swap_mainback_buffers();
+// Waits for the last queued page flip to be on screen. Returns 1 if done, 0 on timeout
+int ruby_drm_core_wait_for_flip_done(int iTimeoutMs);
+// Waits until the back buffer is not on screen anymore (no wait when triple buffering is used)
+int ruby_drm_core_wait_for_back_buffer_free(int iTimeoutMs);
+uint32_t ruby_drm_core_get_last_flip_done_time_micros();
+uint32_t ruby_drm_core_get_flips_count();
 
 int ruby_drm_core_set_plane_properties_and_buffer(uint32_t uBufferId);
 int ruby_drm_core_set_plane_buffer(uint32_t uBufferId);
@@ -94,6 +123,16 @@ int ruby_drm_set_object_property(type_drm_object_info* pObject, const char *szNa
 
 void ruby_drm_set_video_source_size(int iWidth, int iHeight);
 
+// Static layer: an extra ARGB overlay plane between the video plane and the main OSD plane.
+// Its buffers are swapped together with the main OSD buffers, in the same atomic commit.
+// The plane is set up once, but is shown only after the first swap and is turned off again by a hide.
+int ruby_drm_core_setup_static_layer_plane();
+int ruby_drm_core_has_static_layer_plane();
+type_drm_buffer* ruby_drm_core_get_static_layer_draw_buffer(int iIndex);
+type_drm_buffer* ruby_drm_core_get_static_layer_back_buffer();
+void ruby_drm_core_queue_static_layer_swap();
+void ruby_drm_core_queue_static_layer_hide();
+
 #ifdef __cplusplus
 }  
 #endif
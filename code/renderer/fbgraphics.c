@@ -39,6 +39,7 @@
 #endif
 
 #include "fbgraphics.h"
+#include "render_kernels.h"
 
 #ifdef FBG_PARALLEL
     void fbg_terminateFragments(struct _fbg *fbg);
@@ -797,24 +798,15 @@ void fbg_plot(struct _fbg *fbg, int index, unsigned char value) {
 void fbg_hline(struct _fbg *fbg, int x, int y, int w, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
 {
     unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
+    unsigned char color[4] = {r, g, b, a};
 
     if ( fbg->s_iEnableRectBlending )
-    {
-       for (int xx = 0; xx < w; xx++)
-       {
-         fbg_pixela_fast(fbg, pix_pointer, r,g,b,a);
-         pix_pointer += 4;
-       }
-    }
+       render_span_blend_color(pix_pointer, w, color, a);
     else
     {
-       for (int xx = 0; xx < w; xx++)
-       {
-         *pix_pointer++ = r;
-         *pix_pointer++ = g;
-         *pix_pointer++ = b;
-         *pix_pointer++ = a;
-       }
+       u32 pixel;
+       memcpy(&pixel, color, 4);
+       render_span_fill(pix_pointer, w, pixel);
     }
 }
 
@@ -924,20 +916,15 @@ void fbg_polygon(struct _fbg *fbg, int num_vertices, int *vertices, unsigned cha
 
 void fbg_recta(struct _fbg *fbg, int x, int y, int w, int h, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
 {
-    int xx = 0, yy = 0, w4 = w * fbg->components;
+    int yy = 0;
+    unsigned char color[3] = {r, g, b};
 
     unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
 
     for (yy = 0; yy < h; yy += 1)
     {
-        for (xx = 0; xx < w; xx += 1)
-        {
-           fbg_pixela_fast(fbg, pix_pointer, r,g,b,a);
-           //fbg_pixela(fbg, x + xx, y + yy, r,g,b,a);
-           pix_pointer += 4;
-        }
-
-        pix_pointer += (fbg->line_length - w4);
+        render_span_blend_color(pix_pointer, w, color, a);
+        pix_pointer += fbg->line_length;
     }
 }
 
@@ -947,6 +934,18 @@ void fbg_rect(struct _fbg *fbg, int x, int y, int w, int h, unsigned char r, uns
 
     unsigned char *pix_pointer = (unsigned char *)(fbg->back_buffer + (y * fbg->line_length + x * fbg->components));
 
+    if ( 4 == fbg->components )
+    {
+        unsigned char color[4] = {r, g, b, a};
+        u32 pixel;
+        memcpy(&pixel, color, 4);
+        for (yy = 0; yy < h; yy += 1) {
+            render_span_fill(pix_pointer, w, pixel);
+            pix_pointer += fbg->line_length;
+        }
+        return;
+    }
+
     for (yy = 0; yy < h; yy += 1) {
         for (xx = 0; xx < w; xx += 1) {
             *pix_pointer++ = r;
@@ -1667,24 +1666,12 @@ void fbg_imageClipAColor(struct _fbg *fbg, struct _fbg_img *img, int x, int y, i
     }
     else
     {
+       unsigned char mix[4] = {fbg->mix_color.r, fbg->mix_color.g, fbg->mix_color.b, fbg->mix_color.a};
        for (i = 0; i < h; i += 1) 
        {
-          for (int j=0; j<cw; j++ )
-          {
-            r = *pSrcPointer;
-            g = *(pSrcPointer+1);
-            b = *(pSrcPointer+2);
-            a = *(pSrcPointer+3);
-            r = (r*fbg->mix_color.r)>>8;
-            g = (g*fbg->mix_color.g)>>8;
-            b = (b*fbg->mix_color.b)>>8;
-            a = (a*fbg->mix_color.a)>>8;
-            fbg_pixela_fast(fbg, pDestPointer, r,g,b,a);
-            pDestPointer += 4;
-            pSrcPointer += 4;
-          }
-          pDestPointer += fbg->line_length - cw*4;
-          pSrcPointer += img->width * fbg->components - cw*4;
+          render_span_blend_mixed(pDestPointer, pSrcPointer, cw, mix);
+          pDestPointer += fbg->line_length;
+          pSrcPointer += img->width * fbg->components;
        }
     }
 }
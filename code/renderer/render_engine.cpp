@@ -30,6 +30,7 @@
 */
 
 #include "render_engine.h"
+#include "render_kernels.h"
 #include "../base/config_hw.h"
 #include <math.h>
 
@@ -44,15 +45,19 @@
 
 #include "../base/base.h"
 #include "../base/hardware.h"
+#include <pthread.h>
 
 static RenderEngine* s_pRenderEngine = NULL;
 static bool s_bRenderEngineSupportsRawFonts = false;
+static pthread_mutex_t s_MutexRenderEngine;
+static bool s_bMutexRenderEngineInitialized = false;
 
 RenderEngine* render_init_engine()
 {
    log_line("Renderer Engine Init...");
    if ( NULL == s_pRenderEngine )
    {
+      render_kernels_init();
       #if defined (HW_PLATFORM_RASPBERRY)
       s_bRenderEngineSupportsRawFonts = true;
       s_pRenderEngine = new RenderEngineRaw();
@@ -68,6 +73,19 @@ RenderEngine* render_init_engine()
    return s_pRenderEngine;
 }
 
+// Uses the given engine instead of the display one of the platform (i.e. a headless engine)
+RenderEngine* render_init_engine_custom(RenderEngine* pEngine)
+{
+   log_line("Renderer Engine Init (custom engine)...");
+   if ( (NULL != s_pRenderEngine) || (NULL == pEngine) )
+      return s_pRenderEngine;
+   render_kernels_init();
+   s_bRenderEngineSupportsRawFonts = true;
+   s_pRenderEngine = pEngine;
+   s_pRenderEngine->initEngine();
+   return s_pRenderEngine;
+}
+
 bool render_engine_uses_raw_fonts()
 {
    return s_bRenderEngineSupportsRawFonts;  
@@ -83,6 +101,38 @@ void render_free_engine()
    s_pRenderEngine = NULL;
 }
 
+bool render_engine_init_lock()
+{
+   if ( s_bMutexRenderEngineInitialized )
+      return true;
+   pthread_mutexattr_t attrRenderEngine;
+   pthread_mutexattr_init(&attrRenderEngine);
+   pthread_mutexattr_settype(&attrRenderEngine, PTHREAD_MUTEX_RECURSIVE);
+   if ( 0 == pthread_mutex_init(&s_MutexRenderEngine, &attrRenderEngine) )
+      s_bMutexRenderEngineInitialized = true;
+   else
+      log_softerror_and_alarm("Failed to create render engine mutex.");
+   pthread_mutexattr_destroy(&attrRenderEngine);
+   return s_bMutexRenderEngineInitialized;
+}
+
+bool render_engine_has_lock()
+{
+   return s_bMutexRenderEngineInitialized;
+}
+
+void render_engine_lock()
+{
+   if ( s_bMutexRenderEngineInitialized )
+      pthread_mutex_lock(&s_MutexRenderEngine);
+}
+
+void render_engine_unlock()
+{
+   if ( s_bMutexRenderEngineInitialized )
+      pthread_mutex_unlock(&s_MutexRenderEngine);
+}
+
 extern "C" {
 void render_engine_test()
 {
@@ -124,6 +174,19 @@ RenderEngine::RenderEngine()
 
    m_CurrentRawFontId = 0;
    m_iCountRawFonts = 0;
+   m_iLastRawFontIndexLookup = -1;
+
+   m_iDamageBufferIndex = -1;
+   m_bDamageFrameInProgress = false;
+   for( int i=0; i<RENDER_DAMAGE_MAX_BUFFERS; i++ )
+      m_bDamageValid[i] = false;
+   m_iDamageTilesX = 0;
+   m_iDamageTilesY = 0;
+   memset(m_uDamageTileOwner, 0, sizeof(m_uDamageTileOwner));
+   memset(m_uDamageTileOwnerPrev, 0, sizeof(m_uDamageTileOwnerPrev));
+   memset(m_bDamageTilePending, 0, sizeof(m_bDamageTilePending));
+   memset(m_CachedRegions, 0, sizeof(m_CachedRegions));
+   m_iActiveCachedRegion = -1;
 }
 
 
@@ -254,9 +317,304 @@ void RenderEngine::disableRectBlending()
 
 void RenderEngine::setClearBufferByte(u8 uClearByte)
 {
+   if ( uClearByte != m_uClearBufferByte )
+      invalidateDamage();
    m_uClearBufferByte = uClearByte;
 }
 
+void RenderEngine::invalidateDamage()
+{
+   for( int i=0; i<RENDER_DAMAGE_MAX_BUFFERS; i++ )
+      m_bDamageValid[i] = false;
+}
+
+bool RenderEngine::hasStaticLayer()
+{
+   return false;
+}
+
+bool RenderEngine::beginStaticLayer(u32 uContentHash)
+{
+   return false;
+}
+
+void RenderEngine::endStaticLayer()
+{
+}
+
+void RenderEngine::hideStaticLayer()
+{
+}
+
+bool RenderEngine::beginCachedRegion(u32 uRegionId, float xPos, float yPos, float fWidth, float fHeight, u32 uContentHash)
+{
+   m_iActiveCachedRegion = -1;
+   if ( (m_iDamageBufferIndex < 0) || (! m_bDamageFrameInProgress) )
+      return true;
+
+   int x = xPos*m_iRenderWidth;
+   int y = yPos*m_iRenderHeight;
+   int w = fWidth*m_iRenderWidth + 1;
+   int h = fHeight*m_iRenderHeight + 1;
+   if ( x < 0 )
+   {
+      w += x;
+      x = 0;
+   }
+   if ( y < 0 )
+   {
+      h += y;
+      y = 0;
+   }
+   if ( x + w > m_iRenderWidth )
+      w = m_iRenderWidth - x;
+   if ( y + h > m_iRenderHeight )
+      h = m_iRenderHeight - y;
+   if ( (w <= 0) || (h <= 0) )
+      return true;
+
+   RenderEngineCachedRegion* pRegions = m_CachedRegions[m_iDamageBufferIndex];
+   int iSlot = -1;
+   for( int i=0; i<RENDER_DAMAGE_MAX_CACHED_REGIONS; i++ )
+   {
+      if ( pRegions[i].bUsed && (pRegions[i].uRegionId == uRegionId) )
+      {
+         iSlot = i;
+         break;
+      }
+   }
+
+   int tx0 = x / RENDER_DAMAGE_TILE_SIZE;
+   int ty0 = y / RENDER_DAMAGE_TILE_SIZE;
+   int tx1 = (x + w - 1) / RENDER_DAMAGE_TILE_SIZE;
+   int ty1 = (y + h - 1) / RENDER_DAMAGE_TILE_SIZE;
+
+   // Same box and content as in the previous frame of this buffer and all its tiles still hold only its content
+   if ( (-1 != iSlot) && (! pRegions[iSlot].bRegisteredThisFrame) )
+   if ( (pRegions[iSlot].uContentHash == uContentHash) &&
+        (pRegions[iSlot].iPixelX == x) && (pRegions[iSlot].iPixelY == y) &&
+        (pRegions[iSlot].iPixelWidth == w) && (pRegions[iSlot].iPixelHeight == h) )
+   {
+      bool bCanKeep = true;
+      for( int ty=ty0; bCanKeep && (ty<=ty1); ty++ )
+      for( int tx=tx0; tx<=tx1; tx++ )
+      {
+         if ( (! m_bDamageTilePending[ty][tx]) || (m_uDamageTileOwnerPrev[ty][tx] != iSlot+1) )
+         {
+            bCanKeep = false;
+            break;
+         }
+      }
+      if ( bCanKeep )
+      {
+         for( int ty=ty0; ty<=ty1; ty++ )
+         for( int tx=tx0; tx<=tx1; tx++ )
+         {
+            m_bDamageTilePending[ty][tx] = false;
+            if ( m_uDamageTileOwner[m_iDamageBufferIndex][ty][tx] == RENDER_DAMAGE_TILE_OWNER_NONE )
+               m_uDamageTileOwner[m_iDamageBufferIndex][ty][tx] = iSlot+1;
+            else
+               m_uDamageTileOwner[m_iDamageBufferIndex][ty][tx] = RENDER_DAMAGE_TILE_OWNER_MIXED;
+         }
+         pRegions[iSlot].bRegisteredThisFrame = true;
+         return false;
+      }
+   }
+
+   if ( -1 == iSlot )
+   {
+      for( int i=0; i<RENDER_DAMAGE_MAX_CACHED_REGIONS; i++ )
+      {
+         if ( ! pRegions[i].bUsed )
+         {
+            iSlot = i;
+            break;
+         }
+      }
+   }
+   if ( -1 == iSlot )
+      return true;
+
+   pRegions[iSlot].bUsed = true;
+   pRegions[iSlot].bRegisteredThisFrame = true;
+   pRegions[iSlot].uRegionId = uRegionId;
+   pRegions[iSlot].uContentHash = uContentHash;
+   pRegions[iSlot].iPixelX = x;
+   pRegions[iSlot].iPixelY = y;
+   pRegions[iSlot].iPixelWidth = w;
+   pRegions[iSlot].iPixelHeight = h;
+
+   // The whole box is owned by the region, even the parts it does not draw on
+   m_iActiveCachedRegion = iSlot;
+   _markDrawnRect(x, y, w, h);
+   return true;
+}
+
+void RenderEngine::endCachedRegion()
+{
+   m_iActiveCachedRegion = -1;
+}
+
+void RenderEngine::_clearDamageRect(int iPixelX, int iPixelY, int iPixelWidth, int iPixelHeight)
+{
+}
+
+void RenderEngine::_clearDamageTile(int tx, int ty)
+{
+   int x = tx * RENDER_DAMAGE_TILE_SIZE;
+   int y = ty * RENDER_DAMAGE_TILE_SIZE;
+   int w = RENDER_DAMAGE_TILE_SIZE;
+   int h = RENDER_DAMAGE_TILE_SIZE;
+   if ( x + w > m_iRenderWidth )
+      w = m_iRenderWidth - x;
+   if ( y + h > m_iRenderHeight )
+      h = m_iRenderHeight - y;
+   _clearDamageRect(x, y, w, h);
+}
+
+void RenderEngine::_damageStartFrame(int iBufferIndex)
+{
+   m_iActiveCachedRegion = -1;
+   m_iDamageTilesX = (m_iRenderWidth + RENDER_DAMAGE_TILE_SIZE - 1) / RENDER_DAMAGE_TILE_SIZE;
+   m_iDamageTilesY = (m_iRenderHeight + RENDER_DAMAGE_TILE_SIZE - 1) / RENDER_DAMAGE_TILE_SIZE;
+
+   // A frame that was started but not ended leaves the tiles info incomplete
+   if ( m_bDamageFrameInProgress )
+      invalidateDamage();
+
+   if ( (iBufferIndex < 0) || (iBufferIndex >= RENDER_DAMAGE_MAX_BUFFERS) ||
+        (m_iDamageTilesX > RENDER_DAMAGE_MAX_TILES_X) || (m_iDamageTilesY > RENDER_DAMAGE_MAX_TILES_Y) )
+   {
+      m_iDamageBufferIndex = -1;
+      m_bDamageFrameInProgress = false;
+      _clearDamageRect(0, 0, m_iRenderWidth, m_iRenderHeight);
+      return;
+   }
+
+   m_iDamageBufferIndex = iBufferIndex;
+   m_bDamageFrameInProgress = true;
+   memcpy(m_uDamageTileOwnerPrev, m_uDamageTileOwner[iBufferIndex], sizeof(m_uDamageTileOwnerPrev));
+   memset(m_uDamageTileOwner[iBufferIndex], 0, sizeof(m_uDamageTileOwner[iBufferIndex]));
+   memset(m_bDamageTilePending, 0, sizeof(m_bDamageTilePending));
+
+   for( int i=0; i<RENDER_DAMAGE_MAX_CACHED_REGIONS; i++ )
+      m_CachedRegions[iBufferIndex][i].bRegisteredThisFrame = false;
+
+   if ( ! m_bDamageValid[iBufferIndex] )
+   {
+      memset(m_CachedRegions[iBufferIndex], 0, sizeof(m_CachedRegions[iBufferIndex]));
+      _clearDamageRect(0, 0, m_iRenderWidth, m_iRenderHeight);
+      return;
+   }
+
+   // Tiles drawn only by a cached region are cleared later, if the region changed or is not drawn anymore
+   for( int ty=0; ty<m_iDamageTilesY; ty++ )
+   {
+      int tx = 0;
+      while ( tx < m_iDamageTilesX )
+      {
+         u8 uOwner = m_uDamageTileOwnerPrev[ty][tx];
+         if ( RENDER_DAMAGE_TILE_OWNER_NONE == uOwner )
+         {
+            tx++;
+            continue;
+         }
+         if ( RENDER_DAMAGE_TILE_OWNER_MIXED != uOwner )
+         {
+            m_bDamageTilePending[ty][tx] = true;
+            tx++;
+            continue;
+         }
+         // Clear consecutive tiles of a row at once
+         int txEnd = tx+1;
+         while ( (txEnd < m_iDamageTilesX) && (RENDER_DAMAGE_TILE_OWNER_MIXED == m_uDamageTileOwnerPrev[ty][txEnd]) )
+            txEnd++;
+         int x = tx * RENDER_DAMAGE_TILE_SIZE;
+         int y = ty * RENDER_DAMAGE_TILE_SIZE;
+         int w = (txEnd - tx) * RENDER_DAMAGE_TILE_SIZE;
+         int h = RENDER_DAMAGE_TILE_SIZE;
+         if ( x + w > m_iRenderWidth )
+            w = m_iRenderWidth - x;
+         if ( y + h > m_iRenderHeight )
+            h = m_iRenderHeight - y;
+         _clearDamageRect(x, y, w, h);
+         tx = txEnd;
+      }
+   }
+}
+
+void RenderEngine::_damageEndFrame()
+{
+   m_iActiveCachedRegion = -1;
+   if ( (m_iDamageBufferIndex < 0) || (! m_bDamageFrameInProgress) )
+      return;
+
+   for( int ty=0; ty<m_iDamageTilesY; ty++ )
+   for( int tx=0; tx<m_iDamageTilesX; tx++ )
+   {
+      if ( m_bDamageTilePending[ty][tx] )
+      {
+         _clearDamageTile(tx, ty);
+         m_bDamageTilePending[ty][tx] = false;
+      }
+   }
+
+   for( int i=0; i<RENDER_DAMAGE_MAX_CACHED_REGIONS; i++ )
+   {
+      if ( ! m_CachedRegions[m_iDamageBufferIndex][i].bRegisteredThisFrame )
+         m_CachedRegions[m_iDamageBufferIndex][i].bUsed = false;
+   }
+   m_bDamageValid[m_iDamageBufferIndex] = true;
+   m_bDamageFrameInProgress = false;
+}
+
+void RenderEngine::_markDrawnRect(int iPixelX, int iPixelY, int iPixelWidth, int iPixelHeight)
+{
+   if ( (m_iDamageBufferIndex < 0) || (! m_bDamageFrameInProgress) )
+      return;
+
+   if ( iPixelX < 0 )
+   {
+      iPixelWidth += iPixelX;
+      iPixelX = 0;
+   }
+   if ( iPixelY < 0 )
+   {
+      iPixelHeight += iPixelY;
+      iPixelY = 0;
+   }
+   if ( iPixelX + iPixelWidth > m_iRenderWidth )
+      iPixelWidth = m_iRenderWidth - iPixelX;
+   if ( iPixelY + iPixelHeight > m_iRenderHeight )
+      iPixelHeight = m_iRenderHeight - iPixelY;
+   if ( (iPixelWidth <= 0) || (iPixelHeight <= 0) )
+      return;
+
+   int tx0 = iPixelX / RENDER_DAMAGE_TILE_SIZE;
+   int ty0 = iPixelY / RENDER_DAMAGE_TILE_SIZE;
+   int tx1 = (iPixelX + iPixelWidth - 1) / RENDER_DAMAGE_TILE_SIZE;
+   int ty1 = (iPixelY + iPixelHeight - 1) / RENDER_DAMAGE_TILE_SIZE;
+   u8 uOwner = RENDER_DAMAGE_TILE_OWNER_MIXED;
+   if ( -1 != m_iActiveCachedRegion )
+      uOwner = m_iActiveCachedRegion + 1;
+
+   for( int ty=ty0; ty<=ty1; ty++ )
+   for( int tx=tx0; tx<=tx1; tx++ )
+   {
+      // Tile still holds the previous content of a cached region, clear it before drawing over it
+      if ( m_bDamageTilePending[ty][tx] )
+      {
+         _clearDamageTile(tx, ty);
+         m_bDamageTilePending[ty][tx] = false;
+      }
+      u8* pOwner = &(m_uDamageTileOwner[m_iDamageBufferIndex][ty][tx]);
+      if ( RENDER_DAMAGE_TILE_OWNER_NONE == *pOwner )
+         *pOwner = uOwner;
+      else if ( *pOwner != uOwner )
+         *pOwner = RENDER_DAMAGE_TILE_OWNER_MIXED;
+   }
+}
+
 void RenderEngine::setColors(double* color)
 {
    setColors(color, 1.0);
@@ -404,10 +762,18 @@ void RenderEngine::enableFontScaling(bool bEnable)
 
 int RenderEngine::_getRawFontIndexFromId(u32 fontId)
 {
+   // Consecutive text calls mostly use the same font
+   if ( (m_iLastRawFontIndexLookup >= 0) && (m_iLastRawFontIndexLookup < m_iCountRawFonts) )
+   if ( m_RawFontIds[m_iLastRawFontIndexLookup] == fontId )
+      return m_iLastRawFontIndexLookup;
+
    for( int i=0; i<m_iCountRawFonts; i++ )
    {
       if ( m_RawFontIds[i] == fontId )
+      {
+         m_iLastRawFontIndexLookup = i;
          return i;
+      }
    }
    return -1;
 }
@@ -429,22 +795,38 @@ float RenderEngine::_get_raw_space_width(RenderEngineRawFont* pFont)
    return pFont->lineHeight*0.25*m_fPixelHeight + pFont->lineHeight * pFont->dxLetters * m_fPixelWidth;
 }
    
+// Char widths are looked up for each char of each measured or drawn text, so they are computed once per font
+
+void RenderEngine::_update_raw_char_widths(RenderEngineRawFont* pFont)
+{
+   pFont->fCharWidthsPixelWidth = m_fPixelWidth;
+   pFont->fCharWidthsPixelHeight = m_fPixelHeight;
+   pFont->fCharWidthsDxLetters = pFont->dxLetters;
+   for( int ch=0; ch<MAX_FONT_CHARS; ch++ )
+   {
+      float fWidth = 0.0;
+      if ( ch == ' ' )
+         fWidth = _get_raw_space_width(pFont);
+      else if ( (ch >= pFont->charIdFirst) && (ch <= pFont->charIdLast) )
+      {
+         fWidth = pFont->chars[ch-pFont->charIdFirst].xAdvance * m_fPixelWidth;
+         fWidth += pFont->dxLetters * pFont->lineHeight*m_fPixelWidth;
+      }
+      pFont->fCharWidths[ch] = fWidth;
+   }
+}
+
 float RenderEngine::_get_raw_char_width(RenderEngineRawFont* pFont, int ch)
 {
    if ( NULL == pFont )
       return 0.0;
+   if ( (ch < 0) || (ch >= MAX_FONT_CHARS) )
+      return 0.0;
 
-   if ( ch == ' ' )
-      return _get_raw_space_width(pFont);
-   
-   float fWidth = 0.0;
-
-   if ( (ch >= pFont->charIdFirst) && (ch <= pFont->charIdLast) )
-   {
-      fWidth = pFont->chars[ch-pFont->charIdFirst].xAdvance * m_fPixelWidth;
-      fWidth += pFont->dxLetters * pFont->lineHeight*m_fPixelWidth;
-   }
-   return fWidth;
+   // The space width depends on the pixel height too
+   if ( (pFont->fCharWidthsPixelWidth != m_fPixelWidth) || (pFont->fCharWidthsPixelHeight != m_fPixelHeight) || (pFont->fCharWidthsDxLetters != pFont->dxLetters) )
+      _update_raw_char_widths(pFont);
+   return pFont->fCharWidths[ch];
 }
 
 void RenderEngine::_drawSimpleText(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos)
@@ -556,6 +938,9 @@ int RenderEngine::loadRawFont(const char* szFontFile)
    m_pRawFonts[m_iCountRawFonts]->charIdFirst = m_pRawFonts[m_iCountRawFonts]->chars[0].charId;
    m_pRawFonts[m_iCountRawFonts]->charIdLast = m_pRawFonts[m_iCountRawFonts]->chars[m_pRawFonts[m_iCountRawFonts]->charCount-1].charId;
    m_pRawFonts[m_iCountRawFonts]->dxLetters = 0.0;
+   // Kerning pairs are not loaded from the font files, so there is no kerning to apply
+   m_pRawFonts[m_iCountRawFonts]->keringsCount = 0;
+   _update_raw_char_widths(m_pRawFonts[m_iCountRawFonts]);
    m_CurrentRawFontId++;
    m_RawFontIds[m_iCountRawFonts] = m_CurrentRawFontId;
 
@@ -589,6 +974,7 @@ void RenderEngine::freeRawFont(u32 idFont)
       m_RawFontIds[i] = m_RawFontIds[i+1];
    }
    m_iCountRawFonts--;
+   m_iLastRawFontIndexLookup = -1;
    log_line("Unloaded font id %u, remaining fonts: %d", idFont, m_iCountRawFonts);
 }
 
@@ -635,6 +1021,97 @@ void RenderEngine::bltIcon(float xPosDest, float yPosDest, int iSrcX, int iSrcY,
 
 }
 
+bool RenderEngine::canDrawBitmaps()
+{
+   return false;
+}
+
+// Default draw buffer channel order is RGBA
+u32 RenderEngine::makeBitmapPixel(u8 r, u8 g, u8 b, u8 a)
+{
+   u8 uPixel[4] = { (u8)((r*a)/255), (u8)((g*a)/255), (u8)((b*a)/255), a };
+   u32 uValue;
+   memcpy(&uValue, uPixel, 4);
+   return uValue;
+}
+
+void RenderEngine::drawBitmap(float xPos, float yPos, const u32* pPixels, int iWidth, int iHeight)
+{
+}
+
+u8* RenderEngine::_getDrawBufferPixels(int* piStride)
+{
+   return NULL;
+}
+
+bool RenderEngine::_clipBitmapRect(float xPos, float yPos, int iWidth, int iHeight, int* piDestX, int* piDestY, int* piSrcX, int* piSrcY, int* piClipWidth, int* piClipHeight)
+{
+   *piDestX = xPos*m_iRenderWidth;
+   *piDestY = yPos*m_iRenderHeight;
+   *piSrcX = 0;
+   *piSrcY = 0;
+   if ( *piDestX < 0 )
+   {
+      *piSrcX = -(*piDestX);
+      *piDestX = 0;
+   }
+   if ( *piDestY < 0 )
+   {
+      *piSrcY = -(*piDestY);
+      *piDestY = 0;
+   }
+   *piClipWidth = iWidth - *piSrcX;
+   *piClipHeight = iHeight - *piSrcY;
+   if ( *piDestX + *piClipWidth > m_iRenderWidth )
+      *piClipWidth = m_iRenderWidth - *piDestX;
+   if ( *piDestY + *piClipHeight > m_iRenderHeight )
+      *piClipHeight = m_iRenderHeight - *piDestY;
+   return (*piClipWidth > 0) && (*piClipHeight > 0);
+}
+
+bool RenderEngine::readBitmap(float xPos, float yPos, u32* pPixels, int iWidth, int iHeight)
+{
+   int iStride = 0;
+   u8* pBuffer = _getDrawBufferPixels(&iStride);
+   if ( (NULL == pPixels) || (NULL == pBuffer) || (! canDrawBitmaps()) )
+      return false;
+
+   int iDestX, iDestY, iSrcX, iSrcY, w, h;
+   if ( ! _clipBitmapRect(xPos, yPos, iWidth, iHeight, &iDestX, &iDestY, &iSrcX, &iSrcY, &w, &h) )
+   {
+      memset(pPixels, 0, iWidth*iHeight*sizeof(u32));
+      return true;
+   }
+   if ( (w < iWidth) || (h < iHeight) )
+      memset(pPixels, 0, iWidth*iHeight*sizeof(u32));
+   for( int y=0; y<h; y++ )
+      memcpy(pPixels + (iSrcY+y)*iWidth + iSrcX, pBuffer + (iDestY+y)*iStride + 4*iDestX, 4*w);
+   return true;
+}
+
+bool RenderEngine::writeBitmap(float xPos, float yPos, const u32* pPixels, int iWidth, int iHeight)
+{
+   int iStride = 0;
+   u8* pBuffer = _getDrawBufferPixels(&iStride);
+   if ( (NULL == pBuffer) || (! canDrawBitmaps()) )
+      return false;
+
+   int iDestX, iDestY, iSrcX, iSrcY, w, h;
+   if ( ! _clipBitmapRect(xPos, yPos, iWidth, iHeight, &iDestX, &iDestY, &iSrcX, &iSrcY, &w, &h) )
+      return true;
+
+   _markDrawnRect(iDestX, iDestY, w, h);
+   for( int y=0; y<h; y++ )
+   {
+      u8* pDestLine = pBuffer + (iDestY+y)*iStride + 4*iDestX;
+      if ( NULL == pPixels )
+         memset(pDestLine, 0, 4*w);
+      else
+         memcpy(pDestLine, pPixels + (iSrcY+y)*iWidth + iSrcX, 4*w);
+   }
+   return true;
+}
+
 
 float RenderEngine::getRawFontHeight(u32 fontId)
 {
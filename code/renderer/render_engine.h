@@ -8,6 +8,20 @@
 #define MAX_RAW_IMAGES 100
 #define MAX_RAW_ICONS 100
 
+// Damage tracking: the screen is split in tiles and draw calls mark the tiles they touch.
+// At the start of a frame only the tiles drawn in the previous frame of the same buffer are cleared.
+// Everything is still drawn every frame, except the video letterbox bands, which are cached regions.
+#define RENDER_DAMAGE_TILE_SIZE 32
+#define RENDER_DAMAGE_MAX_BUFFERS 3
+#define RENDER_DAMAGE_MAX_TILES_X 128
+#define RENDER_DAMAGE_MAX_TILES_Y 72
+#define RENDER_DAMAGE_MAX_CACHED_REGIONS 32
+#define RENDER_DAMAGE_TILE_OWNER_NONE 0
+#define RENDER_DAMAGE_TILE_OWNER_MIXED 0xFF
+
+#define RENDER_REGION_ID_VIDEO_BAND_1 1
+#define RENDER_REGION_ID_VIDEO_BAND_2 2
+
 
 typedef struct
 {
@@ -37,8 +51,23 @@ typedef struct
 
    float dxLetters; // percent -1...0...1 of font height
 
+   // Widths of each char (indexed by char code), in screen units, computed for the pixel size and dxLetters below
+   float fCharWidths[MAX_FONT_CHARS];
+   float fCharWidthsPixelWidth;
+   float fCharWidthsPixelHeight;
+   float fCharWidthsDxLetters;
+
 } RenderEngineRawFont;
 
+typedef struct
+{
+   bool bUsed;
+   bool bRegisteredThisFrame;
+   u32 uRegionId;
+   u32 uContentHash;
+   int iPixelX, iPixelY, iPixelWidth, iPixelHeight;
+} RenderEngineCachedRegion;
+
 
 class RenderEngine
 {
@@ -63,6 +92,24 @@ class RenderEngine
      void disableRectBlending();
      void setClearBufferByte(u8 uClearByte);
 
+     // Forces a full clear of all the draw buffers on the next frames
+     void invalidateDamage();
+     // Cached regions: content of a region is kept from the previous frame drawn in the same buffer
+     // if the region box and content hash did not change and nothing else was drawn over it.
+     // Returns true if the caller must draw the region content, followed by a call to endCachedRegion.
+     // Returns false if the region content is still in the draw buffer (nothing to draw).
+     bool beginCachedRegion(u32 uRegionId, float xPos, float yPos, float fWidth, float fHeight, u32 uContentHash);
+     void endCachedRegion();
+
+     // Static layer: content that changes rarely (backgrounds, video bands), drawn on a separate display plane
+     // below the main one, only when it changes. Only some engines have it.
+     // beginStaticLayer returns true if the content changed and must be drawn now, followed by a call to endStaticLayer.
+     // hideStaticLayer turns the plane off while there is nothing to show on it.
+     virtual bool hasStaticLayer();
+     virtual bool beginStaticLayer(u32 uContentHash);
+     virtual void endStaticLayer();
+     virtual void hideStaticLayer();
+
      virtual void highlightFirstWordOfLine(bool bHighlight);
      virtual bool drawBackgroundBoundingBoxes(bool bEnable);
 
@@ -100,6 +147,16 @@ class RenderEngine
      virtual void drawIcon(float xPos, float yPos, float fWidth, float fHeight, u32 iconId);
      virtual void bltIcon(float xPosDest, float yPosDest, int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, u32 iconId);
 
+     // Bitmaps: premultiplied 4 bytes pixels in the draw buffer channel order (as returned by makeBitmapPixel),
+     // blended over the draw buffer without scaling. Engines that can't draw them return false from canDrawBitmaps.
+     virtual bool canDrawBitmaps();
+     virtual u32 makeBitmapPixel(u8 r, u8 g, u8 b, u8 a);
+     virtual void drawBitmap(float xPos, float yPos, const u32* pPixels, int iWidth, int iHeight);
+     // Copy pixels from/to the draw buffer as they are, without blending (parts outside the screen read as transparent).
+     // writeBitmap with NULL pixels clears the area to transparent. Both return false if the engine can't draw bitmaps.
+     bool readBitmap(float xPos, float yPos, u32* pPixels, int iWidth, int iHeight);
+     bool writeBitmap(float xPos, float yPos, const u32* pPixels, int iWidth, int iHeight);
+
      virtual float getRawFontHeight(u32 fontId);
      virtual float textHeight(u32 fontId);
      virtual float textWidth(u32 fontId, const char* szText);
@@ -136,10 +193,22 @@ class RenderEngine
 
       virtual float _get_raw_space_width(RenderEngineRawFont* pFont);
       virtual float _get_raw_char_width(RenderEngineRawFont* pFont, int ch);
+      void _update_raw_char_widths(RenderEngineRawFont* pFont);
       virtual void _drawSimpleTextBoundingBox(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos, float fScale);
       virtual void _drawSimpleText(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos);
       virtual void _drawSimpleTextScaled(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos, float fScale);
 
+      // Damage tracking, used by engines that draw directly into the display buffers
+      virtual void _clearDamageRect(int iPixelX, int iPixelY, int iPixelWidth, int iPixelHeight);
+      void _clearDamageTile(int tx, int ty);
+      void _damageStartFrame(int iBufferIndex);
+      void _damageEndFrame();
+      void _markDrawnRect(int iPixelX, int iPixelY, int iPixelWidth, int iPixelHeight);
+
+      // Draw buffer memory, for engines that draw directly into it. Returns NULL if not available.
+      virtual u8* _getDrawBufferPixels(int* piStride);
+      bool _clipBitmapRect(float xPos, float yPos, int iWidth, int iHeight, int* piDestX, int* piDestY, int* piSrcX, int* piSrcY, int* piClipWidth, int* piClipHeight);
+
       int m_iRenderDepth;
       int m_iRenderWidth;
       int m_iRenderHeight;
@@ -171,14 +240,34 @@ class RenderEngine
       u32 m_RawFontIds[MAX_RAW_FONTS];
       u32 m_CurrentRawFontId;
       int m_iCountRawFonts;
+      int m_iLastRawFontIndexLookup;
+
+      int m_iDamageBufferIndex; // Buffer being drawn, -1 if damage tracking is not used
+      bool m_bDamageFrameInProgress;
+      bool m_bDamageValid[RENDER_DAMAGE_MAX_BUFFERS];
+      int m_iDamageTilesX;
+      int m_iDamageTilesY;
+      u8 m_uDamageTileOwner[RENDER_DAMAGE_MAX_BUFFERS][RENDER_DAMAGE_MAX_TILES_Y][RENDER_DAMAGE_MAX_TILES_X];
+      u8 m_uDamageTileOwnerPrev[RENDER_DAMAGE_MAX_TILES_Y][RENDER_DAMAGE_MAX_TILES_X];
+      bool m_bDamageTilePending[RENDER_DAMAGE_MAX_TILES_Y][RENDER_DAMAGE_MAX_TILES_X];
+      RenderEngineCachedRegion m_CachedRegions[RENDER_DAMAGE_MAX_BUFFERS][RENDER_DAMAGE_MAX_CACHED_REGIONS];
+      int m_iActiveCachedRegion;
 };
 
 
 
 RenderEngine* render_init_engine();
+RenderEngine* render_init_engine_custom(RenderEngine* pEngine);
 RenderEngine* renderer_engine();
 bool render_engine_uses_raw_fonts();
 
+// Serializes the use of the render engine between threads (render thread, processing loop, OSD plugins threads).
+// Recursive. Lock and unlock do nothing if the lock was not created.
+bool render_engine_init_lock();
+bool render_engine_has_lock();
+void render_engine_lock();
+void render_engine_unlock();
+
 void render_free_engine();
 
 extern "C" {
@@ -32,6 +32,7 @@
 #include "../base/base.h"
 #include "../base/config.h"
 #include "render_engine_cairo.h"
+#include "render_kernels.h"
 #include "drm_core.h"
 
 #include <stdio.h>
@@ -63,22 +64,46 @@ RenderEngineCairo::RenderEngineCairo()
    log_line("RendererCairo: Display size is: %d x %d, pixel size: %.4f x %.4f",
     m_iRenderWidth, m_iRenderHeight,
     m_fPixelWidth, m_fPixelHeight);
-   type_drm_buffer* pMainDisplayBuffer = ruby_drm_core_get_main_draw_buffer();
-   type_drm_buffer* pBackDisplayBuffer = ruby_drm_core_get_back_draw_buffer();
-   
-   m_uRenderDrawSurfacesIds[0] = pMainDisplayBuffer->uBufferId;
-   m_uRenderDrawSurfacesIds[1] = pBackDisplayBuffer->uBufferId;
-
-   m_pMainCairoSurface[0] = cairo_image_surface_create_for_data (pMainDisplayBuffer->pData, CAIRO_FORMAT_ARGB32, 
-       pMainDisplayBuffer->uWidth, pMainDisplayBuffer->uHeight, pMainDisplayBuffer->uStride);
-   m_pMainCairoSurface[1] = cairo_image_surface_create_for_data (pBackDisplayBuffer->pData, CAIRO_FORMAT_ARGB32, 
-       pBackDisplayBuffer->uWidth, pBackDisplayBuffer->uHeight, pBackDisplayBuffer->uStride);
-   if ( (NULL == m_pMainCairoSurface[0]) || (NULL == m_pMainCairoSurface[1]) )
-      log_softerror_and_alarm("RendererCairo: Failed to create main and back cairo surfaces.");
-   else
-      log_line("RendererCairo: Created main and back cairo surfaces for render buffer ids %u and %u", m_uRenderDrawSurfacesIds[0], m_uRenderDrawSurfacesIds[1]);
+   m_iCountDrawSurfaces = ruby_drm_core_get_draw_buffers_count();
+   if ( m_iCountDrawSurfaces > DRM_CORE_MAX_DRAW_BUFFERS )
+      m_iCountDrawSurfaces = DRM_CORE_MAX_DRAW_BUFFERS;
+   for( int i=0; i<m_iCountDrawSurfaces; i++ )
+   {
+      type_drm_buffer* pDisplayBuffer = ruby_drm_core_get_draw_buffer(i);
+      m_uRenderDrawSurfacesIds[i] = pDisplayBuffer->uBufferId;
+      m_pMainCairoSurface[i] = cairo_image_surface_create_for_data (pDisplayBuffer->pData, CAIRO_FORMAT_ARGB32, 
+          pDisplayBuffer->uWidth, pDisplayBuffer->uHeight, pDisplayBuffer->uStride);
+      if ( NULL == m_pMainCairoSurface[i] )
+         log_softerror_and_alarm("RendererCairo: Failed to create cairo surface for render buffer id %u", m_uRenderDrawSurfacesIds[i]);
+      else
+         log_line("RendererCairo: Created cairo surface for render buffer id %u", m_uRenderDrawSurfacesIds[i]);
+   }
+
+   m_bHasStaticLayer = false;
+   m_bDrawingStaticLayer = false;
+   m_bStaticLayerValid = false;
+   m_uStaticLayerContentHash = 0;
+   m_pStaticLayerCairoSurface[0] = NULL;
+   m_pStaticLayerCairoSurface[1] = NULL;
+   if ( ruby_drm_core_has_static_layer_plane() )
+   {
+      m_bHasStaticLayer = true;
+      for( int i=0; i<2; i++ )
+      {
+         type_drm_buffer* pDisplayBuffer = ruby_drm_core_get_static_layer_draw_buffer(i);
+         m_uStaticLayerSurfacesIds[i] = pDisplayBuffer->uBufferId;
+         m_pStaticLayerCairoSurface[i] = cairo_image_surface_create_for_data (pDisplayBuffer->pData, CAIRO_FORMAT_ARGB32, 
+             pDisplayBuffer->uWidth, pDisplayBuffer->uHeight, pDisplayBuffer->uStride);
+         if ( NULL == m_pStaticLayerCairoSurface[i] )
+            m_bHasStaticLayer = false;
+      }
+      log_line("RendererCairo: Static layer is %s.", m_bHasStaticLayer?"used":"not used (failed to create surfaces)");
+   }
 
    m_pCairoCtx = NULL;
+   m_pMainCairoCtx = NULL;
+   m_pTargetBuffer = ruby_drm_core_get_back_draw_buffer();
+   m_pMainTargetBuffer = m_pTargetBuffer;
    
    m_fStrokeSize = 1.0;
    
@@ -86,6 +111,9 @@ RenderEngineCairo::RenderEngineCairo()
    m_iCountIcons = 0;
    m_CurrentImageId = 0;
    m_CurrentIconId = 0;
+
+   memset(m_TextRuns, 0, sizeof(m_TextRuns));
+   m_uTextRunsUseCounter = 0;
    log_line("RendererCairo: Render init done.");
 }
 
@@ -96,13 +124,25 @@ RenderEngineCairo::~RenderEngineCairo()
       cairo_destroy(m_pCairoCtx);
    m_pCairoCtx = NULL; 
 
-   if ( NULL != m_pMainCairoSurface[0] )
-      cairo_surface_destroy(m_pMainCairoSurface[0]);
-   if ( NULL != m_pMainCairoSurface[1] )
-      cairo_surface_destroy(m_pMainCairoSurface[1]);
+   for( int i=0; i<m_iCountDrawSurfaces; i++ )
+   {
+      if ( NULL != m_pMainCairoSurface[i] )
+         cairo_surface_destroy(m_pMainCairoSurface[i]);
+      m_pMainCairoSurface[i] = NULL;
+   }
+   for( int i=0; i<2; i++ )
+   {
+      if ( NULL != m_pStaticLayerCairoSurface[i] )
+         cairo_surface_destroy(m_pStaticLayerCairoSurface[i]);
+      m_pStaticLayerCairoSurface[i] = NULL;
+   }
 
-   m_pMainCairoSurface[0] = NULL;
-   m_pMainCairoSurface[1] = NULL;
+   for( int i=0; i<MAX_CAIRO_TEXT_RUNS_CACHE; i++ )
+   {
+      if ( NULL != m_TextRuns[i].pSurface )
+         cairo_surface_destroy(m_TextRuns[i].pSurface);
+      m_TextRuns[i].pSurface = NULL;
+   }
 }
 
 void* RenderEngineCairo::getDrawContext()
@@ -113,21 +153,27 @@ void* RenderEngineCairo::getDrawContext()
 
 void RenderEngineCairo::startFrame()
 {
+   // With two buffers, the back buffer is on screen until the last queued page flip is done
+   ruby_drm_core_wait_for_back_buffer_free(50);
    type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   m_pTargetBuffer = pOutputBufferInfo;
+   m_pMainTargetBuffer = pOutputBufferInfo;
    
-   memset(pOutputBufferInfo->pData, m_uClearBufferByte, pOutputBufferInfo->uSize);
+   // Clears only the parts of the buffer drawn in the last frame rendered into it
+   int iBufferIndex = -1;
+   for( int i=0; i<m_iCountDrawSurfaces; i++ )
+   {
+      if ( pOutputBufferInfo->uBufferId == m_uRenderDrawSurfacesIds[i] )
+         iBufferIndex = i;
+   }
+   _damageStartFrame(iBufferIndex);
    
    if ( NULL != m_pCairoCtx )
       cairo_destroy(m_pCairoCtx);
    m_pCairoCtx = NULL; 
 
-   if ( pOutputBufferInfo->uBufferId == m_uRenderDrawSurfacesIds[0] )
-   if ( NULL != m_pMainCairoSurface[0] )
-      m_pCairoCtx = cairo_create(m_pMainCairoSurface[0]);
-
-   if ( pOutputBufferInfo->uBufferId == m_uRenderDrawSurfacesIds[1] )
-   if ( NULL != m_pMainCairoSurface[1] )
-      m_pCairoCtx = cairo_create(m_pMainCairoSurface[1]);
+   if ( (-1 != iBufferIndex) && (NULL != m_pMainCairoSurface[iBufferIndex]) )
+      m_pCairoCtx = cairo_create(m_pMainCairoSurface[iBufferIndex]);
 
    if ( NULL == m_pCairoCtx )
       return;
@@ -138,9 +184,100 @@ void RenderEngineCairo::startFrame()
 
 void RenderEngineCairo::endFrame()
 {
+   if ( m_bDrawingStaticLayer )
+      endStaticLayer();
+   _damageEndFrame();
    ruby_drm_swap_mainback_buffers();
 }
 
+bool RenderEngineCairo::hasStaticLayer()
+{
+   return m_bHasStaticLayer;
+}
+
+// Redirects drawing to the static layer back buffer, until endStaticLayer is called.
+// The static layer is fully redrawn (it changes rarely), so damage tracking is paused meanwhile.
+
+bool RenderEngineCairo::beginStaticLayer(u32 uContentHash)
+{
+   if ( (! m_bHasStaticLayer) || m_bDrawingStaticLayer )
+      return false;
+   if ( m_bStaticLayerValid && (uContentHash == m_uStaticLayerContentHash) )
+      return false;
+
+   type_drm_buffer* pStaticBuffer = ruby_drm_core_get_static_layer_back_buffer();
+   if ( NULL == pStaticBuffer )
+      return false;
+   int iIndex = (pStaticBuffer->uBufferId == m_uStaticLayerSurfacesIds[0])?0:1;
+
+   // The static back buffer was on screen until the last flip
+   ruby_drm_core_wait_for_flip_done(50);
+
+   m_uStaticLayerContentHash = uContentHash;
+   m_bDrawingStaticLayer = true;
+   m_bDamageFrameInProgressBeforeStaticLayer = m_bDamageFrameInProgress;
+   m_bDamageFrameInProgress = false;
+   m_pMainCairoCtx = m_pCairoCtx;
+   m_pTargetBuffer = pStaticBuffer;
+   memset(pStaticBuffer->pData, 0, pStaticBuffer->uSize);
+   m_pCairoCtx = cairo_create(m_pStaticLayerCairoSurface[iIndex]);
+   cairo_select_font_face(m_pCairoCtx, "Roboto", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+   cairo_set_line_width(m_pCairoCtx, m_fStrokeSize);
+   return true;
+}
+
+void RenderEngineCairo::endStaticLayer()
+{
+   if ( ! m_bDrawingStaticLayer )
+      return;
+   if ( NULL != m_pCairoCtx )
+      cairo_destroy(m_pCairoCtx);
+   cairo_surface_flush(m_pStaticLayerCairoSurface[(m_pTargetBuffer->uBufferId == m_uStaticLayerSurfacesIds[0])?0:1]);
+   m_pCairoCtx = m_pMainCairoCtx;
+   m_pMainCairoCtx = NULL;
+   m_pTargetBuffer = m_pMainTargetBuffer;
+   m_bDamageFrameInProgress = m_bDamageFrameInProgressBeforeStaticLayer;
+   m_bDrawingStaticLayer = false;
+   m_bStaticLayerValid = true;
+   ruby_drm_core_queue_static_layer_swap();
+}
+
+// The plane is turned on again by the next static layer content drawn
+
+void RenderEngineCairo::hideStaticLayer()
+{
+   if ( (! m_bHasStaticLayer) || m_bDrawingStaticLayer || (! m_bStaticLayerValid) )
+      return;
+   m_bStaticLayerValid = false;
+   ruby_drm_core_queue_static_layer_hide();
+}
+
+void RenderEngineCairo::_clearDamageRect(int iPixelX, int iPixelY, int iPixelWidth, int iPixelHeight)
+{
+   type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
+   if ( (0 == iPixelX) && (0 == iPixelY) && (iPixelWidth >= m_iRenderWidth) && (iPixelHeight >= m_iRenderHeight) )
+   {
+      memset(pOutputBufferInfo->pData, m_uClearBufferByte, pOutputBufferInfo->uSize);
+      return;
+   }
+   u8* pDestLine = (u8*)&(pOutputBufferInfo->pData[iPixelY*pOutputBufferInfo->uStride + 4*iPixelX]);
+   for( int y=0; y<iPixelHeight; y++ )
+   {
+      memset(pDestLine, m_uClearBufferByte, 4*iPixelWidth);
+      pDestLine += pOutputBufferInfo->uStride;
+   }
+}
+
+void RenderEngineCairo::_markStrokedPath(float x1, float y1, float x2, float y2, float fPadding)
+{
+   int iPadding = fPadding + m_fStrokeSize + 2;
+   int xMin = (x1 < x2)?x1:x2;
+   int yMin = (y1 < y2)?y1:y2;
+   int xMax = (x1 < x2)?x2:x1;
+   int yMax = (y1 < y2)?y2:y1;
+   _markDrawnRect(xMin - iPadding, yMin - iPadding, xMax - xMin + 2*iPadding + 1, yMax - yMin + 2*iPadding + 1);
+}
+
 
 void RenderEngineCairo::setStroke(double* color, float fStrokeSize)
 {
@@ -316,6 +453,7 @@ void RenderEngineCairo::drawImage(float xPos, float yPos, float fWidth, float fH
    if ( NULL == m_pImages[indexImage] )
       return;
   
+   _markDrawnRect(0, 0, m_iRenderWidth, m_iRenderHeight);
    double scaleX = cairo_image_surface_get_width(m_pImages[indexImage]) / (float) m_iRenderWidth;
    double scaleY = cairo_image_surface_get_height(m_pImages[indexImage]) / (float) m_iRenderHeight;
    cairo_scale(m_pCairoCtx, 1.0/scaleX, 1.0/scaleY);
@@ -352,7 +490,8 @@ void RenderEngineCairo::drawIcon(float xPos, float yPos, float fWidth, float fHe
    if ( (x < 0) || (y < 0) || (x+w >= m_iRenderWidth) || (y+h >= m_iRenderHeight) )
       return;
 
-   type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   _markDrawnRect(x, y, w, h);
+   type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
    u8* pSrcImageData = cairo_image_surface_get_data(m_pIcons[indexIcon]);
    int iSrcImageStride = cairo_image_surface_get_stride(m_pIcons[indexIcon]);
 
@@ -444,7 +583,8 @@ void RenderEngineCairo::bltIcon(float xPosDest, float yPosDest, int iSrcX, int i
    if ( (ixPosDest < 0) || (iyPosDest < 0) || (ixPosDest+iSrcWidth >= m_iRenderWidth) || (iyPosDest+iSrcHeight >= m_iRenderHeight) )
       return;
 
-   type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   _markDrawnRect(ixPosDest, iyPosDest, iSrcWidth, iSrcHeight);
+   type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
    u8* pSrcImageData = cairo_image_surface_get_data(m_pIcons[indexIcon]);
    int iSrcImageStride = cairo_image_surface_get_stride(m_pIcons[indexIcon]);
 
@@ -456,24 +596,74 @@ void RenderEngineCairo::bltIcon(float xPosDest, float yPosDest, int iSrcX, int i
       u8* pSrcLine = pSrcImageData + ((iSrcY +y)* iSrcImageStride);
       pSrcLine += 4 * iSrcX;
 
-      for( int x=0; x<iSrcWidth; x++ )
-      {
-          u8 uAlpha = *(pSrcLine+3);
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/255;
-          pDestLine++;
-          pSrcLine++;
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/255;
-          pDestLine++;
-          pSrcLine++;
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/255;
-          pDestLine++;
-          pSrcLine++;
-          pDestLine++;
-          pSrcLine++;
-      }
+      render_span_blit_alpha(pDestLine, pSrcLine, iSrcWidth);
+   }
+}
+
+
+bool RenderEngineCairo::canDrawBitmaps()
+{
+   return (NULL != m_pTargetBuffer);
+}
+
+u32 RenderEngineCairo::makeBitmapPixel(u8 r, u8 g, u8 b, u8 a)
+{
+   return _get_bgra_pixel((r*a)/255, (g*a)/255, (b*a)/255, a);
+}
+
+void RenderEngineCairo::drawBitmap(float xPos, float yPos, const u32* pPixels, int iWidth, int iHeight)
+{
+   if ( (NULL == pPixels) || (NULL == m_pTargetBuffer) )
+      return;
+
+   int iDestX = xPos*m_iRenderWidth;
+   int iDestY = yPos*m_iRenderHeight;
+   int iSrcX = 0;
+   int iSrcY = 0;
+   if ( iDestX < 0 )
+   {
+      iSrcX = -iDestX;
+      iDestX = 0;
+   }
+   if ( iDestY < 0 )
+   {
+      iSrcY = -iDestY;
+      iDestY = 0;
+   }
+   int w = iWidth - iSrcX;
+   int h = iHeight - iSrcY;
+   if ( iDestX + w > m_iRenderWidth )
+      w = m_iRenderWidth - iDestX;
+   if ( iDestY + h > m_iRenderHeight )
+      h = m_iRenderHeight - iDestY;
+   if ( (w <= 0) || (h <= 0) )
+      return;
+
+   _markDrawnRect(iDestX, iDestY, w, h);
+   type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
+   for( int y=0; y<h; y++ )
+   {
+      u8* pDestLine = (&(pOutputBufferInfo->pData[0])) + (iDestY+y)*pOutputBufferInfo->uStride + 4*iDestX;
+      render_span_blend_premultiplied(pDestLine, (const u8*)(pPixels + (iSrcY+y)*iWidth + iSrcX), w);
    }
 }
 
+u8* RenderEngineCairo::_getDrawBufferPixels(int* piStride)
+{
+   if ( NULL == m_pTargetBuffer )
+      return NULL;
+   *piStride = m_pTargetBuffer->uStride;
+   return (u8*)&(m_pTargetBuffer->pData[0]);
+}
+
+// Output surface format order is: BGRA
+u32 RenderEngineCairo::_get_bgra_pixel(u8 r, u8 g, u8 b, u8 a)
+{
+   u8 uPixel[4] = {b, g, r, a};
+   u32 uValue;
+   memcpy(&uValue, uPixel, 4);
+   return uValue;
+}
 
 inline void RenderEngineCairo::_blend_pixel(unsigned char* pixel, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
 {
@@ -514,28 +704,22 @@ inline void RenderEngineCairo::_blend_pixel(unsigned char* pixel, unsigned char
 
 void RenderEngineCairo::_draw_hline(int x, int y, int w, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
 {
-   type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   _markDrawnRect(x, y, w, 1);
+   type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
    u8* pDestLine = (&(pOutputBufferInfo->pData[0])) + y*pOutputBufferInfo->uStride + 4*x;
-   for( int x=0; x<w; x++ )
-   {
-      *pDestLine++ = b;
-      *pDestLine++ = g;
-      *pDestLine++ = r;
-      *pDestLine++ = a;
-   }
+   render_span_fill(pDestLine, w, _get_bgra_pixel(r,g,b,a));
 }
 
 void RenderEngineCairo::_draw_vline(int x, int y, int h, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
 {
-   type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   _markDrawnRect(x, y, 1, h);
+   type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
    u8* pDestLine = (&(pOutputBufferInfo->pData[0])) + y*pOutputBufferInfo->uStride + 4*x;
+   u32 uPixel = _get_bgra_pixel(r,g,b,a);
    for( int x=0; x<h; x++ )
    {
-      *pDestLine++ = b;
-      *pDestLine++ = g;
-      *pDestLine++ = r;
-      *pDestLine++ = a;
-      pDestLine += pOutputBufferInfo->uStride-4;
+      *((u32*)pDestLine) = uPixel;
+      pDestLine += pOutputBufferInfo->uStride;
    }
 }
       
@@ -558,6 +742,7 @@ void RenderEngineCairo::drawLine(float x1, float y1, float x2, float y2)
       return;
    }
 
+   _markStrokedPath(x1 * m_iRenderWidth, y1 * m_iRenderHeight, x2 * m_iRenderWidth, y2 * m_iRenderHeight, 0);
    cairo_move_to (m_pCairoCtx, x1 * m_iRenderWidth, y1 * m_iRenderHeight); 
    cairo_line_to (m_pCairoCtx, x2 * m_iRenderWidth, y2 * m_iRenderHeight);
    cairo_set_source_rgba(m_pCairoCtx, m_ColorStroke[0]/255.0, m_ColorStroke[1]/255.0, m_ColorStroke[2]/255.0, m_ColorStroke[3]/255.0);
@@ -621,20 +806,14 @@ void RenderEngineCairo::drawRect(float xPos, float yPos, float fWidth, float fHe
    // Output surface format order is: BGRA
    if ( m_ColorFill[3] > 2 )
    {
-      type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+      _markDrawnRect(xSt, ySt, w, h);
+      type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
+      u32 uPixel = _get_bgra_pixel(r,g,b,a);
       for( int y=0; y<h; y++ )
       {
          u8* pDestLine = (u8*)&(pOutputBufferInfo->pData[(ySt+y)*pOutputBufferInfo->uStride]);
          pDestLine += 4*xSt;
-         for( int x=0; x<w; x++ )
-         {
-            //_blend_pixel(pDestLine, r,g,b,a);
-            //pDestLine += 4;
-            *pDestLine++ = b;
-            *pDestLine++ = g;
-            *pDestLine++ = r;
-            *pDestLine++ = a;
-         }
+         render_span_fill(pDestLine, w, uPixel);
       }
    }
    if ( m_ColorStroke[3] > 2 )
@@ -710,20 +889,14 @@ void RenderEngineCairo::drawRoundRect(float xPos, float yPos, float fWidth, floa
       u8 g = m_ColorFill[1];
       u8 b = m_ColorFill[2];
       u8 a = m_ColorFill[3];
-      type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+      _markDrawnRect(xSt, ySt, w+1, h+1);
+      type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
+      u32 uPixel = _get_bgra_pixel(r,g,b,a);
       for( int y=0; y<h; y++ )
       {
          u8* pDestLine = (u8*)&(pOutputBufferInfo->pData[(ySt+y)*pOutputBufferInfo->uStride]);
          pDestLine += 4*(xSt+3);
-         for( int x=0; x<(w-5); x++ )
-         {
-            //_blend_pixel(pDestLine, r,g,b,a);
-            //pDestLine += 4;
-            *pDestLine++ = b;
-            *pDestLine++ = g;
-            *pDestLine++ = r;
-            *pDestLine++ = a;
-         }
+         render_span_fill(pDestLine, w-5, uPixel);
       }
   
       _draw_vline(xSt+2, ySt+1, h-2 , r,g,b,a);
@@ -787,8 +960,22 @@ void RenderEngineCairo::drawRoundRect(float xPos, float yPos, float fWidth, floa
    */
 }
 
+void RenderEngineCairo::_markTriangle(float x1, float y1, float x2, float y2, float x3, float y3)
+{
+   float xMin = (x1 < x2)?x1:x2;
+   float xMax = (x1 < x2)?x2:x1;
+   float yMin = (y1 < y2)?y1:y2;
+   float yMax = (y1 < y2)?y2:y1;
+   xMin = (x3 < xMin)?x3:xMin;
+   xMax = (x3 > xMax)?x3:xMax;
+   yMin = (y3 < yMin)?y3:yMin;
+   yMax = (y3 > yMax)?y3:yMax;
+   _markStrokedPath(xMin * m_iRenderWidth, yMin * m_iRenderHeight, xMax * m_iRenderWidth, yMax * m_iRenderHeight, 0);
+}
+
 void RenderEngineCairo::drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3)
 {
+   _markTriangle(x1, y1, x2, y2, x3, y3);
    cairo_move_to (m_pCairoCtx, x1 * m_iRenderWidth, y1 * m_iRenderHeight); 
    cairo_line_to (m_pCairoCtx, x2 * m_iRenderWidth, y2 * m_iRenderHeight);
    cairo_line_to (m_pCairoCtx, x3 * m_iRenderWidth, y3 * m_iRenderHeight);
@@ -799,6 +986,7 @@ void RenderEngineCairo::drawTriangle(float x1, float y1, float x2, float y2, flo
 
 void RenderEngineCairo::fillTriangle(float x1, float y1, float x2, float y2, float x3, float y3)
 {
+   _markTriangle(x1, y1, x2, y2, x3, y3);
    cairo_move_to (m_pCairoCtx, x1 * m_iRenderWidth, y1 * m_iRenderHeight); 
    cairo_line_to (m_pCairoCtx, x2 * m_iRenderWidth, y2 * m_iRenderHeight);
    cairo_line_to (m_pCairoCtx, x3 * m_iRenderWidth, y3 * m_iRenderHeight);
@@ -840,6 +1028,7 @@ void RenderEngineCairo::fillPolygon(float* x, float* y, int count)
 
 void RenderEngineCairo::fillCircle(float x, float y, float r)
 {
+   _markStrokedPath(x * m_iRenderWidth, y * m_iRenderHeight, x * m_iRenderWidth, y * m_iRenderHeight, r * m_iRenderHeight);
    if ( m_ColorFill[3] > 2 )
    {
       cairo_set_source_rgba(m_pCairoCtx, m_ColorFill[0]/255.0, m_ColorFill[1]/255.0, m_ColorFill[2]/255.0, m_ColorFill[3]/255.0);
@@ -861,6 +1050,7 @@ void RenderEngineCairo::fillCircle(float x, float y, float r)
 
 void RenderEngineCairo::drawCircle(float x, float y, float r)
 {
+   _markStrokedPath(x * m_iRenderWidth, y * m_iRenderHeight, x * m_iRenderWidth, y * m_iRenderHeight, r * m_iRenderHeight);
    if ( m_ColorStroke[3] > 2 )
    {
       cairo_set_source_rgba(m_pCairoCtx, m_ColorStroke[0]/255.0, m_ColorStroke[1]/255.0, m_ColorStroke[2]/255.0, m_ColorStroke[3]/255.0);
@@ -916,16 +1106,30 @@ void RenderEngineCairo::_drawSimpleTextScaled(RenderEngineRawFont* pFont, const
    if ( m_bDrawBackgroundBoundingBoxes )
       _drawSimpleTextBoundingBox(pFont, szText, xPos, yPos, 1.0);
 
+   u8 uColor[4];
+   if ( m_bDrawBackgroundBoundingBoxes && m_bDrawBackgroundBoundingBoxesTextUsesSameStrokeColor )
+   {
+      for( int i=0; i<4; i++ )
+         uColor[i] = m_ColorTextBackgroundBoundingBoxStrike[i];
+   }
+   else
+      memcpy(uColor, m_ColorFill, 4);
+
+   if ( _drawCachedTextRun(pFont, szText, xPos, yPos, uColor) )
+      return;
+
+   if ( NULL == m_pCairoCtx )
+      return;
 
    cairo_set_font_size (m_pCairoCtx, pFont->lineHeight*0.8);
    cairo_text_extents_t cte;
    cairo_text_extents(m_pCairoCtx, szText, &cte);
+   // Extra margins for glyphs extending outside of the advance width and line height
+   _markDrawnRect(xPos * m_iRenderWidth - pFont->lineHeight/4, yPos * m_iRenderHeight - pFont->lineHeight/4,
+      cte.x_advance + pFont->lineHeight/2 + 1, pFont->lineHeight + pFont->lineHeight/2 + 1);
    //cairo_set_source_rgba (m_pCairoCtx, 0.2, 0, 0, 1);
 
-   if ( m_bDrawBackgroundBoundingBoxes && m_bDrawBackgroundBoundingBoxesTextUsesSameStrokeColor )
-      cairo_set_source_rgba(m_pCairoCtx, m_ColorTextBackgroundBoundingBoxStrike[0]/255.0, m_ColorTextBackgroundBoundingBoxStrike[1]/255.0, m_ColorTextBackgroundBoundingBoxStrike[2]/255.0, m_ColorTextBackgroundBoundingBoxStrike[3]/255.0);
-   else
-      cairo_set_source_rgba(m_pCairoCtx, m_ColorFill[0]/255.0, m_ColorFill[1]/255.0, m_ColorFill[2]/255.0, m_ColorFill[3]/255.0);
+   cairo_set_source_rgba(m_pCairoCtx, uColor[0]/255.0, uColor[1]/255.0, uColor[2]/255.0, uColor[3]/255.0);
    //cairo_move_to (m_pCairoCtx, xPos * m_iRenderWidth, yPos * m_iRenderHeight + cte.height);
    cairo_move_to (m_pCairoCtx, xPos * m_iRenderWidth, yPos * m_iRenderHeight + pFont->baseLine);
    cairo_show_text (m_pCairoCtx, szText);
@@ -961,6 +1165,144 @@ void RenderEngineCairo::_drawSimpleTextScaled(RenderEngineRawFont* pFont, const
    }
 }
 
+// Renders the text into a cached surface (LRU replacement) and blends it over the output buffer.
+// Returns false if the text can't be cached, so it should be drawn directly.
+
+bool RenderEngineCairo::_drawCachedTextRun(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos, u8* pColor)
+{
+   int iLen = strlen(szText);
+   if ( iLen >= MAX_CAIRO_TEXT_RUN_LENGTH )
+      return false;
+
+   // FNV-1a of the text, line metrics and color
+   u32 uHash = 2166136261u;
+   for( int i=0; i<iLen; i++ )
+      uHash = (uHash ^ (u8)szText[i]) * 16777619u;
+   for( int i=0; i<4; i++ )
+      uHash = (uHash ^ pColor[i]) * 16777619u;
+   uHash = (uHash ^ (u32)pFont->lineHeight) * 16777619u;
+   uHash = (uHash ^ (u32)pFont->baseLine) * 16777619u;
+
+   type_cairo_text_run* pRun = NULL;
+   for( int i=0; i<MAX_CAIRO_TEXT_RUNS_CACHE; i++ )
+   {
+      if ( (m_TextRuns[i].uHash != uHash) || (NULL == m_TextRuns[i].pSurface) )
+         continue;
+      if ( (m_TextRuns[i].iLineHeight != pFont->lineHeight) || (m_TextRuns[i].iBaseLine != pFont->baseLine) )
+         continue;
+      if ( (0 != memcmp(m_TextRuns[i].uColor, pColor, 4)) || (0 != strcmp(m_TextRuns[i].szText, szText)) )
+         continue;
+      pRun = &(m_TextRuns[i]);
+      break;
+   }
+   if ( NULL == pRun )
+      pRun = _renderTextRun(pFont, szText, pColor, uHash);
+   if ( NULL == pRun )
+      return false;
+
+   m_uTextRunsUseCounter++;
+   pRun->uLastUsedCounter = m_uTextRunsUseCounter;
+
+   int xDest = (int)(xPos * m_iRenderWidth) - pRun->iMargin;
+   int yDest = (int)(yPos * m_iRenderHeight) - pRun->iMargin;
+   int xSrc = 0;
+   int ySrc = 0;
+   int w = pRun->iWidth;
+   int h = pRun->iHeight;
+   if ( xDest < 0 )
+   {
+      xSrc = -xDest;
+      w += xDest;
+      xDest = 0;
+   }
+   if ( yDest < 0 )
+   {
+      ySrc = -yDest;
+      h += yDest;
+      yDest = 0;
+   }
+   if ( xDest + w > m_iRenderWidth )
+      w = m_iRenderWidth - xDest;
+   if ( yDest + h > m_iRenderHeight )
+      h = m_iRenderHeight - yDest;
+   if ( (w <= 0) || (h <= 0) )
+      return true;
+
+   _markDrawnRect(xDest, yDest, w, h);
+   type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
+   u8* pSrcData = cairo_image_surface_get_data(pRun->pSurface);
+   int iSrcStride = cairo_image_surface_get_stride(pRun->pSurface);
+   for( int y=0; y<h; y++ )
+   {
+      u8* pDestLine = (u8*)&(pOutputBufferInfo->pData[(yDest+y)*pOutputBufferInfo->uStride + 4*xDest]);
+      u8* pSrcLine = pSrcData + (ySrc+y)*iSrcStride + 4*xSrc;
+      render_span_blend_premultiplied(pDestLine, pSrcLine, w);
+   }
+   return true;
+}
+
+type_cairo_text_run* RenderEngineCairo::_renderTextRun(RenderEngineRawFont* pFont, const char* szText, u8* pColor, u32 uHash)
+{
+   if ( NULL == m_pCairoCtx )
+      return NULL;
+
+   cairo_set_font_size(m_pCairoCtx, pFont->lineHeight*0.8);
+   cairo_text_extents_t cte;
+   cairo_text_extents(m_pCairoCtx, szText, &cte);
+
+   int iMargin = pFont->lineHeight/4 + 1;
+   int iWidth = cte.x_advance + 2*iMargin;
+   if ( cte.x_bearing + cte.width > cte.x_advance )
+      iWidth = cte.x_bearing + cte.width + 2*iMargin;
+   int iHeight = pFont->lineHeight + 2*iMargin;
+
+   // Glyphs outside of the run surface can't be cached
+   if ( (cte.x_bearing < -iMargin) || (pFont->baseLine + cte.y_bearing < -iMargin) ||
+        (pFont->baseLine + cte.y_bearing + cte.height > pFont->lineHeight + iMargin) ||
+        (iWidth > m_iRenderWidth) )
+      return NULL;
+
+   int iIndex = 0;
+   for( int i=1; i<MAX_CAIRO_TEXT_RUNS_CACHE; i++ )
+   {
+      if ( NULL == m_TextRuns[iIndex].pSurface )
+         break;
+      if ( (NULL == m_TextRuns[i].pSurface) || (m_TextRuns[i].uLastUsedCounter < m_TextRuns[iIndex].uLastUsedCounter) )
+         iIndex = i;
+   }
+   type_cairo_text_run* pRun = &(m_TextRuns[iIndex]);
+   if ( NULL != pRun->pSurface )
+      cairo_surface_destroy(pRun->pSurface);
+   pRun->pSurface = NULL;
+
+   cairo_surface_t* pSurface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, iWidth, iHeight);
+   if ( (NULL == pSurface) || (CAIRO_STATUS_SUCCESS != cairo_surface_status(pSurface)) )
+   {
+      if ( NULL != pSurface )
+         cairo_surface_destroy(pSurface);
+      return NULL;
+   }
+   cairo_t* pCtx = cairo_create(pSurface);
+   cairo_select_font_face(pCtx, "Roboto", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+   cairo_set_font_size(pCtx, pFont->lineHeight*0.8);
+   cairo_set_source_rgba(pCtx, pColor[0]/255.0, pColor[1]/255.0, pColor[2]/255.0, pColor[3]/255.0);
+   cairo_move_to(pCtx, iMargin, iMargin + pFont->baseLine);
+   cairo_show_text(pCtx, szText);
+   cairo_destroy(pCtx);
+   cairo_surface_flush(pSurface);
+
+   pRun->uHash = uHash;
+   pRun->iLineHeight = pFont->lineHeight;
+   pRun->iBaseLine = pFont->baseLine;
+   memcpy(pRun->uColor, pColor, 4);
+   strcpy(pRun->szText, szText);
+   pRun->pSurface = pSurface;
+   pRun->iWidth = iWidth;
+   pRun->iHeight = iHeight;
+   pRun->iMargin = iMargin;
+   return pRun;
+}
+
 void RenderEngineCairo::_bltFontChar(int iDestX, int iDestY, int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, RenderEngineRawFont* pFont)
 {
    if ( NULL == pFont )
@@ -968,7 +1310,8 @@ void RenderEngineCairo::_bltFontChar(int iDestX, int iDestY, int iSrcX, int iSrc
    if ( (iDestX < 0) || (iDestY < 0) || (iDestX+iSrcWidth >= m_iRenderWidth) || (iDestY+iSrcHeight >= m_iRenderHeight) )
       return;
 
-   type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   _markDrawnRect(iDestX, iDestY, iSrcWidth, iSrcHeight);
+   type_drm_buffer* pOutputBufferInfo = m_pTargetBuffer;
    u8* pSrcImageData = cairo_image_surface_get_data((cairo_surface_t*)pFont->pImageObject);
    int iSrcImageStride = cairo_image_surface_get_stride((cairo_surface_t*)pFont->pImageObject);
 
@@ -980,20 +1323,6 @@ void RenderEngineCairo::_bltFontChar(int iDestX, int iDestY, int iSrcX, int iSrc
       u8* pSrcLine = pSrcImageData + ((iSrcY +y)* iSrcImageStride);
       pSrcLine += 4 * iSrcX;
 
-      for( int x=0; x<iSrcWidth; x++ )
-      {
-          u8 uAlpha = *(pSrcLine+3);
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/255;
-          pDestLine++;
-          pSrcLine++;
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/255;
-          pDestLine++;
-          pSrcLine++;
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/255;
-          pDestLine++;
-          pSrcLine++;
-          pDestLine++;
-          pSrcLine++;
-      }
+      render_span_blit_alpha(pDestLine, pSrcLine, iSrcWidth);
    }
 }
@@ -1,8 +1,27 @@
 #pragma once
 
 #include "render_engine.h"
+#include "drm_core.h"
 #include <cairo.h>
 
+// Rendered text runs are cached, as most of the OSD and menus text is the same from frame to frame
+#define MAX_CAIRO_TEXT_RUNS_CACHE 128
+#define MAX_CAIRO_TEXT_RUN_LENGTH 48
+
+typedef struct
+{
+   u32 uHash;
+   int iLineHeight;
+   int iBaseLine;
+   u8 uColor[4];
+   char szText[MAX_CAIRO_TEXT_RUN_LENGTH];
+   cairo_surface_t* pSurface;
+   int iWidth;
+   int iHeight;
+   int iMargin; // Text origin (left, top of the line) is at iMargin, iMargin in the surface
+   u32 uLastUsedCounter;
+} type_cairo_text_run;
+
 class RenderEngineCairo: public RenderEngine
 {
    public:
@@ -22,9 +41,17 @@ class RenderEngineCairo: public RenderEngine
      virtual void endFrame();
      virtual void rotate180();
 
+     virtual bool hasStaticLayer();
+     virtual bool beginStaticLayer(u32 uContentHash);
+     virtual void endStaticLayer();
+     virtual void hideStaticLayer();
+
      virtual void drawImage(float xPos, float yPos, float fWidth, float fHeight, u32 uImageId);
      virtual void drawIcon(float xPos, float yPos, float fWidth, float fHeight, u32 uIconId);
      virtual void bltIcon(float xPosDest, float yPosDest, int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, u32 uIconId);
+     virtual bool canDrawBitmaps();
+     virtual u32 makeBitmapPixel(u8 r, u8 g, u8 b, u8 a);
+     virtual void drawBitmap(float xPos, float yPos, const u32* pPixels, int iWidth, int iHeight);
 
      virtual void drawLine(float x1, float y1, float x2, float y2);
      virtual void drawRect(float xPos, float yPos, float fWidth, float fHeight);
@@ -41,18 +68,37 @@ class RenderEngineCairo: public RenderEngine
    protected:
       virtual void* _loadRawFontImageObject(const char* szFileName);
       virtual void _freeRawFontImageObject(void* pImageObject);
+      virtual u8* _getDrawBufferPixels(int* piStride);
 
       void _drawSimpleText(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos);
       void _drawSimpleTextScaled(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos, float fScale);
+      bool _drawCachedTextRun(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos, u8* pColor);
+      type_cairo_text_run* _renderTextRun(RenderEngineRawFont* pFont, const char* szText, u8* pColor, u32 uHash);
       void _bltFontChar(int iDestX, int iDestY, int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, RenderEngineRawFont* pFont);
+      u32 _get_bgra_pixel(u8 r, u8 g, u8 b, u8 a);
       void _blend_pixel(unsigned char* pixel, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
       void _draw_hline(int x, int y, int w, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
       void _draw_vline(int x, int y, int h, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+      virtual void _clearDamageRect(int iPixelX, int iPixelY, int iPixelWidth, int iPixelHeight);
+      void _markStrokedPath(float x1, float y1, float x2, float y2, float fPadding);
+      void _markTriangle(float x1, float y1, float x2, float y2, float x3, float y3);
       
       bool m_bUseDoubleBuffering;
-      u32 m_uRenderDrawSurfacesIds[2];
-      cairo_surface_t *m_pMainCairoSurface[2];
+      int m_iCountDrawSurfaces;
+      u32 m_uRenderDrawSurfacesIds[DRM_CORE_MAX_DRAW_BUFFERS];
+      cairo_surface_t *m_pMainCairoSurface[DRM_CORE_MAX_DRAW_BUFFERS];
       cairo_t* m_pCairoCtx;
+      type_drm_buffer* m_pTargetBuffer; // Display buffer drawn into
+      type_drm_buffer* m_pMainTargetBuffer;
+      cairo_t* m_pMainCairoCtx;
+
+      bool m_bHasStaticLayer;
+      bool m_bDrawingStaticLayer;
+      bool m_bStaticLayerValid;
+      bool m_bDamageFrameInProgressBeforeStaticLayer;
+      u32 m_uStaticLayerContentHash;
+      u32 m_uStaticLayerSurfacesIds[2];
+      cairo_surface_t* m_pStaticLayerCairoSurface[2];
 
       cairo_surface_t* m_pImages[MAX_RAW_IMAGES];
       u32 m_ImageIds[MAX_RAW_IMAGES];
@@ -65,5 +111,8 @@ class RenderEngineCairo: public RenderEngine
       u32 m_CurrentIconId;
       int m_iCountIcons;
 
+      type_cairo_text_run m_TextRuns[MAX_CAIRO_TEXT_RUNS_CACHE];
+      u32 m_uTextRunsUseCounter;
+
 
 };
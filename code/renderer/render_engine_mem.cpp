@@ -0,0 +1,173 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "render_engine_mem.h"
+#include "../base/config_hw.h"
+
+#if defined (HW_PLATFORM_RASPBERRY)
+#include "render_engine_raw.h"
+#include "fbgraphics.h"
+// lodepng is built as C, its C++ wrapper is not available
+#define LODEPNG_NO_COMPILE_CPP
+#include "lodepng.h"
+#endif
+
+#if defined (HW_PLATFORM_RADXA_ZERO3)
+#include "render_engine_cairo.h"
+#include "drm_core.h"
+#endif
+
+#if defined (HW_PLATFORM_RASPBERRY)
+
+// Same drawing as the raw engine, into a memory buffer. Rows are not padded.
+
+class RenderEngineMem: public RenderEngineRaw
+{
+   public:
+     RenderEngineMem(struct _fbg* pFBG)
+     :RenderEngineRaw(pFBG)
+     {
+     }
+
+     virtual ~RenderEngineMem()
+     {
+     }
+
+     struct _fbg* getFBG()
+     {
+        return m_pFBG;
+     }
+};
+
+static void _render_engine_mem_free(struct _fbg* pFBG)
+{
+}
+
+#endif
+
+static RenderEngine* s_pRenderEngineMemory = NULL;
+
+RenderEngine* render_init_engine_memory(int iWidth, int iHeight)
+{
+   if ( NULL != s_pRenderEngineMemory )
+      return s_pRenderEngineMemory;
+   if ( (iWidth <= 0) || (iHeight <= 0) )
+      return NULL;
+
+   #if defined (HW_PLATFORM_RASPBERRY)
+   // No draw/flip callbacks: fbg swaps the back and display buffers on flip
+   struct _fbg* pFBG = fbg_customSetup(iWidth, iHeight, 4, 1, 0, NULL, NULL, NULL, NULL, _render_engine_mem_free);
+   if ( NULL == pFBG )
+      return NULL;
+   s_pRenderEngineMemory = new RenderEngineMem(pFBG);
+   #endif
+
+   #if defined (HW_PLATFORM_RADXA_ZERO3)
+   if ( 0 != ruby_drm_core_init_memory(iWidth, iHeight) )
+      return NULL;
+   s_pRenderEngineMemory = new RenderEngineCairo();
+   #endif
+
+   if ( NULL == s_pRenderEngineMemory )
+      return NULL;
+   log_line("RendererMem: Created memory output of %d x %d pixels.", iWidth, iHeight);
+   return render_init_engine_custom(s_pRenderEngineMemory);
+}
+
+void render_free_engine_memory()
+{
+   if ( NULL == s_pRenderEngineMemory )
+      return;
+   render_free_engine();
+   s_pRenderEngineMemory = NULL;
+   #if defined (HW_PLATFORM_RADXA_ZERO3)
+   ruby_drm_core_uninit();
+   #endif
+}
+
+const u8* render_engine_memory_get_frame(int* piStride)
+{
+   if ( NULL == s_pRenderEngineMemory )
+      return NULL;
+
+   #if defined (HW_PLATFORM_RASPBERRY)
+   struct _fbg* pFBG = ((RenderEngineMem*)s_pRenderEngineMemory)->getFBG();
+   if ( NULL == pFBG )
+      return NULL;
+   if ( NULL != piStride )
+      *piStride = pFBG->line_length;
+   return (const u8*)pFBG->disp_buffer;
+   #endif
+
+   #if defined (HW_PLATFORM_RADXA_ZERO3)
+   // The buffer swapped in by the last endFrame
+   type_drm_buffer* pBuffer = ruby_drm_core_get_main_draw_buffer();
+   if ( NULL != piStride )
+      *piStride = pBuffer->uStride;
+   return (const u8*)pBuffer->pData;
+   #endif
+
+   return NULL;
+}
+
+bool render_engine_memory_save_png(const char* szFile)
+{
+   if ( (NULL == s_pRenderEngineMemory) || (NULL == szFile) )
+      return false;
+
+   #if defined (HW_PLATFORM_RASPBERRY)
+   struct _fbg* pFBG = ((RenderEngineMem*)s_pRenderEngineMemory)->getFBG();
+   if ( NULL == pFBG )
+      return false;
+   unsigned int uError = lodepng_encode32_file(szFile, (const unsigned char*)pFBG->disp_buffer, pFBG->width, pFBG->height);
+   if ( 0 != uError )
+   {
+      log_softerror_and_alarm("RendererMem: Failed to save frame to %s: %s", szFile, lodepng_error_text(uError));
+      return false;
+   }
+   return true;
+   #endif
+
+   #if defined (HW_PLATFORM_RADXA_ZERO3)
+   type_drm_buffer* pBuffer = ruby_drm_core_get_main_draw_buffer();
+   cairo_surface_t* pSurface = cairo_image_surface_create_for_data(pBuffer->pData, CAIRO_FORMAT_ARGB32, pBuffer->uWidth, pBuffer->uHeight, pBuffer->uStride);
+   cairo_status_t status = cairo_surface_write_to_png(pSurface, szFile);
+   cairo_surface_destroy(pSurface);
+   if ( CAIRO_STATUS_SUCCESS != status )
+   {
+      log_softerror_and_alarm("RendererMem: Failed to save frame to %s: %s", szFile, cairo_status_to_string(status));
+      return false;
+   }
+   return true;
+   #endif
+
+   return false;
+}
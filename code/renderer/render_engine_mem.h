@@ -0,0 +1,15 @@
+#pragma once
+
+#include "render_engine.h"
+
+// Headless rendering: the render engine of the platform (raw on Pi, Cairo on Radxa) draws into memory
+// buffers instead of a display. Used to measure and test rendering without a display or a DRM device.
+// The engine is set as the global one, so renderer_engine() and the UI code use it.
+
+RenderEngine* render_init_engine_memory(int iWidth, int iHeight);
+void render_free_engine_memory();
+
+// Last completed frame (after endFrame). Pixels are 4 bytes each:
+// RGBA on Pi, premultiplied BGRA (Cairo ARGB32) on Radxa.
+const u8* render_engine_memory_get_frame(int* piStride);
+bool render_engine_memory_save_png(const char* szFile);
@@ -30,8 +30,12 @@
 */
 
 #include "render_engine_raw.h"
+#include "../base/config_hw.h"
+#if defined (HW_PLATFORM_RASPBERRY)
 #include "fbg_dispmanx.h"
+#endif
 #include "fbgraphics.h"
+#include "render_kernels.h"
 #include <math.h>
 
 RenderEngineRaw::RenderEngineRaw()
@@ -39,19 +43,41 @@ RenderEngineRaw::RenderEngineRaw()
 {
    log_line("RendererRAW: Init started.");
 
+   m_pFBG = NULL;
+   #if defined (HW_PLATFORM_RASPBERRY)
    m_pFBG = fbg_dispmanxSetup(0, VC_IMAGE_RGBA32);
+   #endif
+   _initFromFBG();
+}
 
-   m_iRenderWidth = m_pFBG->width;
-   m_iRenderHeight = m_pFBG->height;
-   log_line("Initialized graphics to resolution: %d x %d", m_iRenderWidth, m_iRenderHeight);
-   m_fPixelWidth = 1.0/(float)m_iRenderWidth;
-   m_fPixelHeight = 1.0/(float)m_iRenderHeight;
+// Renders using an already created fbg instance (i.e. a memory backend)
+RenderEngineRaw::RenderEngineRaw(struct _fbg* pFBG)
+:RenderEngine()
+{
+   log_line("RendererRAW: Init started (custom output).");
+   m_pFBG = pFBG;
+   _initFromFBG();
+}
 
+void RenderEngineRaw::_initFromFBG()
+{
    m_iCountImages = 0;
    m_iCountIcons = 0;
    m_CurrentImageId = 1;
    m_CurrentIconId = 1;
 
+   if ( NULL == m_pFBG )
+   {
+      log_error_and_alarm("RendererRAW: Failed to create the graphics output.");
+      return;
+   }
+
+   m_iRenderWidth = m_pFBG->width;
+   m_iRenderHeight = m_pFBG->height;
+   log_line("Initialized graphics to resolution: %d x %d", m_iRenderWidth, m_iRenderHeight);
+   m_fPixelWidth = 1.0/(float)m_iRenderWidth;
+   m_fPixelHeight = 1.0/(float)m_iRenderHeight;
+
    log_line("RendererRAW: Render init done.");
 }
 
@@ -368,6 +394,56 @@ void RenderEngineRaw::bltIcon(float xPosDest, float yPosDest, int iSrcX, int iSr
 
 }
 
+bool RenderEngineRaw::canDrawBitmaps()
+{
+   return (NULL != m_pFBG) && (m_pFBG->components == 4);
+}
+
+void RenderEngineRaw::drawBitmap(float xPos, float yPos, const u32* pPixels, int iWidth, int iHeight)
+{
+   if ( (NULL == pPixels) || (! canDrawBitmaps()) )
+      return;
+
+   int iDestX = xPos*m_iRenderWidth;
+   int iDestY = yPos*m_iRenderHeight;
+   int iSrcX = 0;
+   int iSrcY = 0;
+   if ( iDestX < 0 )
+   {
+      iSrcX = -iDestX;
+      iDestX = 0;
+   }
+   if ( iDestY < 0 )
+   {
+      iSrcY = -iDestY;
+      iDestY = 0;
+   }
+   int w = iWidth - iSrcX;
+   int h = iHeight - iSrcY;
+   if ( iDestX + w > m_pFBG->width )
+      w = m_pFBG->width - iDestX;
+   if ( iDestY + h > m_pFBG->height )
+      h = m_pFBG->height - iDestY;
+   if ( (w <= 0) || (h <= 0) )
+      return;
+
+   _markDrawnRect(iDestX, iDestY, w, h);
+
+   for( int y=0; y<h; y++ )
+   {
+      u8* pDestLine = (u8*)(m_pFBG->back_buffer + (iDestY+y)*m_pFBG->line_length + iDestX*m_pFBG->components);
+      render_span_blend_premultiplied(pDestLine, (const u8*)(pPixels + (iSrcY+y)*iWidth + iSrcX), w);
+   }
+}
+
+u8* RenderEngineRaw::_getDrawBufferPixels(int* piStride)
+{
+   if ( ! canDrawBitmaps() )
+      return NULL;
+   *piStride = m_pFBG->line_length;
+   return (u8*)m_pFBG->back_buffer;
+}
+
 void RenderEngineRaw::_drawSimpleText(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos)
 {
    if ( NULL == pFont || NULL == szText || 0 == szText[0] )
@@ -6,6 +6,7 @@ class RenderEngineRaw: public RenderEngine
 {
    public:
      RenderEngineRaw();
+     RenderEngineRaw(struct _fbg* pFBG);
      virtual ~RenderEngineRaw();
 
      virtual u32 loadImage(const char* szFile);
@@ -20,6 +21,8 @@ class RenderEngineRaw: public RenderEngine
      virtual void drawImage(float xPos, float yPos, float fWidth, float fHeight, u32 imageId);
      virtual void drawIcon(float xPos, float yPos, float fWidth, float fHeight, u32 iconId);
      virtual void bltIcon(float xPosDest, float yPosDest, int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, u32 iconId);
+     virtual bool canDrawBitmaps();
+     virtual void drawBitmap(float xPos, float yPos, const u32* pPixels, int iWidth, int iHeight);
 
      virtual void drawLine(float x1, float y1, float x2, float y2);
      virtual void drawRect(float xPos, float yPos, float fWidth, float fHeight);
@@ -36,6 +39,8 @@ class RenderEngineRaw: public RenderEngine
    protected:
       virtual void* _loadRawFontImageObject(const char* szFileName);
       virtual void _freeRawFontImageObject(void* pImageObject);
+      virtual u8* _getDrawBufferPixels(int* piStride);
+      void _initFromFBG();
       void _buildMipImage(struct _fbg_img* pSrc, struct _fbg_img* pDest);
 
       void _drawSimpleText(RenderEngineRawFont* pFont, const char* szText, float xPos, float yPos);
@@ -36,6 +36,7 @@
 #include "render_engine.h"
 #include "../public/render_engine_ui.h"
 #include "../r_central/colors.h"
+#include "render_engine_ui_commands.h"
 
 RenderEngine* s_pRenderEngineUI = NULL;
 u32 s_uRenderEngineUIFontIdSmall = 0;
@@ -43,6 +44,172 @@ u32 s_uRenderEngineUIFontIdRegular = 0;
 u32 s_uRenderEngineUIFontIdBig = 0;
 u32 s_uRenderEngineUIFontsListSizes[100];
 
+#define RENDER_UI_CMD_HIGHLIGHT_FIRST_WORD 1
+#define RENDER_UI_CMD_BACKGROUND_BOXES 2
+#define RENDER_UI_CMD_SET_COLORS 3
+#define RENDER_UI_CMD_SET_COLORS_ALPHA 4
+#define RENDER_UI_CMD_SET_FILL 5
+#define RENDER_UI_CMD_SET_STROKE 6
+#define RENDER_UI_CMD_SET_STROKE_SIZE_COLOR 7
+#define RENDER_UI_CMD_SET_STROKE_RGBA 8
+#define RENDER_UI_CMD_SET_STROKE_SIZE 9
+#define RENDER_UI_CMD_SET_FONT_COLOR 10
+#define RENDER_UI_CMD_DRAW_IMAGE 11
+#define RENDER_UI_CMD_DRAW_ICON 12
+#define RENDER_UI_CMD_DRAW_TEXT 13
+#define RENDER_UI_CMD_DRAW_TEXT_LEFT 14
+#define RENDER_UI_CMD_DRAW_MESSAGE_LINES 15
+#define RENDER_UI_CMD_DRAW_LINE 16
+#define RENDER_UI_CMD_DRAW_RECT 17
+#define RENDER_UI_CMD_DRAW_ROUND_RECT 18
+#define RENDER_UI_CMD_DRAW_TRIANGLE 19
+#define RENDER_UI_CMD_DRAW_POLYLINE 20
+#define RENDER_UI_CMD_FILL_POLYGON 21
+#define RENDER_UI_CMD_FILL_CIRCLE 22
+#define RENDER_UI_CMD_DRAW_CIRCLE 23
+#define RENDER_UI_CMD_DRAW_ARC 24
+
+// Commands list the calls of the current thread are recorded to, NULL if they draw directly
+static __thread type_render_ui_command_list* s_pRenderEngineUIRecordList = NULL;
+
+void render_engine_ui_record_to(type_render_ui_command_list* pList, float fStrokeSize)
+{
+   s_pRenderEngineUIRecordList = pList;
+   if ( NULL == pList )
+      return;
+   pList->iCountCommands = 0;
+   pList->iTextBytes = 0;
+   pList->iCountPoints = 0;
+   pList->uCountDroppedCommands = 0;
+   pList->fStrokeSize = fStrokeSize;
+   pList->bBackgroundBoundingBoxes = false;
+}
+
+static type_render_ui_command* _render_ui_add_command(u8 uType)
+{
+   type_render_ui_command_list* pList = s_pRenderEngineUIRecordList;
+   if ( pList->iCountCommands >= RENDER_UI_MAX_COMMANDS )
+   {
+      pList->uCountDroppedCommands++;
+      return NULL;
+   }
+   type_render_ui_command* pCommand = &(pList->commands[pList->iCountCommands]);
+   pList->iCountCommands++;
+   memset(pCommand, 0, sizeof(type_render_ui_command));
+   pCommand->uType = uType;
+   return pCommand;
+}
+
+static type_render_ui_command* _render_ui_add_command_params(u8 uType, float f0, float f1, float f2, float f3, float f4, float f5)
+{
+   type_render_ui_command* pCommand = _render_ui_add_command(uType);
+   if ( NULL == pCommand )
+      return NULL;
+   pCommand->fParams[0] = f0;
+   pCommand->fParams[1] = f1;
+   pCommand->fParams[2] = f2;
+   pCommand->fParams[3] = f3;
+   pCommand->fParams[4] = f4;
+   pCommand->fParams[5] = f5;
+   return pCommand;
+}
+
+static void _render_ui_add_command_color(u8 uType, double* pColor, float fParam)
+{
+   if ( NULL == pColor )
+      return;
+   type_render_ui_command* pCommand = _render_ui_add_command_params(uType, fParam, 0,0,0,0,0);
+   if ( NULL != pCommand )
+      memcpy(pCommand->dColor, pColor, 4*sizeof(double));
+}
+
+static type_render_ui_command* _render_ui_add_command_text(u8 uType, const char* szText)
+{
+   type_render_ui_command_list* pList = s_pRenderEngineUIRecordList;
+   if ( NULL == szText )
+      return NULL;
+   int iLength = strlen(szText);
+   if ( (iLength > 0xFFFF) || (pList->iTextBytes + iLength + 1 > RENDER_UI_MAX_TEXT_BYTES) )
+   {
+      pList->uCountDroppedCommands++;
+      return NULL;
+   }
+   type_render_ui_command* pCommand = _render_ui_add_command(uType);
+   if ( NULL == pCommand )
+      return NULL;
+   pCommand->iDataOffset = pList->iTextBytes;
+   pCommand->uCount = (u16)iLength;
+   memcpy(&(pList->szText[pList->iTextBytes]), szText, iLength+1);
+   pList->iTextBytes += iLength+1;
+   return pCommand;
+}
+
+static void _render_ui_add_command_points(u8 uType, float* x, float* y, int count)
+{
+   type_render_ui_command_list* pList = s_pRenderEngineUIRecordList;
+   if ( (NULL == x) || (NULL == y) || (count <= 0) )
+      return;
+   if ( (count > 0xFFFF) || (pList->iCountPoints + 2*count > RENDER_UI_MAX_POINTS) )
+   {
+      pList->uCountDroppedCommands++;
+      return;
+   }
+   type_render_ui_command* pCommand = _render_ui_add_command(uType);
+   if ( NULL == pCommand )
+      return;
+   pCommand->iDataOffset = pList->iCountPoints;
+   pCommand->uCount = (u16)count;
+   memcpy(&(pList->fPoints[pList->iCountPoints]), x, count*sizeof(float));
+   memcpy(&(pList->fPoints[pList->iCountPoints + count]), y, count*sizeof(float));
+   pList->iCountPoints += 2*count;
+}
+
+void render_engine_ui_replay(type_render_ui_command_list* pList)
+{
+   RenderEngine* pEngine = s_pRenderEngineUI;
+   if ( (NULL == pList) || (NULL == pEngine) )
+      return;
+
+   float fStrokeSize = pEngine->getStrokeSize();
+   bool bBoundingBoxes = pEngine->drawBackgroundBoundingBoxes(false);
+
+   for( int i=0; i<pList->iCountCommands; i++ )
+   {
+      type_render_ui_command* pCommand = &(pList->commands[i]);
+      float* pF = pCommand->fParams;
+      switch ( pCommand->uType )
+      {
+         case RENDER_UI_CMD_HIGHLIGHT_FIRST_WORD: pEngine->highlightFirstWordOfLine(pCommand->uFlag?true:false); break;
+         case RENDER_UI_CMD_BACKGROUND_BOXES: pEngine->drawBackgroundBoundingBoxes(pCommand->uFlag?true:false); break;
+         case RENDER_UI_CMD_SET_COLORS: pEngine->setColors(pCommand->dColor); break;
+         case RENDER_UI_CMD_SET_COLORS_ALPHA: pEngine->setColors(pCommand->dColor, pF[0]); break;
+         case RENDER_UI_CMD_SET_FILL: pEngine->setFill(pF[0], pF[1], pF[2], pF[3]); break;
+         case RENDER_UI_CMD_SET_STROKE: pEngine->setStroke(pCommand->dColor); break;
+         case RENDER_UI_CMD_SET_STROKE_SIZE_COLOR: pEngine->setStroke(pCommand->dColor, pF[0]); break;
+         case RENDER_UI_CMD_SET_STROKE_RGBA: pEngine->setStroke(pF[0], pF[1], pF[2], pF[3]); break;
+         case RENDER_UI_CMD_SET_STROKE_SIZE: pEngine->setStrokeSize(pF[0]); break;
+         case RENDER_UI_CMD_SET_FONT_COLOR: pEngine->setFontColor(pCommand->uId, pCommand->dColor); break;
+         case RENDER_UI_CMD_DRAW_IMAGE: pEngine->drawImage(pF[0], pF[1], pF[2], pF[3], pCommand->uId); break;
+         case RENDER_UI_CMD_DRAW_ICON: pEngine->drawIcon(pF[0], pF[1], pF[2], pF[3], pCommand->uId); break;
+         case RENDER_UI_CMD_DRAW_TEXT: pEngine->drawText(pF[0], pF[1], pCommand->uId, &(pList->szText[pCommand->iDataOffset])); break;
+         case RENDER_UI_CMD_DRAW_TEXT_LEFT: pEngine->drawTextLeft(pF[0], pF[1], pCommand->uId, &(pList->szText[pCommand->iDataOffset])); break;
+         case RENDER_UI_CMD_DRAW_MESSAGE_LINES: pEngine->drawMessageLines(pF[0], pF[1], &(pList->szText[pCommand->iDataOffset]), pF[2], pF[3], pCommand->uId); break;
+         case RENDER_UI_CMD_DRAW_LINE: pEngine->drawLine(pF[0], pF[1], pF[2], pF[3]); break;
+         case RENDER_UI_CMD_DRAW_RECT: pEngine->drawRect(pF[0], pF[1], pF[2], pF[3]); break;
+         case RENDER_UI_CMD_DRAW_ROUND_RECT: pEngine->drawRoundRect(pF[0], pF[1], pF[2], pF[3], pF[4]); break;
+         case RENDER_UI_CMD_DRAW_TRIANGLE: pEngine->drawTriangle(pF[0], pF[1], pF[2], pF[3], pF[4], pF[5]); break;
+         case RENDER_UI_CMD_DRAW_POLYLINE: pEngine->drawPolyLine(&(pList->fPoints[pCommand->iDataOffset]), &(pList->fPoints[pCommand->iDataOffset + pCommand->uCount]), pCommand->uCount); break;
+         case RENDER_UI_CMD_FILL_POLYGON: pEngine->fillPolygon(&(pList->fPoints[pCommand->iDataOffset]), &(pList->fPoints[pCommand->iDataOffset + pCommand->uCount]), pCommand->uCount); break;
+         case RENDER_UI_CMD_FILL_CIRCLE: pEngine->fillCircle(pF[0], pF[1], pF[2]); break;
+         case RENDER_UI_CMD_DRAW_CIRCLE: pEngine->drawCircle(pF[0], pF[1], pF[2]); break;
+         case RENDER_UI_CMD_DRAW_ARC: pEngine->drawArc(pF[0], pF[1], pF[2], pF[3], pF[4]); break;
+      }
+   }
+
+   pEngine->drawBackgroundBoundingBoxes(bBoundingBoxes);
+   pEngine->setStrokeSize(fStrokeSize);
+}
+
 RenderEngineUI::RenderEngineUI()
 {
    for( int i=0; i<100; i++ )
@@ -112,7 +279,19 @@ unsigned int RenderEngineUI::getFontIdBig()
    return s_uRenderEngineUIFontIdBig;
 }
 
+static unsigned int _render_engine_ui_load_font_size(float fSize);
+
 unsigned int RenderEngineUI::loadFontSize(float fSize)
+{
+   if ( NULL == s_pRenderEngineUI )
+      return 0;
+   render_engine_lock();
+   unsigned int uFontId = _render_engine_ui_load_font_size(fSize);
+   render_engine_unlock();
+   return uFontId;
+}
+
+static unsigned int _render_engine_ui_load_font_size(float fSize)
 {
    fSize *= hdmi_get_current_resolution_height();
    int nSize = fSize/2;
@@ -201,28 +380,38 @@ unsigned int RenderEngineUI::loadImage(const char* szFile)
 {
    if ( NULL == s_pRenderEngineUI )
       return 0;
-   return s_pRenderEngineUI->loadImage(szFile);
+   render_engine_lock();
+   unsigned int uId = s_pRenderEngineUI->loadImage(szFile);
+   render_engine_unlock();
+   return uId;
 }
  
 void RenderEngineUI::freeImage(unsigned int idImage)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   render_engine_lock();
    s_pRenderEngineUI->freeImage(idImage);
+   render_engine_unlock();
 }
 
 unsigned int RenderEngineUI::loadIcon(const char* szFile)
 {
    if ( NULL == s_pRenderEngineUI )
       return 0;
-   return s_pRenderEngineUI->loadIcon(szFile);
+   render_engine_lock();
+   unsigned int uId = s_pRenderEngineUI->loadIcon(szFile);
+   render_engine_unlock();
+   return uId;
 }
 
 void RenderEngineUI::freeIcon(unsigned int idIcon)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   render_engine_lock();
    s_pRenderEngineUI->freeIcon(idIcon);
+   render_engine_unlock();
 }
 
 
@@ -230,6 +419,13 @@ void RenderEngineUI::highlightFirstWordOfLine(bool bHighlight)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      type_render_ui_command* pCommand = _render_ui_add_command(RENDER_UI_CMD_HIGHLIGHT_FIRST_WORD);
+      if ( NULL != pCommand )
+         pCommand->uFlag = bHighlight?1:0;
+      return;
+   }
    s_pRenderEngineUI->highlightFirstWordOfLine(bHighlight);
 }
 
@@ -237,6 +433,15 @@ bool RenderEngineUI::drawBackgroundBoundingBoxes(bool bEnable)
 {
    if ( NULL == s_pRenderEngineUI )
       return false;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      bool bPrevious = s_pRenderEngineUIRecordList->bBackgroundBoundingBoxes;
+      s_pRenderEngineUIRecordList->bBackgroundBoundingBoxes = bEnable;
+      type_render_ui_command* pCommand = _render_ui_add_command(RENDER_UI_CMD_BACKGROUND_BOXES);
+      if ( NULL != pCommand )
+         pCommand->uFlag = bEnable?1:0;
+      return bPrevious;
+   }
    return s_pRenderEngineUI->drawBackgroundBoundingBoxes(bEnable);
 }
 
@@ -244,6 +449,11 @@ void RenderEngineUI::setColors(double* color)
 {
    if ( NULL == s_pRenderEngineUI )
       return ;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_color(RENDER_UI_CMD_SET_COLORS, color, 0.0);
+      return;
+   }
    s_pRenderEngineUI->setColors(color);
 }
 
@@ -251,6 +461,11 @@ void RenderEngineUI::setColors(double* color, float fAlfaScale)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_color(RENDER_UI_CMD_SET_COLORS_ALPHA, color, fAlfaScale);
+      return;
+   }
    s_pRenderEngineUI->setColors(color, fAlfaScale);
 }
 
@@ -258,6 +473,11 @@ void RenderEngineUI::setFill(float r, float g, float b, float a)
 {
    if ( NULL == s_pRenderEngineUI )
       return ;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_SET_FILL, r,g,b,a, 0,0);
+      return;
+   }
    s_pRenderEngineUI->setFill(r,g,b,a);
 }
 
@@ -265,6 +485,11 @@ void RenderEngineUI::setStroke(double* color)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_color(RENDER_UI_CMD_SET_STROKE, color, 0.0);
+      return;
+   }
    s_pRenderEngineUI->setStroke(color);
 }
 
@@ -272,6 +497,12 @@ void RenderEngineUI::setStroke(double* color, float fStrokeSize)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      s_pRenderEngineUIRecordList->fStrokeSize = fStrokeSize;
+      _render_ui_add_command_color(RENDER_UI_CMD_SET_STROKE_SIZE_COLOR, color, fStrokeSize);
+      return;
+   }
    s_pRenderEngineUI->setStroke(color, fStrokeSize);
 }
 
@@ -279,6 +510,11 @@ void RenderEngineUI::setStroke(float r, float g, float b, float a)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_SET_STROKE_RGBA, r,g,b,a, 0,0);
+      return;
+   }
    s_pRenderEngineUI->setStroke(r,g,b,a);
 }
 
@@ -286,6 +522,10 @@ float RenderEngineUI::getStrokeSize()
 {
    if ( NULL == s_pRenderEngineUI )
       return 0.0;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      return s_pRenderEngineUIRecordList->fStrokeSize;
+   }
    return s_pRenderEngineUI->getStrokeSize();
 }
 
@@ -293,6 +533,12 @@ void RenderEngineUI::setStrokeSize(float fStrokeSize)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      s_pRenderEngineUIRecordList->fStrokeSize = fStrokeSize;
+      _render_ui_add_command_params(RENDER_UI_CMD_SET_STROKE_SIZE, fStrokeSize, 0,0,0,0,0);
+      return;
+   }
    s_pRenderEngineUI->setStrokeSize(fStrokeSize);
 }
 
@@ -300,6 +546,18 @@ void RenderEngineUI::setFontColor(unsigned int fontId, double* color)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      if ( NULL == color )
+         return;
+      type_render_ui_command* pCommand = _render_ui_add_command(RENDER_UI_CMD_SET_FONT_COLOR);
+      if ( NULL != pCommand )
+      {
+         pCommand->uId = fontId;
+         memcpy(pCommand->dColor, color, 4*sizeof(double));
+      }
+      return;
+   }
    s_pRenderEngineUI->setFontColor(fontId, color);
 }
 
@@ -307,6 +565,13 @@ void RenderEngineUI::drawImage(float xPos, float yPos, float fWidth, float fHeig
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      type_render_ui_command* pCommand = _render_ui_add_command_params(RENDER_UI_CMD_DRAW_IMAGE, xPos, yPos, fWidth, fHeight, 0,0);
+      if ( NULL != pCommand )
+         pCommand->uId = imageId;
+      return;
+   }
    s_pRenderEngineUI->drawImage(xPos, yPos, fWidth, fHeight, imageId);
 }
 
@@ -314,6 +579,13 @@ void RenderEngineUI::drawIcon(float xPos, float yPos, float fWidth, float fHeigh
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      type_render_ui_command* pCommand = _render_ui_add_command_params(RENDER_UI_CMD_DRAW_ICON, xPos, yPos, fWidth, fHeight, 0,0);
+      if ( NULL != pCommand )
+         pCommand->uId = iconId;
+      return;
+   }
    s_pRenderEngineUI->drawIcon(xPos, yPos, fWidth, fHeight, iconId);
 }
 
@@ -321,6 +593,13 @@ float RenderEngineUI::textHeight(unsigned int fontId)
 {
    if ( NULL == s_pRenderEngineUI )
       return 0.0;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      render_engine_lock();
+      float fHeight = s_pRenderEngineUI->textRawHeight(fontId);
+      render_engine_unlock();
+      return fHeight;
+   }
    return s_pRenderEngineUI->textRawHeight(fontId);
 }
 
@@ -328,6 +607,13 @@ float RenderEngineUI::textWidth(unsigned int fontId, const char* szText)
 {
    if ( NULL == s_pRenderEngineUI )
       return 0.0;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      render_engine_lock();
+      float fWidth = s_pRenderEngineUI->textRawWidth(fontId, szText);
+      render_engine_unlock();
+      return fWidth;
+   }
    return s_pRenderEngineUI->textRawWidth(fontId, szText);
 }
 
@@ -335,6 +621,17 @@ void RenderEngineUI::drawText(float xPos, float yPos, unsigned int fontId, const
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      type_render_ui_command* pCommand = _render_ui_add_command_text(RENDER_UI_CMD_DRAW_TEXT, szText);
+      if ( NULL != pCommand )
+      {
+         pCommand->uId = fontId;
+         pCommand->fParams[0] = xPos;
+         pCommand->fParams[1] = yPos;
+      }
+      return;
+   }
    s_pRenderEngineUI->drawText(xPos, yPos, fontId, szText);
 }
 
@@ -342,6 +639,17 @@ void RenderEngineUI::drawTextLeft(float xPos, float yPos, unsigned int fontId, c
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      type_render_ui_command* pCommand = _render_ui_add_command_text(RENDER_UI_CMD_DRAW_TEXT_LEFT, szText);
+      if ( NULL != pCommand )
+      {
+         pCommand->uId = fontId;
+         pCommand->fParams[0] = xPos;
+         pCommand->fParams[1] = yPos;
+      }
+      return;
+   }
    s_pRenderEngineUI->drawTextLeft(xPos, yPos, fontId, szText);
 }
 
@@ -349,6 +657,13 @@ float RenderEngineUI::getMessageHeight(const char* text, float line_spacing_perc
 {
    if ( NULL == s_pRenderEngineUI )
       return 0.0;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      render_engine_lock();
+      float fHeight = s_pRenderEngineUI->getMessageHeight(text, line_spacing_percent, max_width, fontId);
+      render_engine_unlock();
+      return fHeight;
+   }
    return s_pRenderEngineUI->getMessageHeight(text, line_spacing_percent, max_width, fontId);
 }
 
@@ -356,6 +671,19 @@ float RenderEngineUI::drawMessageLines(const char* text, float xPos, float yPos,
 {
    if ( NULL == s_pRenderEngineUI )
       return 0.0;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      type_render_ui_command* pCommand = _render_ui_add_command_text(RENDER_UI_CMD_DRAW_MESSAGE_LINES, text);
+      if ( NULL != pCommand )
+      {
+         pCommand->uId = fontId;
+         pCommand->fParams[0] = xPos;
+         pCommand->fParams[1] = yPos;
+         pCommand->fParams[2] = line_spacing_percent;
+         pCommand->fParams[3] = max_width;
+      }
+      return getMessageHeight(text, line_spacing_percent, max_width, fontId);
+   }
    return s_pRenderEngineUI->drawMessageLines(xPos, yPos, text, line_spacing_percent, max_width, fontId);
 }
 
@@ -363,6 +691,11 @@ void RenderEngineUI::drawLine(float x1, float y1, float x2, float y2)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_DRAW_LINE, x1,y1,x2,y2, 0,0);
+      return;
+   }
    s_pRenderEngineUI->drawLine(x1,y1,x2,y2);
 }
 
@@ -370,6 +703,11 @@ void RenderEngineUI::drawRect(float xPos, float yPos, float fWidth, float fHeigh
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_DRAW_RECT, xPos, yPos, fWidth, fHeight, 0,0);
+      return;
+   }
    s_pRenderEngineUI->drawRect(xPos,yPos,fWidth, fHeight);
 }
 
@@ -377,6 +715,11 @@ void RenderEngineUI::drawRoundRect(float xPos, float yPos, float fWidth, float f
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_DRAW_ROUND_RECT, xPos, yPos, fWidth, fHeight, fCornerRadius, 0);
+      return;
+   }
    s_pRenderEngineUI->drawRoundRect(xPos,yPos,fWidth, fHeight, fCornerRadius);
 }
  
@@ -384,6 +727,11 @@ void RenderEngineUI::drawTriangle(float x1, float y1, float x2, float y2, float
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_DRAW_TRIANGLE, x1,y1,x2,y2,x3,y3);
+      return;
+   }
    s_pRenderEngineUI->drawTriangle(x1,y1,x2,y2,x3,y3);
 }
 
@@ -391,6 +739,11 @@ void RenderEngineUI::drawPolyLine(float* x, float* y, int count)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_points(RENDER_UI_CMD_DRAW_POLYLINE, x, y, count);
+      return;
+   }
    s_pRenderEngineUI->drawPolyLine(x,y,count);
 }
 
@@ -398,6 +751,11 @@ void RenderEngineUI::fillPolygon(float* x, float* y, int count)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_points(RENDER_UI_CMD_FILL_POLYGON, x, y, count);
+      return;
+   }
    s_pRenderEngineUI->fillPolygon(x,y,count);
 }
 
@@ -405,6 +763,11 @@ void RenderEngineUI::fillCircle(float x, float y, float r)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_FILL_CIRCLE, x,y,r, 0,0,0);
+      return;
+   }
    s_pRenderEngineUI->fillCircle(x,y,r);
 }
 
@@ -412,6 +775,11 @@ void RenderEngineUI::drawCircle(float x, float y, float r)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_DRAW_CIRCLE, x,y,r, 0,0,0);
+      return;
+   }
    s_pRenderEngineUI->drawCircle(x,y,r);
 }
 
@@ -419,5 +787,10 @@ void RenderEngineUI::drawArc(float x, float y, float r, float a1, float a2)
 {
    if ( NULL == s_pRenderEngineUI )
       return;
+   if ( NULL != s_pRenderEngineUIRecordList )
+   {
+      _render_ui_add_command_params(RENDER_UI_CMD_DRAW_ARC, x,y,r,a1,a2, 0);
+      return;
+   }
    s_pRenderEngineUI->drawArc(x,y,r,a1,a2);
 }
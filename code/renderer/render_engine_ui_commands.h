@@ -0,0 +1,40 @@
+#pragma once
+#include "../base/base.h"
+
+// OSD plugins render on their own threads (see r_central/osd/osd_plugins.cpp). The RenderEngineUI calls made
+// from a plugin thread are recorded into a commands list, that the UI thread replays on the render engine.
+// Text measurements and image/font loading are done right away, under the render engine lock.
+
+#define RENDER_UI_MAX_COMMANDS 2048
+#define RENDER_UI_MAX_TEXT_BYTES 16384
+#define RENDER_UI_MAX_POINTS 4096
+
+typedef struct
+{
+   u8 uType;
+   u8 uFlag;
+   u16 uCount; // Points count or text length
+   u32 uId; // Font, image or icon id
+   int iDataOffset; // In the text or points buffer
+   float fParams[6];
+   double dColor[4];
+} type_render_ui_command;
+
+typedef struct
+{
+   int iCountCommands;
+   int iTextBytes;
+   int iCountPoints;
+   u32 uCountDroppedCommands; // Commands that did not fit in the list
+   float fStrokeSize; // Engine state as set by the recorded commands
+   bool bBackgroundBoundingBoxes;
+   type_render_ui_command commands[RENDER_UI_MAX_COMMANDS];
+   char szText[RENDER_UI_MAX_TEXT_BYTES];
+   float fPoints[RENDER_UI_MAX_POINTS];
+} type_render_ui_command_list;
+
+// Starts recording the RenderEngineUI calls of the calling thread into the list. fStrokeSize is the
+// stroke size the engine will have when the list is replayed. Call with NULL to stop recording.
+void render_engine_ui_record_to(type_render_ui_command_list* pList, float fStrokeSize);
+// Draws the recorded commands. Call from the thread that owns the render engine.
+void render_engine_ui_replay(type_render_ui_command_list* pList);
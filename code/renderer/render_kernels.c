@@ -0,0 +1,528 @@
+/*
+    Ruby Licence
+    Copyright (c) 2024 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions of source code must retain the above copyright
+        notice, this list of conditions and the following disclaimer.
+        * Redistributions in binary form must reproduce the above copyright
+        notice, this list of conditions and the following disclaimer in the
+        documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permited.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL Julien Verneuil BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../base/base.h"
+#include "render_kernels.h"
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RENDER_KERNELS_HAS_NEON 1
+#include <arm_neon.h>
+#if defined(__arm__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1<<12)
+#endif
+#endif
+#endif
+
+#if defined(__SSE2__)
+#define RENDER_KERNELS_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+//-------------------------------------------------------------
+// Portable kernels
+
+static void _render_span_fill_c(u8* pDest, int iCount, u32 uPixel)
+{
+   u32* pDest32 = (u32*)pDest;
+   while ( iCount >= 8 )
+   {
+      pDest32[0] = uPixel;
+      pDest32[1] = uPixel;
+      pDest32[2] = uPixel;
+      pDest32[3] = uPixel;
+      pDest32[4] = uPixel;
+      pDest32[5] = uPixel;
+      pDest32[6] = uPixel;
+      pDest32[7] = uPixel;
+      pDest32 += 8;
+      iCount -= 8;
+   }
+   while ( iCount > 0 )
+   {
+      *pDest32++ = uPixel;
+      iCount--;
+   }
+}
+
+static void _render_span_blend_color_c(u8* pDest, int iCount, const u8* pColor, u8 uAlpha)
+{
+   u32 uNegAlpha = 255 - uAlpha;
+   u32 uC0 = pColor[0] * uAlpha;
+   u32 uC1 = pColor[1] * uAlpha;
+   u32 uC2 = pColor[2] * uAlpha;
+   for( int i=0; i<iCount; i++ )
+   {
+      pDest[0] = (uC0 + uNegAlpha * pDest[0]) >> 8;
+      pDest[1] = (uC1 + uNegAlpha * pDest[1]) >> 8;
+      pDest[2] = (uC2 + uNegAlpha * pDest[2]) >> 8;
+      pDest[3] = pDest[3] + (((255 - pDest[3]) * uAlpha) >> 8);
+      pDest += 4;
+   }
+}
+
+static void _render_span_blit_alpha_c(u8* pDest, const u8* pSrc, int iCount)
+{
+   for( int i=0; i<iCount; i++ )
+   {
+      u32 uAlpha = pSrc[3];
+      // Most glyph and icon pixels are either fully transparent or fully opaque
+      if ( 255 == uAlpha )
+      {
+         pDest[0] = pSrc[0];
+         pDest[1] = pSrc[1];
+         pDest[2] = pSrc[2];
+      }
+      else if ( 0 != uAlpha )
+      {
+         pDest[0] = (pSrc[0] * uAlpha + pDest[0] * (255 - uAlpha))/255;
+         pDest[1] = (pSrc[1] * uAlpha + pDest[1] * (255 - uAlpha))/255;
+         pDest[2] = (pSrc[2] * uAlpha + pDest[2] * (255 - uAlpha))/255;
+      }
+      pDest += 4;
+      pSrc += 4;
+   }
+}
+
+// Source pixels with a color channel bigger than the alpha (not valid premultiplied pixels) can go over 255: saturate
+
+static inline u8 _render_add_saturate(u32 uValue1, u32 uValue2)
+{
+   u32 uSum = uValue1 + uValue2;
+   return (uSum > 255)?255:(u8)uSum;
+}
+
+static void _render_span_blend_premultiplied_c(u8* pDest, const u8* pSrc, int iCount)
+{
+   for( int i=0; i<iCount; i++ )
+   {
+      u32 uNegAlpha = 255 - pSrc[3];
+      if ( 0 == uNegAlpha )
+         memcpy(pDest, pSrc, 4);
+      else if ( 255 != uNegAlpha )
+      {
+         pDest[0] = _render_add_saturate(pSrc[0], (pDest[0] * uNegAlpha)/255);
+         pDest[1] = _render_add_saturate(pSrc[1], (pDest[1] * uNegAlpha)/255);
+         pDest[2] = _render_add_saturate(pSrc[2], (pDest[2] * uNegAlpha)/255);
+         pDest[3] = _render_add_saturate(pSrc[3], (pDest[3] * uNegAlpha)/255);
+      }
+      // Fully transparent premultiplied pixels have all channels 0
+      else if ( 0 != (pSrc[0] | pSrc[1] | pSrc[2]) )
+      {
+         pDest[0] = _render_add_saturate(pDest[0], pSrc[0]);
+         pDest[1] = _render_add_saturate(pDest[1], pSrc[1]);
+         pDest[2] = _render_add_saturate(pDest[2], pSrc[2]);
+      }
+      pDest += 4;
+      pSrc += 4;
+   }
+}
+
+static void _render_span_blend_mixed_c(u8* pDest, const u8* pSrc, int iCount, const u8* pMixColor)
+{
+   for( int i=0; i<iCount; i++ )
+   {
+      u32 uAlpha = (pSrc[3] * pMixColor[3]) >> 8;
+      if ( 0 != uAlpha )
+      {
+         u32 uNegAlpha = 255 - uAlpha;
+         pDest[0] = (uAlpha * ((pSrc[0] * pMixColor[0]) >> 8) + uNegAlpha * pDest[0]) >> 8;
+         pDest[1] = (uAlpha * ((pSrc[1] * pMixColor[1]) >> 8) + uNegAlpha * pDest[1]) >> 8;
+         pDest[2] = (uAlpha * ((pSrc[2] * pMixColor[2]) >> 8) + uNegAlpha * pDest[2]) >> 8;
+         pDest[3] = pDest[3] + (((255 - pDest[3]) * uAlpha) >> 8);
+      }
+      pDest += 4;
+      pSrc += 4;
+   }
+}
+
+//-------------------------------------------------------------
+// NEON kernels, 8 pixels per iteration, using de-interleaved channels
+
+#ifdef RENDER_KERNELS_HAS_NEON
+
+static void _render_span_fill_neon(u8* pDest, int iCount, u32 uPixel)
+{
+   uint32x4_t vPixel = vdupq_n_u32(uPixel);
+   u32* pDest32 = (u32*)pDest;
+   while ( iCount >= 8 )
+   {
+      vst1q_u32(pDest32, vPixel);
+      vst1q_u32(pDest32+4, vPixel);
+      pDest32 += 8;
+      iCount -= 8;
+   }
+   _render_span_fill_c((u8*)pDest32, iCount, uPixel);
+}
+
+static void _render_span_blend_color_neon(u8* pDest, int iCount, const u8* pColor, u8 uAlpha)
+{
+   uint8x8_t vAlpha = vdup_n_u8(uAlpha);
+   uint8x8_t vNegAlpha = vdup_n_u8(255 - uAlpha);
+   uint16x8_t vC0 = vdupq_n_u16(pColor[0] * uAlpha);
+   uint16x8_t vC1 = vdupq_n_u16(pColor[1] * uAlpha);
+   uint16x8_t vC2 = vdupq_n_u16(pColor[2] * uAlpha);
+   while ( iCount >= 8 )
+   {
+      uint8x8x4_t vPixels = vld4_u8(pDest);
+      vPixels.val[0] = vshrn_n_u16(vmlal_u8(vC0, vPixels.val[0], vNegAlpha), 8);
+      vPixels.val[1] = vshrn_n_u16(vmlal_u8(vC1, vPixels.val[1], vNegAlpha), 8);
+      vPixels.val[2] = vshrn_n_u16(vmlal_u8(vC2, vPixels.val[2], vNegAlpha), 8);
+      vPixels.val[3] = vadd_u8(vPixels.val[3], vshrn_n_u16(vmull_u8(vmvn_u8(vPixels.val[3]), vAlpha), 8));
+      vst4_u8(pDest, vPixels);
+      pDest += 32;
+      iCount -= 8;
+   }
+   _render_span_blend_color_c(pDest, iCount, pColor, uAlpha);
+}
+
+// Exact division by 255 of values up to 255*255: (x + (x>>8) + 1) >> 8
+static inline uint8x8_t _render_neon_div255(uint16x8_t vValue)
+{
+   vValue = vaddq_u16(vaddq_u16(vValue, vshrq_n_u16(vValue, 8)), vdupq_n_u16(1));
+   return vshrn_n_u16(vValue, 8);
+}
+
+static void _render_span_blit_alpha_neon(u8* pDest, const u8* pSrc, int iCount)
+{
+   while ( iCount >= 8 )
+   {
+      uint8x8x4_t vSrc = vld4_u8(pSrc);
+      // Skip fully transparent source pixels
+      if ( 0 != vget_lane_u64(vreinterpret_u64_u8(vSrc.val[3]), 0) )
+      {
+         uint8x8x4_t vDest = vld4_u8(pDest);
+         uint8x8_t vNegAlpha = vmvn_u8(vSrc.val[3]);
+         vDest.val[0] = _render_neon_div255(vmlal_u8(vmull_u8(vSrc.val[0], vSrc.val[3]), vDest.val[0], vNegAlpha));
+         vDest.val[1] = _render_neon_div255(vmlal_u8(vmull_u8(vSrc.val[1], vSrc.val[3]), vDest.val[1], vNegAlpha));
+         vDest.val[2] = _render_neon_div255(vmlal_u8(vmull_u8(vSrc.val[2], vSrc.val[3]), vDest.val[2], vNegAlpha));
+         vst4_u8(pDest, vDest);
+      }
+      pDest += 32;
+      pSrc += 32;
+      iCount -= 8;
+   }
+   _render_span_blit_alpha_c(pDest, pSrc, iCount);
+}
+
+static void _render_span_blend_premultiplied_neon(u8* pDest, const u8* pSrc, int iCount)
+{
+   while ( iCount >= 8 )
+   {
+      uint8x8x4_t vSrc = vld4_u8(pSrc);
+      uint8x8_t vAny = vorr_u8(vorr_u8(vSrc.val[0], vSrc.val[1]), vorr_u8(vSrc.val[2], vSrc.val[3]));
+      if ( 0 != vget_lane_u64(vreinterpret_u64_u8(vAny), 0) )
+      {
+         uint8x8x4_t vDest = vld4_u8(pDest);
+         uint8x8_t vNegAlpha = vmvn_u8(vSrc.val[3]);
+         vDest.val[0] = vqadd_u8(vSrc.val[0], _render_neon_div255(vmull_u8(vDest.val[0], vNegAlpha)));
+         vDest.val[1] = vqadd_u8(vSrc.val[1], _render_neon_div255(vmull_u8(vDest.val[1], vNegAlpha)));
+         vDest.val[2] = vqadd_u8(vSrc.val[2], _render_neon_div255(vmull_u8(vDest.val[2], vNegAlpha)));
+         vDest.val[3] = vqadd_u8(vSrc.val[3], _render_neon_div255(vmull_u8(vDest.val[3], vNegAlpha)));
+         vst4_u8(pDest, vDest);
+      }
+      pDest += 32;
+      pSrc += 32;
+      iCount -= 8;
+   }
+   _render_span_blend_premultiplied_c(pDest, pSrc, iCount);
+}
+
+static void _render_span_blend_mixed_neon(u8* pDest, const u8* pSrc, int iCount, const u8* pMixColor)
+{
+   uint8x8_t vMix0 = vdup_n_u8(pMixColor[0]);
+   uint8x8_t vMix1 = vdup_n_u8(pMixColor[1]);
+   uint8x8_t vMix2 = vdup_n_u8(pMixColor[2]);
+   uint8x8_t vMix3 = vdup_n_u8(pMixColor[3]);
+   while ( iCount >= 8 )
+   {
+      uint8x8x4_t vSrc = vld4_u8(pSrc);
+      uint8x8_t vAlpha = vshrn_n_u16(vmull_u8(vSrc.val[3], vMix3), 8);
+      if ( 0 != vget_lane_u64(vreinterpret_u64_u8(vAlpha), 0) )
+      {
+         uint8x8x4_t vDest = vld4_u8(pDest);
+         uint8x8_t vNegAlpha = vmvn_u8(vAlpha);
+         uint8x8_t vKeep = vceq_u8(vAlpha, vdup_n_u8(0));
+         uint8x8_t vColor;
+
+         vColor = vshrn_n_u16(vmull_u8(vSrc.val[0], vMix0), 8);
+         vDest.val[0] = vbsl_u8(vKeep, vDest.val[0], vshrn_n_u16(vmlal_u8(vmull_u8(vAlpha, vColor), vDest.val[0], vNegAlpha), 8));
+         vColor = vshrn_n_u16(vmull_u8(vSrc.val[1], vMix1), 8);
+         vDest.val[1] = vbsl_u8(vKeep, vDest.val[1], vshrn_n_u16(vmlal_u8(vmull_u8(vAlpha, vColor), vDest.val[1], vNegAlpha), 8));
+         vColor = vshrn_n_u16(vmull_u8(vSrc.val[2], vMix2), 8);
+         vDest.val[2] = vbsl_u8(vKeep, vDest.val[2], vshrn_n_u16(vmlal_u8(vmull_u8(vAlpha, vColor), vDest.val[2], vNegAlpha), 8));
+         vDest.val[3] = vadd_u8(vDest.val[3], vshrn_n_u16(vmull_u8(vmvn_u8(vDest.val[3]), vAlpha), 8));
+         vst4_u8(pDest, vDest);
+      }
+      pDest += 32;
+      pSrc += 32;
+      iCount -= 8;
+   }
+   _render_span_blend_mixed_c(pDest, pSrc, iCount, pMixColor);
+}
+
+#endif
+
+//-------------------------------------------------------------
+// SSE2 kernels, channels widened to 16 bits
+
+#ifdef RENDER_KERNELS_HAS_SSE2
+
+static void _render_span_fill_sse2(u8* pDest, int iCount, u32 uPixel)
+{
+   __m128i vPixel = _mm_set1_epi32((int)uPixel);
+   while ( iCount >= 8 )
+   {
+      _mm_storeu_si128((__m128i*)pDest, vPixel);
+      _mm_storeu_si128((__m128i*)(pDest+16), vPixel);
+      pDest += 32;
+      iCount -= 8;
+   }
+   _render_span_fill_c(pDest, iCount, uPixel);
+}
+
+static inline __m128i _render_sse2_blend_color_2px(__m128i vDest, __m128i vColorAlpha, __m128i vNegAlpha, __m128i vAlphaOnly, __m128i vAlphaLanes, __m128i v255)
+{
+   // Color lanes: (color*a + dest*(255-a)) >> 8, alpha lane: dest + ((255-dest)*a) >> 8
+   __m128i vResult = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(vDest, vNegAlpha), vColorAlpha), 8);
+   __m128i vAlpha = _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(v255, vDest), vAlphaOnly), 8);
+   return _mm_add_epi16(vResult, _mm_add_epi16(vAlpha, _mm_and_si128(vDest, vAlphaLanes)));
+}
+
+static void _render_span_blend_color_sse2(u8* pDest, int iCount, const u8* pColor, u8 uAlpha)
+{
+   __m128i vZero = _mm_setzero_si128();
+   __m128i v255 = _mm_set1_epi16(255);
+   short a = uAlpha;
+   short na = 255 - uAlpha;
+   __m128i vColorAlpha = _mm_set_epi16(0, pColor[2]*a, pColor[1]*a, pColor[0]*a, 0, pColor[2]*a, pColor[1]*a, pColor[0]*a);
+   __m128i vNegAlpha = _mm_set_epi16(0, na, na, na, 0, na, na, na);
+   __m128i vAlphaOnly = _mm_set_epi16(a, 0, 0, 0, a, 0, 0, 0);
+   __m128i vAlphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+   while ( iCount >= 8 )
+   {
+      for( int k=0; k<2; k++ )
+      {
+         __m128i vPixels = _mm_loadu_si128((__m128i*)(pDest + 16*k));
+         __m128i vLow = _render_sse2_blend_color_2px(_mm_unpacklo_epi8(vPixels, vZero), vColorAlpha, vNegAlpha, vAlphaOnly, vAlphaLanes, v255);
+         __m128i vHigh = _render_sse2_blend_color_2px(_mm_unpackhi_epi8(vPixels, vZero), vColorAlpha, vNegAlpha, vAlphaOnly, vAlphaLanes, v255);
+         _mm_storeu_si128((__m128i*)(pDest + 16*k), _mm_packus_epi16(vLow, vHigh));
+      }
+      pDest += 32;
+      iCount -= 8;
+   }
+   _render_span_blend_color_c(pDest, iCount, pColor, uAlpha);
+}
+
+static inline __m128i _render_sse2_broadcast_alpha(__m128i vPixels)
+{
+   return _mm_shufflehi_epi16(_mm_shufflelo_epi16(vPixels, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+}
+
+static inline __m128i _render_sse2_blit_alpha_2px(__m128i vDest, __m128i vSrc, __m128i vAlphaLanes, __m128i v255)
+{
+   __m128i vAlpha = _render_sse2_broadcast_alpha(vSrc);
+   __m128i vValue = _mm_add_epi16(_mm_mullo_epi16(vSrc, vAlpha), _mm_mullo_epi16(vDest, _mm_sub_epi16(v255, vAlpha)));
+   // Exact division by 255 of values up to 255*255: (x + (x>>8) + 1) >> 8
+   vValue = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(vValue, _mm_srli_epi16(vValue, 8)), _mm_set1_epi16(1)), 8);
+   return _mm_or_si128(_mm_andnot_si128(vAlphaLanes, vValue), _mm_and_si128(vAlphaLanes, vDest));
+}
+
+static void _render_span_blit_alpha_sse2(u8* pDest, const u8* pSrc, int iCount)
+{
+   __m128i vZero = _mm_setzero_si128();
+   __m128i v255 = _mm_set1_epi16(255);
+   __m128i vAlphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+   __m128i vAlphaMask32 = _mm_set1_epi32((int)0xFF000000);
+   while ( iCount >= 4 )
+   {
+      __m128i vSrc = _mm_loadu_si128((const __m128i*)pSrc);
+      // Skip fully transparent source pixels
+      if ( 0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(vSrc, vAlphaMask32), vZero)) )
+      {
+         __m128i vDest = _mm_loadu_si128((__m128i*)pDest);
+         __m128i vLow = _render_sse2_blit_alpha_2px(_mm_unpacklo_epi8(vDest, vZero), _mm_unpacklo_epi8(vSrc, vZero), vAlphaLanes, v255);
+         __m128i vHigh = _render_sse2_blit_alpha_2px(_mm_unpackhi_epi8(vDest, vZero), _mm_unpackhi_epi8(vSrc, vZero), vAlphaLanes, v255);
+         _mm_storeu_si128((__m128i*)pDest, _mm_packus_epi16(vLow, vHigh));
+      }
+      pDest += 16;
+      pSrc += 16;
+      iCount -= 4;
+   }
+   _render_span_blit_alpha_c(pDest, pSrc, iCount);
+}
+
+static inline __m128i _render_sse2_blend_premultiplied_2px(__m128i vDest, __m128i vSrc, __m128i v255)
+{
+   __m128i vValue = _mm_mullo_epi16(vDest, _mm_sub_epi16(v255, _render_sse2_broadcast_alpha(vSrc)));
+   vValue = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(vValue, _mm_srli_epi16(vValue, 8)), _mm_set1_epi16(1)), 8);
+   return _mm_add_epi16(vSrc, vValue);
+}
+
+static void _render_span_blend_premultiplied_sse2(u8* pDest, const u8* pSrc, int iCount)
+{
+   __m128i vZero = _mm_setzero_si128();
+   __m128i v255 = _mm_set1_epi16(255);
+   while ( iCount >= 4 )
+   {
+      __m128i vSrc = _mm_loadu_si128((const __m128i*)pSrc);
+      if ( 0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi8(vSrc, vZero)) )
+      {
+         __m128i vDest = _mm_loadu_si128((__m128i*)pDest);
+         __m128i vLow = _render_sse2_blend_premultiplied_2px(_mm_unpacklo_epi8(vDest, vZero), _mm_unpacklo_epi8(vSrc, vZero), v255);
+         __m128i vHigh = _render_sse2_blend_premultiplied_2px(_mm_unpackhi_epi8(vDest, vZero), _mm_unpackhi_epi8(vSrc, vZero), v255);
+         _mm_storeu_si128((__m128i*)pDest, _mm_packus_epi16(vLow, vHigh));
+      }
+      pDest += 16;
+      pSrc += 16;
+      iCount -= 4;
+   }
+   _render_span_blend_premultiplied_c(pDest, pSrc, iCount);
+}
+
+static inline __m128i _render_sse2_blend_mixed_2px(__m128i vDest, __m128i vSrc, __m128i vMix, __m128i vAlphaLanes, __m128i v255, __m128i vZero)
+{
+   __m128i vColor = _mm_srli_epi16(_mm_mullo_epi16(vSrc, vMix), 8);
+   __m128i vAlpha = _render_sse2_broadcast_alpha(vColor);
+   __m128i vResult = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(vColor, vAlpha), _mm_mullo_epi16(vDest, _mm_sub_epi16(v255, vAlpha))), 8);
+   __m128i vResultAlpha = _mm_add_epi16(vDest, _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(v255, vDest), vAlpha), 8));
+   vResult = _mm_or_si128(_mm_andnot_si128(vAlphaLanes, vResult), _mm_and_si128(vAlphaLanes, vResultAlpha));
+   // Fully transparent source pixels leave the destination unchanged
+   __m128i vKeep = _mm_cmpeq_epi16(vAlpha, vZero);
+   return _mm_or_si128(_mm_andnot_si128(vKeep, vResult), _mm_and_si128(vKeep, vDest));
+}
+
+static void _render_span_blend_mixed_sse2(u8* pDest, const u8* pSrc, int iCount, const u8* pMixColor)
+{
+   __m128i vZero = _mm_setzero_si128();
+   __m128i v255 = _mm_set1_epi16(255);
+   __m128i vAlphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+   __m128i vMix = _mm_set_epi16(pMixColor[3], pMixColor[2], pMixColor[1], pMixColor[0], pMixColor[3], pMixColor[2], pMixColor[1], pMixColor[0]);
+   __m128i vAlphaMask32 = _mm_set1_epi32((int)0xFF000000);
+   while ( iCount >= 4 )
+   {
+      __m128i vSrc = _mm_loadu_si128((const __m128i*)pSrc);
+      if ( 0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(vSrc, vAlphaMask32), vZero)) )
+      {
+         __m128i vDest = _mm_loadu_si128((__m128i*)pDest);
+         __m128i vLow = _render_sse2_blend_mixed_2px(_mm_unpacklo_epi8(vDest, vZero), _mm_unpacklo_epi8(vSrc, vZero), vMix, vAlphaLanes, v255, vZero);
+         __m128i vHigh = _render_sse2_blend_mixed_2px(_mm_unpackhi_epi8(vDest, vZero), _mm_unpackhi_epi8(vSrc, vZero), vMix, vAlphaLanes, v255, vZero);
+         _mm_storeu_si128((__m128i*)pDest, _mm_packus_epi16(vLow, vHigh));
+      }
+      pDest += 16;
+      pSrc += 16;
+      iCount -= 4;
+   }
+   _render_span_blend_mixed_c(pDest, pSrc, iCount, pMixColor);
+}
+
+#endif
+
+//-------------------------------------------------------------
+
+static void (*s_pRenderSpanFill)(u8*, int, u32) = _render_span_fill_c;
+static void (*s_pRenderSpanBlendColor)(u8*, int, const u8*, u8) = _render_span_blend_color_c;
+static void (*s_pRenderSpanBlitAlpha)(u8*, const u8*, int) = _render_span_blit_alpha_c;
+static void (*s_pRenderSpanBlendPremultiplied)(u8*, const u8*, int) = _render_span_blend_premultiplied_c;
+static void (*s_pRenderSpanBlendMixed)(u8*, const u8*, int, const u8*) = _render_span_blend_mixed_c;
+static const char* s_szRenderKernelsName = "portable";
+
+void render_kernels_init()
+{
+   #ifdef RENDER_KERNELS_HAS_NEON
+   int iHasNEON = 1;
+   #if defined(__arm__)
+   // 32 bit builds can run on CPUs without NEON (Pi Zero/Pi 1)
+   if ( 0 == (getauxval(AT_HWCAP) & HWCAP_NEON) )
+      iHasNEON = 0;
+   #endif
+   if ( iHasNEON )
+   {
+      s_pRenderSpanFill = _render_span_fill_neon;
+      s_pRenderSpanBlendColor = _render_span_blend_color_neon;
+      s_pRenderSpanBlitAlpha = _render_span_blit_alpha_neon;
+      s_pRenderSpanBlendPremultiplied = _render_span_blend_premultiplied_neon;
+      s_pRenderSpanBlendMixed = _render_span_blend_mixed_neon;
+      s_szRenderKernelsName = "NEON";
+   }
+   #endif
+
+   #ifdef RENDER_KERNELS_HAS_SSE2
+   if ( __builtin_cpu_supports("sse2") )
+   {
+      s_pRenderSpanFill = _render_span_fill_sse2;
+      s_pRenderSpanBlendColor = _render_span_blend_color_sse2;
+      s_pRenderSpanBlitAlpha = _render_span_blit_alpha_sse2;
+      s_pRenderSpanBlendPremultiplied = _render_span_blend_premultiplied_sse2;
+      s_pRenderSpanBlendMixed = _render_span_blend_mixed_sse2;
+      s_szRenderKernelsName = "SSE2";
+   }
+   #endif
+
+   log_line("[RenderKernels] Using %s span kernels.", s_szRenderKernelsName);
+}
+
+const char* render_kernels_get_name()
+{
+   return s_szRenderKernelsName;
+}
+
+void render_span_fill(u8* pDest, int iCount, u32 uPixel)
+{
+   if ( iCount > 0 )
+      s_pRenderSpanFill(pDest, iCount, uPixel);
+}
+
+void render_span_blend_color(u8* pDest, int iCount, const u8* pColor, u8 uAlpha)
+{
+   if ( iCount > 0 )
+      s_pRenderSpanBlendColor(pDest, iCount, pColor, uAlpha);
+}
+
+void render_span_blit_alpha(u8* pDest, const u8* pSrc, int iCount)
+{
+   if ( iCount > 0 )
+      s_pRenderSpanBlitAlpha(pDest, pSrc, iCount);
+}
+
+void render_span_blend_premultiplied(u8* pDest, const u8* pSrc, int iCount)
+{
+   if ( iCount > 0 )
+      s_pRenderSpanBlendPremultiplied(pDest, pSrc, iCount);
+}
+
+void render_span_blend_mixed(u8* pDest, const u8* pSrc, int iCount, const u8* pMixColor)
+{
+   if ( iCount > 0 )
+      s_pRenderSpanBlendMixed(pDest, pSrc, iCount, pMixColor);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "../base/base.h"
+
+// Span kernels used by the render engines to fill and blend rows of 4 bytes pixels.
+// Channel order is the one of the output buffer (RGBA or BGRA), alpha is always the last byte.
+// Vectorized implementations (NEON, SSE2) are selected at runtime by render_kernels_init,
+// the portable ones are used until then or if the CPU does not support them.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void render_kernels_init();
+const char* render_kernels_get_name();
+
+// Sets iCount pixels to uPixel (4 bytes, in buffer channel order)
+void render_span_fill(u8* pDest, int iCount, u32 uPixel);
+
+// Blends a solid color over iCount pixels: dest = (a*color + (255-a)*dest)/256, dest alpha += (255-dest alpha)*a/256
+// pColor has the 3 color channels in buffer order
+void render_span_blend_color(u8* pDest, int iCount, const u8* pColor, u8 uAlpha);
+
+// Blits iCount source pixels over destination using the source alpha: dest = (src*a + dest*(255-a))/255
+// Destination alpha is not changed
+void render_span_blit_alpha(u8* pDest, const u8* pSrc, int iCount);
+
+// Blends iCount premultiplied source pixels (as rendered by Cairo) over destination: dest = src + dest*(255-a)/255, for all channels
+void render_span_blend_premultiplied(u8* pDest, const u8* pSrc, int iCount);
+
+// Multiplies iCount source pixels with pMixColor (4 channels) and blends them over destination as in render_span_blend_color.
+// Fully transparent source pixels leave the destination unchanged
+void render_span_blend_mixed(u8* pDest, const u8* pSrc, int iCount, const u8* pMixColor);
+
+#ifdef __cplusplus
+}  
+#endif